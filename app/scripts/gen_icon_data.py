@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+#
+# Generate a C source embedding the app icon as zlib-compressed RGBA pixels,
+# so that the icon is pre-decoded at build time instead of decoding the PNG
+# at every startup (see app/src/icon.c).
+#
+# Usage: gen_icon_data.py <icon.png> <output.c>
+
+import os
+import struct
+import sys
+import zlib
+
+
+def fatal(msg):
+    sys.exit('gen_icon_data: ' + msg)
+
+
+def decode_png(data):
+    if data[:8] != b'\x89PNG\r\n\x1a\n':
+        fatal('not a PNG file')
+
+    width = height = None
+    idat = b''
+    pos = 8
+    while pos < len(data):
+        (length,) = struct.unpack('>I', data[pos:pos + 4])
+        ctype = data[pos + 4:pos + 8]
+        chunk = data[pos + 8:pos + 8 + length]
+        if ctype == b'IHDR':
+            width, height, depth, color, _, _, interlace = \
+                struct.unpack('>IIBBBBB', chunk)
+            if depth != 8 or color != 6 or interlace != 0:
+                fatal('only 8-bit non-interlaced RGBA is supported')
+        elif ctype == b'IDAT':
+            idat += chunk
+        pos += 12 + length
+
+    if width is None:
+        fatal('missing IHDR chunk')
+
+    raw = zlib.decompress(idat)
+
+    # undo the per-scanline filters (PNG spec, section 9)
+    stride = width * 4
+    pixels = bytearray()
+    prev = bytearray(stride)
+    pos = 0
+    for _ in range(height):
+        ftype = raw[pos]
+        pos += 1
+        line = bytearray(raw[pos:pos + stride])
+        pos += stride
+        if ftype == 1:  # Sub
+            for i in range(4, stride):
+                line[i] = (line[i] + line[i - 4]) & 0xff
+        elif ftype == 2:  # Up
+            for i in range(stride):
+                line[i] = (line[i] + prev[i]) & 0xff
+        elif ftype == 3:  # Average
+            for i in range(stride):
+                a = line[i - 4] if i >= 4 else 0
+                line[i] = (line[i] + (a + prev[i]) // 2) & 0xff
+        elif ftype == 4:  # Paeth
+            for i in range(stride):
+                a = line[i - 4] if i >= 4 else 0
+                b = prev[i]
+                c = prev[i - 4] if i >= 4 else 0
+                p = a + b - c
+                pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+                if pa <= pb and pa <= pc:
+                    pred = a
+                elif pb <= pc:
+                    pred = b
+                else:
+                    pred = c
+                line[i] = (line[i] + pred) & 0xff
+        elif ftype != 0:
+            fatal('unsupported filter type %d' % ftype)
+        pixels += line
+        prev = line
+
+    return width, height, bytes(pixels)
+
+
+def main():
+    if len(sys.argv) != 3:
+        fatal('usage: gen_icon_data.py <icon.png> <output.c>')
+
+    with open(sys.argv[1], 'rb') as f:
+        width, height, pixels = decode_png(f.read())
+
+    zdata = zlib.compress(pixels, 9)
+
+    with open(sys.argv[2], 'w') as out:
+        out.write('// Generated from %s by gen_icon_data.py, do not edit\n'
+                  % os.path.basename(sys.argv[1]))
+        out.write('#include "icon_data.h"\n\n')
+        out.write('const unsigned scrcpy_icon_width = %d;\n' % width)
+        out.write('const unsigned scrcpy_icon_height = %d;\n\n' % height)
+        out.write('const unsigned char scrcpy_icon_zdata[] = {\n')
+        for i in range(0, len(zdata), 12):
+            row = ', '.join('0x%02x' % b for b in zdata[i:i + 12])
+            out.write('    %s,\n' % row)
+        out.write('};\n\n')
+        out.write('const unsigned scrcpy_icon_zdata_len = %d;\n' % len(zdata))
+
+
+if __name__ == '__main__':
+    main()
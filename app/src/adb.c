@@ -5,9 +5,11 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "adb_client.h"
 #include "adb_parser.h"
 #include "util/file.h"
 #include "util/log.h"
+#include "util/net.h"
 #include "util/process_intr.h"
 #include "util/str.h"
 
@@ -219,6 +221,13 @@ adb_execute(const char *serial, const char *const adb_cmd[], size_t len,
 bool
 adb_forward(struct sc_intr *intr, const char *serial, uint16_t local_port,
             const char *device_socket_name, unsigned flags) {
+    if (sc_adb_client_available(intr)) {
+        // issue the command to the adb server directly, without forking an
+        // adb process
+        return sc_adb_client_forward(intr, serial, local_port,
+                                     device_socket_name, flags);
+    }
+
     char local[4 + 5 + 1]; // tcp:PORT
     char remote[108 + 14 + 1]; // localabstract:NAME
     sprintf(local, "tcp:%" PRIu16, local_port);
@@ -232,6 +241,10 @@ adb_forward(struct sc_intr *intr, const char *serial, uint16_t local_port,
 bool
 adb_forward_remove(struct sc_intr *intr, const char *serial,
                    uint16_t local_port, unsigned flags) {
+    if (sc_adb_client_available(intr)) {
+        return sc_adb_client_forward_remove(intr, serial, local_port, flags);
+    }
+
     char local[4 + 5 + 1]; // tcp:PORT
     sprintf(local, "tcp:%" PRIu16, local_port);
     const char *const adb_cmd[] = {"forward", "--remove", local};
@@ -244,6 +257,11 @@ bool
 adb_reverse(struct sc_intr *intr, const char *serial,
             const char *device_socket_name, uint16_t local_port,
             unsigned flags) {
+    if (sc_adb_client_available(intr)) {
+        return sc_adb_client_reverse(intr, serial, device_socket_name,
+                                     local_port, flags);
+    }
+
     char local[4 + 5 + 1]; // tcp:PORT
     char remote[108 + 14 + 1]; // localabstract:NAME
     sprintf(local, "tcp:%" PRIu16, local_port);
@@ -257,6 +275,11 @@ adb_reverse(struct sc_intr *intr, const char *serial,
 bool
 adb_reverse_remove(struct sc_intr *intr, const char *serial,
                    const char *device_socket_name, unsigned flags) {
+    if (sc_adb_client_available(intr)) {
+        return sc_adb_client_reverse_remove(intr, serial, device_socket_name,
+                                            flags);
+    }
+
     char remote[108 + 14 + 1]; // localabstract:NAME
     snprintf(remote, sizeof(remote), "localabstract:%s", device_socket_name);
     const char *const adb_cmd[] = {"reverse", "--remove", remote};
@@ -268,6 +291,12 @@ adb_reverse_remove(struct sc_intr *intr, const char *serial,
 bool
 adb_push(struct sc_intr *intr, const char *serial, const char *local,
          const char *remote, unsigned flags) {
+    if (sc_adb_client_available(intr)) {
+        // upload via the sync protocol (no quoting necessary, the paths are
+        // not parsed by a shell)
+        return sc_adb_client_push(intr, serial, local, remote, flags);
+    }
+
 #ifdef __WINDOWS__
     // Windows will parse the string, so the paths must be quoted
     // (see sys/win/command.c)
@@ -373,9 +402,52 @@ adb_disconnect(struct sc_intr *intr, const char *ip_port, unsigned flags) {
     return process_check_success_intr(intr, pid, "adb disconnect", flags);
 }
 
+char *
+adb_shell(struct sc_intr *intr, const char *serial, const char *cmd,
+          unsigned flags) {
+    if (sc_adb_client_available(intr)) {
+        return sc_adb_client_shell(intr, serial, cmd, flags);
+    }
+
+    const char *const adb_cmd[] = {"shell", cmd};
+
+    sc_pipe pout;
+    sc_pid pid =
+        adb_execute_p(serial, adb_cmd, ARRAY_LEN(adb_cmd), flags, &pout);
+    if (pid == SC_PROCESS_NONE) {
+        LOGE("Could not execute \"adb shell\"");
+        return NULL;
+    }
+
+    char buf[128];
+    ssize_t r = sc_pipe_read_all_intr(intr, pid, pout, buf, sizeof(buf));
+    sc_pipe_close(pout);
+
+    bool ok = process_check_success_intr(intr, pid, "adb shell", flags);
+    if (!ok) {
+        return NULL;
+    }
+
+    if (r == -1) {
+        return NULL;
+    }
+
+    sc_str_truncate(buf, r, " \r\n");
+
+    return strdup(buf);
+}
+
 char *
 adb_getprop(struct sc_intr *intr, const char *serial, const char *prop,
             unsigned flags) {
+    if (sc_adb_client_available(intr)) {
+        char cmd[128];
+        int len = snprintf(cmd, sizeof(cmd), "getprop %s", prop);
+        if (len > 0 && (size_t) len < sizeof(cmd)) {
+            return sc_adb_client_shell(intr, serial, cmd, flags);
+        }
+    }
+
     const char *const adb_cmd[] = {"shell", "getprop", prop};
 
     sc_pipe pout;
@@ -406,6 +478,10 @@ adb_getprop(struct sc_intr *intr, const char *serial, const char *prop,
 
 char *
 adb_get_serialno(struct sc_intr *intr, unsigned flags) {
+    if (sc_adb_client_available(intr)) {
+        return sc_adb_client_get_serialno(intr, flags);
+    }
+
     const char *const adb_cmd[] = {"get-serialno"};
 
     sc_pipe pout;
@@ -469,3 +545,90 @@ adb_get_device_ip(struct sc_intr *intr, const char *serial, unsigned flags) {
 
     return sc_adb_parse_device_ip_from_output(buf, r);
 }
+
+#define SC_ADB_TRACK_DEVICES "host:track-devices"
+
+static bool
+sc_adb_recv_exact(sc_socket socket, char *buf, size_t len) {
+    ssize_t r = net_recv_all(socket, buf, len);
+    return r != -1 && (size_t) r == len;
+}
+
+bool
+sc_adb_await_device(const char *serial) {
+    bool result = false;
+
+    sc_socket socket = net_socket();
+    if (socket == SC_SOCKET_NONE) {
+        return false;
+    }
+
+    if (!net_connect(socket, IPV4_LOCALHOST, SC_ADB_SERVER_PORT)) {
+        LOGW("Could not connect to the adb server");
+        goto end;
+    }
+
+    // adb smart socket requests are prefixed by their length as 4 hex chars
+    char request[64];
+    int len = snprintf(request, sizeof(request), "%04x" SC_ADB_TRACK_DEVICES,
+                       (unsigned) strlen(SC_ADB_TRACK_DEVICES));
+    assert(len > 0 && (size_t) len < sizeof(request));
+    if (net_send_all(socket, request, len) < len) {
+        LOGW("Could not request adb device tracking");
+        goto end;
+    }
+
+    char status[4];
+    if (!sc_adb_recv_exact(socket, status, sizeof(status))
+            || memcmp(status, "OKAY", 4)) {
+        LOGW("Device tracking rejected by the adb server");
+        goto end;
+    }
+
+    // the adb server pushes the full device list on every change
+    for (;;) {
+        char hex_len[5];
+        if (!sc_adb_recv_exact(socket, hex_len, 4)) {
+            goto end;
+        }
+        hex_len[4] = '\0';
+
+        char *endptr;
+        long payload_len = strtol(hex_len, &endptr, 16);
+        if (*endptr != '\0' || payload_len < 0) {
+            LOGW("Invalid adb device tracking payload");
+            goto end;
+        }
+
+        if (!payload_len) {
+            // no devices connected
+            continue;
+        }
+
+        char *payload = malloc(payload_len + 1);
+        if (!payload) {
+            LOG_OOM();
+            goto end;
+        }
+
+        bool ok = sc_adb_recv_exact(socket, payload, payload_len);
+        if (ok) {
+            payload[payload_len] = '\0';
+            result = sc_adb_parse_device_present(payload, payload_len + 1,
+                                                 serial);
+        }
+        free(payload);
+
+        if (!ok) {
+            goto end;
+        }
+        if (result) {
+            // Found
+            goto end;
+        }
+    }
+
+end:
+    net_close(socket);
+    return result;
+}
@@ -67,6 +67,17 @@ adb_connect(struct sc_intr *intr, const char *ip_port, unsigned flags);
 bool
 adb_disconnect(struct sc_intr *intr, const char *ip_port, unsigned flags);
 
+/**
+ * Execute `adb shell <cmd>` and capture its output
+ *
+ * Return the output with trailing whitespace removed, to be freed by the
+ * caller, or NULL on error. The output must fit in a small internal buffer
+ * (128 bytes), this is only intended for short probe commands.
+ */
+char *
+adb_shell(struct sc_intr *intr, const char *serial, const char *cmd,
+          unsigned flags);
+
 /**
  * Execute `adb getprop <prop>`
  */
@@ -91,4 +102,16 @@ adb_get_serialno(struct sc_intr *intr, unsigned flags);
 char *
 adb_get_device_ip(struct sc_intr *intr, const char *serial, unsigned flags);
 
+/**
+ * Wait until a device matching `serial` (any device if NULL) is connected
+ *
+ * Subscribe to the "host:track-devices" service of the adb server, which
+ * pushes the device list on every change, so the function returns as soon as
+ * the device is fully enumerated, without polling.
+ *
+ * Return false if the adb server could not be reached or the protocol failed.
+ */
+bool
+sc_adb_await_device(const char *serial);
+
 #endif
@@ -0,0 +1,555 @@
+#include "adb_client.h"
+
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "adb.h"
+#include "util/log.h"
+#include "util/net_intr.h"
+#include "util/str.h"
+
+// sync protocol: chunks are at most 64k
+#define SC_ADB_SYNC_MAX_CHUNK 65536
+// remote mode of pushed files: regular file, rw-r--r-- (Linux representation)
+#define SC_ADB_SYNC_PUSH_MODE 0100644
+// file type bits in the remote mode
+#define SC_ADB_SYNC_IFMT 0170000
+#define SC_ADB_SYNC_IFDIR 0040000
+
+// the server has been reached at least once (it stays up once started)
+static atomic_bool server_reached;
+
+// the sync protocol uses little-endian integers (contrary to the scrcpy
+// protocol, so buffer_util.h helpers do not apply)
+static inline void
+write32le(uint8_t *buf, uint32_t value) {
+    buf[0] = value;
+    buf[1] = value >> 8;
+    buf[2] = value >> 16;
+    buf[3] = value >> 24;
+}
+
+static inline uint32_t
+read32le(const uint8_t *buf) {
+    return buf[0] | ((uint32_t) buf[1] << 8) | ((uint32_t) buf[2] << 16)
+                  | ((uint32_t) buf[3] << 24);
+}
+
+static sc_socket
+sc_adb_client_open(struct sc_intr *intr) {
+    sc_socket socket = net_socket();
+    if (socket == SC_SOCKET_NONE) {
+        return SC_SOCKET_NONE;
+    }
+
+    if (!net_connect_intr(intr, socket, IPV4_LOCALHOST, SC_ADB_SERVER_PORT)) {
+        net_close(socket);
+        return SC_SOCKET_NONE;
+    }
+
+    return socket;
+}
+
+static bool
+sc_adb_client_send_request(struct sc_intr *intr, sc_socket socket,
+                           const char *service) {
+    // adb smart socket requests are prefixed by their length as 4 hex chars
+    char request[256];
+    int len = snprintf(request, sizeof(request), "%04x%s",
+                       (unsigned) strlen(service), service);
+    if (len < 0 || (size_t) len >= sizeof(request)) {
+        LOGE("adb service name too long: %s", service);
+        return false;
+    }
+
+    return net_send_all_intr(intr, socket, request, len) == len;
+}
+
+static void
+sc_adb_client_log_failure(struct sc_intr *intr, sc_socket socket,
+                          const char *service, unsigned flags) {
+    if (flags & SC_ADB_NO_LOGERR) {
+        return;
+    }
+
+    // a FAIL status is followed by a hex-length-prefixed error message
+    char hex_len[5];
+    if (net_recv_all_intr(intr, socket, hex_len, 4) != 4) {
+        LOGE("adb server: \"%s\" failed", service);
+        return;
+    }
+    hex_len[4] = '\0';
+
+    char *endptr;
+    long message_len = strtol(hex_len, &endptr, 16);
+    if (*endptr != '\0' || message_len <= 0) {
+        LOGE("adb server: \"%s\" failed", service);
+        return;
+    }
+
+    char message[256];
+    if ((size_t) message_len >= sizeof(message)) {
+        message_len = sizeof(message) - 1;
+    }
+
+    ssize_t r = net_recv_all_intr(intr, socket, message, message_len);
+    if (r == -1) {
+        r = 0;
+    }
+    message[r] = '\0';
+    LOGE("adb server: \"%s\" failed: %s", service, message);
+}
+
+static bool
+sc_adb_client_recv_status(struct sc_intr *intr, sc_socket socket,
+                          const char *service, unsigned flags) {
+    char status[4];
+    if (net_recv_all_intr(intr, socket, status, sizeof(status))
+            != (ssize_t) sizeof(status)) {
+        if (!(flags & SC_ADB_NO_LOGERR)) {
+            LOGE("adb server: no status for \"%s\"", service);
+        }
+        return false;
+    }
+
+    if (!memcmp(status, "OKAY", 4)) {
+        return true;
+    }
+
+    sc_adb_client_log_failure(intr, socket, service, flags);
+    return false;
+}
+
+// read a hex-length-prefixed payload, to be freed by the caller
+static char *
+sc_adb_client_recv_payload(struct sc_intr *intr, sc_socket socket) {
+    char hex_len[5];
+    if (net_recv_all_intr(intr, socket, hex_len, 4) != 4) {
+        return NULL;
+    }
+    hex_len[4] = '\0';
+
+    char *endptr;
+    long payload_len = strtol(hex_len, &endptr, 16);
+    if (*endptr != '\0' || payload_len < 0) {
+        return NULL;
+    }
+
+    char *payload = malloc(payload_len + 1);
+    if (!payload) {
+        LOG_OOM();
+        return NULL;
+    }
+
+    if (net_recv_all_intr(intr, socket, payload, payload_len) != payload_len) {
+        free(payload);
+        return NULL;
+    }
+
+    payload[payload_len] = '\0';
+    return payload;
+}
+
+// switch the connection to the device transport, further requests are
+// forwarded to adbd
+static bool
+sc_adb_client_transport(struct sc_intr *intr, sc_socket socket,
+                        const char *serial, unsigned flags) {
+    char service[128];
+    int len;
+    if (serial) {
+        len = snprintf(service, sizeof(service), "host:transport:%s", serial);
+    } else {
+        len = snprintf(service, sizeof(service), "host:transport-any");
+    }
+    if (len < 0 || (size_t) len >= sizeof(service)) {
+        return false;
+    }
+
+    return sc_adb_client_send_request(intr, socket, service)
+        && sc_adb_client_recv_status(intr, socket, service, flags);
+}
+
+// Execute a (kill)forward-family command: the first OKAY acknowledges the
+// request, then a second status reports the result (but on success some
+// server versions close the connection instead)
+static bool
+sc_adb_client_forward_command(struct sc_intr *intr, sc_socket socket,
+                              const char *service, unsigned flags) {
+    if (!sc_adb_client_send_request(intr, socket, service)
+            || !sc_adb_client_recv_status(intr, socket, service, flags)) {
+        return false;
+    }
+
+    char status[4];
+    ssize_t r = net_recv_all_intr(intr, socket, status, sizeof(status));
+    if (r == (ssize_t) sizeof(status) && !memcmp(status, "FAIL", 4)) {
+        sc_adb_client_log_failure(intr, socket, service, flags);
+        return false;
+    }
+
+    return true;
+}
+
+bool
+sc_adb_client_available(struct sc_intr *intr) {
+    if (atomic_load_explicit(&server_reached, memory_order_relaxed)) {
+        return true;
+    }
+
+    sc_socket socket = sc_adb_client_open(intr);
+    if (socket == SC_SOCKET_NONE) {
+        // the adb binary will start the server
+        return false;
+    }
+
+    bool ok = sc_adb_client_send_request(intr, socket, "host:version")
+           && sc_adb_client_recv_status(intr, socket, "host:version",
+                                        SC_ADB_NO_LOGERR);
+    net_close(socket);
+
+    if (ok) {
+        atomic_store_explicit(&server_reached, true, memory_order_relaxed);
+    }
+    return ok;
+}
+
+bool
+sc_adb_client_forward(struct sc_intr *intr, const char *serial,
+                      uint16_t local_port, const char *device_socket_name,
+                      unsigned flags) {
+    char service[256];
+    int len;
+    if (serial) {
+        len = snprintf(service, sizeof(service),
+                       "host-serial:%s:forward:tcp:%" PRIu16
+                           ";localabstract:%s",
+                       serial, local_port, device_socket_name);
+    } else {
+        len = snprintf(service, sizeof(service),
+                       "host:forward:tcp:%" PRIu16 ";localabstract:%s",
+                       local_port, device_socket_name);
+    }
+    if (len < 0 || (size_t) len >= sizeof(service)) {
+        return false;
+    }
+
+    sc_socket socket = sc_adb_client_open(intr);
+    if (socket == SC_SOCKET_NONE) {
+        return false;
+    }
+
+    bool ok = sc_adb_client_forward_command(intr, socket, service, flags);
+    net_close(socket);
+    return ok;
+}
+
+bool
+sc_adb_client_forward_remove(struct sc_intr *intr, const char *serial,
+                             uint16_t local_port, unsigned flags) {
+    char service[256];
+    int len;
+    if (serial) {
+        len = snprintf(service, sizeof(service),
+                       "host-serial:%s:killforward:tcp:%" PRIu16,
+                       serial, local_port);
+    } else {
+        len = snprintf(service, sizeof(service),
+                       "host:killforward:tcp:%" PRIu16, local_port);
+    }
+    if (len < 0 || (size_t) len >= sizeof(service)) {
+        return false;
+    }
+
+    sc_socket socket = sc_adb_client_open(intr);
+    if (socket == SC_SOCKET_NONE) {
+        return false;
+    }
+
+    bool ok = sc_adb_client_forward_command(intr, socket, service, flags);
+    net_close(socket);
+    return ok;
+}
+
+bool
+sc_adb_client_reverse(struct sc_intr *intr, const char *serial,
+                      const char *device_socket_name, uint16_t local_port,
+                      unsigned flags) {
+    // reverse commands are executed by adbd, behind a transport
+    char service[256];
+    int len = snprintf(service, sizeof(service),
+                       "reverse:forward:localabstract:%s;tcp:%" PRIu16,
+                       device_socket_name, local_port);
+    if (len < 0 || (size_t) len >= sizeof(service)) {
+        return false;
+    }
+
+    sc_socket socket = sc_adb_client_open(intr);
+    if (socket == SC_SOCKET_NONE) {
+        return false;
+    }
+
+    bool ok = sc_adb_client_transport(intr, socket, serial, flags)
+           && sc_adb_client_forward_command(intr, socket, service, flags);
+    net_close(socket);
+    return ok;
+}
+
+bool
+sc_adb_client_reverse_remove(struct sc_intr *intr, const char *serial,
+                             const char *device_socket_name, unsigned flags) {
+    char service[256];
+    int len = snprintf(service, sizeof(service),
+                       "reverse:killforward:localabstract:%s",
+                       device_socket_name);
+    if (len < 0 || (size_t) len >= sizeof(service)) {
+        return false;
+    }
+
+    sc_socket socket = sc_adb_client_open(intr);
+    if (socket == SC_SOCKET_NONE) {
+        return false;
+    }
+
+    bool ok = sc_adb_client_transport(intr, socket, serial, flags)
+           && sc_adb_client_forward_command(intr, socket, service, flags);
+    net_close(socket);
+    return ok;
+}
+
+// send a sync request: 4-char id, little-endian path length, path
+static bool
+sc_adb_client_sync_send(struct sc_intr *intr, sc_socket socket, const char *id,
+                        const char *path) {
+    size_t path_len = strlen(path);
+    uint8_t header[8];
+    memcpy(header, id, 4);
+    write32le(&header[4], path_len);
+    return net_send_all_intr(intr, socket, header, sizeof(header))
+               == (ssize_t) sizeof(header)
+        && net_send_all_intr(intr, socket, path, path_len)
+               == (ssize_t) path_len;
+}
+
+// return true if `remote` names an existing directory on the device
+static bool
+sc_adb_client_sync_is_dir(struct sc_intr *intr, sc_socket socket,
+                          const char *remote) {
+    if (!sc_adb_client_sync_send(intr, socket, "STAT", remote)) {
+        return false;
+    }
+
+    uint8_t response[16]; // id, mode, size, time
+    if (net_recv_all_intr(intr, socket, response, sizeof(response))
+            != (ssize_t) sizeof(response)
+            || memcmp(response, "STAT", 4)) {
+        return false;
+    }
+
+    uint32_t mode = read32le(&response[4]);
+    return (mode & SC_ADB_SYNC_IFMT) == SC_ADB_SYNC_IFDIR;
+}
+
+bool
+sc_adb_client_push(struct sc_intr *intr, const char *serial, const char *local,
+                   const char *remote, unsigned flags) {
+    bool result = false;
+    char *dest = NULL;
+    uint8_t *chunk = NULL;
+    FILE *file = NULL;
+
+    sc_socket socket = sc_adb_client_open(intr);
+    if (socket == SC_SOCKET_NONE) {
+        return false;
+    }
+
+    if (!sc_adb_client_transport(intr, socket, serial, flags)
+            || !sc_adb_client_send_request(intr, socket, "sync:")
+            || !sc_adb_client_recv_status(intr, socket, "sync:", flags)) {
+        goto end;
+    }
+
+    size_t remote_len = strlen(remote);
+    bool trailing_slash = remote_len && remote[remote_len - 1] == '/';
+    if (trailing_slash || sc_adb_client_sync_is_dir(intr, socket, remote)) {
+        // like "adb push", send to <remote>/<basename of local>
+        const char *base = strrchr(local, '/');
+#ifdef __WINDOWS__
+        const char *base_win = strrchr(local, '\\');
+        if (base_win > base) {
+            base = base_win;
+        }
+#endif
+        base = base ? base + 1 : local;
+
+        dest = malloc(remote_len + 1 + strlen(base) + 1);
+        if (!dest) {
+            LOG_OOM();
+            goto end;
+        }
+        if (trailing_slash) {
+            sprintf(dest, "%s%s", remote, base);
+        } else {
+            sprintf(dest, "%s/%s", remote, base);
+        }
+        remote = dest;
+    }
+
+    // the SEND argument is "<path>,<mode>" with the mode in decimal
+    char send_arg[512];
+    int len = snprintf(send_arg, sizeof(send_arg), "%s,%d", remote,
+                       SC_ADB_SYNC_PUSH_MODE);
+    if (len < 0 || (size_t) len >= sizeof(send_arg)) {
+        goto end;
+    }
+
+    file = fopen(local, "rb");
+    if (!file) {
+        if (!(flags & SC_ADB_NO_LOGERR)) {
+            LOGE("Could not open \"%s\"", local);
+        }
+        goto end;
+    }
+
+    // read each chunk right after an 8-byte header slot, so that header and
+    // payload are sent in a single call
+    chunk = malloc(8 + SC_ADB_SYNC_MAX_CHUNK);
+    if (!chunk) {
+        LOG_OOM();
+        goto end;
+    }
+
+    if (!sc_adb_client_sync_send(intr, socket, "SEND", send_arg)) {
+        goto end;
+    }
+
+    for (;;) {
+        size_t r = fread(&chunk[8], 1, SC_ADB_SYNC_MAX_CHUNK, file);
+        if (!r) {
+            if (ferror(file)) {
+                if (!(flags & SC_ADB_NO_LOGERR)) {
+                    LOGE("Could not read \"%s\"", local);
+                }
+                goto end;
+            }
+            break;
+        }
+
+        memcpy(chunk, "DATA", 4);
+        write32le(&chunk[4], r);
+        if (net_send_all_intr(intr, socket, chunk, 8 + r)
+                != (ssize_t) (8 + r)) {
+            goto end;
+        }
+    }
+
+    uint8_t done[8];
+    memcpy(done, "DONE", 4);
+    write32le(&done[4], (uint32_t) time(NULL)); // remote mtime
+    if (net_send_all_intr(intr, socket, done, sizeof(done))
+            != (ssize_t) sizeof(done)) {
+        goto end;
+    }
+
+    uint8_t response[8];
+    if (net_recv_all_intr(intr, socket, response, sizeof(response))
+            != (ssize_t) sizeof(response)) {
+        goto end;
+    }
+
+    if (memcmp(response, "OKAY", 4)) {
+        if (!(flags & SC_ADB_NO_LOGERR)) {
+            char message[256];
+            size_t message_len = read32le(&response[4]);
+            if (message_len >= sizeof(message)) {
+                message_len = sizeof(message) - 1;
+            }
+            ssize_t r =
+                net_recv_all_intr(intr, socket, message, message_len);
+            if (r == -1) {
+                r = 0;
+            }
+            message[r] = '\0';
+            LOGE("adb sync: could not push to \"%s\": %s", remote, message);
+        }
+        goto end;
+    }
+
+    result = true;
+
+end:
+    if (file) {
+        fclose(file);
+    }
+    free(chunk);
+    free(dest);
+    net_close(socket);
+    return result;
+}
+
+char *
+sc_adb_client_shell(struct sc_intr *intr, const char *serial, const char *cmd,
+                    unsigned flags) {
+    char service[256];
+    int len = snprintf(service, sizeof(service), "shell:%s", cmd);
+    if (len < 0 || (size_t) len >= sizeof(service)) {
+        return NULL;
+    }
+
+    sc_socket socket = sc_adb_client_open(intr);
+    if (socket == SC_SOCKET_NONE) {
+        return NULL;
+    }
+
+    char *result = NULL;
+    if (sc_adb_client_transport(intr, socket, serial, flags)
+            && sc_adb_client_send_request(intr, socket, service)
+            && sc_adb_client_recv_status(intr, socket, service, flags)) {
+        // the output is not length-prefixed, read until EOF
+        char buf[1024];
+        size_t idx = 0;
+        while (idx < sizeof(buf) - 1) {
+            ssize_t r = net_recv_intr(intr, socket, &buf[idx],
+                                      sizeof(buf) - 1 - idx);
+            if (r <= 0) {
+                break;
+            }
+            idx += r;
+        }
+
+        sc_str_truncate(buf, idx, " \r\n");
+        result = strdup(buf);
+        if (!result) {
+            LOG_OOM();
+        }
+    }
+
+    net_close(socket);
+    return result;
+}
+
+char *
+sc_adb_client_get_serialno(struct sc_intr *intr, unsigned flags) {
+    const char *service = "host:get-serialno";
+
+    sc_socket socket = sc_adb_client_open(intr);
+    if (socket == SC_SOCKET_NONE) {
+        return NULL;
+    }
+
+    char *result = NULL;
+    if (sc_adb_client_send_request(intr, socket, service)
+            && sc_adb_client_recv_status(intr, socket, service, flags)) {
+        result = sc_adb_client_recv_payload(intr, socket);
+        if (result) {
+            sc_str_truncate(result, strlen(result), " \r\n");
+        }
+    }
+
+    net_close(socket);
+    return result;
+}
@@ -0,0 +1,80 @@
+#ifndef SC_ADB_CLIENT_H
+#define SC_ADB_CLIENT_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "util/intr.h"
+#include "util/net.h"
+
+// Native client for the local adb server "smart socket" protocol
+//
+// Speaking the protocol directly avoids forking one adb process (~30-50ms)
+// per command; connecting a socket to the local server costs microseconds.
+// Commands which require the adb binary itself (starting the server,
+// installing packages, managing transports) still go through adb.c.
+//
+// The `flags` parameters accept the SC_ADB_* flags from adb.h (only
+// SC_ADB_NO_LOGERR is relevant, there is no child process stdio to silence).
+
+#define SC_ADB_SERVER_PORT 5037
+
+/**
+ * Return true if the local adb server currently accepts connections
+ *
+ * A positive result is cached (the server stays up once started), a negative
+ * result is not, so that callers retry once the server has been started by a
+ * spawned adb process.
+ */
+bool
+sc_adb_client_available(struct sc_intr *intr);
+
+bool
+sc_adb_client_forward(struct sc_intr *intr, const char *serial,
+                      uint16_t local_port, const char *device_socket_name,
+                      unsigned flags);
+
+bool
+sc_adb_client_forward_remove(struct sc_intr *intr, const char *serial,
+                             uint16_t local_port, unsigned flags);
+
+bool
+sc_adb_client_reverse(struct sc_intr *intr, const char *serial,
+                      const char *device_socket_name, uint16_t local_port,
+                      unsigned flags);
+
+bool
+sc_adb_client_reverse_remove(struct sc_intr *intr, const char *serial,
+                             const char *device_socket_name, unsigned flags);
+
+/**
+ * Upload a file via the sync protocol
+ *
+ * If `remote` is an existing directory (or ends with '/'), the basename of
+ * `local` is appended, like "adb push".
+ */
+bool
+sc_adb_client_push(struct sc_intr *intr, const char *serial, const char *local,
+                   const char *remote, unsigned flags);
+
+/**
+ * Run a shell command on the device and return its output
+ *
+ * The result is truncated at the first whitespace (like the adb.c getprop
+ * helpers), to be freed by the caller (NULL on error).
+ */
+char *
+sc_adb_client_shell(struct sc_intr *intr, const char *serial, const char *cmd,
+                    unsigned flags);
+
+/**
+ * Query the serial of the current device ("host:get-serialno")
+ *
+ * Return the result, to be freed by the caller, or NULL on error.
+ */
+char *
+sc_adb_client_get_serialno(struct sc_intr *intr, unsigned flags);
+
+#endif
@@ -63,3 +63,52 @@ sc_adb_parse_device_ip_from_output(char *buf, size_t buf_len) {
 
     return NULL;
 }
+
+static bool
+sc_adb_parse_device_present_line(char *line, size_t len, const char *serial) {
+    // One line from the "host:track-devices" payload looks like:
+    // "0123456789abcdef\tdevice"
+
+    ssize_t idx_state = sc_str_index_of_column(line, 1, "\t");
+    if (idx_state == -1) {
+        return false;
+    }
+
+    char *state = &line[idx_state];
+    sc_str_truncate(state, len - idx_state + 1, " \t");
+    if (strcmp(state, "device")) {
+        // not fully enumerated yet (e.g. "offline", "unauthorized")
+        return false;
+    }
+
+    if (!serial) {
+        // any device matches
+        return true;
+    }
+
+    char *line_serial = line;
+    sc_str_truncate(line_serial, len + 1, " \t");
+    return !strcmp(line_serial, serial);
+}
+
+bool
+sc_adb_parse_device_present(char *buf, size_t buf_len, const char *serial) {
+    size_t idx_line = 0;
+    while (idx_line < buf_len && buf[idx_line] != '\0') {
+        char *line = &buf[idx_line];
+        size_t len = sc_str_truncate(line, buf_len - idx_line, "\n");
+
+        // The same, but without any trailing '\r'
+        size_t line_len = sc_str_remove_trailing_cr(line, len);
+
+        if (sc_adb_parse_device_present_line(line, line_len, serial)) {
+            // Found
+            return true;
+        }
+
+        // The next line starts after the '\n' (replaced by `\0`)
+        idx_line += len + 1;
+    }
+
+    return false;
+}
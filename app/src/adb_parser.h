@@ -11,4 +11,15 @@
 char *
 sc_adb_parse_device_ip_from_output(char *buf, size_t buf_len);
 
+/**
+ * Parse a device list payload from the adb "host:track-devices" service
+ *
+ * Each line is "<serial>\t<state>". Return true if a device matching
+ * `serial` (any device if `serial` is NULL) is in the "device" state.
+ *
+ * The buffer may be modified in place.
+ */
+bool
+sc_adb_parse_device_present(char *buf, size_t buf_len, const char *serial);
+
 #endif
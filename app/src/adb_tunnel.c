@@ -116,6 +116,7 @@ void
 sc_adb_tunnel_init(struct sc_adb_tunnel *tunnel) {
     tunnel->enabled = false;
     tunnel->forward = false;
+    tunnel->direct = false;
     tunnel->server_socket = SC_SOCKET_NONE;
     tunnel->local_port = 0;
 }
@@ -141,11 +142,28 @@ sc_adb_tunnel_open(struct sc_adb_tunnel *tunnel, struct sc_intr *intr,
     return enable_tunnel_forward_any_port(tunnel, intr, serial, port_range);
 }
 
+void
+sc_adb_tunnel_open_direct(struct sc_adb_tunnel *tunnel, uint16_t port) {
+    assert(!tunnel->enabled);
+
+    // like "adb forward": the server listens, the client connects
+    tunnel->forward = true;
+    tunnel->direct = true;
+    tunnel->local_port = port;
+    tunnel->enabled = true;
+}
+
 bool
 sc_adb_tunnel_close(struct sc_adb_tunnel *tunnel, struct sc_intr *intr,
                     const char *serial) {
     assert(tunnel->enabled);
 
+    if (tunnel->direct) {
+        // nothing to clean up, no adb tunnel was set up
+        tunnel->enabled = false;
+        return true;
+    }
+
     bool ret;
     if (tunnel->forward) {
         ret = adb_forward_remove(intr, serial, tunnel->local_port,
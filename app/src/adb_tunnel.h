@@ -13,6 +13,9 @@
 struct sc_adb_tunnel {
     bool enabled;
     bool forward; // use "adb forward" instead of "adb reverse"
+    // direct TCP connection to the device, no adb tunnel at all (the
+    // "tunnel" only records the port the server listens on)
+    bool direct;
     sc_socket server_socket; // only used if !forward
     uint16_t local_port;
 };
@@ -37,6 +40,16 @@ sc_adb_tunnel_open(struct sc_adb_tunnel *tunnel, struct sc_intr *intr,
                    const char *serial, struct sc_port_range port_range,
                    bool force_adb_forward);
 
+/**
+ * Set up a direct TCP "tunnel"
+ *
+ * No adb command is involved: the server listens on `port` on the device, and
+ * the client connects to it directly (the device IP is resolved by the
+ * caller).
+ */
+void
+sc_adb_tunnel_open_direct(struct sc_adb_tunnel *tunnel, uint16_t port);
+
 /**
  * Close the tunnel
  */
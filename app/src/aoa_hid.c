@@ -2,6 +2,8 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "aoa_hid.h"
 #include "util/log.h"
@@ -159,6 +161,28 @@ sc_aoa_init(struct sc_aoa *aoa, const char *serial,
         return false;
     }
 
+    for (unsigned i = 0; i < SC_AOA_INFLIGHT; ++i) {
+        struct sc_aoa_transfer *slot = &aoa->transfers[i];
+        slot->transfer = libusb_alloc_transfer(0);
+        if (!slot->transfer) {
+            LOG_OOM();
+            while (i) {
+                libusb_free_transfer(aoa->transfers[--i].transfer);
+            }
+            libusb_close(aoa->usb_handle);
+            libusb_unref_device(aoa->usb_device);
+            libusb_exit(aoa->usb_context);
+            sc_cond_destroy(&aoa->event_cond);
+            sc_mutex_destroy(&aoa->mutex);
+            return false;
+        }
+        slot->aoa = aoa;
+        slot->buffer = NULL;
+        slot->buffer_size = 0;
+        slot->in_flight = false;
+    }
+    aoa->inflight_count = 0;
+
     aoa->stopped = false;
     aoa->acksync = acksync;
 
@@ -173,6 +197,13 @@ sc_aoa_destroy(struct sc_aoa *aoa) {
         sc_hid_event_destroy(&event);
     }
 
+    // in-flight transfers have been reaped by the AOA thread before exiting
+    assert(!aoa->inflight_count);
+    for (unsigned i = 0; i < SC_AOA_INFLIGHT; ++i) {
+        libusb_free_transfer(aoa->transfers[i].transfer);
+        free(aoa->transfers[i].buffer);
+    }
+
     libusb_close(aoa->usb_handle);
     libusb_unref_device(aoa->usb_device);
     libusb_exit(aoa->usb_context);
@@ -259,8 +290,49 @@ sc_aoa_setup_hid(struct sc_aoa *aoa, uint16_t accessory_id,
     return true;
 }
 
-static bool
-sc_aoa_send_hid_event(struct sc_aoa *aoa, const struct sc_hid_event *event) {
+// Completion callback, called from libusb_handle_events() on the AOA thread
+static void
+sc_aoa_on_event_sent(struct libusb_transfer *transfer) {
+    struct sc_aoa_transfer *slot = transfer->user_data;
+    struct sc_aoa *aoa = slot->aoa;
+
+    if (transfer->status != LIBUSB_TRANSFER_COMPLETED
+            && transfer->status != LIBUSB_TRANSFER_CANCELLED) {
+        LOGW("Could not send HID event to USB device");
+    }
+
+    assert(slot->in_flight);
+    slot->in_flight = false;
+    assert(aoa->inflight_count);
+    --aoa->inflight_count;
+}
+
+// Submit the event asynchronously on a free transfer slot (the caller must
+// ensure that one is available) and return immediately, without waiting for
+// the USB round-trip; consumes the event
+static void
+sc_aoa_submit_hid_event(struct sc_aoa *aoa, struct sc_hid_event *event) {
+    struct sc_aoa_transfer *slot = NULL;
+    for (unsigned i = 0; i < SC_AOA_INFLIGHT; ++i) {
+        if (!aoa->transfers[i].in_flight) {
+            slot = &aoa->transfers[i];
+            break;
+        }
+    }
+    assert(slot);
+
+    uint16_t buffer_size = LIBUSB_CONTROL_SETUP_SIZE + event->size;
+    if (slot->buffer_size < buffer_size) {
+        unsigned char *buffer = realloc(slot->buffer, buffer_size);
+        if (!buffer) {
+            LOG_OOM();
+            sc_hid_event_destroy(event);
+            return;
+        }
+        slot->buffer = buffer;
+        slot->buffer_size = buffer_size;
+    }
+
     uint8_t request_type = LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR;
     uint8_t request = ACCESSORY_SEND_HID_EVENT;
     // <https://source.android.com/devices/accessories/aoa2.html#hid-support>
@@ -268,17 +340,24 @@ sc_aoa_send_hid_event(struct sc_aoa *aoa, const struct sc_hid_event *event) {
     // index (arg1): 0 (unused)
     uint16_t value = event->accessory_id;
     uint16_t index = 0;
-    unsigned char *buffer = event->buffer;
-    uint16_t length = event->size;
-    int result = libusb_control_transfer(aoa->usb_handle, request_type, request,
-                                         value, index, buffer, length,
-                                         DEFAULT_TIMEOUT);
+    libusb_fill_control_setup(slot->buffer, request_type, request, value,
+                              index, event->size);
+    memcpy(slot->buffer + LIBUSB_CONTROL_SETUP_SIZE, event->buffer,
+           event->size);
+    // the report data has been copied into the slot buffer
+    sc_hid_event_destroy(event);
+
+    libusb_fill_control_transfer(slot->transfer, aoa->usb_handle, slot->buffer,
+                                 sc_aoa_on_event_sent, slot, DEFAULT_TIMEOUT);
+    int result = libusb_submit_transfer(slot->transfer);
     if (result < 0) {
         log_libusb_error((enum libusb_error) result);
-        return false;
+        LOGW("Could not send HID event to USB device");
+        return;
     }
 
-    return true;
+    slot->in_flight = true;
+    ++aoa->inflight_count;
 }
 
 bool
@@ -316,6 +395,14 @@ sc_aoa_push_hid_event(struct sc_aoa *aoa, const struct sc_hid_event *event) {
         sc_cond_signal(&aoa->event_cond);
     }
     sc_mutex_unlock(&aoa->mutex);
+
+    if (res && event->ack_to_wait != SC_SEQUENCE_INVALID && aoa->acksync) {
+        // Release the AOA thread if it is blocked on an older sequence: in a
+        // burst of paste requests, only the last one needs to wait for its
+        // acknowledgement
+        sc_acksync_register(aoa->acksync, event->ack_to_wait);
+    }
+
     return res;
 }
 
@@ -325,7 +412,8 @@ run_aoa_thread(void *data) {
 
     for (;;) {
         sc_mutex_lock(&aoa->mutex);
-        while (!aoa->stopped && cbuf_is_empty(&aoa->queue)) {
+        while (!aoa->stopped && cbuf_is_empty(&aoa->queue)
+                && !aoa->inflight_count) {
             sc_cond_wait(&aoa->event_cond, &aoa->mutex);
         }
         if (aoa->stopped) {
@@ -333,37 +421,70 @@ run_aoa_thread(void *data) {
             sc_mutex_unlock(&aoa->mutex);
             break;
         }
-        struct sc_hid_event event;
-        bool non_empty = cbuf_take(&aoa->queue, &event);
-        assert(non_empty);
-        (void) non_empty;
-
-        uint64_t ack_to_wait = event.ack_to_wait;
-        sc_mutex_unlock(&aoa->mutex);
 
-        if (ack_to_wait != SC_SEQUENCE_INVALID) {
-            LOGD("Waiting ack from server sequence=%" PRIu64_, ack_to_wait);
-            // Do not block the loop indefinitely if the ack never comes (it should
-            // never happen)
-            sc_tick deadline = sc_tick_now() + SC_TICK_FROM_MS(500);
-            enum sc_acksync_wait_result result =
-                sc_acksync_wait(aoa->acksync, ack_to_wait, deadline);
-
-            if (result == SC_ACKSYNC_WAIT_TIMEOUT) {
-                LOGW("Ack not received after 500ms, discarding HID event");
-                sc_hid_event_destroy(&event);
-                continue;
-            } else if (result == SC_ACKSYNC_WAIT_INTR) {
-                // stopped
-                sc_hid_event_destroy(&event);
+        // Submit events from the queue until the in-flight window is full
+        while (aoa->inflight_count < SC_AOA_INFLIGHT) {
+            struct sc_hid_event event;
+            if (!cbuf_take(&aoa->queue, &event)) {
                 break;
             }
+
+            uint64_t ack_to_wait = event.ack_to_wait;
+            sc_mutex_unlock(&aoa->mutex);
+
+            if (ack_to_wait != SC_SEQUENCE_INVALID) {
+                LOGD("Waiting ack from server sequence=%" PRIu64_,
+                     ack_to_wait);
+                // Do not block the loop indefinitely if the ack never comes
+                // (it should never happen)
+                sc_tick deadline = sc_tick_now() + SC_TICK_FROM_MS(500);
+                enum sc_acksync_wait_result result =
+                    sc_acksync_wait(aoa->acksync, ack_to_wait, deadline);
+
+                if (result == SC_ACKSYNC_WAIT_TIMEOUT) {
+                    LOGW("Ack not received after 500ms, discarding HID event");
+                    sc_hid_event_destroy(&event);
+                    sc_mutex_lock(&aoa->mutex);
+                    continue;
+                } else if (result == SC_ACKSYNC_WAIT_INTR) {
+                    // stopped
+                    sc_hid_event_destroy(&event);
+                    goto stopped;
+                } else if (result == SC_ACKSYNC_WAIT_SUPERSEDED) {
+                    // A newer clipboard request is in flight; the device
+                    // clipboard is already past this sequence, inject
+                    // optimistically without waiting for the intermediate
+                    // acknowledgement
+                    LOGD("Sequence %" PRIu64_
+                         " superseded, injecting immediately", ack_to_wait);
+                }
+            }
+
+            sc_aoa_submit_hid_event(aoa, &event);
+            sc_mutex_lock(&aoa->mutex);
         }
+        sc_mutex_unlock(&aoa->mutex);
 
-        bool ok = sc_aoa_send_hid_event(aoa, &event);
-        sc_hid_event_destroy(&event);
-        if (!ok) {
-            LOGW("Could not send HID event to USB device");
+        if (aoa->inflight_count) {
+            // Reap completions; returns as soon as a transfer completes, so
+            // that its slot may be refilled from the queue
+            struct timeval tv = { .tv_sec = 0, .tv_usec = 100000 };
+            libusb_handle_events_timeout_completed(aoa->usb_context, &tv,
+                                                   NULL);
+        }
+    }
+
+stopped:
+    // Cancel and reap the in-flight transfers, so that no completion callback
+    // may fire once the struct is destroyed
+    for (unsigned i = 0; i < SC_AOA_INFLIGHT; ++i) {
+        if (aoa->transfers[i].in_flight) {
+            libusb_cancel_transfer(aoa->transfers[i].transfer);
+        }
+    }
+    while (aoa->inflight_count) {
+        if (libusb_handle_events(aoa->usb_context) < 0) {
+            break;
         }
     }
     return 0;
@@ -28,6 +28,25 @@ sc_hid_event_destroy(struct sc_hid_event *hid_event);
 
 struct sc_hid_event_queue CBUF(struct sc_hid_event, 64);
 
+// Number of asynchronous transfers which may be in flight at the same time,
+// so that a burst of HID reports is not serialized at USB round-trip
+// granularity
+#define SC_AOA_INFLIGHT 4
+
+struct sc_aoa;
+
+// An asynchronous control transfer slot (only accessed from the AOA thread,
+// the completion callbacks run from libusb_handle_events() on that thread)
+struct sc_aoa_transfer {
+    struct sc_aoa *aoa;
+    struct libusb_transfer *transfer;
+    // control setup packet followed by the report data, grown on demand (in
+    // practice, allocated once since reports have a fixed size per device)
+    unsigned char *buffer;
+    uint16_t buffer_size;
+    bool in_flight;
+};
+
 struct sc_aoa {
     libusb_context *usb_context;
     libusb_device *usb_device;
@@ -38,6 +57,9 @@ struct sc_aoa {
     bool stopped;
     struct sc_hid_event_queue queue;
 
+    struct sc_aoa_transfer transfers[SC_AOA_INFLIGHT];
+    unsigned inflight_count; // only accessed from the AOA thread
+
     struct sc_acksync *acksync;
 };
 
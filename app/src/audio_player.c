@@ -0,0 +1,306 @@
+#include "audio_player.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include "util/buffer_util.h"
+#include "util/log.h"
+
+// Audio packets are framed with a 12-byte header: an 8-byte PTS (NO_PTS for
+// the codec config packet) followed by the 4-byte packet size, both
+// big-endian (a simpler variant of the video frame meta header, there is a
+// single audio stream to demultiplex)
+#define SC_AUDIO_HEADER_SIZE 12
+#define SC_AUDIO_NO_PTS UINT64_C(-1)
+
+// fixed capture format, negotiated by construction with the server encoder
+#define SC_AUDIO_SAMPLE_RATE 48000
+#define SC_AUDIO_CHANNELS 2
+
+// bytes per interleaved float sample frame
+#define SC_AUDIO_FRAME_BYTES (SC_AUDIO_CHANNELS * 4)
+
+// ring capacity (must be a power of two): 64k sample frames, ~1.3s, so that
+// the ring itself never limits a transient burst
+#define SC_AUDIO_BUF_BYTES (65536 * SC_AUDIO_FRAME_BYTES)
+
+// Start playback once ~20ms are buffered: enough to absorb the scheduling
+// jitter of the decoder thread, small enough to keep A/V desync well under
+// 50ms
+#define SC_AUDIO_PREBUF_BYTES (960 * SC_AUDIO_FRAME_BYTES)
+
+static void
+sc_audio_player_sdl_callback(void *userdata, uint8_t *data, int len) {
+    struct sc_audio_player *ap = userdata;
+
+    size_t read = sc_audiobuf_read(&ap->buf, data, len);
+    if (read < (size_t) len) {
+        // underrun: play silence
+        memset(data + read, 0, len - read);
+    }
+}
+
+static bool
+sc_audio_player_open_device(struct sc_audio_player *ap) {
+    SDL_AudioSpec desired = {
+        .freq = SC_AUDIO_SAMPLE_RATE,
+        .format = AUDIO_F32SYS,
+        .channels = SC_AUDIO_CHANNELS,
+        .samples = 512, // ~10ms SDL-side latency
+        .callback = sc_audio_player_sdl_callback,
+        .userdata = ap,
+    };
+
+    ap->device = SDL_OpenAudioDevice(NULL, 0, &desired, NULL, 0);
+    if (!ap->device) {
+        LOGE("Could not open audio device: %s", SDL_GetError());
+        return false;
+    }
+
+    return true;
+}
+
+static bool
+sc_audio_player_open_codec(struct sc_audio_player *ap,
+                           const uint8_t *config, size_t config_len) {
+    AVCodec *codec = avcodec_find_decoder(AV_CODEC_ID_OPUS);
+    if (!codec) {
+        LOGE("Opus decoder not found");
+        return false;
+    }
+
+    ap->codec_ctx = avcodec_alloc_context3(codec);
+    if (!ap->codec_ctx) {
+        LOG_OOM();
+        return false;
+    }
+
+    if (config_len) {
+        // the config packet contains the OpusHead emitted by the device
+        // encoder
+        uint8_t *extradata =
+            av_malloc(config_len + AV_INPUT_BUFFER_PADDING_SIZE);
+        if (!extradata) {
+            LOG_OOM();
+            avcodec_free_context(&ap->codec_ctx);
+            return false;
+        }
+        memcpy(extradata, config, config_len);
+        memset(extradata + config_len, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+        ap->codec_ctx->extradata = extradata;
+        ap->codec_ctx->extradata_size = config_len;
+    }
+
+    ap->codec_ctx->sample_rate = SC_AUDIO_SAMPLE_RATE;
+    ap->codec_ctx->channels = SC_AUDIO_CHANNELS;
+
+    if (avcodec_open2(ap->codec_ctx, codec, NULL) < 0) {
+        LOGE("Could not open Opus codec");
+        avcodec_free_context(&ap->codec_ctx);
+        return false;
+    }
+
+    return true;
+}
+
+// Interleave the decoded samples into the ring, as 32-bit floats (the native
+// output format of the Opus decoder is planar float)
+static void
+sc_audio_player_push_samples(struct sc_audio_player *ap,
+                             const AVFrame *frame) {
+    size_t written;
+    if (frame->format == AV_SAMPLE_FMT_FLT) {
+        size_t len = frame->nb_samples * SC_AUDIO_FRAME_BYTES;
+        written = sc_audiobuf_write(&ap->buf, frame->data[0], len);
+        written = written == len ? written : 0; // for the log only
+    } else if (frame->format == AV_SAMPLE_FMT_FLTP) {
+        assert(SC_AUDIO_CHANNELS == 2);
+        const float *left = (const float *) frame->data[0];
+        const float *right = (const float *) frame->data[1];
+        float interleaved[2 * 960]; // at most one 20ms Opus frame per chunk
+        int remaining = frame->nb_samples;
+        int pos = 0;
+        written = 1;
+        while (remaining > 0 && written) {
+            int count = remaining < 960 ? remaining : 960;
+            for (int i = 0; i < count; ++i) {
+                interleaved[2 * i] = left[pos + i];
+                interleaved[2 * i + 1] = right[pos + i];
+            }
+            size_t len = count * SC_AUDIO_FRAME_BYTES;
+            written = sc_audiobuf_write(&ap->buf,
+                                        (const uint8_t *) interleaved, len);
+            written = written == len ? written : 0;
+            pos += count;
+            remaining -= count;
+        }
+    } else {
+        LOG_RATE_LIMITED(LOGW, "Unsupported audio sample format: %d",
+                         frame->format);
+        return;
+    }
+
+    if (!written) {
+        // the ring is full (the audio device is stalled), drop the samples
+        LOG_RATE_LIMITED(LOGW, "Audio buffer full, dropping samples");
+    }
+
+    if (!ap->playing
+            && sc_audiobuf_can_read(&ap->buf) >= SC_AUDIO_PREBUF_BYTES) {
+        SDL_PauseAudioDevice(ap->device, 0);
+        ap->playing = true;
+    }
+}
+
+static bool
+sc_audio_player_push_packet(struct sc_audio_player *ap,
+                            const AVPacket *packet) {
+    int ret = avcodec_send_packet(ap->codec_ctx, packet);
+    if (ret < 0 && ret != AVERROR(EAGAIN)) {
+        LOGE("Could not send audio packet: %d", ret);
+        return false;
+    }
+
+    for (;;) {
+        ret = avcodec_receive_frame(ap->codec_ctx, ap->frame);
+        if (ret == AVERROR(EAGAIN)) {
+            break;
+        }
+        if (ret) {
+            LOGE("Could not receive audio frame: %d", ret);
+            return false;
+        }
+
+        sc_audio_player_push_samples(ap, ap->frame);
+        av_frame_unref(ap->frame);
+    }
+
+    return true;
+}
+
+static int
+run_audio_player(void *data) {
+    struct sc_audio_player *ap = data;
+
+    bool header_received = false;
+    for (;;) {
+        uint8_t header[SC_AUDIO_HEADER_SIZE];
+        ssize_t r = net_recv_all(ap->socket, header, SC_AUDIO_HEADER_SIZE);
+        if (r < SC_AUDIO_HEADER_SIZE) {
+            break;
+        }
+
+        uint64_t pts = buffer_read64be(header);
+        uint32_t len = buffer_read32be(&header[8]);
+        assert(len);
+
+        AVPacket packet;
+        if (av_new_packet(&packet, len)) {
+            LOG_OOM();
+            break;
+        }
+
+        r = net_recv_all(ap->socket, packet.data, len);
+        if (r < 0 || ((uint32_t) r) < len) {
+            av_packet_unref(&packet);
+            break;
+        }
+
+        if (!ap->codec_ctx) {
+            // the first packet is expected to be the codec config
+            const uint8_t *config = pts == SC_AUDIO_NO_PTS ? packet.data
+                                                           : NULL;
+            size_t config_len = config ? len : 0;
+            if (!sc_audio_player_open_codec(ap, config, config_len)) {
+                av_packet_unref(&packet);
+                break;
+            }
+            if (!sc_audio_player_open_device(ap)) {
+                av_packet_unref(&packet);
+                break;
+            }
+            if (config) {
+                av_packet_unref(&packet);
+                header_received = true;
+                continue;
+            }
+        }
+
+        packet.pts = pts != SC_AUDIO_NO_PTS ? (int64_t) pts : AV_NOPTS_VALUE;
+
+        bool ok = sc_audio_player_push_packet(ap, &packet);
+        av_packet_unref(&packet);
+        if (!ok) {
+            break;
+        }
+        header_received = true;
+    }
+
+    if (!header_received) {
+        // the device closed the socket without sending anything: audio
+        // capture is unsupported or failed on the device, mirroring continues
+        // without audio
+        LOGW("Audio disabled: no audio stream received from the device");
+    } else {
+        LOGD("Audio stream stopped");
+    }
+
+    if (ap->device) {
+        SDL_CloseAudioDevice(ap->device);
+        ap->device = 0;
+    }
+
+    return 0;
+}
+
+bool
+sc_audio_player_init(struct sc_audio_player *ap, sc_socket socket) {
+    ap->frame = av_frame_alloc();
+    if (!ap->frame) {
+        LOG_OOM();
+        return false;
+    }
+
+    if (!sc_audiobuf_init(&ap->buf, SC_AUDIO_BUF_BYTES)) {
+        LOG_OOM();
+        av_frame_free(&ap->frame);
+        return false;
+    }
+
+    ap->socket = socket;
+    ap->thread_started = false;
+    ap->codec_ctx = NULL;
+    ap->device = 0;
+    ap->playing = false;
+
+    return true;
+}
+
+bool
+sc_audio_player_start(struct sc_audio_player *ap) {
+    bool ok = sc_thread_create(&ap->thread, run_audio_player, "audio", ap);
+    if (!ok) {
+        LOGE("Could not start audio player thread");
+        return false;
+    }
+
+    ap->thread_started = true;
+    return true;
+}
+
+void
+sc_audio_player_join(struct sc_audio_player *ap) {
+    if (ap->thread_started) {
+        sc_thread_join(&ap->thread, NULL);
+    }
+}
+
+void
+sc_audio_player_destroy(struct sc_audio_player *ap) {
+    assert(!ap->device); // closed by the player thread
+    if (ap->codec_ctx) {
+        avcodec_free_context(&ap->codec_ctx);
+    }
+    av_frame_free(&ap->frame);
+    sc_audiobuf_destroy(&ap->buf);
+}
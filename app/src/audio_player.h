@@ -0,0 +1,51 @@
+#ifndef SC_AUDIO_PLAYER_H
+#define SC_AUDIO_PLAYER_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <libavcodec/avcodec.h>
+#include <SDL2/SDL.h>
+
+#include "util/audiobuf.h"
+#include "util/net.h"
+#include "util/thread.h"
+
+// Receives the Opus packets sent by the device on the dedicated audio socket,
+// decodes them on its own thread, and feeds the decoded samples to the SDL
+// audio device through a lock-free byte ring (the SDL audio callback runs on
+// a thread owned by SDL).
+//
+// Audio is best-effort: if the device cannot capture audio (it requires
+// Android 10), the server closes the audio socket immediately, and the player
+// thread terminates with a warning without ending the session.
+struct sc_audio_player {
+    sc_socket socket;
+
+    sc_thread thread;
+    bool thread_started;
+
+    AVCodecContext *codec_ctx;
+    AVFrame *frame;
+
+    SDL_AudioDeviceID device;
+    // samples decoded but not played yet, as interleaved 32-bit floats
+    struct sc_audiobuf buf;
+    bool playing;
+};
+
+bool
+sc_audio_player_init(struct sc_audio_player *ap, sc_socket socket);
+
+bool
+sc_audio_player_start(struct sc_audio_player *ap);
+
+// The player thread terminates by itself when the audio socket is closed on
+// server stop; there is no stop function
+void
+sc_audio_player_join(struct sc_audio_player *ap);
+
+void
+sc_audio_player_destroy(struct sc_audio_player *ap);
+
+#endif
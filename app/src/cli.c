@@ -8,6 +8,7 @@
 #include <unistd.h>
 
 #include "options.h"
+#include "recorder.h"
 #include "util/log.h"
 #include "util/net.h"
 #include "util/str.h"
@@ -52,6 +53,33 @@
 #define OPT_NO_CLIPBOARD_AUTOSYNC  1032
 #define OPT_TCPIP                  1033
 #define OPT_RAW_KEY_EVENTS         1034
+#define OPT_DYNAMIC_MAX_SIZE       1035
+#define OPT_MEMORY_BUDGET          1036
+#define OPT_THUMBNAIL_PORT         1037
+#define OPT_RELAY_PORT             1038
+#define OPT_AUTO_RECONNECT         1039
+#define OPT_STREAM_DUMP            1040
+#define OPT_STREAM_REPLAY          1041
+#define OPT_STREAM_REPLAY_FAST     1042
+#define OPT_OTG                    1043
+#define OPT_MAX_FPS_UNFOCUSED      1044
+#define OPT_RECORD_FRAGMENTED      1045
+#define OPT_RECORD_SEGMENT         1046
+#define OPT_CPU_AFFINITY           1047
+#define OPT_PRIORITIZE_DISPLAY     1048
+#define OPT_DECODER_THREADS        1049
+#define OPT_DECODER_FRAME_THREADING 1050
+#define OPT_TRACE_FILE             1051
+#define OPT_DAEMON                 1052
+#define OPT_DIRECT_TCP             1053
+#define OPT_TCP_RCVBUF             1054
+#define OPT_STATS_INTERVAL         1055
+#define OPT_PRINT_LATENCY          1056
+#define OPT_MIRROR                 1057
+#define OPT_AUDIO                  1058
+#define OPT_CODEC                  1059
+#define OPT_HWDEC                  1060
+#define OPT_RECORD_IO_BUFFER       1061
 
 struct sc_option {
     char shortopt;
@@ -77,11 +105,27 @@ struct sc_getopt_adapter {
 };
 
 static const struct sc_option options[] = {
+    {
+        .longopt_id = OPT_AUTO_RECONNECT,
+        .longopt = "auto-reconnect",
+        .text = "Automatically restart the session when the device is "
+                "disconnected (for example on a USB cable glitch).\n"
+                "This option is ignored while recording, to avoid overwriting "
+                "the output file.",
+    },
     {
         .longopt_id = OPT_ALWAYS_ON_TOP,
         .longopt = "always-on-top",
         .text = "Make scrcpy window always on top (above other windows).",
     },
+    {
+        .longopt_id = OPT_AUDIO,
+        .longopt = "audio",
+        .text = "Forward the device audio (played while mirroring). It "
+                "requires Android 10.\n"
+                "If the device cannot capture audio, mirroring continues "
+                "without audio.",
+    },
     {
         .shortopt = 'b',
         .longopt = "bit-rate",
@@ -90,6 +134,14 @@ static const struct sc_option options[] = {
                 "Unit suffixes are supported: 'K' (x1000) and 'M' (x1000000).\n"
                 "Default is " STR(DEFAULT_BIT_RATE) ".",
     },
+    {
+        .longopt_id = OPT_CODEC,
+        .longopt = "codec",
+        .argdesc = "name",
+        .text = "Select the video codec: h264 (default), h265 or av1.\n"
+                "H.265 and AV1 hardware encoders provide a better quality at "
+                "equal bitrate, but are not available on all devices.",
+    },
     {
         .longopt_id = OPT_CODEC_OPTIONS,
         .longopt = "codec-options",
@@ -111,6 +163,52 @@ static const struct sc_option options[] = {
                 "(typically, portrait for a phone, landscape for a tablet). "
                 "Any --max-size value is cmoputed on the cropped size.",
     },
+    {
+        .longopt_id = OPT_CPU_AFFINITY,
+        .longopt = "cpu-affinity",
+        .argdesc = "mask",
+        .text = "Pin all the threads of this scrcpy instance to the CPUs set "
+                "in mask (a bitmask, hexadecimal with a 0x prefix or "
+                "decimal).\n"
+                "This is useful to isolate several instances running on the "
+                "same host from each other.\n"
+                "Default is 0 (no affinity constraint).",
+    },
+    {
+        .longopt_id = OPT_DAEMON,
+        .longopt = "daemon",
+        .text = "Keep the server resident on the device when scrcpy exits, "
+                "and re-attach to a resident server on startup, making "
+                "reconnections near-instant (skipping the app_process "
+                "startup).\n"
+                "This implies --force-adb-forward.",
+    },
+    {
+        .longopt_id = OPT_DECODER_FRAME_THREADING,
+        .longopt = "decoder-frame-threading",
+        .text = "Use frame threading instead of slice threading for software "
+                "decoding.\n"
+                "Frame threading parallelizes better, but adds one frame of "
+                "latency per decoder thread.",
+    },
+    {
+        .longopt_id = OPT_DECODER_THREADS,
+        .longopt = "decoder-threads",
+        .argdesc = "value",
+        .text = "Set the number of threads used for software decoding.\n"
+                "Default is 0 (automatic, sized from the CPU count).",
+    },
+    {
+        .longopt_id = OPT_DIRECT_TCP,
+        .longopt = "direct-tcp",
+        .argdesc = "port",
+        .text = "Make the server listen on the given TCP port on the device "
+                "and connect to it directly, bypassing the adb tunnel (which "
+                "copies every packet).\n"
+                "The device must be reachable over the network from this "
+                "computer. WARNING: the connection is neither authenticated "
+                "nor encrypted, use only on trusted networks.",
+    },
     {
         .longopt_id = OPT_DISABLE_SCREENSAVER,
         .longopt = "disable-screensaver",
@@ -121,6 +219,9 @@ static const struct sc_option options[] = {
         .longopt = "display",
         .argdesc = "id",
         .text = "Specify the display id to mirror.\n"
+                "Several ids may be passed, comma-separated, to mirror "
+                "several displays at once, each in its own window (only the "
+                "first one receives input events).\n"
                 "The list of possible display ids can be listed by:\n"
                 "    adb shell dumpsys display\n"
                 "(search \"mDisplayId=\" in the output)\n"
@@ -132,13 +233,27 @@ static const struct sc_option options[] = {
         .argdesc = "ms",
         .text = "Add a buffering delay (in milliseconds) before displaying. "
                 "This increases latency to compensate for jitter.\n"
+                "Set to \"auto\" to adapt the delay dynamically to the "
+                "measured jitter (near-zero on USB, increased on jittery "
+                "connections).\n"
                 "Default is 0 (no buffering).",
     },
+    {
+        .longopt_id = OPT_DYNAMIC_MAX_SIZE,
+        .longopt = "dynamic-max-size",
+        .text = "Adapt the stream resolution to the window size: when the "
+                "window is resized, request the device to encode at a "
+                "resolution just sufficient for the new window dimensions "
+                "(never above the --max-size value, if set).\n"
+                "This reduces encoding, bandwidth and decoding costs for "
+                "small windows.",
+    },
     {
         .longopt_id = OPT_ENCODER_NAME,
         .longopt = "encoder",
         .argdesc = "name",
-        .text = "Use a specific MediaCodec encoder (must be a H.264 encoder).",
+        .text = "Use a specific MediaCodec encoder (must support the codec "
+                "selected by --codec).",
     },
     {
         .longopt_id = OPT_FORCE_ADB_FORWARD,
@@ -158,6 +273,16 @@ static const struct sc_option options[] = {
         .longopt = "fullscreen",
         .text = "Start in fullscreen.",
     },
+    {
+        .shortopt = 'G',
+        .longopt = "hid-gamepad",
+        .text = "Simulate physical gamepads by using HID over AOAv2.\n"
+                "Game controllers plugged into the computer are forwarded as "
+                "HID gamepads, so mobile games see them as if they were "
+                "paired with the device.\n"
+                "It may only work over USB, and is currently only supported "
+                "on Linux.",
+    },
     {
         .shortopt = 'K',
         .longopt = "hid-keyboard",
@@ -175,11 +300,30 @@ static const struct sc_option options[] = {
                 "However, the option is only available when the HID keyboard "
                 "is enabled (or a physical keyboard is connected).",
     },
+    {
+        .shortopt = 'M',
+        .longopt = "hid-mouse",
+        .text = "Simulate a physical mouse by using HID over AOAv2.\n"
+                "In this mode, the computer mouse is captured to control the "
+                "device directly (relative mouse mode), bypassing the Android "
+                "input injection stack.\n"
+                "It may only work over USB, and is currently only supported "
+                "on Linux.",
+    },
     {
         .shortopt = 'h',
         .longopt = "help",
         .text = "Print this help.",
     },
+    {
+        .longopt_id = OPT_HWDEC,
+        .longopt = "hwdec",
+        .text = "Use hardware-accelerated decoding (VAAPI, D3D11VA, "
+                "VideoToolbox, etc.) when available.\n"
+                "The first hardware device that can be opened for the video "
+                "codec is used; if none works, software decoding is used, as "
+                "without this option.",
+    },
     {
         .longopt_id = OPT_LEGACY_PASTE,
         .longopt = "legacy-paste",
@@ -209,6 +353,16 @@ static const struct sc_option options[] = {
         .text = "Limit the frame rate of screen capture (officially supported "
                 "since Android 10, but may work on earlier versions).",
     },
+    {
+        .longopt_id = OPT_MAX_FPS_UNFOCUSED,
+        .longopt = "max-fps-unfocused",
+        .argdesc = "value",
+        .text = "Limit the frame rate of screen capture while the scrcpy "
+                "window has no focus, to reduce the device and client load "
+                "for background sessions.\n"
+                "The nominal frame rate is restored when the window gains "
+                "focus.",
+    },
     {
         .shortopt = 'm',
         .longopt = "max-size",
@@ -218,6 +372,24 @@ static const struct sc_option options[] = {
                 "is preserved.\n"
                 "Default is 0 (unlimited).",
     },
+    {
+        .longopt_id = OPT_MEMORY_BUDGET,
+        .longopt = "memory-budget",
+        .argdesc = "value",
+        .text = "Limit the total memory retained by the buffering pools, in "
+                "bytes.\n"
+                "Unit suffixes are supported: 'K' (x1000) and 'M' (x1000000).\n"
+                "Default is 0 (unlimited).",
+    },
+    {
+        .longopt_id = OPT_MIRROR,
+        .longopt = "mirror",
+        .argdesc = "serial",
+        .text = "Also mirror the device with the given serial, in a "
+                "view-only window driven by the same process (shared SDL "
+                "initialization and event loop).\n"
+                "May be repeated to mirror several additional devices.",
+    },
     {
         .longopt_id = OPT_NO_CLIPBOARD_AUTOSYNC,
         .longopt = "no-clipboard-autosync",
@@ -253,6 +425,15 @@ static const struct sc_option options[] = {
                 "mipmaps are automatically generated to improve downscaling "
                 "quality. This option disables the generation of mipmaps.",
     },
+    {
+        .longopt_id = OPT_OTG,
+        .longopt = "otg",
+        .text = "Run in OTG mode: simulate a physical keyboard connected "
+                "over USB (AOAv2), without starting the server or mirroring "
+                "the device.\n"
+                "It may only work over USB, and is currently only supported "
+                "on Linux.",
+    },
     {
         .shortopt = 'p',
         .longopt = "port",
@@ -275,6 +456,23 @@ static const struct sc_option options[] = {
                 "special character, but breaks the expected behavior of alpha "
                 "keys in games (typically WASD).",
     },
+    {
+        .longopt_id = OPT_PRINT_LATENCY,
+        .longopt = "print-latency",
+        .text = "Measure and periodically log the capture-to-present latency "
+                "of the rendered frames.\n"
+                "The device and client clocks are synchronized with periodic "
+                "probes over the control socket, so control must be enabled.",
+    },
+    {
+        .longopt_id = OPT_PRIORITIZE_DISPLAY,
+        .longopt = "prioritize-display",
+        .text = "Raise the scheduling priority of the decoding and rendering "
+                "threads, and lower the priority of the recording and file "
+                "transfer threads.\n"
+                "This keeps mirroring smooth when many instances compete for "
+                "the CPU, at the cost of slower background I/O.",
+    },
     {
         .longopt_id = OPT_PUSH_TARGET,
         .longopt = "push-target",
@@ -294,7 +492,10 @@ static const struct sc_option options[] = {
         .argdesc = "file.mp4",
         .text = "Record screen to file.\n"
                 "The format is determined by the --record-format option if "
-                "set, or by the file extension (.mp4 or .mkv).",
+                "set, or by the file extension (.mp4 or .mkv).\n"
+                "Pass - (or pipe:N for file descriptor N) to write the muxed "
+                "stream to stdout (or to that fd) instead of a file; "
+                "--record-format is then mandatory.",
     },
     {
         .longopt_id = OPT_RECORD_FORMAT,
@@ -302,6 +503,44 @@ static const struct sc_option options[] = {
         .argdesc = "format",
         .text = "Force recording format (either mp4 or mkv).",
     },
+    {
+        .longopt_id = OPT_RECORD_FRAGMENTED,
+        .longopt = "record-fragmented",
+        .text = "Record in a streaming-safe way (fragmented MP4, flushed "
+                "Matroska clusters), so that any prefix of the file remains "
+                "playable if recording is interrupted.",
+    },
+    {
+        .longopt_id = OPT_RECORD_IO_BUFFER,
+        .longopt = "record-io-buffer",
+        .argdesc = "bytes",
+        .text = "Set the size of the recording I/O buffer, in bytes "
+                "(K/M suffixes accepted).\n"
+                "Muxed packets are written to the output file by batches of "
+                "this size, so that a slow disk (e.g. a network filesystem) "
+                "stalls the recorder queue less often.\n"
+                "Ignored when recording to stdout or a pipe.\n"
+                "Default is 1M.",
+    },
+    {
+        .longopt_id = OPT_RECORD_SEGMENT,
+        .longopt = "record-segment",
+        .argdesc = "seconds",
+        .text = "Rotate the recording to a new file every given number of "
+                "seconds, cutting on a keyframe so that no packet is lost.\n"
+                "A 3-digit counter is appended to the record filename, "
+                "before the extension.",
+    },
+    {
+        .longopt_id = OPT_RELAY_PORT,
+        .longopt = "relay-port",
+        .argdesc = "port",
+        .text = "Re-serve the received H.264 stream (raw Annex B) on "
+                "localhost:port, so that additional viewers can mirror the "
+                "device without a second device encode.\n"
+                "New clients immediately receive the latest config packet and "
+                "keyframe.",
+    },
     {
         .longopt_id = OPT_RENDER_DRIVER,
         .longopt = "render-driver",
@@ -332,6 +571,30 @@ static const struct sc_option options[] = {
         .text = "The device serial number. Mandatory only if several devices "
                 "are connected to adb.",
     },
+    {
+        .longopt_id = OPT_STREAM_DUMP,
+        .longopt = "stream-dump",
+        .argdesc = "file",
+        .text = "Dump the raw video stream (including the frame meta headers "
+                "and arrival timestamps) to the given file, to be replayed "
+                "later with --stream-replay.",
+    },
+    {
+        .longopt_id = OPT_STREAM_REPLAY,
+        .longopt = "stream-replay",
+        .argdesc = "file",
+        .text = "Replay a raw video stream dumped with --stream-dump, "
+                "reproducing the original packet timing, instead of "
+                "connecting to a device.\n"
+                "No device is required; control is disabled.",
+    },
+    {
+        .longopt_id = OPT_STREAM_REPLAY_FAST,
+        .longopt = "stream-replay-fast",
+        .text = "With --stream-replay, deliver the packets as fast as "
+                "possible instead of reproducing the original timing (useful "
+                "for benchmarking the decoding and rendering pipeline).",
+    },
     {
         .longopt_id = OPT_SHORTCUT_MOD,
         .longopt = "shortcut-mod",
@@ -357,6 +620,35 @@ static const struct sc_option options[] = {
                 "on exit.\n"
                 "It only shows physical touches (not clicks from scrcpy).",
     },
+    {
+        .longopt_id = OPT_STATS_INTERVAL,
+        .longopt = "stats-interval",
+        .argdesc = "ms",
+        .text = "Periodically log a line with pipeline statistics (frames "
+                "decoded/rendered/skipped/dropped, queue depths), every given "
+                "number of milliseconds.\n"
+                "A final line is logged on exit.\n"
+                "Default is 0 (disabled).",
+    },
+    {
+        .longopt_id = OPT_THUMBNAIL_PORT,
+        .longopt = "thumbnail-port",
+        .argdesc = "port",
+        .text = "Serve low-rate JPEG thumbnails of the mirrored display on "
+                "localhost:port.\n"
+                "Each thumbnail is sent to every connected client as a 4-byte "
+                "big-endian length followed by the JPEG data.",
+    },
+    {
+        .longopt_id = OPT_TRACE_FILE,
+        .longopt = "trace-file",
+        .argdesc = "file",
+        .text = "Write scoped trace events (Chrome trace event format) to "
+                "the given file, to be loaded in chrome://tracing.\n"
+                "The instrumented sections cover the main pipeline stages "
+                "(packet reception, decoding, buffering, rendering) across "
+                "all threads.",
+    },
     {
         .longopt_id = OPT_TUNNEL_HOST,
         .longopt = "tunnel-host",
@@ -418,6 +710,17 @@ static const struct sc_option options[] = {
         .text = "Keep the device on while scrcpy is running, when the device "
                 "is plugged in.",
     },
+    {
+        .longopt_id = OPT_TCP_RCVBUF,
+        .longopt = "tcp-rcvbuf",
+        .argdesc = "value",
+        .text = "Set the kernel receive buffer size (SO_RCVBUF) of the video "
+                "socket, in bytes. On high-latency links, a larger buffer "
+                "lets the device keep sending during a TCP retransmission "
+                "stall.\n"
+                "The value may be suffixed by 'K' or 'M' (e.g. \"4M\").\n"
+                "Default is 1M.",
+    },
     {
         .longopt_id = OPT_TCPIP,
         .longopt = "tcpip",
@@ -510,6 +813,10 @@ static const struct sc_shortcut shortcuts[] = {
         .shortcuts = { "MOD+s" },
         .text = "Click on APP_SWITCH",
     },
+    {
+        .shortcuts = { "MOD+Shift+s" },
+        .text = "Save a screenshot of the mirrored screen (PNG)",
+    },
     {
         .shortcuts = { "MOD+m" },
         .text = "Click on MENU",
@@ -898,6 +1205,60 @@ parse_bit_rate(const char *s, uint32_t *bit_rate) {
     return true;
 }
 
+static bool
+parse_memory_budget(const char *s, size_t *memory_budget) {
+    long value;
+    // long may be 32 bits (it is the case on mingw), so do not use more than
+    // 31 bits (long is signed)
+    bool ok = parse_integer_arg(s, &value, true, 0, 0x7FFFFFFF,
+                                "memory budget");
+    if (!ok) {
+        return false;
+    }
+
+    *memory_budget = (size_t) value;
+    return true;
+}
+
+static bool
+parse_tcp_rcvbuf(const char *s, uint32_t *rcvbuf) {
+    long value;
+    // long may be 32 bits (it is the case on mingw), so do not use more than
+    // 31 bits (long is signed)
+    bool ok = parse_integer_arg(s, &value, true, 0, 0x7FFFFFFF,
+                                "tcp-rcvbuf");
+    if (!ok) {
+        return false;
+    }
+
+    *rcvbuf = (uint32_t) value;
+    return true;
+}
+
+static bool
+parse_cpu_affinity(const char *s, uint64_t *cpu_affinity) {
+    char *endptr;
+    if (*s == '\0') {
+        LOGE("Could not parse cpu affinity: empty string");
+        return false;
+    }
+
+    // accept hexadecimal (0x prefix), octal (0 prefix) and decimal
+    unsigned long long value = strtoull(s, &endptr, 0);
+    if (*endptr != '\0') {
+        LOGE("Could not parse cpu affinity: %s", s);
+        return false;
+    }
+
+    if (!value) {
+        LOGE("Could not parse cpu affinity: mask must not be empty");
+        return false;
+    }
+
+    *cpu_affinity = value;
+    return true;
+}
+
 static bool
 parse_max_size(const char *s, uint16_t *max_size) {
     long value;
@@ -922,6 +1283,18 @@ parse_max_fps(const char *s, uint16_t *max_fps) {
     return true;
 }
 
+static bool
+parse_decoder_threads(const char *s, uint16_t *threads) {
+    long value;
+    bool ok = parse_integer_arg(s, &value, false, 0, 256, "decoder threads");
+    if (!ok) {
+        return false;
+    }
+
+    *threads = (uint16_t) value;
+    return true;
+}
+
 static bool
 parse_buffering_time(const char *s, sc_tick *tick) {
     long value;
@@ -935,6 +1308,47 @@ parse_buffering_time(const char *s, sc_tick *tick) {
     return true;
 }
 
+static bool
+parse_stats_interval(const char *s, sc_tick *tick) {
+    long value;
+    bool ok = parse_integer_arg(s, &value, false, 0, 0x7FFFFFFF,
+                                "stats interval");
+    if (!ok) {
+        return false;
+    }
+
+    *tick = SC_TICK_FROM_MS(value);
+    return true;
+}
+
+static bool
+parse_record_io_buffer(const char *s, uint32_t *size) {
+    long value;
+    // long may be 32 bits (it is the case on mingw), so do not use more than
+    // 31 bits (long is signed)
+    bool ok = parse_integer_arg(s, &value, true, 4096, 0x7FFFFFFF,
+                                "record I/O buffer size");
+    if (!ok) {
+        return false;
+    }
+
+    *size = (uint32_t) value;
+    return true;
+}
+
+static bool
+parse_record_segment(const char *s, sc_tick *tick) {
+    long value;
+    bool ok = parse_integer_arg(s, &value, false, 1, 0x7FFFFFFF,
+                                "record segment duration");
+    if (!ok) {
+        return false;
+    }
+
+    *tick = SC_TICK_FROM_SEC(value);
+    return true;
+}
+
 static bool
 parse_lock_video_orientation(const char *s,
                              enum sc_lock_video_orientation *lock_mode) {
@@ -1046,6 +1460,31 @@ parse_display_id(const char *s, uint32_t *display_id) {
     return true;
 }
 
+static bool
+parse_display_ids(const char *s, struct scrcpy_options *opts) {
+    long values[1 + SC_MAX_SECONDARY_DISPLAYS];
+    size_t count = sc_str_parse_integers(s, ',', ARRAY_LEN(values), values);
+    if (!count) {
+        LOGE("Could not parse display ids: %s", s);
+        return false;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        if (values[i] < 0 || values[i] > 0x7FFFFFFF) {
+            LOGE("Could not parse display ids: value (%ld) out-of-range",
+                 values[i]);
+            return false;
+        }
+    }
+
+    opts->display_id = (uint32_t) values[0];
+    opts->secondary_display_count = count - 1;
+    for (size_t i = 1; i < count; ++i) {
+        opts->secondary_display_ids[i - 1] = (uint32_t) values[i];
+    }
+    return true;
+}
+
 static bool
 parse_log_level(const char *s, enum sc_log_level *log_level) {
     if (!strcmp(s, "verbose")) {
@@ -1188,6 +1627,24 @@ parse_record_format(const char *optarg, enum sc_record_format *format) {
     return false;
 }
 
+static bool
+parse_codec(const char *optarg, enum sc_codec *codec) {
+    if (!strcmp(optarg, "h264")) {
+        *codec = SC_CODEC_H264;
+        return true;
+    }
+    if (!strcmp(optarg, "h265")) {
+        *codec = SC_CODEC_H265;
+        return true;
+    }
+    if (!strcmp(optarg, "av1")) {
+        *codec = SC_CODEC_AV1;
+        return true;
+    }
+    LOGE("Unsupported codec: %s (expected h264, h265 or av1)", optarg);
+    return false;
+}
+
 static bool
 parse_ip(const char *optarg, uint32_t *ipv4) {
     return net_parse_ipv4(optarg, ipv4);
@@ -1238,7 +1695,7 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
                 opts->crop = optarg;
                 break;
             case OPT_DISPLAY_ID:
-                if (!parse_display_id(optarg, &opts->display_id)) {
+                if (!parse_display_ids(optarg, opts)) {
                     return false;
                 }
                 break;
@@ -1253,28 +1710,105 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
                     return false;
                 }
                 break;
+            case OPT_RECORD_FRAGMENTED:
+                opts->record_fragmented = true;
+                break;
+            case OPT_RECORD_IO_BUFFER:
+                if (!parse_record_io_buffer(optarg,
+                                            &opts->record_io_buffer)) {
+                    return false;
+                }
+                break;
+            case OPT_RECORD_SEGMENT:
+                if (!parse_record_segment(optarg, &opts->record_segment)) {
+                    return false;
+                }
+                break;
             case 'h':
                 args->help = true;
                 break;
+            case 'G':
+                opts->hid_gamepad = true;
+                break;
             case 'K':
                 opts->keyboard_input_mode = SC_KEYBOARD_INPUT_MODE_HID;
                 break;
+            case 'M':
+                opts->hid_mouse = true;
+                break;
             case OPT_MAX_FPS:
                 if (!parse_max_fps(optarg, &opts->max_fps)) {
                     return false;
                 }
                 break;
+            case OPT_MAX_FPS_UNFOCUSED:
+                if (!parse_max_fps(optarg, &opts->max_fps_unfocused)) {
+                    return false;
+                }
+                break;
             case 'm':
                 if (!parse_max_size(optarg, &opts->max_size)) {
                     return false;
                 }
                 break;
+            case OPT_MEMORY_BUDGET:
+                if (!parse_memory_budget(optarg, &opts->memory_budget)) {
+                    return false;
+                }
+                break;
+            case OPT_CPU_AFFINITY:
+                if (!parse_cpu_affinity(optarg, &opts->cpu_affinity)) {
+                    return false;
+                }
+                break;
+            case OPT_PRIORITIZE_DISPLAY:
+                opts->prioritize_display = true;
+                break;
+            case OPT_DECODER_THREADS:
+                if (!parse_decoder_threads(optarg, &opts->decoder_threads)) {
+                    return false;
+                }
+                break;
+            case OPT_DECODER_FRAME_THREADING:
+                opts->decoder_frame_threading = true;
+                break;
+            case OPT_HWDEC:
+                opts->hwdec = true;
+                break;
+            case OPT_TRACE_FILE:
+                opts->trace_file = optarg;
+                break;
             case OPT_LOCK_VIDEO_ORIENTATION:
                 if (!parse_lock_video_orientation(optarg,
                         &opts->lock_video_orientation)) {
                     return false;
                 }
                 break;
+            case OPT_AUTO_RECONNECT:
+                opts->auto_reconnect = true;
+                break;
+            case OPT_STREAM_DUMP:
+                opts->stream_dump_filename = optarg;
+                break;
+            case OPT_STREAM_REPLAY:
+                opts->stream_replay_filename = optarg;
+                break;
+            case OPT_STREAM_REPLAY_FAST:
+                opts->stream_replay_fast = true;
+                break;
+            case OPT_OTG:
+                opts->otg = true;
+                break;
+            case OPT_RELAY_PORT:
+                if (!parse_port(optarg, &opts->relay_port)) {
+                    return false;
+                }
+                break;
+            case OPT_THUMBNAIL_PORT:
+                if (!parse_port(optarg, &opts->thumbnail_port)) {
+                    return false;
+                }
+                break;
             case OPT_TUNNEL_HOST:
                 if (!parse_ip(optarg, &opts->tunnel_host)) {
                     return false;
@@ -1383,6 +1917,11 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
             case OPT_NO_KEY_REPEAT:
                 opts->forward_key_repeat = false;
                 break;
+            case OPT_CODEC:
+                if (!parse_codec(optarg, &opts->codec)) {
+                    return false;
+                }
+                break;
             case OPT_CODEC_OPTIONS:
                 opts->codec_options = optarg;
                 break;
@@ -1392,6 +1931,38 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
             case OPT_FORCE_ADB_FORWARD:
                 opts->force_adb_forward = true;
                 break;
+            case OPT_DAEMON:
+                opts->daemon = true;
+                break;
+            case OPT_DIRECT_TCP:
+                if (!parse_port(optarg, &opts->direct_tcp_port)) {
+                    return false;
+                }
+                break;
+            case OPT_TCP_RCVBUF:
+                if (!parse_tcp_rcvbuf(optarg, &opts->tcp_rcvbuf)) {
+                    return false;
+                }
+                break;
+            case OPT_STATS_INTERVAL:
+                if (!parse_stats_interval(optarg, &opts->stats_interval)) {
+                    return false;
+                }
+                break;
+            case OPT_PRINT_LATENCY:
+                opts->print_latency = true;
+                break;
+            case OPT_AUDIO:
+                opts->audio = true;
+                break;
+            case OPT_MIRROR:
+                if (opts->mirror_count == SC_MAX_MIRROR_DEVICES) {
+                    LOGE("Could not mirror more than %d additional devices",
+                         SC_MAX_MIRROR_DEVICES);
+                    return false;
+                }
+                opts->mirror_serials[opts->mirror_count++] = optarg;
+                break;
             case OPT_DISABLE_SCREENSAVER:
                 opts->disable_screensaver = true;
                 break;
@@ -1406,11 +1977,17 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
             case OPT_LEGACY_PASTE:
                 opts->legacy_paste = true;
                 break;
+            case OPT_DYNAMIC_MAX_SIZE:
+                opts->dynamic_max_size = true;
+                break;
             case OPT_POWER_OFF_ON_CLOSE:
                 opts->power_off_on_close = true;
                 break;
             case OPT_DISPLAY_BUFFER:
-                if (!parse_buffering_time(optarg, &opts->display_buffer)) {
+                if (!strcmp(optarg, "auto")) {
+                    opts->display_buffer_auto = true;
+                } else if (!parse_buffering_time(optarg,
+                                                 &opts->display_buffer)) {
                     return false;
                 }
                 break;
@@ -1487,6 +2064,38 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
         return false;
     }
 
+    if (opts->record_fragmented && !opts->record_filename) {
+        LOGE("--record-fragmented requires recording (-r/--record)");
+        return false;
+    }
+
+    if (opts->record_segment) {
+        if (!opts->record_filename) {
+            LOGE("--record-segment requires recording (-r/--record)");
+            return false;
+        }
+        if (sc_record_filename_is_pipe(opts->record_filename)) {
+            LOGE("Could not rotate record segments on a pipe output");
+            return false;
+        }
+    }
+
+    if (opts->record_filename && sc_record_filename_is_pipe(
+                                     opts->record_filename)) {
+        if (!opts->record_format) {
+            LOGE("Recording to a pipe requires an explicit format "
+                 "(--record-format=mkv or --record-format=mp4)");
+            return false;
+        }
+        if (opts->record_format == SC_RECORD_FORMAT_MP4
+                && !opts->record_fragmented) {
+            // a pipe is not seekable, the moov atom could never be written
+            LOGI("Recording MP4 to a pipe, "
+                 "--record-fragmented automatically enabled.");
+            opts->record_fragmented = true;
+        }
+    }
+
     if (opts->record_filename && !opts->record_format) {
         opts->record_format = guess_record_format(opts->record_filename);
         if (!opts->record_format) {
@@ -1497,6 +2106,62 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
         }
     }
 
+    if (opts->stream_replay_filename) {
+        if (opts->stream_dump_filename) {
+            LOGE("Incompatible options: --stream-dump and --stream-replay");
+            return false;
+        }
+        if (opts->auto_reconnect) {
+            LOGE("Incompatible options: --auto-reconnect and --stream-replay");
+            return false;
+        }
+        // there is no device to control
+        opts->control = false;
+        opts->turn_screen_off = false;
+        opts->show_touches = false;
+        opts->stay_awake = false;
+    }
+
+    if (opts->stream_replay_fast && !opts->stream_replay_filename) {
+        LOGE("--stream-replay-fast requires --stream-replay");
+        return false;
+    }
+
+    if (opts->otg) {
+#ifndef HAVE_AOA_HID
+        LOGE("OTG mode (--otg) is disabled (or unsupported on this platform)");
+        return false;
+#endif
+        if (opts->record_filename || opts->stream_dump_filename
+                || opts->stream_replay_filename) {
+            LOGE("OTG mode (--otg) is incompatible with recording, "
+                 "--stream-dump and --stream-replay");
+            return false;
+        }
+    }
+
+    if (opts->mirror_count && !opts->display) {
+        LOGE("--mirror requires display enabled");
+        return false;
+    }
+
+    if (opts->audio && opts->stream_replay_filename) {
+        LOGE("--audio is incompatible with --stream-replay "
+             "(no audio is recorded in a stream dump)");
+        return false;
+    }
+
+    if (opts->mirror_count && opts->stream_replay_filename) {
+        LOGE("--mirror is incompatible with --stream-replay");
+        return false;
+    }
+
+    if (!opts->control && opts->print_latency) {
+        LOGE("--print-latency requires control (the clocks are synchronized "
+             "over the control socket)");
+        return false;
+    }
+
     if (!opts->control && opts->turn_screen_off) {
         LOGE("Could not request to turn screen off if control is disabled");
         return false;
@@ -1507,6 +2172,16 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
         return false;
     }
 
+    if (opts->dynamic_max_size && (!opts->control || !opts->display)) {
+        LOGE("Dynamic max size requires both control and display");
+        return false;
+    }
+
+    if (opts->max_fps_unfocused && (!opts->control || !opts->display)) {
+        LOGE("--max-fps-unfocused requires both control and display");
+        return false;
+    }
+
     return true;
 }
 
@@ -4,10 +4,19 @@
 
 #define SC_CLOCK_NDEBUG // comment to debug
 
+// Transmission may only add delay, so only points later than the estimation
+// (by more than this threshold) are considered outliers
+#define SC_CLOCK_OUTLIER_THRESHOLD SC_TICK_FROM_MS(100)
+// After this many consecutive outliers, the latency has genuinely changed:
+// restart the estimation from scratch
+#define SC_CLOCK_MAX_CONSECUTIVE_OUTLIERS 8
+
 void
 sc_clock_init(struct sc_clock *clock) {
     clock->count = 0;
     clock->head = 0;
+    clock->outliers = 0;
+    clock->jitter = 0;
     clock->left_sum.system = 0;
     clock->left_sum.stream = 0;
     clock->right_sum.system = 0;
@@ -56,6 +65,39 @@ sc_clock_estimate(struct sc_clock *clock,
 
 void
 sc_clock_update(struct sc_clock *clock, sc_tick system, sc_tick stream) {
+    if (clock->count > 1) {
+        // Update the jitter estimation, including for points rejected as
+        // outliers below (a delayed frame is precisely what the jitter must
+        // capture)
+        sc_tick deviation = system - sc_clock_to_system_time(clock, stream);
+        clock->jitter -= clock->jitter / 32;
+        if (deviation > clock->jitter) {
+            clock->jitter = deviation;
+        }
+    }
+
+    if (clock->count == SC_CLOCK_RANGE) {
+        sc_tick expected = sc_clock_to_system_time(clock, stream);
+        if (system - expected > SC_CLOCK_OUTLIER_THRESHOLD) {
+            if (clock->outliers < SC_CLOCK_MAX_CONSECUTIVE_OUTLIERS) {
+                // This point is an outlier (a delayed frame), drop it so that
+                // it does not skew the estimation
+                ++clock->outliers;
+#ifndef SC_CLOCK_NDEBUG
+                LOGD("Clock outlier rejected: %" PRItick " > %" PRItick,
+                     system, expected);
+#endif
+                return;
+            }
+
+            // The latency has genuinely changed, the window content is
+            // obsolete: restart the estimation from scratch (the consumer
+            // handles count == 1 as on startup)
+            sc_clock_init(clock);
+        }
+    }
+    clock->outliers = 0;
+
     struct sc_clock_point *point = &clock->points[clock->head];
 
     if (clock->count == SC_CLOCK_RANGE || clock->count & 1) {
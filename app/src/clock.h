@@ -35,6 +35,11 @@ struct sc_clock_point {
  *
  * With a circular array, the rolling sums (and average) are quick to compute.
  * In practice, the estimation is stable and the evolution is smooth.
+ *
+ * A delayed frame (device GC pause, Wi-Fi retransmission) produces a system
+ * timestamp arbitrarily later than the estimation, which would skew the slope
+ * for the whole window. Once the window is full, such outliers are rejected,
+ * unless they persist (a genuine latency change must eventually be accepted).
  */
 struct sc_clock {
     // Circular array
@@ -52,10 +57,19 @@ struct sc_clock {
     // Sum of the last (count+1)/2 points
     struct sc_clock_point right_sum;
 
+    // Number of consecutive points rejected as outliers (see
+    // sc_clock_update())
+    unsigned outliers;
+
     // Estimated slope and offset
     // (computed on sc_clock_update(), used by sc_clock_to_system_time())
     double slope;
     sc_tick offset;
+
+    // Estimated arrival jitter: decaying maximum of the positive deviations
+    // of the system timestamps from the estimation (a late frame raises it
+    // immediately, then it decays over the following frames)
+    sc_tick jitter;
 };
 
 void
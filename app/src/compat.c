@@ -19,6 +19,13 @@ char *strdup(const char *s) {
 }
 #endif
 
+#ifndef HAVE_STRNLEN
+size_t strnlen(const char *s, size_t maxlen) {
+    const char *end = memchr(s, 0, maxlen);
+    return end ? (size_t) (end - s) : maxlen;
+}
+#endif
+
 #ifndef HAVE_ASPRINTF
 int asprintf(char **strp, const char *fmt, ...) {
     va_list va;
@@ -54,10 +54,19 @@
 # define SCRCPY_SDL_HAS_HINT_VIDEO_X11_NET_WM_BYPASS_COMPOSITOR
 #endif
 
+#if SDL_VERSION_ATLEAST(2, 0, 16)
+// <https://wiki.libsdl.org/SDL_UpdateNVTexture>
+# define SCRCPY_SDL_HAS_UPDATE_NV_TEXTURE
+#endif
+
 #ifndef HAVE_STRDUP
 char *strdup(const char *s);
 #endif
 
+#ifndef HAVE_STRNLEN
+size_t strnlen(const char *s, size_t maxlen);
+#endif
+
 #ifndef HAVE_ASPRINTF
 int asprintf(char **strp, const char *fmt, ...);
 #endif
@@ -2,8 +2,8 @@
 
 #include <assert.h>
 #include <inttypes.h>
-#include <stdlib.h>
 #include <string.h>
+#include <zlib.h>
 
 #include "util/buffer_util.h"
 #include "util/log.h"
@@ -78,6 +78,34 @@ write_string(const char *utf8, size_t max_len, unsigned char *buf) {
     return 4 + len;
 }
 
+// write compressed flag (1 byte) + length (4 bytes) + payload
+// where the payload is either the raw string (non nul-terminated), or, if
+// large enough for the compression to pay off, the uncompressed length
+// (4 bytes) followed by a zlib stream
+static size_t
+write_clipboard_string(const char *utf8, size_t max_len, unsigned char *buf) {
+    size_t len = sc_str_utf8_truncation_index(utf8, max_len);
+
+    if (len >= CONTROL_MSG_CLIPBOARD_DEFLATE_MIN_LENGTH) {
+        // only useful if the compressed payload is smaller than the raw one
+        uLongf compressed_len = len - 5;
+        int r = compress2(&buf[9], &compressed_len, (const Bytef *) utf8, len,
+                          Z_BEST_SPEED);
+        if (r == Z_OK) {
+            buf[0] = 1; // compressed
+            buffer_write32be(&buf[1], 4 + compressed_len);
+            buffer_write32be(&buf[5], len); // uncompressed length
+            return 5 + 4 + compressed_len;
+        }
+        // Z_BUF_ERROR: the text is incompressible, send it raw
+    }
+
+    buf[0] = 0; // not compressed
+    buffer_write32be(&buf[1], len);
+    memcpy(&buf[5], utf8, len);
+    return 5 + len;
+}
+
 static uint16_t
 to_fixed_point_16(float f) {
     assert(f >= 0.0f && f <= 1.0f);
@@ -88,6 +116,33 @@ to_fixed_point_16(float f) {
     return (uint16_t) u;
 }
 
+size_t
+control_msg_serialized_size_bound(const struct control_msg *msg) {
+    switch (msg->type) {
+        case CONTROL_MSG_TYPE_INJECT_KEYCODE:
+            return 14;
+        case CONTROL_MSG_TYPE_INJECT_TEXT:
+            // type + length + string
+            return 1 + 4 + strlen(msg->inject_text.text);
+        case CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT:
+            return 29 + 14 * msg->inject_touch_event.history_count;
+        case CONTROL_MSG_TYPE_INJECT_SCROLL_EVENT:
+            return 21;
+        case CONTROL_MSG_TYPE_SET_CLIPBOARD:
+            // type + sequence + paste flag + compressed flag + length +
+            // string (the deflated form is never larger)
+            return 15 + strlen(msg->set_clipboard.text);
+        case CONTROL_MSG_TYPE_SET_CROP:
+        case CONTROL_MSG_TYPE_CLOCK_SYNC:
+            return 9;
+        case CONTROL_MSG_TYPE_SET_BITRATE:
+            return 5;
+        default:
+            // all the remaining messages are at most type + 2 bytes
+            return 3;
+    }
+}
+
 size_t
 control_msg_serialize(const struct control_msg *msg, unsigned char *buf) {
     buf[0] = msg->type;
@@ -104,7 +159,7 @@ control_msg_serialize(const struct control_msg *msg, unsigned char *buf) {
                              CONTROL_MSG_INJECT_TEXT_MAX_LENGTH, &buf[1]);
             return 1 + len;
         }
-        case CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT:
+        case CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT: {
             buf[1] = msg->inject_touch_event.action;
             buffer_write64be(&buf[2], msg->inject_touch_event.pointer_id);
             write_position(&buf[10], &msg->inject_touch_event.position);
@@ -112,7 +167,29 @@ control_msg_serialize(const struct control_msg *msg, unsigned char *buf) {
                 to_fixed_point_16(msg->inject_touch_event.pressure);
             buffer_write16be(&buf[22], pressure);
             buffer_write32be(&buf[24], msg->inject_touch_event.buttons);
-            return 28;
+            uint8_t count = msg->inject_touch_event.history_count;
+            assert(count <= CONTROL_MSG_TOUCH_HISTORY_MAX);
+            buf[28] = count;
+            size_t off = 29;
+            for (uint8_t i = 0; i < count; ++i) {
+                write_position(&buf[off],
+                               &msg->inject_touch_event.history[i].position);
+                // age of the sample relative to the event itself, in
+                // milliseconds (clamped)
+                sc_tick age = msg->inject_touch_event.timestamp
+                            - msg->inject_touch_event.history[i].timestamp;
+                if (age < 0) {
+                    age = 0;
+                }
+                uint64_t age_ms = SC_TICK_TO_MS(age);
+                if (age_ms > 0xffff) {
+                    age_ms = 0xffff;
+                }
+                buffer_write16be(&buf[off + 12], (uint16_t) age_ms);
+                off += 14;
+            }
+            return off;
+        }
         case CONTROL_MSG_TYPE_INJECT_SCROLL_EVENT:
             write_position(&buf[1], &msg->inject_scroll_event.position);
             buffer_write32be(&buf[13],
@@ -129,18 +206,41 @@ control_msg_serialize(const struct control_msg *msg, unsigned char *buf) {
         case CONTROL_MSG_TYPE_SET_CLIPBOARD: {
             buffer_write64be(&buf[1], msg->set_clipboard.sequence);
             buf[9] = !!msg->set_clipboard.paste;
-            size_t len = write_string(msg->set_clipboard.text,
-                                      CONTROL_MSG_CLIPBOARD_TEXT_MAX_LENGTH,
-                                      &buf[10]);
+            size_t len =
+                write_clipboard_string(msg->set_clipboard.text,
+                                       CONTROL_MSG_CLIPBOARD_TEXT_MAX_LENGTH,
+                                       &buf[10]);
             return 10 + len;
         }
         case CONTROL_MSG_TYPE_SET_SCREEN_POWER_MODE:
             buf[1] = msg->set_screen_power_mode.mode;
             return 2;
+        case CONTROL_MSG_TYPE_SET_MAX_SIZE:
+            buffer_write16be(&buf[1], msg->set_max_size.max_size);
+            return 3;
+        case CONTROL_MSG_TYPE_SET_MAX_FPS:
+            buffer_write16be(&buf[1], msg->set_max_fps.max_fps);
+            return 3;
+        case CONTROL_MSG_TYPE_SET_STREAM_PAUSED:
+            buf[1] = !!msg->set_stream_paused.paused;
+            return 2;
+        case CONTROL_MSG_TYPE_SET_CROP:
+            buffer_write16be(&buf[1], msg->set_crop.width);
+            buffer_write16be(&buf[3], msg->set_crop.height);
+            buffer_write16be(&buf[5], msg->set_crop.x);
+            buffer_write16be(&buf[7], msg->set_crop.y);
+            return 9;
+        case CONTROL_MSG_TYPE_CLOCK_SYNC:
+            buffer_write64be(&buf[1], msg->clock_sync.client_time);
+            return 9;
+        case CONTROL_MSG_TYPE_SET_BITRATE:
+            buffer_write32be(&buf[1], msg->set_bitrate.bit_rate);
+            return 5;
         case CONTROL_MSG_TYPE_EXPAND_NOTIFICATION_PANEL:
         case CONTROL_MSG_TYPE_EXPAND_SETTINGS_PANEL:
         case CONTROL_MSG_TYPE_COLLAPSE_PANELS:
         case CONTROL_MSG_TYPE_ROTATE_DEVICE:
+        case CONTROL_MSG_TYPE_REQUEST_IDR:
             // no additional data
             return 1;
         default:
@@ -228,23 +328,37 @@ control_msg_log(const struct control_msg *msg) {
         case CONTROL_MSG_TYPE_ROTATE_DEVICE:
             LOG_CMSG("rotate device");
             break;
-        default:
-            LOG_CMSG("unknown type: %u", (unsigned) msg->type);
+        case CONTROL_MSG_TYPE_SET_MAX_SIZE:
+            LOG_CMSG("max size %" PRIu16, msg->set_max_size.max_size);
             break;
-    }
-}
-
-void
-control_msg_destroy(struct control_msg *msg) {
-    switch (msg->type) {
-        case CONTROL_MSG_TYPE_INJECT_TEXT:
-            free(msg->inject_text.text);
+        case CONTROL_MSG_TYPE_SET_MAX_FPS:
+            LOG_CMSG("max fps %" PRIu16, msg->set_max_fps.max_fps);
             break;
-        case CONTROL_MSG_TYPE_SET_CLIPBOARD:
-            free(msg->set_clipboard.text);
+        case CONTROL_MSG_TYPE_SET_STREAM_PAUSED:
+            LOG_CMSG("stream %s",
+                     msg->set_stream_paused.paused ? "paused" : "resumed");
+            break;
+        case CONTROL_MSG_TYPE_REQUEST_IDR:
+            LOG_CMSG("request IDR");
+            break;
+        case CONTROL_MSG_TYPE_SET_CROP:
+            if (msg->set_crop.width && msg->set_crop.height) {
+                LOG_CMSG("crop %" PRIu16 ":%" PRIu16 ":%" PRIu16 ":%" PRIu16,
+                         msg->set_crop.width, msg->set_crop.height,
+                         msg->set_crop.x, msg->set_crop.y);
+            } else {
+                LOG_CMSG("crop reset");
+            }
+            break;
+        case CONTROL_MSG_TYPE_CLOCK_SYNC:
+            LOG_CMSG("clock sync t0=%" PRIu64_, msg->clock_sync.client_time);
+            break;
+        case CONTROL_MSG_TYPE_SET_BITRATE:
+            LOG_CMSG("bitrate %" PRIu32, msg->set_bitrate.bit_rate);
             break;
         default:
-            // do nothing
+            LOG_CMSG("unknown type: %u", (unsigned) msg->type);
             break;
     }
 }
+
@@ -10,16 +10,24 @@
 #include "android/input.h"
 #include "android/keycodes.h"
 #include "coords.h"
+#include "util/tick.h"
 
 #define CONTROL_MSG_MAX_SIZE (1 << 18) // 256k
 
 #define CONTROL_MSG_INJECT_TEXT_MAX_LENGTH 300
-// type: 1 byte; paste flag: 1 byte; length: 4 bytes
-#define CONTROL_MSG_CLIPBOARD_TEXT_MAX_LENGTH (CONTROL_MSG_MAX_SIZE - 6)
+// type: 1 byte; paste flag: 1 byte; compressed flag: 1 byte; length: 4 bytes
+#define CONTROL_MSG_CLIPBOARD_TEXT_MAX_LENGTH (CONTROL_MSG_MAX_SIZE - 7)
+// deflate the clipboard text when at least this size (small payloads are not
+// worth the overhead)
+#define CONTROL_MSG_CLIPBOARD_DEFLATE_MIN_LENGTH 512
 
 #define POINTER_ID_MOUSE UINT64_C(-1)
 #define POINTER_ID_VIRTUAL_FINGER UINT64_C(-2)
 
+// Maximum number of coalesced positions carried by a single touch move event
+// (see controller_coalesce_touch_moves())
+#define CONTROL_MSG_TOUCH_HISTORY_MAX 7
+
 enum control_msg_type {
     CONTROL_MSG_TYPE_INJECT_KEYCODE,
     CONTROL_MSG_TYPE_INJECT_TEXT,
@@ -33,6 +41,13 @@ enum control_msg_type {
     CONTROL_MSG_TYPE_SET_CLIPBOARD,
     CONTROL_MSG_TYPE_SET_SCREEN_POWER_MODE,
     CONTROL_MSG_TYPE_ROTATE_DEVICE,
+    CONTROL_MSG_TYPE_SET_MAX_SIZE,
+    CONTROL_MSG_TYPE_SET_MAX_FPS,
+    CONTROL_MSG_TYPE_SET_STREAM_PAUSED,
+    CONTROL_MSG_TYPE_REQUEST_IDR,
+    CONTROL_MSG_TYPE_SET_CROP,
+    CONTROL_MSG_TYPE_CLOCK_SYNC,
+    CONTROL_MSG_TYPE_SET_BITRATE,
 };
 
 enum screen_power_mode {
@@ -65,6 +80,15 @@ struct control_msg {
             uint64_t pointer_id;
             struct sc_position position;
             float pressure;
+            sc_tick timestamp; // client date of the event
+            // Older move positions coalesced into this event while it was
+            // queued (oldest first), sent as a timestamped batch so the
+            // device keeps the full motion for velocity and resampling
+            uint8_t history_count;
+            struct {
+                struct sc_position position;
+                sc_tick timestamp;
+            } history[CONTROL_MSG_TOUCH_HISTORY_MAX];
         } inject_touch_event;
         struct {
             struct sc_position position;
@@ -86,9 +110,40 @@ struct control_msg {
         struct {
             enum screen_power_mode mode;
         } set_screen_power_mode;
+        struct {
+            uint16_t max_size; // must be a multiple of 8 (0 for no limit)
+        } set_max_size;
+        struct {
+            uint16_t max_fps; // 0 for no limit
+        } set_max_fps;
+        struct {
+            bool paused;
+        } set_stream_paused;
+        struct {
+            // region of interest, in the device natural orientation
+            // (width == 0 or height == 0 restores the full screen)
+            uint16_t width;
+            uint16_t height;
+            uint16_t x;
+            uint16_t y;
+        } set_crop;
+        struct {
+            // client timestamp (sc_tick), echoed back by the device along
+            // with its own timestamp to estimate the clock offset
+            uint64_t client_time;
+        } clock_sync;
+        struct {
+            uint32_t bit_rate; // video bitrate, in bits per second
+        } set_bitrate;
     };
 };
 
+// Return an upper bound of the serialized size of the message (the actual
+// size may be smaller, e.g. when a clipboard text is deflated), to reserve
+// space when serializing several messages back-to-back
+size_t
+control_msg_serialized_size_bound(const struct control_msg *msg);
+
 // buf size must be at least CONTROL_MSG_MAX_SIZE
 // return the number of bytes written
 size_t
@@ -97,7 +152,4 @@ control_msg_serialize(const struct control_msg *msg, unsigned char *buf);
 void
 control_msg_log(const struct control_msg *msg);
 
-void
-control_msg_destroy(struct control_msg *msg);
-
 #endif
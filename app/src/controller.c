@@ -1,47 +1,92 @@
 #include "controller.h"
 
 #include <assert.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "util/log.h"
 
+// size of the ring allocator serving the text payloads (larger texts fall
+// back to the heap, see struct sc_arena)
+#define CONTROLLER_ARENA_SIZE 4096
+
+// must be a power of two
+#define CONTROLLER_QUEUE_CAPACITY 64
+
 bool
 controller_init(struct controller *controller, sc_socket control_socket,
                 struct sc_acksync *acksync) {
-    cbuf_init(&controller->queue);
+    bool ok = sc_mpscq_init(&controller->queue, sizeof(struct control_msg),
+                            CONTROLLER_QUEUE_CAPACITY);
+    if (!ok) {
+        return false;
+    }
 
-    bool ok = receiver_init(&controller->receiver, control_socket, acksync);
+    ok = receiver_init(&controller->receiver, control_socket, acksync);
     if (!ok) {
+        sc_mpscq_destroy(&controller->queue);
+        return false;
+    }
+
+    ok = sc_arena_init(&controller->arena, CONTROLLER_ARENA_SIZE);
+    if (!ok) {
+        receiver_destroy(&controller->receiver);
+        sc_mpscq_destroy(&controller->queue);
         return false;
     }
 
     ok = sc_mutex_init(&controller->mutex);
     if (!ok) {
+        sc_arena_destroy(&controller->arena);
         receiver_destroy(&controller->receiver);
+        sc_mpscq_destroy(&controller->queue);
         return false;
     }
 
     ok = sc_cond_init(&controller->msg_cond);
     if (!ok) {
+        sc_arena_destroy(&controller->arena);
         receiver_destroy(&controller->receiver);
         sc_mutex_destroy(&controller->mutex);
+        sc_mpscq_destroy(&controller->queue);
         return false;
     }
 
     controller->control_socket = control_socket;
-    controller->stopped = false;
+    atomic_init(&controller->consumer_waiting, false);
+    atomic_init(&controller->stopped, false);
 
     return true;
 }
 
+// release the payload of a processed message (the texts are allocated from
+// the controller arena)
+static void
+controller_msg_destroy(struct controller *controller, struct control_msg *msg) {
+    switch (msg->type) {
+        case CONTROL_MSG_TYPE_INJECT_TEXT:
+            sc_arena_free(&controller->arena, msg->inject_text.text);
+            break;
+        case CONTROL_MSG_TYPE_SET_CLIPBOARD:
+            sc_arena_free(&controller->arena, msg->set_clipboard.text);
+            break;
+        default:
+            // do nothing
+            break;
+    }
+}
+
 void
 controller_destroy(struct controller *controller) {
     sc_cond_destroy(&controller->msg_cond);
     sc_mutex_destroy(&controller->mutex);
 
     struct control_msg msg;
-    while (cbuf_take(&controller->queue, &msg)) {
-        control_msg_destroy(&msg);
+    while (sc_mpscq_take(&controller->queue, &msg)) {
+        controller_msg_destroy(controller, &msg);
     }
+    sc_mpscq_destroy(&controller->queue);
+    sc_arena_destroy(&controller->arena);
 
     receiver_destroy(&controller->receiver);
 }
@@ -53,50 +98,186 @@ controller_push_msg(struct controller *controller,
         control_msg_log(msg);
     }
 
-    sc_mutex_lock(&controller->mutex);
-    bool was_empty = cbuf_is_empty(&controller->queue);
-    bool res = cbuf_push(&controller->queue, *msg);
-    if (was_empty) {
+    bool res = sc_mpscq_push(&controller->queue, msg);
+    if (!res) {
+        // the queue is full
+        return false;
+    }
+
+    // Make the push visible before reading the consumer state (it pairs with
+    // the fence in run_controller(), so that either this producer sees the
+    // consumer waiting, or the consumer sees the pushed message)
+    atomic_thread_fence(memory_order_seq_cst);
+
+    if (atomic_load_explicit(&controller->consumer_waiting,
+                             memory_order_relaxed)) {
+        // take the mutex only to wake up an idle consumer, never while it is
+        // actively draining the queue
+        sc_mutex_lock(&controller->mutex);
         sc_cond_signal(&controller->msg_cond);
+        sc_mutex_unlock(&controller->mutex);
+    }
+    return true;
+}
+
+// Merge the text of consecutive "inject text" messages that accumulated while
+// the previous message was being sent, so that a fast typing burst (automated
+// form filling) does not pay one malloc and one socket write per character.
+// Must be called from the controller thread (the single consumer).
+static void
+controller_coalesce_text(struct controller *controller,
+                         struct control_msg *msg) {
+    assert(msg->type == CONTROL_MSG_TYPE_INJECT_TEXT);
+
+    struct control_msg next;
+    while (sc_mpscq_peek(&controller->queue, &next)
+            && next.type == CONTROL_MSG_TYPE_INJECT_TEXT) {
+        size_t len = strlen(msg->inject_text.text);
+        size_t next_len = strlen(next.inject_text.text);
+        if (len + next_len > CONTROL_MSG_INJECT_TEXT_MAX_LENGTH) {
+            // the merged text would be truncated on serialization
+            break;
+        }
+
+        char *merged = sc_arena_alloc(&controller->arena, len + next_len + 1);
+        if (!merged) {
+            LOG_OOM();
+            break;
+        }
+        memcpy(merged, msg->inject_text.text, len);
+        memcpy(merged + len, next.inject_text.text, next_len + 1);
+        sc_arena_free(&controller->arena, msg->inject_text.text);
+        msg->inject_text.text = merged;
+
+        // consume the merged message
+        sc_mpscq_take(&controller->queue, &next);
+        controller_msg_destroy(controller, &next);
     }
-    sc_mutex_unlock(&controller->mutex);
-    return res;
 }
 
+// Merge consecutive "move" messages of the same pointer that accumulated
+// while the previous message was being sent: the backlog positions become
+// timestamped history of the newest message, so a fast drag is injected as a
+// single batched motion event instead of a tail of late individual moves.
+// Must be called from the controller thread (the single consumer).
+static void
+controller_coalesce_touch_moves(struct controller *controller,
+                                struct control_msg *msg) {
+    assert(msg->type == CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT);
+    assert(msg->inject_touch_event.action == AMOTION_EVENT_ACTION_MOVE);
+
+    struct control_msg next;
+    while (msg->inject_touch_event.history_count
+                < CONTROL_MSG_TOUCH_HISTORY_MAX
+            && sc_mpscq_peek(&controller->queue, &next)
+            && next.type == CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT
+            && next.inject_touch_event.action == AMOTION_EVENT_ACTION_MOVE
+            && next.inject_touch_event.pointer_id
+                == msg->inject_touch_event.pointer_id
+            && next.inject_touch_event.buttons
+                == msg->inject_touch_event.buttons
+            && next.inject_touch_event.position.screen_size.width
+                == msg->inject_touch_event.position.screen_size.width
+            && next.inject_touch_event.position.screen_size.height
+                == msg->inject_touch_event.position.screen_size.height) {
+        // the current head becomes a historical sample of the newer message
+        uint8_t n = msg->inject_touch_event.history_count;
+        msg->inject_touch_event.history[n].position =
+            msg->inject_touch_event.position;
+        msg->inject_touch_event.history[n].timestamp =
+            msg->inject_touch_event.timestamp;
+        msg->inject_touch_event.history_count = n + 1;
+
+        msg->inject_touch_event.position = next.inject_touch_event.position;
+        msg->inject_touch_event.pressure = next.inject_touch_event.pressure;
+        msg->inject_touch_event.timestamp = next.inject_touch_event.timestamp;
+
+        // consume the merged message (it owns no payload)
+        sc_mpscq_take(&controller->queue, &next);
+    }
+}
+
+// Serialize the message and all the queued messages that fit into a single
+// buffer, then send them with one call: on high-latency links (Wi-Fi ADB),
+// one TCP segment per tiny input message visibly delays bursts.
+// Take ownership of `msg` (it is released even on failure).
 static bool
-process_msg(struct controller *controller, const struct control_msg *msg) {
-    static unsigned char serialized_msg[CONTROL_MSG_MAX_SIZE];
-    size_t length = control_msg_serialize(msg, serialized_msg);
-    if (!length) {
-        return false;
+process_msgs(struct controller *controller, struct control_msg *msg) {
+    static unsigned char buf[CONTROL_MSG_MAX_SIZE];
+    size_t used = 0;
+
+    for (;;) {
+        if (msg->type == CONTROL_MSG_TYPE_INJECT_TEXT) {
+            controller_coalesce_text(controller, msg);
+        } else if (msg->type == CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT
+                && msg->inject_touch_event.action
+                    == AMOTION_EVENT_ACTION_MOVE) {
+            controller_coalesce_touch_moves(controller, msg);
+        }
+
+        size_t length = control_msg_serialize(msg, buf + used);
+        controller_msg_destroy(controller, msg);
+        used += length;
+
+        struct control_msg next;
+        if (!sc_mpscq_peek(&controller->queue, &next)
+                || used + control_msg_serialized_size_bound(&next)
+                    > sizeof(buf)) {
+            break;
+        }
+        sc_mpscq_take(&controller->queue, &next);
+        *msg = next;
+    }
+
+    if (!used) {
+        // nothing serialized (invalid message), not a socket error
+        return true;
     }
-    ssize_t w =
-        net_send_all(controller->control_socket, serialized_msg, length);
-    return (size_t) w == length;
+
+    ssize_t w = net_send_all(controller->control_socket, buf, used);
+    return (size_t) w == used;
 }
 
 static int
 run_controller(void *data) {
     struct controller *controller = data;
 
+    sc_thread_apply_role(SC_THREAD_ROLE_CONTROL);
+
     for (;;) {
-        sc_mutex_lock(&controller->mutex);
-        while (!controller->stopped && cbuf_is_empty(&controller->queue)) {
-            sc_cond_wait(&controller->msg_cond, &controller->mutex);
-        }
-        if (controller->stopped) {
-            // stop immediately, do not process further msgs
+        struct control_msg msg;
+        bool has_msg = sc_mpscq_take(&controller->queue, &msg);
+        if (!has_msg) {
+            // the queue looks empty, park until a producer wakes us up
+            sc_mutex_lock(&controller->mutex);
+            atomic_store_explicit(&controller->consumer_waiting, true,
+                                  memory_order_relaxed);
+            // make the waiting flag visible before re-checking the queue
+            // (see the matching fence in controller_push_msg())
+            atomic_thread_fence(memory_order_seq_cst);
+            has_msg = sc_mpscq_take(&controller->queue, &msg);
+            while (!has_msg && !atomic_load_explicit(&controller->stopped,
+                                                     memory_order_relaxed)) {
+                sc_cond_wait(&controller->msg_cond, &controller->mutex);
+                has_msg = sc_mpscq_take(&controller->queue, &msg);
+            }
+            atomic_store_explicit(&controller->consumer_waiting, false,
+                                  memory_order_relaxed);
             sc_mutex_unlock(&controller->mutex);
+        }
+
+        if (atomic_load_explicit(&controller->stopped,
+                                 memory_order_relaxed)) {
+            // stop immediately, do not process further msgs (the remaining
+            // queued messages are released by controller_destroy())
+            if (has_msg) {
+                controller_msg_destroy(controller, &msg);
+            }
             break;
         }
-        struct control_msg msg;
-        bool non_empty = cbuf_take(&controller->queue, &msg);
-        assert(non_empty);
-        (void) non_empty;
-        sc_mutex_unlock(&controller->mutex);
+        assert(has_msg);
 
-        bool ok = process_msg(controller, &msg);
-        control_msg_destroy(&msg);
+        bool ok = process_msgs(controller, &msg);
         if (!ok) {
             LOGD("Could not write msg to socket");
             break;
@@ -116,19 +297,16 @@ controller_start(struct controller *controller) {
         return false;
     }
 
-    if (!receiver_start(&controller->receiver)) {
-        controller_stop(controller);
-        sc_thread_join(&controller->thread, NULL);
-        return false;
-    }
+    // the receiver does not have its own thread, it is serviced by the
+    // thread polling the control socket (see receiver_on_readable())
 
     return true;
 }
 
 void
 controller_stop(struct controller *controller) {
+    atomic_store_explicit(&controller->stopped, true, memory_order_relaxed);
     sc_mutex_lock(&controller->mutex);
-    controller->stopped = true;
     sc_cond_signal(&controller->msg_cond);
     sc_mutex_unlock(&controller->mutex);
 }
@@ -136,5 +314,17 @@ controller_stop(struct controller *controller) {
 void
 controller_join(struct controller *controller) {
     sc_thread_join(&controller->thread, NULL);
-    receiver_join(&controller->receiver);
+}
+
+bool
+controller_get_device_clock_offset(struct controller *controller,
+                                   sc_tick *offset) {
+    struct receiver *receiver = &controller->receiver;
+    if (!atomic_load_explicit(&receiver->has_device_clock_offset,
+                              memory_order_acquire)) {
+        return false;
+    }
+    *offset = atomic_load_explicit(&receiver->device_clock_offset,
+                                   memory_order_relaxed);
+    return true;
 }
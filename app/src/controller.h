@@ -3,24 +3,36 @@
 
 #include "common.h"
 
+#include <stdatomic.h>
 #include <stdbool.h>
 
 #include "control_msg.h"
 #include "receiver.h"
 #include "util/acksync.h"
-#include "util/cbuf.h"
+#include "util/arena.h"
+#include "util/mpscq.h"
 #include "util/net.h"
 #include "util/thread.h"
 
-struct control_msg_queue CBUF(struct control_msg, 64);
-
 struct controller {
     sc_socket control_socket;
     sc_thread thread;
+    // the mutex and condition variable only serve to park the controller
+    // thread while the queue is empty; producers push lock-free and take the
+    // mutex only to wake up an idle consumer
     sc_mutex mutex;
     sc_cond msg_cond;
-    bool stopped;
-    struct control_msg_queue queue;
+    // the controller thread is (or is about to be) blocked on msg_cond
+    atomic_bool consumer_waiting;
+    atomic_bool stopped;
+    // lock-free queue, so that high-rate input bursts from the UI thread
+    // never contend with the controller thread draining messages
+    struct sc_mpscq queue;
+    // allocator for the text payloads of queued messages, so that a sustained
+    // text stream performs no per-message heap traffic (producers allocate
+    // via sc_arena_strdup(), the payload is released once the message is
+    // processed)
+    struct sc_arena arena;
     struct receiver receiver;
 };
 
@@ -44,4 +56,11 @@ bool
 controller_push_msg(struct controller *controller,
                     const struct control_msg *msg);
 
+// Retrieve the estimated device clock offset (device time - client time, in
+// microseconds), computed by the receiver from clock sync replies.
+// Return false if no estimation is available yet.
+bool
+controller_get_device_clock_offset(struct controller *controller,
+                                   sc_tick *offset);
+
 #endif
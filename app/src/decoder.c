@@ -2,11 +2,17 @@
 
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
+#include <libavutil/hwcontext.h>
 
+#include "control_msg.h"
+#include "controller.h"
 #include "events.h"
 #include "video_buffer.h"
 #include "trait/frame_sink.h"
 #include "util/log.h"
+#include "util/stats.h"
+#include "util/thread.h"
+#include "util/trace.h"
 
 /** Downcast packet_sink to decoder */
 #define DOWNCAST(SINK) container_of(SINK, struct decoder, packet_sink)
@@ -38,6 +44,69 @@ decoder_open_sinks(struct decoder *decoder) {
     return true;
 }
 
+static enum AVPixelFormat
+decoder_get_format(AVCodecContext *ctx, const enum AVPixelFormat *pix_fmts) {
+    struct decoder *decoder = ctx->opaque;
+
+    if (decoder->hw_pix_fmt != AV_PIX_FMT_NONE) {
+        for (const enum AVPixelFormat *fmt = pix_fmts;
+                *fmt != AV_PIX_FMT_NONE; ++fmt) {
+            if (*fmt == decoder->hw_pix_fmt) {
+                return *fmt;
+            }
+        }
+        // the hardware format may legitimately be missing (e.g. on a stream
+        // parameter change the decoder re-negotiates), decode in software
+        LOGW("Hardware pixel format not offered by the decoder, "
+             "falling back to software decoding");
+        decoder->hw_pix_fmt = AV_PIX_FMT_NONE;
+    }
+
+    // Accept the formats that the renderer can upload without a per-frame
+    // conversion (hardware decoders natively output NV12), in the decoder's
+    // order of preference
+    for (const enum AVPixelFormat *fmt = pix_fmts; *fmt != AV_PIX_FMT_NONE;
+            ++fmt) {
+        if (*fmt == AV_PIX_FMT_NV12 || *fmt == AV_PIX_FMT_YUV420P) {
+            return *fmt;
+        }
+    }
+
+    // no format directly supported by the renderer, let ffmpeg choose
+    return avcodec_default_get_format(ctx, pix_fmts);
+}
+
+// Open the first hardware decoding device usable with the codec, and record
+// the pixel format its frames will use. Returns false (without logging an
+// error) if none is available: the caller decodes in software.
+static bool
+decoder_open_hw_device(struct decoder *decoder, const AVCodec *codec) {
+    for (int i = 0;; ++i) {
+        const AVCodecHWConfig *config = avcodec_get_hw_config(codec, i);
+        if (!config) {
+            return false;
+        }
+        if (!(config->methods & AV_CODEC_HW_CONFIG_METHOD_HW_DEVICE_CTX)) {
+            continue;
+        }
+
+        AVBufferRef *hw_device_ctx;
+        int ret = av_hwdevice_ctx_create(&hw_device_ctx, config->device_type,
+                                         NULL, NULL, 0);
+        if (ret < 0) {
+            LOGD("Could not open hwaccel device %s: %d",
+                 av_hwdevice_get_type_name(config->device_type), ret);
+            continue;
+        }
+
+        LOGI("Hardware decoding on %s",
+             av_hwdevice_get_type_name(config->device_type));
+        decoder->codec_ctx->hw_device_ctx = hw_device_ctx;
+        decoder->hw_pix_fmt = config->pix_fmt;
+        return true;
+    }
+}
+
 static bool
 decoder_open(struct decoder *decoder, const AVCodec *codec) {
     decoder->codec_ctx = avcodec_alloc_context3(codec);
@@ -46,6 +115,40 @@ decoder_open(struct decoder *decoder, const AVCodec *codec) {
         return false;
     }
 
+    decoder->codec_ctx->opaque = decoder;
+    decoder->codec_ctx->get_format = decoder_get_format;
+
+    decoder->hw_pix_fmt = AV_PIX_FMT_NONE;
+    if (decoder->hwdec && !decoder_open_hw_device(decoder, codec)) {
+        LOGW("No hwaccel device available, decoding in software");
+    }
+    if (decoder->hw_pix_fmt != AV_PIX_FMT_NONE) {
+        // mapped frames pin their decoder surface while the display pipeline
+        // holds them (pending frame + frame being rendered + diff reference)
+        decoder->codec_ctx->extra_hw_frames = 3;
+    }
+
+    if (decoder->frame_threading) {
+        // frame threading parallelizes better, but delays the output by one
+        // frame per thread (low-delay mode would defeat it)
+        decoder->codec_ctx->thread_type = FF_THREAD_FRAME;
+    } else {
+        // the stream has no B-frames, the decoder may output each frame
+        // immediately
+        decoder->codec_ctx->flags |= AV_CODEC_FLAG_LOW_DELAY;
+
+        // if the device encoder splits frames into several slices, decode
+        // them in parallel (contrary to frame threading, slice threading
+        // adds no latency)
+        decoder->codec_ctx->thread_type = FF_THREAD_SLICE;
+    }
+
+    unsigned threads = decoder->thread_count;
+    if (!threads) {
+        threads = sc_cpu_count();
+    }
+    decoder->codec_ctx->thread_count = threads;
+
     if (avcodec_open2(decoder->codec_ctx, codec, NULL) < 0) {
         LOGE("Could not open codec");
         avcodec_free_context(&decoder->codec_ctx);
@@ -60,8 +163,18 @@ decoder_open(struct decoder *decoder, const AVCodec *codec) {
         return false;
     }
 
+    decoder->hw_frame = av_frame_alloc();
+    if (!decoder->hw_frame) {
+        LOG_OOM();
+        av_frame_free(&decoder->frame);
+        avcodec_close(decoder->codec_ctx);
+        avcodec_free_context(&decoder->codec_ctx);
+        return false;
+    }
+
     if (!decoder_open_sinks(decoder)) {
         LOGE("Could not open decoder sinks");
+        av_frame_free(&decoder->hw_frame);
         av_frame_free(&decoder->frame);
         avcodec_close(decoder->codec_ctx);
         avcodec_free_context(&decoder->codec_ctx);
@@ -74,6 +187,7 @@ decoder_open(struct decoder *decoder, const AVCodec *codec) {
 static void
 decoder_close(struct decoder *decoder) {
     decoder_close_sinks(decoder);
+    av_frame_free(&decoder->hw_frame);
     av_frame_free(&decoder->frame);
     avcodec_close(decoder->codec_ctx);
     avcodec_free_context(&decoder->codec_ctx);
@@ -92,6 +206,17 @@ push_frame_to_sinks(struct decoder *decoder, const AVFrame *frame) {
     return true;
 }
 
+static void
+decoder_request_idr(struct decoder *decoder) {
+    struct control_msg msg;
+    msg.type = CONTROL_MSG_TYPE_REQUEST_IDR;
+    if (controller_push_msg(decoder->controller, &msg)) {
+        LOGI("Requested IDR frame to recover the stream");
+    } else {
+        LOGW("Could not request IDR frame");
+    }
+}
+
 static bool
 decoder_push(struct decoder *decoder, const AVPacket *packet) {
     bool is_config = packet->pts == AV_NOPTS_VALUE;
@@ -103,16 +228,49 @@ decoder_push(struct decoder *decoder, const AVPacket *packet) {
     int ret = avcodec_send_packet(decoder->codec_ctx, packet);
     if (ret < 0 && ret != AVERROR(EAGAIN)) {
         LOGE("Could not send video packet: %d", ret);
+        if (decoder->controller) {
+            // skip the broken packet and ask the device encoder for a
+            // keyframe, instead of waiting (possibly for seconds) for the
+            // next natural one
+            decoder_request_idr(decoder);
+            return true;
+        }
         return false;
     }
     ret = avcodec_receive_frame(decoder->codec_ctx, decoder->frame);
     if (!ret) {
         // a frame was received
-        bool ok = push_frame_to_sinks(decoder, decoder->frame);
+        sc_stats_add(SC_STAT_FRAMES_DECODED, 1);
+
+        const AVFrame *frame = decoder->frame;
+        if (decoder->hw_pix_fmt != AV_PIX_FMT_NONE
+                && decoder->frame->format == decoder->hw_pix_fmt) {
+            // Map the hardware frame when the device supports it (zero-copy:
+            // the renderer then reads the decoder's buffer directly),
+            // otherwise download a copy to system memory; either way the
+            // frame is typically NV12, which the renderer uploads without
+            // conversion
+            ret = av_hwframe_map(decoder->hw_frame, decoder->frame,
+                                 AV_HWFRAME_MAP_READ);
+            if (ret < 0) {
+                ret = av_hwframe_transfer_data(decoder->hw_frame,
+                                               decoder->frame, 0);
+                if (ret < 0) {
+                    LOGE("Could not transfer hardware frame: %d", ret);
+                    av_frame_unref(decoder->frame);
+                    return false;
+                }
+            }
+            av_frame_copy_props(decoder->hw_frame, decoder->frame);
+            frame = decoder->hw_frame;
+        }
+
+        bool ok = push_frame_to_sinks(decoder, frame);
         // A frame lost should not make the whole pipeline fail. The error, if
         // any, is already logged.
         (void) ok;
 
+        av_frame_unref(decoder->hw_frame);
         av_frame_unref(decoder->frame);
     } else if (ret != AVERROR(EAGAIN)) {
         LOGE("Could not receive video frame: %d", ret);
@@ -136,12 +294,20 @@ decoder_packet_sink_close(struct sc_packet_sink *sink) {
 static bool
 decoder_packet_sink_push(struct sc_packet_sink *sink, const AVPacket *packet) {
     struct decoder *decoder = DOWNCAST(sink);
-    return decoder_push(decoder, packet);
+    sc_tick trace = sc_trace_begin();
+    bool ok = decoder_push(decoder, packet);
+    sc_trace_end("decode", trace);
+    return ok;
 }
 
 void
-decoder_init(struct decoder *decoder) {
+decoder_init(struct decoder *decoder, struct controller *controller,
+             uint16_t thread_count, bool frame_threading, bool hwdec) {
     decoder->sink_count = 0;
+    decoder->controller = controller;
+    decoder->thread_count = thread_count;
+    decoder->frame_threading = frame_threading;
+    decoder->hwdec = hwdec;
 
     static const struct sc_packet_sink_ops ops = {
         .open = decoder_packet_sink_open,
@@ -6,9 +6,12 @@
 #include "trait/packet_sink.h"
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <libavformat/avformat.h>
 
-#define DECODER_MAX_SINKS 2
+#define DECODER_MAX_SINKS 3
+
+struct controller;
 
 struct decoder {
     struct sc_packet_sink packet_sink; // packet sink trait
@@ -18,10 +21,29 @@ struct decoder {
 
     AVCodecContext *codec_ctx;
     AVFrame *frame;
+
+    // use a hardware decoding device if one can be opened (see decoder_open())
+    bool hwdec;
+    // pixel format of the hardware frames (AV_PIX_FMT_NONE when decoding in
+    // software)
+    enum AVPixelFormat hw_pix_fmt;
+    // destination of the hardware frames downloaded to system memory
+    AVFrame *hw_frame;
+
+    // if not NULL, request an IDR frame to the device on decode errors,
+    // instead of failing (recovery on lossy links)
+    struct controller *controller;
+
+    // number of decoding threads (0 to auto-size from the CPU count)
+    uint16_t thread_count;
+    // frame threading parallelizes better than slice threading, but adds one
+    // frame of latency per thread
+    bool frame_threading;
 };
 
 void
-decoder_init(struct decoder *decoder);
+decoder_init(struct decoder *decoder, struct controller *controller,
+             uint16_t thread_count, bool frame_threading, bool hwdec);
 
 void
 decoder_add_sink(struct decoder *decoder, struct sc_frame_sink *sink);
@@ -1,15 +1,15 @@
 #include "device_msg.h"
 
 #include <stdint.h>
-#include <stdlib.h>
 #include <string.h>
+#include <zlib.h>
 
 #include "util/buffer_util.h"
 #include "util/log.h"
 
 ssize_t
-device_msg_deserialize(const unsigned char *buf, size_t len,
-                       struct device_msg *msg) {
+device_msg_deserialize(struct sc_arena *arena, const unsigned char *buf,
+                       size_t len, struct device_msg *msg) {
     if (len < 5) {
         // at least type + empty string length
         return 0; // not available
@@ -18,28 +18,74 @@ device_msg_deserialize(const unsigned char *buf, size_t len,
     msg->type = buf[0];
     switch (msg->type) {
         case DEVICE_MSG_TYPE_CLIPBOARD: {
-            size_t clipboard_len = buffer_read32be(&buf[1]);
-            if (clipboard_len > len - 5) {
+            if (len < 6) {
                 return 0; // not available
             }
-            char *text = malloc(clipboard_len + 1);
-            if (!text) {
-                LOG_OOM();
-                return -1;
+            bool compressed = buf[1];
+            size_t clipboard_len = buffer_read32be(&buf[2]);
+            if (clipboard_len > len - 6) {
+                return 0; // not available
             }
-            if (clipboard_len) {
-                memcpy(text, &buf[5], clipboard_len);
+
+            char *text;
+            if (compressed) {
+                // compressed payload: uncompressed length (4 bytes) followed
+                // by a zlib stream
+                if (clipboard_len < 4) {
+                    LOGE("Invalid compressed clipboard message");
+                    return -1; // error, we cannot recover
+                }
+                size_t text_len = buffer_read32be(&buf[6]);
+                if (text_len > DEVICE_MSG_TEXT_MAX_LENGTH) {
+                    LOGE("Invalid clipboard length: %zu", text_len);
+                    return -1;
+                }
+                text = sc_arena_alloc(arena, text_len + 1);
+                if (!text) {
+                    LOG_OOM();
+                    return -1;
+                }
+                uLongf dst_len = text_len;
+                int r = uncompress((Bytef *) text, &dst_len, &buf[10],
+                                   clipboard_len - 4);
+                if (r != Z_OK || dst_len != text_len) {
+                    LOGE("Could not uncompress clipboard message");
+                    sc_arena_free(arena, text);
+                    return -1;
+                }
+                text[text_len] = '\0';
+            } else {
+                text = sc_arena_alloc(arena, clipboard_len + 1);
+                if (!text) {
+                    LOG_OOM();
+                    return -1;
+                }
+                if (clipboard_len) {
+                    memcpy(text, &buf[6], clipboard_len);
+                }
+                text[clipboard_len] = '\0';
             }
-            text[clipboard_len] = '\0';
 
             msg->clipboard.text = text;
-            return 5 + clipboard_len;
+            return 6 + clipboard_len;
         }
         case DEVICE_MSG_TYPE_ACK_CLIPBOARD: {
             uint64_t sequence = buffer_read64be(&buf[1]);
             msg->ack_clipboard.sequence = sequence;
             return 9;
         }
+        case DEVICE_MSG_TYPE_INJECT_FAILURES: {
+            msg->inject_failures.count = buffer_read32be(&buf[1]);
+            return 5;
+        }
+        case DEVICE_MSG_TYPE_CLOCK_SYNC: {
+            if (len < 17) {
+                return 0; // not available
+            }
+            msg->clock_sync.client_time = buffer_read64be(&buf[1]);
+            msg->clock_sync.device_time = buffer_read64be(&buf[9]);
+            return 17;
+        }
         default:
             LOGW("Unknown device message type: %d", (int) msg->type);
             return -1; // error, we cannot recover
@@ -47,8 +93,8 @@ device_msg_deserialize(const unsigned char *buf, size_t len,
 }
 
 void
-device_msg_destroy(struct device_msg *msg) {
+device_msg_destroy(struct sc_arena *arena, struct device_msg *msg) {
     if (msg->type == DEVICE_MSG_TYPE_CLIPBOARD) {
-        free(msg->clipboard.text);
+        sc_arena_free(arena, msg->clipboard.text);
     }
 }
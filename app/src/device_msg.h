@@ -7,33 +7,48 @@
 #include <stdint.h>
 #include <unistd.h>
 
+#include "util/arena.h"
+
 #define DEVICE_MSG_MAX_SIZE (1 << 18) // 256k
-// type: 1 byte; length: 4 bytes
-#define DEVICE_MSG_TEXT_MAX_LENGTH (DEVICE_MSG_MAX_SIZE - 5)
+// type: 1 byte; compressed flag: 1 byte; length: 4 bytes
+#define DEVICE_MSG_TEXT_MAX_LENGTH (DEVICE_MSG_MAX_SIZE - 6)
 
 enum device_msg_type {
     DEVICE_MSG_TYPE_CLIPBOARD,
     DEVICE_MSG_TYPE_ACK_CLIPBOARD,
+    DEVICE_MSG_TYPE_INJECT_FAILURES,
+    DEVICE_MSG_TYPE_CLOCK_SYNC,
 };
 
 struct device_msg {
     enum device_msg_type type;
     union {
         struct {
-            char *text; // owned, to be freed by free()
+            // allocated from the caller's arena, released by
+            // device_msg_destroy()
+            char *text;
         } clipboard;
         struct {
             uint64_t sequence;
         } ack_clipboard;
+        struct {
+            uint32_t count;
+        } inject_failures;
+        struct {
+            uint64_t client_time; // echoed from the clock sync request
+            uint64_t device_time; // device timestamp, in the frame PTS base
+        } clock_sync;
     };
 };
 
-// return the number of bytes consumed (0 for no msg available, -1 on error)
+// Return the number of bytes consumed (0 for no msg available, -1 on error).
+// Any payload is allocated from `arena` (the text length is known before the
+// allocation, so the buffer is requested at its exact final size).
 ssize_t
-device_msg_deserialize(const unsigned char *buf, size_t len,
-                       struct device_msg *msg);
+device_msg_deserialize(struct sc_arena *arena, const unsigned char *buf,
+                       size_t len, struct device_msg *msg);
 
 void
-device_msg_destroy(struct device_msg *msg);
+device_msg_destroy(struct sc_arena *arena, struct device_msg *msg);
 
 #endif
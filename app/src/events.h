@@ -2,3 +2,5 @@
 #define EVENT_STREAM_STOPPED           (SDL_USEREVENT + 1)
 #define EVENT_SERVER_CONNECTION_FAILED (SDL_USEREVENT + 2)
 #define EVENT_SERVER_CONNECTED         (SDL_USEREVENT + 3)
+#define EVENT_MIRROR_STREAM_STOPPED    (SDL_USEREVENT + 4)
+#define EVENT_PRESENT_FRAME            (SDL_USEREVENT + 5)
@@ -32,17 +32,26 @@ file_handler_init(struct file_handler *file_handler, const char *serial,
         return false;
     }
 
-    ok = sc_intr_init(&file_handler->intr);
-    if (!ok) {
-        sc_cond_destroy(&file_handler->event_cond);
-        sc_mutex_destroy(&file_handler->mutex);
-        return false;
+    for (unsigned i = 0; i < FILE_HANDLER_WORKERS; ++i) {
+        struct file_handler_worker *worker = &file_handler->workers[i];
+        worker->parent = file_handler;
+        ok = sc_intr_init(&worker->intr);
+        if (!ok) {
+            while (i) {
+                sc_intr_destroy(&file_handler->workers[--i].intr);
+            }
+            sc_cond_destroy(&file_handler->event_cond);
+            sc_mutex_destroy(&file_handler->mutex);
+            return false;
+        }
     }
 
     file_handler->serial = strdup(serial);
     if (!file_handler->serial) {
         LOG_OOM();
-        sc_intr_destroy(&file_handler->intr);
+        for (unsigned i = 0; i < FILE_HANDLER_WORKERS; ++i) {
+            sc_intr_destroy(&file_handler->workers[i].intr);
+        }
         sc_cond_destroy(&file_handler->event_cond);
         sc_mutex_destroy(&file_handler->mutex);
         return false;
@@ -62,7 +71,9 @@ void
 file_handler_destroy(struct file_handler *file_handler) {
     sc_cond_destroy(&file_handler->event_cond);
     sc_mutex_destroy(&file_handler->mutex);
-    sc_intr_destroy(&file_handler->intr);
+    for (unsigned i = 0; i < FILE_HANDLER_WORKERS; ++i) {
+        sc_intr_destroy(&file_handler->workers[i].intr);
+    }
     free(file_handler->serial);
 
     struct file_handler_request req;
@@ -101,8 +112,11 @@ file_handler_request(struct file_handler *file_handler,
 
 static int
 run_file_handler(void *data) {
-    struct file_handler *file_handler = data;
-    struct sc_intr *intr = &file_handler->intr;
+    struct file_handler_worker *worker = data;
+    struct file_handler *file_handler = worker->parent;
+
+    sc_thread_apply_role(SC_THREAD_ROLE_IO);
+    struct sc_intr *intr = &worker->intr;
 
     const char *serial = file_handler->serial;
     assert(serial);
@@ -126,6 +140,7 @@ run_file_handler(void *data) {
         (void) non_empty;
         sc_mutex_unlock(&file_handler->mutex);
 
+        // several workers may run adb concurrently, each on its own request
         if (req.action == ACTION_INSTALL_APK) {
             LOGI("Installing %s...", req.file);
             bool ok = adb_install(intr, serial, req.file, 0);
@@ -151,13 +166,24 @@ run_file_handler(void *data) {
 
 bool
 file_handler_start(struct file_handler *file_handler) {
-    LOGD("Starting file_handler thread");
-
-    bool ok = sc_thread_create(&file_handler->thread, run_file_handler,
-                               "file_handler", file_handler);
-    if (!ok) {
-        LOGC("Could not start file_handler thread");
-        return false;
+    LOGD("Starting file_handler threads");
+
+    for (unsigned i = 0; i < FILE_HANDLER_WORKERS; ++i) {
+        struct file_handler_worker *worker = &file_handler->workers[i];
+        bool ok = sc_thread_create(&worker->thread, run_file_handler,
+                                   "file_handler", worker);
+        if (!ok) {
+            LOGC("Could not start file_handler thread");
+            // stop and join the workers already started
+            sc_mutex_lock(&file_handler->mutex);
+            file_handler->stopped = true;
+            sc_cond_broadcast(&file_handler->event_cond);
+            sc_mutex_unlock(&file_handler->mutex);
+            while (i) {
+                sc_thread_join(&file_handler->workers[--i].thread, NULL);
+            }
+            return false;
+        }
     }
 
     return true;
@@ -167,12 +193,16 @@ void
 file_handler_stop(struct file_handler *file_handler) {
     sc_mutex_lock(&file_handler->mutex);
     file_handler->stopped = true;
-    sc_cond_signal(&file_handler->event_cond);
-    sc_intr_interrupt(&file_handler->intr);
+    sc_cond_broadcast(&file_handler->event_cond);
+    for (unsigned i = 0; i < FILE_HANDLER_WORKERS; ++i) {
+        sc_intr_interrupt(&file_handler->workers[i].intr);
+    }
     sc_mutex_unlock(&file_handler->mutex);
 }
 
 void
 file_handler_join(struct file_handler *file_handler) {
-    sc_thread_join(&file_handler->thread, NULL);
+    for (unsigned i = 0; i < FILE_HANDLER_WORKERS; ++i) {
+        sc_thread_join(&file_handler->workers[i].thread, NULL);
+    }
 }
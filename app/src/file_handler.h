@@ -22,17 +22,30 @@ struct file_handler_request {
 
 struct file_handler_request_queue CBUF(struct file_handler_request, 16);
 
+// Several workers process the shared queue concurrently, so that dropping a
+// batch of APKs is bounded by adb bandwidth rather than by the number of
+// requests (each install is a blocking "adb install")
+#define FILE_HANDLER_WORKERS 3
+
+struct file_handler;
+
+struct file_handler_worker {
+    struct file_handler *parent;
+    sc_thread thread;
+    // each worker has its own interruptor (it holds at most one process)
+    struct sc_intr intr;
+};
+
 struct file_handler {
     char *serial;
     const char *push_target;
-    sc_thread thread;
     sc_mutex mutex;
     sc_cond event_cond;
     bool stopped;
     bool initialized;
     struct file_handler_request_queue queue;
 
-    struct sc_intr intr;
+    struct file_handler_worker workers[FILE_HANDLER_WORKERS];
 };
 
 bool
@@ -53,6 +53,17 @@ display_fps(struct fps_counter *counter) {
     } else {
         LOGI("%u fps", rendered_per_second);
     }
+
+    if (counter->frame_times.count >= 2) {
+        // inter-frame gap percentiles, in milliseconds
+        double p50 = sc_histogram_percentile(&counter->frame_times, 50)
+                   / 1000.;
+        double p95 = sc_histogram_percentile(&counter->frame_times, 95)
+                   / 1000.;
+        double p99 = sc_histogram_percentile(&counter->frame_times, 99)
+                   / 1000.;
+        LOGI("  frame time p50/p95/p99 = %.1f/%.1f/%.1f ms", p50, p95, p99);
+    }
 }
 
 // must be called with mutex locked
@@ -65,6 +76,7 @@ check_interval_expired(struct fps_counter *counter, uint32_t now) {
     display_fps(counter);
     counter->nr_rendered = 0;
     counter->nr_skipped = 0;
+    sc_histogram_clear(&counter->frame_times);
     // add a multiple of the interval
     uint32_t elapsed_slices =
         (now - counter->next_timestamp) / FPS_COUNTER_INTERVAL + 1;
@@ -99,6 +111,8 @@ fps_counter_start(struct fps_counter *counter) {
     counter->next_timestamp = sc_tick_now() + FPS_COUNTER_INTERVAL;
     counter->nr_rendered = 0;
     counter->nr_skipped = 0;
+    sc_histogram_clear(&counter->frame_times);
+    counter->last_rendered = 0;
     sc_mutex_unlock(&counter->mutex);
 
     set_started(counter, true);
@@ -165,6 +179,11 @@ fps_counter_add_rendered_frame(struct fps_counter *counter) {
     sc_tick now = sc_tick_now();
     check_interval_expired(counter, now);
     ++counter->nr_rendered;
+    if (counter->last_rendered) {
+        sc_histogram_add(&counter->frame_times,
+                         (uint64_t) (now - counter->last_rendered));
+    }
+    counter->last_rendered = now;
     sc_mutex_unlock(&counter->mutex);
 }
 
@@ -7,6 +7,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "util/histogram.h"
 #include "util/thread.h"
 
 struct fps_counter {
@@ -24,6 +25,10 @@ struct fps_counter {
     bool interrupted;
     unsigned nr_rendered;
     unsigned nr_skipped;
+    // inter-frame gaps of the current interval, to report latency
+    // percentiles (the average FPS hides stutter)
+    struct sc_histogram frame_times;
+    sc_tick last_rendered; // 0 if no frame was rendered yet
     sc_tick next_timestamp;
 };
 
@@ -6,85 +6,92 @@
 
 #include "util/log.h"
 
+// flag set in shared_slot when the shared slot holds a frame that has not
+// been consumed yet (the low bits hold the slot index)
+#define SC_FRAME_BUFFER_FRESH 4u
+#define SC_FRAME_BUFFER_SLOT_MASK 3u
+
 bool
 sc_frame_buffer_init(struct sc_frame_buffer *fb) {
-    fb->pending_frame = av_frame_alloc();
-    if (!fb->pending_frame) {
-        LOG_OOM();
-        return false;
-    }
-
-    fb->tmp_frame = av_frame_alloc();
-    if (!fb->tmp_frame) {
-        LOG_OOM();
-        av_frame_free(&fb->pending_frame);
-        return false;
-    }
-
-    bool ok = sc_mutex_init(&fb->mutex);
-    if (!ok) {
-        av_frame_free(&fb->pending_frame);
-        av_frame_free(&fb->tmp_frame);
-        return false;
+    for (unsigned i = 0; i < 3; ++i) {
+        fb->frames[i] = av_frame_alloc();
+        if (!fb->frames[i]) {
+            LOG_OOM();
+            while (i) {
+                av_frame_free(&fb->frames[--i]);
+            }
+            return false;
+        }
     }
 
+    fb->producer_slot = 0;
+    fb->consumer_slot = 1;
     // there is initially no frame, so consider it has already been consumed
-    fb->pending_frame_consumed = true;
+    atomic_init(&fb->shared_slot, 2);
 
     return true;
 }
 
 void
 sc_frame_buffer_destroy(struct sc_frame_buffer *fb) {
-    sc_mutex_destroy(&fb->mutex);
-    av_frame_free(&fb->pending_frame);
-    av_frame_free(&fb->tmp_frame);
-}
-
-static inline void
-swap_frames(AVFrame **lhs, AVFrame **rhs) {
-    AVFrame *tmp = *lhs;
-    *lhs = *rhs;
-    *rhs = tmp;
+    for (unsigned i = 0; i < 3; ++i) {
+        av_frame_free(&fb->frames[i]);
+    }
 }
 
 bool
 sc_frame_buffer_push(struct sc_frame_buffer *fb, const AVFrame *frame,
                   bool *previous_frame_skipped) {
-    sc_mutex_lock(&fb->mutex);
+    AVFrame *slot = fb->frames[fb->producer_slot];
+
+    // The producer slot may still hold a frame never consumed (it was
+    // replaced by a newer one before the consumer took it); unreffing it here
+    // may return its plane buffers to the decoder's buffer pool
+    av_frame_unref(slot);
 
-    // Use a temporary frame to preserve pending_frame in case of error.
-    // tmp_frame is an empty frame, no need to call av_frame_unref() beforehand.
-    int r = av_frame_ref(fb->tmp_frame, frame);
+    // On error, the pending frame (in the shared slot) is left untouched
+    int r = av_frame_ref(slot, frame);
     if (r) {
         LOGE("Could not ref frame: %d", r);
         return false;
     }
 
-    // Now that av_frame_ref() succeeded, we can replace the previous
-    // pending_frame
-    swap_frames(&fb->pending_frame, &fb->tmp_frame);
-    av_frame_unref(fb->tmp_frame);
+    // Publish the frame: the release ordering makes its content visible to
+    // the consumer, the acquire ordering makes the consumer's reset of the
+    // received slot visible to this thread
+    unsigned shared =
+        atomic_exchange_explicit(&fb->shared_slot,
+                                 fb->producer_slot | SC_FRAME_BUFFER_FRESH,
+                                 memory_order_acq_rel);
 
     if (previous_frame_skipped) {
-        *previous_frame_skipped = !fb->pending_frame_consumed;
+        *previous_frame_skipped = shared & SC_FRAME_BUFFER_FRESH;
     }
-    fb->pending_frame_consumed = false;
-
-    sc_mutex_unlock(&fb->mutex);
+    fb->producer_slot = shared & SC_FRAME_BUFFER_SLOT_MASK;
 
     return true;
 }
 
-void
+bool
 sc_frame_buffer_consume(struct sc_frame_buffer *fb, AVFrame *dst) {
-    sc_mutex_lock(&fb->mutex);
-    assert(!fb->pending_frame_consumed);
-    fb->pending_frame_consumed = true;
+    unsigned shared =
+        atomic_load_explicit(&fb->shared_slot, memory_order_relaxed);
+    if (!(shared & SC_FRAME_BUFFER_FRESH)) {
+        // no fresh frame (spurious wake-up)
+        return false;
+    }
 
-    av_frame_move_ref(dst, fb->pending_frame);
-    // av_frame_move_ref() resets its source frame, so no need to call
-    // av_frame_unref()
+    // Only this thread clears the fresh flag, so it is necessarily still set
+    // (the producer may have swapped in an even newer frame meanwhile, which
+    // is fine: the latest frame wins)
+    shared = atomic_exchange_explicit(&fb->shared_slot, fb->consumer_slot,
+                                      memory_order_acq_rel);
+    assert(shared & SC_FRAME_BUFFER_FRESH);
+    fb->consumer_slot = shared & SC_FRAME_BUFFER_SLOT_MASK;
 
-    sc_mutex_unlock(&fb->mutex);
+    av_frame_move_ref(dst, fb->frames[fb->consumer_slot]);
+    // av_frame_move_ref() resets its source frame, so the slot is empty for
+    // its next owner
+
+    return true;
 }
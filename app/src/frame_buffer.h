@@ -3,10 +3,9 @@
 
 #include "common.h"
 
+#include <stdatomic.h>
 #include <stdbool.h>
 
-#include "util/thread.h"
-
 // forward declarations
 typedef struct AVFrame AVFrame;
 
@@ -17,15 +16,22 @@ typedef struct AVFrame AVFrame;
  * If a pending frame has not been consumed when the producer pushes a new
  * frame, then it is lost. The intent is to always provide access to the very
  * last frame to minimize latency.
+ *
+ * It is implemented as a lock-free triple buffer: the producer and the
+ * consumer each own one slot, and atomically exchange it with the shared
+ * slot, so neither thread ever blocks on the other (a decode completing
+ * exactly at vsync must not stall the render thread).
  */
 
 struct sc_frame_buffer {
-    AVFrame *pending_frame;
-    AVFrame *tmp_frame; // To preserve the pending frame on error
-
-    sc_mutex mutex;
-
-    bool pending_frame_consumed;
+    AVFrame *frames[3];
+    // slot currently owned by the producer (producer thread only)
+    unsigned producer_slot;
+    // slot currently owned by the consumer (consumer thread only)
+    unsigned consumer_slot;
+    // index of the shared slot, with SC_FRAME_BUFFER_FRESH set if it holds a
+    // frame not consumed yet
+    atomic_uint shared_slot;
 };
 
 bool
@@ -38,7 +44,9 @@ bool
 sc_frame_buffer_push(struct sc_frame_buffer *fb, const AVFrame *frame,
                      bool *skipped);
 
-void
+// take a reference on the pending frame; return false without touching `dst`
+// if it was already consumed (spurious wake-up)
+bool
 sc_frame_buffer_consume(struct sc_frame_buffer *fb, AVFrame *dst);
 
 #endif
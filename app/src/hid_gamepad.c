@@ -0,0 +1,449 @@
+#include "hid_gamepad.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include "util/log.h"
+
+// Accessory ID 1 is the HID keyboard, 2 is reserved for a HID mouse
+#define HID_GAMEPAD_ACCESSORY_ID_FIRST 3
+
+#define HID_GAMEPAD_EVENT_SIZE 9
+
+#define HID_GAMEPAD_INDEX_AXES 0    // 4 bytes
+#define HID_GAMEPAD_INDEX_BRAKE 4
+#define HID_GAMEPAD_INDEX_ACCEL 5
+#define HID_GAMEPAD_INDEX_HAT 6
+#define HID_GAMEPAD_INDEX_BUTTONS 7 // 2 bytes
+
+#define HID_GAMEPAD_AXIS_CENTER 0x80
+
+// dpad state bits, converted to a hat switch value in the report
+#define HID_GAMEPAD_DPAD_UP (1 << 0)
+#define HID_GAMEPAD_DPAD_RIGHT (1 << 1)
+#define HID_GAMEPAD_DPAD_DOWN (1 << 2)
+#define HID_GAMEPAD_DPAD_LEFT (1 << 3)
+
+/**
+ * Gamepad HID report (9 bytes):
+ *
+ *     X Y Z Rz Brake Accelerator Hat Buttons Buttons
+ *
+ * X/Y are the left stick, Z/Rz the right stick (from 0 to 255, centered at
+ * 128). Brake and Accelerator are the triggers, mapped to the Simulation
+ * Controls usage page so that Android exposes them as AXIS_BRAKE and
+ * AXIS_GAS. The dpad is reported as a hat switch (from 1 to 8 clockwise
+ * starting north, 0 when released), and the 16-bit field reports the face,
+ * shoulder and stick buttons.
+ */
+static const unsigned char gamepad_report_desc[] = {
+    // Usage Page (Generic Desktop)
+    0x05, 0x01,
+    // Usage (Game Pad)
+    0x09, 0x05,
+
+    // Collection (Application)
+    0xA1, 0x01,
+
+    // Usage (X)
+    0x09, 0x30,
+    // Usage (Y)
+    0x09, 0x31,
+    // Usage (Z)
+    0x09, 0x32,
+    // Usage (Rz)
+    0x09, 0x35,
+    // Logical Minimum (0)
+    0x15, 0x00,
+    // Logical Maximum (255)
+    0x26, 0xFF, 0x00,
+    // Report Size (8)
+    0x75, 0x08,
+    // Report Count (4)
+    0x95, 0x04,
+    // Input (Data, Variable, Absolute): the sticks
+    0x81, 0x02,
+
+    // Usage Page (Simulation Controls)
+    0x05, 0x02,
+    // Usage (Brake)
+    0x09, 0xC5,
+    // Usage (Accelerator)
+    0x09, 0xC4,
+    // Logical Minimum (0)
+    0x15, 0x00,
+    // Logical Maximum (255)
+    0x26, 0xFF, 0x00,
+    // Report Size (8)
+    0x75, 0x08,
+    // Report Count (2)
+    0x95, 0x02,
+    // Input (Data, Variable, Absolute): the triggers
+    0x81, 0x02,
+
+    // Usage Page (Generic Desktop)
+    0x05, 0x01,
+    // Usage (Hat switch)
+    0x09, 0x39,
+    // Logical Minimum (1)
+    0x15, 0x01,
+    // Logical Maximum (8)
+    0x25, 0x08,
+    // Physical Minimum (0)
+    0x35, 0x00,
+    // Physical Maximum (315)
+    0x46, 0x3B, 0x01,
+    // Unit (degrees)
+    0x65, 0x14,
+    // Report Size (4)
+    0x75, 0x04,
+    // Report Count (1)
+    0x95, 0x01,
+    // Input (Data, Variable, Absolute, Null State): the dpad
+    0x81, 0x42,
+    // Unit (none)
+    0x65, 0x00,
+
+    // Report Size (4)
+    0x75, 0x04,
+    // Report Count (1)
+    0x95, 0x01,
+    // Input (Constant): hat padding
+    0x81, 0x01,
+
+    // Usage Page (Buttons)
+    0x05, 0x09,
+    // Usage Minimum (1)
+    0x19, 0x01,
+    // Usage Maximum (16)
+    0x29, 0x10,
+    // Logical Minimum (0)
+    0x15, 0x00,
+    // Logical Maximum (1)
+    0x25, 0x01,
+    // Report Size (1)
+    0x75, 0x01,
+    // Report Count (16)
+    0x95, 0x10,
+    // Input (Data, Variable, Absolute): the buttons
+    0x81, 0x02,
+
+    // End Collection
+    0xC0
+};
+
+// hat switch value indexed by the dpad bitmask (0 when the combination is
+// physically impossible)
+static const uint8_t hat_values[1 << 4] = {
+    0, // released
+    1, // up
+    3, // right
+    2, // up | right
+    5, // down
+    0,
+    4, // right | down
+    0,
+    7, // left
+    8, // up | left
+    0,
+    0,
+    6, // down | left
+    0,
+    0,
+    0,
+};
+
+static struct sc_hid_gamepad_slot *
+find_free_slot(struct sc_hid_gamepad *gamepad) {
+    for (size_t i = 0; i < SC_HID_GAMEPAD_MAX_SLOTS; ++i) {
+        struct sc_hid_gamepad_slot *slot = &gamepad->slots[i];
+        if (!slot->game_controller) {
+            return slot;
+        }
+    }
+    return NULL;
+}
+
+static struct sc_hid_gamepad_slot *
+find_slot(struct sc_hid_gamepad *gamepad, SDL_JoystickID instance_id) {
+    for (size_t i = 0; i < SC_HID_GAMEPAD_MAX_SLOTS; ++i) {
+        struct sc_hid_gamepad_slot *slot = &gamepad->slots[i];
+        if (slot->game_controller && slot->instance_id == instance_id) {
+            return slot;
+        }
+    }
+    return NULL;
+}
+
+static inline uint16_t
+slot_accessory_id(struct sc_hid_gamepad *gamepad,
+                  const struct sc_hid_gamepad_slot *slot) {
+    return HID_GAMEPAD_ACCESSORY_ID_FIRST + (slot - gamepad->slots);
+}
+
+static void
+slot_reset_state(struct sc_hid_gamepad_slot *slot) {
+    memset(slot->axes, HID_GAMEPAD_AXIS_CENTER, sizeof(slot->axes));
+    slot->brake = 0;
+    slot->accel = 0;
+    slot->dpad = 0;
+    slot->buttons = 0;
+}
+
+static bool
+push_report(struct sc_hid_gamepad *gamepad,
+            const struct sc_hid_gamepad_slot *slot) {
+    unsigned char *buffer = malloc(HID_GAMEPAD_EVENT_SIZE);
+    if (!buffer) {
+        LOG_OOM();
+        return false;
+    }
+
+    memcpy(&buffer[HID_GAMEPAD_INDEX_AXES], slot->axes, sizeof(slot->axes));
+    buffer[HID_GAMEPAD_INDEX_BRAKE] = slot->brake;
+    buffer[HID_GAMEPAD_INDEX_ACCEL] = slot->accel;
+    buffer[HID_GAMEPAD_INDEX_HAT] = hat_values[slot->dpad];
+    buffer[HID_GAMEPAD_INDEX_BUTTONS] = slot->buttons & 0xFF;
+    buffer[HID_GAMEPAD_INDEX_BUTTONS + 1] = slot->buttons >> 8;
+
+    struct sc_hid_event hid_event;
+    sc_hid_event_init(&hid_event, slot_accessory_id(gamepad, slot), buffer,
+                      HID_GAMEPAD_EVENT_SIZE);
+
+    if (!sc_aoa_push_hid_event(gamepad->aoa, &hid_event)) {
+        sc_hid_event_destroy(&hid_event);
+        LOGW("Could request HID event");
+        return false;
+    }
+
+    return true;
+}
+
+static void
+process_device_added(struct sc_hid_gamepad *gamepad,
+                     const SDL_ControllerDeviceEvent *event) {
+    struct sc_hid_gamepad_slot *slot = find_free_slot(gamepad);
+    if (!slot) {
+        LOGW("Could not handle more than %d gamepads",
+             SC_HID_GAMEPAD_MAX_SLOTS);
+        return;
+    }
+
+    // event->which is a device index for SDL_CONTROLLERDEVICEADDED
+    SDL_GameController *game_controller =
+        SDL_GameControllerOpen(event->which);
+    if (!game_controller) {
+        LOGW("Could not open game controller: %s", SDL_GetError());
+        return;
+    }
+
+    SDL_Joystick *joystick = SDL_GameControllerGetJoystick(game_controller);
+    assert(joystick);
+
+    uint16_t accessory_id = slot_accessory_id(gamepad, slot);
+    if (!sc_aoa_setup_hid(gamepad->aoa, accessory_id, gamepad_report_desc,
+                          ARRAY_LEN(gamepad_report_desc))) {
+        LOGW("Register HID gamepad failed");
+        SDL_GameControllerClose(game_controller);
+        return;
+    }
+
+    slot->game_controller = game_controller;
+    slot->instance_id = SDL_JoystickInstanceID(joystick);
+    slot_reset_state(slot);
+
+    LOGI("Gamepad connected: %s",
+         SDL_GameControllerName(game_controller));
+}
+
+static void
+process_device_removed(struct sc_hid_gamepad *gamepad,
+                       const SDL_ControllerDeviceEvent *event) {
+    // event->which is an instance id for SDL_CONTROLLERDEVICEREMOVED
+    struct sc_hid_gamepad_slot *slot = find_slot(gamepad, event->which);
+    if (!slot) {
+        return;
+    }
+
+    uint16_t accessory_id = slot_accessory_id(gamepad, slot);
+    if (!sc_aoa_unregister_hid(gamepad->aoa, accessory_id)) {
+        LOGW("Could not unregister HID gamepad");
+    }
+
+    SDL_GameControllerClose(slot->game_controller);
+    slot->game_controller = NULL;
+
+    LOGI("Gamepad disconnected");
+}
+
+// return the button bit index, or -1 if the button is not forwarded
+static int
+button_to_bit(uint8_t button) {
+    switch (button) {
+        case SDL_CONTROLLER_BUTTON_A:
+            return 0;
+        case SDL_CONTROLLER_BUTTON_B:
+            return 1;
+        case SDL_CONTROLLER_BUTTON_X:
+            return 2;
+        case SDL_CONTROLLER_BUTTON_Y:
+            return 3;
+        case SDL_CONTROLLER_BUTTON_BACK:
+            return 4;
+        case SDL_CONTROLLER_BUTTON_GUIDE:
+            return 5;
+        case SDL_CONTROLLER_BUTTON_START:
+            return 6;
+        case SDL_CONTROLLER_BUTTON_LEFTSTICK:
+            return 7;
+        case SDL_CONTROLLER_BUTTON_RIGHTSTICK:
+            return 8;
+        case SDL_CONTROLLER_BUTTON_LEFTSHOULDER:
+            return 9;
+        case SDL_CONTROLLER_BUTTON_RIGHTSHOULDER:
+            return 10;
+        default:
+            return -1;
+    }
+}
+
+static void
+process_button(struct sc_hid_gamepad *gamepad,
+               const SDL_ControllerButtonEvent *event) {
+    struct sc_hid_gamepad_slot *slot = find_slot(gamepad, event->which);
+    if (!slot) {
+        return;
+    }
+
+    bool down = event->state == SDL_PRESSED;
+
+    uint8_t dpad_bit = 0;
+    switch (event->button) {
+        case SDL_CONTROLLER_BUTTON_DPAD_UP:
+            dpad_bit = HID_GAMEPAD_DPAD_UP;
+            break;
+        case SDL_CONTROLLER_BUTTON_DPAD_RIGHT:
+            dpad_bit = HID_GAMEPAD_DPAD_RIGHT;
+            break;
+        case SDL_CONTROLLER_BUTTON_DPAD_DOWN:
+            dpad_bit = HID_GAMEPAD_DPAD_DOWN;
+            break;
+        case SDL_CONTROLLER_BUTTON_DPAD_LEFT:
+            dpad_bit = HID_GAMEPAD_DPAD_LEFT;
+            break;
+        default:
+            break;
+    }
+
+    if (dpad_bit) {
+        if (down) {
+            slot->dpad |= dpad_bit;
+        } else {
+            slot->dpad &= ~dpad_bit;
+        }
+    } else {
+        int bit = button_to_bit(event->button);
+        if (bit < 0) {
+            // unsupported button, ignore
+            return;
+        }
+        if (down) {
+            slot->buttons |= 1 << bit;
+        } else {
+            slot->buttons &= ~(1 << bit);
+        }
+    }
+
+    push_report(gamepad, slot);
+}
+
+// convert a stick axis value (-32768 to 32767) to a report value (0 to 255)
+static inline uint8_t
+axis_to_report(int16_t value) {
+    return ((int32_t) value + 0x8000) >> 8;
+}
+
+// convert a trigger axis value (0 to 32767) to a report value (0 to 255)
+static inline uint8_t
+trigger_to_report(int16_t value) {
+    return value <= 0 ? 0 : value >> 7;
+}
+
+static void
+process_axis(struct sc_hid_gamepad *gamepad,
+             const SDL_ControllerAxisEvent *event) {
+    struct sc_hid_gamepad_slot *slot = find_slot(gamepad, event->which);
+    if (!slot) {
+        return;
+    }
+
+    switch (event->axis) {
+        case SDL_CONTROLLER_AXIS_LEFTX:
+            slot->axes[0] = axis_to_report(event->value);
+            break;
+        case SDL_CONTROLLER_AXIS_LEFTY:
+            slot->axes[1] = axis_to_report(event->value);
+            break;
+        case SDL_CONTROLLER_AXIS_RIGHTX:
+            slot->axes[2] = axis_to_report(event->value);
+            break;
+        case SDL_CONTROLLER_AXIS_RIGHTY:
+            slot->axes[3] = axis_to_report(event->value);
+            break;
+        case SDL_CONTROLLER_AXIS_TRIGGERLEFT:
+            slot->brake = trigger_to_report(event->value);
+            break;
+        case SDL_CONTROLLER_AXIS_TRIGGERRIGHT:
+            slot->accel = trigger_to_report(event->value);
+            break;
+        default:
+            return;
+    }
+
+    push_report(gamepad, slot);
+}
+
+void
+sc_hid_gamepad_process_event(struct sc_hid_gamepad *gamepad,
+                             const SDL_Event *event) {
+    switch (event->type) {
+        case SDL_CONTROLLERDEVICEADDED:
+            process_device_added(gamepad, &event->cdevice);
+            break;
+        case SDL_CONTROLLERDEVICEREMOVED:
+            process_device_removed(gamepad, &event->cdevice);
+            break;
+        case SDL_CONTROLLERBUTTONDOWN:
+        case SDL_CONTROLLERBUTTONUP:
+            process_button(gamepad, &event->cbutton);
+            break;
+        case SDL_CONTROLLERAXISMOTION:
+            process_axis(gamepad, &event->caxis);
+            break;
+        default:
+            break;
+    }
+}
+
+void
+sc_hid_gamepad_init(struct sc_hid_gamepad *gamepad, struct sc_aoa *aoa) {
+    gamepad->aoa = aoa;
+    for (size_t i = 0; i < SC_HID_GAMEPAD_MAX_SLOTS; ++i) {
+        gamepad->slots[i].game_controller = NULL;
+    }
+}
+
+void
+sc_hid_gamepad_destroy(struct sc_hid_gamepad *gamepad) {
+    for (size_t i = 0; i < SC_HID_GAMEPAD_MAX_SLOTS; ++i) {
+        struct sc_hid_gamepad_slot *slot = &gamepad->slots[i];
+        if (slot->game_controller) {
+            uint16_t accessory_id = slot_accessory_id(gamepad, slot);
+            if (!sc_aoa_unregister_hid(gamepad->aoa, accessory_id)) {
+                LOGW("Could not unregister HID gamepad");
+            }
+            SDL_GameControllerClose(slot->game_controller);
+            slot->game_controller = NULL;
+        }
+    }
+}
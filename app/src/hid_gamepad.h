@@ -0,0 +1,44 @@
+#ifndef SC_HID_GAMEPAD_H
+#define SC_HID_GAMEPAD_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <SDL2/SDL.h>
+
+#include "aoa_hid.h"
+
+// A few gamepads may be connected at the same time, each one exposed as a
+// separate HID device (with its own accessory id)
+#define SC_HID_GAMEPAD_MAX_SLOTS 4
+
+struct sc_hid_gamepad_slot {
+    SDL_GameController *game_controller; // NULL if the slot is free
+    SDL_JoystickID instance_id;
+
+    // current report state
+    uint8_t axes[4]; // left x/y then right x/y, from 0 to 255
+    uint8_t brake;   // left trigger, from 0 to 255
+    uint8_t accel;   // right trigger, from 0 to 255
+    uint8_t dpad;    // bitmask of pressed dpad buttons
+    uint16_t buttons;
+};
+
+struct sc_hid_gamepad {
+    struct sc_aoa *aoa;
+    struct sc_hid_gamepad_slot slots[SC_HID_GAMEPAD_MAX_SLOTS];
+};
+
+void
+sc_hid_gamepad_init(struct sc_hid_gamepad *gamepad, struct sc_aoa *aoa);
+
+void
+sc_hid_gamepad_destroy(struct sc_hid_gamepad *gamepad);
+
+// handle SDL_CONTROLLER* events (including controller hotplug)
+void
+sc_hid_gamepad_process_event(struct sc_hid_gamepad *gamepad,
+                             const SDL_Event *event);
+
+#endif
@@ -0,0 +1,231 @@
+#include "hid_mouse.h"
+
+#include <assert.h>
+#include <SDL2/SDL_events.h>
+
+#include "util/log.h"
+
+/** Downcast mouse processor to sc_hid_mouse */
+#define DOWNCAST(MP) container_of(MP, struct sc_hid_mouse, mouse_processor)
+
+// 1 is the keyboard, 3..6 are the gamepad slots
+#define HID_MOUSE_ACCESSORY_ID 2
+
+// 1 byte for buttons + padding, 1 byte for x, 1 byte for y, 1 byte for wheel
+#define HID_MOUSE_EVENT_SIZE 4
+
+#define HID_MOUSE_BUTTON_LEFT (1 << 0)
+#define HID_MOUSE_BUTTON_RIGHT (1 << 1)
+#define HID_MOUSE_BUTTON_MIDDLE (1 << 2)
+#define HID_MOUSE_BUTTON_X1 (1 << 3)
+#define HID_MOUSE_BUTTON_X2 (1 << 4)
+
+/**
+ * Mouse descriptor from the specification:
+ * <https://www.usb.org/sites/default/files/hid1_11.pdf>
+ *
+ * Appendix E (p71): §E.10 Report Descriptor (Mouse)
+ *
+ * The usage tags (like Wheel) are listed in "HID Usage Tables":
+ * <https://www.usb.org/sites/default/files/documents/hut1_12v2.pdf>
+ * §4 Generic Desktop Page (0x01) (p26)
+ */
+static const unsigned char mouse_report_desc[] = {
+    // Usage Page (Generic Desktop)
+    0x05, 0x01,
+    // Usage (Mouse)
+    0x09, 0x02,
+
+    // Collection (Application)
+    0xA1, 0x01,
+
+    // Usage (Pointer)
+    0x09, 0x01,
+
+    // Collection (Physical)
+    0xA1, 0x00,
+
+    // Usage Page (Buttons)
+    0x05, 0x09,
+    // Usage Minimum (1)
+    0x19, 0x01,
+    // Usage Maximum (5)
+    0x29, 0x05,
+    // Logical Minimum (0)
+    0x15, 0x00,
+    // Logical Maximum (1)
+    0x25, 0x01,
+    // Report Count (5)
+    0x95, 0x05,
+    // Report Size (1)
+    0x75, 0x01,
+    // Input (Data, Variable, Absolute): 5 buttons bits
+    0x81, 0x02,
+
+    // Report Count (1)
+    0x95, 0x01,
+    // Report Size (3)
+    0x75, 0x03,
+    // Input (Constant): 3 bits padding
+    0x81, 0x01,
+
+    // Usage Page (Generic Desktop)
+    0x05, 0x01,
+    // Usage (X)
+    0x09, 0x30,
+    // Usage (Y)
+    0x09, 0x31,
+    // Usage (Wheel)
+    0x09, 0x38,
+    // Logical Minimum (-127)
+    0x15, 0x81,
+    // Logical Maximum (127)
+    0x25, 0x7F,
+    // Report Size (8)
+    0x75, 0x08,
+    // Report Count (3)
+    0x95, 0x03,
+    // Input (Data, Variable, Relative): 3 position bytes (X, Y, Wheel)
+    0x81, 0x06,
+
+    // End Collection
+    0xC0,
+    // End Collection
+    0xC0,
+};
+
+static unsigned char
+sc_hid_mouse_clamp(int32_t value) {
+    if (value < -127) {
+        value = -127;
+    } else if (value > 127) {
+        value = 127;
+    }
+    return (unsigned char) (int8_t) value;
+}
+
+static bool
+sc_hid_mouse_event_init(struct sc_hid_event *hid_event, uint8_t buttons,
+                        int32_t dx, int32_t dy, int32_t wheel) {
+    unsigned char *buffer = calloc(1, HID_MOUSE_EVENT_SIZE);
+    if (!buffer) {
+        LOG_OOM();
+        return false;
+    }
+
+    buffer[0] = buttons;
+    buffer[1] = sc_hid_mouse_clamp(dx);
+    buffer[2] = sc_hid_mouse_clamp(dy);
+    buffer[3] = sc_hid_mouse_clamp(wheel);
+
+    sc_hid_event_init(hid_event, HID_MOUSE_ACCESSORY_ID, buffer,
+                      HID_MOUSE_EVENT_SIZE);
+    return true;
+}
+
+static void
+sc_hid_mouse_push(struct sc_hid_mouse *mouse, uint8_t buttons, int32_t dx,
+                  int32_t dy, int32_t wheel) {
+    struct sc_hid_event hid_event;
+    if (!sc_hid_mouse_event_init(&hid_event, buttons, dx, dy, wheel)) {
+        return;
+    }
+
+    if (!sc_aoa_push_hid_event(mouse->aoa, &hid_event)) {
+        sc_hid_event_destroy(&hid_event);
+        LOGW("Could request HID event");
+    }
+}
+
+static uint8_t
+sc_hid_mouse_button(uint8_t sdl_button) {
+    switch (sdl_button) {
+        case SDL_BUTTON_LEFT:
+            return HID_MOUSE_BUTTON_LEFT;
+        case SDL_BUTTON_RIGHT:
+            return HID_MOUSE_BUTTON_RIGHT;
+        case SDL_BUTTON_MIDDLE:
+            return HID_MOUSE_BUTTON_MIDDLE;
+        case SDL_BUTTON_X1:
+            return HID_MOUSE_BUTTON_X1;
+        case SDL_BUTTON_X2:
+            return HID_MOUSE_BUTTON_X2;
+        default:
+            return 0;
+    }
+}
+
+static void
+sc_mouse_processor_process_mouse_motion(struct sc_mouse_processor *mp,
+                                        const SDL_MouseMotionEvent *event) {
+    struct sc_hid_mouse *mouse = DOWNCAST(mp);
+    sc_hid_mouse_push(mouse, mouse->buttons, event->xrel, event->yrel, 0);
+}
+
+static void
+sc_mouse_processor_process_touch(struct sc_mouse_processor *mp,
+                                 const SDL_TouchFingerEvent *event) {
+    (void) mp;
+    (void) event;
+
+    // A physical mouse cannot produce touch events
+}
+
+static void
+sc_mouse_processor_process_mouse_button(struct sc_mouse_processor *mp,
+                                        const SDL_MouseButtonEvent *event) {
+    struct sc_hid_mouse *mouse = DOWNCAST(mp);
+
+    uint8_t button = sc_hid_mouse_button(event->button);
+    if (!button) {
+        return;
+    }
+
+    if (event->type == SDL_MOUSEBUTTONDOWN) {
+        mouse->buttons |= button;
+    } else {
+        mouse->buttons &= ~button;
+    }
+
+    sc_hid_mouse_push(mouse, mouse->buttons, 0, 0, 0);
+}
+
+static void
+sc_mouse_processor_process_mouse_wheel(struct sc_mouse_processor *mp,
+                                       const SDL_MouseWheelEvent *event) {
+    struct sc_hid_mouse *mouse = DOWNCAST(mp);
+    sc_hid_mouse_push(mouse, mouse->buttons, 0, 0, event->y);
+}
+
+bool
+sc_hid_mouse_init(struct sc_hid_mouse *mouse, struct sc_aoa *aoa) {
+    mouse->aoa = aoa;
+    mouse->buttons = 0;
+
+    bool ok = sc_aoa_setup_hid(aoa, HID_MOUSE_ACCESSORY_ID, mouse_report_desc,
+                               ARRAY_LEN(mouse_report_desc));
+    if (!ok) {
+        LOGW("Register HID mouse failed");
+        return false;
+    }
+
+    static const struct sc_mouse_processor_ops ops = {
+        .process_mouse_motion = sc_mouse_processor_process_mouse_motion,
+        .process_touch = sc_mouse_processor_process_touch,
+        .process_mouse_button = sc_mouse_processor_process_mouse_button,
+        .process_mouse_wheel = sc_mouse_processor_process_mouse_wheel,
+    };
+
+    mouse->mouse_processor.ops = &ops;
+
+    return true;
+}
+
+void
+sc_hid_mouse_destroy(struct sc_hid_mouse *mouse) {
+    // Unregister the HID mouse so the Android pointer disappears
+    bool ok = sc_aoa_unregister_hid(mouse->aoa, HID_MOUSE_ACCESSORY_ID);
+    if (!ok) {
+        LOGW("Could not unregister HID mouse");
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef SC_HID_MOUSE_H
+#define SC_HID_MOUSE_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "aoa_hid.h"
+#include "trait/mouse_processor.h"
+
+/**
+ * HID mouse reports are relative: each event contains the pressed buttons and
+ * the motion deltas since the previous report, as produced by a physical
+ * mouse. The pointer is drawn by Android itself, and events bypass the input
+ * injection stack entirely (they are handled like events from any USB mouse).
+ */
+struct sc_hid_mouse {
+    struct sc_mouse_processor mouse_processor; // mouse processor trait
+
+    struct sc_aoa *aoa;
+
+    // current buttons state, to be reported on every event
+    uint8_t buttons;
+};
+
+bool
+sc_hid_mouse_init(struct sc_hid_mouse *mouse, struct sc_aoa *aoa);
+
+void
+sc_hid_mouse_destroy(struct sc_hid_mouse *mouse);
+
+#endif
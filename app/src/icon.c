@@ -2,20 +2,19 @@
 
 #include <assert.h>
 #include <stdbool.h>
+#include <stdlib.h>
+#include <zlib.h>
 #include <libavformat/avformat.h>
 #include <libavutil/pixdesc.h>
 #include <libavutil/pixfmt.h>
 
-#include "config.h"
 #include "compat.h"
-#include "util/file.h"
+#include "icon_data.h"
 #include "util/log.h"
 #include "util/str.h"
 
-#define SCRCPY_PORTABLE_ICON_FILENAME "icon.png"
-#define SCRCPY_DEFAULT_ICON_PATH \
-    PREFIX "/share/icons/hicolor/256x256/apps/scrcpy.png"
-
+// return the icon path from the SCRCPY_ICON_PATH envvar, or NULL to use the
+// icon embedded at build time
 static char *
 get_icon_path(void) {
 #ifdef __WINDOWS__
@@ -38,23 +37,7 @@ get_icon_path(void) {
         return icon_path;
     }
 
-#ifndef PORTABLE
-    LOGD("Using icon: " SCRCPY_DEFAULT_ICON_PATH);
-    char *icon_path = strdup(SCRCPY_DEFAULT_ICON_PATH);
-    if (!icon_path) {
-        LOG_OOM();
-        return NULL;
-    }
-#else
-    char *icon_path = sc_file_get_local_path(SCRCPY_PORTABLE_ICON_FILENAME);
-    if (!icon_path) {
-        LOGE("Could not get icon path");
-        return NULL;
-    }
-    LOGD("Using icon (portable): %s", icon_path);
-#endif
-
-    return icon_path;
+    return NULL;
 }
 
 static AVFrame *
@@ -269,22 +252,64 @@ error:
     return NULL;
 }
 
+static SDL_Surface *
+load_embedded(void) {
+    uLongf len = scrcpy_icon_width * scrcpy_icon_height * 4;
+    unsigned char *pixels = malloc(len);
+    if (!pixels) {
+        LOG_OOM();
+        return NULL;
+    }
+
+    // the pixels are stored zlib-compressed, pre-decoded from the PNG at
+    // build time (see scripts/gen_icon_data.py)
+    int ret = uncompress(pixels, &len, scrcpy_icon_zdata,
+                         scrcpy_icon_zdata_len);
+    if (ret != Z_OK || len != scrcpy_icon_width * scrcpy_icon_height * 4) {
+        LOGE("Could not uncompress icon data");
+        free(pixels);
+        return NULL;
+    }
+
+    SDL_Surface *surface =
+        SDL_CreateRGBSurfaceWithFormatFrom(pixels,
+                                           scrcpy_icon_width,
+                                           scrcpy_icon_height,
+                                           32, scrcpy_icon_width * 4,
+                                           SDL_PIXELFORMAT_RGBA32);
+    if (!surface) {
+        LOGE("Could not create icon surface");
+        free(pixels);
+        return NULL;
+    }
+
+    // userdata is kept NULL: the pixels are malloc()ed, not owned by a frame
+    return surface;
+}
+
 SDL_Surface *
 scrcpy_icon_load() {
     char *icon_path = get_icon_path();
-    if (!icon_path) {
-        return NULL;
+    if (icon_path) {
+        // the envvar overrides the embedded icon
+        SDL_Surface *icon = load_from_path(icon_path);
+        free(icon_path);
+        return icon;
     }
 
-    SDL_Surface *icon = load_from_path(icon_path);
-    free(icon_path);
-    return icon;
+    return load_embedded();
 }
 
 void
 scrcpy_icon_destroy(SDL_Surface *icon) {
     AVFrame *frame = icon->userdata;
-    assert(frame);
-    av_frame_free(&frame);
+    void *pixels = icon->pixels;
     SDL_FreeSurface(icon);
+    if (frame) {
+        // loaded from SCRCPY_ICON_PATH, the frame owns the pixel data
+        av_frame_free(&frame);
+    } else {
+        // embedded icon, the pixels are malloc()ed
+        free(pixels);
+    }
 }
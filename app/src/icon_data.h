@@ -0,0 +1,16 @@
+#ifndef SC_ICON_DATA_H
+#define SC_ICON_DATA_H
+
+#include "common.h"
+
+// RGBA pixels of the app icon, zlib-compressed
+//
+// The definitions are generated at build time from data/icon.png by
+// scripts/gen_icon_data.py, so that startup does not decode a PNG at runtime.
+
+extern const unsigned scrcpy_icon_width;
+extern const unsigned scrcpy_icon_height;
+extern const unsigned char scrcpy_icon_zdata[];
+extern const unsigned scrcpy_icon_zdata_len;
+
+#endif
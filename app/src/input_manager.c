@@ -3,7 +3,12 @@
 #include <assert.h>
 #include <SDL2/SDL_keycode.h>
 
+#ifdef HAVE_AOA_HID
+# include "hid_gamepad.h"
+#endif
+#include "screenshot.h"
 #include "util/log.h"
+#include "util/str.h"
 
 static const int ACTION_DOWN = 1;
 static const int ACTION_UP = 1 << 1;
@@ -54,6 +59,8 @@ void
 input_manager_init(struct input_manager *im, struct controller *controller,
                    struct screen *screen, struct sc_key_processor *kp,
                    struct sc_mouse_processor *mp,
+                   struct sc_hid_gamepad *gamepad,
+                   struct sc_screenshot *screenshot,
                    const struct scrcpy_options *options) {
     assert(!options->control || (kp && kp->ops));
     assert(!options->control || (mp && mp->ops));
@@ -62,6 +69,8 @@ input_manager_init(struct input_manager *im, struct controller *controller,
     im->screen = screen;
     im->kp = kp;
     im->mp = mp;
+    im->gamepad = gamepad;
+    im->screenshot = screenshot;
 
     im->control = options->control;
     im->forward_all_clicks = options->forward_all_clicks;
@@ -225,10 +234,23 @@ set_device_clipboard(struct controller *controller, bool paste,
         return false;
     }
 
-    char *text_dup = strdup(text);
+    uint64_t hash = sc_str_hash(text);
+    uint64_t device_hash =
+        atomic_load_explicit(&controller->receiver.device_clipboard_hash,
+                             memory_order_relaxed);
+    if (!paste && hash == device_hash) {
+        // The device clipboard already contains this content, do not
+        // retransmit it (it may be arbitrarily large). On paste, the message
+        // must still be sent for the PASTE key press.
+        LOGD("Device clipboard unchanged, not re-sent");
+        SDL_free(text);
+        return true;
+    }
+
+    char *text_dup = sc_arena_strdup(&controller->arena, text);
     SDL_free(text);
     if (!text_dup) {
-        LOGW("Could not strdup input text");
+        LOGW("Could not copy input text");
         return false;
     }
 
@@ -239,11 +261,15 @@ set_device_clipboard(struct controller *controller, bool paste,
     msg.set_clipboard.paste = paste;
 
     if (!controller_push_msg(controller, &msg)) {
-        free(text_dup);
+        sc_arena_free(&controller->arena, text_dup);
         LOGW("Could not request 'set device clipboard'");
         return false;
     }
 
+    // the device clipboard will hold this content
+    atomic_store_explicit(&controller->receiver.device_clipboard_hash, hash,
+                          memory_order_relaxed);
+
     return true;
 }
 
@@ -288,10 +314,10 @@ clipboard_paste(struct controller *controller) {
         return;
     }
 
-    char *text_dup = strdup(text);
+    char *text_dup = sc_arena_strdup(&controller->arena, text);
     SDL_free(text);
     if (!text_dup) {
-        LOGW("Could not strdup input text");
+        LOGW("Could not copy input text");
         return;
     }
 
@@ -299,7 +325,7 @@ clipboard_paste(struct controller *controller) {
     msg.type = CONTROL_MSG_TYPE_INJECT_TEXT;
     msg.inject_text.text = text_dup;
     if (!controller_push_msg(controller, &msg)) {
-        free(text_dup);
+        sc_arena_free(&controller->arena, text_dup);
         LOGW("Could not request 'paste clipboard'");
     }
 }
@@ -351,6 +377,8 @@ simulate_virtual_finger(struct input_manager *im,
     msg.inject_touch_event.pointer_id = POINTER_ID_VIRTUAL_FINGER;
     msg.inject_touch_event.pressure = up ? 0.0f : 1.0f;
     msg.inject_touch_event.buttons = 0;
+    msg.inject_touch_event.timestamp = sc_tick_now();
+    msg.inject_touch_event.history_count = 0;
 
     if (!controller_push_msg(im->controller, &msg)) {
         LOGW("Could not request 'inject virtual finger event'");
@@ -410,8 +438,17 @@ input_manager_process_key(struct input_manager *im,
                 }
                 return;
             case SDLK_s:
-                if (control && !shift && !repeat) {
-                    action_app_switch(controller, action);
+                if (!repeat) {
+                    if (shift) {
+                        if (down && im->screenshot && im->screen->has_frame) {
+                            // snapshot the last decoded frame, the PNG is
+                            // encoded and saved on a background thread
+                            sc_screenshot_request(im->screenshot,
+                                                  im->screen->frame);
+                        }
+                    } else if (control) {
+                        action_app_switch(controller, action);
+                    }
                 }
                 return;
             case SDLK_m:
@@ -433,13 +470,21 @@ input_manager_process_key(struct input_manager *im,
                 }
                 return;
             case SDLK_DOWN:
-                if (control && !shift) {
+                if (shift) {
+                    if (!repeat && down) {
+                        screen_adjust_buffering(im->screen, false);
+                    }
+                } else if (control) {
                     // forward repeated events
                     action_volume_down(controller, action);
                 }
                 return;
             case SDLK_UP:
-                if (control && !shift) {
+                if (shift) {
+                    if (!repeat && down) {
+                        screen_adjust_buffering(im->screen, true);
+                    }
+                } else if (control) {
                     // forward repeated events
                     action_volume_up(controller, action);
                 }
@@ -718,6 +763,18 @@ input_manager_handle_event(struct input_manager *im, SDL_Event *event) {
         case SDL_FINGERUP:
             input_manager_process_touch(im, &event->tfinger);
             return true;
+#ifdef HAVE_AOA_HID
+        case SDL_CONTROLLERDEVICEADDED:
+        case SDL_CONTROLLERDEVICEREMOVED:
+        case SDL_CONTROLLERBUTTONDOWN:
+        case SDL_CONTROLLERBUTTONUP:
+        case SDL_CONTROLLERAXISMOTION:
+            if (!im->gamepad) {
+                break;
+            }
+            sc_hid_gamepad_process_event(im->gamepad, event);
+            return true;
+#endif
     }
 
     return false;
@@ -14,6 +14,8 @@
 #include "trait/key_processor.h"
 #include "trait/mouse_processor.h"
 
+struct sc_hid_gamepad;
+
 struct input_manager {
     struct controller *controller;
     struct screen *screen;
@@ -21,6 +23,14 @@ struct input_manager {
     struct sc_key_processor *kp;
     struct sc_mouse_processor *mp;
 
+    // forward game controller events as HID gamepad reports (may be NULL,
+    // only available with HAVE_AOA_HID)
+    struct sc_hid_gamepad *gamepad;
+
+    // save screenshots of the mirrored video (may be NULL if display is
+    // disabled)
+    struct sc_screenshot *screenshot;
+
     bool control;
     bool forward_all_clicks;
     bool legacy_paste;
@@ -47,6 +57,8 @@ void
 input_manager_init(struct input_manager *im, struct controller *controller,
                    struct screen *screen, struct sc_key_processor *kp,
                    struct sc_mouse_processor *mp,
+                   struct sc_hid_gamepad *gamepad,
+                   struct sc_screenshot *screenshot,
                    const struct scrcpy_options *options);
 
 bool
@@ -33,7 +33,7 @@ convert_keycode(SDL_Keycode from, enum android_keycode *to, uint16_t mod,
                 enum sc_key_inject_mode key_inject_mode) {
     // Navigation keys and ENTER.
     // Used in all modes.
-    static const struct sc_intmap_entry special_keys[] = {
+    static struct sc_intmap_entry special_keys_entries[] = {
         {SDLK_RETURN,    AKEYCODE_ENTER},
         {SDLK_KP_ENTER,  AKEYCODE_NUMPAD_ENTER},
         {SDLK_ESCAPE,    AKEYCODE_ESCAPE},
@@ -56,7 +56,7 @@ convert_keycode(SDL_Keycode from, enum android_keycode *to, uint16_t mod,
 
     // Numpad navigation keys.
     // Used in all modes, when NumLock and Shift are disabled.
-    static const struct sc_intmap_entry kp_nav_keys[] = {
+    static struct sc_intmap_entry kp_nav_keys_entries[] = {
         {SDLK_KP_0,      AKEYCODE_INSERT},
         {SDLK_KP_1,      AKEYCODE_MOVE_END},
         {SDLK_KP_2,      AKEYCODE_DPAD_DOWN},
@@ -71,7 +71,7 @@ convert_keycode(SDL_Keycode from, enum android_keycode *to, uint16_t mod,
 
     // Letters and space.
     // Used in non-text mode.
-    static const struct sc_intmap_entry alphaspace_keys[] = {
+    static struct sc_intmap_entry alphaspace_keys_entries[] = {
         {SDLK_a,         AKEYCODE_A},
         {SDLK_b,         AKEYCODE_B},
         {SDLK_c,         AKEYCODE_C},
@@ -103,7 +103,7 @@ convert_keycode(SDL_Keycode from, enum android_keycode *to, uint16_t mod,
 
     // Numbers and punctuation keys.
     // Used in raw mode only.
-    static const struct sc_intmap_entry numbers_punct_keys[] = {
+    static struct sc_intmap_entry numbers_punct_keys_entries[] = {
         {SDLK_HASH,          AKEYCODE_POUND},
         {SDLK_PERCENT,       AKEYCODE_PERIOD},
         {SDLK_QUOTE,         AKEYCODE_APOSTROPHE},
@@ -150,8 +150,15 @@ convert_keycode(SDL_Keycode from, enum android_keycode *to, uint16_t mod,
         {SDLK_KP_RIGHTPAREN, AKEYCODE_NUMPAD_RIGHT_PAREN},
     };
 
-    const struct sc_intmap_entry *entry =
-        SC_INTMAP_FIND_ENTRY(special_keys, from);
+    // binary-searched (sorted on first lookup); key events are all processed
+    // from the event loop thread
+    static struct sc_intmap special_keys = SC_INTMAP(special_keys_entries);
+    static struct sc_intmap kp_nav_keys = SC_INTMAP(kp_nav_keys_entries);
+    static struct sc_intmap alphaspace_keys = SC_INTMAP(alphaspace_keys_entries);
+    static struct sc_intmap numbers_punct_keys =
+        SC_INTMAP(numbers_punct_keys_entries);
+
+    const struct sc_intmap_entry *entry = sc_intmap_find(&special_keys, from);
     if (entry) {
         *to = entry->value;
         return true;
@@ -160,7 +167,7 @@ convert_keycode(SDL_Keycode from, enum android_keycode *to, uint16_t mod,
     if (!(mod & (KMOD_NUM | KMOD_SHIFT))) {
         // Handle Numpad events when Num Lock is disabled
         // If SHIFT is pressed, a text event will be sent instead
-        entry = SC_INTMAP_FIND_ENTRY(kp_nav_keys, from);
+        entry = sc_intmap_find(&kp_nav_keys, from);
         if (entry) {
             *to = entry->value;
             return true;
@@ -177,14 +184,14 @@ convert_keycode(SDL_Keycode from, enum android_keycode *to, uint16_t mod,
     }
 
     // if ALT and META are not pressed, also handle letters and space
-    entry = SC_INTMAP_FIND_ENTRY(alphaspace_keys, from);
+    entry = sc_intmap_find(&alphaspace_keys, from);
     if (entry) {
         *to = entry->value;
         return true;
     }
 
     if (key_inject_mode == SC_KEY_INJECT_MODE_RAW) {
-        entry = SC_INTMAP_FIND_ENTRY(numbers_punct_keys, from);
+        entry = sc_intmap_find(&numbers_punct_keys, from);
         if (entry) {
             *to = entry->value;
             return true;
@@ -324,13 +331,14 @@ sc_key_processor_process_text(struct sc_key_processor *kp,
 
     struct control_msg msg;
     msg.type = CONTROL_MSG_TYPE_INJECT_TEXT;
-    msg.inject_text.text = strdup(event->text);
+    msg.inject_text.text = sc_arena_strdup(&ki->controller->arena,
+                                           event->text);
     if (!msg.inject_text.text) {
-        LOGW("Could not strdup input text");
+        LOGW("Could not copy input text");
         return;
     }
     if (!controller_push_msg(ki->controller, &msg)) {
-        free(msg.inject_text.text);
+        sc_arena_free(&ki->controller->arena, msg.inject_text.text);
         LOGW("Could not request 'inject text'");
     }
 }
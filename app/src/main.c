@@ -4,15 +4,17 @@
 #include <stdbool.h>
 #include <unistd.h>
 #include <libavformat/avformat.h>
-#ifdef HAVE_V4L2
-# include <libavdevice/avdevice.h>
-#endif
 #define SDL_MAIN_HANDLED // avoid link error on Linux Windows Subsystem
 #include <SDL2/SDL.h>
 
+#include "adb.h"
 #include "cli.h"
 #include "options.h"
+#include "presets.h"
 #include "scrcpy.h"
+#ifdef HAVE_AOA_HID
+# include "scrcpy_otg.h"
+#endif
 #include "util/log.h"
 
 static void
@@ -31,11 +33,6 @@ print_version(void) {
     fprintf(stderr, " - libavutil %d.%d.%d\n", LIBAVUTIL_VERSION_MAJOR,
                                                LIBAVUTIL_VERSION_MINOR,
                                                LIBAVUTIL_VERSION_MICRO);
-#ifdef HAVE_V4L2
-    fprintf(stderr, " - libavdevice %d.%d.%d\n", LIBAVDEVICE_VERSION_MAJOR,
-                                                 LIBAVDEVICE_VERSION_MINOR,
-                                                 LIBAVDEVICE_VERSION_MICRO);
-#endif
 }
 
 int
@@ -60,7 +57,17 @@ main(int argc, char *argv[]) {
     args.opts.log_level = SC_LOG_LEVEL_DEBUG;
 #endif
 
-    if (!scrcpy_parse_args(&args, argc, argv)) {
+    int expanded_argc;
+    char **expanded_argv;
+    if (!sc_presets_expand_args(argc, argv, &expanded_argc, &expanded_argv)) {
+        return 1;
+    }
+
+    bool parsed = scrcpy_parse_args(&args, expanded_argc, expanded_argv);
+    if (expanded_argv != argv) {
+        sc_presets_free_args(expanded_argc, expanded_argv);
+    }
+    if (!parsed) {
         return 1;
     }
 
@@ -80,17 +87,34 @@ main(int argc, char *argv[]) {
     av_register_all();
 #endif
 
-#ifdef HAVE_V4L2
-    if (args.opts.v4l2_device) {
-        avdevice_register_all();
+    if (avformat_network_init()) {
+        return 1;
+    }
+
+    if (args.opts.auto_reconnect && args.opts.record_filename) {
+        LOGW("Auto-reconnect is disabled while recording");
+        args.opts.auto_reconnect = false;
+    }
+
+#ifdef HAVE_AOA_HID
+    if (args.opts.otg) {
+        enum scrcpy_exit otg_result = scrcpy_otg(&args.opts);
+        avformat_network_deinit(); // ignore failure
+        return otg_result == SCRCPY_EXIT_SUCCESS ? 0 : 1;
     }
 #endif
 
-    if (avformat_network_init()) {
-        return 1;
+    enum scrcpy_exit result = scrcpy(&args.opts);
+    while (result == SCRCPY_EXIT_DISCONNECTED && args.opts.auto_reconnect) {
+        LOGI("Device disconnected, waiting for it to reconnect...");
+        if (!sc_adb_await_device(args.opts.serial)) {
+            // device tracking unavailable, retry immediately
+            LOGW("Could not track devices, reconnecting blindly");
+        }
+        result = scrcpy(&args.opts);
     }
 
-    int res = scrcpy(&args.opts) ? 0 : 1;
+    int res = result == SCRCPY_EXIT_SUCCESS ? 0 : 1;
 
     avformat_network_deinit(); // ignore failure
 
@@ -77,6 +77,8 @@ convert_mouse_motion(const SDL_MouseMotionEvent *from, struct screen *screen,
         screen_convert_window_to_frame_coords(screen, from->x, from->y);
     to->inject_touch_event.pressure = 1.f;
     to->inject_touch_event.buttons = convert_mouse_buttons(from->state);
+    to->inject_touch_event.timestamp = sc_tick_now();
+    to->inject_touch_event.history_count = 0;
 
     return true;
 }
@@ -105,6 +107,8 @@ convert_touch(const SDL_TouchFingerEvent *from, struct screen *screen,
 
     to->inject_touch_event.pressure = from->pressure;
     to->inject_touch_event.buttons = 0;
+    to->inject_touch_event.timestamp = sc_tick_now();
+    to->inject_touch_event.history_count = 0;
     return true;
 }
 
@@ -125,6 +129,8 @@ convert_mouse_button(const SDL_MouseButtonEvent *from, struct screen *screen,
         from->type == SDL_MOUSEBUTTONDOWN ? 1.f : 0.f;
     to->inject_touch_event.buttons =
         convert_mouse_buttons(SDL_BUTTON(from->button));
+    to->inject_touch_event.timestamp = sc_tick_now();
+    to->inject_touch_event.history_count = 0;
 
     return true;
 }
@@ -194,16 +200,42 @@ sc_mouse_processor_process_mouse_button(struct sc_mouse_processor *mp,
     }
 }
 
+// Minimum interval between two scroll messages: high-resolution trackpads
+// emit hundreds of small deltas per second, which would flood the control
+// socket and the device injector. The deltas are accumulated, so no scroll
+// amplitude is lost (a remainder closing a burst is sent with the next one).
+#define SC_SCROLL_MIN_INTERVAL SC_TICK_FROM_MS(20)
+
 static void
 sc_mouse_processor_process_mouse_wheel(struct sc_mouse_processor *mp,
                                        const SDL_MouseWheelEvent *event) {
     struct sc_mouse_inject *mi = DOWNCAST(mp);
 
+    mi->pending_hscroll += event->x;
+    mi->pending_vscroll += event->y;
+
+    sc_tick now = sc_tick_now();
+    if (now - mi->last_scroll_date < SC_SCROLL_MIN_INTERVAL) {
+        // recently sent, keep accumulating
+        return;
+    }
+
+    if (!mi->pending_hscroll && !mi->pending_vscroll) {
+        // the deltas canceled out
+        return;
+    }
+
     struct control_msg msg;
     if (convert_mouse_wheel(event, mi->screen, &msg)) {
+        msg.inject_scroll_event.hscroll = mi->pending_hscroll;
+        msg.inject_scroll_event.vscroll = mi->pending_vscroll;
         if (!controller_push_msg(mi->controller, &msg)) {
             LOGW("Could not request 'inject mouse wheel event'");
+            return;
         }
+        mi->pending_hscroll = 0;
+        mi->pending_vscroll = 0;
+        mi->last_scroll_date = now;
     }
 }
 
@@ -212,6 +244,9 @@ sc_mouse_inject_init(struct sc_mouse_inject *mi, struct controller *controller,
                      struct screen *screen) {
     mi->controller = controller;
     mi->screen = screen;
+    mi->pending_hscroll = 0;
+    mi->pending_vscroll = 0;
+    mi->last_scroll_date = 0;
 
     static const struct sc_mouse_processor_ops ops = {
         .process_mouse_motion = sc_mouse_processor_process_mouse_motion,
@@ -8,12 +8,19 @@
 #include "controller.h"
 #include "screen.h"
 #include "trait/mouse_processor.h"
+#include "util/tick.h"
 
 struct sc_mouse_inject {
     struct sc_mouse_processor mouse_processor; // mouse processor trait
 
     struct controller *controller;
     struct screen *screen;
+
+    // aggregate wheel deltas to send scroll events at a bounded rate
+    // (trackpads may emit hundreds of small deltas per second)
+    int32_t pending_hscroll;
+    int32_t pending_vscroll;
+    sc_tick last_scroll_date;
 };
 
 void
@@ -2,8 +2,11 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include <string.h>
 #include "SDL2/SDL.h"
 
+#include "util/log.h"
+
 void
 sc_opengl_init(struct sc_opengl *gl) {
     gl->GetString = SDL_GL_GetProcAddress("glGetString");
@@ -18,6 +21,43 @@ sc_opengl_init(struct sc_opengl *gl) {
     // optional
     gl->GenerateMipmap = SDL_GL_GetProcAddress("glGenerateMipmap");
 
+    // optional, required by the YUV renderer only
+    gl->CreateShader = SDL_GL_GetProcAddress("glCreateShader");
+    gl->ShaderSource = SDL_GL_GetProcAddress("glShaderSource");
+    gl->CompileShader = SDL_GL_GetProcAddress("glCompileShader");
+    gl->GetShaderiv = SDL_GL_GetProcAddress("glGetShaderiv");
+    gl->GetShaderInfoLog = SDL_GL_GetProcAddress("glGetShaderInfoLog");
+    gl->DeleteShader = SDL_GL_GetProcAddress("glDeleteShader");
+    gl->CreateProgram = SDL_GL_GetProcAddress("glCreateProgram");
+    gl->AttachShader = SDL_GL_GetProcAddress("glAttachShader");
+    gl->LinkProgram = SDL_GL_GetProcAddress("glLinkProgram");
+    gl->GetProgramiv = SDL_GL_GetProcAddress("glGetProgramiv");
+    gl->GetProgramInfoLog = SDL_GL_GetProcAddress("glGetProgramInfoLog");
+    gl->DeleteProgram = SDL_GL_GetProcAddress("glDeleteProgram");
+    gl->UseProgram = SDL_GL_GetProcAddress("glUseProgram");
+    gl->GetUniformLocation = SDL_GL_GetProcAddress("glGetUniformLocation");
+    gl->GetAttribLocation = SDL_GL_GetProcAddress("glGetAttribLocation");
+    gl->Uniform1i = SDL_GL_GetProcAddress("glUniform1i");
+    gl->VertexAttribPointer = SDL_GL_GetProcAddress("glVertexAttribPointer");
+    gl->EnableVertexAttribArray =
+        SDL_GL_GetProcAddress("glEnableVertexAttribArray");
+    gl->DisableVertexAttribArray =
+        SDL_GL_GetProcAddress("glDisableVertexAttribArray");
+    gl->DrawArrays = SDL_GL_GetProcAddress("glDrawArrays");
+    gl->GenTextures = SDL_GL_GetProcAddress("glGenTextures");
+    gl->DeleteTextures = SDL_GL_GetProcAddress("glDeleteTextures");
+    gl->ActiveTexture = SDL_GL_GetProcAddress("glActiveTexture");
+    gl->BindTexture = SDL_GL_GetProcAddress("glBindTexture");
+    gl->TexImage2D = SDL_GL_GetProcAddress("glTexImage2D");
+    gl->TexSubImage2D = SDL_GL_GetProcAddress("glTexSubImage2D");
+    gl->PixelStorei = SDL_GL_GetProcAddress("glPixelStorei");
+    gl->Viewport = SDL_GL_GetProcAddress("glViewport");
+    gl->GenBuffers = SDL_GL_GetProcAddress("glGenBuffers");
+    gl->DeleteBuffers = SDL_GL_GetProcAddress("glDeleteBuffers");
+    gl->BindBuffer = SDL_GL_GetProcAddress("glBindBuffer");
+    gl->BufferData = SDL_GL_GetProcAddress("glBufferData");
+    gl->BufferSubData = SDL_GL_GetProcAddress("glBufferSubData");
+
     const char *version = (const char *) gl->GetString(GL_VERSION);
     assert(version);
     gl->version = version;
@@ -28,7 +68,7 @@ sc_opengl_init(struct sc_opengl *gl) {
                                sizeof(OPENGL_ES_PREFIX) - 1);
     if (gl->is_opengles) {
         /* skip the prefix */
-        version += sizeof(PREFIX) - 1;
+        version += sizeof(OPENGL_ES_PREFIX) - 1;
     }
 
     int r = sscanf(version, "%d.%d", &gl->version_major, &gl->version_minor);
@@ -54,3 +94,462 @@ sc_opengl_version_at_least(struct sc_opengl *gl,
         || (gl->version_major == minver_major
          && gl->version_minor >= minver_minor);
 }
+
+// GLSL 1.00 (ES) / 1.10, compatible with OpenGL 2.0+ and OpenGL ES 2.0+
+static const char *const yuv_vertex_shader_source =
+    "attribute vec2 vertex_pos;\n"
+    "attribute vec2 tex_coords_in;\n"
+    "varying vec2 tex_coords;\n"
+    "void main() {\n"
+    "    gl_Position = vec4(vertex_pos, 0.0, 1.0);\n"
+    "    tex_coords = tex_coords_in;\n"
+    "}\n";
+
+// BT.601 limited range, the colorspace produced by the device encoders
+static const char *const yuv_fragment_shader_source =
+    "#ifdef GL_ES\n"
+    "precision mediump float;\n"
+    "#endif\n"
+    "varying vec2 tex_coords;\n"
+    "uniform sampler2D tex_y;\n"
+    "uniform sampler2D tex_u;\n"
+    "uniform sampler2D tex_v;\n"
+    "void main() {\n"
+    "    float y = texture2D(tex_y, tex_coords).r - 0.0625;\n"
+    "    float u = texture2D(tex_u, tex_coords).r - 0.5;\n"
+    "    float v = texture2D(tex_v, tex_coords).r - 0.5;\n"
+    "    gl_FragColor = vec4(1.164 * y + 1.596 * v,\n"
+    "                        1.164 * y - 0.392 * u - 0.813 * v,\n"
+    "                        1.164 * y + 2.017 * u,\n"
+    "                        1.0);\n"
+    "}\n";
+
+// NV12 variant: the chroma plane interleaves U and V, uploaded as a
+// two-channel texture; the prefix defines SC_NV12_V to the channel holding V
+// (alpha for GL_LUMINANCE_ALPHA, green for GL_RG)
+static const char *const nv12_fragment_shader_source =
+    "#ifdef GL_ES\n"
+    "precision mediump float;\n"
+    "#endif\n"
+    "varying vec2 tex_coords;\n"
+    "uniform sampler2D tex_y;\n"
+    "uniform sampler2D tex_uv;\n"
+    "void main() {\n"
+    "    float y = texture2D(tex_y, tex_coords).r - 0.0625;\n"
+    "    float u = texture2D(tex_uv, tex_coords).r - 0.5;\n"
+    "    float v = texture2D(tex_uv, tex_coords).SC_NV12_V - 0.5;\n"
+    "    gl_FragColor = vec4(1.164 * y + 1.596 * v,\n"
+    "                        1.164 * y - 0.392 * u - 0.813 * v,\n"
+    "                        1.164 * y + 2.017 * u,\n"
+    "                        1.0);\n"
+    "}\n";
+
+static GLuint
+sc_yuv_renderer_compile_shader(struct sc_opengl *gl, GLenum type,
+                               const char *prefix, const char *source) {
+    GLuint shader = gl->CreateShader(type);
+    if (!shader) {
+        return 0;
+    }
+
+    const char *sources[2] = {prefix ? prefix : "", source};
+    gl->ShaderSource(shader, 2, sources, NULL);
+    gl->CompileShader(shader);
+
+    GLint compiled;
+    gl->GetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+    if (!compiled) {
+        char log[512];
+        gl->GetShaderInfoLog(shader, sizeof(log), NULL, log);
+        LOGE("Could not compile shader: %s", log);
+        gl->DeleteShader(shader);
+        return 0;
+    }
+
+    return shader;
+}
+
+// Create a program from the shared vertex shader and the given fragment
+// shader source (with an optional prefix prepended)
+static GLuint
+sc_yuv_renderer_create_program(struct sc_opengl *gl, const char *frag_prefix,
+                               const char *frag_source) {
+    GLuint vertex_shader =
+        sc_yuv_renderer_compile_shader(gl, GL_VERTEX_SHADER, NULL,
+                                       yuv_vertex_shader_source);
+    if (!vertex_shader) {
+        return 0;
+    }
+
+    GLuint fragment_shader =
+        sc_yuv_renderer_compile_shader(gl, GL_FRAGMENT_SHADER, frag_prefix,
+                                       frag_source);
+    if (!fragment_shader) {
+        gl->DeleteShader(vertex_shader);
+        return 0;
+    }
+
+    GLuint program = gl->CreateProgram();
+    if (program) {
+        gl->AttachShader(program, vertex_shader);
+        gl->AttachShader(program, fragment_shader);
+        gl->LinkProgram(program);
+
+        GLint linked;
+        gl->GetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (!linked) {
+            char log[512];
+            gl->GetProgramInfoLog(program, sizeof(log), NULL, log);
+            LOGE("Could not link shader program: %s", log);
+            gl->DeleteProgram(program);
+            program = 0;
+        }
+    }
+
+    // the shaders are no longer needed once the program is linked
+    gl->DeleteShader(vertex_shader);
+    gl->DeleteShader(fragment_shader);
+
+    return program;
+}
+
+bool
+sc_yuv_renderer_init(struct sc_yuv_renderer *yr, struct sc_opengl *gl,
+                     bool mipmaps) {
+    if (!gl->CreateShader || !gl->ShaderSource || !gl->CompileShader
+            || !gl->GetShaderiv || !gl->GetShaderInfoLog || !gl->DeleteShader
+            || !gl->CreateProgram || !gl->AttachShader || !gl->LinkProgram
+            || !gl->GetProgramiv || !gl->GetProgramInfoLog
+            || !gl->DeleteProgram || !gl->UseProgram
+            || !gl->GetUniformLocation || !gl->GetAttribLocation
+            || !gl->Uniform1i || !gl->VertexAttribPointer
+            || !gl->EnableVertexAttribArray || !gl->DisableVertexAttribArray
+            || !gl->DrawArrays || !gl->GenTextures || !gl->DeleteTextures
+            || !gl->ActiveTexture || !gl->BindTexture || !gl->TexImage2D
+            || !gl->TexSubImage2D || !gl->PixelStorei || !gl->Viewport) {
+        LOGW("OpenGL context without shader support");
+        return false;
+    }
+
+    if (!sc_opengl_version_at_least(gl, 2, 0, /* OpenGL 2.0+ */
+                                        2, 0  /* OpenGL ES 2.0+ */)) {
+        LOGW("OpenGL 2.0+ or ES 2.0+ required for the YUV renderer: %s",
+             gl->version);
+        return false;
+    }
+
+    bool core_profile = !gl->is_opengles && gl->version_major >= 3;
+
+    GLuint program = sc_yuv_renderer_create_program(gl, NULL,
+                                                    yuv_fragment_shader_source);
+    if (!program) {
+        return false;
+    }
+
+    // select the channel holding V in the two-channel chroma texture
+    const char *nv12_prefix = core_profile ? "#define SC_NV12_V g\n"
+                                           : "#define SC_NV12_V a\n";
+    GLuint nv12_program =
+        sc_yuv_renderer_create_program(gl, nv12_prefix,
+                                       nv12_fragment_shader_source);
+    if (!nv12_program) {
+        gl->DeleteProgram(program);
+        return false;
+    }
+
+    yr->gl = gl;
+    yr->program = program;
+    yr->attr_vertex_pos = gl->GetAttribLocation(program, "vertex_pos");
+    yr->attr_tex_coords = gl->GetAttribLocation(program, "tex_coords_in");
+    yr->nv12_program = nv12_program;
+    yr->nv12_attr_vertex_pos =
+        gl->GetAttribLocation(nv12_program, "vertex_pos");
+    yr->nv12_attr_tex_coords =
+        gl->GetAttribLocation(nv12_program, "tex_coords_in");
+
+    gl->UseProgram(program);
+    gl->Uniform1i(gl->GetUniformLocation(program, "tex_y"), 0);
+    gl->Uniform1i(gl->GetUniformLocation(program, "tex_u"), 1);
+    gl->Uniform1i(gl->GetUniformLocation(program, "tex_v"), 2);
+    gl->UseProgram(nv12_program);
+    gl->Uniform1i(gl->GetUniformLocation(nv12_program, "tex_y"), 0);
+    gl->Uniform1i(gl->GetUniformLocation(nv12_program, "tex_uv"), 1);
+    gl->UseProgram(0);
+
+    // GL_LUMINANCE and GL_LUMINANCE_ALPHA do not exist on desktop core
+    // profiles (OpenGL 3.0+)
+    yr->plane_format = core_profile ? GL_RED : GL_LUMINANCE;
+    yr->uv_format = core_profile ? GL_RG : GL_LUMINANCE_ALPHA;
+    // GL_UNPACK_ROW_LENGTH is unavailable on OpenGL ES 2.0 only
+    yr->has_unpack_row_length =
+        sc_opengl_version_at_least(gl, 1, 0, 3, 0);
+
+    gl->GenTextures(3, yr->textures);
+
+    // Pixel buffer objects require OpenGL 2.1+ or ES 3.0+ (which also
+    // guarantee GL_UNPACK_ROW_LENGTH); fall back to synchronous uploads on
+    // older contexts
+    yr->use_pbo = gl->GenBuffers && gl->DeleteBuffers && gl->BindBuffer
+               && gl->BufferData && gl->BufferSubData
+               && sc_opengl_version_at_least(gl, 2, 1, 3, 0);
+    if (yr->use_pbo) {
+        gl->GenBuffers(2, yr->pbos);
+        yr->pbo_index = 0;
+        LOGD("Using PBO texture uploads");
+    }
+
+    yr->size.width = 0;
+    yr->size.height = 0;
+    yr->nv12 = false;
+    yr->mipmaps = mipmaps;
+    yr->mipmaps_active = false;
+
+    return true;
+}
+
+void
+sc_yuv_renderer_set_mipmaps_active(struct sc_yuv_renderer *yr, bool active) {
+    assert(!active || yr->mipmaps);
+    if (active == yr->mipmaps_active) {
+        return;
+    }
+    yr->mipmaps_active = active;
+
+    if (!active || !yr->size.width) {
+        // nothing uploaded yet, the mipmaps are generated on the next upload
+        return;
+    }
+
+    struct sc_opengl *gl = yr->gl;
+    unsigned planes = yr->nv12 ? 2 : 3;
+    for (unsigned i = 0; i < planes; ++i) {
+        gl->BindTexture(GL_TEXTURE_2D, yr->textures[i]);
+        gl->GenerateMipmap(GL_TEXTURE_2D);
+    }
+}
+
+static void
+sc_yuv_renderer_setup_texture(struct sc_yuv_renderer *yr, GLuint texture,
+                              GLenum format, GLsizei width, GLsizei height) {
+    struct sc_opengl *gl = yr->gl;
+
+    gl->BindTexture(GL_TEXTURE_2D, texture);
+    gl->TexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0,
+                   format, GL_UNSIGNED_BYTE, NULL);
+    GLint min_filter = yr->mipmaps && gl->GenerateMipmap
+                     ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR;
+    gl->TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, min_filter);
+    gl->TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    gl->TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    gl->TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    if (min_filter == GL_LINEAR_MIPMAP_LINEAR) {
+        gl->TexParameterf(GL_TEXTURE_2D, GL_TEXTURE_LOD_BIAS, -1.f);
+    }
+}
+
+static void
+sc_yuv_renderer_upload_plane(struct sc_yuv_renderer *yr, GLuint texture,
+                             GLenum format, int bpp,
+                             GLsizei width, GLsizei height,
+                             const uint8_t *data, int linesize) {
+    struct sc_opengl *gl = yr->gl;
+
+    gl->BindTexture(GL_TEXTURE_2D, texture);
+    if (linesize == width * bpp) {
+        gl->TexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height,
+                          format, GL_UNSIGNED_BYTE, data);
+    } else if (yr->has_unpack_row_length && !(linesize % bpp)) {
+        // GL_UNPACK_ROW_LENGTH is expressed in pixels
+        gl->PixelStorei(GL_UNPACK_ROW_LENGTH, linesize / bpp);
+        gl->TexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height,
+                          format, GL_UNSIGNED_BYTE, data);
+        gl->PixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    } else {
+        // OpenGL ES 2.0: no GL_UNPACK_ROW_LENGTH, upload row by row
+        for (GLsizei y = 0; y < height; ++y) {
+            gl->TexSubImage2D(GL_TEXTURE_2D, 0, 0, y, width, 1,
+                              format, GL_UNSIGNED_BYTE,
+                              data + y * linesize);
+        }
+    }
+
+    if (yr->mipmaps_active) {
+        gl->GenerateMipmap(GL_TEXTURE_2D);
+    }
+}
+
+// upload one plane reading from the bound PBO at `offset` (the plane was
+// copied there with its stride padding included)
+static void
+sc_yuv_renderer_upload_plane_pbo(struct sc_yuv_renderer *yr, GLuint texture,
+                                 GLenum format, int bpp,
+                                 GLsizei width, GLsizei height,
+                                 int linesize, size_t offset) {
+    struct sc_opengl *gl = yr->gl;
+
+    gl->BindTexture(GL_TEXTURE_2D, texture);
+    gl->PixelStorei(GL_UNPACK_ROW_LENGTH, linesize / bpp);
+    gl->TexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height,
+                      format, GL_UNSIGNED_BYTE,
+                      (const void *) (uintptr_t) offset);
+    gl->PixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+    if (yr->mipmaps_active) {
+        gl->GenerateMipmap(GL_TEXTURE_2D);
+    }
+}
+
+static void
+sc_yuv_renderer_upload_frame(struct sc_yuv_renderer *yr, struct sc_size size,
+                             bool nv12, const uint8_t *const *data,
+                             const int *linesize) {
+    struct sc_opengl *gl = yr->gl;
+
+    GLsizei chroma_width = (size.width + 1) / 2;
+    GLsizei chroma_height = (size.height + 1) / 2;
+
+    unsigned planes = nv12 ? 2 : 3;
+    const GLsizei widths[3] = {size.width, chroma_width, chroma_width};
+    const GLsizei heights[3] = {size.height, chroma_height, chroma_height};
+    const GLenum formats[3] =
+        {yr->plane_format, nv12 ? yr->uv_format : yr->plane_format,
+         yr->plane_format};
+    const int bpps[3] = {1, nv12 ? 2 : 1, 1};
+
+    gl->PixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    if (size.width != yr->size.width || size.height != yr->size.height
+            || nv12 != yr->nv12) {
+        for (unsigned i = 0; i < planes; ++i) {
+            sc_yuv_renderer_setup_texture(yr, yr->textures[i], formats[i],
+                                          widths[i], heights[i]);
+        }
+        yr->size = size;
+        yr->nv12 = nv12;
+    }
+
+    if (yr->use_pbo) {
+        size_t plane_sizes[3];
+        size_t total = 0;
+        for (unsigned i = 0; i < planes; ++i) {
+            plane_sizes[i] = (size_t) linesize[i] * heights[i];
+            total += plane_sizes[i];
+        }
+
+        // alternate between the two PBOs, so that the upload from the
+        // previous frame may still be in flight
+        GLuint pbo = yr->pbos[yr->pbo_index];
+        yr->pbo_index = (yr->pbo_index + 1) % 2;
+
+        gl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+        // orphan the previous storage instead of synchronizing with it
+        gl->BufferData(GL_PIXEL_UNPACK_BUFFER, total, NULL, GL_STREAM_DRAW);
+
+        size_t offset = 0;
+        for (unsigned i = 0; i < planes; ++i) {
+            gl->BufferSubData(GL_PIXEL_UNPACK_BUFFER, offset, plane_sizes[i],
+                              data[i]);
+            gl->ActiveTexture(GL_TEXTURE0 + i);
+            sc_yuv_renderer_upload_plane_pbo(yr, yr->textures[i], formats[i],
+                                             bpps[i], widths[i], heights[i],
+                                             linesize[i], offset);
+            offset += plane_sizes[i];
+        }
+
+        gl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return;
+    }
+
+    for (unsigned i = 0; i < planes; ++i) {
+        gl->ActiveTexture(GL_TEXTURE0 + i);
+        sc_yuv_renderer_upload_plane(yr, yr->textures[i], formats[i], bpps[i],
+                                     widths[i], heights[i], data[i],
+                                     linesize[i]);
+    }
+}
+
+void
+sc_yuv_renderer_upload(struct sc_yuv_renderer *yr, struct sc_size size,
+                       const uint8_t *const data[3], const int linesize[3]) {
+    sc_yuv_renderer_upload_frame(yr, size, false, data, linesize);
+}
+
+void
+sc_yuv_renderer_upload_nv12(struct sc_yuv_renderer *yr, struct sc_size size,
+                            const uint8_t *const data[2],
+                            const int linesize[2]) {
+    sc_yuv_renderer_upload_frame(yr, size, true, data, linesize);
+}
+
+void
+sc_yuv_renderer_draw(struct sc_yuv_renderer *yr, struct sc_size drawable_size,
+                     int rect_x, int rect_y, int rect_w, int rect_h,
+                     unsigned rotation) {
+    struct sc_opengl *gl = yr->gl;
+
+    // convert the target rectangle (origin top-left) to normalized device
+    // coordinates (origin bottom-left)
+    float left = 2.f * rect_x / drawable_size.width - 1.f;
+    float right = 2.f * (rect_x + rect_w) / drawable_size.width - 1.f;
+    float top = 1.f - 2.f * rect_y / drawable_size.height;
+    float bottom = 1.f - 2.f * (rect_y + rect_h) / drawable_size.height;
+
+    const float vertices[] = {
+        left, bottom,
+        right, bottom,
+        left, top,
+        right, top,
+    };
+
+    // one texture coordinate per vertex (bottom-left, bottom-right, top-left,
+    // top-right), rotated by the requested number of counterclockwise
+    // quarter-turns
+    static const float tex_coords[4][8] = {
+        {0, 1,  1, 1,  0, 0,  1, 0}, // 0°
+        {0, 0,  0, 1,  1, 0,  1, 1}, // 90° counterclockwise
+        {1, 0,  0, 0,  1, 1,  0, 1}, // 180°
+        {1, 1,  1, 0,  0, 1,  0, 0}, // 270° counterclockwise
+    };
+    assert(rotation < 4);
+
+    GLuint program = yr->nv12 ? yr->nv12_program : yr->program;
+    GLint attr_vertex_pos = yr->nv12 ? yr->nv12_attr_vertex_pos
+                                     : yr->attr_vertex_pos;
+    GLint attr_tex_coords = yr->nv12 ? yr->nv12_attr_tex_coords
+                                     : yr->attr_tex_coords;
+    unsigned planes = yr->nv12 ? 2 : 3;
+
+    gl->Viewport(0, 0, drawable_size.width, drawable_size.height);
+    gl->UseProgram(program);
+
+    for (unsigned i = 0; i < planes; ++i) {
+        gl->ActiveTexture(GL_TEXTURE0 + i);
+        gl->BindTexture(GL_TEXTURE_2D, yr->textures[i]);
+    }
+
+    gl->VertexAttribPointer(attr_vertex_pos, 2, GL_FLOAT, GL_FALSE, 0,
+                            vertices);
+    gl->EnableVertexAttribArray(attr_vertex_pos);
+    gl->VertexAttribPointer(attr_tex_coords, 2, GL_FLOAT, GL_FALSE, 0,
+                            tex_coords[rotation]);
+    gl->EnableVertexAttribArray(attr_tex_coords);
+
+    gl->DrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+    gl->DisableVertexAttribArray(attr_vertex_pos);
+    gl->DisableVertexAttribArray(attr_tex_coords);
+    gl->UseProgram(0);
+    // restore the texture unit expected by the SDL renderer
+    gl->ActiveTexture(GL_TEXTURE0);
+}
+
+void
+sc_yuv_renderer_destroy(struct sc_yuv_renderer *yr) {
+    struct sc_opengl *gl = yr->gl;
+    if (yr->use_pbo) {
+        gl->DeleteBuffers(2, yr->pbos);
+    }
+    gl->DeleteTextures(3, yr->textures);
+    gl->DeleteProgram(yr->nv12_program);
+    gl->DeleteProgram(yr->program);
+}
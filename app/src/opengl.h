@@ -4,8 +4,11 @@
 #include "common.h"
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <SDL2/SDL_opengl.h>
 
+#include "coords.h"
+
 struct sc_opengl {
     const char *version;
     bool is_opengles;
@@ -23,6 +26,118 @@ struct sc_opengl {
 
     void
     (*GenerateMipmap)(GLenum target);
+
+    // the functions below are required by the YUV renderer only, they may be
+    // NULL if the context does not support shaders
+    GLuint
+    (*CreateShader)(GLenum type);
+
+    void
+    (*ShaderSource)(GLuint shader, GLsizei count, const GLchar *const *string,
+                    const GLint *length);
+
+    void
+    (*CompileShader)(GLuint shader);
+
+    void
+    (*GetShaderiv)(GLuint shader, GLenum pname, GLint *params);
+
+    void
+    (*GetShaderInfoLog)(GLuint shader, GLsizei max_length, GLsizei *length,
+                        GLchar *info_log);
+
+    void
+    (*DeleteShader)(GLuint shader);
+
+    GLuint
+    (*CreateProgram)(void);
+
+    void
+    (*AttachShader)(GLuint program, GLuint shader);
+
+    void
+    (*LinkProgram)(GLuint program);
+
+    void
+    (*GetProgramiv)(GLuint program, GLenum pname, GLint *params);
+
+    void
+    (*GetProgramInfoLog)(GLuint program, GLsizei max_length, GLsizei *length,
+                         GLchar *info_log);
+
+    void
+    (*DeleteProgram)(GLuint program);
+
+    void
+    (*UseProgram)(GLuint program);
+
+    GLint
+    (*GetUniformLocation)(GLuint program, const GLchar *name);
+
+    GLint
+    (*GetAttribLocation)(GLuint program, const GLchar *name);
+
+    void
+    (*Uniform1i)(GLint location, GLint v0);
+
+    void
+    (*VertexAttribPointer)(GLuint index, GLint size, GLenum type,
+                           GLboolean normalized, GLsizei stride,
+                           const void *pointer);
+
+    void
+    (*EnableVertexAttribArray)(GLuint index);
+
+    void
+    (*DisableVertexAttribArray)(GLuint index);
+
+    void
+    (*DrawArrays)(GLenum mode, GLint first, GLsizei count);
+
+    void
+    (*GenTextures)(GLsizei n, GLuint *textures);
+
+    void
+    (*DeleteTextures)(GLsizei n, const GLuint *textures);
+
+    void
+    (*ActiveTexture)(GLenum texture);
+
+    void
+    (*BindTexture)(GLenum target, GLuint texture);
+
+    void
+    (*TexImage2D)(GLenum target, GLint level, GLint internal_format,
+                  GLsizei width, GLsizei height, GLint border, GLenum format,
+                  GLenum type, const void *data);
+
+    void
+    (*TexSubImage2D)(GLenum target, GLint level, GLint xoffset, GLint yoffset,
+                     GLsizei width, GLsizei height, GLenum format, GLenum type,
+                     const void *data);
+
+    void
+    (*PixelStorei)(GLenum pname, GLint param);
+
+    void
+    (*Viewport)(GLint x, GLint y, GLsizei width, GLsizei height);
+
+    void
+    (*GenBuffers)(GLsizei n, GLuint *buffers);
+
+    void
+    (*DeleteBuffers)(GLsizei n, const GLuint *buffers);
+
+    void
+    (*BindBuffer)(GLenum target, GLuint buffer);
+
+    void
+    (*BufferData)(GLenum target, GLsizeiptr size, const void *data,
+                  GLenum usage);
+
+    void
+    (*BufferSubData)(GLenum target, GLintptr offset, GLsizeiptr size,
+                     const void *data);
 };
 
 void
@@ -33,4 +148,79 @@ sc_opengl_version_at_least(struct sc_opengl *gl,
                            int minver_major, int minver_minor,
                            int minver_es_major, int minver_es_minor);
 
+// Renders YUV 4:2:0 frames with a fragment shader, by uploading the planes
+// as textures, so that the YUV to RGB conversion always runs on the GPU
+// (SDL_UpdateYUVTexture falls back to a CPU conversion on some drivers).
+// Planar frames (YUV420P) use three single-channel textures; NV12 frames
+// (hardware decoders) use a Y texture and a two-channel interleaved UV
+// texture.
+//
+// It draws directly into the OpenGL context owned by the SDL renderer; the
+// caller must flush the SDL renderer before drawing (SDL_RenderFlush()).
+struct sc_yuv_renderer {
+    struct sc_opengl *gl;
+    GLuint program; // YUV 4:2:0 planar
+    GLuint nv12_program;
+    GLuint textures[3]; // Y, U, V (only Y and UV for NV12)
+    GLint attr_vertex_pos;
+    GLint attr_tex_coords;
+    GLint nv12_attr_vertex_pos;
+    GLint nv12_attr_tex_coords;
+    // single-channel texture format (GL_RED on core profiles, where
+    // GL_LUMINANCE does not exist)
+    GLenum plane_format;
+    // two-channel texture format for the interleaved NV12 chroma plane
+    // (GL_RG on core profiles, where GL_LUMINANCE_ALPHA does not exist)
+    GLenum uv_format;
+    bool has_unpack_row_length;
+    // Double-buffered pixel buffer objects: the planes are copied into a PBO
+    // and the texture upload reads from it asynchronously, so that the PCIe
+    // transfer of frame N overlaps the rendering of frame N-1 instead of
+    // stalling the render thread (~3ms per frame at 4K)
+    bool use_pbo;
+    GLuint pbos[2];
+    unsigned pbo_index;
+    struct sc_size size; // texture size (0 until the first upload)
+    bool nv12; // format of the current texture content
+    bool mipmaps; // trilinear filtering requested and supported
+    // regenerate the mipmaps on each upload; gated on the actual downscale
+    // by the caller, since generation is pure GPU cost while the content is
+    // displayed near its native size
+    bool mipmaps_active;
+};
+
+// Return false if the context does not support shaders
+bool
+sc_yuv_renderer_init(struct sc_yuv_renderer *yr, struct sc_opengl *gl,
+                     bool mipmaps);
+
+// Upload the 3 planes of a YUV420P frame (recreate the textures if the size
+// or the format changed)
+void
+sc_yuv_renderer_upload(struct sc_yuv_renderer *yr, struct sc_size size,
+                       const uint8_t *const data[3], const int linesize[3]);
+
+// Upload the 2 planes of an NV12 frame (recreate the textures if the size or
+// the format changed)
+void
+sc_yuv_renderer_upload_nv12(struct sc_yuv_renderer *yr, struct sc_size size,
+                            const uint8_t *const data[2],
+                            const int linesize[2]);
+
+// Enable or disable per-frame mipmap generation; when enabling, the mipmaps
+// are regenerated immediately from the current content (the existing levels
+// are stale)
+void
+sc_yuv_renderer_set_mipmaps_active(struct sc_yuv_renderer *yr, bool active);
+
+// Draw the current frame into the given rectangle (in drawable coordinates),
+// rotated by `rotation` (number of counterclockwise quarter-turns)
+void
+sc_yuv_renderer_draw(struct sc_yuv_renderer *yr, struct sc_size drawable_size,
+                     int rect_x, int rect_y, int rect_w, int rect_h,
+                     unsigned rotation);
+
+void
+sc_yuv_renderer_destroy(struct sc_yuv_renderer *yr);
+
 #endif
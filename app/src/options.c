@@ -14,6 +14,9 @@ const struct scrcpy_options scrcpy_options_default = {
 #endif
     .log_level = SC_LOG_LEVEL_INFO,
     .record_format = SC_RECORD_FORMAT_AUTO,
+    .record_fragmented = false,
+    .record_segment = 0,
+    .record_io_buffer = 1024 * 1024,
     .keyboard_input_mode = SC_KEYBOARD_INPUT_MODE_INJECT,
     .port_range = {
         .first = DEFAULT_LOCAL_PORT_RANGE_FIRST,
@@ -27,7 +30,9 @@ const struct scrcpy_options scrcpy_options_default = {
     },
     .max_size = 0,
     .bit_rate = DEFAULT_BIT_RATE,
+    .codec = SC_CODEC_H264,
     .max_fps = 0,
+    .max_fps_unfocused = 0,
     .lock_video_orientation = SC_LOCK_VIDEO_ORIENTATION_UNLOCKED,
     .rotation = 0,
     .window_x = SC_WINDOW_POSITION_UNDEFINED,
@@ -35,19 +40,32 @@ const struct scrcpy_options scrcpy_options_default = {
     .window_width = 0,
     .window_height = 0,
     .display_id = 0,
+    .secondary_display_ids = {0},
+    .secondary_display_count = 0,
+    .mirror_count = 0,
+    .thumbnail_port = 0,
+    .relay_port = 0,
+    .stream_dump_filename = NULL,
+    .stream_replay_filename = NULL,
+    .stream_replay_fast = false,
+    .auto_reconnect = false,
     .display_buffer = 0,
+    .display_buffer_auto = false,
     .v4l2_buffer = 0,
     .show_touches = false,
     .fullscreen = false,
     .always_on_top = false,
     .control = true,
     .display = true,
+    .audio = false,
     .turn_screen_off = false,
     .key_inject_mode = SC_KEY_INJECT_MODE_MIXED,
     .window_borderless = false,
     .mipmaps = true,
     .stay_awake = false,
     .force_adb_forward = false,
+    .daemon = false,
+    .direct_tcp_port = 0,
     .disable_screensaver = false,
     .forward_key_repeat = true,
     .forward_all_clicks = false,
@@ -56,4 +74,18 @@ const struct scrcpy_options scrcpy_options_default = {
     .clipboard_autosync = true,
     .tcpip = false,
     .tcpip_dst = NULL,
+    .dynamic_max_size = false,
+    .hid_gamepad = false,
+    .hid_mouse = false,
+    .memory_budget = 0,
+    .tcp_rcvbuf = 0,
+    .cpu_affinity = 0,
+    .prioritize_display = false,
+    .decoder_threads = 0,
+    .decoder_frame_threading = false,
+    .hwdec = false,
+    .trace_file = NULL,
+    .stats_interval = 0,
+    .print_latency = false,
+    .otg = false,
 };
@@ -23,6 +23,12 @@ enum sc_record_format {
     SC_RECORD_FORMAT_MKV,
 };
 
+enum sc_codec {
+    SC_CODEC_H264,
+    SC_CODEC_H265,
+    SC_CODEC_AV1,
+};
+
 enum sc_lock_video_orientation {
     SC_LOCK_VIDEO_ORIENTATION_UNLOCKED = -1,
     // lock the current orientation when scrcpy starts
@@ -89,6 +95,9 @@ struct scrcpy_options {
 #endif
     enum sc_log_level log_level;
     enum sc_record_format record_format;
+    bool record_fragmented;
+    sc_tick record_segment; // segment duration, 0 to disable rotation
+    uint32_t record_io_buffer; // muxer I/O buffer size, in bytes
     enum sc_keyboard_input_mode keyboard_input_mode;
     struct sc_port_range port_range;
     uint32_t tunnel_host;
@@ -96,7 +105,11 @@ struct scrcpy_options {
     struct sc_shortcut_mods shortcut_mods;
     uint16_t max_size;
     uint32_t bit_rate;
+    enum sc_codec codec;
     uint16_t max_fps;
+    // reduced frame rate requested while the window has no focus (0 to
+    // keep the nominal rate)
+    uint16_t max_fps_unfocused;
     enum sc_lock_video_orientation lock_video_orientation;
     uint8_t rotation;
     int16_t window_x; // SC_WINDOW_POSITION_UNDEFINED for "auto"
@@ -104,19 +117,44 @@ struct scrcpy_options {
     uint16_t window_width;
     uint16_t window_height;
     uint32_t display_id;
+    // additional display ids mirrored in separate windows (multiplexed over
+    // the same video socket)
+#define SC_MAX_SECONDARY_DISPLAYS 3
+    uint32_t secondary_display_ids[SC_MAX_SECONDARY_DISPLAYS];
+    unsigned secondary_display_count;
+    // additional devices mirrored in view-only windows by the same process
+    // (sharing the SDL initialization and the event loop)
+#define SC_MAX_MIRROR_DEVICES 15
+    const char *mirror_serials[SC_MAX_MIRROR_DEVICES];
+    unsigned mirror_count;
+    uint16_t thumbnail_port; // 0 for no thumbnail sink
+    uint16_t relay_port; // 0 for no relay sink
+    // dump the raw video stream (with arrival timestamps) to this file
+    const char *stream_dump_filename;
+    // replay a raw video stream dump instead of connecting to a device
+    const char *stream_replay_filename;
+    bool stream_replay_fast; // replay as fast as possible (ignore timing)
+    bool auto_reconnect;
     sc_tick display_buffer;
+    // adapt the display buffering dynamically to the measured jitter
+    bool display_buffer_auto;
     sc_tick v4l2_buffer;
     bool show_touches;
     bool fullscreen;
     bool always_on_top;
     bool control;
     bool display;
+    bool audio; // forward and play the device audio
     bool turn_screen_off;
     enum sc_key_inject_mode key_inject_mode;
     bool window_borderless;
     bool mipmaps;
     bool stay_awake;
     bool force_adb_forward;
+    // keep the device-side server resident, and re-attach to it on startup
+    bool daemon;
+    // if not 0, connect to the device over TCP directly (no adb tunnel)
+    uint16_t direct_tcp_port;
     bool disable_screensaver;
     bool forward_key_repeat;
     bool forward_all_clicks;
@@ -125,6 +163,36 @@ struct scrcpy_options {
     bool clipboard_autosync;
     bool tcpip;
     const char *tcpip_dst;
+    bool dynamic_max_size;
+    bool hid_gamepad;
+    bool hid_mouse;
+    size_t memory_budget; // in bytes, 0 for unlimited
+    // video socket kernel receive buffer, in bytes (0: default, 1MiB)
+    uint32_t tcp_rcvbuf;
+    // pin all the threads of this session to these CPUs (bitmask, 0 for no
+    // constraint)
+    uint64_t cpu_affinity;
+    // raise the priority of the decode and render threads and lower the
+    // priority of the I/O threads
+    bool prioritize_display;
+    // number of threads for software decoding (0 to auto-size from the CPU
+    // count)
+    uint16_t decoder_threads;
+    // use frame threading instead of slice threading for decoding (better
+    // parallelism, but adds latency)
+    bool decoder_frame_threading;
+    // use hardware-accelerated decoding when a hwaccel is available, falling
+    // back to software decoding
+    bool hwdec;
+    // if not NULL, write scoped trace events (Chrome trace event format) to
+    // this file
+    const char *trace_file;
+    // if positive, periodically log the pipeline statistics
+    sc_tick stats_interval;
+    // measure and log the capture-to-present latency
+    bool print_latency;
+    // input-only mode over USB (AOAv2), without server or video stream
+    bool otg;
 };
 
 extern const struct scrcpy_options scrcpy_options_default;
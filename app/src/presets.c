@@ -0,0 +1,129 @@
+#include "presets.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/file.h"
+#include "util/log.h"
+
+#define SC_PRESETS_FILENAME "presets"
+#define SC_PRESETS_MAX_LINE 1024
+// maximum number of arguments a single preset may expand to
+#define SC_PRESETS_MAX_ARGS 64
+
+#define SC_PRESETS_SEPARATORS " \t\r\n"
+
+// append the arguments of the preset to argv (up to cap items)
+static bool
+append_preset(const char *name, char **argv, int *argc, int cap) {
+    char *path = sc_file_get_config_path(SC_PRESETS_FILENAME);
+    if (!path) {
+        LOGE("Could not get presets config path");
+        return false;
+    }
+
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        LOGE("Could not open presets file: %s", path);
+        free(path);
+        return false;
+    }
+
+    bool found = false;
+    bool ok = true;
+    char line[SC_PRESETS_MAX_LINE];
+    while (!found && fgets(line, sizeof(line), file)) {
+        char *saveptr;
+        char *first = strtok_r(line, SC_PRESETS_SEPARATORS, &saveptr);
+        if (!first || first[0] == '#' || strcmp(first, name)) {
+            // empty line, comment, or another preset
+            continue;
+        }
+        found = true;
+
+        for (char *token = strtok_r(NULL, SC_PRESETS_SEPARATORS, &saveptr);
+                token;
+                token = strtok_r(NULL, SC_PRESETS_SEPARATORS, &saveptr)) {
+            if (*argc == cap) {
+                LOGE("Too many arguments in preset: %s", name);
+                ok = false;
+                break;
+            }
+            char *copy = strdup(token);
+            if (!copy) {
+                LOG_OOM();
+                ok = false;
+                break;
+            }
+            argv[(*argc)++] = copy;
+        }
+    }
+    fclose(file);
+
+    if (!found) {
+        LOGE("Unknown preset @%s (not found in %s)", name, path);
+        ok = false;
+    }
+
+    free(path);
+    return ok;
+}
+
+bool
+sc_presets_expand_args(int argc, char *argv[], int *out_argc,
+                       char ***out_argv) {
+    int preset_count = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (argv[i][0] == '@') {
+            ++preset_count;
+        }
+    }
+
+    if (!preset_count) {
+        // no preset argument, nothing to expand
+        *out_argc = argc;
+        *out_argv = argv;
+        return true;
+    }
+
+    int cap = argc - preset_count + preset_count * SC_PRESETS_MAX_ARGS;
+    char **new_argv = malloc(cap * sizeof(*new_argv));
+    if (!new_argv) {
+        LOG_OOM();
+        return false;
+    }
+
+    // all items are duplicated so that the result can be released uniformly
+    int new_argc = 0;
+    for (int i = 0; i < argc; ++i) {
+        if (i > 0 && argv[i][0] == '@') {
+            if (!append_preset(&argv[i][1], new_argv, &new_argc, cap)) {
+                goto error;
+            }
+        } else {
+            char *copy = strdup(argv[i]);
+            if (!copy) {
+                LOG_OOM();
+                goto error;
+            }
+            new_argv[new_argc++] = copy;
+        }
+    }
+
+    *out_argc = new_argc;
+    *out_argv = new_argv;
+    return true;
+
+error:
+    sc_presets_free_args(new_argc, new_argv);
+    return false;
+}
+
+void
+sc_presets_free_args(int argc, char **argv) {
+    for (int i = 0; i < argc; ++i) {
+        free(argv[i]);
+    }
+    free(argv);
+}
@@ -0,0 +1,34 @@
+#ifndef SC_PRESETS_H
+#define SC_PRESETS_H
+
+#include "common.h"
+
+#include <stdbool.h>
+
+/**
+ * Expand "@<name>" arguments from the presets config file
+ *
+ * A preset is a named list of command-line arguments, stored one preset per
+ * line in the "presets" file of the scrcpy config directory:
+ *
+ *     lowlatency --max-fps=60 --no-display --record=out.mkv
+ *
+ * Each "@<name>" argument is replaced (in place) by the arguments of the
+ * preset, so that explicit arguments may still override preset values.
+ *
+ * On success, *out_argv contains either argv itself (if there was no preset
+ * argument), or a new array to be released by sc_presets_free_args().
+ */
+bool
+sc_presets_expand_args(int argc, char *argv[], int *out_argc,
+                       char ***out_argv);
+
+/**
+ * Release an argv returned by sc_presets_expand_args()
+ *
+ * Must not be called if the returned argv was the input argv.
+ */
+void
+sc_presets_free_args(int argc, char **argv);
+
+#endif
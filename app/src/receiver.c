@@ -1,10 +1,24 @@
 #include "receiver.h"
 
 #include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <SDL2/SDL_clipboard.h>
 
 #include "device_msg.h"
 #include "util/log.h"
+#include "util/str.h"
+
+// Allocate twice the maximum message size, so that an incomplete message
+// can keep accumulating at its current position: compaction is then only
+// necessary when the free space at the end may not hold a whole message
+// (at most once per message, instead of after every batch)
+#define RECEIVER_BUFSIZE (2 * DEVICE_MSG_MAX_SIZE)
+
+// Ring size for the payload arena. A message is released as soon as it has
+// been processed, so a single typical clipboard must fit; huge clipboards
+// transparently fall back to the heap (see struct sc_arena).
+#define RECEIVER_ARENA_SIZE 4096
 
 bool
 receiver_init(struct receiver *receiver, sc_socket control_socket,
@@ -14,14 +28,36 @@ receiver_init(struct receiver *receiver, sc_socket control_socket,
         return false;
     }
 
+    receiver->buf = malloc(RECEIVER_BUFSIZE);
+    if (!receiver->buf) {
+        LOG_OOM();
+        sc_mutex_destroy(&receiver->mutex);
+        return false;
+    }
+    receiver->buf_head = 0;
+    receiver->buf_tail = 0;
+
+    ok = sc_arena_init(&receiver->arena, RECEIVER_ARENA_SIZE);
+    if (!ok) {
+        free(receiver->buf);
+        sc_mutex_destroy(&receiver->mutex);
+        return false;
+    }
+
     receiver->control_socket = control_socket;
     receiver->acksync = acksync;
+    atomic_init(&receiver->device_clipboard_hash, 0);
+    atomic_init(&receiver->device_clock_offset, 0);
+    atomic_init(&receiver->has_device_clock_offset, false);
+    receiver->clock_sync_min_rtt = INT64_MAX;
 
     return true;
 }
 
 void
 receiver_destroy(struct receiver *receiver) {
+    sc_arena_destroy(&receiver->arena);
+    free(receiver->buf);
     sc_mutex_destroy(&receiver->mutex);
 }
 
@@ -29,15 +65,21 @@ static void
 process_msg(struct receiver *receiver, struct device_msg *msg) {
     switch (msg->type) {
         case DEVICE_MSG_TYPE_CLIPBOARD: {
+            // remember what the device clipboard contains, so that the input
+            // manager does not send the same content back
+            atomic_store_explicit(&receiver->device_clipboard_hash,
+                                  sc_str_hash(msg->clipboard.text),
+                                  memory_order_relaxed);
+
             char *current = SDL_GetClipboardText();
             bool same = current && !strcmp(current, msg->clipboard.text);
             SDL_free(current);
             if (same) {
-                LOGD("Computer clipboard unchanged");
+                LOG_RATE_LIMITED(LOGD, "Computer clipboard unchanged");
                 return;
             }
 
-            LOGI("Device clipboard copied");
+            LOG_RATE_LIMITED(LOGI, "Device clipboard copied");
             SDL_SetClipboardText(msg->clipboard.text);
             break;
         }
@@ -47,6 +89,35 @@ process_msg(struct receiver *receiver, struct device_msg *msg) {
                  msg->ack_clipboard.sequence);
             sc_acksync_ack(receiver->acksync, msg->ack_clipboard.sequence);
             break;
+        case DEVICE_MSG_TYPE_INJECT_FAILURES:
+            // the device batches the failures, one report per second at most
+            LOGW("Device failed to inject %" PRIu32 " input event(s)",
+                 msg->inject_failures.count);
+            break;
+        case DEVICE_MSG_TYPE_CLOCK_SYNC: {
+            sc_tick now = sc_tick_now();
+            sc_tick t0 = (sc_tick) msg->clock_sync.client_time;
+            sc_tick rtt = now - t0;
+            if (rtt < 0) {
+                // inconsistent reply (it cannot arrive before its request)
+                break;
+            }
+            if (rtt <= receiver->clock_sync_min_rtt) {
+                // Assume symmetric transmission: the device produced its
+                // timestamp rtt/2 after t0. The sample with the lowest rtt
+                // bounds the estimation error the best.
+                receiver->clock_sync_min_rtt = rtt;
+                int64_t offset = (int64_t) msg->clock_sync.device_time
+                               - (t0 + rtt / 2);
+                atomic_store_explicit(&receiver->device_clock_offset, offset,
+                                      memory_order_relaxed);
+                atomic_store_explicit(&receiver->has_device_clock_offset,
+                                      true, memory_order_release);
+                LOGD("Clock sync: rtt=%" PRItick "us offset=%" PRIi64 "us",
+                     rtt, offset);
+            }
+            break;
+        }
     }
 }
 
@@ -55,7 +126,8 @@ process_msgs(struct receiver *receiver, const unsigned char *buf, size_t len) {
     size_t head = 0;
     for (;;) {
         struct device_msg msg;
-        ssize_t r = device_msg_deserialize(&buf[head], len - head, &msg);
+        ssize_t r = device_msg_deserialize(&receiver->arena, &buf[head],
+                                           len - head, &msg);
         if (r == -1) {
             return -1;
         }
@@ -64,7 +136,7 @@ process_msgs(struct receiver *receiver, const unsigned char *buf, size_t len) {
         }
 
         process_msg(receiver, &msg);
-        device_msg_destroy(&msg);
+        device_msg_destroy(&receiver->arena, &msg);
 
         head += r;
         assert(head <= len);
@@ -74,54 +146,43 @@ process_msgs(struct receiver *receiver, const unsigned char *buf, size_t len) {
     }
 }
 
-static int
-run_receiver(void *data) {
-    struct receiver *receiver = data;
-
-    static unsigned char buf[DEVICE_MSG_MAX_SIZE];
-    size_t head = 0;
-
-    for (;;) {
-        assert(head < DEVICE_MSG_MAX_SIZE);
-        ssize_t r = net_recv(receiver->control_socket, buf + head,
-                             DEVICE_MSG_MAX_SIZE - head);
-        if (r <= 0) {
-            LOGD("Receiver stopped");
-            break;
-        }
-
-        head += r;
-        ssize_t consumed = process_msgs(receiver, buf, head);
-        if (consumed == -1) {
-            // an error occurred
-            break;
-        }
-
-        if (consumed) {
-            head -= consumed;
-            // shift the remaining data in the buffer
-            memmove(buf, &buf[consumed], head);
-        }
+bool
+receiver_on_readable(struct receiver *receiver) {
+    unsigned char *buf = receiver->buf;
+    size_t head = receiver->buf_head;
+    size_t tail = receiver->buf_tail;
+
+    if (RECEIVER_BUFSIZE - head < DEVICE_MSG_MAX_SIZE) {
+        // the space at the end may not hold a whole message, move the
+        // pending bytes (at most one incomplete message) to the front
+        memmove(buf, &buf[tail], head - tail);
+        head -= tail;
+        tail = 0;
     }
 
-    return 0;
-}
-
-bool
-receiver_start(struct receiver *receiver) {
-    LOGD("Starting receiver thread");
+    assert(head < RECEIVER_BUFSIZE);
+    ssize_t r = net_recv(receiver->control_socket, &buf[head],
+                         RECEIVER_BUFSIZE - head);
+    if (r <= 0) {
+        LOGD("Receiver stopped");
+        return false;
+    }
 
-    bool ok = sc_thread_create(&receiver->thread, run_receiver, "receiver",
-                               receiver);
-    if (!ok) {
-        LOGC("Could not start receiver thread");
+    head += r;
+    ssize_t consumed = process_msgs(receiver, &buf[tail], head - tail);
+    if (consumed == -1) {
+        // an error occurred
         return false;
     }
 
-    return true;
-}
+    tail += consumed;
+    if (tail == head) {
+        // no pending bytes, restart from the front
+        tail = 0;
+        head = 0;
+    }
 
-void
-receiver_join(struct receiver *receiver) {
-    sc_thread_join(&receiver->thread, NULL);
+    receiver->buf_head = head;
+    receiver->buf_tail = tail;
+    return true;
 }
@@ -3,20 +3,48 @@
 
 #include "common.h"
 
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "util/acksync.h"
+#include "util/arena.h"
 #include "util/net.h"
 #include "util/thread.h"
+#include "util/tick.h"
 
 // receive events from the device
-// managed by the controller
+// managed by the controller, serviced by the stream thread (which polls the
+// control socket along with the video socket, so that no dedicated receive
+// thread is needed)
 struct receiver {
     sc_socket control_socket;
-    sc_thread thread;
     sc_mutex mutex;
 
+    // accumulation buffer for partially received messages
+    unsigned char *buf;
+    size_t buf_head; // end of the pending (unprocessed) bytes
+    size_t buf_tail; // start of the pending bytes
+
+    // message payloads (clipboard text) are decoded into this arena, then
+    // released as soon as the message is processed
+    struct sc_arena arena;
+
+    // hash (sc_str_hash()) of the last device clipboard content received
+    // (0 if none), read by the input manager to avoid resending content the
+    // device already has
+    atomic_uint_least64_t device_clipboard_hash;
+
     struct sc_acksync *acksync;
+
+    // Device clock offset estimation (device time - client time, in
+    // microseconds), written on clock sync replies, read by the screen to
+    // compute capture-to-present latency
+    atomic_int_least64_t device_clock_offset;
+    atomic_bool has_device_clock_offset;
+    // lowest round-trip time observed (only used by the receiver thread):
+    // the estimation it produced bounds the error the best
+    sc_tick clock_sync_min_rtt;
 };
 
 bool
@@ -26,12 +54,11 @@ receiver_init(struct receiver *receiver, sc_socket control_socket,
 void
 receiver_destroy(struct receiver *receiver);
 
+// Receive and process the available device messages (one recv() call).
+// Return false on end of stream or error.
+//
+// Called on the thread polling the control socket.
 bool
-receiver_start(struct receiver *receiver);
-
-// no receiver_stop(), it will automatically stop on control_socket shutdown
-
-void
-receiver_join(struct receiver *receiver);
+receiver_on_readable(struct receiver *receiver);
 
 #endif
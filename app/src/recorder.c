@@ -1,11 +1,18 @@
 #include "recorder.h"
 
 #include <assert.h>
+#include <string.h>
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
 #include <libavutil/time.h>
+#ifndef _WIN32
+# include <errno.h>
+# include <fcntl.h>
+# include <unistd.h>
+#endif
 
 #include "util/log.h"
+#include "util/stats.h"
 #include "util/str.h"
 
 /** Downcast packet_sink to recorder */
@@ -13,6 +20,11 @@
 
 static const AVRational SCRCPY_TIME_BASE = {1, 1000000}; // timestamps in us
 
+#ifndef _WIN32
+// preallocate the output file ahead of the writes by chunks of this size
+#define SC_RECORDER_PREALLOC_CHUNK ((int64_t) 32 * 1024 * 1024) // 32MiB
+#endif
+
 static const AVOutputFormat *
 find_muxer(const char *name) {
 #ifdef SCRCPY_LAVF_HAS_NEW_MUXER_ITERATOR_API
@@ -30,51 +42,258 @@ find_muxer(const char *name) {
     return oformat;
 }
 
-static struct record_packet *
-record_packet_new(const AVPacket *packet) {
-    struct record_packet *rec = malloc(sizeof(*rec));
-    if (!rec) {
-        LOG_OOM();
-        return NULL;
+static void
+recorder_queue_clear(struct recorder_queue *queue) {
+    AVPacket rec;
+    while (sc_ringbuf_take(queue, &rec)) {
+        av_packet_unref(&rec);
+    }
+}
+
+static const char *
+recorder_get_format_name(enum sc_record_format format) {
+    switch (format) {
+        case SC_RECORD_FORMAT_MP4: return "mp4";
+        case SC_RECORD_FORMAT_MKV: return "matroska";
+        default: return NULL;
+    }
+}
+
+// Build "<name>-NNN<.ext>" for the next segment (caller must free it)
+static char *
+recorder_build_segment_filename(struct recorder *recorder) {
+    const char *filename = recorder->filename;
+    const char *dot = strrchr(filename, '.');
+    const char *slash = strrchr(filename, '/');
+    if (dot && slash && dot < slash) {
+        // the dot is in a parent directory, not in the basename
+        dot = NULL;
     }
 
-    rec->packet = av_packet_alloc();
-    if (!rec->packet) {
+    size_t stem_len = dot ? (size_t) (dot - filename) : strlen(filename);
+    const char *ext = dot ? dot : "";
+
+    ++recorder->segment_index;
+
+    size_t len = strlen(filename) + 16;
+    char *segment_filename = malloc(len);
+    if (!segment_filename) {
         LOG_OOM();
-        free(rec);
         return NULL;
     }
 
-    if (av_packet_ref(rec->packet, packet)) {
-        av_packet_free(&rec->packet);
-        free(rec);
-        return NULL;
+    snprintf(segment_filename, len, "%.*s-%03u%s", (int) stem_len, filename,
+             recorder->segment_index, ext);
+    return segment_filename;
+}
+
+#ifndef _WIN32
+static int
+recorder_avio_write(void *opaque, uint8_t *buf, int size) {
+    struct recorder *recorder = opaque;
+
+    if (recorder->write_pos + size > recorder->allocated) {
+        // Preallocate a large chunk ahead of the writes, so that the
+        // filesystem reserves the space in advance instead of growing the
+        // file on every batch (the file is truncated back to its real size
+        // on close)
+        int64_t target =
+            recorder->write_pos + size + SC_RECORDER_PREALLOC_CHUNK;
+        if (!posix_fallocate(recorder->fd, 0, target)) {
+            recorder->allocated = target;
+        }
+        // on error (e.g. the filesystem does not support preallocation),
+        // the write below extends the file as usual
     }
-    return rec;
+
+    int written = 0;
+    while (written < size) {
+        ssize_t w = write(recorder->fd, buf + written, size - written);
+        if (w == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return AVERROR(errno);
+        }
+        written += w;
+    }
+
+    recorder->write_pos += size;
+    if (recorder->write_pos > recorder->file_size) {
+        recorder->file_size = recorder->write_pos;
+    }
+
+    return size;
 }
 
-static void
-record_packet_delete(struct record_packet *rec) {
-    av_packet_free(&rec->packet);
-    free(rec);
+static int64_t
+recorder_avio_seek(void *opaque, int64_t offset, int whence) {
+    struct recorder *recorder = opaque;
+
+    if (whence & AVSEEK_SIZE) {
+        // report the bytes actually muxed, not the preallocated size
+        return recorder->file_size;
+    }
+    whence &= ~AVSEEK_FORCE;
+
+    int64_t pos;
+    switch (whence) {
+        case SEEK_SET:
+            pos = offset;
+            break;
+        case SEEK_CUR:
+            pos = recorder->write_pos + offset;
+            break;
+        case SEEK_END:
+            pos = recorder->file_size + offset;
+            break;
+        default:
+            return AVERROR(EINVAL);
+    }
+
+    if (pos < 0) {
+        return AVERROR(EINVAL);
+    }
+
+    if (lseek(recorder->fd, pos, SEEK_SET) == -1) {
+        return AVERROR(errno);
+    }
+
+    recorder->write_pos = pos;
+    return pos;
 }
 
-static void
-recorder_queue_clear(struct recorder_queue *queue) {
-    while (!sc_queue_is_empty(queue)) {
-        struct record_packet *rec;
-        sc_queue_take(queue, next, &rec);
-        record_packet_delete(rec);
+static bool
+recorder_open_file_output(struct recorder *recorder, const char *filename) {
+    assert(recorder->io_buffer_size);
+
+    int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0664);
+    if (fd == -1) {
+        LOGE("Failed to open output file: %s", filename);
+        return false;
     }
+
+    unsigned char *buffer = av_malloc(recorder->io_buffer_size);
+    if (!buffer) {
+        LOG_OOM();
+        close(fd);
+        return false;
+    }
+
+    AVIOContext *pb =
+        avio_alloc_context(buffer, recorder->io_buffer_size, 1, recorder,
+                           NULL, recorder_avio_write, recorder_avio_seek);
+    if (!pb) {
+        LOG_OOM();
+        av_free(buffer);
+        close(fd);
+        return false;
+    }
+
+    recorder->fd = fd;
+    recorder->write_pos = 0;
+    recorder->file_size = 0;
+    recorder->allocated = 0;
+    recorder->ctx->pb = pb;
+    return true;
 }
+#endif
 
-static const char *
-recorder_get_format_name(enum sc_record_format format) {
-    switch (format) {
-        case SC_RECORD_FORMAT_MP4: return "mp4";
-        case SC_RECORD_FORMAT_MKV: return "matroska";
-        default: return NULL;
+static bool
+recorder_create_output(struct recorder *recorder, const char *filename) {
+    const char *format_name = recorder_get_format_name(recorder->format);
+    assert(format_name);
+    const AVOutputFormat *format = find_muxer(format_name);
+    if (!format) {
+        LOGE("Could not find muxer");
+        return false;
+    }
+
+    recorder->ctx = avformat_alloc_context();
+    if (!recorder->ctx) {
+        LOG_OOM();
+        return false;
+    }
+
+    // contrary to the deprecated API (av_oformat_next()), av_muxer_iterate()
+    // returns (on purpose) a pointer-to-const, but AVFormatContext.oformat
+    // still expects a pointer-to-non-const (it has not be updated accordingly)
+    // <https://github.com/FFmpeg/FFmpeg/commit/0694d8702421e7aff1340038559c438b61bb30dd>
+    recorder->ctx->oformat = (AVOutputFormat *) format;
+
+    av_dict_set(&recorder->ctx->metadata, "comment",
+                "Recorded by scrcpy " SCRCPY_VERSION, 0);
+
+    AVStream *ostream = avformat_new_stream(recorder->ctx, recorder->codec);
+    if (!ostream) {
+        goto error_avformat_free_context;
     }
+
+    ostream->codecpar->codec_type = AVMEDIA_TYPE_VIDEO;
+    ostream->codecpar->codec_id = recorder->codec->id;
+    ostream->codecpar->format = AV_PIX_FMT_YUV420P;
+    ostream->codecpar->width = recorder->declared_frame_size.width;
+    ostream->codecpar->height = recorder->declared_frame_size.height;
+
+    const char *url = filename;
+    if (!strcmp(url, "-")) {
+        // ffmpeg pipe protocol, fd 1 is stdout
+        url = "pipe:1";
+    }
+
+#ifndef _WIN32
+    if (!sc_record_filename_is_pipe(filename)) {
+        // Write regular files directly, with a configurable I/O buffer so
+        // that the muxed packets hit the disk in large batches, and with
+        // file-space preallocation (ffmpeg's file protocol offers neither)
+        if (!recorder_open_file_output(recorder, filename)) {
+            // ostream will be cleaned up during context cleaning
+            goto error_avformat_free_context;
+        }
+        return true;
+    }
+#endif
+
+    int ret = avio_open(&recorder->ctx->pb, url, AVIO_FLAG_WRITE);
+    if (ret < 0) {
+        LOGE("Failed to open output file: %s", filename);
+        // ostream will be cleaned up during context cleaning
+        goto error_avformat_free_context;
+    }
+
+    return true;
+
+error_avformat_free_context:
+    avformat_free_context(recorder->ctx);
+    recorder->ctx = NULL;
+    return false;
+}
+
+static void
+recorder_close_output(struct recorder *recorder) {
+#ifndef _WIN32
+    if (recorder->fd != -1) {
+        AVIOContext *pb = recorder->ctx->pb;
+        avio_flush(pb);
+        av_free(pb->buffer);
+        avio_context_free(&recorder->ctx->pb);
+        if (recorder->allocated > recorder->file_size) {
+            // drop the preallocated space past the bytes actually muxed
+            if (ftruncate(recorder->fd, recorder->file_size) == -1) {
+                LOGW("Could not truncate %s to its real size",
+                     recorder->filename);
+            }
+        }
+        close(recorder->fd);
+        recorder->fd = -1;
+    } else {
+        avio_close(recorder->ctx->pb);
+    }
+#else
+    avio_close(recorder->ctx->pb);
+#endif
+    avformat_free_context(recorder->ctx);
+    recorder->ctx = NULL;
 }
 
 static bool
@@ -93,7 +312,17 @@ recorder_write_header(struct recorder *recorder, const AVPacket *packet) {
     ostream->codecpar->extradata = extradata;
     ostream->codecpar->extradata_size = packet->size;
 
-    int ret = avformat_write_header(recorder->ctx, NULL);
+    AVDictionary *opts = NULL;
+    if (recorder->fragmented
+            && recorder->format == SC_RECORD_FORMAT_MP4) {
+        // write a fragment per keyframe, so that a crash only loses the
+        // fragment being written (the moov atom is written upfront)
+        av_dict_set(&opts, "movflags",
+                    "frag_keyframe+empty_moov+default_base_moof", 0);
+    }
+
+    int ret = avformat_write_header(recorder->ctx, &opts);
+    av_dict_free(&opts);
     if (ret < 0) {
         LOGE("Failed to write header to %s", recorder->filename);
         return false;
@@ -110,110 +339,234 @@ recorder_rescale_packet(struct recorder *recorder, AVPacket *packet) {
 
 static bool
 recorder_write(struct recorder *recorder, AVPacket *packet) {
-    if (!recorder->header_written) {
-        if (packet->pts != AV_NOPTS_VALUE) {
-            LOGE("The first packet is not a config packet");
-            return false;
+    if (packet->pts == AV_NOPTS_VALUE) {
+        if (recorder->segment_duration) {
+            // keep the latest config packet, to replay it as extradata of
+            // the next segments
+            av_packet_free(&recorder->config);
+            recorder->config = av_packet_clone(packet);
+            if (!recorder->config) {
+                LOG_OOM();
+                return false;
+            }
         }
-        bool ok = recorder_write_header(recorder, packet);
-        if (!ok) {
-            return false;
+
+        if (!recorder->header_written) {
+            bool ok = recorder_write_header(recorder, packet);
+            if (!ok) {
+                return false;
+            }
+            recorder->header_written = true;
         }
-        recorder->header_written = true;
+
+        // do not write config packets as frames
         return true;
     }
 
-    if (packet->pts == AV_NOPTS_VALUE) {
-        // ignore config packets
-        return true;
+    if (!recorder->header_written) {
+        LOGE("The first packet is not a config packet");
+        return false;
     }
 
     recorder_rescale_packet(recorder, packet);
-    return av_write_frame(recorder->ctx, packet) >= 0;
+    if (av_write_frame(recorder->ctx, packet) < 0) {
+        return false;
+    }
+
+    if (recorder->fragmented) {
+        // push the muxed data to the output immediately, so that the
+        // on-disk file always ends on a complete fragment/cluster
+        avio_flush(recorder->ctx->pb);
+    }
+
+    return true;
+}
+
+static bool
+recorder_rotate_segment(struct recorder *recorder) {
+    assert(recorder->config);
+
+    int ret = av_write_trailer(recorder->ctx);
+    if (ret < 0) {
+        LOGE("Failed to write trailer to segment %u",
+             recorder->segment_index);
+        return false;
+    }
+
+    recorder_close_output(recorder);
+    recorder->header_written = false;
+
+    char *filename = recorder_build_segment_filename(recorder);
+    if (!filename) {
+        return false;
+    }
+
+    bool ok = recorder_create_output(recorder, filename);
+    if (!ok) {
+        free(filename);
+        return false;
+    }
+
+    ok = recorder_write_header(recorder, recorder->config);
+    if (!ok) {
+        recorder_close_output(recorder);
+        free(filename);
+        return false;
+    }
+    recorder->header_written = true;
+
+    LOGI("Recording rotated to %s", filename);
+    free(filename);
+    return true;
+}
+
+// Rotate to a new segment if the current one lasted long enough, cutting on
+// a keyframe so that every segment starts decodable (no packet is lost)
+static bool
+recorder_maybe_rotate_segment(struct recorder *recorder,
+                              const AVPacket *packet) {
+    if (!recorder->segment_duration || packet->pts == AV_NOPTS_VALUE) {
+        return true;
+    }
+
+    if (recorder->segment_start == AV_NOPTS_VALUE) {
+        recorder->segment_start = packet->pts;
+        return true;
+    }
+
+    if (!(packet->flags & AV_PKT_FLAG_KEY) || !recorder->config) {
+        return true;
+    }
+
+    // both pts and segment_duration are in microseconds
+    if (packet->pts - recorder->segment_start < recorder->segment_duration) {
+        return true;
+    }
+
+    if (!recorder_rotate_segment(recorder)) {
+        return false;
+    }
+
+    recorder->segment_start = packet->pts;
+    return true;
 }
 
 static int
 run_recorder(void *data) {
     struct recorder *recorder = data;
 
-    for (;;) {
-        sc_mutex_lock(&recorder->mutex);
+    sc_thread_apply_role(SC_THREAD_ROLE_IO);
 
-        while (!recorder->stopped && sc_queue_is_empty(&recorder->queue)) {
-            sc_cond_wait(&recorder->queue_cond, &recorder->mutex);
+    for (;;) {
+        AVPacket rec;
+        bool has_rec = sc_ringbuf_take(&recorder->queue, &rec);
+        if (!has_rec) {
+            // the queue looks empty, park until a producer wakes us up
+            sc_mutex_lock(&recorder->mutex);
+            atomic_store_explicit(&recorder->consumer_waiting, true,
+                                  memory_order_relaxed);
+            // make the waiting flag visible before re-checking the queue
+            // (see the matching fence in recorder_push())
+            atomic_thread_fence(memory_order_seq_cst);
+            has_rec = sc_ringbuf_take(&recorder->queue, &rec);
+            while (!has_rec && !atomic_load_explicit(&recorder->stopped,
+                                                     memory_order_relaxed)) {
+                sc_cond_wait(&recorder->queue_cond, &recorder->mutex);
+                has_rec = sc_ringbuf_take(&recorder->queue, &rec);
+            }
+            atomic_store_explicit(&recorder->consumer_waiting, false,
+                                  memory_order_relaxed);
+            sc_mutex_unlock(&recorder->mutex);
         }
 
-        // if stopped is set, continue to process the remaining events (to
+        // if stopped is set, continue to process the remaining packets (to
         // finish the recording) before actually stopping
 
-        if (recorder->stopped && sc_queue_is_empty(&recorder->queue)) {
-            sc_mutex_unlock(&recorder->mutex);
-            struct record_packet *last = recorder->previous;
-            if (last) {
+        if (!has_rec) {
+            // stopped, and the queue is drained
+            if (recorder->has_previous) {
+                AVPacket *last = &recorder->previous;
                 // assign an arbitrary duration to the last packet
-                last->packet->duration = 100000;
-                bool ok = recorder_write(recorder, last->packet);
+                last->duration = 100000;
+                bool ok = recorder_write(recorder, last);
                 if (!ok) {
                     // failing to write the last frame is not very serious, no
                     // future frame may depend on it, so the resulting file
                     // will still be valid
                     LOGW("Could not record last packet");
                 }
-                record_packet_delete(last);
+                av_packet_unref(last);
+                recorder->has_previous = false;
             }
             break;
         }
 
-        struct record_packet *rec;
-        sc_queue_take(&recorder->queue, next, &rec);
-
-        sc_mutex_unlock(&recorder->mutex);
-
-        // recorder->previous is only written from this thread, no need to lock
-        struct record_packet *previous = recorder->previous;
-        recorder->previous = rec;
+        // Make the take visible before reading the producer state (it pairs
+        // with the fence in recorder_push()), then unblock a pusher parked
+        // on a full queue
+        atomic_thread_fence(memory_order_seq_cst);
+        if (atomic_load_explicit(&recorder->producer_waiting,
+                                 memory_order_relaxed)) {
+            sc_mutex_lock(&recorder->mutex);
+            sc_cond_signal(&recorder->push_cond);
+            sc_mutex_unlock(&recorder->mutex);
+        }
 
-        if (!previous) {
+        if (!recorder->has_previous) {
             // we just received the first packet
+            recorder->previous = rec;
+            recorder->has_previous = true;
             continue;
         }
 
+        AVPacket *previous = &recorder->previous;
+
         // config packets have no PTS, we must ignore them
-        if (rec->packet->pts != AV_NOPTS_VALUE
-            && previous->packet->pts != AV_NOPTS_VALUE) {
+        if (rec.pts != AV_NOPTS_VALUE
+            && previous->pts != AV_NOPTS_VALUE) {
             // we now know the duration of the previous packet
-            previous->packet->duration =
-                rec->packet->pts - previous->packet->pts;
+            previous->duration = rec.pts - previous->pts;
         }
 
-        bool ok = recorder_write(recorder, previous->packet);
-        record_packet_delete(previous);
+        bool ok = recorder_maybe_rotate_segment(recorder, previous)
+               && recorder_write(recorder, previous);
+        av_packet_unref(previous);
+        recorder->previous = rec; // take ownership (plain struct copy)
+        if (ok) {
+            sc_stats_add(SC_STAT_PACKETS_RECORDED, 1);
+        }
         if (!ok) {
             LOGE("Could not record packet");
 
-            sc_mutex_lock(&recorder->mutex);
-            recorder->failed = true;
+            atomic_store_explicit(&recorder->failed, true,
+                                  memory_order_relaxed);
             // discard pending packets
             recorder_queue_clear(&recorder->queue);
+            av_packet_unref(&recorder->previous);
+            recorder->has_previous = false;
+            // wake up a pusher blocked on a full queue, it will fail
+            sc_mutex_lock(&recorder->mutex);
+            sc_cond_signal(&recorder->push_cond);
             sc_mutex_unlock(&recorder->mutex);
             break;
         }
     }
 
-    if (!recorder->failed) {
+    bool failed = atomic_load_explicit(&recorder->failed, memory_order_relaxed);
+    if (!failed) {
         if (recorder->header_written) {
             int ret = av_write_trailer(recorder->ctx);
             if (ret < 0) {
                 LOGE("Failed to write trailer to %s", recorder->filename);
-                recorder->failed = true;
+                failed = true;
             }
         } else {
             // the recorded file is empty
-            recorder->failed = true;
+            failed = true;
         }
     }
 
-    if (recorder->failed) {
+    if (failed) {
         LOGE("Recording failed to %s", recorder->filename);
     } else {
         const char *format_name = recorder_get_format_name(recorder->format);
@@ -238,52 +591,40 @@ recorder_open(struct recorder *recorder, const AVCodec *input_codec) {
         goto error_mutex_destroy;
     }
 
-    sc_queue_init(&recorder->queue);
-    recorder->stopped = false;
-    recorder->failed = false;
-    recorder->header_written = false;
-    recorder->previous = NULL;
-
-    const char *format_name = recorder_get_format_name(recorder->format);
-    assert(format_name);
-    const AVOutputFormat *format = find_muxer(format_name);
-    if (!format) {
-        LOGE("Could not find muxer");
-        goto error_cond_destroy;
-    }
-
-    recorder->ctx = avformat_alloc_context();
-    if (!recorder->ctx) {
-        LOG_OOM();
-        goto error_cond_destroy;
+    ok = sc_cond_init(&recorder->push_cond);
+    if (!ok) {
+        goto error_queue_cond_destroy;
     }
 
-    // contrary to the deprecated API (av_oformat_next()), av_muxer_iterate()
-    // returns (on purpose) a pointer-to-const, but AVFormatContext.oformat
-    // still expects a pointer-to-non-const (it has not be updated accordingly)
-    // <https://github.com/FFmpeg/FFmpeg/commit/0694d8702421e7aff1340038559c438b61bb30dd>
-    recorder->ctx->oformat = (AVOutputFormat *) format;
-
-    av_dict_set(&recorder->ctx->metadata, "comment",
-                "Recorded by scrcpy " SCRCPY_VERSION, 0);
+    sc_ringbuf_init(&recorder->queue);
+    atomic_init(&recorder->stopped, false);
+    atomic_init(&recorder->failed, false);
+    atomic_init(&recorder->consumer_waiting, false);
+    atomic_init(&recorder->producer_waiting, false);
+    recorder->header_written = false;
+    recorder->has_previous = false;
+    recorder->codec = input_codec;
+    recorder->config = NULL;
+    recorder->segment_start = AV_NOPTS_VALUE;
+    recorder->segment_index = 0;
+#ifndef _WIN32
+    recorder->fd = -1;
+#endif
 
-    AVStream *ostream = avformat_new_stream(recorder->ctx, input_codec);
-    if (!ostream) {
-        goto error_avformat_free_context;
+    char *segment_filename = NULL;
+    const char *target = recorder->filename;
+    if (recorder->segment_duration) {
+        // number every segment, including the first one
+        segment_filename = recorder_build_segment_filename(recorder);
+        if (!segment_filename) {
+            goto error_cond_destroy;
+        }
+        target = segment_filename;
     }
 
-    ostream->codecpar->codec_type = AVMEDIA_TYPE_VIDEO;
-    ostream->codecpar->codec_id = input_codec->id;
-    ostream->codecpar->format = AV_PIX_FMT_YUV420P;
-    ostream->codecpar->width = recorder->declared_frame_size.width;
-    ostream->codecpar->height = recorder->declared_frame_size.height;
-
-    int ret = avio_open(&recorder->ctx->pb, recorder->filename,
-                        AVIO_FLAG_WRITE);
-    if (ret < 0) {
-        LOGE("Failed to open output file: %s", recorder->filename);
-        // ostream will be cleaned up during context cleaning
-        goto error_avformat_free_context;
+    ok = recorder_create_output(recorder, target);
+    if (!ok) {
+        goto error_free_segment_filename;
     }
 
     LOGD("Starting recorder thread");
@@ -291,18 +632,23 @@ recorder_open(struct recorder *recorder, const AVCodec *input_codec) {
                                recorder);
     if (!ok) {
         LOGC("Could not start recorder thread");
-        goto error_avio_close;
+        goto error_close_output;
     }
 
-    LOGI("Recording started to %s file: %s", format_name, recorder->filename);
+    LOGI("Recording started to %s file: %s",
+         recorder_get_format_name(recorder->format), target);
+
+    free(segment_filename);
 
     return true;
 
-error_avio_close:
-    avio_close(recorder->ctx->pb);
-error_avformat_free_context:
-    avformat_free_context(recorder->ctx);
+error_close_output:
+    recorder_close_output(recorder);
+error_free_segment_filename:
+    free(segment_filename);
 error_cond_destroy:
+    sc_cond_destroy(&recorder->push_cond);
+error_queue_cond_destroy:
     sc_cond_destroy(&recorder->queue_cond);
 error_mutex_destroy:
     sc_mutex_destroy(&recorder->mutex);
@@ -312,41 +658,78 @@ error_mutex_destroy:
 
 static void
 recorder_close(struct recorder *recorder) {
+    atomic_store_explicit(&recorder->stopped, true, memory_order_relaxed);
     sc_mutex_lock(&recorder->mutex);
-    recorder->stopped = true;
     sc_cond_signal(&recorder->queue_cond);
     sc_mutex_unlock(&recorder->mutex);
 
     sc_thread_join(&recorder->thread, NULL);
 
-    avio_close(recorder->ctx->pb);
-    avformat_free_context(recorder->ctx);
+    if (recorder->ctx) {
+        // may be NULL if a segment rotation failed
+        recorder_close_output(recorder);
+    }
+    av_packet_free(&recorder->config);
+    sc_cond_destroy(&recorder->push_cond);
     sc_cond_destroy(&recorder->queue_cond);
     sc_mutex_destroy(&recorder->mutex);
 }
 
 static bool
 recorder_push(struct recorder *recorder, const AVPacket *packet) {
-    sc_mutex_lock(&recorder->mutex);
-    assert(!recorder->stopped);
+    assert(!atomic_load_explicit(&recorder->stopped, memory_order_relaxed));
 
-    if (recorder->failed) {
+    if (atomic_load_explicit(&recorder->failed, memory_order_relaxed)) {
         // reject any new packet (this will stop the stream)
-        sc_mutex_unlock(&recorder->mutex);
         return false;
     }
 
-    struct record_packet *rec = record_packet_new(packet);
-    if (!rec) {
+    // Reference the packet into a local struct, copied by value into a
+    // preallocated ring slot: queuing performs no allocation (the payload
+    // buffers are refcounted and recycled by the stream's packet pool)
+    AVPacket rec;
+    if (av_packet_ref(&rec, packet)) {
         LOG_OOM();
-        sc_mutex_unlock(&recorder->mutex);
         return false;
     }
 
-    sc_queue_push(&recorder->queue, next, rec);
-    sc_cond_signal(&recorder->queue_cond);
+    while (!sc_ringbuf_push(&recorder->queue, rec)) {
+        // Block rather than drop, a recording must not lose packets; the
+        // mutex is only taken to park until the recorder thread consumes a
+        // packet
+        sc_mutex_lock(&recorder->mutex);
+        atomic_store_explicit(&recorder->producer_waiting, true,
+                              memory_order_relaxed);
+        // make the waiting flag visible before re-checking the queue (see
+        // the matching fence in run_recorder())
+        atomic_thread_fence(memory_order_seq_cst);
+        while (!atomic_load_explicit(&recorder->failed, memory_order_relaxed)
+                && sc_ringbuf_is_full(&recorder->queue)) {
+            sc_cond_wait(&recorder->push_cond, &recorder->mutex);
+        }
+        atomic_store_explicit(&recorder->producer_waiting, false,
+                              memory_order_relaxed);
+        sc_mutex_unlock(&recorder->mutex);
+
+        if (atomic_load_explicit(&recorder->failed, memory_order_relaxed)) {
+            av_packet_unref(&rec);
+            return false;
+        }
+    }
+
+    sc_stats_set(SC_STAT_RECORDER_QUEUE, sc_ringbuf_count(&recorder->queue));
+
+    // Make the push visible before reading the consumer state (it pairs with
+    // the fence in run_recorder()), then wake up the recorder thread if it
+    // is parked
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&recorder->consumer_waiting,
+                             memory_order_relaxed)) {
+        sc_mutex_lock(&recorder->mutex);
+        sc_cond_signal(&recorder->queue_cond);
+        sc_mutex_unlock(&recorder->mutex);
+    }
 
-    sc_mutex_unlock(&recorder->mutex);
     return true;
 }
 
@@ -368,10 +751,18 @@ recorder_packet_sink_push(struct sc_packet_sink *sink, const AVPacket *packet) {
     return recorder_push(recorder, packet);
 }
 
+bool
+sc_record_filename_is_pipe(const char *filename) {
+    return !strcmp(filename, "-") || !strncmp(filename, "pipe:", 5);
+}
+
 bool
 recorder_init(struct recorder *recorder,
               const char *filename,
               enum sc_record_format format,
+              bool fragmented,
+              sc_tick segment_duration,
+              size_t io_buffer_size,
               struct sc_size declared_frame_size) {
     recorder->filename = strdup(filename);
     if (!recorder->filename) {
@@ -380,6 +771,9 @@ recorder_init(struct recorder *recorder,
     }
 
     recorder->format = format;
+    recorder->fragmented = fragmented;
+    recorder->segment_duration = segment_duration;
+    recorder->io_buffer_size = io_buffer_size;
     recorder->declared_frame_size = declared_frame_size;
 
     static const struct sc_packet_sink_ops ops = {
@@ -3,48 +3,93 @@
 
 #include "common.h"
 
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <libavformat/avformat.h>
 
 #include "coords.h"
 #include "options.h"
 #include "trait/packet_sink.h"
-#include "util/queue.h"
+#include "util/ringbuf.h"
 #include "util/thread.h"
+#include "util/tick.h"
 
-struct record_packet {
-    AVPacket *packet;
-    struct record_packet *next;
-};
-
-struct recorder_queue SC_QUEUE(struct record_packet);
+// Bounded so that a slow disk applies backpressure to the stream thread
+// instead of consuming memory without limit (the display path drops to the
+// latest frame downstream, so it is not affected by the bound).
+// The slots store the AVPacket structs by value, so queuing a packet
+// performs no allocation (the payload buffers are refcounted)
+struct recorder_queue SC_RINGBUF(AVPacket, 512);
 
 struct recorder {
     struct sc_packet_sink packet_sink; // packet sink trait
 
     char *filename;
     enum sc_record_format format;
+    // write a streaming-safe file (fragmented MP4), any prefix is playable
+    bool fragmented;
+    // rotate to a new file every segment_duration (0 to disable)
+    sc_tick segment_duration;
     AVFormatContext *ctx;
+    const AVCodec *codec;
     struct sc_size declared_frame_size;
     bool header_written;
 
     sc_thread thread;
+    // The ring buffer is lock-free; the mutex and conds only serve to park
+    // and wake the two threads (the recorder on an empty queue, the pusher
+    // on a full queue), never to protect the queue itself
     sc_mutex mutex;
     sc_cond queue_cond;
-    bool stopped; // set on recorder_close()
-    bool failed; // set on packet write failure
+    // signaled when the recorder thread consumes a packet, to wake up a
+    // pusher blocked on a full queue
+    sc_cond push_cond;
+    atomic_bool stopped; // set on recorder_close()
+    atomic_bool failed; // set on packet write failure
+    // each thread publishes that it is about to park, so that the other one
+    // only takes the mutex to wake it up (see controller.c for the pattern)
+    atomic_bool consumer_waiting;
+    atomic_bool producer_waiting;
     struct recorder_queue queue;
 
     // we can write a packet only once we received the next one so that we can
     // set its duration (next_pts - current_pts)
     // "previous" is only accessed from the recorder thread, so it does not
     // need to be protected by the mutex
-    struct record_packet *previous;
+    AVPacket previous;
+    bool has_previous;
+
+    // segment rotation state, only accessed from the recorder thread
+    AVPacket *config; // latest config packet, replayed on each new segment
+    int64_t segment_start; // pts of the first packet of the current segment
+    unsigned segment_index;
+
+    // muxer I/O buffer size, in bytes
+    size_t io_buffer_size;
+#ifndef _WIN32
+    // Direct file output (bypassing ffmpeg's file protocol), so that the
+    // muxed data is written in io_buffer_size batches and the file space
+    // can be preallocated; -1 when writing to a pipe
+    int fd;
+    int64_t write_pos;  // current write offset
+    int64_t file_size;  // highest offset written
+    int64_t allocated;  // bytes preallocated on disk
+#endif
 };
 
+/**
+ * Indicate whether `filename` targets a pipe rather than a regular file
+ *
+ * Either "-" (stdout) or an explicit ffmpeg "pipe:N" URL.
+ */
+bool
+sc_record_filename_is_pipe(const char *filename);
+
 bool
 recorder_init(struct recorder *recorder, const char *filename,
-              enum sc_record_format format, struct sc_size declared_frame_size);
+              enum sc_record_format format, bool fragmented,
+              sc_tick segment_duration, size_t io_buffer_size,
+              struct sc_size declared_frame_size);
 
 void
 recorder_destroy(struct recorder *recorder);
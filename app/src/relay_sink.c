@@ -0,0 +1,434 @@
+#include "relay_sink.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "util/log.h"
+
+/** Downcast packet_sink to sc_relay_sink */
+#define DOWNCAST(SINK) container_of(SINK, struct sc_relay_sink, packet_sink)
+
+static struct sc_relay_packet *
+sc_relay_packet_new(const AVPacket *packet) {
+    struct sc_relay_packet *rel = malloc(sizeof(*rel));
+    if (!rel) {
+        LOG_OOM();
+        return NULL;
+    }
+
+    rel->packet = av_packet_alloc();
+    if (!rel->packet) {
+        LOG_OOM();
+        free(rel);
+        return NULL;
+    }
+
+    if (av_packet_ref(rel->packet, packet)) {
+        av_packet_free(&rel->packet);
+        free(rel);
+        return NULL;
+    }
+    return rel;
+}
+
+static void
+sc_relay_packet_delete(struct sc_relay_packet *rel) {
+    av_packet_free(&rel->packet);
+    free(rel);
+}
+
+static void
+sc_relay_queue_clear(struct sc_relay_sink *rs) {
+    while (!sc_queue_is_empty(&rs->queue)) {
+        struct sc_relay_packet *rel;
+        sc_queue_take(&rs->queue, next, &rel);
+        sc_relay_packet_delete(rel);
+    }
+    rs->queue_size = 0;
+}
+
+// keep a reference on the latest config or keyframe packet
+// (must be called with the mutex locked)
+static void
+sc_relay_cache_packet(AVPacket **cache, const AVPacket *packet) {
+    if (!*cache) {
+        *cache = av_packet_alloc();
+        if (!*cache) {
+            LOG_OOM();
+            // not fatal, the cache is best-effort
+            return;
+        }
+    } else {
+        av_packet_unref(*cache);
+    }
+
+    if (av_packet_ref(*cache, packet)) {
+        av_packet_free(cache);
+        LOG_OOM();
+    }
+}
+
+// remove a client (identified by its socket) and close it
+// (must be called with the mutex locked)
+static void
+sc_relay_sink_remove_client(struct sc_relay_sink *rs, sc_socket socket) {
+    for (unsigned i = 0; i < rs->client_count; ++i) {
+        if (rs->clients[i].socket == socket) {
+            if (rs->clients[i].needs_replay) {
+                --rs->replay_pending;
+            }
+            rs->clients[i] = rs->clients[--rs->client_count];
+            break;
+        }
+    }
+    net_close(socket);
+}
+
+// send state snapshotted under the mutex, used with the mutex released
+struct sc_relay_send {
+    sc_socket socket;
+    bool replay;
+    bool failed;
+};
+
+static int
+run_relay_sink(void *data) {
+    struct sc_relay_sink *rs = data;
+
+    for (;;) {
+        sc_mutex_lock(&rs->mutex);
+
+        while (!rs->stopped && sc_queue_is_empty(&rs->queue)
+                && !rs->replay_pending) {
+            sc_cond_wait(&rs->queue_cond, &rs->mutex);
+        }
+
+        if (rs->stopped) {
+            sc_relay_queue_clear(rs);
+            sc_mutex_unlock(&rs->mutex);
+            break;
+        }
+
+        // Snapshot the client sockets and take references on the packets to
+        // send, then perform the blocking sends with the mutex released: a
+        // stalled client (full TCP send buffer) must never block
+        // sc_relay_sink_push() on the stream thread, otherwise the whole
+        // pipeline would stall and the queue overflow recovery could not
+        // even engage
+        struct sc_relay_send sends[SC_RELAY_MAX_CLIENTS];
+        unsigned count = rs->client_count;
+        bool replay = false;
+        for (unsigned i = 0; i < count; ++i) {
+            sends[i].socket = rs->clients[i].socket;
+            sends[i].replay = rs->clients[i].needs_replay;
+            sends[i].failed = false;
+            replay |= sends[i].replay;
+            rs->clients[i].needs_replay = false;
+        }
+        rs->replay_pending = 0;
+
+        // cached packets to replay to the new clients (best-effort: on OOM,
+        // the client resynchronizes on the next keyframe)
+        AVPacket *config = NULL;
+        AVPacket *keyframe = NULL;
+        if (replay) {
+            if (rs->cached_config) {
+                config = av_packet_clone(rs->cached_config);
+                if (!config) {
+                    LOG_OOM();
+                }
+            }
+            if (rs->cached_keyframe) {
+                keyframe = av_packet_clone(rs->cached_keyframe);
+                if (!keyframe) {
+                    LOG_OOM();
+                }
+            }
+        }
+
+        struct sc_relay_packet *rel = NULL;
+        if (!sc_queue_is_empty(&rs->queue)) {
+            sc_queue_take(&rs->queue, next, &rel);
+            --rs->queue_size;
+        }
+
+        sc_mutex_unlock(&rs->mutex);
+
+        unsigned failed_count = 0;
+        for (unsigned i = 0; i < count; ++i) {
+            struct sc_relay_send *snd = &sends[i];
+            bool ok = true;
+            if (snd->replay) {
+                // send the latest config packet and keyframe first, so that
+                // the new client displays a frame immediately
+                if (config) {
+                    ok = net_send_all(snd->socket, config->data,
+                                      config->size) > 0;
+                }
+                if (ok && keyframe) {
+                    ok = net_send_all(snd->socket, keyframe->data,
+                                      keyframe->size) > 0;
+                }
+            }
+            if (ok && rel) {
+                ok = net_send_all(snd->socket, rel->packet->data,
+                                  rel->packet->size) > 0;
+            }
+            if (!ok) {
+                snd->failed = true;
+                ++failed_count;
+            }
+        }
+
+        av_packet_free(&config);
+        av_packet_free(&keyframe);
+        if (rel) {
+            sc_relay_packet_delete(rel);
+        }
+
+        if (failed_count) {
+            sc_mutex_lock(&rs->mutex);
+            for (unsigned i = 0; i < count; ++i) {
+                if (sends[i].failed) {
+                    LOGD("Relay client disconnected");
+                    sc_relay_sink_remove_client(rs, sends[i].socket);
+                }
+            }
+            sc_mutex_unlock(&rs->mutex);
+        }
+    }
+
+    LOGD("Relay thread ended");
+
+    return 0;
+}
+
+static int
+run_relay_accept(void *data) {
+    struct sc_relay_sink *rs = data;
+
+    for (;;) {
+        sc_socket client = net_accept(rs->server_socket);
+        if (client == SC_SOCKET_NONE) {
+            // interrupted (or error)
+            break;
+        }
+
+        sc_mutex_lock(&rs->mutex);
+        bool stopped = rs->stopped;
+        if (!stopped && rs->client_count < SC_RELAY_MAX_CLIENTS) {
+            // The cached config/keyframe replay is performed by the relay
+            // thread, like every send: a blocking send must not be performed
+            // with the mutex locked, and sending without the mutex would race
+            // with the queued packets
+            struct sc_relay_client *c = &rs->clients[rs->client_count++];
+            c->socket = client;
+            c->needs_replay = true;
+            ++rs->replay_pending;
+            sc_cond_signal(&rs->queue_cond);
+            client = SC_SOCKET_NONE;
+        }
+        sc_mutex_unlock(&rs->mutex);
+
+        if (client != SC_SOCKET_NONE) {
+            // rejected (stopped or too many clients)
+            net_close(client);
+        } else {
+            LOGI("Relay client connected");
+        }
+
+        if (stopped) {
+            break;
+        }
+    }
+
+    LOGD("Relay accept thread ended");
+
+    return 0;
+}
+
+static bool
+sc_relay_sink_open(struct sc_relay_sink *rs) {
+    bool ok = sc_mutex_init(&rs->mutex);
+    if (!ok) {
+        return false;
+    }
+
+    ok = sc_cond_init(&rs->queue_cond);
+    if (!ok) {
+        goto error_mutex_destroy;
+    }
+
+    rs->server_socket = net_socket();
+    if (rs->server_socket == SC_SOCKET_NONE) {
+        goto error_cond_destroy;
+    }
+
+    if (!net_listen(rs->server_socket, IPV4_LOCALHOST, rs->port, 1)) {
+        LOGE("Could not listen on port %" PRIu16 " for relay", rs->port);
+        goto error_close_server_socket;
+    }
+
+    sc_queue_init(&rs->queue);
+    rs->queue_size = 0;
+    rs->waiting_for_key = false;
+    rs->stopped = false;
+    rs->client_count = 0;
+    rs->replay_pending = 0;
+    rs->cached_config = NULL;
+    rs->cached_keyframe = NULL;
+
+    LOGD("Starting relay thread");
+    ok = sc_thread_create(&rs->thread, run_relay_sink, "relay", rs);
+    if (!ok) {
+        LOGC("Could not start relay thread");
+        goto error_close_server_socket;
+    }
+
+    ok = sc_thread_create(&rs->accept_thread, run_relay_accept,
+                          "relay-accept", rs);
+    if (!ok) {
+        LOGC("Could not start relay accept thread");
+        sc_mutex_lock(&rs->mutex);
+        rs->stopped = true;
+        sc_cond_signal(&rs->queue_cond);
+        sc_mutex_unlock(&rs->mutex);
+        sc_thread_join(&rs->thread, NULL);
+        goto error_close_server_socket;
+    }
+
+    LOGI("Relay sink listening on localhost:%" PRIu16, rs->port);
+
+    return true;
+
+error_close_server_socket:
+    net_close(rs->server_socket);
+error_cond_destroy:
+    sc_cond_destroy(&rs->queue_cond);
+error_mutex_destroy:
+    sc_mutex_destroy(&rs->mutex);
+
+    return false;
+}
+
+static void
+sc_relay_sink_close(struct sc_relay_sink *rs) {
+    sc_mutex_lock(&rs->mutex);
+    rs->stopped = true;
+    sc_cond_signal(&rs->queue_cond);
+    sc_mutex_unlock(&rs->mutex);
+
+    // wake up the blocking accept()
+    net_interrupt(rs->server_socket);
+
+    sc_thread_join(&rs->thread, NULL);
+    sc_thread_join(&rs->accept_thread, NULL);
+
+    for (unsigned i = 0; i < rs->client_count; ++i) {
+        net_close(rs->clients[i].socket);
+    }
+    net_close(rs->server_socket);
+
+    if (rs->cached_config) {
+        av_packet_free(&rs->cached_config);
+    }
+    if (rs->cached_keyframe) {
+        av_packet_free(&rs->cached_keyframe);
+    }
+    sc_cond_destroy(&rs->queue_cond);
+    sc_mutex_destroy(&rs->mutex);
+}
+
+static bool
+sc_relay_sink_push(struct sc_relay_sink *rs, const AVPacket *packet) {
+    bool is_config = packet->pts == AV_NOPTS_VALUE;
+    bool is_key = packet->flags & AV_PKT_FLAG_KEY;
+
+    sc_mutex_lock(&rs->mutex);
+    assert(!rs->stopped);
+
+    if (is_config) {
+        sc_relay_cache_packet(&rs->cached_config, packet);
+    } else if (is_key) {
+        sc_relay_cache_packet(&rs->cached_keyframe, packet);
+    }
+
+    if (!rs->client_count) {
+        // no consumers, nothing to queue
+        sc_mutex_unlock(&rs->mutex);
+        return true;
+    }
+
+    if (rs->queue_size >= SC_RELAY_MAX_QUEUED) {
+        // a client stalls, drop the queued packets and resynchronize on the
+        // next keyframe
+        LOGW("Relay queue overflow, waiting for the next keyframe");
+        sc_relay_queue_clear(rs);
+        rs->waiting_for_key = true;
+    }
+
+    if (rs->waiting_for_key) {
+        if (!is_config && !is_key) {
+            sc_mutex_unlock(&rs->mutex);
+            return true;
+        }
+        if (is_key) {
+            rs->waiting_for_key = false;
+        }
+    }
+
+    struct sc_relay_packet *rel = sc_relay_packet_new(packet);
+    if (!rel) {
+        sc_mutex_unlock(&rs->mutex);
+        // failing to relay a packet must not stop the whole pipeline
+        return true;
+    }
+
+    sc_queue_push(&rs->queue, next, rel);
+    ++rs->queue_size;
+    sc_cond_signal(&rs->queue_cond);
+
+    sc_mutex_unlock(&rs->mutex);
+
+    return true;
+}
+
+static bool
+sc_relay_packet_sink_open(struct sc_packet_sink *sink, const AVCodec *codec) {
+    (void) codec;
+    struct sc_relay_sink *rs = DOWNCAST(sink);
+    return sc_relay_sink_open(rs);
+}
+
+static void
+sc_relay_packet_sink_close(struct sc_packet_sink *sink) {
+    struct sc_relay_sink *rs = DOWNCAST(sink);
+    sc_relay_sink_close(rs);
+}
+
+static bool
+sc_relay_packet_sink_push(struct sc_packet_sink *sink,
+                          const AVPacket *packet) {
+    struct sc_relay_sink *rs = DOWNCAST(sink);
+    return sc_relay_sink_push(rs, packet);
+}
+
+bool
+sc_relay_sink_init(struct sc_relay_sink *rs, uint16_t port) {
+    rs->port = port;
+
+    static const struct sc_packet_sink_ops ops = {
+        .open = sc_relay_packet_sink_open,
+        .close = sc_relay_packet_sink_close,
+        .push = sc_relay_packet_sink_push,
+    };
+
+    rs->packet_sink.ops = &ops;
+
+    return true;
+}
+
+void
+sc_relay_sink_destroy(struct sc_relay_sink *rs) {
+    (void) rs;
+}
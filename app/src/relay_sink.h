@@ -0,0 +1,74 @@
+#ifndef SC_RELAY_SINK_H
+#define SC_RELAY_SINK_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <libavformat/avformat.h>
+
+#include "trait/packet_sink.h"
+#include "util/net.h"
+#include "util/queue.h"
+#include "util/thread.h"
+
+#define SC_RELAY_MAX_CLIENTS 4
+// limit the number of queued packets if a client stalls
+#define SC_RELAY_MAX_QUEUED 64
+
+struct sc_relay_packet {
+    AVPacket *packet;
+    struct sc_relay_packet *next;
+};
+
+struct sc_relay_queue SC_QUEUE(struct sc_relay_packet);
+
+struct sc_relay_client {
+    sc_socket socket;
+    // the initial config/keyframe replay has not been sent yet (it is
+    // performed by the relay thread, like every send)
+    bool needs_replay;
+};
+
+/**
+ * Re-serve the received H.264 stream (raw Annex B) over a local TCP socket,
+ * so that additional viewers can mirror the device without a second device
+ * encode.
+ *
+ * New clients first receive the latest config packet and keyframe, so they
+ * display a frame immediately.
+ */
+struct sc_relay_sink {
+    struct sc_packet_sink packet_sink; // packet sink trait
+
+    uint16_t port;
+
+    sc_thread thread; // send the queued packets to the clients
+    sc_thread accept_thread;
+    // protects all the fields below; the blocking sends themselves are
+    // performed by the relay thread with the mutex released, so that a
+    // stalled client never blocks the push from the stream thread
+    sc_mutex mutex;
+    sc_cond queue_cond;
+    bool stopped;
+    struct sc_relay_queue queue;
+    size_t queue_size;
+    // after a queue overflow, drop packets until the next keyframe
+    bool waiting_for_key;
+
+    sc_socket server_socket;
+    struct sc_relay_client clients[SC_RELAY_MAX_CLIENTS];
+    unsigned client_count;
+    unsigned replay_pending; // clients with needs_replay set
+
+    // latest config packet and keyframe, sent first to new clients
+    AVPacket *cached_config;
+    AVPacket *cached_keyframe;
+};
+
+bool
+sc_relay_sink_init(struct sc_relay_sink *rs, uint16_t port);
+
+void
+sc_relay_sink_destroy(struct sc_relay_sink *rs);
+
+#endif
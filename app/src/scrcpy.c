@@ -1,5 +1,6 @@
 #include "scrcpy.h"
 
+#include <inttypes.h>
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
@@ -13,37 +14,68 @@
 # include <windows.h>
 #endif
 
+#include "audio_player.h"
 #include "controller.h"
 #include "decoder.h"
 #include "events.h"
 #include "file_handler.h"
 #include "input_manager.h"
 #ifdef HAVE_AOA_HID
+# include "hid_gamepad.h"
 # include "hid_keyboard.h"
+# include "hid_mouse.h"
 #endif
 #include "keyboard_inject.h"
 #include "mouse_inject.h"
 #include "recorder.h"
+#include "relay_sink.h"
 #include "screen.h"
+#include "screenshot.h"
 #include "server.h"
 #include "stream.h"
+#include "thumbnail_sink.h"
 #include "util/acksync.h"
 #include "util/log.h"
+#include "util/memory_budget.h"
 #include "util/net.h"
+#include "util/stats.h"
+#include "util/thread.h"
+#include "util/trace.h"
 #ifdef HAVE_V4L2
 # include "v4l2_sink.h"
 #endif
 
 struct scrcpy {
+    // memory accounting shared by the buffering pools
+    struct sc_memory_budget memory_budget;
     struct sc_server server;
     struct screen screen;
+    // one extra screen/decoder per secondary display
+    struct screen secondary_screens[SC_MAX_SECONDARY_DISPLAYS];
+    struct decoder secondary_decoders[SC_MAX_SECONDARY_DISPLAYS];
+    unsigned secondary_screen_count;
+    // one extra view-only pipeline per additional mirrored device (--mirror),
+    // sharing the SDL initialization and the event loop with the primary
+    struct sc_server mirror_servers[SC_MAX_MIRROR_DEVICES];
+    struct stream mirror_streams[SC_MAX_MIRROR_DEVICES];
+    struct decoder mirror_decoders[SC_MAX_MIRROR_DEVICES];
+    struct screen mirror_screens[SC_MAX_MIRROR_DEVICES];
+    unsigned mirror_screen_count;
     struct stream stream;
     struct decoder decoder;
+    struct sc_audio_player audio_player;
     struct recorder recorder;
 #ifdef HAVE_V4L2
     struct sc_v4l2_sink v4l2_sink;
 #endif
+    struct sc_thumbnail_sink thumbnail_sink;
+    struct sc_relay_sink relay_sink;
     struct controller controller;
+    // Adaptive video bitrate state (see stream_on_congestion()): the current
+    // requested bitrate (0 if adaptation is disabled) and the startup value
+    // it may recover to
+    uint32_t video_bit_rate;
+    uint32_t configured_bit_rate;
     struct file_handler file_handler;
 #ifdef HAVE_AOA_HID
     struct sc_aoa aoa;
@@ -56,7 +88,16 @@ struct scrcpy {
         struct sc_hid_keyboard keyboard_hid;
 #endif
     };
-    struct sc_mouse_inject mouse_inject;
+#ifdef HAVE_AOA_HID
+    struct sc_hid_gamepad gamepad_hid;
+#endif
+    union {
+        struct sc_mouse_inject mouse_inject;
+#ifdef HAVE_AOA_HID
+        struct sc_hid_mouse mouse_hid;
+#endif
+    };
+    struct sc_screenshot screenshot;
     struct input_manager input_manager;
 };
 
@@ -158,6 +199,55 @@ enum event_result {
     EVENT_RESULT_STOPPED_BY_EOS,
 };
 
+static bool
+event_get_window_id(const SDL_Event *event, uint32_t *window_id) {
+    switch (event->type) {
+        case SDL_KEYDOWN:
+        case SDL_KEYUP:
+            *window_id = event->key.windowID;
+            return true;
+        case SDL_TEXTINPUT:
+            *window_id = event->text.windowID;
+            return true;
+        case SDL_MOUSEMOTION:
+            *window_id = event->motion.windowID;
+            return true;
+        case SDL_MOUSEBUTTONDOWN:
+        case SDL_MOUSEBUTTONUP:
+            *window_id = event->button.windowID;
+            return true;
+        case SDL_MOUSEWHEEL:
+            *window_id = event->wheel.windowID;
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool
+event_from_secondary_window(struct scrcpy *s, const SDL_Event *event) {
+    uint32_t window_id;
+    if (!event_get_window_id(event, &window_id)) {
+        return false;
+    }
+
+    for (unsigned i = 0; i < s->secondary_screen_count; ++i) {
+        struct screen *screen = &s->secondary_screens[i];
+        if (window_id == SDL_GetWindowID(screen->window)) {
+            return true;
+        }
+    }
+
+    for (unsigned i = 0; i < s->mirror_screen_count; ++i) {
+        struct screen *screen = &s->mirror_screens[i];
+        if (window_id == SDL_GetWindowID(screen->window)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 static enum event_result
 handle_event(struct scrcpy *s, const struct scrcpy_options *options,
              SDL_Event *event) {
@@ -165,6 +255,14 @@ handle_event(struct scrcpy *s, const struct scrcpy_options *options,
         case EVENT_STREAM_STOPPED:
             LOGD("Video stream stopped");
             return EVENT_RESULT_STOPPED_BY_EOS;
+        case EVENT_MIRROR_STREAM_STOPPED: {
+            // a mirrored device disconnecting does not end the session
+            uintptr_t index = (uintptr_t) event->user.data1;
+            assert(index < s->mirror_screen_count);
+            LOGW("Mirror device disconnected");
+            screen_hide_window(&s->mirror_screens[index]);
+            return EVENT_RESULT_CONTINUE;
+        }
         case SDL_QUIT:
             LOGD("User requested to quit");
             return EVENT_RESULT_STOPPED_BY_USER;
@@ -191,10 +289,22 @@ handle_event(struct scrcpy *s, const struct scrcpy_options *options,
     }
 
     bool consumed = screen_handle_event(&s->screen, event);
+    for (unsigned i = 0; !consumed && i < s->secondary_screen_count; ++i) {
+        consumed = screen_handle_event(&s->secondary_screens[i], event);
+    }
+    for (unsigned i = 0; !consumed && i < s->mirror_screen_count; ++i) {
+        consumed = screen_handle_event(&s->mirror_screens[i], event);
+    }
     if (consumed) {
         goto end;
     }
 
+    if (event_from_secondary_window(s, event)) {
+        // input events from secondary or mirror windows must not be injected
+        // into the primary display
+        goto end;
+    }
+
     consumed = input_manager_handle_event(&s->input_manager, event);
     (void) consumed;
 
@@ -221,7 +331,7 @@ event_loop(struct scrcpy *s, const struct scrcpy_options *options) {
 }
 
 static bool
-await_for_server(void) {
+await_for_server(unsigned count) {
     SDL_Event event;
     while (SDL_WaitEvent(&event)) {
         switch (event.type) {
@@ -233,7 +343,10 @@ await_for_server(void) {
                 return false;
             case EVENT_SERVER_CONNECTED:
                 LOGD("Server connected");
-                return true;
+                if (!--count) {
+                    return true;
+                }
+                break;
             default:
                 break;
         }
@@ -280,6 +393,12 @@ av_log_callback(void *avcl, int level, const char *fmt, va_list vl) {
     free(local_fmt);
 }
 
+static bool
+control_socket_on_readable(void *userdata) {
+    struct receiver *receiver = userdata;
+    return receiver_on_readable(receiver);
+}
+
 static void
 stream_on_eos(struct stream *stream, void *userdata) {
     (void) stream;
@@ -288,6 +407,84 @@ stream_on_eos(struct stream *stream, void *userdata) {
     PUSH_EVENT(EVENT_STREAM_STOPPED);
 }
 
+static void
+mirror_stream_on_eos(struct stream *stream, void *userdata) {
+    (void) stream;
+
+    SDL_Event event;
+    event.type = EVENT_MIRROR_STREAM_STOPPED;
+    event.user.data1 = userdata; // the mirror index
+    int ret = SDL_PushEvent(&event);
+    if (ret < 0) {
+        LOGE("Could not post EVENT_MIRROR_STREAM_STOPPED event: %s",
+             SDL_GetError());
+    }
+}
+
+static enum AVCodecID
+codec_to_avcodec_id(enum sc_codec codec) {
+    switch (codec) {
+        case SC_CODEC_H265:
+            return AV_CODEC_ID_HEVC;
+        case SC_CODEC_AV1:
+            return AV_CODEC_ID_AV1;
+        default:
+            return AV_CODEC_ID_H264;
+    }
+}
+
+// lower bound of the adaptive bitrate, the stream must remain usable
+#define SC_ADAPTIVE_BIT_RATE_MIN 250000
+
+// Adapt the video bitrate to the observed congestion: back off quickly while
+// the receive timing lags behind the capture timing, then recover gradually
+// (in steps, at most once per second) once it has caught up. The device
+// applies the new rate to the running encoder without restarting it.
+static void
+stream_on_congestion(struct stream *stream, bool congested, void *userdata) {
+    (void) stream;
+    struct scrcpy *s = userdata;
+
+    uint32_t rate = s->video_bit_rate;
+    if (!rate) {
+        // no control socket, bitrate adaptation disabled
+        return;
+    }
+
+    if (congested) {
+        rate = rate * 3 / 4;
+        if (rate < SC_ADAPTIVE_BIT_RATE_MIN) {
+            rate = SC_ADAPTIVE_BIT_RATE_MIN;
+        }
+    } else {
+        rate += s->configured_bit_rate / 8;
+        if (rate > s->configured_bit_rate) {
+            rate = s->configured_bit_rate;
+        }
+    }
+
+    if (rate == s->video_bit_rate) {
+        return;
+    }
+
+    struct control_msg msg;
+    msg.type = CONTROL_MSG_TYPE_SET_BITRATE;
+    msg.set_bitrate.bit_rate = rate;
+    if (!controller_push_msg(&s->controller, &msg)) {
+        LOGW("Could not request 'set bitrate'");
+        return;
+    }
+
+    s->video_bit_rate = rate;
+    if (congested) {
+        LOGI("Congestion detected, video bitrate lowered to %" PRIu32 " bps",
+             rate);
+    } else {
+        LOGD("Congestion cleared, video bitrate raised to %" PRIu32 " bps",
+             rate);
+    }
+}
+
 static void
 sc_server_on_connection_failed(struct sc_server *server, void *userdata) {
     (void) server;
@@ -314,7 +511,7 @@ sc_server_on_disconnected(struct sc_server *server, void *userdata) {
     // event
 }
 
-bool
+enum scrcpy_exit
 scrcpy(struct scrcpy_options *options) {
     static struct scrcpy scrcpy;
     struct scrcpy *s = &scrcpy;
@@ -322,12 +519,51 @@ scrcpy(struct scrcpy_options *options) {
     // Minimal SDL initialization
     if (SDL_Init(SDL_INIT_EVENTS)) {
         LOGC("Could not initialize SDL: %s", SDL_GetError());
-        return false;
+        return SCRCPY_EXIT_FAILURE;
     }
 
     atexit(SDL_Quit);
 
-    bool ret = false;
+    // Configure the scheduling of the session threads before any of them
+    // starts
+    enum sc_thread_priority display_priority = options->prioritize_display
+                                             ? SC_THREAD_PRIORITY_HIGH
+                                             : SC_THREAD_PRIORITY_NORMAL;
+    enum sc_thread_priority io_priority = options->prioritize_display
+                                        ? SC_THREAD_PRIORITY_LOW
+                                        : SC_THREAD_PRIORITY_NORMAL;
+    sc_thread_role_configure(SC_THREAD_ROLE_RENDER, display_priority,
+                             options->cpu_affinity);
+    sc_thread_role_configure(SC_THREAD_ROLE_DECODE, display_priority,
+                             options->cpu_affinity);
+    sc_thread_role_configure(SC_THREAD_ROLE_IO, io_priority,
+                             options->cpu_affinity);
+    sc_thread_role_configure(SC_THREAD_ROLE_CONTROL, SC_THREAD_PRIORITY_NORMAL,
+                             options->cpu_affinity);
+    // the main thread runs the event loop and the renderer
+    sc_thread_apply_role(SC_THREAD_ROLE_RENDER);
+
+    if (options->trace_file && !sc_trace_init(options->trace_file)) {
+        // tracing is a diagnostic tool, do not abort the session
+        LOGW("Tracing disabled");
+    }
+
+    if (options->stats_interval
+            && !sc_stats_logger_start(options->stats_interval)) {
+        // statistics are a diagnostic tool, do not abort the session
+        LOGW("Stats logging disabled");
+    }
+
+    enum scrcpy_exit ret = SCRCPY_EXIT_FAILURE;
+
+    if (!sc_memory_budget_init(&s->memory_budget, options->memory_budget)) {
+        return ret;
+    }
+
+    // the struct is static (so zero-initialized), but scrcpy() may be called
+    // several times on --auto-reconnect
+    s->secondary_screen_count = 0;
+    s->mirror_screen_count = 0;
 
     bool server_started = false;
     bool file_handler_initialized = false;
@@ -335,16 +571,50 @@ scrcpy(struct scrcpy_options *options) {
 #ifdef HAVE_V4L2
     bool v4l2_sink_initialized = false;
 #endif
+    bool thumbnail_sink_initialized = false;
+    bool relay_sink_initialized = false;
+    bool stream_initialized = false;
     bool stream_started = false;
 #ifdef HAVE_AOA_HID
     bool aoa_hid_initialized = false;
+    bool hid_keyboard_initialized = false;
+    bool hid_mouse_initialized = false;
+    bool hid_gamepad_initialized = false;
 #endif
     bool controller_initialized = false;
     bool controller_started = false;
     bool screen_initialized = false;
+    bool screenshot_initialized = false;
+    unsigned mirror_server_count = 0; // servers initialized and started
+    unsigned mirror_stream_init_count = 0;
+    unsigned mirror_stream_started_count = 0;
+    bool audio_player_initialized = false;
+
+    // window and renderer created while the server connection is in progress
+    struct screen_prewarm prewarm = {0};
 
     struct sc_acksync *acksync = NULL;
 
+    // in replay mode, no server is started: the stream is read from a dump
+    // file instead of the video socket
+    bool replay = !!options->stream_replay_filename;
+
+    // The frame meta headers (PTS, packet boundaries, display index) are only
+    // needed by sinks that record, buffer or demultiplex the stream; for pure
+    // live mirroring, receive the raw encoder output instead, to skip one
+    // header per packet on both ends
+    bool raw_stream = !replay
+                   && !options->record_filename
+                   && !options->stream_dump_filename
+                   && !options->relay_port
+                   && !options->thumbnail_port
+                   && !options->display_buffer
+                   && !options->display_buffer_auto
+#ifdef HAVE_V4L2
+                   && !options->v4l2_device
+#endif
+                   && !options->secondary_display_count;
+
     struct sc_server_params params = {
         .serial = options->serial,
         .log_level = options->log_level,
@@ -354,17 +624,25 @@ scrcpy(struct scrcpy_options *options) {
         .tunnel_port = options->tunnel_port,
         .max_size = options->max_size,
         .bit_rate = options->bit_rate,
+        .codec = options->codec,
         .max_fps = options->max_fps,
         .lock_video_orientation = options->lock_video_orientation,
         .control = options->control,
+        .audio = options->audio,
         .display_id = options->display_id,
+        .secondary_display_ids = options->secondary_display_ids,
+        .secondary_display_count = options->secondary_display_count,
         .show_touches = options->show_touches,
         .stay_awake = options->stay_awake,
         .codec_options = options->codec_options,
         .encoder_name = options->encoder_name,
         .force_adb_forward = options->force_adb_forward,
+        .daemon = options->daemon,
+        .direct_tcp_port = options->direct_tcp_port,
+        .tcp_rcvbuf = options->tcp_rcvbuf,
         .power_off_on_close = options->power_off_on_close,
         .clipboard_autosync = options->clipboard_autosync,
+        .send_frame_meta = !raw_stream,
         .tcpip = options->tcpip,
         .tcpip_dst = options->tcpip_dst,
     };
@@ -374,15 +652,41 @@ scrcpy(struct scrcpy_options *options) {
         .on_connected = sc_server_on_connected,
         .on_disconnected = sc_server_on_disconnected,
     };
-    if (!sc_server_init(&s->server, &params, &cbs, NULL)) {
-        return false;
-    }
+    if (!replay) {
+        if (!sc_server_init(&s->server, &params, &cbs, NULL)) {
+            sc_memory_budget_destroy(&s->memory_budget);
+            return SCRCPY_EXIT_FAILURE;
+        }
 
-    if (!sc_server_start(&s->server)) {
-        goto end;
-    }
+        if (!sc_server_start(&s->server)) {
+            goto end;
+        }
 
-    server_started = true;
+        server_started = true;
+
+        // connect all the mirrored devices concurrently with the primary
+        for (unsigned i = 0; i < options->mirror_count; ++i) {
+            struct sc_server_params mirror_params = params;
+            mirror_params.serial = options->mirror_serials[i];
+            // mirrored devices are view-only and muted
+            mirror_params.control = false;
+            mirror_params.audio = false;
+            mirror_params.secondary_display_ids = NULL;
+            mirror_params.secondary_display_count = 0;
+            mirror_params.tcpip = false;
+            mirror_params.tcpip_dst = NULL;
+
+            struct sc_server *mirror = &s->mirror_servers[i];
+            if (!sc_server_init(mirror, &mirror_params, &cbs, NULL)) {
+                goto end;
+            }
+            if (!sc_server_start(mirror)) {
+                sc_server_destroy(mirror);
+                goto end;
+            }
+            ++mirror_server_count;
+        }
+    }
 
     if (options->display) {
         sdl_set_hints(options->render_driver);
@@ -394,18 +698,65 @@ scrcpy(struct scrcpy_options *options) {
         goto end;
     }
 
+    if (options->hid_gamepad && SDL_Init(SDL_INIT_GAMECONTROLLER)) {
+        LOGE("Could not initialize SDL game controller subsystem: %s "
+             "(-G/--hid-gamepad ignored)", SDL_GetError());
+        options->hid_gamepad = false;
+    }
+
+    if (options->audio && SDL_Init(SDL_INIT_AUDIO)) {
+        LOGE("Could not initialize SDL audio subsystem: %s "
+             "(--audio ignored)", SDL_GetError());
+        options->audio = false;
+    }
+
     sdl_configure(options->display, options->disable_screensaver);
 
-    // Await for server without blocking Ctrl+C handling
-    if (!await_for_server()) {
+    if (options->display && !replay) {
+        // overlap the window, renderer and GL context creation with the
+        // server connection; screen_init() adopts the result once the device
+        // size is received
+        screen_prewarm(&prewarm, options->always_on_top,
+                       options->window_borderless);
+    }
+
+    // Await for all the servers without blocking Ctrl+C handling
+    if (!replay && !await_for_server(1 + options->mirror_count)) {
         goto end;
     }
 
-    // It is necessarily initialized here, since the device is connected
+    // It is necessarily initialized here, since the device is connected (in
+    // replay mode, it is filled below from the dump file header)
     struct sc_server_info *info = &s->server.info;
 
-    const char *serial = s->server.params.serial;
-    assert(serial);
+    const char *serial = NULL;
+    if (!replay) {
+        serial = s->server.params.serial;
+        assert(serial);
+    }
+
+    static const struct stream_callbacks stream_cbs = {
+        .on_eos = stream_on_eos,
+        .on_congestion = stream_on_congestion,
+    };
+
+    unsigned substream_count = 1 + options->secondary_display_count;
+    if (replay) {
+        struct sc_size frame_sizes[STREAM_MAX_SUBSTREAMS];
+        if (!stream_init_replay(&s->stream, options->stream_replay_filename,
+                                options->stream_replay_fast, frame_sizes,
+                                &substream_count, &stream_cbs, s)) {
+            goto end;
+        }
+        stream_initialized = true;
+
+        // expose the recorded sizes as if they were received from the device
+        info->frame_size = frame_sizes[0];
+        for (unsigned i = 1; i < substream_count; ++i) {
+            info->secondary_frame_sizes[i - 1] = frame_sizes[i];
+        }
+        memcpy(info->device_name, "replay", sizeof("replay"));
+    }
 
     if (options->display && options->control) {
         if (!file_handler_init(&s->file_handler, serial,
@@ -420,8 +771,12 @@ scrcpy(struct scrcpy_options *options) {
 #ifdef HAVE_V4L2
     needs_decoder |= !!options->v4l2_device;
 #endif
+    needs_decoder |= !!options->thumbnail_port;
     if (needs_decoder) {
-        decoder_init(&s->decoder);
+        decoder_init(&s->decoder,
+                     options->control ? &s->controller : NULL,
+                     options->decoder_threads,
+                     options->decoder_frame_threading, options->hwdec);
         dec = &s->decoder;
     }
 
@@ -430,6 +785,9 @@ scrcpy(struct scrcpy_options *options) {
         if (!recorder_init(&s->recorder,
                            options->record_filename,
                            options->record_format,
+                           options->record_fragmented,
+                           options->record_segment,
+                           options->record_io_buffer,
                            info->frame_size)) {
             goto end;
         }
@@ -439,22 +797,61 @@ scrcpy(struct scrcpy_options *options) {
 
     av_log_set_callback(av_log_callback);
 
-    static const struct stream_callbacks stream_cbs = {
-        .on_eos = stream_on_eos,
-    };
-    stream_init(&s->stream, s->server.video_socket, &stream_cbs, NULL);
+    if (!replay) {
+        if (!stream_init(&s->stream, s->server.video_socket, substream_count,
+                         &stream_cbs, s)) {
+            goto end;
+        }
+        stream_initialized = true;
+
+        if (raw_stream) {
+            stream_set_raw(&s->stream);
+        }
+
+        if (options->stream_dump_filename) {
+            struct sc_size frame_sizes[STREAM_MAX_SUBSTREAMS];
+            frame_sizes[0] = info->frame_size;
+            for (unsigned i = 1; i < substream_count; ++i) {
+                frame_sizes[i] = info->secondary_frame_sizes[i - 1];
+            }
+            if (!stream_set_dump(&s->stream, options->stream_dump_filename,
+                                 frame_sizes, substream_count)) {
+                goto end;
+            }
+        }
+    }
+
+    stream_set_codec(&s->stream, codec_to_avcodec_id(options->codec));
 
     if (dec) {
-        stream_add_sink(&s->stream, &dec->packet_sink);
+        stream_add_sink(&s->stream, 0, &dec->packet_sink);
     }
 
     if (rec) {
-        stream_add_sink(&s->stream, &rec->packet_sink);
+        stream_add_sink(&s->stream, 0, &rec->packet_sink);
+    }
+
+    if (options->relay_port) {
+        if (!sc_relay_sink_init(&s->relay_sink, options->relay_port)) {
+            goto end;
+        }
+
+        stream_add_sink(&s->stream, 0, &s->relay_sink.packet_sink);
+
+        relay_sink_initialized = true;
+    }
+
+    if (!dec && !raw_stream) {
+        // Record-only (or relay-only) session: no packet is ever decoded, so
+        // hand the packets straight to the sinks, without the config/keyframe
+        // merging that only decoders require
+        stream_set_pass_through(&s->stream);
     }
 
     if (options->control) {
 #ifdef HAVE_AOA_HID
-        if (options->keyboard_input_mode == SC_KEYBOARD_INPUT_MODE_HID) {
+        if (options->keyboard_input_mode == SC_KEYBOARD_INPUT_MODE_HID
+                || options->hid_gamepad) {
             bool ok = sc_acksync_init(&s->acksync);
             if (!ok) {
                 goto end;
@@ -474,6 +871,19 @@ scrcpy(struct scrcpy_options *options) {
         }
         controller_started = true;
 
+        // the receiver has no dedicated thread, service the control socket
+        // from the stream thread
+        stream_set_aux_socket(&s->stream, s->server.control_socket,
+                              control_socket_on_readable,
+                              &s->controller.receiver);
+
+        if (!raw_stream) {
+            // enable bitrate adaptation (in raw mode, the stream provides no
+            // timing information to measure congestion from)
+            s->configured_bit_rate = options->bit_rate;
+            s->video_bit_rate = options->bit_rate;
+        }
+
         if (options->turn_screen_off) {
             struct control_msg msg;
             msg.type = CONTROL_MSG_TYPE_SET_SCREEN_POWER_MODE;
@@ -490,6 +900,7 @@ scrcpy(struct scrcpy_options *options) {
             options->window_title ? options->window_title : info->device_name;
 
         struct screen_params screen_params = {
+            .serial = serial,
             .window_title = window_title,
             .frame_size = info->frame_size,
             .always_on_top = options->always_on_top,
@@ -502,6 +913,14 @@ scrcpy(struct scrcpy_options *options) {
             .mipmaps = options->mipmaps,
             .fullscreen = options->fullscreen,
             .buffering_time = options->display_buffer,
+            .buffering_auto = options->display_buffer_auto,
+            .controller = options->control ? &s->controller : NULL,
+            .dynamic_max_size = options->dynamic_max_size,
+            .max_size = options->max_size,
+            .max_fps = options->max_fps,
+            .max_fps_unfocused = options->max_fps_unfocused,
+            .print_latency = options->print_latency,
+            .prewarm = &prewarm,
         };
 
         if (!screen_init(&s->screen, &screen_params)) {
@@ -510,6 +929,126 @@ scrcpy(struct scrcpy_options *options) {
         screen_initialized = true;
 
         decoder_add_sink(&s->decoder, &s->screen.frame_sink);
+
+        // one additional window per secondary display (in replay mode, the
+        // substreams come from the dump file, not from --display)
+        for (unsigned i = 0; i + 1 < substream_count; ++i) {
+            struct decoder *sec_dec = &s->secondary_decoders[i];
+            // control requests are sent for the primary stream only
+            decoder_init(sec_dec, NULL, options->decoder_threads,
+                         options->decoder_frame_threading, options->hwdec);
+            stream_add_sink(&s->stream, 1 + i, &sec_dec->packet_sink);
+
+            uint32_t sec_display_id =
+                replay ? i + 1 : options->secondary_display_ids[i];
+            char *sec_title = NULL;
+            if (asprintf(&sec_title, "%s - display %" PRIu32, window_title,
+                         sec_display_id) == -1) {
+                LOG_OOM();
+                goto end;
+            }
+
+            struct screen_params sec_params = {
+                // no window geometry persistence (it is keyed by serial)
+                .serial = NULL,
+                .window_title = sec_title,
+                .frame_size = info->secondary_frame_sizes[i],
+                .always_on_top = options->always_on_top,
+                .window_x = SC_WINDOW_POSITION_UNDEFINED,
+                .window_y = SC_WINDOW_POSITION_UNDEFINED,
+                .window_width = 0,
+                .window_height = 0,
+                .window_borderless = options->window_borderless,
+                .rotation = 0,
+                .mipmaps = options->mipmaps,
+                .fullscreen = false,
+                .buffering_time = options->display_buffer,
+                .buffering_auto = options->display_buffer_auto,
+                // input and stream adaptation only apply to the primary
+                // display
+                .controller = NULL,
+                .dynamic_max_size = false,
+                .max_size = options->max_size,
+                .max_fps = 0,
+                .max_fps_unfocused = 0,
+            };
+
+            bool sec_ok = screen_init(&s->secondary_screens[i], &sec_params);
+            // the title is copied by SDL
+            free(sec_title);
+            if (!sec_ok) {
+                goto end;
+            }
+            ++s->secondary_screen_count;
+
+            decoder_add_sink(sec_dec, &s->secondary_screens[i].frame_sink);
+        }
+
+        // one additional view-only window per mirrored device
+        static const struct stream_callbacks mirror_stream_cbs = {
+            .on_eos = mirror_stream_on_eos,
+        };
+        for (unsigned i = 0; i < options->mirror_count; ++i) {
+            struct sc_server *mirror = &s->mirror_servers[i];
+            struct stream *mirror_stream = &s->mirror_streams[i];
+
+            if (!stream_init(mirror_stream, mirror->video_socket, 1,
+                             &mirror_stream_cbs, (void *) (uintptr_t) i)) {
+                goto end;
+            }
+            ++mirror_stream_init_count;
+            stream_set_codec(mirror_stream,
+                             codec_to_avcodec_id(options->codec));
+
+            struct decoder *mirror_dec = &s->mirror_decoders[i];
+            // mirrored devices are view-only
+            decoder_init(mirror_dec, NULL, options->decoder_threads,
+                         options->decoder_frame_threading, options->hwdec);
+            stream_add_sink(mirror_stream, 0, &mirror_dec->packet_sink);
+
+            char *mirror_title = NULL;
+            if (asprintf(&mirror_title, "%s - %s", mirror->info.device_name,
+                         options->mirror_serials[i]) == -1) {
+                LOG_OOM();
+                goto end;
+            }
+
+            struct screen_params mirror_params = {
+                // window geometry persistence is keyed by serial
+                .serial = options->mirror_serials[i],
+                .window_title = mirror_title,
+                .frame_size = mirror->info.frame_size,
+                .always_on_top = options->always_on_top,
+                .window_x = SC_WINDOW_POSITION_UNDEFINED,
+                .window_y = SC_WINDOW_POSITION_UNDEFINED,
+                .window_width = 0,
+                .window_height = 0,
+                .window_borderless = options->window_borderless,
+                .rotation = 0,
+                .mipmaps = options->mipmaps,
+                .fullscreen = false,
+                .buffering_time = options->display_buffer,
+                .buffering_auto = options->display_buffer_auto,
+                // input and stream adaptation only apply to the primary
+                // device
+                .controller = NULL,
+                .dynamic_max_size = false,
+                .max_size = options->max_size,
+                .max_fps = 0,
+                .max_fps_unfocused = 0,
+            };
+
+            bool mirror_ok =
+                screen_init(&s->mirror_screens[i], &mirror_params);
+            // the title is copied by SDL
+            free(mirror_title);
+            if (!mirror_ok) {
+                goto end;
+            }
+            ++s->mirror_screen_count;
+
+            decoder_add_sink(mirror_dec, &s->mirror_screens[i].frame_sink);
+        }
     }
 
 #ifdef HAVE_V4L2
@@ -525,6 +1064,17 @@ scrcpy(struct scrcpy_options *options) {
     }
 #endif
 
+    if (options->thumbnail_port) {
+        if (!sc_thumbnail_sink_init(&s->thumbnail_sink,
+                                    options->thumbnail_port)) {
+            goto end;
+        }
+
+        decoder_add_sink(&s->decoder, &s->thumbnail_sink.frame_sink);
+
+        thumbnail_sink_initialized = true;
+    }
+
     // now we consumed the header values, the socket receives the video stream
     // start the stream
     if (!stream_start(&s->stream)) {
@@ -532,11 +1082,34 @@ scrcpy(struct scrcpy_options *options) {
     }
     stream_started = true;
 
+    for (unsigned i = 0; i < mirror_stream_init_count; ++i) {
+        if (!stream_start(&s->mirror_streams[i])) {
+            goto end;
+        }
+        ++mirror_stream_started_count;
+    }
+
+    if (options->audio) {
+        assert(s->server.audio_socket != SC_SOCKET_NONE);
+        if (!sc_audio_player_init(&s->audio_player,
+                                  s->server.audio_socket)) {
+            goto end;
+        }
+        audio_player_initialized = true;
+
+        if (!sc_audio_player_start(&s->audio_player)) {
+            goto end;
+        }
+    }
+
     struct sc_key_processor *kp = NULL;
     struct sc_mouse_processor *mp = NULL;
+    struct sc_hid_gamepad *gamepad = NULL;
 
     if (options->control) {
-        if (options->keyboard_input_mode == SC_KEYBOARD_INPUT_MODE_HID) {
+        bool use_hid_keyboard =
+            options->keyboard_input_mode == SC_KEYBOARD_INPUT_MODE_HID;
+        if (use_hid_keyboard || options->hid_mouse || options->hid_gamepad) {
 #ifdef HAVE_AOA_HID
             bool aoa_hid_ok = false;
 
@@ -545,34 +1118,101 @@ scrcpy(struct scrcpy_options *options) {
                 goto aoa_hid_end;
             }
 
-            if (!sc_hid_keyboard_init(&s->keyboard_hid, &s->aoa)) {
-                sc_aoa_destroy(&s->aoa);
-                goto aoa_hid_end;
+            if (use_hid_keyboard) {
+                if (!sc_hid_keyboard_init(&s->keyboard_hid, &s->aoa)) {
+                    sc_aoa_destroy(&s->aoa);
+                    goto aoa_hid_end;
+                }
+                hid_keyboard_initialized = true;
+            }
+
+            if (options->hid_mouse) {
+                if (!sc_hid_mouse_init(&s->mouse_hid, &s->aoa)) {
+                    if (hid_keyboard_initialized) {
+                        sc_hid_keyboard_destroy(&s->keyboard_hid);
+                        hid_keyboard_initialized = false;
+                    }
+                    sc_aoa_destroy(&s->aoa);
+                    goto aoa_hid_end;
+                }
+                hid_mouse_initialized = true;
+            }
+
+            if (options->hid_gamepad) {
+                // HID gamepads are registered on controller hotplug
+                sc_hid_gamepad_init(&s->gamepad_hid, &s->aoa);
+                hid_gamepad_initialized = true;
             }
 
             if (!sc_aoa_start(&s->aoa)) {
-                sc_hid_keyboard_destroy(&s->keyboard_hid);
+                if (hid_keyboard_initialized) {
+                    sc_hid_keyboard_destroy(&s->keyboard_hid);
+                    hid_keyboard_initialized = false;
+                }
+                if (hid_mouse_initialized) {
+                    sc_hid_mouse_destroy(&s->mouse_hid);
+                    hid_mouse_initialized = false;
+                }
+                hid_gamepad_initialized = false;
                 sc_aoa_destroy(&s->aoa);
                 goto aoa_hid_end;
             }
 
             aoa_hid_ok = true;
-            kp = &s->keyboard_hid.key_processor;
+            if (use_hid_keyboard) {
+                kp = &s->keyboard_hid.key_processor;
+            }
+            if (options->hid_mouse) {
+                mp = &s->mouse_hid.mouse_processor;
+                // HID mouse reports are relative, capture the mouse so that
+                // motion is not limited by the window borders
+                SDL_SetRelativeMouseMode(SDL_TRUE);
+            }
+            if (options->hid_gamepad) {
+                gamepad = &s->gamepad_hid;
+            }
 
             aoa_hid_initialized = true;
 
 aoa_hid_end:
             if (!aoa_hid_ok) {
-                LOGE("Failed to enable HID over AOA, "
+                if (use_hid_keyboard) {
+                    LOGE("Failed to enable HID over AOA, "
+                         "fallback to default keyboard injection method "
+                         "(-K/--hid-keyboard ignored)");
+                    options->keyboard_input_mode =
+                        SC_KEYBOARD_INPUT_MODE_INJECT;
+                }
+                if (options->hid_mouse) {
+                    LOGE("Failed to enable HID over AOA, "
+                         "fallback to default mouse injection method "
+                         "(-M/--hid-mouse ignored)");
+                    options->hid_mouse = false;
+                }
+                if (options->hid_gamepad) {
+                    LOGE("Failed to enable HID over AOA "
+                         "(-G/--hid-gamepad ignored)");
+                    options->hid_gamepad = false;
+                }
+            }
+#else
+            if (use_hid_keyboard) {
+                LOGE("HID over AOA is not supported on this platform, "
                      "fallback to default keyboard injection method "
                      "(-K/--hid-keyboard ignored)");
                 options->keyboard_input_mode = SC_KEYBOARD_INPUT_MODE_INJECT;
             }
-#else
-            LOGE("HID over AOA is not supported on this platform, "
-                 "fallback to default keyboard injection method "
-                 "(-K/--hid-keyboard ignored)");
-            options->keyboard_input_mode = SC_KEYBOARD_INPUT_MODE_INJECT;
+            if (options->hid_mouse) {
+                LOGE("HID over AOA is not supported on this platform, "
+                     "fallback to default mouse injection method "
+                     "(-M/--hid-mouse ignored)");
+                options->hid_mouse = false;
+            }
+            if (options->hid_gamepad) {
+                LOGE("HID over AOA is not supported on this platform "
+                     "(-G/--hid-gamepad ignored)");
+                options->hid_gamepad = false;
+            }
 #endif
         }
 
@@ -583,26 +1223,56 @@ aoa_hid_end:
             kp = &s->keyboard_inject.key_processor;
         }
 
-        sc_mouse_inject_init(&s->mouse_inject, &s->controller, &s->screen);
-        mp = &s->mouse_inject.mouse_processor;
+        // hid_mouse may have been reset if HID mode failed
+        if (!options->hid_mouse) {
+            sc_mouse_inject_init(&s->mouse_inject, &s->controller, &s->screen);
+            mp = &s->mouse_inject.mouse_processor;
+        }
+    }
+
+    struct sc_screenshot *screenshot = NULL;
+    if (options->display) {
+        if (!sc_screenshot_init(&s->screenshot)) {
+            goto end;
+        }
+        screenshot_initialized = true;
+        screenshot = &s->screenshot;
     }
 
     input_manager_init(&s->input_manager, &s->controller, &s->screen, kp, mp,
-                       options);
+                       gamepad, screenshot, options);
 
-    ret = event_loop(s, options);
+    ret = event_loop(s, options) ? SCRCPY_EXIT_SUCCESS
+                                 : SCRCPY_EXIT_DISCONNECTED;
     LOGD("quit...");
 
-    // Close the window immediately on closing, because screen_destroy() may
+    // Close the windows immediately on closing, because screen_destroy() may
     // only be called once the stream thread is joined (it may take time)
     screen_hide_window(&s->screen);
+    for (unsigned i = 0; i < s->secondary_screen_count; ++i) {
+        screen_hide_window(&s->secondary_screens[i]);
+    }
+    for (unsigned i = 0; i < s->mirror_screen_count; ++i) {
+        screen_hide_window(&s->mirror_screens[i]);
+    }
 
 end:
+    // no-op if the prewarmed window was consumed by screen_init()
+    screen_prewarm_discard(&prewarm);
+
     // The stream is not stopped explicitly, because it will stop by itself on
     // end-of-stream
 #ifdef HAVE_AOA_HID
     if (aoa_hid_initialized) {
-        sc_hid_keyboard_destroy(&s->keyboard_hid);
+        if (hid_keyboard_initialized) {
+            sc_hid_keyboard_destroy(&s->keyboard_hid);
+        }
+        if (hid_mouse_initialized) {
+            sc_hid_mouse_destroy(&s->mouse_hid);
+        }
+        if (hid_gamepad_initialized) {
+            sc_hid_gamepad_destroy(&s->gamepad_hid);
+        }
         sc_aoa_stop(&s->aoa);
     }
     if (acksync) {
@@ -615,20 +1285,47 @@ end:
     if (file_handler_initialized) {
         file_handler_stop(&s->file_handler);
     }
+    if (screenshot_initialized) {
+        sc_screenshot_stop(&s->screenshot);
+    }
     if (screen_initialized) {
         screen_interrupt(&s->screen);
     }
+    for (unsigned i = 0; i < s->secondary_screen_count; ++i) {
+        screen_interrupt(&s->secondary_screens[i]);
+    }
+    for (unsigned i = 0; i < s->mirror_screen_count; ++i) {
+        screen_interrupt(&s->mirror_screens[i]);
+    }
 
     if (server_started) {
         // shutdown the sockets and kill the server
         sc_server_stop(&s->server);
     }
+    for (unsigned i = 0; i < mirror_server_count; ++i) {
+        sc_server_stop(&s->mirror_servers[i]);
+    }
+
+    if (replay && stream_started) {
+        // there is no socket to shutdown
+        stream_interrupt(&s->stream);
+    }
 
     // now that the sockets are shutdown, the stream and controller are
     // interrupted, we can join them
     if (stream_started) {
         stream_join(&s->stream);
     }
+    for (unsigned i = 0; i < mirror_stream_started_count; ++i) {
+        stream_join(&s->mirror_streams[i]);
+    }
+
+    // the audio socket is closed when the server stops, which terminates the
+    // player thread
+    if (audio_player_initialized) {
+        sc_audio_player_join(&s->audio_player);
+        sc_audio_player_destroy(&s->audio_player);
+    }
 
 #ifdef HAVE_V4L2
     if (v4l2_sink_initialized) {
@@ -636,6 +1333,21 @@ end:
     }
 #endif
 
+    if (thumbnail_sink_initialized) {
+        sc_thumbnail_sink_destroy(&s->thumbnail_sink);
+    }
+
+    if (relay_sink_initialized) {
+        sc_relay_sink_destroy(&s->relay_sink);
+    }
+
+    if (stream_initialized) {
+        stream_destroy(&s->stream);
+    }
+    for (unsigned i = 0; i < mirror_stream_init_count; ++i) {
+        stream_destroy(&s->mirror_streams[i]);
+    }
+
 #ifdef HAVE_AOA_HID
     if (aoa_hid_initialized) {
         sc_aoa_join(&s->aoa);
@@ -649,6 +1361,14 @@ end:
         screen_join(&s->screen);
         screen_destroy(&s->screen);
     }
+    for (unsigned i = 0; i < s->secondary_screen_count; ++i) {
+        screen_join(&s->secondary_screens[i]);
+        screen_destroy(&s->secondary_screens[i]);
+    }
+    for (unsigned i = 0; i < s->mirror_screen_count; ++i) {
+        screen_join(&s->mirror_screens[i]);
+        screen_destroy(&s->mirror_screens[i]);
+    }
 
     if (controller_started) {
         controller_join(&s->controller);
@@ -666,7 +1386,23 @@ end:
         file_handler_destroy(&s->file_handler);
     }
 
-    sc_server_destroy(&s->server);
+    if (screenshot_initialized) {
+        sc_screenshot_join(&s->screenshot);
+        sc_screenshot_destroy(&s->screenshot);
+    }
+
+    if (!replay) {
+        sc_server_destroy(&s->server);
+    }
+    for (unsigned i = 0; i < mirror_server_count; ++i) {
+        sc_server_destroy(&s->mirror_servers[i]);
+    }
+
+    sc_memory_budget_destroy(&s->memory_budget);
+
+    // all the instrumented threads are joined
+    sc_stats_logger_stop();
+    sc_trace_close();
 
     return ret;
 }
@@ -6,7 +6,13 @@
 #include <stdbool.h>
 #include "options.h"
 
-bool
+enum scrcpy_exit {
+    SCRCPY_EXIT_SUCCESS, // stopped by the user
+    SCRCPY_EXIT_FAILURE,
+    SCRCPY_EXIT_DISCONNECTED, // the device stream ended
+};
+
+enum scrcpy_exit
 scrcpy(struct scrcpy_options *options);
 
 #endif
@@ -0,0 +1,206 @@
+#include "scrcpy_otg.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+
+#include "adb.h"
+#include "aoa_hid.h"
+#include "hid_gamepad.h"
+#include "hid_keyboard.h"
+#include "hid_mouse.h"
+#include "icon.h"
+#include "util/intr.h"
+#include "util/log.h"
+
+struct scrcpy_otg {
+    struct sc_aoa aoa;
+    struct sc_hid_keyboard keyboard;
+    struct sc_hid_mouse mouse;
+    struct sc_hid_gamepad gamepad;
+    SDL_Window *window;
+};
+
+static bool
+otg_handle_event(struct scrcpy_otg *s, const struct scrcpy_options *options,
+                 const SDL_Event *event) {
+    switch (event->type) {
+        case SDL_QUIT:
+            LOGD("User requested to quit");
+            return false;
+        case SDL_KEYDOWN:
+        case SDL_KEYUP: {
+            struct sc_key_processor *kp = &s->keyboard.key_processor;
+            kp->ops->process_key(kp, &event->key, SC_SEQUENCE_INVALID);
+            return true;
+        }
+        case SDL_MOUSEMOTION: {
+            struct sc_mouse_processor *mp = &s->mouse.mouse_processor;
+            mp->ops->process_mouse_motion(mp, &event->motion);
+            return true;
+        }
+        case SDL_MOUSEBUTTONDOWN:
+        case SDL_MOUSEBUTTONUP: {
+            struct sc_mouse_processor *mp = &s->mouse.mouse_processor;
+            mp->ops->process_mouse_button(mp, &event->button);
+            return true;
+        }
+        case SDL_MOUSEWHEEL: {
+            struct sc_mouse_processor *mp = &s->mouse.mouse_processor;
+            mp->ops->process_mouse_wheel(mp, &event->wheel);
+            return true;
+        }
+        case SDL_CONTROLLERDEVICEADDED:
+        case SDL_CONTROLLERDEVICEREMOVED:
+        case SDL_CONTROLLERBUTTONDOWN:
+        case SDL_CONTROLLERBUTTONUP:
+        case SDL_CONTROLLERAXISMOTION:
+            if (options->hid_gamepad) {
+                sc_hid_gamepad_process_event(&s->gamepad, event);
+            }
+            return true;
+        default:
+            return true;
+    }
+}
+
+static void
+otg_event_loop(struct scrcpy_otg *s, const struct scrcpy_options *options) {
+    SDL_Event event;
+    while (SDL_WaitEvent(&event)) {
+        if (!otg_handle_event(s, options, &event)) {
+            return;
+        }
+    }
+    LOGE("SDL_WaitEvent() error: %s", SDL_GetError());
+}
+
+enum scrcpy_exit
+scrcpy_otg(struct scrcpy_options *options) {
+    static struct scrcpy_otg scrcpy_otg;
+    struct scrcpy_otg *s = &scrcpy_otg;
+
+    uint32_t sdl_flags = SDL_INIT_VIDEO | SDL_INIT_EVENTS;
+    if (options->hid_gamepad) {
+        sdl_flags |= SDL_INIT_GAMECONTROLLER;
+    }
+    if (SDL_Init(sdl_flags)) {
+        LOGC("Could not initialize SDL: %s", SDL_GetError());
+        return SCRCPY_EXIT_FAILURE;
+    }
+
+    atexit(SDL_Quit);
+
+    enum scrcpy_exit ret = SCRCPY_EXIT_FAILURE;
+
+    bool keyboard_initialized = false;
+    bool mouse_initialized = false;
+    bool gamepad_initialized = false;
+    bool aoa_started = false;
+
+    char *serial_owned = NULL;
+    const char *serial = options->serial;
+    if (!serial) {
+        // the USB device is matched by its serial, so it must be known even
+        // without any adb tunnel
+        struct sc_intr intr;
+        if (sc_intr_init(&intr)) {
+            serial_owned = adb_get_serialno(&intr, 0);
+            sc_intr_destroy(&intr);
+        }
+        if (!serial_owned) {
+            LOGE("Could not get device serial (try with -s/--serial)");
+            return SCRCPY_EXIT_FAILURE;
+        }
+        serial = serial_owned;
+    }
+
+    if (!sc_aoa_init(&s->aoa, serial, NULL)) {
+        goto end;
+    }
+
+    if (!sc_hid_keyboard_init(&s->keyboard, &s->aoa)) {
+        sc_aoa_destroy(&s->aoa);
+        goto end;
+    }
+    keyboard_initialized = true;
+
+    if (!sc_hid_mouse_init(&s->mouse, &s->aoa)) {
+        sc_hid_keyboard_destroy(&s->keyboard);
+        keyboard_initialized = false;
+        sc_aoa_destroy(&s->aoa);
+        goto end;
+    }
+    mouse_initialized = true;
+
+    if (options->hid_gamepad) {
+        // HID gamepads are registered on controller hotplug
+        sc_hid_gamepad_init(&s->gamepad, &s->aoa);
+        gamepad_initialized = true;
+    }
+
+    if (!sc_aoa_start(&s->aoa)) {
+        sc_hid_keyboard_destroy(&s->keyboard);
+        keyboard_initialized = false;
+        sc_hid_mouse_destroy(&s->mouse);
+        mouse_initialized = false;
+        if (gamepad_initialized) {
+            sc_hid_gamepad_destroy(&s->gamepad);
+            gamepad_initialized = false;
+        }
+        sc_aoa_destroy(&s->aoa);
+        goto end;
+    }
+    aoa_started = true;
+
+    // a window is necessary to capture keyboard focus; it displays no video
+    char window_title[128];
+    snprintf(window_title, sizeof(window_title), "%s (OTG)",
+             options->window_title ? options->window_title : serial);
+    s->window = SDL_CreateWindow(window_title, SDL_WINDOWPOS_UNDEFINED,
+                                 SDL_WINDOWPOS_UNDEFINED, 256, 256, 0);
+    if (!s->window) {
+        LOGC("Could not create window: %s", SDL_GetError());
+        goto end;
+    }
+
+    SDL_Surface *icon = scrcpy_icon_load();
+    if (icon) {
+        SDL_SetWindowIcon(s->window, icon);
+        scrcpy_icon_destroy(icon);
+    } else {
+        LOGW("Could not load icon");
+    }
+
+    // HID mouse reports are relative, capture the mouse in the window
+    SDL_SetRelativeMouseMode(SDL_TRUE);
+
+    LOGI("OTG mode: input events are sent over USB (no mirroring)");
+
+    otg_event_loop(s, options);
+    ret = SCRCPY_EXIT_SUCCESS;
+
+    LOGD("quit...");
+    SDL_DestroyWindow(s->window);
+
+end:
+    if (aoa_started) {
+        if (keyboard_initialized) {
+            sc_hid_keyboard_destroy(&s->keyboard);
+        }
+        if (mouse_initialized) {
+            sc_hid_mouse_destroy(&s->mouse);
+        }
+        if (gamepad_initialized) {
+            sc_hid_gamepad_destroy(&s->gamepad);
+        }
+        sc_aoa_stop(&s->aoa);
+        sc_aoa_join(&s->aoa);
+        sc_aoa_destroy(&s->aoa);
+    }
+
+    free(serial_owned);
+
+    return ret;
+}
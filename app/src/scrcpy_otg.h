@@ -0,0 +1,15 @@
+#ifndef SCRCPY_OTG_H
+#define SCRCPY_OTG_H
+
+#include "common.h"
+
+#include "scrcpy.h"
+
+/**
+ * Run scrcpy in OTG mode: physical keyboard simulation over USB (AOAv2),
+ * without server, video stream or decoder.
+ */
+enum scrcpy_exit
+scrcpy_otg(struct scrcpy_options *options);
+
+#endif
@@ -2,16 +2,26 @@
 
 #include <assert.h>
 #include <string.h>
+#include <libavutil/pixdesc.h>
 #include <SDL2/SDL.h>
 
+#include "controller.h"
 #include "events.h"
 #include "icon.h"
 #include "options.h"
 #include "video_buffer.h"
+#include "window_geometry.h"
 #include "util/log.h"
+#include "util/stats.h"
+#include "util/trace.h"
 
 #define DISPLAY_MARGINS 96
 
+// Dynamic max-size requests are rounded up to a multiple of this value, so
+// that continuous window resizing does not restart the encoder on every
+// SIZE_CHANGED event (must be a multiple of 8)
+#define DYNAMIC_MAX_SIZE_STEP 256
+
 #define DOWNCAST(SINK) container_of(SINK, struct screen, frame_sink)
 
 static inline struct sc_size
@@ -160,6 +170,9 @@ get_initial_optimal_size(struct sc_size content_size, uint16_t req_width,
     return window_size;
 }
 
+static void
+screen_update_mipmaps_active(struct screen *screen);
+
 static void
 screen_update_content_rect(struct screen *screen) {
     int dw;
@@ -170,6 +183,17 @@ screen_update_content_rect(struct screen *screen) {
     // The drawable size is the window size * the HiDPI scale
     struct sc_size drawable_size = {dw, dh};
 
+    if (drawable_size.width == screen->rect_drawable_size.width
+            && drawable_size.height == screen->rect_drawable_size.height
+            && content_size.width == screen->rect_content_size.width
+            && content_size.height == screen->rect_content_size.height) {
+        // the cached rectangle is still valid
+        return;
+    }
+
+    screen->rect_drawable_size = drawable_size;
+    screen->rect_content_size = content_size;
+
     SDL_Rect *rect = &screen->rect;
 
     if (is_optimal_size(drawable_size, content_size)) {
@@ -177,6 +201,7 @@ screen_update_content_rect(struct screen *screen) {
         rect->y = 0;
         rect->w = drawable_size.width;
         rect->h = drawable_size.height;
+        screen_update_mipmaps_active(screen);
         return;
     }
 
@@ -195,13 +220,37 @@ screen_update_content_rect(struct screen *screen) {
                                        / content_size.height;
         rect->x = (drawable_size.width - rect->w) / 2;
     }
+
+    screen_update_mipmaps_active(screen);
+}
+
+// return the SDL pixel format to use for a given frame format
+// (SDL_PIXELFORMAT_UNKNOWN if the renderer does not support it)
+static uint32_t
+to_sdl_pixel_format(enum AVPixelFormat fmt) {
+    switch (fmt) {
+        case AV_PIX_FMT_YUV420P:
+            return SDL_PIXELFORMAT_YV12;
+#ifdef SCRCPY_SDL_HAS_UPDATE_NV_TEXTURE
+        case AV_PIX_FMT_NV12:
+            return SDL_PIXELFORMAT_NV12;
+#endif
+        default:
+            return SDL_PIXELFORMAT_UNKNOWN;
+    }
 }
 
 static inline SDL_Texture *
 create_texture(struct screen *screen) {
     SDL_Renderer *renderer = screen->renderer;
     struct sc_size size = screen->frame_size;
-    SDL_Texture *texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_YV12,
+    uint32_t sdl_format = to_sdl_pixel_format(screen->frame_format);
+    if (sdl_format == SDL_PIXELFORMAT_UNKNOWN) {
+        LOGE("Unsupported frame format: %s",
+             av_get_pix_fmt_name(screen->frame_format));
+        return NULL;
+    }
+    SDL_Texture *texture = SDL_CreateTexture(renderer, sdl_format,
                                              SDL_TEXTUREACCESS_STREAMING,
                                              size.width, size.height);
     if (!texture) {
@@ -224,17 +273,114 @@ create_texture(struct screen *screen) {
     return texture;
 }
 
+static void
+texture_pool_clear(struct screen *screen) {
+    for (size_t i = 0; i < SC_TEXTURE_POOL_LEN; ++i) {
+        SDL_Texture *texture = screen->texture_pool.entries[i].texture;
+        if (texture) {
+            SDL_DestroyTexture(texture);
+            screen->texture_pool.entries[i].texture = NULL;
+        }
+    }
+    screen->texture_pool.next = 0;
+}
+
+// return a texture for the current frame size, reusing a cached one if
+// possible (evicting the oldest entry otherwise)
+static SDL_Texture *
+texture_pool_get(struct screen *screen) {
+    struct sc_size size = screen->frame_size;
+    for (size_t i = 0; i < SC_TEXTURE_POOL_LEN; ++i) {
+        SDL_Texture *texture = screen->texture_pool.entries[i].texture;
+        if (texture && screen->texture_pool.entries[i].size.width == size.width
+                && screen->texture_pool.entries[i].size.height
+                        == size.height) {
+            return texture;
+        }
+    }
+
+    SDL_Texture *texture = create_texture(screen);
+    if (!texture) {
+        return NULL;
+    }
+
+    unsigned i = screen->texture_pool.next;
+    if (screen->texture_pool.entries[i].texture) {
+        SDL_DestroyTexture(screen->texture_pool.entries[i].texture);
+    }
+    screen->texture_pool.entries[i].size = size;
+    screen->texture_pool.entries[i].texture = texture;
+    screen->texture_pool.next = (i + 1) % SC_TEXTURE_POOL_LEN;
+
+    LOGI("New texture: %" PRIu16 "x%" PRIu16, size.width, size.height);
+    return texture;
+}
+
+// Regenerating the mipmaps on every frame costs significant GPU time at high
+// resolutions, while the mip levels are only sampled (given the -1 LOD bias)
+// once the content is downscaled by more than 2x; enable the generation only
+// past that threshold, from the displayed rectangle just computed
+static void
+screen_update_mipmaps_active(struct screen *screen) {
+    if (!screen->mipmaps) {
+        return;
+    }
+
+    // the rect is in drawable (scaled) coordinates, the content size in
+    // frame pixels
+    bool downscaled =
+        2 * screen->rect.w < (int) screen->rect_content_size.width
+     || 2 * screen->rect.h < (int) screen->rect_content_size.height;
+    if (downscaled == screen->mipmaps_active) {
+        return;
+    }
+    screen->mipmaps_active = downscaled;
+    LOGD("Mipmap generation %s", downscaled ? "enabled" : "disabled");
+
+    if (screen->use_yuv_renderer) {
+        sc_yuv_renderer_set_mipmaps_active(&screen->yuv_renderer, downscaled);
+        return;
+    }
+
+    if (downscaled && screen->texture) {
+        // the existing mip levels are stale, regenerate them from the
+        // current content
+        SDL_GL_BindTexture(screen->texture, NULL, NULL);
+        screen->gl.GenerateMipmap(GL_TEXTURE_2D);
+        SDL_GL_UnbindTexture(screen->texture);
+    }
+}
+
 // render the texture to the renderer
 //
 // Set the update_content_rect flag if the window or content size may have
 // changed, so that the content rectangle is recomputed
 static void
 screen_render(struct screen *screen, bool update_content_rect) {
+    sc_tick trace = sc_trace_begin();
+
     if (update_content_rect) {
         screen_update_content_rect(screen);
     }
 
     SDL_RenderClear(screen->renderer);
+#if SDL_VERSION_ATLEAST(2, 0, 10)
+    if (screen->use_yuv_renderer) {
+        if (screen->yuv_renderer.size.width) {
+            // submit the pending SDL drawing (the clear) before drawing with
+            // our own program
+            SDL_RenderFlush(screen->renderer);
+            sc_yuv_renderer_draw(&screen->yuv_renderer,
+                                 screen->rect_drawable_size,
+                                 screen->rect.x, screen->rect.y,
+                                 screen->rect.w, screen->rect.h,
+                                 screen->rotation);
+        }
+        SDL_RenderPresent(screen->renderer);
+        sc_trace_end("render", trace);
+        return;
+    }
+#endif
     if (screen->rotation == 0) {
         SDL_RenderCopy(screen->renderer, screen->texture, NULL, &screen->rect);
     } else {
@@ -260,6 +406,8 @@ screen_render(struct screen *screen, bool update_content_rect) {
                          angle, NULL, 0);
     }
     SDL_RenderPresent(screen->renderer);
+
+    sc_trace_end("render", trace);
 }
 
 
@@ -268,6 +416,12 @@ screen_render(struct screen *screen, bool update_content_rect) {
 #endif
 
 #ifdef CONTINUOUS_RESIZING_WORKAROUND
+// During an interactive resize, this watcher is called for every motion
+// event, much faster than the display refresh rate; rendering a large texture
+// for each of them wastes GPU time and drops frames, so present at most once
+// per interval (the final size is always rendered from the event loop)
+#define SC_RESIZE_RENDER_INTERVAL SC_TICK_FROM_MS(16)
+
 // On Windows and MacOS, resizing blocks the event loop, so resizing events are
 // not triggered. As a workaround, handle them in an event handler.
 //
@@ -278,6 +432,12 @@ event_watcher(void *data, SDL_Event *event) {
     struct screen *screen = data;
     if (event->type == SDL_WINDOWEVENT
             && event->window.event == SDL_WINDOWEVENT_RESIZED) {
+        sc_tick now = sc_tick_now();
+        if (now - screen->last_resize_render < SC_RESIZE_RENDER_INTERVAL) {
+            // rendered very recently, skip this intermediate size
+            return 0;
+        }
+        screen->last_resize_render = now;
         // In practice, it seems to always be called from the same thread in
         // that specific case. Anyway, it's just a workaround.
         screen_render(screen, true);
@@ -286,6 +446,25 @@ event_watcher(void *data, SDL_Event *event) {
 }
 #endif
 
+// executed on the SDL timer thread, present the pending frame from the event
+// loop
+static uint32_t
+present_timer_cb(uint32_t interval, void *param) {
+    struct screen *screen = param;
+
+    SDL_Event present_event = {
+        .type = EVENT_PRESENT_FRAME,
+    };
+    present_event.user.data1 = screen;
+
+    int ret = SDL_PushEvent(&present_event);
+    if (ret < 0) {
+        // retry at the next interval
+        return interval;
+    }
+    return 0; // one-shot
+}
+
 static bool
 screen_frame_sink_open(struct sc_frame_sink *sink) {
     struct screen *screen = DOWNCAST(sink);
@@ -312,7 +491,143 @@ screen_frame_sink_close(struct sc_frame_sink *sink) {
 static bool
 screen_frame_sink_push(struct sc_frame_sink *sink, const AVFrame *frame) {
     struct screen *screen = DOWNCAST(sink);
-    return sc_video_buffer_push(&screen->vb, frame);
+    sc_tick trace = sc_trace_begin();
+    bool ok = sc_video_buffer_push(&screen->vb, frame);
+    sc_trace_end("vbuf_push", trace);
+    return ok;
+}
+
+// Flow control: when the renderer cannot keep up, it is pointless (and
+// counter-productive) to let the device encode at full rate, only for the
+// client to decode frames it will never display. Observe the skip ratio over
+// a rolling window and request a reduced encoder frame rate, then restore the
+// nominal rate once the skips stop.
+#define SC_FPS_ADAPT_WINDOW SC_TICK_FROM_SEC(2)
+#define SC_FPS_ADAPT_MIN_FPS 10
+// do not conclude anything from a nearly empty window
+#define SC_FPS_ADAPT_MIN_FRAMES 20
+
+static void
+screen_adapt_max_fps(struct screen *screen, bool skipped) {
+    ++screen->adapt_frames;
+    if (skipped) {
+        ++screen->adapt_skipped;
+    }
+
+    sc_tick now = sc_tick_now();
+    if (!screen->adapt_window_start) {
+        screen->adapt_window_start = now;
+        return;
+    }
+
+    sc_tick window = now - screen->adapt_window_start;
+    if (window < SC_FPS_ADAPT_WINDOW) {
+        return;
+    }
+
+    unsigned frames = screen->adapt_frames;
+    unsigned skipped_frames = screen->adapt_skipped;
+    screen->adapt_frames = 0;
+    screen->adapt_skipped = 0;
+    screen->adapt_window_start = now;
+
+    if (frames < SC_FPS_ADAPT_MIN_FRAMES) {
+        return;
+    }
+
+    uint16_t target;
+    if (4 * skipped_frames >= frames) {
+        // more than 25% of the frames are skipped, halve the received rate
+        uint32_t received_fps = frames * 1000 / SC_TICK_TO_MS(window);
+        uint32_t reduced = received_fps / 2;
+        if (reduced < SC_FPS_ADAPT_MIN_FPS) {
+            reduced = SC_FPS_ADAPT_MIN_FPS;
+        }
+        if (screen->reduced_max_fps && reduced >= screen->reduced_max_fps) {
+            // already reduced at least as much
+            return;
+        }
+        target = reduced;
+    } else if (screen->reduced_max_fps && 20 * skipped_frames < frames) {
+        // less than 5% skipped over a whole window, restore the nominal rate
+        target = screen->max_fps; // may be 0 (no limit)
+    } else {
+        return;
+    }
+
+    struct control_msg msg;
+    msg.type = CONTROL_MSG_TYPE_SET_MAX_FPS;
+    msg.set_max_fps.max_fps = target;
+
+    if (!controller_push_msg(screen->controller, &msg)) {
+        LOGW("Could not request max fps %" PRIu16, target);
+        return;
+    }
+
+    if (target == screen->max_fps) {
+        LOGI("Nominal max fps restored");
+        screen->reduced_max_fps = 0;
+    } else {
+        LOGI("Renderer overloaded, max fps reduced to %" PRIu16, target);
+        screen->reduced_max_fps = target;
+    }
+}
+
+static void
+screen_set_stream_paused(struct screen *screen, bool paused) {
+    if (!screen->controller) {
+        // no control, the device encoder cannot be paused
+        return;
+    }
+
+    if (screen->stream_paused == paused) {
+        return;
+    }
+
+    struct control_msg msg;
+    msg.type = CONTROL_MSG_TYPE_SET_STREAM_PAUSED;
+    msg.set_stream_paused.paused = paused;
+
+    if (!controller_push_msg(screen->controller, &msg)) {
+        LOGW("Could not request to %s the video stream",
+             paused ? "pause" : "resume");
+        return;
+    }
+
+    screen->stream_paused = paused;
+    LOGD("Video stream %s", paused ? "paused" : "resumed");
+}
+
+static void
+screen_on_focus_changed(struct screen *screen, bool focused) {
+    if (screen->focused == focused) {
+        return;
+    }
+    screen->focused = focused;
+
+    if (!screen->controller || !screen->max_fps_unfocused) {
+        return;
+    }
+
+    uint16_t target = focused ? screen->max_fps : screen->max_fps_unfocused;
+
+    struct control_msg msg;
+    msg.type = CONTROL_MSG_TYPE_SET_MAX_FPS;
+    msg.set_max_fps.max_fps = target;
+
+    if (!controller_push_msg(screen->controller, &msg)) {
+        LOGW("Could not request max fps %" PRIu16, target);
+        return;
+    }
+
+    if (focused) {
+        LOGD("Window focused, nominal max fps restored");
+        // let the overload adaptation re-engage from the nominal rate
+        screen->reduced_max_fps = 0;
+    } else {
+        LOGD("Window unfocused, max fps reduced to %" PRIu16, target);
+        screen->reduced_max_fps = target;
+    }
 }
 
 static void
@@ -321,33 +636,99 @@ sc_video_buffer_on_new_frame(struct sc_video_buffer *vb, bool previous_skipped,
     (void) vb;
     struct screen *screen = userdata;
 
-    // event_failed implies previous_skipped (the previous frame may not have
-    // been consumed if the event was not sent)
-    assert(!screen->event_failed || previous_skipped);
+    if (screen->controller) {
+        screen_adapt_max_fps(screen, previous_skipped);
+    }
 
-    bool need_new_event;
     if (previous_skipped) {
         fps_counter_add_skipped_frame(&screen->fps_counter);
-        // The EVENT_NEW_FRAME triggered for the previous frame will consume
-        // this new frame instead, unless the previous event failed
-        need_new_event = screen->event_failed;
-    } else {
-        need_new_event = true;
+        sc_stats_add(SC_STAT_FRAMES_SKIPPED, 1);
     }
 
-    if (need_new_event) {
-        static SDL_Event new_frame_event = {
-            .type = EVENT_NEW_FRAME,
-        };
+    // Coalesce the signaling: at most one wake-up event is in flight per
+    // screen; frames arriving while it is pending are consumed by it (the
+    // frame buffer keeps only the latest frame), so a fast decoder does not
+    // contend with input events on SDL's global event queue
+    bool was_pending = atomic_exchange(&screen->frame_pending, true);
+    if (was_pending) {
+        return;
+    }
 
-        // Post the event on the UI thread
-        int ret = SDL_PushEvent(&new_frame_event);
-        if (ret < 0) {
-            LOGW("Could not post new frame event: %s", SDL_GetError());
-            screen->event_failed = true;
-        } else {
-            screen->event_failed = false;
-        }
+    SDL_Event new_frame_event = {
+        .type = EVENT_NEW_FRAME,
+    };
+    // several screens may push this event, identify the sender
+    new_frame_event.user.data1 = screen;
+
+    // Post the event on the UI thread
+    int ret = SDL_PushEvent(&new_frame_event);
+    if (ret < 0) {
+        LOGW("Could not post new frame event: %s", SDL_GetError());
+        // let the next frame retry the wake-up
+        atomic_store(&screen->frame_pending, false);
+    }
+}
+
+static uint32_t
+get_window_flags(bool always_on_top, bool window_borderless) {
+    uint32_t window_flags = SDL_WINDOW_HIDDEN
+                          | SDL_WINDOW_RESIZABLE
+                          | SDL_WINDOW_ALLOW_HIGHDPI;
+    if (always_on_top) {
+#ifdef SCRCPY_SDL_HAS_WINDOW_ALWAYS_ON_TOP
+        window_flags |= SDL_WINDOW_ALWAYS_ON_TOP;
+#else
+        LOGW("The 'always on top' flag is not available "
+             "(compile with SDL >= 2.0.5 to enable it)");
+#endif
+    }
+    if (window_borderless) {
+        window_flags |= SDL_WINDOW_BORDERLESS;
+    }
+    return window_flags;
+}
+
+bool
+screen_prewarm(struct screen_prewarm *prewarm, bool always_on_top,
+               bool window_borderless) {
+    prewarm->window = NULL;
+    prewarm->renderer = NULL;
+
+    uint32_t window_flags = get_window_flags(always_on_top, window_borderless);
+
+    // the title, position and size are set by screen_init() once the device
+    // size handshake is received (the window stays hidden until then)
+    SDL_Window *window =
+        SDL_CreateWindow("scrcpy", SDL_WINDOWPOS_UNDEFINED,
+                         SDL_WINDOWPOS_UNDEFINED, 256, 256, window_flags);
+    if (!window) {
+        // not fatal, screen_init() will create its own window
+        LOGW("Could not create window ahead of time: %s", SDL_GetError());
+        return false;
+    }
+
+    SDL_Renderer *renderer =
+        SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+    if (!renderer) {
+        LOGW("Could not create renderer ahead of time: %s", SDL_GetError());
+        SDL_DestroyWindow(window);
+        return false;
+    }
+
+    prewarm->window = window;
+    prewarm->renderer = renderer;
+    return true;
+}
+
+void
+screen_prewarm_discard(struct screen_prewarm *prewarm) {
+    if (prewarm->renderer) {
+        SDL_DestroyRenderer(prewarm->renderer);
+        prewarm->renderer = NULL;
+    }
+    if (prewarm->window) {
+        SDL_DestroyWindow(prewarm->window);
+        prewarm->window = NULL;
     }
 }
 
@@ -355,16 +736,42 @@ bool
 screen_init(struct screen *screen, const struct screen_params *params) {
     screen->resize_pending = false;
     screen->has_frame = false;
+    screen->visible = true;
+    screen->render_pending = false;
+    screen->vsync_interval = 0;
+    screen->next_present_date = 0;
+    screen->present_scheduled = false;
+    screen->stream_paused = false;
     screen->fullscreen = false;
     screen->maximized = false;
-    screen->event_failed = false;
+    atomic_init(&screen->frame_pending, false);
+    screen->serial = params->serial;
+    screen->controller = params->controller;
+    screen->dynamic_max_size = params->dynamic_max_size;
+    screen->max_size = params->max_size;
+    screen->requested_max_size = 0;
+    screen->max_fps = params->max_fps;
+    screen->reduced_max_fps = 0;
+    screen->max_fps_unfocused = params->max_fps_unfocused;
+    screen->focused = true;
+    screen->adapt_frames = 0;
+    screen->adapt_skipped = 0;
+    screen->adapt_window_start = 0;
+    screen->print_latency = params->print_latency;
+    sc_histogram_clear(&screen->latency);
+    screen->latency_log_date = 0;
+    screen->clock_probe_date = 0;
+    // force the first screen_update_content_rect() to compute the rectangle
+    screen->rect_drawable_size = (struct sc_size) {0, 0};
+    screen->rect_content_size = (struct sc_size) {0, 0};
+    screen->last_resize_render = 0;
 
     static const struct sc_video_buffer_callbacks cbs = {
         .on_new_frame = sc_video_buffer_on_new_frame,
     };
 
-    bool ok = sc_video_buffer_init(&screen->vb, params->buffering_time, &cbs,
-                                   screen);
+    bool ok = sc_video_buffer_init(&screen->vb, params->buffering_time,
+                                   params->buffering_auto, &cbs, screen);
     if (!ok) {
         return false;
     }
@@ -379,6 +786,7 @@ screen_init(struct screen *screen, const struct screen_params *params) {
     }
 
     screen->frame_size = params->frame_size;
+    screen->frame_format = AV_PIX_FMT_YUV420P; // until the first frame
     screen->rotation = params->rotation;
     if (screen->rotation) {
         LOGI("Initial display rotation set to %u", screen->rotation);
@@ -390,38 +798,66 @@ screen_init(struct screen *screen, const struct screen_params *params) {
     struct sc_size window_size =
         get_initial_optimal_size(content_size,params->window_width,
                                  params->window_height);
-    uint32_t window_flags = SDL_WINDOW_HIDDEN
-                          | SDL_WINDOW_RESIZABLE
-                          | SDL_WINDOW_ALLOW_HIGHDPI;
-    if (params->always_on_top) {
-#ifdef SCRCPY_SDL_HAS_WINDOW_ALWAYS_ON_TOP
-        window_flags |= SDL_WINDOW_ALWAYS_ON_TOP;
-#else
-        LOGW("The 'always on top' flag is not available "
-             "(compile with SDL >= 2.0.5 to enable it)");
-#endif
-    }
-    if (params->window_borderless) {
-        window_flags |= SDL_WINDOW_BORDERLESS;
-    }
 
     int x = params->window_x != SC_WINDOW_POSITION_UNDEFINED
           ? params->window_x : (int) SDL_WINDOWPOS_UNDEFINED;
     int y = params->window_y != SC_WINDOW_POSITION_UNDEFINED
           ? params->window_y : (int) SDL_WINDOWPOS_UNDEFINED;
-    screen->window = SDL_CreateWindow(params->window_title, x, y,
-                                      window_size.width, window_size.height,
-                                      window_flags);
-    if (!screen->window) {
-        LOGC("Could not create window: %s", SDL_GetError());
-        goto error_destroy_fps_counter;
+
+    // If the user did not request an explicit geometry, restore the geometry
+    // used the last time for this device, so that the window appears directly
+    // at its final place
+    bool restore_geometry = params->serial
+                         && params->window_x == SC_WINDOW_POSITION_UNDEFINED
+                         && params->window_y == SC_WINDOW_POSITION_UNDEFINED
+                         && !params->window_width && !params->window_height;
+    if (restore_geometry) {
+        struct sc_window_geometry geom;
+        if (sc_window_geometry_load(params->serial, &geom)) {
+            LOGD("Restoring window geometry: %" PRIu16 "x%" PRIu16
+                 " at (%" PRIi16 ",%" PRIi16 ")", geom.width, geom.height,
+                                                  geom.x, geom.y);
+            x = geom.x;
+            y = geom.y;
+            window_size.width = geom.width;
+            window_size.height = geom.height;
+        }
     }
 
-    screen->renderer = SDL_CreateRenderer(screen->window, -1,
-                                          SDL_RENDERER_ACCELERATED);
-    if (!screen->renderer) {
-        LOGC("Could not create renderer: %s", SDL_GetError());
-        goto error_destroy_window;
+    struct screen_prewarm *prewarm = params->prewarm;
+    if (prewarm && prewarm->window) {
+        // adopt the hidden window and renderer created while the server
+        // connection was in progress (see screen_prewarm())
+        screen->window = prewarm->window;
+        screen->renderer = prewarm->renderer;
+        prewarm->window = NULL;
+        prewarm->renderer = NULL;
+
+        SDL_SetWindowTitle(screen->window, params->window_title);
+        if (x != (int) SDL_WINDOWPOS_UNDEFINED
+                || y != (int) SDL_WINDOWPOS_UNDEFINED) {
+            SDL_SetWindowPosition(screen->window, x, y);
+        }
+        // the size is applied below (it is always reset to workaround HiDPI
+        // issues)
+    } else {
+        uint32_t window_flags = get_window_flags(params->always_on_top,
+                                                 params->window_borderless);
+
+        screen->window = SDL_CreateWindow(params->window_title, x, y,
+                                          window_size.width,
+                                          window_size.height, window_flags);
+        if (!screen->window) {
+            LOGC("Could not create window: %s", SDL_GetError());
+            goto error_destroy_fps_counter;
+        }
+
+        screen->renderer = SDL_CreateRenderer(screen->window, -1,
+                                              SDL_RENDERER_ACCELERATED);
+        if (!screen->renderer) {
+            LOGC("Could not create renderer: %s", SDL_GetError());
+            goto error_destroy_window;
+        }
     }
 
     SDL_RendererInfo renderer_info;
@@ -429,7 +865,21 @@ screen_init(struct screen *screen, const struct screen_params *params) {
     const char *renderer_name = r ? NULL : renderer_info.name;
     LOGI("Renderer: %s", renderer_name ? renderer_name : "(unknown)");
 
+    // the timer subsystem is required to defer a present to the next vsync
+    // deadline
+    SDL_DisplayMode display_mode;
+    if (SDL_InitSubSystem(SDL_INIT_TIMER)) {
+        LOGW("Could not initialize SDL timers: %s", SDL_GetError());
+        // present pacing disabled
+    } else if (!SDL_GetWindowDisplayMode(screen->window, &display_mode)
+            && display_mode.refresh_rate > 0) {
+        screen->vsync_interval =
+            SC_TICK_FROM_SEC(1) / display_mode.refresh_rate;
+        LOGD("Display refresh rate: %d Hz", display_mode.refresh_rate);
+    }
+
     screen->mipmaps = false;
+    screen->mipmaps_active = false;
 
     // starts with "opengl"
     bool use_opengl = renderer_name && !strncmp(renderer_name, "opengl", 6);
@@ -457,6 +907,22 @@ screen_init(struct screen *screen, const struct screen_params *params) {
         LOGD("Trilinear filtering disabled (not an OpenGL renderer)");
     }
 
+    screen->use_yuv_renderer = false;
+#if SDL_VERSION_ATLEAST(2, 0, 10)
+    // The YUV renderer draws with its own program into the context owned by
+    // the SDL renderer, which requires SDL_RenderFlush() (SDL 2.0.10+)
+    if (use_opengl) {
+        if (sc_yuv_renderer_init(&screen->yuv_renderer, &screen->gl,
+                                 screen->mipmaps)) {
+            LOGI("OpenGL YUV renderer enabled");
+            screen->use_yuv_renderer = true;
+        } else {
+            LOGW("Could not enable the OpenGL YUV renderer, falling back to "
+                 "SDL textures");
+        }
+    }
+#endif
+
     SDL_Surface *icon = scrcpy_icon_load();
     if (icon) {
         SDL_SetWindowIcon(screen->window, icon);
@@ -465,12 +931,19 @@ screen_init(struct screen *screen, const struct screen_params *params) {
         LOGW("Could not load icon");
     }
 
-    LOGI("Initial texture: %" PRIu16 "x%" PRIu16, params->frame_size.width,
-                                                  params->frame_size.height);
-    screen->texture = create_texture(screen);
-    if (!screen->texture) {
-        LOGC("Could not create texture: %s", SDL_GetError());
-        goto error_destroy_renderer;
+    for (size_t i = 0; i < SC_TEXTURE_POOL_LEN; ++i) {
+        screen->texture_pool.entries[i].texture = NULL;
+    }
+    screen->texture_pool.next = 0;
+
+    if (!screen->use_yuv_renderer) {
+        screen->texture = texture_pool_get(screen);
+        if (!screen->texture) {
+            LOGC("Could not create texture: %s", SDL_GetError());
+            goto error_destroy_renderer;
+        }
+    } else {
+        screen->texture = NULL;
     }
 
     screen->frame = av_frame_alloc();
@@ -479,6 +952,13 @@ screen_init(struct screen *screen, const struct screen_params *params) {
         goto error_destroy_texture;
     }
 
+    screen->prev_frame = av_frame_alloc();
+    if (!screen->prev_frame) {
+        LOG_OOM();
+        av_frame_free(&screen->frame);
+        goto error_destroy_texture;
+    }
+
     // Reset the window size to trigger a SIZE_CHANGED event, to workaround
     // HiDPI issues with some SDL renderers when several displays having
     // different HiDPI scaling are connected
@@ -509,8 +989,11 @@ screen_init(struct screen *screen, const struct screen_params *params) {
     return true;
 
 error_destroy_texture:
-    SDL_DestroyTexture(screen->texture);
+    texture_pool_clear(screen);
 error_destroy_renderer:
+    if (screen->use_yuv_renderer) {
+        sc_yuv_renderer_destroy(&screen->yuv_renderer);
+    }
     SDL_DestroyRenderer(screen->renderer);
 error_destroy_window:
     SDL_DestroyWindow(screen->window);
@@ -547,13 +1030,39 @@ screen_join(struct screen *screen) {
     fps_counter_join(&screen->fps_counter);
 }
 
+static void
+screen_save_geometry(struct screen *screen) {
+    struct sc_point point = get_window_position(screen);
+    struct sc_size size = get_window_size(screen);
+    if (point.x < INT16_MIN || point.x > INT16_MAX
+            || point.y < INT16_MIN || point.y > INT16_MAX
+            || !size.width || !size.height) {
+        return;
+    }
+
+    struct sc_window_geometry geom = {
+        .x = point.x,
+        .y = point.y,
+        .width = size.width,
+        .height = size.height,
+    };
+    sc_window_geometry_save(screen->serial, &geom);
+}
+
 void
 screen_destroy(struct screen *screen) {
 #ifndef NDEBUG
     assert(!screen->open);
 #endif
+    if (screen->serial && !screen->fullscreen && !screen->maximized) {
+        screen_save_geometry(screen);
+    }
     av_frame_free(&screen->frame);
-    SDL_DestroyTexture(screen->texture);
+    av_frame_free(&screen->prev_frame);
+    texture_pool_clear(screen);
+    if (screen->use_yuv_renderer) {
+        sc_yuv_renderer_destroy(&screen->yuv_renderer);
+    }
     SDL_DestroyRenderer(screen->renderer);
     SDL_DestroyWindow(screen->window);
     fps_counter_destroy(&screen->fps_counter);
@@ -617,67 +1126,453 @@ screen_set_rotation(struct screen *screen, unsigned rotation) {
     screen_render(screen, true);
 }
 
-// recreate the texture and resize the window if the frame size has changed
+#define SC_BUFFERING_STEP SC_TICK_FROM_MS(10)
+
+void
+screen_adjust_buffering(struct screen *screen, bool increase) {
+    if (!sc_video_buffer_is_buffering_enabled(&screen->vb)) {
+        LOGW("Buffering is disabled, it cannot be adjusted live "
+             "(restart with --display-buffer)");
+        return;
+    }
+
+    sc_tick time = sc_video_buffer_get_buffering_time(&screen->vb);
+    if (increase) {
+        time += SC_BUFFERING_STEP;
+    } else if (time > SC_BUFFERING_STEP) {
+        time -= SC_BUFFERING_STEP;
+    } else {
+        // keep a zero buffering time (the thread delivers immediately, it
+        // may not be stopped dynamically)
+        time = 0;
+    }
+
+    // this also disables automatic buffering, if it was enabled
+    bool ok = sc_video_buffer_set_buffering_time(&screen->vb, time);
+    assert(ok);
+    (void) ok;
+
+    LOGI("Display buffer set to %" PRItick " ms", SC_TICK_TO_MS(time));
+}
+
+// indicate whether two sizes have the same aspect ratio, tolerating the
+// rounding to multiples of 8 applied by the server on downscaling
+static bool
+is_same_aspect_ratio(struct sc_size a, struct sc_size b) {
+    int64_t cross = (int64_t) a.width * b.height - (int64_t) a.height * b.width;
+    if (cross < 0) {
+        cross = -cross;
+    }
+    // the minor dimension is rounded to the nearest multiple of 8 (+/-4)
+    return cross <= 4 * ((int64_t) a.width + a.height);
+}
+
+// request the encoder resolution adapted to the current content rectangle
+static void
+screen_request_max_size(struct screen *screen) {
+    assert(screen->controller);
+
+    // round up to the next ladder step, to keep some margin and avoid
+    // restarting the encoder too often
+    uint32_t target = MAX(screen->rect.w, screen->rect.h);
+    target = (target + DYNAMIC_MAX_SIZE_STEP - 1)
+           & ~(DYNAMIC_MAX_SIZE_STEP - 1);
+    if (screen->max_size && target > screen->max_size) {
+        // never exceed the max size explicitly requested by the user
+        target = screen->max_size;
+    }
+    if (target > UINT16_MAX - 7) {
+        target = UINT16_MAX & ~7; // a multiple of 8 fitting in 16 bits
+    }
+
+    if (target == screen->requested_max_size) {
+        return;
+    }
+
+    struct control_msg msg;
+    msg.type = CONTROL_MSG_TYPE_SET_MAX_SIZE;
+    msg.set_max_size.max_size = target;
+
+    if (!controller_push_msg(screen->controller, &msg)) {
+        LOGW("Could not request max size %" PRIu32, target);
+        return;
+    }
+
+    screen->requested_max_size = target;
+}
+
+// switch texture and resize the window if the frame size or pixel format
+// has changed
 static bool
-prepare_for_frame(struct screen *screen, struct sc_size new_frame_size) {
-    if (screen->frame_size.width != new_frame_size.width
-            || screen->frame_size.height != new_frame_size.height) {
-        // frame dimension changed, destroy texture
-        SDL_DestroyTexture(screen->texture);
+prepare_for_frame(struct screen *screen, const AVFrame *frame) {
+    struct sc_size new_frame_size = {frame->width, frame->height};
+    bool size_changed = screen->frame_size.width != new_frame_size.width
+                     || screen->frame_size.height != new_frame_size.height;
+    bool format_changed =
+        screen->frame_format != (enum AVPixelFormat) frame->format;
+    if (!size_changed && !format_changed) {
+        return true;
+    }
+
+    if (format_changed) {
+        screen->frame_format = frame->format;
+        LOGI("Frame format: %s",
+             av_get_pix_fmt_name(screen->frame_format));
 
+        // all the cached textures use the old format
+        texture_pool_clear(screen);
+    }
+
+    if (size_changed) {
         screen->frame_size = new_frame_size;
 
         struct sc_size new_content_size =
             get_rotated_size(new_frame_size, screen->rotation);
-        set_content_size(screen, new_content_size);
+        if (screen->requested_max_size
+                && is_same_aspect_ratio(screen->content_size,
+                                        new_content_size)) {
+            // the new frame size results from a max-size request generated
+            // from the window dimensions, keep the current window size
+            screen->content_size = new_content_size;
+        } else {
+            set_content_size(screen, new_content_size);
+        }
 
         screen_update_content_rect(screen);
+    }
 
-        LOGI("New texture: %" PRIu16 "x%" PRIu16,
-                     screen->frame_size.width, screen->frame_size.height);
-        screen->texture = create_texture(screen);
-        if (!screen->texture) {
-            LOGC("Could not create texture: %s", SDL_GetError());
-            return false;
+    if (screen->use_yuv_renderer) {
+        if (screen->frame_format == AV_PIX_FMT_YUV420P
+                || screen->frame_format == AV_PIX_FMT_NV12) {
+            // the plane textures are resized on upload
+            return true;
+        }
+        LOGW("Frame format not supported by the OpenGL YUV renderer, "
+             "falling back to SDL textures");
+        sc_yuv_renderer_destroy(&screen->yuv_renderer);
+        screen->use_yuv_renderer = false;
+    }
+
+    screen->texture = texture_pool_get(screen);
+    if (!screen->texture) {
+        LOGC("Could not create texture: %s", SDL_GetError());
+        return false;
+    }
+
+    return true;
+}
+
+// find the bounding box of the rows and columns which differ between two
+// planes (coordinates in plane pixels); return false if the planes are equal
+static bool
+plane_diff_bounds(const uint8_t *a, int linesize_a,
+                  const uint8_t *b, int linesize_b,
+                  int width, int height, SDL_Rect *bounds) {
+    int top = 0;
+    while (top < height && !memcmp(a + top * linesize_a,
+                                   b + top * linesize_b, width)) {
+        ++top;
+    }
+    if (top == height) {
+        // the planes are equal
+        return false;
+    }
+
+    int bottom = height - 1;
+    while (bottom > top && !memcmp(a + bottom * linesize_a,
+                                   b + bottom * linesize_b, width)) {
+        --bottom;
+    }
+
+    int left = width;
+    int right = -1;
+    for (int y = top; y <= bottom; ++y) {
+        const uint8_t *row_a = a + y * linesize_a;
+        const uint8_t *row_b = b + y * linesize_b;
+        // only scan beyond the current bounds
+        int x = 0;
+        while (x < left && row_a[x] == row_b[x]) {
+            ++x;
+        }
+        if (x < left) {
+            left = x;
+        }
+        x = width - 1;
+        while (x > right && row_a[x] == row_b[x]) {
+            --x;
         }
+        if (x > right) {
+            right = x;
+        }
+        if (left == 0 && right == width - 1) {
+            // the horizontal bounds cannot grow anymore
+            break;
+        }
+    }
+
+    bounds->x = left;
+    bounds->y = top;
+    bounds->w = right - left + 1;
+    bounds->h = bottom - top + 1;
+    return true;
+}
+
+// compute the bounding box of the pixels which changed between the previous
+// and the current frame, in luma coordinates aligned to the 2x2 chroma
+// subsampling; return false if nothing changed
+static bool
+frame_dirty_rect(const AVFrame *prev, const AVFrame *frame, SDL_Rect *dirty) {
+    assert(frame->format == AV_PIX_FMT_YUV420P);
+
+    int width = frame->width;
+    int height = frame->height;
+    int chroma_width = (width + 1) / 2;
+    int chroma_height = (height + 1) / 2;
+
+    bool has_dirty = plane_diff_bounds(prev->data[0], prev->linesize[0],
+                                       frame->data[0], frame->linesize[0],
+                                       width, height, dirty);
+
+    for (int i = 1; i <= 2; ++i) {
+        SDL_Rect chroma;
+        if (plane_diff_bounds(prev->data[i], prev->linesize[i],
+                              frame->data[i], frame->linesize[i],
+                              chroma_width, chroma_height, &chroma)) {
+            // scale to luma coordinates
+            chroma.x *= 2;
+            chroma.y *= 2;
+            chroma.w *= 2;
+            chroma.h *= 2;
+            if (has_dirty) {
+                SDL_UnionRect(dirty, &chroma, dirty);
+            } else {
+                *dirty = chroma;
+                has_dirty = true;
+            }
+        }
+    }
+
+    if (!has_dirty) {
+        return false;
     }
 
+    // align to even coordinates so that the rect maps exactly to chroma
+    // samples
+    dirty->w += dirty->x % 2;
+    dirty->h += dirty->y % 2;
+    dirty->x -= dirty->x % 2;
+    dirty->y -= dirty->y % 2;
+    dirty->w += dirty->w % 2;
+    dirty->h += dirty->h % 2;
+    if (dirty->x + dirty->w > width) {
+        dirty->w = width - dirty->x;
+    }
+    if (dirty->y + dirty->h > height) {
+        dirty->h = height - dirty->y;
+    }
     return true;
 }
 
 // write the frame into the texture
 static void
 update_texture(struct screen *screen, const AVFrame *frame) {
-    SDL_UpdateYUVTexture(screen->texture, NULL,
-            frame->data[0], frame->linesize[0],
-            frame->data[1], frame->linesize[1],
-            frame->data[2], frame->linesize[2]);
+    // compute the dirty rectangle when the previous frame is comparable
+    // (most frames, except the first one and on size or format changes)
+    SDL_Rect dirty;
+    bool partial = false;
+    if (screen->frame_format == AV_PIX_FMT_YUV420P
+            && screen->prev_frame->data[0]
+            && screen->prev_frame->width == frame->width
+            && screen->prev_frame->height == frame->height
+            && screen->prev_frame->format == frame->format) {
+        if (!frame_dirty_rect(screen->prev_frame, frame, &dirty)) {
+            // nothing changed, keep the texture content
+            return;
+        }
+        partial = dirty.x != 0 || dirty.y != 0
+               || dirty.w != frame->width || dirty.h != frame->height;
+    }
 
-    if (screen->mipmaps) {
+    // keep a reference for the next diff (cheap, the frame is refcounted)
+    av_frame_unref(screen->prev_frame);
+    if (av_frame_ref(screen->prev_frame, frame)) {
+        LOG_OOM();
+        // not fatal, the next update will be a full upload
+    }
+
+    if (screen->use_yuv_renderer) {
+        // the PBO upload is asynchronous, always upload the full planes
+        if (screen->frame_format == AV_PIX_FMT_NV12) {
+            sc_yuv_renderer_upload_nv12(&screen->yuv_renderer,
+                                        screen->frame_size,
+                                        (const uint8_t *const *) frame->data,
+                                        frame->linesize);
+            return;
+        }
+        assert(screen->frame_format == AV_PIX_FMT_YUV420P);
+        sc_yuv_renderer_upload(&screen->yuv_renderer, screen->frame_size,
+                               (const uint8_t *const *) frame->data,
+                               frame->linesize);
+        return;
+    }
+
+#ifdef SCRCPY_SDL_HAS_UPDATE_NV_TEXTURE
+    if (screen->frame_format == AV_PIX_FMT_NV12) {
+        SDL_UpdateNVTexture(screen->texture, NULL,
+                frame->data[0], frame->linesize[0],
+                frame->data[1], frame->linesize[1]);
+    } else
+#endif
+    if (partial) {
+        // upload only the changed region, the plane pointers must point to
+        // the first pixel of the rect
+        SDL_UpdateYUVTexture(screen->texture, &dirty,
+                frame->data[0] + dirty.y * frame->linesize[0] + dirty.x,
+                frame->linesize[0],
+                frame->data[1] + dirty.y / 2 * frame->linesize[1] + dirty.x / 2,
+                frame->linesize[1],
+                frame->data[2] + dirty.y / 2 * frame->linesize[2] + dirty.x / 2,
+                frame->linesize[2]);
+    } else {
+        assert(screen->frame_format == AV_PIX_FMT_YUV420P);
+        SDL_UpdateYUVTexture(screen->texture, NULL,
+                frame->data[0], frame->linesize[0],
+                frame->data[1], frame->linesize[1],
+                frame->data[2], frame->linesize[2]);
+    }
+
+    if (screen->mipmaps_active) {
         SDL_GL_BindTexture(screen->texture, NULL, NULL);
         screen->gl.GenerateMipmap(GL_TEXTURE_2D);
         SDL_GL_UnbindTexture(screen->texture);
     }
 }
 
+#define SC_LATENCY_PROBE_INTERVAL SC_TICK_FROM_MS(500)
+#define SC_LATENCY_LOG_INTERVAL SC_TICK_FROM_SEC(2)
+
+// Measure and periodically report the capture-to-present latency of the
+// rendered frames.
+//
+// The frame PTS is a capture date in the device clock; the offset between
+// the device and client clocks is estimated from periodic probes echoed by
+// the device over the control socket (see DEVICE_MSG_TYPE_CLOCK_SYNC).
+static void
+screen_log_latency(struct screen *screen, const AVFrame *frame) {
+    sc_tick now = sc_tick_now();
+
+    if (now >= screen->clock_probe_date) {
+        struct control_msg msg;
+        msg.type = CONTROL_MSG_TYPE_CLOCK_SYNC;
+        msg.clock_sync.client_time = (uint64_t) now;
+        if (controller_push_msg(screen->controller, &msg)) {
+            screen->clock_probe_date = now + SC_LATENCY_PROBE_INTERVAL;
+        }
+    }
+
+    sc_tick offset;
+    if (!controller_get_device_clock_offset(screen->controller, &offset)) {
+        // no clock sync reply received yet
+        return;
+    }
+
+    // the PTS is expressed in microseconds of the device clock
+    sc_tick capture = SC_TICK_FROM_US(frame->pts) - offset;
+    sc_tick latency = now - capture;
+    if (latency < 0) {
+        // the clock estimation error exceeds the latency, ignore the sample
+        return;
+    }
+
+    sc_histogram_add(&screen->latency, (uint64_t) latency);
+
+    if (!screen->latency_log_date) {
+        screen->latency_log_date = now + SC_LATENCY_LOG_INTERVAL;
+    } else if (now >= screen->latency_log_date) {
+        double p50 = SC_TICK_TO_US(sc_histogram_percentile(&screen->latency,
+                                                           50)) / 1000.;
+        double p95 = SC_TICK_TO_US(sc_histogram_percentile(&screen->latency,
+                                                           95)) / 1000.;
+        double p99 = SC_TICK_TO_US(sc_histogram_percentile(&screen->latency,
+                                                           99)) / 1000.;
+        LOGI("Latency (capture to present): p50=%.1fms p95=%.1fms p99=%.1fms",
+             p50, p95, p99);
+        sc_histogram_clear(&screen->latency);
+        screen->latency_log_date = now + SC_LATENCY_LOG_INTERVAL;
+    }
+}
+
+// upload the last consumed frame to the texture and present it
 static bool
-screen_update_frame(struct screen *screen) {
-    av_frame_unref(screen->frame);
-    sc_video_buffer_consume(&screen->vb, screen->frame);
+screen_apply_frame(struct screen *screen) {
     AVFrame *frame = screen->frame;
 
     fps_counter_add_rendered_frame(&screen->fps_counter);
+    sc_stats_add(SC_STAT_FRAMES_RENDERED, 1);
 
-    struct sc_size new_frame_size = {frame->width, frame->height};
-    if (!prepare_for_frame(screen, new_frame_size)) {
+    if (!prepare_for_frame(screen, frame)) {
         return false;
     }
     update_texture(screen, frame);
 
     screen_render(screen, false);
+
+    if (screen->print_latency && screen->controller) {
+        screen_log_latency(screen, frame);
+    }
+
+    if (screen->vsync_interval) {
+        screen->next_present_date = sc_tick_now() + screen->vsync_interval;
+    }
+
     return true;
 }
 
+static bool
+screen_update_frame(struct screen *screen) {
+    // clear the flag before consuming, so that a frame pushed in between
+    // posts a new wake-up event (which may then find nothing to consume)
+    atomic_store(&screen->frame_pending, false);
+
+    av_frame_unref(screen->frame);
+    if (!sc_video_buffer_consume(&screen->vb, screen->frame)) {
+        // the frame was already consumed by a previous event
+        return true;
+    }
+
+    if (!screen->visible) {
+        // do not upload and render frames nobody can see, the last frame
+        // will be applied on restore
+        screen->render_pending = true;
+        fps_counter_add_skipped_frame(&screen->fps_counter);
+        sc_stats_add(SC_STAT_FRAMES_SKIPPED, 1);
+        return true;
+    }
+
+    sc_tick now = sc_tick_now();
+    if (screen->vsync_interval && now < screen->next_present_date) {
+        // too early: defer the upload and present to the vsync deadline, so
+        // that only the newest frame available at that date is rendered
+        if (screen->present_scheduled) {
+            // this frame replaces one which will never be presented
+            fps_counter_add_skipped_frame(&screen->fps_counter);
+            sc_stats_add(SC_STAT_FRAMES_SKIPPED, 1);
+            return true;
+        }
+        uint32_t delay = SC_TICK_TO_MS(screen->next_present_date - now);
+        if (!delay) {
+            delay = 1;
+        }
+        if (SDL_AddTimer(delay, present_timer_cb, screen)) {
+            screen->present_scheduled = true;
+            return true;
+        }
+        // on timer failure, present immediately
+    }
+
+    return screen_apply_frame(screen);
+}
+
 void
 screen_switch_fullscreen(struct screen *screen) {
     uint32_t new_mode = screen->fullscreen ? 0 : SDL_WINDOW_FULLSCREEN_DESKTOP;
@@ -740,6 +1635,10 @@ bool
 screen_handle_event(struct screen *screen, SDL_Event *event) {
     switch (event->type) {
         case EVENT_NEW_FRAME:
+            if (event->user.data1 != screen) {
+                // targeted at another screen
+                return false;
+            }
             if (!screen->has_frame) {
                 screen->has_frame = true;
                 // this is the very first frame, show the window
@@ -750,21 +1649,65 @@ screen_handle_event(struct screen *screen, SDL_Event *event) {
                 LOGW("Frame update failed\n");
             }
             return true;
+        case EVENT_PRESENT_FRAME:
+            if (event->user.data1 != screen) {
+                // targeted at another screen
+                return false;
+            }
+            screen->present_scheduled = false;
+            if (!screen->visible) {
+                // the frame will be applied on restore
+                screen->render_pending = true;
+                return true;
+            }
+            if (!screen_apply_frame(screen)) {
+                LOGW("Frame update failed\n");
+            }
+            return true;
         case SDL_WINDOWEVENT:
+            if (event->window.windowID != SDL_GetWindowID(screen->window)) {
+                // targeted at another screen
+                return false;
+            }
             if (!screen->has_frame) {
                 // Do nothing
                 return true;
             }
             switch (event->window.event) {
                 case SDL_WINDOWEVENT_EXPOSED:
-                    screen_render(screen, true);
+                    screen->visible = true;
+                    screen_set_stream_paused(screen, false);
+                    if (screen->render_pending) {
+                        // apply the frame received while not visible
+                        screen->render_pending = false;
+                        screen_apply_frame(screen);
+                    } else {
+                        screen_render(screen, true);
+                    }
                     break;
                 case SDL_WINDOWEVENT_SIZE_CHANGED:
                     screen_render(screen, true);
+                    if (screen->controller && screen->dynamic_max_size) {
+                        // adapt the stream resolution to the new window size
+                        screen_request_max_size(screen);
+                    }
                     break;
                 case SDL_WINDOWEVENT_MAXIMIZED:
                     screen->maximized = true;
                     break;
+                case SDL_WINDOWEVENT_FOCUS_GAINED:
+                    screen_on_focus_changed(screen, true);
+                    break;
+                case SDL_WINDOWEVENT_FOCUS_LOST:
+                    screen_on_focus_changed(screen, false);
+                    break;
+                case SDL_WINDOWEVENT_MINIMIZED:
+                case SDL_WINDOWEVENT_HIDDEN:
+                    screen->visible = false;
+                    // stop the device encoder while the content cannot be
+                    // seen (it restarts with a keyframe on resume)
+                    screen_set_stream_paused(screen, true);
+                    break;
                 case SDL_WINDOWEVENT_RESTORED:
                     if (screen->fullscreen) {
                         // On Windows, in maximized+fullscreen, disabling
@@ -775,8 +1718,16 @@ screen_handle_event(struct screen *screen, SDL_Event *event) {
                         break;
                     }
                     screen->maximized = false;
+                    screen->visible = true;
+                    screen_set_stream_paused(screen, false);
                     apply_pending_resize(screen);
-                    screen_render(screen, true);
+                    if (screen->render_pending) {
+                        // apply the frame received while not visible
+                        screen->render_pending = false;
+                        screen_apply_frame(screen);
+                    } else {
+                        screen_render(screen, true);
+                    }
                     break;
             }
             return true;
@@ -3,16 +3,20 @@
 
 #include "common.h"
 
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <SDL2/SDL.h>
 #include <libavformat/avformat.h>
 
 #include "coords.h"
 #include "fps_counter.h"
+#include "util/histogram.h"
 #include "opengl.h"
 #include "trait/frame_sink.h"
 #include "video_buffer.h"
 
+struct controller;
+
 struct screen {
     struct sc_frame_sink frame_sink; // frame sink trait
 
@@ -26,9 +30,26 @@ struct screen {
     SDL_Window *window;
     SDL_Renderer *renderer;
     SDL_Texture *texture;
+    // cache one texture per recent frame size (typically the portrait and
+    // landscape dimensions), so that a rotation switches back to an existing
+    // texture without any GPU allocation on the hot path
+#define SC_TEXTURE_POOL_LEN 2
+    struct {
+        struct {
+            struct sc_size size;
+            SDL_Texture *texture;
+        } entries[SC_TEXTURE_POOL_LEN];
+        unsigned next; // next slot to evict
+    } texture_pool;
     struct sc_opengl gl;
+    // shader-based YUV renderer, when the SDL renderer backend is OpenGL
+    // (SDL_UpdateYUVTexture does a CPU conversion on some drivers)
+    struct sc_yuv_renderer yuv_renderer;
+    bool use_yuv_renderer;
     struct sc_size frame_size;
     struct sc_size content_size; // rotated frame_size
+    // pixel format of the incoming frames (and of the texture)
+    enum AVPixelFormat frame_format;
 
     bool resize_pending; // resize requested while fullscreen or maximized
     // The content size the last time the window was not maximized or
@@ -39,17 +60,93 @@ struct screen {
     unsigned rotation;
     // rectangle of the content (excluding black borders)
     struct SDL_Rect rect;
+    // the drawable and content sizes the rectangle was computed from, to
+    // avoid recomputing it on every resize event when nothing changed
+    struct sc_size rect_drawable_size;
+    struct sc_size rect_content_size;
+    // date of the last render triggered by a continuous-resize event, to
+    // present at most once per display refresh while dragging a window border
+    sc_tick last_resize_render;
     bool has_frame;
+    // false while the window is minimized or hidden: new frames are consumed
+    // but neither uploaded nor presented (no GPU work for invisible content)
+    bool visible;
+    // a frame was received while not visible, to be rendered on restore
+    bool render_pending;
+    // the device encoder is paused while the window is minimized (only if a
+    // controller is available)
+    bool stream_paused;
     bool fullscreen;
     bool maximized;
-    bool mipmaps;
+    bool mipmaps; // trilinear filtering requested and supported
+    // With the -1 LOD bias, mip levels above 0 are only sampled once the
+    // content is downscaled by more than 2x, so mipmap generation (pure GPU
+    // cost on every frame) is enabled only past that threshold
+    bool mipmaps_active;
+
+    // a new-frame wake-up event is in flight; frames pushed while it is set
+    // coalesce into it without touching the SDL event queue
+    atomic_bool frame_pending;
+
+    // Present pacing: when the decoder briefly outruns the display, frames
+    // rendered in between two vsyncs are replaced before they are ever seen,
+    // so only the newest frame per refresh interval is uploaded and presented
+    sc_tick vsync_interval; // 0 if the display refresh rate is unknown
+    sc_tick next_present_date; // do not present again before this date
+    // a deferred present is armed (EVENT_PRESENT_FRAME); frames consumed
+    // while it is set only replace the frame to be presented
+    bool present_scheduled;
+
+    // device serial, used to persist the window geometry (may be NULL)
+    const char *serial;
+
+    // to send adaptation requests to the device encoder (may be NULL)
+    struct controller *controller;
+    // request encoder max-size changes on window resize
+    bool dynamic_max_size;
+    // the max size requested by the user (0 for no limit), used as a ceiling
+    // for dynamic max-size requests
+    uint16_t max_size;
+    // the last dynamically requested max size (0 if none)
+    uint16_t requested_max_size;
 
-    bool event_failed; // in case SDL_PushEvent() returned an error
+    // consumer-driven flow control: when the renderer skips too many frames,
+    // request a reduced encoder frame rate (see screen_adapt_max_fps())
+    uint16_t max_fps; // the max fps requested by the user (0 for no limit)
+    uint16_t reduced_max_fps; // the last reduction requested (0 if none)
+    // frame rate requested while the window has no focus (0 to keep the
+    // nominal rate)
+    uint16_t max_fps_unfocused;
+    bool focused;
+    unsigned adapt_frames; // frames received in the current window
+    unsigned adapt_skipped; // frames skipped in the current window
+    sc_tick adapt_window_start;
+
+    // capture-to-present latency measurement (see screen_log_latency())
+    bool print_latency;
+    struct sc_histogram latency;
+    sc_tick latency_log_date; // date of the next latency report
+    sc_tick clock_probe_date; // date of the next clock sync probe
 
     AVFrame *frame;
+    // the previously uploaded frame, kept to compute the dirty rectangle
+    // (the region which changed since the last upload)
+    AVFrame *prev_frame;
+};
+
+// A hidden window and its renderer created ahead of time, while the server
+// connection is in progress (the GL context creation alone may take hundreds
+// of milliseconds), to be adopted by screen_init()
+struct screen_prewarm {
+    SDL_Window *window;
+    SDL_Renderer *renderer;
 };
 
 struct screen_params {
+    // if not NULL, restore (and save on exit) the window geometry used the
+    // last time for this device
+    const char *serial;
+
     const char *window_title;
     struct sc_size frame_size;
     bool always_on_top;
@@ -67,8 +164,36 @@ struct screen_params {
     bool fullscreen;
 
     sc_tick buffering_time;
+    // adapt the buffering time dynamically to the measured jitter
+    bool buffering_auto;
+
+    // if not NULL, used to send adaptation requests to the device encoder
+    struct controller *controller;
+    bool dynamic_max_size;
+    uint16_t max_size;
+    uint16_t max_fps;
+    uint16_t max_fps_unfocused;
+    // measure and log the capture-to-present latency (requires a controller)
+    bool print_latency;
+
+    // if set, the window and renderer it holds are consumed instead of
+    // creating new ones
+    struct screen_prewarm *prewarm;
 };
 
+// Create the window (hidden, with a placeholder title and size) and its
+// renderer before the device size is known
+//
+// On failure, the prewarm is left empty and screen_init() creates its own
+// window, so the result may be ignored.
+bool
+screen_prewarm(struct screen_prewarm *prewarm, bool always_on_top,
+               bool window_borderless);
+
+// destroy the window and renderer, if they have not been consumed
+void
+screen_prewarm_discard(struct screen_prewarm *prewarm);
+
 // initialize screen, create window, renderer and texture (window is hidden)
 bool
 screen_init(struct screen *screen, const struct screen_params *params);
@@ -109,6 +234,11 @@ screen_resize_to_pixel_perfect(struct screen *screen);
 void
 screen_set_rotation(struct screen *screen, unsigned rotation);
 
+// increase or decrease the display buffering time by one step (no-op with a
+// warning if the display buffer is disabled)
+void
+screen_adjust_buffering(struct screen *screen, bool increase);
+
 // react to SDL events
 bool
 screen_handle_event(struct screen *screen, SDL_Event *event);
@@ -0,0 +1,246 @@
+#include "screenshot.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <time.h>
+#include <libavcodec/avcodec.h>
+#include <libswscale/swscale.h>
+
+#include "util/log.h"
+#include "util/tick.h"
+
+static bool
+sc_screenshot_write_file(const char *filename, const AVPacket *packet) {
+    FILE *file = fopen(filename, "wb");
+    if (!file) {
+        LOGE("Could not open screenshot file: %s", filename);
+        return false;
+    }
+
+    size_t w = fwrite(packet->data, 1, packet->size, file);
+    fclose(file);
+
+    if (w != (size_t) packet->size) {
+        LOGE("Could not write screenshot file: %s", filename);
+        return false;
+    }
+
+    return true;
+}
+
+static bool
+sc_screenshot_save(const AVFrame *frame, const char *filename) {
+    bool ret = false;
+
+    const AVCodec *codec = avcodec_find_encoder(AV_CODEC_ID_PNG);
+    if (!codec) {
+        LOGE("PNG encoder not found");
+        return false;
+    }
+
+    AVCodecContext *ctx = avcodec_alloc_context3(codec);
+    if (!ctx) {
+        LOG_OOM();
+        return false;
+    }
+
+    ctx->width = frame->width;
+    ctx->height = frame->height;
+    ctx->pix_fmt = AV_PIX_FMT_RGB24;
+    ctx->time_base = (AVRational) {1, 1};
+
+    if (avcodec_open2(ctx, codec, NULL) < 0) {
+        LOGE("Could not open PNG encoder");
+        goto free_ctx;
+    }
+
+    AVFrame *rgb = av_frame_alloc();
+    if (!rgb) {
+        LOG_OOM();
+        goto free_ctx;
+    }
+
+    rgb->width = frame->width;
+    rgb->height = frame->height;
+    rgb->format = AV_PIX_FMT_RGB24;
+    if (av_frame_get_buffer(rgb, 0) < 0) {
+        LOG_OOM();
+        goto free_rgb;
+    }
+
+    struct SwsContext *sws_ctx =
+        sws_getContext(frame->width, frame->height, frame->format,
+                       rgb->width, rgb->height, AV_PIX_FMT_RGB24,
+                       SWS_BILINEAR, NULL, NULL, NULL);
+    if (!sws_ctx) {
+        LOGE("Could not create converter context");
+        goto free_rgb;
+    }
+
+    sws_scale(sws_ctx, (const uint8_t *const *) frame->data, frame->linesize,
+              0, frame->height, rgb->data, rgb->linesize);
+    sws_freeContext(sws_ctx);
+
+    AVPacket *packet = av_packet_alloc();
+    if (!packet) {
+        LOG_OOM();
+        goto free_rgb;
+    }
+
+    if (avcodec_send_frame(ctx, rgb) < 0
+            || avcodec_receive_packet(ctx, packet) < 0) {
+        LOGE("Could not encode screenshot");
+        goto free_packet;
+    }
+
+    ret = sc_screenshot_write_file(filename, packet);
+
+free_packet:
+    av_packet_free(&packet);
+free_rgb:
+    av_frame_free(&rgb);
+free_ctx:
+    avcodec_free_context(&ctx);
+
+    return ret;
+}
+
+static void
+sc_screenshot_build_filename(char *buf, size_t buf_size) {
+    time_t now = time(NULL);
+    struct tm *tm = localtime(&now);
+
+    // keep a tick-based suffix so that several screenshots within the same
+    // second get distinct names
+    snprintf(buf, buf_size,
+             "scrcpy-%04d%02d%02d-%02d%02d%02d-%03" PRItick ".png",
+             tm->tm_year + 1900, tm->tm_mon + 1, tm->tm_mday, tm->tm_hour,
+             tm->tm_min, tm->tm_sec, SC_TICK_TO_MS(sc_tick_now()) % 1000);
+}
+
+static int
+run_screenshot(void *data) {
+    struct sc_screenshot *ss = data;
+
+    sc_thread_apply_role(SC_THREAD_ROLE_IO);
+
+    for (;;) {
+        sc_mutex_lock(&ss->mutex);
+        while (!ss->stopped && cbuf_is_empty(&ss->queue)) {
+            sc_cond_wait(&ss->event_cond, &ss->mutex);
+        }
+        if (ss->stopped && cbuf_is_empty(&ss->queue)) {
+            // stop only once all pending screenshots are saved
+            sc_mutex_unlock(&ss->mutex);
+            break;
+        }
+        AVFrame *frame;
+        bool non_empty = cbuf_take(&ss->queue, &frame);
+        assert(non_empty);
+        (void) non_empty;
+        sc_mutex_unlock(&ss->mutex);
+
+        char filename[128];
+        sc_screenshot_build_filename(filename, sizeof(filename));
+
+        if (sc_screenshot_save(frame, filename)) {
+            LOGI("Screenshot saved to %s", filename);
+        }
+
+        av_frame_free(&frame);
+    }
+    return 0;
+}
+
+bool
+sc_screenshot_init(struct sc_screenshot *ss) {
+    cbuf_init(&ss->queue);
+
+    bool ok = sc_mutex_init(&ss->mutex);
+    if (!ok) {
+        return false;
+    }
+
+    ok = sc_cond_init(&ss->event_cond);
+    if (!ok) {
+        sc_mutex_destroy(&ss->mutex);
+        return false;
+    }
+
+    // lazy thread start, on the first request
+    ss->initialized = false;
+    ss->stopped = false;
+
+    return true;
+}
+
+void
+sc_screenshot_destroy(struct sc_screenshot *ss) {
+    sc_cond_destroy(&ss->event_cond);
+    sc_mutex_destroy(&ss->mutex);
+
+    AVFrame *frame;
+    while (cbuf_take(&ss->queue, &frame)) {
+        av_frame_free(&frame);
+    }
+}
+
+static bool
+sc_screenshot_start(struct sc_screenshot *ss) {
+    LOGD("Starting screenshot thread");
+
+    bool ok = sc_thread_create(&ss->thread, run_screenshot, "screenshot", ss);
+    if (!ok) {
+        LOGC("Could not start screenshot thread");
+        return false;
+    }
+
+    return true;
+}
+
+void
+sc_screenshot_stop(struct sc_screenshot *ss) {
+    sc_mutex_lock(&ss->mutex);
+    ss->stopped = true;
+    sc_cond_signal(&ss->event_cond);
+    sc_mutex_unlock(&ss->mutex);
+}
+
+void
+sc_screenshot_join(struct sc_screenshot *ss) {
+    if (ss->initialized) {
+        sc_thread_join(&ss->thread, NULL);
+    }
+}
+
+bool
+sc_screenshot_request(struct sc_screenshot *ss, const AVFrame *frame) {
+    // start the thread if it is used for the first time
+    if (!ss->initialized) {
+        if (!sc_screenshot_start(ss)) {
+            return false;
+        }
+        ss->initialized = true;
+    }
+
+    AVFrame *clone = av_frame_clone(frame);
+    if (!clone) {
+        LOG_OOM();
+        return false;
+    }
+
+    sc_mutex_lock(&ss->mutex);
+    bool was_empty = cbuf_is_empty(&ss->queue);
+    bool res = cbuf_push(&ss->queue, clone);
+    if (was_empty) {
+        sc_cond_signal(&ss->event_cond);
+    }
+    sc_mutex_unlock(&ss->mutex);
+
+    if (!res) {
+        LOGW("Screenshot queue full, screenshot dropped");
+        av_frame_free(&clone);
+    }
+
+    return res;
+}
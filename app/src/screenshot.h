@@ -0,0 +1,51 @@
+#ifndef SC_SCREENSHOT_H
+#define SC_SCREENSHOT_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <libavformat/avformat.h>
+
+#include "util/cbuf.h"
+#include "util/thread.h"
+
+struct sc_screenshot_queue CBUF(AVFrame *, 4);
+
+/**
+ * Save screenshots of the mirrored video, without any device round-trip.
+ *
+ * A screenshot request snapshots the last decoded frame (a cheap AVFrame
+ * reference) and returns immediately; a background thread converts it and
+ * encodes it to a PNG file, so the render loop is never blocked.
+ */
+struct sc_screenshot {
+    sc_thread thread;
+    sc_mutex mutex;
+    sc_cond event_cond;
+    bool stopped;
+    bool initialized;
+    struct sc_screenshot_queue queue;
+};
+
+bool
+sc_screenshot_init(struct sc_screenshot *ss);
+
+void
+sc_screenshot_destroy(struct sc_screenshot *ss);
+
+void
+sc_screenshot_stop(struct sc_screenshot *ss);
+
+void
+sc_screenshot_join(struct sc_screenshot *ss);
+
+/**
+ * Request to save a screenshot of `frame`
+ *
+ * Take a reference on the frame content (without copying the pixels), the
+ * caller keeps the ownership of `frame` itself.
+ */
+bool
+sc_screenshot_request(struct sc_screenshot *ss, const AVFrame *frame);
+
+#endif
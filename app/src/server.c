@@ -8,6 +8,7 @@
 #include <SDL2/SDL_platform.h>
 
 #include "adb.h"
+#include "util/cmd_builder.h"
 #include "util/file.h"
 #include "util/log.h"
 #include "util/net_intr.h"
@@ -18,6 +19,9 @@
 
 #define SC_SERVER_PATH_DEFAULT PREFIX "/share/scrcpy/" SC_SERVER_FILENAME
 #define SC_DEVICE_SERVER_PATH "/data/local/tmp/scrcpy-server.jar"
+// hash of the last pushed server, to skip the push when the device copy is
+// already current
+#define SC_DEVICE_SERVER_SUM_PATH SC_DEVICE_SERVER_PATH ".sum"
 
 static char *
 get_server_path(void) {
@@ -114,8 +118,45 @@ push_server(struct sc_intr *intr, const char *serial) {
         free(server_path);
         return false;
     }
+
+    uint64_t hash;
+    bool has_hash = sc_file_hash(server_path, &hash);
+    char sum[17];
+    if (has_hash) {
+        snprintf(sum, sizeof(sum), "%016" PRIx64, hash);
+
+        // Compare with the device copy in a single shell round-trip (also
+        // check that the server file itself is still present); any failure
+        // just causes a normal push
+        char *device_sum = adb_shell(intr, serial,
+                                     "test -f " SC_DEVICE_SERVER_PATH
+                                     " && cat " SC_DEVICE_SERVER_SUM_PATH
+                                     " 2>/dev/null", SC_ADB_SILENT);
+        if (device_sum) {
+            bool up_to_date = !strcmp(device_sum, sum);
+            free(device_sum);
+            if (up_to_date) {
+                LOGD("Device server copy up to date, push skipped");
+                free(server_path);
+                return true;
+            }
+        }
+    }
+
     bool ok = adb_push(intr, serial, server_path, SC_DEVICE_SERVER_PATH, 0);
     free(server_path);
+
+    if (ok && has_hash) {
+        // remember the pushed content for the next launches (best effort)
+        char cmd[128];
+        int len = snprintf(cmd, sizeof(cmd),
+                           "echo %s > " SC_DEVICE_SERVER_SUM_PATH, sum);
+        assert(len > 0 && (size_t) len < sizeof(cmd));
+        (void) len;
+        char *out = adb_shell(intr, serial, cmd, SC_ADB_SILENT);
+        free(out);
+    }
+
     return ok;
 }
 
@@ -138,6 +179,21 @@ log_level_to_server_string(enum sc_log_level level) {
     }
 }
 
+static const char *
+codec_to_server_string(enum sc_codec codec) {
+    switch (codec) {
+        case SC_CODEC_H264:
+            return "h264";
+        case SC_CODEC_H265:
+            return "h265";
+        case SC_CODEC_AV1:
+            return "av1";
+        default:
+            assert(!"unexpected codec");
+            return "(unknown)";
+    }
+}
+
 static bool
 sc_server_sleep(struct sc_server *server, sc_tick deadline) {
     sc_mutex_lock(&server->mutex);
@@ -157,15 +213,26 @@ execute_server(struct sc_server *server,
                const struct sc_server_params *params) {
     sc_pid pid = SC_PROCESS_NONE;
 
-    const char *cmd[128];
-    unsigned count = 0;
-    cmd[count++] = "shell";
-    cmd[count++] = "CLASSPATH=" SC_DEVICE_SERVER_PATH;
-    cmd[count++] = "app_process";
+    // all the parameters are copied into a single arena, so the whole command
+    // is built with at most one allocation (instead of one per parameter)
+    struct sc_cmd_builder builder;
+    if (!sc_cmd_builder_init(&builder, 256)) {
+        return SC_PROCESS_NONE;
+    }
+
+#define ADD_PARAM(fmt, ...) \
+    if (!sc_cmd_builder_addf(&builder, fmt, ## __VA_ARGS__)) { \
+        goto end; \
+    }
+#define STRBOOL(v) (v ? "true" : "false")
+
+    ADD_PARAM("shell");
+    ADD_PARAM("CLASSPATH=" SC_DEVICE_SERVER_PATH);
+    ADD_PARAM("app_process");
 
 #ifdef SERVER_DEBUGGER
 # define SERVER_DEBUGGER_PORT "5005"
-    cmd[count++] =
+    ADD_PARAM(
 # ifdef SERVER_DEBUGGER_METHOD_NEW
         /* Android 9 and above */
         "-XjdwpProvider:internal -XjdwpOptions:transport=dt_socket,suspend=y,"
@@ -174,25 +241,18 @@ execute_server(struct sc_server *server,
         /* Android 8 and below */
         "-agentlib:jdwp=transport=dt_socket,suspend=y,server=y,address="
 # endif
-            SERVER_DEBUGGER_PORT;
+            SERVER_DEBUGGER_PORT);
 #endif
-    cmd[count++] = "/"; // unused
-    cmd[count++] = "com.genymobile.scrcpy.Server";
-    cmd[count++] = SCRCPY_VERSION;
-
-    unsigned dyn_idx = count; // from there, the strings are allocated
-#define ADD_PARAM(fmt, ...) { \
-        char *p = (char *) &cmd[count]; \
-        if (asprintf(&p, fmt, ## __VA_ARGS__) == -1) { \
-            goto end; \
-        } \
-        cmd[count++] = p; \
-    }
-#define STRBOOL(v) (v ? "true" : "false")
+    ADD_PARAM("/"); // unused
+    ADD_PARAM("com.genymobile.scrcpy.Server");
+    ADD_PARAM(SCRCPY_VERSION);
 
     ADD_PARAM("log_level=%s", log_level_to_server_string(params->log_level));
     ADD_PARAM("bit_rate=%" PRIu32, params->bit_rate);
 
+    if (params->codec != SC_CODEC_H264) {
+        ADD_PARAM("codec=%s", codec_to_server_string(params->codec));
+    }
     if (params->max_size) {
         ADD_PARAM("max_size=%" PRIu16, params->max_size);
     }
@@ -213,7 +273,24 @@ execute_server(struct sc_server *server,
         // By default, control is true
         ADD_PARAM("control=%s", STRBOOL(params->control));
     }
-    if (params->display_id) {
+    if (params->audio) {
+        ADD_PARAM("audio=%s", STRBOOL(params->audio));
+    }
+    if (!params->send_frame_meta) {
+        // By default, send_frame_meta is true
+        ADD_PARAM("send_frame_meta=%s", STRBOOL(params->send_frame_meta));
+    }
+    if (params->secondary_display_count) {
+        // primary + secondary display ids, comma-separated
+        char ids[128];
+        int w = snprintf(ids, sizeof(ids), "%" PRIu32, params->display_id);
+        for (unsigned i = 0; i < params->secondary_display_count; ++i) {
+            w += snprintf(ids + w, sizeof(ids) - w, ",%" PRIu32,
+                          params->secondary_display_ids[i]);
+        }
+        assert((size_t) w < sizeof(ids));
+        ADD_PARAM("display_id=%s", ids);
+    } else if (params->display_id) {
         ADD_PARAM("display_id=%" PRIu32, params->display_id);
     }
     if (params->show_touches) {
@@ -235,6 +312,12 @@ execute_server(struct sc_server *server,
         // By defaut, clipboard_autosync is true
         ADD_PARAM("clipboard_autosync=%s", STRBOOL(params->clipboard_autosync));
     }
+    if (params->daemon) {
+        ADD_PARAM("daemon=%s", STRBOOL(params->daemon));
+    }
+    if (params->direct_tcp_port) {
+        ADD_PARAM("listen_port=%" PRIu16, params->direct_tcp_port);
+    }
 
 #undef ADD_PARAM
 #undef STRBOOL
@@ -250,17 +333,77 @@ execute_server(struct sc_server *server,
     //     Port: 5005
     // Then click on "Debug"
 #endif
-    // Inherit both stdout and stderr (all server logs are printed to stdout)
-    pid = adb_execute(params->serial, cmd, count, 0);
+    if (server->tunnel.forward && !params->daemon) {
+        // Capture stdout to detect the readiness marker printed by the
+        // server once its socket is listening (the output is then forwarded
+        // to our stdout, see sc_server_wait_ready())
+        //
+        // In daemon mode, the server outlives this client, so no thread can
+        // keep consuming a captured pipe: stdio is inherited and readiness is
+        // detected by the connection retry loop instead
+        pid = adb_execute_p(params->serial, sc_cmd_builder_get_argv(&builder),
+                            builder.count, 0, &server->stdout_pipe);
+        server->has_stdout_pipe = pid != SC_PROCESS_NONE;
+    } else {
+        // Inherit both stdout and stderr (all server logs are printed to
+        // stdout)
+        pid = adb_execute(params->serial, sc_cmd_builder_get_argv(&builder),
+                          builder.count, 0);
+    }
 
 end:
-    for (unsigned i = dyn_idx; i < count; ++i) {
-        free((char *) cmd[i]);
-    }
+    sc_cmd_builder_destroy(&builder);
 
     return pid;
 }
 
+// marker printed (via Ln) by the server in forward-tunnel mode once its
+// socket is listening, so that the client connects without polling
+#define SC_SERVER_READY_MARKER "Listening on scrcpy socket"
+
+static int
+run_forward_stdout(void *data) {
+    struct sc_server *server = data;
+
+    char buf[256];
+    ssize_t r;
+    while ((r = sc_pipe_read(server->stdout_pipe, buf, sizeof(buf))) > 0) {
+        fwrite(buf, 1, r, stdout);
+        fflush(stdout);
+    }
+
+    return 0;
+}
+
+static bool
+sc_server_wait_ready(struct sc_server *server) {
+    assert(server->has_stdout_pipe);
+
+    // Echo the server output until the readiness marker is printed. If the
+    // server dies first, the pipe reports EOF (the read cannot block
+    // forever), and the caller falls back to the connection retry loop.
+    char line[256];
+    size_t len = 0;
+    for (;;) {
+        char c;
+        ssize_t r = sc_pipe_read(server->stdout_pipe, &c, 1);
+        if (r <= 0) {
+            return false;
+        }
+        fputc(c, stdout);
+        if (c == '\n') {
+            line[len] = '\0';
+            if (strstr(line, SC_SERVER_READY_MARKER)) {
+                fflush(stdout);
+                return true;
+            }
+            len = 0;
+        } else if (len < sizeof(line) - 1) {
+            line[len++] = c;
+        }
+    }
+}
+
 static bool
 connect_and_read_byte(struct sc_intr *intr, sc_socket socket,
                       uint32_t tunnel_host, uint16_t tunnel_port) {
@@ -343,11 +486,24 @@ sc_server_init(struct sc_server *server, const struct sc_server_params *params,
         return false;
     }
 
+    ok = sc_intr_init(&server->push_intr);
+    if (!ok) {
+        sc_intr_destroy(&server->intr);
+        sc_cond_destroy(&server->cond_stopped);
+        sc_mutex_destroy(&server->mutex);
+        sc_server_params_destroy(&server->params);
+        return false;
+    }
+
     server->stopped = false;
 
     server->video_socket = SC_SOCKET_NONE;
+    server->audio_socket = SC_SOCKET_NONE;
     server->control_socket = SC_SOCKET_NONE;
 
+    server->has_stdout_pipe = false;
+    server->stdout_thread_started = false;
+
     sc_adb_tunnel_init(&server->tunnel);
 
     assert(cbs);
@@ -361,28 +517,132 @@ sc_server_init(struct sc_server *server, const struct sc_server_params *params,
     return true;
 }
 
+// The device meta handshake is a versioned TLV block, sent by the server in a
+// single write: 1 byte version, 2 bytes payload length, then entries of
+// 1 byte type + 2 bytes length + value. Unknown entry types are skipped, so
+// new capabilities do not cost an extra protocol round-trip.
+#define SC_DEVICE_META_VERSION 1
+#define SC_DEVICE_META_MAX_SIZE 4096
+
+enum sc_device_meta_type {
+    SC_DEVICE_META_TYPE_DEVICE_NAME = 1,
+    SC_DEVICE_META_TYPE_VIDEO_SIZE = 2,
+    SC_DEVICE_META_TYPE_SECONDARY_VIDEO_SIZES = 3,
+    SC_DEVICE_META_TYPE_DENSITY = 4,
+    SC_DEVICE_META_TYPE_FEATURES = 5,
+};
+
 static bool
 device_read_info(struct sc_intr *intr, sc_socket device_socket,
-                 struct sc_server_info *info) {
-    unsigned char buf[SC_DEVICE_NAME_FIELD_LENGTH + 4];
-    ssize_t r = net_recv_all_intr(intr, device_socket, buf, sizeof(buf));
-    if (r < SC_DEVICE_NAME_FIELD_LENGTH + 4) {
+                 struct sc_server_info *info, unsigned secondary_count) {
+    assert(secondary_count <= SC_MAX_SECONDARY_DISPLAYS);
+
+    unsigned char header[3];
+    ssize_t r = net_recv_all_intr(intr, device_socket, header, sizeof(header));
+    if (r < (ssize_t) sizeof(header)) {
+        LOGE("Could not retrieve device information");
+        return false;
+    }
+
+    if (header[0] != SC_DEVICE_META_VERSION) {
+        LOGE("Unexpected device meta version: %u", header[0]);
+        return false;
+    }
+
+    size_t len = (header[1] << 8) | header[2];
+    unsigned char buf[SC_DEVICE_META_MAX_SIZE];
+    if (len > sizeof(buf)) {
+        LOGE("Device meta too large: %zu", len);
+        return false;
+    }
+
+    r = net_recv_all_intr(intr, device_socket, buf, len);
+    if (r < (ssize_t) len) {
         LOGE("Could not retrieve device information");
         return false;
     }
-    // in case the client sends garbage
-    buf[SC_DEVICE_NAME_FIELD_LENGTH - 1] = '\0';
-    memcpy(info->device_name, (char *) buf, sizeof(info->device_name));
 
-    info->frame_size.width = (buf[SC_DEVICE_NAME_FIELD_LENGTH] << 8)
-                           | buf[SC_DEVICE_NAME_FIELD_LENGTH + 1];
-    info->frame_size.height = (buf[SC_DEVICE_NAME_FIELD_LENGTH + 2] << 8)
-                            | buf[SC_DEVICE_NAME_FIELD_LENGTH + 3];
+    info->device_name[0] = '\0';
+    info->frame_size.width = 0;
+    info->frame_size.height = 0;
+    info->density = 0;
+    info->features = 0;
+
+    size_t pos = 0;
+    while (pos + 3 <= len) {
+        uint8_t type = buf[pos];
+        size_t entry_len = (buf[pos + 1] << 8) | buf[pos + 2];
+        pos += 3;
+        if (entry_len > len - pos) {
+            LOGE("Truncated device meta entry");
+            return false;
+        }
+        const unsigned char *value = &buf[pos];
+        switch (type) {
+            case SC_DEVICE_META_TYPE_DEVICE_NAME: {
+                size_t name_len = entry_len < sizeof(info->device_name) - 1
+                                ? entry_len : sizeof(info->device_name) - 1;
+                memcpy(info->device_name, value, name_len);
+                info->device_name[name_len] = '\0';
+                break;
+            }
+            case SC_DEVICE_META_TYPE_VIDEO_SIZE:
+                if (entry_len != 4) {
+                    LOGE("Invalid video size entry");
+                    return false;
+                }
+                info->frame_size.width = (value[0] << 8) | value[1];
+                info->frame_size.height = (value[2] << 8) | value[3];
+                break;
+            case SC_DEVICE_META_TYPE_SECONDARY_VIDEO_SIZES:
+                if (entry_len != 4 * secondary_count) {
+                    LOGE("Invalid secondary video sizes entry");
+                    return false;
+                }
+                for (unsigned i = 0; i < secondary_count; ++i) {
+                    const unsigned char *p = &value[4 * i];
+                    info->secondary_frame_sizes[i].width = (p[0] << 8) | p[1];
+                    info->secondary_frame_sizes[i].height = (p[2] << 8) | p[3];
+                }
+                break;
+            case SC_DEVICE_META_TYPE_DENSITY:
+                if (entry_len != 2) {
+                    LOGE("Invalid density entry");
+                    return false;
+                }
+                info->density = (value[0] << 8) | value[1];
+                break;
+            case SC_DEVICE_META_TYPE_FEATURES:
+                if (entry_len != 4) {
+                    LOGE("Invalid features entry");
+                    return false;
+                }
+                info->features = ((uint32_t) value[0] << 24)
+                               | ((uint32_t) value[1] << 16)
+                               | ((uint32_t) value[2] << 8)
+                               | value[3];
+                break;
+            default:
+                // skip unknown entries for forward compatibility
+                break;
+        }
+        pos += entry_len;
+    }
+
+    if (!info->frame_size.width || !info->frame_size.height) {
+        LOGE("Device meta is missing the video size");
+        return false;
+    }
+
     return true;
 }
 
+// If `probe` is true, attempt to attach to an already-running server
+// (daemon mode): make a single immediate connection attempt, and on failure,
+// leave the tunnel open so that the caller can spawn a fresh server.
 static bool
-sc_server_connect_to(struct sc_server *server, struct sc_server_info *info) {
+sc_server_connect_to(struct sc_server *server, struct sc_server_info *info,
+                     bool probe) {
     struct sc_adb_tunnel *tunnel = &server->tunnel;
 
     assert(tunnel->enabled);
@@ -390,6 +650,7 @@ sc_server_connect_to(struct sc_server *server, struct sc_server_info *info) {
     const char *serial = server->params.serial;
 
     sc_socket video_socket = SC_SOCKET_NONE;
+    sc_socket audio_socket = SC_SOCKET_NONE;
     sc_socket control_socket = SC_SOCKET_NONE;
     if (!tunnel->forward) {
         video_socket = net_accept_intr(&server->intr, tunnel->server_socket);
@@ -397,6 +658,14 @@ sc_server_connect_to(struct sc_server *server, struct sc_server_info *info) {
             goto fail;
         }
 
+        if (server->params.audio) {
+            audio_socket =
+                net_accept_intr(&server->intr, tunnel->server_socket);
+            if (audio_socket == SC_SOCKET_NONE) {
+                goto fail;
+            }
+        }
+
         control_socket = net_accept_intr(&server->intr, tunnel->server_socket);
         if (control_socket == SC_SOCKET_NONE) {
             goto fail;
@@ -412,7 +681,28 @@ sc_server_connect_to(struct sc_server *server, struct sc_server_info *info) {
             tunnel_port = tunnel->local_port;
         }
 
-        unsigned attempts = 100;
+        // When attaching to a resident server, there is no spawned process,
+        // hence no stdout pipe to wait on
+        if (server->has_stdout_pipe) {
+            // Wait for the readiness marker, so that the first connection
+            // attempt succeeds without polling; the retry loop remains as a
+            // fallback in case the marker is never printed
+            if (sc_server_wait_ready(server)) {
+                LOGD("Server ready");
+            }
+
+            // Forward the remaining server logs to our stdout
+            server->stdout_thread_started =
+                sc_thread_create(&server->stdout_thread, run_forward_stdout,
+                                 "server-stdout", server);
+            if (!server->stdout_thread_started) {
+                LOGW("Could not start server stdout thread");
+                sc_pipe_close(server->stdout_pipe);
+                server->has_stdout_pipe = false;
+            }
+        }
+
+        unsigned attempts = probe ? 1 : 100;
         sc_tick delay = SC_TICK_FROM_MS(100);
         video_socket = connect_to_server(server, attempts, delay, tunnel_host,
                                          tunnel_port);
@@ -421,6 +711,17 @@ sc_server_connect_to(struct sc_server *server, struct sc_server_info *info) {
         }
 
         // we know that the device is listening, we don't need several attempts
+        if (server->params.audio) {
+            audio_socket = net_socket();
+            if (audio_socket == SC_SOCKET_NONE) {
+                goto fail;
+            }
+            if (!net_connect_intr(&server->intr, audio_socket, tunnel_host,
+                                  tunnel_port)) {
+                goto fail;
+            }
+        }
+
         control_socket = net_socket();
         if (control_socket == SC_SOCKET_NONE) {
             goto fail;
@@ -436,15 +737,33 @@ sc_server_connect_to(struct sc_server *server, struct sc_server_info *info) {
     sc_adb_tunnel_close(tunnel, &server->intr, serial);
 
     // The sockets will be closed on stop if device_read_info() fails
-    bool ok = device_read_info(&server->intr, video_socket, info);
+    bool ok = device_read_info(&server->intr, video_socket, info,
+                               server->params.secondary_display_count);
     if (!ok) {
         goto fail;
     }
 
     assert(video_socket != SC_SOCKET_NONE);
     assert(control_socket != SC_SOCKET_NONE);
+    assert(!server->params.audio || audio_socket != SC_SOCKET_NONE);
+
+    // On a lossy link (typically Wi-Fi adb), a retransmission stalls the TCP
+    // stream for at least one RTT; give the video socket a large receive
+    // buffer so that the device can keep sending during the stall instead of
+    // blocking the encoder, and flush the (small) control messages
+    // immediately (all best-effort)
+    uint32_t rcvbuf = server->params.tcp_rcvbuf;
+    struct sc_socket_tune video_tune = {
+        .recv_buffer_size = rcvbuf ? (int) rcvbuf : 1 << 20, // default 1MiB
+    };
+    net_socket_tune(video_socket, &video_tune);
+    struct sc_socket_tune control_tune = {
+        .tcp_nodelay = true,
+    };
+    net_socket_tune(control_socket, &control_tune);
 
     server->video_socket = video_socket;
+    server->audio_socket = audio_socket;
     server->control_socket = control_socket;
 
     return true;
@@ -456,14 +775,23 @@ fail:
         }
     }
 
+    if (audio_socket != SC_SOCKET_NONE) {
+        if (!net_close(audio_socket)) {
+            LOGW("Could not close audio socket");
+        }
+    }
+
     if (control_socket != SC_SOCKET_NONE) {
         if (!net_close(control_socket)) {
             LOGW("Could not close control socket");
         }
     }
 
-    // Always leave this function with tunnel disabled
-    sc_adb_tunnel_close(tunnel, &server->intr, serial);
+    if (!probe) {
+        // Leave this function with tunnel disabled (on probe failure, the
+        // caller spawns a fresh server, which still needs the tunnel)
+        sc_adb_tunnel_close(tunnel, &server->intr, serial);
+    }
 
     return false;
 }
@@ -483,6 +811,19 @@ sc_server_on_terminated(void *userdata) {
     LOGD("Server terminated");
 }
 
+static void
+sc_server_close_stdout_pipe(struct sc_server *server) {
+    if (server->stdout_thread_started) {
+        // the thread ends on pipe EOF, once the server process is dead
+        sc_thread_join(&server->stdout_thread, NULL);
+        server->stdout_thread_started = false;
+    }
+    if (server->has_stdout_pipe) {
+        sc_pipe_close(server->stdout_pipe);
+        server->has_stdout_pipe = false;
+    }
+}
+
 static bool
 sc_server_fill_serial(struct sc_server *server) {
     // Retrieve the actual device immediately if not provided, so that all
@@ -682,6 +1023,38 @@ sc_server_configure_tcpip(struct sc_server *server) {
     return ok;
 }
 
+static bool
+sc_server_prepare_direct(struct sc_server *server) {
+    // The server will listen on a TCP port on the device; resolve the device
+    // IP so that the client connects to it directly, without the adb
+    // forwarder (and its per-packet copy) on the data path
+    if (!server->params.tunnel_host) {
+        char *ip = adb_get_device_ip(&server->intr, server->params.serial, 0);
+        if (!ip) {
+            LOGE("Could not resolve the device IP address");
+            return false;
+        }
+        bool parsed = net_parse_ipv4(ip, &server->params.tunnel_host);
+        if (!parsed) {
+            LOGE("Invalid device IP address: %s", ip);
+        }
+        free(ip);
+        if (!parsed) {
+            return false;
+        }
+    }
+
+    sc_adb_tunnel_open_direct(&server->tunnel, server->params.direct_tcp_port);
+    return true;
+}
+
+static int
+run_push_server(void *data) {
+    struct sc_server *server = data;
+    bool ok = push_server(&server->push_intr, server->params.serial);
+    return ok ? 0 : -1;
+}
+
 static int
 run_server(void *data) {
     struct sc_server *server = data;
@@ -706,44 +1079,102 @@ run_server(void *data) {
         goto error_connection_failed;
     }
 
-    bool ok = push_server(&server->intr, params->serial);
-    if (!ok) {
-        goto error_connection_failed;
+    // Push the server and open the adb tunnel concurrently: both only
+    // depend on the device serial, and the push (tens of kilobytes over USB)
+    // dominates the startup time. Executing the server must wait for both,
+    // since it needs the pushed jar and the tunnel mode.
+    sc_thread push_thread;
+    bool push_started = sc_thread_create(&push_thread, run_push_server,
+                                         "adb-push", server);
+    if (!push_started) {
+        LOGW("Could not create push thread, pushing the server synchronously");
+        if (!push_server(&server->intr, params->serial)) {
+            goto error_connection_failed;
+        }
+    }
+
+    bool ok;
+    if (params->direct_tcp_port) {
+        ok = sc_server_prepare_direct(server);
+    } else {
+        // Daemon mode implies a forward tunnel: a resident server listens on
+        // the localabstract socket, it could not connect back to each new
+        // client
+        ok = sc_adb_tunnel_open(&server->tunnel, &server->intr,
+                                params->serial, params->port_range,
+                                params->force_adb_forward || params->daemon);
+    }
+
+    if (push_started) {
+        int push_ret;
+        sc_thread_join(&push_thread, &push_ret);
+        if (push_ret) {
+            if (ok) {
+                sc_adb_tunnel_close(&server->tunnel, &server->intr,
+                                    params->serial);
+            }
+            goto error_connection_failed;
+        }
     }
 
-    ok = sc_adb_tunnel_open(&server->tunnel, &server->intr, params->serial,
-                            params->port_range, params->force_adb_forward);
     if (!ok) {
         goto error_connection_failed;
     }
 
-    // server will connect to our server socket
-    sc_pid pid = execute_server(server, params);
-    if (pid == SC_PROCESS_NONE) {
-        sc_adb_tunnel_close(&server->tunnel, &server->intr, params->serial);
-        goto error_connection_failed;
+    bool attached = false;
+    if (params->daemon && server->tunnel.forward) {
+        // a resident server may already be listening behind the forward
+        // tunnel; attaching skips the app_process startup entirely
+        attached = sc_server_connect_to(server, &server->info, true);
+        if (attached) {
+            LOGI("Attached to a resident scrcpy server");
+        }
+    }
+
+    sc_pid pid = SC_PROCESS_NONE;
+    if (!attached) {
+        // server will connect to our server socket
+        pid = execute_server(server, params);
+        if (pid == SC_PROCESS_NONE) {
+            sc_adb_tunnel_close(&server->tunnel, &server->intr,
+                                params->serial);
+            goto error_connection_failed;
+        }
     }
 
+    // In daemon mode, the server process must survive this scrcpy instance,
+    // so it is neither observed nor reaped
     static const struct sc_process_listener listener = {
         .on_terminated = sc_server_on_terminated,
     };
     struct sc_process_observer observer;
-    ok = sc_process_observer_init(&observer, pid, &listener, server);
-    if (!ok) {
-        sc_process_terminate(pid);
-        sc_process_wait(pid, true); // ignore exit code
-        sc_adb_tunnel_close(&server->tunnel, &server->intr, params->serial);
-        goto error_connection_failed;
+    bool has_observer = false;
+    if (pid != SC_PROCESS_NONE && !params->daemon) {
+        ok = sc_process_observer_init(&observer, pid, &listener, server);
+        if (!ok) {
+            sc_process_terminate(pid);
+            sc_process_wait(pid, true); // ignore exit code
+            sc_adb_tunnel_close(&server->tunnel, &server->intr,
+                                params->serial);
+            sc_server_close_stdout_pipe(server);
+            goto error_connection_failed;
+        }
+        has_observer = true;
     }
 
-    ok = sc_server_connect_to(server, &server->info);
-    // The tunnel is always closed by server_connect_to()
-    if (!ok) {
-        sc_process_terminate(pid);
-        sc_process_wait(pid, true); // ignore exit code
-        sc_process_observer_join(&observer);
-        sc_process_observer_destroy(&observer);
-        goto error_connection_failed;
+    if (!attached) {
+        ok = sc_server_connect_to(server, &server->info, false);
+        // The tunnel is always closed by server_connect_to()
+        if (!ok) {
+            sc_process_terminate(pid);
+            sc_process_wait(pid, true); // ignore exit code
+            if (has_observer) {
+                sc_process_observer_join(&observer);
+                sc_process_observer_destroy(&observer);
+            }
+            sc_server_close_stdout_pipe(server);
+            goto error_connection_failed;
+        }
     }
 
     // Now connected
@@ -756,26 +1187,32 @@ run_server(void *data) {
     }
     sc_mutex_unlock(&server->mutex);
 
-    // Give some delay for the server to terminate properly
+    if (has_observer) {
+        // Give some delay for the server to terminate properly
 #define WATCHDOG_DELAY SC_TICK_FROM_SEC(1)
-    sc_tick deadline = sc_tick_now() + WATCHDOG_DELAY;
-    bool terminated = sc_process_observer_timedwait(&observer, deadline);
+        sc_tick deadline = sc_tick_now() + WATCHDOG_DELAY;
+        bool terminated = sc_process_observer_timedwait(&observer, deadline);
+
+        // After this delay, kill the server if it's not dead already.
+        // On some devices, closing the sockets is not sufficient to wake up
+        // the blocking calls while the device is asleep.
+        if (!terminated) {
+            // The process may have terminated since the check, but it is not
+            // reaped (closed) yet, so its PID is still valid, and it is ok to
+            // call sc_process_terminate() even in that case.
+            LOGW("Killing the server...");
+            sc_process_terminate(pid);
+        }
 
-    // After this delay, kill the server if it's not dead already.
-    // On some devices, closing the sockets is not sufficient to wake up the
-    // blocking calls while the device is asleep.
-    if (!terminated) {
-        // The process may have terminated since the check, but it is not
-        // reaped (closed) yet, so its PID is still valid, and it is ok to call
-        // sc_process_terminate() even in that case.
-        LOGW("Killing the server...");
-        sc_process_terminate(pid);
-    }
+        sc_process_observer_join(&observer);
+        sc_process_observer_destroy(&observer);
 
-    sc_process_observer_join(&observer);
-    sc_process_observer_destroy(&observer);
+        sc_process_close(pid);
+    }
+    // In daemon mode, the spawned adb shell process is intentionally left
+    // running: it keeps the resident server alive for the next session
 
-    sc_process_close(pid);
+    sc_server_close_stdout_pipe(server);
 
     return 0;
 
@@ -801,6 +1238,7 @@ sc_server_stop(struct sc_server *server) {
     server->stopped = true;
     sc_cond_signal(&server->cond_stopped);
     sc_intr_interrupt(&server->intr);
+    sc_intr_interrupt(&server->push_intr);
     sc_mutex_unlock(&server->mutex);
 
     sc_thread_join(&server->thread, NULL);
@@ -809,6 +1247,7 @@ sc_server_stop(struct sc_server *server) {
 void
 sc_server_destroy(struct sc_server *server) {
     sc_server_params_destroy(&server->params);
+    sc_intr_destroy(&server->push_intr);
     sc_intr_destroy(&server->intr);
     sc_cond_destroy(&server->cond_stopped);
     sc_mutex_destroy(&server->mutex);
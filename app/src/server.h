@@ -12,14 +12,25 @@
 #include "coords.h"
 #include "options.h"
 #include "util/intr.h"
+#include "util/process.h"
 #include "util/log.h"
 #include "util/net.h"
 #include "util/thread.h"
 
 #define SC_DEVICE_NAME_FIELD_LENGTH 64
+
+// features advertised by the server in the handshake
+#define SC_SERVER_FEATURE_REQUEST_IDR     (UINT32_C(1) << 0)
+#define SC_SERVER_FEATURE_STREAM_PAUSE    (UINT32_C(1) << 1)
+#define SC_SERVER_FEATURE_INJECT_FAILURES (UINT32_C(1) << 2)
+
 struct sc_server_info {
     char device_name[SC_DEVICE_NAME_FIELD_LENGTH];
     struct sc_size frame_size;
+    // initial sizes of the requested secondary displays
+    struct sc_size secondary_frame_sizes[SC_MAX_SECONDARY_DISPLAYS];
+    uint16_t density; // device display density (dpi), 0 if unknown
+    uint32_t features; // bitmask of SC_SERVER_FEATURE_*
 };
 
 struct sc_server_params {
@@ -33,13 +44,28 @@ struct sc_server_params {
     uint16_t tunnel_port;
     uint16_t max_size;
     uint32_t bit_rate;
+    enum sc_codec codec;
     uint16_t max_fps;
     int8_t lock_video_orientation;
     bool control;
+    // forward the device audio on a dedicated socket
+    bool audio;
+    // send the frame meta headers (PTS, packet boundaries, display index)
+    // before each packet; can be disabled for pure live mirroring
+    bool send_frame_meta;
     uint32_t display_id;
+    // secondary display ids (the pointed array must outlive the server)
+    const uint32_t *secondary_display_ids;
+    unsigned secondary_display_count;
     bool show_touches;
     bool stay_awake;
     bool force_adb_forward;
+    bool daemon;
+    // if not 0, the server listens on this TCP port on the device and the
+    // client connects to it directly, without any adb tunnel
+    uint16_t direct_tcp_port;
+    // video socket kernel receive buffer, in bytes (0: default)
+    uint32_t tcp_rcvbuf;
     bool power_off_on_close;
     bool clipboard_autosync;
     bool tcpip;
@@ -58,11 +84,23 @@ struct sc_server {
     bool stopped;
 
     struct sc_intr intr;
+    // interruptor for the "adb push" executed concurrently with the tunnel
+    // setup on startup (an interruptor holds a single process token)
+    struct sc_intr push_intr;
     struct sc_adb_tunnel tunnel;
 
     sc_socket video_socket;
+    // SC_SOCKET_NONE if audio is disabled
+    sc_socket audio_socket;
     sc_socket control_socket;
 
+    // In forward-tunnel mode, the server stdout is captured to detect the
+    // readiness marker (then forwarded to our stdout by a dedicated thread)
+    sc_pipe stdout_pipe;
+    bool has_stdout_pipe;
+    sc_thread stdout_thread;
+    bool stdout_thread_started;
+
     const struct sc_server_callbacks *cbs;
     void *cbs_userdata;
 };
@@ -10,88 +10,469 @@
 #include "recorder.h"
 #include "util/buffer_util.h"
 #include "util/log.h"
+#include "util/trace.h"
 
 #define BUFSIZE 0x10000
-
-#define HEADER_SIZE 12
+// size of the user-space receive buffer (see stream_recv_all())
+#define STREAM_RECV_BUF_SIZE 0x10000
+
+#define HEADER_SIZE 17
+
+// Minimum size of the pooled packet buffers; the pool grows to the next
+// power of two when a packet does not fit
+#define STREAM_PACKET_POOL_MIN_SIZE 0x10000
+// after this many packets, shrink the pool if the recent packets are much
+// smaller than the pooled buffers
+#define STREAM_PACKET_POOL_WINDOW 128
+
+// Total arrival lag above which the transport is considered congested
+#define STREAM_CONGESTION_THRESHOLD SC_TICK_FROM_MS(100)
+// minimum delay between two congestion state reports
+#define STREAM_CONGESTION_REPORT_INTERVAL SC_TICK_FROM_MS(1000)
 #define NO_PTS UINT64_C(-1)
+// bit 62 of the PTS field carries the keyframe flag, known by the server
+// from MediaCodec.BufferInfo (the PTS itself never reaches these bits)
+#define PACKET_FLAG_KEY_FRAME (UINT64_C(1) << 62)
+
+// Raw stream dump file layout (everything big-endian):
+//  - 6-byte magic, 1-byte version, 1-byte substream count
+//  - for each substream, the frame size (2-byte width, 2-byte height)
+//  - then one record per packet: an 8-byte capture timestamp (sc_tick),
+//    followed by the frame meta header and the packet bytes as received
+#define STREAM_DUMP_MAGIC "SCDUMP"
+#define STREAM_DUMP_MAGIC_LEN 6
+#define STREAM_DUMP_VERSION 1
+#define STREAM_DUMP_HEADER_SIZE(count) (8 + 4 * (count))
+
+static bool
+stream_replay_read_header(struct stream *stream, uint8_t *header) {
+    uint8_t record[8 + HEADER_SIZE]; // capture timestamp + frame meta header
+    if (fread(record, 1, sizeof(record), stream->replay) < sizeof(record)) {
+        // end of file
+        return false;
+    }
+
+    sc_tick ts = (sc_tick) buffer_read64be(record);
+    if (!stream->replay_started) {
+        stream->replay_started = true;
+        stream->replay_base = sc_tick_now();
+        stream->replay_first = ts;
+    } else if (!stream->replay_fast) {
+        // deliver the packet with the same delay relatively to the first
+        // packet as during the capture
+        sc_tick target = stream->replay_base + (ts - stream->replay_first);
+        for (;;) {
+            if (atomic_load_explicit(&stream->replay_interrupted,
+                                     memory_order_relaxed)) {
+                return false;
+            }
+            sc_tick remaining = target - sc_tick_now();
+            if (remaining <= 0) {
+                break;
+            }
+            // sleep in bounded slices, so that an interruption is handled
+            // quickly
+            sc_tick_sleep(MIN(remaining, SC_TICK_FROM_MS(100)));
+        }
+    }
+
+    if (atomic_load_explicit(&stream->replay_interrupted,
+                             memory_order_relaxed)) {
+        return false;
+    }
+
+    memcpy(header, &record[8], HEADER_SIZE);
+    return true;
+}
+
+static void
+stream_dump_record(struct stream *stream, const uint8_t *header,
+                   const uint8_t *payload, uint32_t len) {
+    uint8_t ts[8];
+    buffer_write64be(ts, (uint64_t) sc_tick_now());
+    bool ok = fwrite(ts, 1, sizeof(ts), stream->dump) == sizeof(ts)
+           && fwrite(header, 1, HEADER_SIZE, stream->dump) == HEADER_SIZE
+           && fwrite(payload, 1, len, stream->dump) == len;
+    if (!ok) {
+        LOGW("Could not write to stream dump file, capture disabled");
+        fclose(stream->dump);
+        stream->dump = NULL;
+    }
+}
+
+// Receive exactly len bytes, through a user-space buffer: instead of one
+// syscall for the frame meta header and one for the payload, a single
+// recv() pulls everything already available on the socket (possibly several
+// header+payload pairs), and the following reads are served from memory.
+// Payloads larger than the buffer are read directly into the destination.
+// Return -1 on EOS or error.
+static ssize_t
+stream_recv_all(struct stream *stream, uint8_t *buf, size_t len) {
+    size_t copied = 0;
+    while (copied < len) {
+        if (stream->recv_buf_len) {
+            size_t n = MIN(len - copied, stream->recv_buf_len);
+            memcpy(buf + copied, stream->recv_buf + stream->recv_buf_head, n);
+            stream->recv_buf_head += n;
+            stream->recv_buf_len -= n;
+            copied += n;
+            continue;
+        }
+
+        size_t remaining = len - copied;
+        if (remaining >= STREAM_RECV_BUF_SIZE) {
+            // large payload, buffering would only add a copy
+            ssize_t r = net_recv_all(stream->socket, buf + copied, remaining);
+            if (r < 0 || (size_t) r < remaining) {
+                return -1;
+            }
+            copied += remaining;
+            break;
+        }
+
+        ssize_t r = net_recv(stream->socket, stream->recv_buf,
+                             STREAM_RECV_BUF_SIZE);
+        if (r <= 0) {
+            return -1;
+        }
+        stream->recv_buf_head = 0;
+        stream->recv_buf_len = (size_t) r;
+    }
+    return (ssize_t) copied;
+}
+
+// Replace the pool with one of buffers of the given size (buffers still
+// referenced by packets in flight are freed when released)
+static bool
+stream_packet_pool_resize(struct stream *stream, size_t size) {
+    av_buffer_pool_uninit(&stream->packet_pool);
+    stream->packet_pool = av_buffer_pool_init(size, NULL);
+    if (!stream->packet_pool) {
+        LOG_OOM();
+        stream->packet_pool_size = 0;
+        return false;
+    }
+    stream->packet_pool_size = size;
+    return true;
+}
 
+// Fill the packet with a buffer drawn from the pool (replacing
+// av_new_packet() on the hot path): in steady state, the same few buffers
+// are recycled instead of paying one malloc/free per packet. The pool
+// follows the packet sizes: it grows as soon as a packet does not fit, and
+// shrinks when the recent packets would all fit in much smaller buffers
+// (after a keyframe burst or a resolution change).
 static bool
-stream_recv_packet(struct stream *stream, AVPacket *packet) {
+stream_packet_alloc(struct stream *stream, AVPacket *packet, size_t size) {
+    size_t total = size + AV_INPUT_BUFFER_PADDING_SIZE;
+
+    if (total > stream->packet_pool_max) {
+        stream->packet_pool_max = total;
+    }
+    if (++stream->packet_pool_count == STREAM_PACKET_POOL_WINDOW) {
+        size_t shrunk = stream->packet_pool_size;
+        while (shrunk > STREAM_PACKET_POOL_MIN_SIZE
+                && stream->packet_pool_max <= shrunk / 4) {
+            shrunk /= 2;
+        }
+        if (shrunk != stream->packet_pool_size) {
+            // ignore failure, the pool is recreated on the next packet
+            stream_packet_pool_resize(stream, shrunk);
+        }
+        stream->packet_pool_max = total;
+        stream->packet_pool_count = 0;
+    }
+
+    if (total > stream->packet_pool_size) {
+        size_t grown = stream->packet_pool_size ? stream->packet_pool_size
+                                                : STREAM_PACKET_POOL_MIN_SIZE;
+        while (grown < total) {
+            grown *= 2;
+        }
+        if (!stream_packet_pool_resize(stream, grown)) {
+            return false;
+        }
+    }
+
+    AVBufferRef *buf = av_buffer_pool_get(stream->packet_pool);
+    if (!buf) {
+        LOG_OOM();
+        return false;
+    }
+
+    packet->buf = buf;
+    packet->data = buf->data;
+    packet->size = size;
+    // av_new_packet() guarantees zeroed padding after the data
+    memset(packet->data + size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+    return true;
+}
+
+static bool
+stream_recv_packet(struct stream *stream, struct stream_substream **substream,
+                   AVPacket *packet) {
     // The video stream contains raw packets, without time information. When we
     // record, we retrieve the timestamps separately, from a "meta" header
     // added by the server before each raw packet.
     //
-    // The "meta" header length is 12 bytes:
-    // [. . . . . . . .|. . . .]. . . . . . . . . . . . . . . ...
-    //  <-------------> <-----> <-----------------------------...
-    //        PTS        packet        raw packet
-    //                    size
+    // The "meta" header length is 17 bytes:
+    // [.|. . . . . . . .|. . . .|. . . .]. . . . . . . . . . . . . . . ...
+    //  ^ <-------------> <-----> <-----> <-----------------------------...
+    //  |       PTS        packet  frame        raw packet
+    //  |                   size    seq
+    //  display index
     //
     // It is followed by <packet_size> bytes containing the packet/frame.
+    //
+    // The display index routes the packet to the corresponding substream
+    // (several displays may be multiplexed over the same socket).
+    //
+    // The sequence number counts the encoded media packets (config packets
+    // repeat the current value), so that frames lost upstream of the client
+    // can be distinguished from frames skipped by the client.
 
     uint8_t header[HEADER_SIZE];
-    ssize_t r = net_recv_all(stream->socket, header, HEADER_SIZE);
-    if (r < HEADER_SIZE) {
-        return false;
+    if (stream->replay) {
+        if (!stream_replay_read_header(stream, header)) {
+            return false;
+        }
+    } else {
+        if (stream_recv_all(stream, header, HEADER_SIZE) < 0) {
+            return false;
+        }
     }
 
-    uint64_t pts = buffer_read64be(header);
-    uint32_t len = buffer_read32be(&header[8]);
+    uint8_t display_index = header[0];
+    uint64_t pts = buffer_read64be(&header[1]);
+    uint32_t len = buffer_read32be(&header[9]);
+    uint32_t seq = buffer_read32be(&header[13]);
+
+    bool is_key = pts != NO_PTS && (pts & PACKET_FLAG_KEY_FRAME);
+    if (pts != NO_PTS) {
+        pts &= ~PACKET_FLAG_KEY_FRAME;
+    }
     assert(pts == NO_PTS || (pts & 0x8000000000000000) == 0);
     assert(len);
 
-    if (av_new_packet(packet, len)) {
-        LOG_OOM();
+    if (display_index >= stream->substream_count) {
+        LOGE("Invalid display index: %" PRIu8, display_index);
         return false;
     }
+    struct stream_substream *ss = &stream->substreams[display_index];
+    *substream = ss;
+
+    if (pts != NO_PTS) {
+        if (ss->last_seq && seq != ss->last_seq + 1) {
+            uint32_t lost = seq - ss->last_seq - 1;
+            LOGW("%" PRIu32 " encoded frame(s) lost before the client "
+                 "(device-side or transport)", lost);
+        }
+        ss->last_seq = seq;
+    }
 
-    r = net_recv_all(stream->socket, packet->data, len);
-    if (r < 0 || ((uint32_t) r) < len) {
-        av_packet_unref(packet);
+    // If a config packet is pending for this substream, receive the data
+    // payload directly after the config prefix, in a single allocation, so
+    // that the keyframe following an encoder reconfiguration is written only
+    // once (the config itself is only a few dozen bytes)
+    size_t offset = 0;
+    if (pts != NO_PTS && ss->pending) {
+        offset = ss->pending->size;
+    }
+
+    if (!stream_packet_alloc(stream, packet, offset + len)) {
+        // error already logged
         return false;
     }
 
+    if (offset) {
+        memcpy(packet->data, ss->pending->data, offset);
+        av_packet_free(&ss->pending);
+    }
+
+    if (stream->replay) {
+        if (fread(packet->data + offset, 1, len, stream->replay) < len) {
+            LOGE("Truncated stream dump file");
+            av_packet_unref(packet);
+            return false;
+        }
+    } else {
+        if (stream_recv_all(stream, packet->data + offset, len) < 0) {
+            av_packet_unref(packet);
+            return false;
+        }
+
+        if (stream->dump) {
+            stream_dump_record(stream, header, packet->data + offset, len);
+        }
+    }
+
     packet->pts = pts != NO_PTS ? (int64_t) pts : AV_NOPTS_VALUE;
+    if (is_key) {
+        packet->flags |= AV_PKT_FLAG_KEY;
+    }
 
     return true;
 }
 
+// Estimate the transport congestion from the receive timing: when the link
+// cannot sustain the encoder bitrate, the inter-arrival delays exceed the
+// inter-capture (PTS) delays, and the difference accumulates in the socket
+// buffers as a growing backlog (which the user perceives as latency). Only
+// the primary substream is timed, but its arrival delays include the time
+// spent receiving the other substreams, so the measure covers the whole
+// socket.
+static void
+stream_update_congestion(struct stream *stream,
+                         struct stream_substream *substream,
+                         const AVPacket *packet) {
+    if (!stream->cbs->on_congestion || packet->pts == AV_NOPTS_VALUE
+            || substream != &stream->substreams[0]) {
+        return;
+    }
+
+    sc_tick now = sc_tick_now();
+    if (stream->cong_last_arrival) {
+        sc_tick pts_delta = packet->pts - stream->cong_last_pts;
+        if (pts_delta < 0 || pts_delta > SC_TICK_FROM_MS(1000)) {
+            // PTS discontinuity (encoder restart), restart the estimation
+            stream->cong_backlog = 0;
+        } else {
+            sc_tick arrival_delta = now - stream->cong_last_arrival;
+            stream->cong_backlog += arrival_delta - pts_delta;
+            if (stream->cong_backlog < 0) {
+                // packets arrive faster than real time, the backlog drained
+                stream->cong_backlog = 0;
+            }
+        }
+    }
+    stream->cong_last_arrival = now;
+    stream->cong_last_pts = packet->pts;
+
+    if (now - stream->cong_last_report < STREAM_CONGESTION_REPORT_INTERVAL) {
+        return;
+    }
+    stream->cong_last_report = now;
+
+    bool congested = stream->cong_backlog >= STREAM_CONGESTION_THRESHOLD;
+    stream->cbs->on_congestion(stream, congested, stream->cbs_userdata);
+    if (congested) {
+        // measure the effect of the reaction (a bitrate reduction) from
+        // scratch
+        stream->cong_backlog = 0;
+    }
+}
+
+// Each sink applies its own queuing policy downstream: the decoder keeps only
+// the latest frame for display (drop-oldest), while the recorder buffers
+// packets on its own thread up to a bound, then blocks (a recording must not
+// lose packets). A slow sink can therefore not consume memory without limit.
 static bool
-push_packet_to_sinks(struct stream *stream, const AVPacket *packet) {
-    for (unsigned i = 0; i < stream->sink_count; ++i) {
-        struct sc_packet_sink *sink = stream->sinks[i];
+push_packet_to_sinks(struct stream *stream, struct stream_substream *substream,
+                     const AVPacket *packet) {
+    sc_mutex_lock(&stream->mutex);
+    for (unsigned i = 0; i < substream->sink_count; ++i) {
+        struct sc_packet_sink *sink = substream->sinks[i];
         if (!sink->ops->push(sink, packet)) {
+            sc_mutex_unlock(&stream->mutex);
             LOGE("Could not send config packet to sink %d", i);
             return false;
         }
     }
+    sc_mutex_unlock(&stream->mutex);
 
     return true;
 }
 
+// Without frame meta headers, the parser splits the byte stream into frames
+// itself: a received chunk may produce zero or several frames
 static bool
-stream_parse(struct stream *stream, AVPacket *packet) {
-    uint8_t *in_data = packet->data;
-    int in_len = packet->size;
-    uint8_t *out_data = NULL;
-    int out_len = 0;
-    int r = av_parser_parse2(stream->parser, stream->codec_ctx,
-                             &out_data, &out_len, in_data, in_len,
-                             AV_NOPTS_VALUE, AV_NOPTS_VALUE, -1);
-
-    // PARSER_FLAG_COMPLETE_FRAMES is set
-    assert(r == in_len);
-    (void) r;
-    assert(out_len == in_len);
-
-    if (stream->parser->key_frame == 1) {
-        packet->flags |= AV_PKT_FLAG_KEY;
+stream_push_raw_data(struct stream *stream, struct stream_substream *substream,
+                     AVPacket *packet, uint8_t *data, size_t len) {
+    while (len) {
+        uint8_t *out_data = NULL;
+        int out_len = 0;
+        int r = av_parser_parse2(substream->parser, substream->codec_ctx,
+                                 &out_data, &out_len, data, (int) len,
+                                 AV_NOPTS_VALUE, AV_NOPTS_VALUE, -1);
+        assert(r >= 0);
+        data += r;
+        len -= r;
+
+        if (!out_len) {
+            // no complete frame yet
+            continue;
+        }
+
+        // the packet data points into the parser buffer, valid until the next
+        // parse call: the sinks consume it synchronously
+        packet->buf = NULL;
+        packet->data = out_data;
+        packet->size = out_len;
+        packet->pts = AV_NOPTS_VALUE;
+        packet->dts = AV_NOPTS_VALUE;
+        packet->flags = substream->parser->key_frame == 1 ? AV_PKT_FLAG_KEY
+                                                          : 0;
+
+        if (!push_packet_to_sinks(stream, substream, packet)) {
+            LOGE("Could not process packet");
+            return false;
+        }
     }
 
+    return true;
+}
+
+static bool
+stream_recv_raw(struct stream *stream, uint8_t *buf, AVPacket *packet) {
+    ssize_t r = net_recv(stream->socket, buf, BUFSIZE);
+    if (r <= 0) {
+        // end of stream
+        return false;
+    }
+
+    // raw mode requires a single substream
+    struct stream_substream *substream = &stream->substreams[0];
+    return stream_push_raw_data(stream, substream, packet, buf, (size_t) r);
+}
+
+// keep a reference on the latest config or keyframe packet, to replay it to
+// late-attached sinks
+static void
+stream_cache_packet(struct stream *stream, AVPacket **cache,
+                    const AVPacket *packet) {
+    sc_mutex_lock(&stream->mutex);
+    if (!*cache) {
+        *cache = av_packet_alloc();
+        if (!*cache) {
+            sc_mutex_unlock(&stream->mutex);
+            LOG_OOM();
+            // not fatal, the cache is best-effort
+            return;
+        }
+    } else {
+        av_packet_unref(*cache);
+    }
+
+    if (av_packet_ref(*cache, packet)) {
+        av_packet_free(cache);
+        LOG_OOM();
+    }
+    sc_mutex_unlock(&stream->mutex);
+}
+
+static bool
+stream_process_frame(struct stream *stream, struct stream_substream *substream,
+                     AVPacket *packet) {
+    // the keyframe flag is taken from the frame meta header, so there is no
+    // need to run a parser over the packet bytes
+
     packet->dts = packet->pts;
 
-    bool ok = push_packet_to_sinks(stream, packet);
+    if (packet->flags & AV_PKT_FLAG_KEY) {
+        stream_cache_packet(stream, &substream->cached_keyframe, packet);
+    }
+
+    bool ok = push_packet_to_sinks(stream, substream, packet);
     if (!ok) {
         LOGE("Could not process packet");
         return false;
@@ -101,138 +482,242 @@ stream_parse(struct stream *stream, AVPacket *packet) {
 }
 
 static bool
-stream_push_packet(struct stream *stream, AVPacket *packet) {
+stream_push_packet(struct stream *stream, struct stream_substream *substream,
+                   AVPacket *packet) {
     bool is_config = packet->pts == AV_NOPTS_VALUE;
 
-    // A config packet must not be decoded immediately (it contains no
-    // frame); instead, it must be concatenated with the future data packet.
-    if (stream->pending || is_config) {
+    if (is_config) {
+        if (stream->pass_through) {
+            // no decoder downstream: the sinks handle config packets
+            // themselves, so there is no need to keep the config pending to
+            // prefix the next keyframe with it
+            stream_cache_packet(stream, &substream->cached_config, packet);
+            return push_packet_to_sinks(stream, substream, packet);
+        }
+
+        // A config packet must not be decoded immediately (it contains no
+        // frame); it is kept pending, and stream_recv_packet() receives the
+        // next data packet directly after it, so that the following keyframe
+        // is never copied a second time.
         size_t offset;
-        if (stream->pending) {
-            offset = stream->pending->size;
-            if (av_grow_packet(stream->pending, packet->size)) {
+        if (substream->pending) {
+            // concatenate consecutive config packets
+            offset = substream->pending->size;
+            if (av_grow_packet(substream->pending, packet->size)) {
                 LOG_OOM();
                 return false;
             }
         } else {
             offset = 0;
-            stream->pending = av_packet_alloc();
-            if (!stream->pending) {
+            substream->pending = av_packet_alloc();
+            if (!substream->pending) {
                 LOG_OOM();
                 return false;
             }
-            if (av_new_packet(stream->pending, packet->size)) {
+            if (av_new_packet(substream->pending, packet->size)) {
                 LOG_OOM();
-                av_packet_free(&stream->pending);
+                av_packet_free(&substream->pending);
                 return false;
             }
         }
 
-        memcpy(stream->pending->data + offset, packet->data, packet->size);
+        memcpy(substream->pending->data + offset, packet->data, packet->size);
 
-        if (!is_config) {
-            // prepare the concat packet to send to the decoder
-            stream->pending->pts = packet->pts;
-            stream->pending->dts = packet->dts;
-            stream->pending->flags = packet->flags;
-            packet = stream->pending;
-        }
-    }
-
-    if (is_config) {
-        // config packet
-        bool ok = push_packet_to_sinks(stream, packet);
-        if (!ok) {
-            return false;
-        }
-    } else {
-        // data packet
-        bool ok = stream_parse(stream, packet);
-
-        if (stream->pending) {
-            // the pending packet must be discarded (consumed or error)
-            av_packet_free(&stream->pending);
-        }
+        stream_cache_packet(stream, &substream->cached_config, packet);
 
-        if (!ok) {
-            return false;
-        }
+        return push_packet_to_sinks(stream, substream, packet);
     }
-    return true;
+
+    // data packet, already prefixed with any pending config packet (see
+    // stream_recv_packet())
+    return stream_process_frame(stream, substream, packet);
 }
 
 static void
-stream_close_first_sinks(struct stream *stream, unsigned count) {
+stream_substream_close_first_sinks(struct stream_substream *substream,
+                                   unsigned count) {
     while (count) {
-        struct sc_packet_sink *sink = stream->sinks[--count];
+        struct sc_packet_sink *sink = substream->sinks[--count];
         sink->ops->close(sink);
     }
 }
 
 static inline void
 stream_close_sinks(struct stream *stream) {
-    stream_close_first_sinks(stream, stream->sink_count);
+    sc_mutex_lock(&stream->mutex);
+    for (unsigned i = 0; i < stream->substream_count; ++i) {
+        struct stream_substream *substream = &stream->substreams[i];
+        stream_substream_close_first_sinks(substream, substream->sink_count);
+        substream->sink_count = 0;
+    }
+    sc_mutex_unlock(&stream->mutex);
 }
 
 static bool
 stream_open_sinks(struct stream *stream, const AVCodec *codec) {
-    for (unsigned i = 0; i < stream->sink_count; ++i) {
-        struct sc_packet_sink *sink = stream->sinks[i];
-        if (!sink->ops->open(sink, codec)) {
-            LOGE("Could not open packet sink %d", i);
-            stream_close_first_sinks(stream, i);
-            return false;
+    for (unsigned i = 0; i < stream->substream_count; ++i) {
+        struct stream_substream *substream = &stream->substreams[i];
+        for (unsigned j = 0; j < substream->sink_count; ++j) {
+            struct sc_packet_sink *sink = substream->sinks[j];
+            if (!sink->ops->open(sink, codec)) {
+                LOGE("Could not open packet sink %d of substream %d", j, i);
+                stream_substream_close_first_sinks(substream, j);
+                while (i) {
+                    struct stream_substream *prev = &stream->substreams[--i];
+                    stream_substream_close_first_sinks(prev, prev->sink_count);
+                }
+                return false;
+            }
         }
     }
 
     return true;
 }
 
+// allocate the codec context and parser of each substream, or roll back
+//
+// In normal mode, frame boundaries and keyframes are known from the frame
+// meta headers, so no parser is needed at all; in raw mode, the parser
+// splits the byte stream into frames itself
+static bool
+stream_open_parsers(struct stream *stream, const AVCodec *codec) {
+    if (!stream->raw) {
+        return true;
+    }
+
+    for (unsigned i = 0; i < stream->substream_count; ++i) {
+        struct stream_substream *substream = &stream->substreams[i];
+
+        substream->codec_ctx = avcodec_alloc_context3(codec);
+        if (!substream->codec_ctx) {
+            LOG_OOM();
+            goto error;
+        }
+
+        substream->parser = av_parser_init(stream->codec_id);
+        if (!substream->parser) {
+            LOGE("Could not initialize parser");
+            avcodec_free_context(&substream->codec_ctx);
+            goto error;
+        }
+        continue;
+
+error:
+        while (i) {
+            struct stream_substream *prev = &stream->substreams[--i];
+            av_parser_close(prev->parser);
+            avcodec_free_context(&prev->codec_ctx);
+        }
+        return false;
+    }
+
+    return true;
+}
+
+static void
+stream_close_parsers(struct stream *stream) {
+    if (!stream->raw) {
+        return;
+    }
+
+    for (unsigned i = 0; i < stream->substream_count; ++i) {
+        struct stream_substream *substream = &stream->substreams[i];
+        av_parser_close(substream->parser);
+        avcodec_free_context(&substream->codec_ctx);
+    }
+}
+
 static int
 run_stream(void *data) {
     struct stream *stream = data;
 
-    AVCodec *codec = avcodec_find_decoder(AV_CODEC_ID_H264);
+    sc_thread_apply_role(SC_THREAD_ROLE_DECODE);
+
+    AVCodec *codec = avcodec_find_decoder(stream->codec_id);
     if (!codec) {
-        LOGE("H.264 decoder not found");
+        LOGE("Decoder not found for %s", avcodec_get_name(stream->codec_id));
         goto end;
     }
+    stream->codec = codec;
 
-    stream->codec_ctx = avcodec_alloc_context3(codec);
-    if (!stream->codec_ctx) {
-        LOG_OOM();
+    if (!stream_open_parsers(stream, codec)) {
         goto end;
     }
 
     if (!stream_open_sinks(stream, codec)) {
         LOGE("Could not open stream sinks");
-        goto finally_free_codec_ctx;
-    }
-
-    stream->parser = av_parser_init(AV_CODEC_ID_H264);
-    if (!stream->parser) {
-        LOGE("Could not initialize parser");
-        goto finally_close_sinks;
+        goto finally_close_parsers;
     }
 
-    // We must only pass complete frames to av_parser_parse2()!
-    // It's more complicated, but this allows to reduce the latency by 1 frame!
-    stream->parser->flags |= PARSER_FLAG_COMPLETE_FRAMES;
-
     AVPacket *packet = av_packet_alloc();
     if (!packet) {
         LOG_OOM();
-        goto finally_close_parser;
+        goto finally_close_sinks;
     }
 
+    uint8_t *raw_buf = NULL;
+    if (stream->raw) {
+        assert(stream->substream_count == 1);
+        raw_buf = malloc(BUFSIZE);
+        if (!raw_buf) {
+            LOG_OOM();
+            av_packet_free(&packet);
+            goto finally_close_sinks;
+        }
+    } else if (!stream->replay) {
+        stream->recv_buf = malloc(STREAM_RECV_BUF_SIZE);
+        if (!stream->recv_buf) {
+            LOG_OOM();
+            av_packet_free(&packet);
+            goto finally_close_sinks;
+        }
+    }
+
+    bool aux_alive = stream->aux_socket != SC_SOCKET_NONE;
+
     for (;;) {
-        bool ok = stream_recv_packet(stream, packet);
+        // only poll when no received data is pending in the buffer, it would
+        // delay the buffered packets until the device sends more
+        if (aux_alive && !stream->recv_buf_len) {
+            sc_socket sockets[2] = {stream->socket, stream->aux_socket};
+            bool ready[2];
+            if (!net_poll_recv(sockets, 2, ready)) {
+                break;
+            }
+
+            if (ready[1] && !stream->aux_on_readable(stream->aux_userdata)) {
+                // end of stream on the auxiliary socket, poll only the video
+                // socket from now on
+                aux_alive = false;
+            }
+
+            if (!ready[0]) {
+                continue;
+            }
+        }
+
+        if (stream->raw) {
+            if (!stream_recv_raw(stream, raw_buf, packet)) {
+                // end of stream or processing error (already logged)
+                break;
+            }
+            continue;
+        }
+
+        struct stream_substream *substream;
+        sc_tick trace = sc_trace_begin();
+        bool ok = stream_recv_packet(stream, &substream, packet);
+        sc_trace_end("recv_packet", trace);
         if (!ok) {
             // end of stream
             break;
         }
 
-        ok = stream_push_packet(stream, packet);
+        if (!stream->replay) {
+            stream_update_congestion(stream, substream, packet);
+        }
+
+        ok = stream_push_packet(stream, substream, packet);
         av_packet_unref(packet);
         if (!ok) {
             // cannot process packet (error already logged)
@@ -242,42 +727,269 @@ run_stream(void *data) {
 
     LOGD("End of frames");
 
-    if (stream->pending) {
-        av_packet_free(&stream->pending);
+    free(raw_buf);
+    free(stream->recv_buf);
+    stream->recv_buf = NULL;
+
+    for (unsigned i = 0; i < stream->substream_count; ++i) {
+        if (stream->substreams[i].pending) {
+            av_packet_free(&stream->substreams[i].pending);
+        }
     }
 
     av_packet_free(&packet);
-finally_close_parser:
-    av_parser_close(stream->parser);
 finally_close_sinks:
     stream_close_sinks(stream);
-finally_free_codec_ctx:
-    avcodec_free_context(&stream->codec_ctx);
+finally_close_parsers:
+    stream_close_parsers(stream);
 end:
     stream->cbs->on_eos(stream, stream->cbs_userdata);
 
     return 0;
 }
 
-void
-stream_init(struct stream *stream, sc_socket socket,
+bool
+stream_init(struct stream *stream, sc_socket socket, unsigned substream_count,
             const struct stream_callbacks *cbs, void *cbs_userdata) {
+    assert(substream_count);
+    assert(substream_count <= STREAM_MAX_SUBSTREAMS);
+
+    bool ok = sc_mutex_init(&stream->mutex);
+    if (!ok) {
+        return false;
+    }
+
     stream->socket = socket;
-    stream->pending = NULL;
-    stream->sink_count = 0;
+    stream->codec_id = AV_CODEC_ID_H264;
+    stream->codec = NULL;
+    stream->raw = false;
+    stream->pass_through = false;
+    stream->substream_count = substream_count;
+    stream->aux_socket = SC_SOCKET_NONE;
+    stream->aux_on_readable = NULL;
+    stream->aux_userdata = NULL;
+
+    stream->recv_buf = NULL;
+    stream->recv_buf_head = 0;
+    stream->recv_buf_len = 0;
+
+    stream->packet_pool = NULL;
+    stream->packet_pool_size = 0;
+    stream->packet_pool_max = 0;
+    stream->packet_pool_count = 0;
+
+    stream->cong_backlog = 0;
+    stream->cong_last_arrival = 0;
+    stream->cong_last_pts = 0;
+    stream->cong_last_report = 0;
+
+    stream->dump = NULL;
+    stream->replay = NULL;
+    stream->replay_fast = false;
+    stream->replay_started = false;
+    atomic_init(&stream->replay_interrupted, false);
+    stream->replay_base = 0;
+    stream->replay_first = 0;
+
+    for (unsigned i = 0; i < substream_count; ++i) {
+        struct stream_substream *substream = &stream->substreams[i];
+        substream->last_seq = 0;
+        substream->codec_ctx = NULL;
+        substream->parser = NULL; // only initialized in raw mode
+        substream->pending = NULL;
+        substream->cached_config = NULL;
+        substream->cached_keyframe = NULL;
+        substream->sink_count = 0;
+    }
 
     assert(cbs && cbs->on_eos);
 
     stream->cbs = cbs;
     stream->cbs_userdata = cbs_userdata;
+
+    return true;
 }
 
 void
-stream_add_sink(struct stream *stream, struct sc_packet_sink *sink) {
-    assert(stream->sink_count < STREAM_MAX_SINKS);
+stream_destroy(struct stream *stream) {
+    av_buffer_pool_uninit(&stream->packet_pool);
+    for (unsigned i = 0; i < stream->substream_count; ++i) {
+        struct stream_substream *substream = &stream->substreams[i];
+        if (substream->cached_config) {
+            av_packet_free(&substream->cached_config);
+        }
+        if (substream->cached_keyframe) {
+            av_packet_free(&substream->cached_keyframe);
+        }
+    }
+    if (stream->dump) {
+        fclose(stream->dump);
+    }
+    if (stream->replay) {
+        fclose(stream->replay);
+    }
+    sc_mutex_destroy(&stream->mutex);
+}
+
+void
+stream_add_sink(struct stream *stream, unsigned substream_index,
+                struct sc_packet_sink *sink) {
+    assert(substream_index < stream->substream_count);
+    struct stream_substream *substream = &stream->substreams[substream_index];
+    assert(substream->sink_count < STREAM_MAX_SINKS);
     assert(sink);
     assert(sink->ops);
-    stream->sinks[stream->sink_count++] = sink;
+    substream->sinks[substream->sink_count++] = sink;
+}
+
+void
+stream_set_codec(struct stream *stream, enum AVCodecID codec_id) {
+    stream->codec_id = codec_id;
+}
+
+void
+stream_set_raw(struct stream *stream) {
+    assert(stream->substream_count == 1);
+    assert(!stream->dump);
+    assert(!stream->replay);
+    stream->raw = true;
+}
+
+void
+stream_set_pass_through(struct stream *stream) {
+    // raw mode has no config packets to merge in the first place
+    assert(!stream->raw);
+    stream->pass_through = true;
+}
+
+void
+stream_set_aux_socket(struct stream *stream, sc_socket socket,
+                      bool (*on_readable)(void *userdata), void *userdata) {
+    assert(socket != SC_SOCKET_NONE);
+    assert(on_readable);
+    stream->aux_socket = socket;
+    stream->aux_on_readable = on_readable;
+    stream->aux_userdata = userdata;
+}
+
+bool
+stream_set_dump(struct stream *stream, const char *filename,
+                const struct sc_size *frame_sizes, unsigned count) {
+    assert(count == stream->substream_count);
+
+    FILE *file = fopen(filename, "wb");
+    if (!file) {
+        LOGE("Could not open stream dump file: %s", filename);
+        return false;
+    }
+
+    uint8_t header[STREAM_DUMP_HEADER_SIZE(STREAM_MAX_SUBSTREAMS)];
+    memcpy(header, STREAM_DUMP_MAGIC, STREAM_DUMP_MAGIC_LEN);
+    header[6] = STREAM_DUMP_VERSION;
+    header[7] = count;
+    for (unsigned i = 0; i < count; ++i) {
+        buffer_write16be(&header[8 + 4 * i], frame_sizes[i].width);
+        buffer_write16be(&header[10 + 4 * i], frame_sizes[i].height);
+    }
+
+    size_t len = STREAM_DUMP_HEADER_SIZE(count);
+    if (fwrite(header, 1, len, file) < len) {
+        LOGE("Could not write stream dump header");
+        fclose(file);
+        return false;
+    }
+
+    stream->dump = file;
+    LOGI("Dumping raw stream to %s", filename);
+    return true;
+}
+
+bool
+stream_init_replay(struct stream *stream, const char *filename, bool fast,
+                   struct sc_size *frame_sizes, unsigned *substream_count,
+                   const struct stream_callbacks *cbs, void *cbs_userdata) {
+    FILE *file = fopen(filename, "rb");
+    if (!file) {
+        LOGE("Could not open stream dump file: %s", filename);
+        return false;
+    }
+
+    uint8_t header[STREAM_DUMP_HEADER_SIZE(STREAM_MAX_SUBSTREAMS)];
+    if (fread(header, 1, 8, file) < 8
+            || memcmp(header, STREAM_DUMP_MAGIC, STREAM_DUMP_MAGIC_LEN)
+            || header[6] != STREAM_DUMP_VERSION) {
+        LOGE("Invalid stream dump file: %s", filename);
+        fclose(file);
+        return false;
+    }
+
+    unsigned count = header[7];
+    if (!count || count > STREAM_MAX_SUBSTREAMS
+            || fread(&header[8], 1, 4 * count, file) < 4 * count) {
+        LOGE("Invalid stream dump file: %s", filename);
+        fclose(file);
+        return false;
+    }
+
+    for (unsigned i = 0; i < count; ++i) {
+        frame_sizes[i].width = buffer_read16be(&header[8 + 4 * i]);
+        frame_sizes[i].height = buffer_read16be(&header[10 + 4 * i]);
+    }
+
+    if (!stream_init(stream, SC_SOCKET_NONE, count, cbs, cbs_userdata)) {
+        fclose(file);
+        return false;
+    }
+
+    stream->replay = file;
+    stream->replay_fast = fast;
+    *substream_count = count;
+    LOGI("Replaying raw stream from %s", filename);
+    return true;
+}
+
+void
+stream_interrupt(struct stream *stream) {
+    atomic_store(&stream->replay_interrupted, true);
+}
+
+bool
+stream_attach_sink(struct stream *stream, struct sc_packet_sink *sink) {
+    assert(sink);
+    assert(sink->ops);
+
+    // only the primary display supports late-attached sinks
+    struct stream_substream *substream = &stream->substreams[0];
+
+    sc_mutex_lock(&stream->mutex);
+    // the stream thread must have found the codec
+    assert(stream->codec);
+
+    if (substream->sink_count == STREAM_MAX_SINKS) {
+        sc_mutex_unlock(&stream->mutex);
+        LOGE("Too many stream sinks");
+        return false;
+    }
+
+    if (!sink->ops->open(sink, stream->codec)) {
+        sc_mutex_unlock(&stream->mutex);
+        LOGE("Could not open late-attached packet sink");
+        return false;
+    }
+
+    // replay the cached packets so that the sink does not have to wait for
+    // the next keyframe
+    if (substream->cached_config) {
+        sink->ops->push(sink, substream->cached_config);
+    }
+    if (substream->cached_keyframe) {
+        sink->ops->push(sink, substream->cached_keyframe);
+    }
+
+    substream->sinks[substream->sink_count++] = sink;
+    sc_mutex_unlock(&stream->mutex);
+
+    return true;
 }
 
 bool
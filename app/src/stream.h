@@ -3,22 +3,28 @@
 
 #include "common.h"
 
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <libavformat/avformat.h>
 
+#include "coords.h"
 #include "trait/packet_sink.h"
 #include "util/net.h"
 #include "util/thread.h"
+#include "util/tick.h"
 
-#define STREAM_MAX_SINKS 2
+#define STREAM_MAX_SINKS 3
+// 1 primary + SC_MAX_SECONDARY_DISPLAYS (options.h)
+#define STREAM_MAX_SUBSTREAMS 4
 
-struct stream {
-    sc_socket socket;
-    sc_thread thread;
-
-    struct sc_packet_sink *sinks[STREAM_MAX_SINKS];
-    unsigned sink_count;
+// Demuxing state for one substream (one mirrored display): the packets of all
+// displays are multiplexed over the same socket, tagged with a display index
+// in the frame meta header, and parsed/routed separately.
+struct stream_substream {
+    // last frame sequence number received, to detect frames lost upstream
+    uint32_t last_seq;
 
     AVCodecContext *codec_ctx;
     AVCodecParserContext *parser;
@@ -26,20 +32,168 @@ struct stream {
     // packet is available
     AVPacket *pending;
 
+    // latest config and keyframe packets, replayed to late-attached sinks so
+    // that they produce output without waiting for the next keyframe
+    AVPacket *cached_config;
+    AVPacket *cached_keyframe;
+
+    struct sc_packet_sink *sinks[STREAM_MAX_SINKS];
+    unsigned sink_count;
+};
+
+struct stream {
+    sc_socket socket;
+    sc_thread thread;
+
+    // codec of the received stream (see stream_set_codec())
+    enum AVCodecID codec_id;
+
+    // raw mode: the server sends the encoder output without frame meta
+    // headers, and the parser splits the byte stream into frames itself (only
+    // possible for pure live mirroring, see stream_set_raw())
+    bool raw;
+
+    // pass-through mode: no decoder downstream, hand the packets to the
+    // sinks without merging config packets into the next keyframe (see
+    // stream_set_pass_through())
+    bool pass_through;
+
+    // protects the sinks and the cached packets (sinks may be attached from
+    // other threads while the stream is running)
+    sc_mutex mutex;
+    // codec passed to the sinks on open, set by the stream thread
+    const AVCodec *codec;
+
+    struct stream_substream substreams[STREAM_MAX_SUBSTREAMS];
+    unsigned substream_count;
+
+    // raw stream capture and replay (see stream_set_dump() and
+    // stream_init_replay())
+    FILE *dump;
+    FILE *replay;
+    bool replay_fast; // ignore the recorded timing
+    bool replay_started; // the first record has been replayed
+    atomic_bool replay_interrupted;
+    sc_tick replay_base; // sc_tick_now() when the first record was replayed
+    sc_tick replay_first; // capture timestamp of the first record
+
+    // auxiliary socket polled along with the video socket, so that another
+    // receive loop (typically the device message receiver) does not need its
+    // own thread
+    sc_socket aux_socket; // SC_SOCKET_NONE if unused
+    bool (*aux_on_readable)(void *userdata);
+    void *aux_userdata;
+
+    // User-space receive buffer (see stream_recv_all()): one recv() may
+    // pull several header+payload pairs, instead of two syscalls per packet
+    uint8_t *recv_buf; // NULL in raw and replay modes
+    size_t recv_buf_head;
+    size_t recv_buf_len;
+
+    // Packet buffer pool (see stream_packet_alloc()): fixed-size recycled
+    // buffers, so that steady-state streaming performs no malloc/free on the
+    // packet hot path
+    AVBufferPool *packet_pool;
+    size_t packet_pool_size; // size of the pooled buffers (with padding)
+    size_t packet_pool_max; // largest buffer needed in the current window
+    unsigned packet_pool_count; // packets allocated in the current window
+
+    // Congestion estimation from the receive timing of the primary
+    // substream (see stream_update_congestion())
+    sc_tick cong_backlog; // how far the arrivals lag behind the PTS pace
+    sc_tick cong_last_arrival; // 0 before the first timed packet
+    int64_t cong_last_pts;
+    sc_tick cong_last_report; // date of the last on_congestion() callback
+
     const struct stream_callbacks *cbs;
     void *cbs_userdata;
 };
 
 struct stream_callbacks {
     void (*on_eos)(struct stream *stream, void *userdata);
+    // Called from the stream thread, at most once per second, with the
+    // current congestion state: congested means that packets arrive slower
+    // than the device produces them, i.e. the socket buffers are filling up
+    // and latency is accumulating. May be NULL. Never called in raw or
+    // replay mode.
+    void (*on_congestion)(struct stream *stream, bool congested,
+                          void *userdata);
 };
 
-void
-stream_init(struct stream *stream, sc_socket socket,
+bool
+stream_init(struct stream *stream, sc_socket socket, unsigned substream_count,
             const struct stream_callbacks *cbs, void *cbs_userdata);
 
 void
-stream_add_sink(struct stream *stream, struct sc_packet_sink *sink);
+stream_destroy(struct stream *stream);
+
+// add a sink for the given substream before the stream is started
+void
+stream_add_sink(struct stream *stream, unsigned substream,
+                struct sc_packet_sink *sink);
+
+// Set the codec of the received stream (default: AV_CODEC_ID_H264), it must
+// match the --codec option given to the server.
+// Must be called before the stream is started.
+void
+stream_set_codec(struct stream *stream, enum AVCodecID codec_id);
+
+// Receive the stream without frame meta headers (the server must be started
+// with send_frame_meta=false). This skips the per-packet header processing on
+// both ends, but provides no PTS, no packet boundaries and no display index,
+// so it requires a single substream and sinks that do not need timestamps
+// (i.e. pure live mirroring: no recorder, no buffering, no dump).
+// Must be called before the stream is started.
+void
+stream_set_raw(struct stream *stream);
+
+// Record-only fast path: hand the received packets straight to the sinks,
+// without merging config packets into the following keyframe (a merge only
+// decoders require; the recorder turns config packets into extradata
+// itself). This skips one allocation and one copy of every keyframe that
+// follows an encoder (re)configuration.
+// Must be called before the stream is started, and only when no decoder is
+// attached to any substream.
+void
+stream_set_pass_through(struct stream *stream);
+
+// Dump the raw stream (the frame meta headers and the packets, with arrival
+// timestamps) to a file, to replay it later with stream_init_replay().
+// Must be called before the stream is started. One frame size per substream
+// is recorded in the file header.
+bool
+stream_set_dump(struct stream *stream, const char *filename,
+                const struct sc_size *frame_sizes, unsigned count);
+
+// Initialize a stream reading from a dump file instead of a socket. The
+// substream count and the frame sizes recorded in the file header are
+// returned via the output parameters (frame_sizes must hold
+// STREAM_MAX_SUBSTREAMS items). The original packet timing is reproduced,
+// unless fast is true.
+bool
+stream_init_replay(struct stream *stream, const char *filename, bool fast,
+                   struct sc_size *frame_sizes, unsigned *substream_count,
+                   const struct stream_callbacks *cbs, void *cbs_userdata);
+
+// Interrupt a replaying stream (a live stream is interrupted by shutting
+// down its socket instead)
+void
+stream_interrupt(struct stream *stream);
+
+// Service an additional socket from the stream thread: on_readable() is
+// called (on the stream thread) whenever the socket is readable. If it
+// returns false, the socket is not serviced anymore.
+// Must be called before the stream is started.
+void
+stream_set_aux_socket(struct stream *stream, sc_socket socket,
+                      bool (*on_readable)(void *userdata), void *userdata);
+
+// Attach a sink to the primary substream of a running stream: the sink is
+// opened, then the cached config and keyframe packets are replayed to it, so
+// that it produces output immediately instead of waiting for the next
+// keyframe.
+bool
+stream_attach_sink(struct stream *stream, struct sc_packet_sink *sink);
 
 bool
 stream_start(struct stream *stream);
@@ -1,10 +1,12 @@
 #include "util/file.h"
 
+#include <errno.h>
 #include <limits.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <sys/types.h>
 #include <unistd.h>
 
 #include "util/log.h"
@@ -68,6 +70,60 @@ sc_file_get_executable_path(void) {
 #endif
 }
 
+// return the path of `name` in the scrcpy subdirectory of the XDG base
+// directory given by `envvar` (defaulting to $HOME/`fallback`), creating the
+// directories if necessary
+static char *
+get_xdg_path(const char *envvar, const char *fallback, const char *name) {
+    char dir[PATH_MAX];
+    int r;
+
+    const char *base = getenv(envvar);
+    if (base && base[0] == '/') {
+        r = snprintf(dir, sizeof(dir), "%s/scrcpy", base);
+    } else {
+        const char *home = getenv("HOME");
+        if (!home) {
+            LOGW("Could not get HOME directory");
+            return NULL;
+        }
+        r = snprintf(dir, sizeof(dir), "%s/%s", home, fallback);
+        if (r < 0 || (size_t) r >= sizeof(dir)) {
+            return NULL;
+        }
+        // ensure that the parent exists (ignore failure, the mkdir below
+        // will fail anyway)
+        (void) mkdir(dir, 0700);
+
+        r = snprintf(dir, sizeof(dir), "%s/%s/scrcpy", home, fallback);
+    }
+    if (r < 0 || (size_t) r >= sizeof(dir)) {
+        return NULL;
+    }
+
+    if (mkdir(dir, 0700) && errno != EEXIST) {
+        LOGW("Could not create directory: %s", dir);
+        return NULL;
+    }
+
+    char *path;
+    if (asprintf(&path, "%s/%s", dir, name) == -1) {
+        LOG_OOM();
+        return NULL;
+    }
+    return path;
+}
+
+char *
+sc_file_get_cache_path(const char *name) {
+    return get_xdg_path("XDG_CACHE_HOME", ".cache", name);
+}
+
+char *
+sc_file_get_config_path(const char *name) {
+    return get_xdg_path("XDG_CONFIG_HOME", ".config", name);
+}
+
 bool
 sc_file_is_regular(const char *path) {
     struct stat path_stat;
@@ -22,6 +22,52 @@ sc_file_get_executable_path(void) {
     return sc_str_from_wchars(buf);
 }
 
+// return the path of `name` in the scrcpy subdirectory of the base directory
+// given by `envvar`, creating the subdirectory if necessary
+static char *
+get_appdata_path(const char *envvar, const char *name) {
+    const char *base = getenv(envvar);
+    if (!base) {
+        LOGW("Could not get %s directory", envvar);
+        return NULL;
+    }
+
+    char *dir;
+    if (asprintf(&dir, "%s\\scrcpy", base) == -1) {
+        LOG_OOM();
+        return NULL;
+    }
+
+    wchar_t *wide_dir = sc_str_to_wchars(dir);
+    if (!wide_dir) {
+        LOG_OOM();
+        free(dir);
+        return NULL;
+    }
+    // ignore failure (the directory may already exist)
+    CreateDirectoryW(wide_dir, NULL);
+    free(wide_dir);
+
+    char *path;
+    if (asprintf(&path, "%s\\%s", dir, name) == -1) {
+        LOG_OOM();
+        free(dir);
+        return NULL;
+    }
+    free(dir);
+    return path;
+}
+
+char *
+sc_file_get_cache_path(const char *name) {
+    return get_appdata_path("LOCALAPPDATA", name);
+}
+
+char *
+sc_file_get_config_path(const char *name) {
+    return get_appdata_path("APPDATA", name);
+}
+
 bool
 sc_file_is_regular(const char *path) {
     wchar_t *wide_path = sc_str_to_wchars(path);
@@ -0,0 +1,97 @@
+#include "util/net.h"
+
+#include "util/log.h"
+
+// Overlapped I/O backend for the socket data path.
+//
+// The generic implementation performs one blocking recv() per call, which
+// costs a kernel wait (and the associated wakeup) per packet; at the video
+// socket packet rate, this shows up as kernel time on Windows. An overlapped
+// WSARecv()/WSASend() completes inline (without any wait) whenever the data
+// is already buffered, and otherwise performs a single event wait.
+//
+// A completion port is not used: the net API is blocking with at most one
+// operation in flight per direction, so there are never several completions
+// to batch.
+
+static WSAEVENT
+get_event(WSAEVENT *event) {
+    // Lazily created. Each direction of a socket is only used from a single
+    // thread, so no synchronization is necessary.
+    if (*event == WSA_INVALID_EVENT) {
+        *event = WSACreateEvent();
+    }
+    return *event;
+}
+
+static ssize_t
+overlapped_recv(sc_socket socket, void *buf, size_t len, DWORD flags) {
+    WSAEVENT event = get_event(&socket->recv_event);
+    if (event == WSA_INVALID_EVENT) {
+        // fall back to the blocking path
+        return recv(socket->socket, buf, len, (int) flags);
+    }
+
+    WSABUF wsabuf = {
+        .len = (ULONG) len,
+        .buf = buf,
+    };
+    WSAOVERLAPPED ovl = {
+        .hEvent = event,
+    };
+    DWORD received;
+    int r = WSARecv(socket->socket, &wsabuf, 1, &received, &flags, &ovl,
+                    NULL);
+    if (r == SOCKET_ERROR) {
+        if (WSAGetLastError() != WSA_IO_PENDING) {
+            return -1;
+        }
+        if (!WSAGetOverlappedResult(socket->socket, &ovl, &received, TRUE,
+                                    &flags)) {
+            return -1;
+        }
+    }
+
+    return received;
+}
+
+ssize_t
+net_recv(sc_socket socket, void *buf, size_t len) {
+    return overlapped_recv(socket, buf, len, 0);
+}
+
+ssize_t
+net_recv_all(sc_socket socket, void *buf, size_t len) {
+    return overlapped_recv(socket, buf, len, MSG_WAITALL);
+}
+
+ssize_t
+net_send(sc_socket socket, const void *buf, size_t len) {
+    WSAEVENT event = get_event(&socket->send_event);
+    if (event == WSA_INVALID_EVENT) {
+        // fall back to the blocking path
+        return send(socket->socket, buf, len, 0);
+    }
+
+    WSABUF wsabuf = {
+        .len = (ULONG) len,
+        .buf = (char *) buf,
+    };
+    WSAOVERLAPPED ovl = {
+        .hEvent = event,
+    };
+    DWORD sent;
+    int r = WSASend(socket->socket, &wsabuf, 1, &sent, 0, &ovl, NULL);
+    if (r == SOCKET_ERROR) {
+        if (WSAGetLastError() != WSA_IO_PENDING) {
+            return -1;
+        }
+        DWORD flags;
+        if (!WSAGetOverlappedResult(socket->socket, &ovl, &sent, TRUE,
+                                    &flags)) {
+            return -1;
+        }
+    }
+
+    return sent;
+}
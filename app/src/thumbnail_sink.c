@@ -0,0 +1,422 @@
+#include "thumbnail_sink.h"
+
+#include <assert.h>
+#include <libswscale/swscale.h>
+
+#include "util/buffer_util.h"
+#include "util/log.h"
+
+/** Downcast frame_sink to sc_thumbnail_sink */
+#define DOWNCAST(SINK) container_of(SINK, struct sc_thumbnail_sink, frame_sink)
+
+#define SC_THUMBNAIL_INTERVAL SC_TICK_FROM_SEC(1)
+#define SC_THUMBNAIL_MAX_SIZE 256
+
+static struct sc_size
+get_thumbnail_size(int width, int height) {
+    int max = width > height ? width : height;
+    if (max > SC_THUMBNAIL_MAX_SIZE) {
+        width = width * SC_THUMBNAIL_MAX_SIZE / max;
+        height = height * SC_THUMBNAIL_MAX_SIZE / max;
+    }
+
+    // dimensions must be even for YUV 4:2:0
+    struct sc_size size = {width & ~1, height & ~1};
+    return size;
+}
+
+static void
+sc_thumbnail_sink_close_encoder(struct sc_thumbnail_sink *ts) {
+    if (ts->sws_ctx) {
+        sws_freeContext(ts->sws_ctx);
+        ts->sws_ctx = NULL;
+    }
+    if (ts->encoder_ctx) {
+        avcodec_close(ts->encoder_ctx);
+        avcodec_free_context(&ts->encoder_ctx);
+    }
+    av_frame_unref(ts->scaled_frame);
+}
+
+// (re)configure the scaler and the JPEG encoder for the source frame
+// dimensions (they may change on device rotation or resolution change)
+static bool
+sc_thumbnail_sink_prepare(struct sc_thumbnail_sink *ts, const AVFrame *frame) {
+    if (ts->encoder_ctx && frame->width == ts->src_size.width
+            && frame->height == ts->src_size.height) {
+        return true;
+    }
+
+    sc_thumbnail_sink_close_encoder(ts);
+
+    struct sc_size size = get_thumbnail_size(frame->width, frame->height);
+
+    ts->sws_ctx = sws_getContext(frame->width, frame->height, frame->format,
+                                 size.width, size.height, AV_PIX_FMT_YUVJ420P,
+                                 SWS_BILINEAR, NULL, NULL, NULL);
+    if (!ts->sws_ctx) {
+        LOGE("Could not create thumbnail scaler");
+        return false;
+    }
+
+    const AVCodec *encoder = avcodec_find_encoder(AV_CODEC_ID_MJPEG);
+    if (!encoder) {
+        LOGE("MJPEG encoder not found");
+        goto error_free_sws;
+    }
+
+    ts->encoder_ctx = avcodec_alloc_context3(encoder);
+    if (!ts->encoder_ctx) {
+        LOG_OOM();
+        goto error_free_sws;
+    }
+
+    ts->encoder_ctx->width = size.width;
+    ts->encoder_ctx->height = size.height;
+    ts->encoder_ctx->pix_fmt = AV_PIX_FMT_YUVJ420P;
+    ts->encoder_ctx->time_base.num = 1;
+    ts->encoder_ctx->time_base.den = 1;
+
+    if (avcodec_open2(ts->encoder_ctx, encoder, NULL) < 0) {
+        LOGE("Could not open thumbnail encoder");
+        goto error_free_encoder_ctx;
+    }
+
+    ts->scaled_frame->format = AV_PIX_FMT_YUVJ420P;
+    ts->scaled_frame->width = size.width;
+    ts->scaled_frame->height = size.height;
+    if (av_frame_get_buffer(ts->scaled_frame, 0)) {
+        LOG_OOM();
+        goto error_close_encoder;
+    }
+
+    ts->src_size.width = frame->width;
+    ts->src_size.height = frame->height;
+
+    LOGD("Thumbnail size: %" PRIu16 "x%" PRIu16, size.width, size.height);
+
+    return true;
+
+error_close_encoder:
+    avcodec_close(ts->encoder_ctx);
+error_free_encoder_ctx:
+    avcodec_free_context(&ts->encoder_ctx);
+error_free_sws:
+    sws_freeContext(ts->sws_ctx);
+    ts->sws_ctx = NULL;
+    return false;
+}
+
+// send the packet to all connected clients, dropping the clients on error
+// (must be called with the mutex locked)
+static void
+send_to_clients(struct sc_thumbnail_sink *ts, const AVPacket *packet) {
+    assert(packet->size >= 0);
+
+    uint8_t header[4];
+    buffer_write32be(header, packet->size);
+
+    unsigned i = 0;
+    while (i < ts->client_count) {
+        sc_socket client = ts->clients[i];
+        bool ok = net_send_all(client, header, sizeof(header)) > 0
+               && net_send_all(client, packet->data, packet->size) > 0;
+        if (ok) {
+            ++i;
+        } else {
+            LOGD("Thumbnail client disconnected");
+            net_close(client);
+            ts->clients[i] = ts->clients[--ts->client_count];
+        }
+    }
+}
+
+static bool
+encode_and_send_frame(struct sc_thumbnail_sink *ts, const AVFrame *frame) {
+    bool ok = sc_thumbnail_sink_prepare(ts, frame);
+    if (!ok) {
+        return false;
+    }
+
+    sws_scale(ts->sws_ctx, (const uint8_t *const *) frame->data,
+              frame->linesize, 0, frame->height, ts->scaled_frame->data,
+              ts->scaled_frame->linesize);
+    ts->scaled_frame->pts = frame->pts;
+
+    int ret = avcodec_send_frame(ts->encoder_ctx, ts->scaled_frame);
+    if (ret < 0 && ret != AVERROR(EAGAIN)) {
+        LOGE("Could not send thumbnail frame: %d", ret);
+        return false;
+    }
+
+    ret = avcodec_receive_packet(ts->encoder_ctx, ts->packet);
+    if (ret == 0) {
+        sc_mutex_lock(&ts->mutex);
+        send_to_clients(ts, ts->packet);
+        sc_mutex_unlock(&ts->mutex);
+        av_packet_unref(ts->packet);
+    } else if (ret != AVERROR(EAGAIN)) {
+        LOGE("Could not receive thumbnail packet: %d", ret);
+        return false;
+    }
+
+    return true;
+}
+
+static int
+run_thumbnail_sink(void *data) {
+    struct sc_thumbnail_sink *ts = data;
+
+    for (;;) {
+        sc_mutex_lock(&ts->mutex);
+
+        while (!ts->stopped && !ts->has_frame) {
+            sc_cond_wait(&ts->cond, &ts->mutex);
+        }
+
+        if (ts->stopped) {
+            sc_mutex_unlock(&ts->mutex);
+            break;
+        }
+
+        ts->has_frame = false;
+        av_frame_move_ref(ts->frame, ts->pending_frame);
+        sc_mutex_unlock(&ts->mutex);
+
+        bool ok = encode_and_send_frame(ts, ts->frame);
+        av_frame_unref(ts->frame);
+        if (!ok) {
+            // A failed thumbnail must not stop the sink, the next frame may
+            // succeed (the error is already logged)
+            continue;
+        }
+    }
+
+    LOGD("Thumbnail thread ended");
+
+    return 0;
+}
+
+static int
+run_thumbnail_accept(void *data) {
+    struct sc_thumbnail_sink *ts = data;
+
+    for (;;) {
+        sc_socket client = net_accept(ts->server_socket);
+        if (client == SC_SOCKET_NONE) {
+            // interrupted (or error)
+            break;
+        }
+
+        sc_mutex_lock(&ts->mutex);
+        bool stopped = ts->stopped;
+        if (!stopped && ts->client_count < SC_THUMBNAIL_MAX_CLIENTS) {
+            ts->clients[ts->client_count++] = client;
+            client = SC_SOCKET_NONE;
+        }
+        sc_mutex_unlock(&ts->mutex);
+
+        if (client != SC_SOCKET_NONE) {
+            // rejected (stopped or too many clients)
+            net_close(client);
+        } else {
+            LOGI("Thumbnail client connected");
+        }
+
+        if (stopped) {
+            break;
+        }
+    }
+
+    LOGD("Thumbnail accept thread ended");
+
+    return 0;
+}
+
+static bool
+sc_thumbnail_sink_open(struct sc_thumbnail_sink *ts) {
+    bool ok = sc_mutex_init(&ts->mutex);
+    if (!ok) {
+        return false;
+    }
+
+    ok = sc_cond_init(&ts->cond);
+    if (!ok) {
+        goto error_mutex_destroy;
+    }
+
+    ts->pending_frame = av_frame_alloc();
+    if (!ts->pending_frame) {
+        LOG_OOM();
+        goto error_cond_destroy;
+    }
+
+    ts->frame = av_frame_alloc();
+    if (!ts->frame) {
+        LOG_OOM();
+        goto error_free_pending_frame;
+    }
+
+    ts->scaled_frame = av_frame_alloc();
+    if (!ts->scaled_frame) {
+        LOG_OOM();
+        goto error_free_frame;
+    }
+
+    ts->packet = av_packet_alloc();
+    if (!ts->packet) {
+        LOG_OOM();
+        goto error_free_scaled_frame;
+    }
+
+    ts->server_socket = net_socket();
+    if (ts->server_socket == SC_SOCKET_NONE) {
+        goto error_free_packet;
+    }
+
+    if (!net_listen(ts->server_socket, IPV4_LOCALHOST, ts->port, 1)) {
+        LOGE("Could not listen on port %" PRIu16 " for thumbnails", ts->port);
+        goto error_close_server_socket;
+    }
+
+    ts->has_frame = false;
+    ts->stopped = false;
+    ts->next_date = 0;
+    ts->client_count = 0;
+    ts->encoder_ctx = NULL;
+    ts->sws_ctx = NULL;
+
+    LOGD("Starting thumbnail thread");
+    ok = sc_thread_create(&ts->thread, run_thumbnail_sink, "thumbnail", ts);
+    if (!ok) {
+        LOGC("Could not start thumbnail thread");
+        goto error_close_server_socket;
+    }
+
+    ok = sc_thread_create(&ts->accept_thread, run_thumbnail_accept,
+                          "thumbnail-accept", ts);
+    if (!ok) {
+        LOGC("Could not start thumbnail accept thread");
+        sc_mutex_lock(&ts->mutex);
+        ts->stopped = true;
+        sc_cond_signal(&ts->cond);
+        sc_mutex_unlock(&ts->mutex);
+        sc_thread_join(&ts->thread, NULL);
+        goto error_close_server_socket;
+    }
+
+    LOGI("Thumbnail sink listening on localhost:%" PRIu16, ts->port);
+
+    return true;
+
+error_close_server_socket:
+    net_close(ts->server_socket);
+error_free_packet:
+    av_packet_free(&ts->packet);
+error_free_scaled_frame:
+    av_frame_free(&ts->scaled_frame);
+error_free_frame:
+    av_frame_free(&ts->frame);
+error_free_pending_frame:
+    av_frame_free(&ts->pending_frame);
+error_cond_destroy:
+    sc_cond_destroy(&ts->cond);
+error_mutex_destroy:
+    sc_mutex_destroy(&ts->mutex);
+
+    return false;
+}
+
+static void
+sc_thumbnail_sink_close(struct sc_thumbnail_sink *ts) {
+    sc_mutex_lock(&ts->mutex);
+    ts->stopped = true;
+    sc_cond_signal(&ts->cond);
+    sc_mutex_unlock(&ts->mutex);
+
+    // wake up the blocking accept()
+    net_interrupt(ts->server_socket);
+
+    sc_thread_join(&ts->thread, NULL);
+    sc_thread_join(&ts->accept_thread, NULL);
+
+    for (unsigned i = 0; i < ts->client_count; ++i) {
+        net_close(ts->clients[i]);
+    }
+    net_close(ts->server_socket);
+
+    sc_thumbnail_sink_close_encoder(ts);
+    av_packet_free(&ts->packet);
+    av_frame_free(&ts->scaled_frame);
+    av_frame_free(&ts->frame);
+    av_frame_free(&ts->pending_frame);
+    sc_cond_destroy(&ts->cond);
+    sc_mutex_destroy(&ts->mutex);
+}
+
+static bool
+sc_thumbnail_frame_sink_open(struct sc_frame_sink *sink) {
+    struct sc_thumbnail_sink *ts = DOWNCAST(sink);
+    return sc_thumbnail_sink_open(ts);
+}
+
+static void
+sc_thumbnail_frame_sink_close(struct sc_frame_sink *sink) {
+    struct sc_thumbnail_sink *ts = DOWNCAST(sink);
+    sc_thumbnail_sink_close(ts);
+}
+
+static bool
+sc_thumbnail_frame_sink_push(struct sc_frame_sink *sink,
+                             const AVFrame *frame) {
+    struct sc_thumbnail_sink *ts = DOWNCAST(sink);
+
+    sc_tick now = sc_tick_now();
+    if (now < ts->next_date) {
+        // thumbnails are low rate, drop the frame immediately
+        return true;
+    }
+
+    sc_mutex_lock(&ts->mutex);
+    if (!ts->client_count) {
+        // do not pay for scaling and encoding without consumers
+        sc_mutex_unlock(&ts->mutex);
+        return true;
+    }
+
+    av_frame_unref(ts->pending_frame);
+    if (av_frame_ref(ts->pending_frame, frame)) {
+        sc_mutex_unlock(&ts->mutex);
+        LOG_OOM();
+        // not fatal for the whole pipeline
+        return true;
+    }
+
+    ts->has_frame = true;
+    sc_cond_signal(&ts->cond);
+    sc_mutex_unlock(&ts->mutex);
+
+    ts->next_date = now + SC_THUMBNAIL_INTERVAL;
+
+    return true;
+}
+
+bool
+sc_thumbnail_sink_init(struct sc_thumbnail_sink *ts, uint16_t port) {
+    ts->port = port;
+
+    static const struct sc_frame_sink_ops ops = {
+        .open = sc_thumbnail_frame_sink_open,
+        .close = sc_thumbnail_frame_sink_close,
+        .push = sc_thumbnail_frame_sink_push,
+    };
+
+    ts->frame_sink.ops = &ops;
+
+    return true;
+}
+
+void
+sc_thumbnail_sink_destroy(struct sc_thumbnail_sink *ts) {
+    (void) ts;
+}
@@ -0,0 +1,63 @@
+#ifndef SC_THUMBNAIL_SINK_H
+#define SC_THUMBNAIL_SINK_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <libavformat/avformat.h>
+
+#include "coords.h"
+#include "trait/frame_sink.h"
+#include "util/net.h"
+#include "util/thread.h"
+#include "util/tick.h"
+
+// forward declaration
+struct SwsContext;
+
+#define SC_THUMBNAIL_MAX_CLIENTS 4
+
+/**
+ * Expose low-rate JPEG thumbnails of the mirrored display over a local TCP
+ * socket, so that monitoring tools can observe a session without running a
+ * video decoder.
+ *
+ * Each thumbnail is sent to every connected client as a 4-byte big-endian
+ * length followed by the JPEG data.
+ */
+struct sc_thumbnail_sink {
+    struct sc_frame_sink frame_sink; // frame sink trait
+
+    uint16_t port;
+
+    sc_thread thread; // scale, encode and send thumbnails
+    sc_thread accept_thread;
+    sc_mutex mutex;
+    sc_cond cond;
+    bool has_frame;
+    bool stopped;
+
+    // date of the next thumbnail (only accessed from the producer thread)
+    sc_tick next_date;
+
+    sc_socket server_socket;
+    sc_socket clients[SC_THUMBNAIL_MAX_CLIENTS];
+    unsigned client_count;
+
+    AVFrame *pending_frame; // latest frame pushed (protected by mutex)
+    AVFrame *frame; // frame being encoded (thumbnail thread only)
+    AVFrame *scaled_frame;
+    AVPacket *packet;
+    AVCodecContext *encoder_ctx;
+    struct SwsContext *sws_ctx;
+    // source dimensions the scaler and encoder are configured for
+    struct sc_size src_size;
+};
+
+bool
+sc_thumbnail_sink_init(struct sc_thumbnail_sink *ts, uint16_t port);
+
+void
+sc_thumbnail_sink_destroy(struct sc_thumbnail_sink *ts);
+
+#endif
@@ -18,6 +18,7 @@ sc_acksync_init(struct sc_acksync *as) {
 
     as->stopped = false;
     as->ack = SC_SEQUENCE_INVALID;
+    as->pending = SC_SEQUENCE_INVALID;
 
     return true;
 }
@@ -41,12 +42,26 @@ sc_acksync_ack(struct sc_acksync *as, uint64_t sequence) {
     sc_mutex_unlock(&as->mutex);
 }
 
+void
+sc_acksync_register(struct sc_acksync *as, uint64_t sequence) {
+    sc_mutex_lock(&as->mutex);
+
+    // Sequences are requested in increasing order
+    assert(sequence >= as->pending);
+
+    as->pending = sequence;
+    // wake up a waiter blocked on an older (now superseded) sequence
+    sc_cond_signal(&as->cond);
+
+    sc_mutex_unlock(&as->mutex);
+}
+
 enum sc_acksync_wait_result
 sc_acksync_wait(struct sc_acksync *as, uint64_t ack, sc_tick deadline) {
     sc_mutex_lock(&as->mutex);
 
     bool timed_out = false;
-    while (!as->stopped && as->ack < ack && !timed_out) {
+    while (!as->stopped && as->ack < ack && as->pending <= ack && !timed_out) {
         timed_out = !sc_cond_timedwait(&as->cond, &as->mutex, deadline);
     }
 
@@ -55,6 +70,8 @@ sc_acksync_wait(struct sc_acksync *as, uint64_t ack, sc_tick deadline) {
         ret = SC_ACKSYNC_WAIT_INTR;
     } else if (as->ack >= ack) {
         ret = SC_ACKSYNC_WAIT_OK;
+    } else if (as->pending > ack) {
+        ret = SC_ACKSYNC_WAIT_SUPERSEDED;
     } else {
         assert(timed_out);
         ret = SC_ACKSYNC_WAIT_TIMEOUT;
@@ -23,12 +23,23 @@ struct sc_acksync {
 
     // Last acked value, initially SC_SEQUENCE_INVALID
     uint64_t ack;
+
+    // Highest registered (requested) sequence, initially SC_SEQUENCE_INVALID
+    //
+    // Since acknowledgements are monotonic, a waiter blocked on an older
+    // sequence is released as "superseded" as soon as a newer sequence is
+    // registered: there is no point serializing a burst of requests on
+    // intermediate acknowledgements.
+    uint64_t pending;
 };
 
 enum sc_acksync_wait_result {
     // Acknowledgment received
     SC_ACKSYNC_WAIT_OK,
 
+    // A newer sequence has been registered while waiting
+    SC_ACKSYNC_WAIT_SUPERSEDED,
+
     // Timeout expired
     SC_ACKSYNC_WAIT_TIMEOUT,
 
@@ -51,8 +62,20 @@ sc_acksync_destroy(struct sc_acksync *as);
 void
 sc_acksync_ack(struct sc_acksync *as, uint64_t sequence);
 
+/**
+ * Register `sequence` as requested (awaiting acknowledgement)
+ *
+ * This releases any waiter blocked on an older sequence with
+ * SC_ACKSYNC_WAIT_SUPERSEDED.
+ */
+void
+sc_acksync_register(struct sc_acksync *as, uint64_t sequence);
+
 /**
  * Wait for acknowledgment of sequence `ack` (or higher)
+ *
+ * Return SC_ACKSYNC_WAIT_SUPERSEDED immediately if a sequence greater than
+ * `ack` has been registered.
  */
 enum sc_acksync_wait_result
 sc_acksync_wait(struct sc_acksync *as, uint64_t ack, sc_tick deadline);
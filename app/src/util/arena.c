@@ -0,0 +1,167 @@
+#include "arena.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+// each block starts with a header, and both the header and the payload are
+// padded so that every block offset keeps the strictest alignment
+struct sc_arena_block {
+    size_t size; // total block size, header and padding included
+    bool free;
+};
+
+#define SC_ARENA_ALIGN (sizeof(max_align_t))
+
+static inline size_t
+sc_arena_align(size_t size) {
+    return (size + SC_ARENA_ALIGN - 1) / SC_ARENA_ALIGN * SC_ARENA_ALIGN;
+}
+
+#define SC_ARENA_HEADER_SIZE (sc_arena_align(sizeof(struct sc_arena_block)))
+
+bool
+sc_arena_init(struct sc_arena *arena, size_t capacity) {
+    assert(capacity == sc_arena_align(capacity));
+
+    arena->data = malloc(capacity);
+    if (!arena->data) {
+        return false;
+    }
+
+    bool ok = sc_mutex_init(&arena->mutex);
+    if (!ok) {
+        free(arena->data);
+        return false;
+    }
+
+    arena->capacity = capacity;
+    arena->head = 0;
+    arena->tail = 0;
+    arena->used = 0;
+
+    return true;
+}
+
+void
+sc_arena_destroy(struct sc_arena *arena) {
+    assert(!arena->used);
+    sc_mutex_destroy(&arena->mutex);
+    free(arena->data);
+}
+
+// write a block header at `offset` and return its payload
+static void *
+sc_arena_place(struct sc_arena *arena, size_t offset, size_t block_size) {
+    struct sc_arena_block *block =
+        (struct sc_arena_block *) (arena->data + offset);
+    block->size = block_size;
+    block->free = false;
+    arena->head = (offset + block_size) % arena->capacity;
+    arena->used += block_size;
+    return arena->data + offset + SC_ARENA_HEADER_SIZE;
+}
+
+// the mutex must be held
+static void *
+sc_arena_try_alloc(struct sc_arena *arena, size_t size) {
+    size_t block_size = SC_ARENA_HEADER_SIZE + sc_arena_align(size);
+    if (block_size > arena->capacity - arena->used) {
+        return NULL;
+    }
+
+    if (!arena->used) {
+        // restart from the beginning to maximize contiguous space
+        arena->head = 0;
+        arena->tail = 0;
+        return sc_arena_place(arena, 0, block_size);
+    }
+
+    if (arena->head < arena->tail) {
+        // free space is the single range [head, tail)
+        if (block_size > arena->tail - arena->head) {
+            return NULL;
+        }
+        return sc_arena_place(arena, arena->head, block_size);
+    }
+
+    // free space is [head, capacity) then [0, tail)
+    if (block_size <= arena->capacity - arena->head) {
+        return sc_arena_place(arena, arena->head, block_size);
+    }
+
+    if (block_size > arena->tail) {
+        return NULL;
+    }
+
+    // wrap: mark the remainder at the end as a free filler block, so that
+    // reclaiming can walk over it, then allocate from the beginning
+    size_t remainder = arena->capacity - arena->head;
+    if (remainder) {
+        assert(remainder >= SC_ARENA_HEADER_SIZE);
+        struct sc_arena_block *filler =
+            (struct sc_arena_block *) (arena->data + arena->head);
+        filler->size = remainder;
+        filler->free = true;
+        arena->used += remainder;
+    }
+    return sc_arena_place(arena, 0, block_size);
+}
+
+void *
+sc_arena_alloc(struct sc_arena *arena, size_t size) {
+    sc_mutex_lock(&arena->mutex);
+    void *data = sc_arena_try_alloc(arena, size);
+    sc_mutex_unlock(&arena->mutex);
+    if (data) {
+        return data;
+    }
+
+    // the ring is full (or the request too large), fall back to the heap
+    return malloc(size);
+}
+
+char *
+sc_arena_strdup(struct sc_arena *arena, const char *s) {
+    size_t size = strlen(s) + 1;
+    char *copy = sc_arena_alloc(arena, size);
+    if (!copy) {
+        return NULL;
+    }
+    memcpy(copy, s, size);
+    return copy;
+}
+
+void
+sc_arena_free(struct sc_arena *arena, void *data) {
+    if (!data) {
+        return;
+    }
+
+    uint8_t *ptr = data;
+    if (ptr < arena->data || ptr >= arena->data + arena->capacity) {
+        // allocated by the heap fallback
+        free(data);
+        return;
+    }
+
+    sc_mutex_lock(&arena->mutex);
+
+    struct sc_arena_block *block =
+        (struct sc_arena_block *) (ptr - SC_ARENA_HEADER_SIZE);
+    assert(!block->free);
+    block->free = true;
+
+    // reclaim the contiguous run of free blocks from the tail
+    while (arena->used) {
+        struct sc_arena_block *oldest =
+            (struct sc_arena_block *) (arena->data + arena->tail);
+        if (!oldest->free) {
+            break;
+        }
+        arena->used -= oldest->size;
+        arena->tail = (arena->tail + oldest->size) % arena->capacity;
+    }
+
+    sc_mutex_unlock(&arena->mutex);
+}
@@ -0,0 +1,52 @@
+#ifndef SC_ARENA_H
+#define SC_ARENA_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "util/thread.h"
+
+/**
+ * Ring allocator for short-lived message payloads
+ *
+ * Serve allocations from a fixed preallocated ring, so that a sustained
+ * stream of small buffers allocated and released in (roughly) FIFO order
+ * performs no heap traffic at all. When the ring is full or a request is too
+ * large, transparently fall back to malloc().
+ *
+ * Buffers may be released in any order; the space of a buffer released
+ * out-of-order is reclaimed once all the buffers allocated before it are
+ * released too.
+ */
+struct sc_arena {
+    sc_mutex mutex;
+    uint8_t *data;
+    size_t capacity;
+    size_t head; // offset of the next allocation
+    size_t tail; // offset of the oldest live block
+    size_t used; // bytes between tail and head, headers included
+};
+
+bool
+sc_arena_init(struct sc_arena *arena, size_t capacity);
+
+// all allocations must have been released
+void
+sc_arena_destroy(struct sc_arena *arena);
+
+// return NULL on allocation failure (never due to the ring being full, the
+// heap fallback is used instead)
+void *
+sc_arena_alloc(struct sc_arena *arena, size_t size);
+
+char *
+sc_arena_strdup(struct sc_arena *arena, const char *s);
+
+// accept NULL and pointers returned by the heap fallback
+void
+sc_arena_free(struct sc_arena *arena, void *data);
+
+#endif
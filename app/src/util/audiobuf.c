@@ -0,0 +1,84 @@
+#include "audiobuf.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool
+sc_audiobuf_init(struct sc_audiobuf *buf, size_t cap) {
+    assert(cap && !(cap & (cap - 1))); // power of two
+
+    buf->data = malloc(cap);
+    if (!buf->data) {
+        return false;
+    }
+
+    buf->cap = cap;
+    atomic_init(&buf->head, 0);
+    atomic_init(&buf->tail, 0);
+    return true;
+}
+
+size_t
+sc_audiobuf_write(struct sc_audiobuf *buf, const uint8_t *from, size_t len) {
+    size_t head = atomic_load_explicit(&buf->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&buf->tail, memory_order_acquire);
+
+    size_t space = buf->cap - (head - tail);
+    if (len > space) {
+        len = space;
+    }
+    if (!len) {
+        return 0;
+    }
+
+    size_t pos = head & (buf->cap - 1);
+    size_t contiguous = buf->cap - pos;
+    if (len <= contiguous) {
+        memcpy(&buf->data[pos], from, len);
+    } else {
+        memcpy(&buf->data[pos], from, contiguous);
+        memcpy(buf->data, from + contiguous, len - contiguous);
+    }
+
+    atomic_store_explicit(&buf->head, head + len, memory_order_release);
+    return len;
+}
+
+size_t
+sc_audiobuf_read(struct sc_audiobuf *buf, uint8_t *to, size_t len) {
+    size_t tail = atomic_load_explicit(&buf->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&buf->head, memory_order_acquire);
+
+    size_t avail = head - tail;
+    if (len > avail) {
+        len = avail;
+    }
+    if (!len) {
+        return 0;
+    }
+
+    size_t pos = tail & (buf->cap - 1);
+    size_t contiguous = buf->cap - pos;
+    if (len <= contiguous) {
+        memcpy(to, &buf->data[pos], len);
+    } else {
+        memcpy(to, &buf->data[pos], contiguous);
+        memcpy(to + contiguous, buf->data, len - contiguous);
+    }
+
+    atomic_store_explicit(&buf->tail, tail + len, memory_order_release);
+    return len;
+}
+
+size_t
+sc_audiobuf_can_read(struct sc_audiobuf *buf) {
+    size_t tail = atomic_load_explicit(&buf->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&buf->head, memory_order_acquire);
+    return head - tail;
+}
+
+void
+sc_audiobuf_destroy(struct sc_audiobuf *buf) {
+    free(buf->data);
+}
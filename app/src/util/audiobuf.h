@@ -0,0 +1,49 @@
+// lock-free single-producer single-consumer byte ring for audio samples
+#ifndef SC_AUDIOBUF_H
+#define SC_AUDIOBUF_H
+
+#include "common.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Contrary to SC_RINGBUF (fixed-size items stored by value), this ring
+// transfers byte chunks of arbitrary size, as required between an audio
+// decoder thread and the audio device callback, which consume different
+// amounts per call.
+//
+// One thread may write and another thread may read concurrently without any
+// lock: the free-running indices are accessed with explicit memory orderings,
+// and each one is written by a single side (head by the producer, tail by the
+// consumer).
+
+struct sc_audiobuf {
+    uint8_t *data;
+    size_t cap; // in bytes, power of two
+    atomic_size_t head; // write index (produced bytes)
+    atomic_size_t tail; // read index (consumed bytes)
+};
+
+bool
+sc_audiobuf_init(struct sc_audiobuf *buf, size_t cap);
+
+// Copy up to `len` bytes into the ring, return the number of bytes actually
+// written (less than `len` if the ring is full)
+size_t
+sc_audiobuf_write(struct sc_audiobuf *buf, const uint8_t *from, size_t len);
+
+// Copy up to `len` bytes out of the ring, return the number of bytes actually
+// read (less than `len` on underrun)
+size_t
+sc_audiobuf_read(struct sc_audiobuf *buf, uint8_t *to, size_t len);
+
+// Number of buffered bytes, as seen from the consumer side
+size_t
+sc_audiobuf_can_read(struct sc_audiobuf *buf);
+
+void
+sc_audiobuf_destroy(struct sc_audiobuf *buf);
+
+#endif
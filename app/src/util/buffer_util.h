@@ -5,42 +5,99 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
+
+// Byte-order conversions implemented with an unaligned load/store and a
+// single byte-swap instruction where the compiler provides one, instead of
+// byte-by-byte shifts; these helpers are inlined into every serialization
+// site (control_msg_serialize, stream_recv_packet), called for each input
+// event and each video packet.
+#if defined(__GNUC__) || defined(__clang__)
+# if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#  define SC_HTOBE16(v) (v)
+#  define SC_HTOBE32(v) (v)
+#  define SC_HTOBE64(v) (v)
+# else
+#  define SC_HTOBE16(v) __builtin_bswap16(v)
+#  define SC_HTOBE32(v) __builtin_bswap32(v)
+#  define SC_HTOBE64(v) __builtin_bswap64(v)
+# endif
+#elif defined(_MSC_VER)
+# include <stdlib.h>
+  // Windows is always little-endian
+# define SC_HTOBE16(v) _byteswap_ushort(v)
+# define SC_HTOBE32(v) _byteswap_ulong(v)
+# define SC_HTOBE64(v) _byteswap_uint64(v)
+#endif
 
 static inline void
 buffer_write16be(uint8_t *buf, uint16_t value) {
+#ifdef SC_HTOBE16
+    uint16_t be = SC_HTOBE16(value);
+    memcpy(buf, &be, 2);
+#else
     buf[0] = value >> 8;
     buf[1] = value;
+#endif
 }
 
 static inline void
 buffer_write32be(uint8_t *buf, uint32_t value) {
+#ifdef SC_HTOBE32
+    uint32_t be = SC_HTOBE32(value);
+    memcpy(buf, &be, 4);
+#else
     buf[0] = value >> 24;
     buf[1] = value >> 16;
     buf[2] = value >> 8;
     buf[3] = value;
+#endif
 }
 
 static inline void
 buffer_write64be(uint8_t *buf, uint64_t value) {
+#ifdef SC_HTOBE64
+    uint64_t be = SC_HTOBE64(value);
+    memcpy(buf, &be, 8);
+#else
     buffer_write32be(buf, value >> 32);
     buffer_write32be(&buf[4], (uint32_t) value);
+#endif
 }
 
 static inline uint16_t
 buffer_read16be(const uint8_t *buf) {
+#ifdef SC_HTOBE16
+    uint16_t be;
+    memcpy(&be, buf, 2);
+    return SC_HTOBE16(be);
+#else
     return (buf[0] << 8) | buf[1];
+#endif
 }
 
 static inline uint32_t
 buffer_read32be(const uint8_t *buf) {
+#ifdef SC_HTOBE32
+    uint32_t be;
+    memcpy(&be, buf, 4);
+    return SC_HTOBE32(be);
+#else
     return ((uint32_t) buf[0] << 24) | (buf[1] << 16) | (buf[2] << 8) | buf[3];
+#endif
 }
 
 static inline uint64_t
 buffer_read64be(const uint8_t *buf) {
+#ifdef SC_HTOBE64
+    uint64_t be;
+    memcpy(&be, buf, 8);
+    return SC_HTOBE64(be);
+#else
     uint32_t msb = buffer_read32be(buf);
     uint32_t lsb = buffer_read32be(&buf[4]);
     return ((uint64_t) msb << 32) | lsb;
+#endif
 }
 
 #endif
@@ -49,4 +49,14 @@
         ok; \
     })
 
+// copy the next item without consuming it
+#define cbuf_peek(PCBUF, PITEM) \
+    ({ \
+        bool ok = !cbuf_is_empty(PCBUF); \
+        if (ok) { \
+            *(PITEM) = (PCBUF)->data[(PCBUF)->tail]; \
+        } \
+        ok; \
+    })
+
 #endif
@@ -0,0 +1,78 @@
+#include "cmd_builder.h"
+
+#include <assert.h>
+#include <stdarg.h>
+#include <stdlib.h>
+
+bool
+sc_cmd_builder_init(struct sc_cmd_builder *builder, size_t init_cap) {
+    if (!sc_strbuf_init(&builder->buf, init_cap)) {
+        return false;
+    }
+
+    builder->count = 0;
+    return true;
+}
+
+void
+sc_cmd_builder_reset(struct sc_cmd_builder *builder) {
+    builder->buf.len = 0;
+    builder->buf.s[0] = '\0';
+    builder->count = 0;
+}
+
+static bool
+sc_cmd_builder_commit(struct sc_cmd_builder *builder, size_t offset) {
+    // separate the parameters with a NUL in the arena
+    if (!sc_strbuf_append_char(&builder->buf, '\0')) {
+        // drop the partially appended parameter
+        builder->buf.len = offset;
+        builder->buf.s[offset] = '\0';
+        return false;
+    }
+
+    builder->offsets[builder->count++] = offset;
+    return true;
+}
+
+bool
+sc_cmd_builder_add(struct sc_cmd_builder *builder, const char *s) {
+    assert(builder->count < SC_CMD_BUILDER_MAX_PARAMS);
+
+    size_t offset = builder->buf.len;
+    if (!sc_strbuf_append_str(&builder->buf, s)) {
+        return false;
+    }
+
+    return sc_cmd_builder_commit(builder, offset);
+}
+
+bool
+sc_cmd_builder_addf(struct sc_cmd_builder *builder, const char *fmt, ...) {
+    assert(builder->count < SC_CMD_BUILDER_MAX_PARAMS);
+
+    size_t offset = builder->buf.len;
+
+    va_list va;
+    va_start(va, fmt);
+    bool ok = sc_strbuf_vappendf(&builder->buf, fmt, va);
+    va_end(va);
+    if (!ok) {
+        return false;
+    }
+
+    return sc_cmd_builder_commit(builder, offset);
+}
+
+const char *const *
+sc_cmd_builder_get_argv(struct sc_cmd_builder *builder) {
+    for (unsigned i = 0; i < builder->count; ++i) {
+        builder->argv[i] = &builder->buf.s[builder->offsets[i]];
+    }
+    return builder->argv;
+}
+
+void
+sc_cmd_builder_destroy(struct sc_cmd_builder *builder) {
+    free(builder->buf.s);
+}
@@ -0,0 +1,68 @@
+#ifndef SC_CMD_BUILDER_H
+#define SC_CMD_BUILDER_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "strbuf.h"
+
+#define SC_CMD_BUILDER_MAX_PARAMS 128
+
+/**
+ * Command line builder
+ *
+ * All the parameter strings are copied into a single arena (a sc_strbuf with
+ * geometric growth), NUL-separated, so that building a command performs at
+ * most one allocation in total, instead of one allocation per parameter.
+ *
+ * The arena is kept across sc_cmd_builder_reset() calls, so a builder may be
+ * reused to assemble several commands without allocating at all.
+ */
+struct sc_cmd_builder {
+    struct sc_strbuf buf; // arena of NUL-separated parameter strings
+    // offsets of the parameters in the arena (the arena may be reallocated
+    // on growth, so pointers may not be stored directly)
+    size_t offsets[SC_CMD_BUILDER_MAX_PARAMS];
+    const char *argv[SC_CMD_BUILDER_MAX_PARAMS];
+    unsigned count;
+};
+
+/**
+ * Initialize the builder with an arena of `init_cap` bytes
+ */
+bool
+sc_cmd_builder_init(struct sc_cmd_builder *builder, size_t init_cap);
+
+/**
+ * Remove all parameters, but keep the arena for reuse
+ */
+void
+sc_cmd_builder_reset(struct sc_cmd_builder *builder);
+
+/**
+ * Append a parameter (copied into the arena)
+ */
+bool
+sc_cmd_builder_add(struct sc_cmd_builder *builder, const char *s);
+
+/**
+ * Append a parameter formatted (as if by printf()) directly into the arena
+ */
+bool
+sc_cmd_builder_addf(struct sc_cmd_builder *builder, const char *fmt, ...);
+
+/**
+ * Return the parameters as an array of `builder->count` strings
+ *
+ * The returned pointers reference the arena: they are invalidated by any
+ * further sc_cmd_builder_add[f]() or by sc_cmd_builder_destroy().
+ */
+const char *const *
+sc_cmd_builder_get_argv(struct sc_cmd_builder *builder);
+
+void
+sc_cmd_builder_destroy(struct sc_cmd_builder *builder);
+
+#endif
@@ -1,5 +1,6 @@
 #include "file.h"
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -46,3 +47,28 @@ sc_file_get_local_path(const char *name) {
     return file_path;
 }
 
+bool
+sc_file_hash(const char *path, uint64_t *hash) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return false;
+    }
+
+    // FNV-1a, same parameters as sc_str_hash(), but over the file bytes
+    uint64_t h = 0xcbf29ce484222325;
+    uint8_t buf[4096];
+    size_t r;
+    while ((r = fread(buf, 1, sizeof(buf), f)) > 0) {
+        for (size_t i = 0; i < r; ++i) {
+            h ^= buf[i];
+            h *= 0x100000001b3;
+        }
+    }
+
+    bool ok = !ferror(f);
+    fclose(f);
+    if (ok) {
+        *hash = h;
+    }
+    return ok;
+}
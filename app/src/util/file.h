@@ -4,6 +4,7 @@
 #include "common.h"
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #ifdef _WIN32
 # define SC_PATH_SEPARATOR '\\'
@@ -40,10 +41,40 @@ sc_file_get_executable_path(void);
 char *
 sc_file_get_local_path(const char *name);
 
+/**
+ * Return the absolute path of a file in the scrcpy cache directory
+ *
+ * Create the cache directory if necessary.
+ *
+ * The result must be freed by the caller using free(). It may return NULL on
+ * error.
+ */
+char *
+sc_file_get_cache_path(const char *name);
+
+/**
+ * Return the absolute path of a file in the scrcpy config directory
+ *
+ * Create the config directory if necessary.
+ *
+ * The result must be freed by the caller using free(). It may return NULL on
+ * error.
+ */
+char *
+sc_file_get_config_path(const char *name);
+
 /**
  * Indicate if the file exists and is not a directory
  */
 bool
 sc_file_is_regular(const char *path);
 
+/**
+ * Compute a 64-bit FNV-1a hash of the file content
+ *
+ * Return false if the file could not be read.
+ */
+bool
+sc_file_hash(const char *path, uint64_t *hash);
+
 #endif
@@ -0,0 +1,80 @@
+#include "histogram.h"
+
+#include <string.h>
+
+void
+sc_histogram_clear(struct sc_histogram *histogram) {
+    memset(histogram->buckets, 0, sizeof(histogram->buckets));
+    histogram->count = 0;
+}
+
+static unsigned
+sc_histogram_msb(uint64_t value) {
+    unsigned msb = 0;
+    while (value >>= 1) {
+        ++msb;
+    }
+    return msb;
+}
+
+static size_t
+sc_histogram_index(uint64_t value) {
+    if (value < SC_HISTOGRAM_SUBBUCKETS) {
+        // group 0: exact values
+        return value;
+    }
+
+    unsigned msb = sc_histogram_msb(value);
+    unsigned shift = msb - SC_HISTOGRAM_SUBBUCKET_BITS;
+    size_t group = shift + 1;
+    size_t sub = (value >> shift) & (SC_HISTOGRAM_SUBBUCKETS - 1);
+    return group * SC_HISTOGRAM_SUBBUCKETS + sub;
+}
+
+// the midpoint of the value range covered by the bucket
+static uint64_t
+sc_histogram_value(size_t index) {
+    if (index < SC_HISTOGRAM_SUBBUCKETS) {
+        return index;
+    }
+
+    size_t group = index / SC_HISTOGRAM_SUBBUCKETS;
+    uint64_t sub = index % SC_HISTOGRAM_SUBBUCKETS;
+    unsigned shift = group - 1;
+    uint64_t lower = (SC_HISTOGRAM_SUBBUCKETS | sub) << shift;
+    return lower + (UINT64_C(1) << shift) / 2;
+}
+
+void
+sc_histogram_add(struct sc_histogram *histogram, uint64_t value) {
+    ++histogram->buckets[sc_histogram_index(value)];
+    ++histogram->count;
+}
+
+uint64_t
+sc_histogram_percentile(const struct sc_histogram *histogram,
+                        unsigned percentile) {
+    if (!histogram->count) {
+        return 0;
+    }
+
+    // the first bucket such that at least `percentile`% of the samples fall
+    // into it or below
+    uint64_t threshold =
+        (histogram->count * percentile + 99) / 100; // rounded up
+    uint64_t cumulated = 0;
+    for (size_t i = 0; i < SC_HISTOGRAM_BUCKETS; ++i) {
+        cumulated += histogram->buckets[i];
+        if (cumulated >= threshold) {
+            return sc_histogram_value(i);
+        }
+    }
+
+    // percentile > 100, return the highest non-empty bucket value
+    for (size_t i = SC_HISTOGRAM_BUCKETS; i;) {
+        if (histogram->buckets[--i]) {
+            return sc_histogram_value(i);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,41 @@
+#ifndef SC_HISTOGRAM_H
+#define SC_HISTOGRAM_H
+
+#include "common.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Constant-memory log-linear histogram ("HDR-style")
+ *
+ * Each power-of-two range is split into 2^SC_HISTOGRAM_SUBBUCKET_BITS linear
+ * sub-buckets, so quantile estimates keep a bounded relative error (~12.5%
+ * with 3 bits) over the whole 64-bit value range, with a fixed footprint of
+ * a couple of KB and O(1) insertion.
+ */
+
+#define SC_HISTOGRAM_SUBBUCKET_BITS 3
+#define SC_HISTOGRAM_SUBBUCKETS (1 << SC_HISTOGRAM_SUBBUCKET_BITS)
+// values 0..7 are exact (group 0), then one group per remaining bit position
+#define SC_HISTOGRAM_BUCKETS \
+    ((65 - SC_HISTOGRAM_SUBBUCKET_BITS) * SC_HISTOGRAM_SUBBUCKETS)
+
+struct sc_histogram {
+    uint32_t buckets[SC_HISTOGRAM_BUCKETS];
+    uint64_t count;
+};
+
+void
+sc_histogram_clear(struct sc_histogram *histogram);
+
+void
+sc_histogram_add(struct sc_histogram *histogram, uint64_t value);
+
+// return an estimate of the requested percentile (0 to 100), or 0 if the
+// histogram is empty
+uint64_t
+sc_histogram_percentile(const struct sc_histogram *histogram,
+                        unsigned percentile);
+
+#endif
@@ -1,5 +1,7 @@
 #include "intmap.h"
 
+#include <stdlib.h>
+
 const struct sc_intmap_entry *
 sc_intmap_find_entry(const struct sc_intmap_entry entries[], size_t len,
                      int32_t key) {
@@ -11,3 +13,35 @@ sc_intmap_find_entry(const struct sc_intmap_entry entries[], size_t len,
     }
     return NULL;
 }
+
+static int
+sc_intmap_entry_cmp(const void *lhs, const void *rhs) {
+    const struct sc_intmap_entry *a = lhs;
+    const struct sc_intmap_entry *b = rhs;
+    return (a->key > b->key) - (a->key < b->key);
+}
+
+const struct sc_intmap_entry *
+sc_intmap_find(struct sc_intmap *intmap, int32_t key) {
+    if (!intmap->sorted) {
+        qsort(intmap->entries, intmap->len, sizeof(*intmap->entries),
+              sc_intmap_entry_cmp);
+        intmap->sorted = true;
+    }
+
+    size_t lo = 0;
+    size_t hi = intmap->len;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        const struct sc_intmap_entry *entry = &intmap->entries[mid];
+        if (entry->key == key) {
+            return entry;
+        }
+        if (entry->key < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return NULL;
+}
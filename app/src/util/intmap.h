@@ -3,6 +3,7 @@
 
 #include "common.h"
 
+#include <stdbool.h>
 #include <stdint.h>
 
 struct sc_intmap_entry {
@@ -21,4 +22,29 @@ sc_intmap_find_entry(const struct sc_intmap_entry entries[], size_t len,
 #define SC_INTMAP_FIND_ENTRY(MAP, KEY) \
     sc_intmap_find_entry(MAP, ARRAY_LEN(MAP), KEY)
 
+/**
+ * A map sorted by key on first lookup, then binary-searched
+ *
+ * Preferable over SC_INTMAP_FIND_ENTRY for maps large enough that a linear
+ * scan costs more than log2(len) comparisons (e.g. the keycode translation
+ * tables, hit for every key event).
+ *
+ * The entries array must be writable (it is sorted in place), and all lookups
+ * must be performed from the same thread.
+ */
+struct sc_intmap {
+    struct sc_intmap_entry *entries;
+    size_t len;
+    bool sorted;
+};
+
+/**
+ * ENTRIES is expected to be a static (non-const) array of sc_intmap_entry.
+ */
+#define SC_INTMAP(ENTRIES) \
+    { ENTRIES, ARRAY_LEN(ENTRIES), false }
+
+const struct sc_intmap_entry *
+sc_intmap_find(struct sc_intmap *intmap, int32_t key);
+
 #endif
@@ -4,80 +4,82 @@
 
 #include <assert.h>
 
+// The store of the token and the load of the interrupted flag (and their
+// counterparts in sc_intr_interrupt()) must not be reordered, otherwise an
+// interruption could be missed by both threads. Sequentially consistent
+// operations guarantee that at least one of the two threads sees the other's
+// write.
+
 bool
 sc_intr_init(struct sc_intr *intr) {
-    bool ok = sc_mutex_init(&intr->mutex);
-    if (!ok) {
-        LOG_OOM();
-        return false;
-    }
-
-    intr->socket = SC_SOCKET_NONE;
-    intr->process = SC_PROCESS_NONE;
-
-    atomic_store_explicit(&intr->interrupted, false, memory_order_relaxed);
+    atomic_init(&intr->socket, SC_SOCKET_NONE);
+    atomic_init(&intr->process, SC_PROCESS_NONE);
+    atomic_init(&intr->interrupted, false);
 
     return true;
 }
 
 bool
 sc_intr_set_socket(struct sc_intr *intr, sc_socket socket) {
-    assert(intr->process == SC_PROCESS_NONE);
+    assert(atomic_load_explicit(&intr->process, memory_order_relaxed)
+            == SC_PROCESS_NONE);
+
+    atomic_store(&intr->socket, socket);
 
-    sc_mutex_lock(&intr->mutex);
-    bool interrupted =
-        atomic_load_explicit(&intr->interrupted, memory_order_relaxed);
-    if (!interrupted) {
-        intr->socket = socket;
+    bool interrupted = atomic_load(&intr->interrupted);
+    if (interrupted && socket != SC_SOCKET_NONE) {
+        // The interruptor may have consumed the previous token only, take the
+        // new one back so that the socket is not interrupted after this call
+        // returned failure
+        atomic_exchange(&intr->socket, SC_SOCKET_NONE);
     }
-    sc_mutex_unlock(&intr->mutex);
 
     return !interrupted;
 }
 
 bool
 sc_intr_set_process(struct sc_intr *intr, sc_pid pid) {
-    assert(intr->socket == SC_SOCKET_NONE);
+    assert(atomic_load_explicit(&intr->socket, memory_order_relaxed)
+            == SC_SOCKET_NONE);
 
-    sc_mutex_lock(&intr->mutex);
-    bool interrupted =
-        atomic_load_explicit(&intr->interrupted, memory_order_relaxed);
-    if (!interrupted) {
-        intr->process = pid;
+    atomic_store(&intr->process, pid);
+
+    bool interrupted = atomic_load(&intr->interrupted);
+    if (interrupted && pid != SC_PROCESS_NONE) {
+        // The interruptor may have consumed the previous token only, take the
+        // new one back so that the process is not interrupted after this call
+        // returned failure
+        atomic_exchange(&intr->process, SC_PROCESS_NONE);
     }
-    sc_mutex_unlock(&intr->mutex);
 
     return !interrupted;
 }
 
 void
 sc_intr_interrupt(struct sc_intr *intr) {
-    sc_mutex_lock(&intr->mutex);
-
-    atomic_store_explicit(&intr->interrupted, true, memory_order_relaxed);
-
-    // No more than one component to interrupt
-    assert(intr->socket == SC_SOCKET_NONE ||
-           intr->process == SC_PROCESS_NONE);
+    atomic_store(&intr->interrupted, true);
 
-    if (intr->socket != SC_SOCKET_NONE) {
+    // Claim the tokens exclusively, so that each component is interrupted at
+    // most once
+    sc_socket socket = atomic_exchange(&intr->socket, SC_SOCKET_NONE);
+    if (socket != SC_SOCKET_NONE) {
         LOGD("Interrupting socket");
-        net_interrupt(intr->socket);
-        intr->socket = SC_SOCKET_NONE;
+        net_interrupt(socket);
     }
-    if (intr->process != SC_PROCESS_NONE) {
+
+    sc_pid pid = atomic_exchange(&intr->process, SC_PROCESS_NONE);
+    if (pid != SC_PROCESS_NONE) {
         LOGD("Interrupting process");
-        sc_process_terminate(intr->process);
-        intr->process = SC_PROCESS_NONE;
+        sc_process_terminate(pid);
     }
-
-    sc_mutex_unlock(&intr->mutex);
 }
 
 void
 sc_intr_destroy(struct sc_intr *intr) {
-    assert(intr->socket == SC_SOCKET_NONE);
-    assert(intr->process == SC_PROCESS_NONE);
+    assert(atomic_load_explicit(&intr->socket, memory_order_relaxed)
+            == SC_SOCKET_NONE);
+    assert(atomic_load_explicit(&intr->process, memory_order_relaxed)
+            == SC_PROCESS_NONE);
 
-    sc_mutex_destroy(&intr->mutex);
+    (void) intr;
 }
@@ -8,7 +8,6 @@
 
 #include "net.h"
 #include "process.h"
-#include "thread.h"
 
 /**
  * Interruptor to wake up a blocking call from another thread
@@ -17,14 +16,12 @@
  * interrupt/close from another thread to wake up the blocking call.
  */
 struct sc_intr {
-    sc_mutex mutex;
+    // Tokens holding the component to interrupt, exchanged atomically so that
+    // registering a component before every blocking call adds no lock traffic
+    // on the I/O path
+    _Atomic(sc_socket) socket;
+    _Atomic(sc_pid) process;
 
-    sc_socket socket;
-    sc_pid process;
-
-    // Written protected by the mutex to avoid race conditions against
-    // sc_intr_set_socket() and sc_intr_set_process(), but can be read
-    // (atomically) without mutex
     atomic_bool interrupted;
 };
 
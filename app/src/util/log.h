@@ -6,17 +6,45 @@
 #include <SDL2/SDL_log.h>
 
 #include "options.h"
+#include "tick.h"
 
 #define LOG_STR_IMPL_(x) # x
 #define LOG_STR(x) LOG_STR_IMPL_(x)
 
-#define LOGV(...) SDL_LogVerbose(SDL_LOG_CATEGORY_APPLICATION, __VA_ARGS__)
-#define LOGD(...) SDL_LogDebug(SDL_LOG_CATEGORY_APPLICATION, __VA_ARGS__)
-#define LOGI(...) SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, __VA_ARGS__)
-#define LOGW(...) SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, __VA_ARGS__)
-#define LOGE(...) SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, __VA_ARGS__)
+// current log level, cached to avoid calling into SDL from the log macros
+// (only written by sc_set_log_level())
+extern enum sc_log_level sc_log_level;
+
+// Check the level before calling into SDL, so that a filtered log site costs
+// a single predictable branch (in particular, the arguments are not
+// evaluated and no formatting occurs)
+#define LOG_AT_LEVEL_(LEVEL, SDL_LOG_FN, ...) \
+    do { \
+        if (sc_log_level <= (LEVEL)) { \
+            SDL_LOG_FN(SDL_LOG_CATEGORY_APPLICATION, __VA_ARGS__); \
+        } \
+    } while (0)
+
+#define LOGV(...) LOG_AT_LEVEL_(SC_LOG_LEVEL_VERBOSE, SDL_LogVerbose, \
+                                __VA_ARGS__)
+#define LOGD(...) LOG_AT_LEVEL_(SC_LOG_LEVEL_DEBUG, SDL_LogDebug, __VA_ARGS__)
+#define LOGI(...) LOG_AT_LEVEL_(SC_LOG_LEVEL_INFO, SDL_LogInfo, __VA_ARGS__)
+#define LOGW(...) LOG_AT_LEVEL_(SC_LOG_LEVEL_WARN, SDL_LogWarn, __VA_ARGS__)
+#define LOGE(...) LOG_AT_LEVEL_(SC_LOG_LEVEL_ERROR, SDL_LogError, __VA_ARGS__)
 #define LOGC(...) SDL_LogCritical(SDL_LOG_CATEGORY_APPLICATION, __VA_ARGS__)
 
+// Log at most once per second per call site (drop the others), to bound the
+// logging cost on hot paths even if a misbehaving device spams messages
+#define LOG_RATE_LIMITED(LOG, ...) \
+    do { \
+        static sc_tick sc_log_next_date_; /* benign race */ \
+        sc_tick sc_log_now_ = sc_tick_now(); \
+        if (sc_log_now_ >= sc_log_next_date_) { \
+            sc_log_next_date_ = sc_log_now_ + SC_TICK_FROM_SEC(1); \
+            LOG(__VA_ARGS__); \
+        } \
+    } while (0)
+
 #define LOG_OOM() \
     LOGC("OOM: %s:%d %s()", __FILE__, __LINE__, __func__)
 
@@ -0,0 +1,127 @@
+#include "memory_budget.h"
+
+#include <assert.h>
+
+#include "util/log.h"
+
+bool
+sc_memory_budget_init(struct sc_memory_budget *mb, size_t budget) {
+    bool ok = sc_mutex_init(&mb->mutex);
+    if (!ok) {
+        return false;
+    }
+
+    mb->budget = budget;
+    mb->used = 0;
+    mb->clients = NULL;
+    return true;
+}
+
+void
+sc_memory_budget_destroy(struct sc_memory_budget *mb) {
+    assert(!mb->clients);
+    assert(!mb->used);
+    sc_mutex_destroy(&mb->mutex);
+}
+
+void
+sc_memory_budget_register(struct sc_memory_budget *mb,
+                          struct sc_memory_budget_client *client) {
+    assert(client->shrink);
+
+    client->used = 0;
+
+    sc_mutex_lock(&mb->mutex);
+    client->next = mb->clients;
+    mb->clients = client;
+    sc_mutex_unlock(&mb->mutex);
+}
+
+void
+sc_memory_budget_unregister(struct sc_memory_budget *mb,
+                            struct sc_memory_budget_client *client) {
+    assert(!client->used);
+
+    sc_mutex_lock(&mb->mutex);
+    struct sc_memory_budget_client **cur = &mb->clients;
+    while (*cur) {
+        if (*cur == client) {
+            *cur = client->next;
+            break;
+        }
+        cur = &(*cur)->next;
+    }
+    sc_mutex_unlock(&mb->mutex);
+}
+
+// return the registered client retaining the most memory, excluding `skip`
+// (NULL if none retains anything)
+static struct sc_memory_budget_client *
+find_biggest_client(struct sc_memory_budget *mb,
+                    const struct sc_memory_budget_client *skip) {
+    sc_mutex_assert(&mb->mutex);
+
+    struct sc_memory_budget_client *biggest = NULL;
+    for (struct sc_memory_budget_client *client = mb->clients; client;
+            client = client->next) {
+        if (client == skip || !client->used) {
+            continue;
+        }
+        if (!biggest || client->used > biggest->used) {
+            biggest = client;
+        }
+    }
+    return biggest;
+}
+
+bool
+sc_memory_budget_acquire(struct sc_memory_budget *mb,
+                         struct sc_memory_budget_client *client,
+                         size_t bytes) {
+    sc_mutex_lock(&mb->mutex);
+
+    while (mb->budget && mb->used + bytes > mb->budget) {
+        struct sc_memory_budget_client *victim =
+            find_biggest_client(mb, client);
+        if (!victim) {
+            // nothing left to shrink, the caller must degrade by itself
+            sc_mutex_unlock(&mb->mutex);
+            return false;
+        }
+
+        size_t overshoot = mb->used + bytes - mb->budget;
+        size_t target = MIN(overshoot, victim->used);
+        size_t before = victim->used;
+
+        // release the lock so that the shrink callback may call
+        // sc_memory_budget_release()
+        sc_mutex_unlock(&mb->mutex);
+        victim->shrink(victim, target);
+        sc_mutex_lock(&mb->mutex);
+
+        if (victim->used >= before) {
+            // the victim could not release anything, do not ask it again,
+            // give up (asking other clients could loop forever since the
+            // state changed while unlocked)
+            sc_mutex_unlock(&mb->mutex);
+            return false;
+        }
+    }
+
+    mb->used += bytes;
+    client->used += bytes;
+    sc_mutex_unlock(&mb->mutex);
+    return true;
+}
+
+void
+sc_memory_budget_release(struct sc_memory_budget *mb,
+                         struct sc_memory_budget_client *client,
+                         size_t bytes) {
+    sc_mutex_lock(&mb->mutex);
+    assert(client->used >= bytes);
+    assert(mb->used >= bytes);
+    client->used -= bytes;
+    mb->used -= bytes;
+    sc_mutex_unlock(&mb->mutex);
+}
@@ -0,0 +1,80 @@
+#ifndef SC_MEMORY_BUDGET_H
+#define SC_MEMORY_BUDGET_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "util/thread.h"
+
+/**
+ * Process-wide memory accounting across the pipeline pools
+ *
+ * Each pool (packets, frames, recorder queue…) registers as a client and
+ * accounts the memory it retains via acquire()/release(). When an
+ * acquisition would exceed the configured budget, the other clients are
+ * asked to shrink, so that memory pressure degrades buffering instead of
+ * growing without bound.
+ */
+
+struct sc_memory_budget_client;
+
+/**
+ * Request the client to release (at least) `target_bytes`
+ *
+ * Called without the budget lock held, so the implementation may call
+ * sc_memory_budget_release(). Shrinking is best effort: the client frees
+ * what it can without breaking its own invariants.
+ */
+typedef void (*sc_memory_budget_shrink_fn)
+    (struct sc_memory_budget_client *client, size_t target_bytes);
+
+struct sc_memory_budget_client {
+    sc_memory_budget_shrink_fn shrink;
+
+    // fields below are managed by the memory budget
+    size_t used;
+    struct sc_memory_budget_client *next;
+};
+
+struct sc_memory_budget {
+    sc_mutex mutex;
+    size_t budget; // in bytes, 0 for unlimited
+    size_t used;
+    struct sc_memory_budget_client *clients;
+};
+
+bool
+sc_memory_budget_init(struct sc_memory_budget *mb, size_t budget);
+
+void
+sc_memory_budget_destroy(struct sc_memory_budget *mb);
+
+// the client must provide its shrink callback, other fields are initialized
+void
+sc_memory_budget_register(struct sc_memory_budget *mb,
+                          struct sc_memory_budget_client *client);
+
+// the client must have released all its accounted memory
+void
+sc_memory_budget_unregister(struct sc_memory_budget *mb,
+                            struct sc_memory_budget_client *client);
+
+/**
+ * Account `bytes` for `client`
+ *
+ * If the budget would be exceeded, ask the biggest other clients to shrink
+ * first. Return false (without accounting anything) if the budget is still
+ * exceeded afterwards; the caller should then avoid the allocation (for
+ * example by dropping or recycling its oldest buffer).
+ */
+bool
+sc_memory_budget_acquire(struct sc_memory_budget *mb,
+                         struct sc_memory_budget_client *client, size_t bytes);
+
+void
+sc_memory_budget_release(struct sc_memory_budget *mb,
+                         struct sc_memory_budget_client *client, size_t bytes);
+
+#endif
@@ -0,0 +1,111 @@
+#include "mpscq.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/log.h"
+
+bool
+sc_mpscq_init(struct sc_mpscq *queue, size_t item_size, size_t capacity) {
+    assert(capacity >= 2);
+    assert(!(capacity & (capacity - 1))); // power of two
+
+    queue->cells = malloc(capacity * item_size);
+    if (!queue->cells) {
+        LOG_OOM();
+        return false;
+    }
+
+    queue->seqs = malloc(capacity * sizeof(*queue->seqs));
+    if (!queue->seqs) {
+        LOG_OOM();
+        free(queue->cells);
+        return false;
+    }
+
+    for (size_t i = 0; i < capacity; ++i) {
+        atomic_init(&queue->seqs[i], i);
+    }
+
+    queue->item_size = item_size;
+    queue->mask = capacity - 1;
+    atomic_init(&queue->enqueue_pos, 0);
+    queue->dequeue_pos = 0;
+
+    return true;
+}
+
+void
+sc_mpscq_destroy(struct sc_mpscq *queue) {
+    free(queue->seqs);
+    free(queue->cells);
+}
+
+bool
+sc_mpscq_push(struct sc_mpscq *queue, const void *item) {
+    size_t pos = atomic_load_explicit(&queue->enqueue_pos,
+                                      memory_order_relaxed);
+    size_t cell;
+    for (;;) {
+        cell = pos & queue->mask;
+        size_t seq = atomic_load_explicit(&queue->seqs[cell],
+                                          memory_order_acquire);
+        intptr_t dif = (intptr_t) seq - (intptr_t) pos;
+        if (dif == 0) {
+            // the cell is free, try to claim it
+            if (atomic_compare_exchange_weak_explicit(&queue->enqueue_pos,
+                                                      &pos, pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                break;
+            }
+            // pos was reloaded by the failed CAS, retry
+        } else if (dif < 0) {
+            // the cell still holds an item from the previous lap
+            return false; // full
+        } else {
+            // another producer claimed this cell, move forward
+            pos = atomic_load_explicit(&queue->enqueue_pos,
+                                       memory_order_relaxed);
+        }
+    }
+
+    memcpy(queue->cells + cell * queue->item_size, item, queue->item_size);
+    // publish the item to the consumer
+    atomic_store_explicit(&queue->seqs[cell], pos + 1, memory_order_release);
+    return true;
+}
+
+bool
+sc_mpscq_take(struct sc_mpscq *queue, void *item) {
+    size_t pos = queue->dequeue_pos;
+    size_t cell = pos & queue->mask;
+    size_t seq = atomic_load_explicit(&queue->seqs[cell],
+                                      memory_order_acquire);
+    if ((intptr_t) seq - (intptr_t) (pos + 1) < 0) {
+        // no published item at this position
+        return false; // empty
+    }
+
+    memcpy(item, queue->cells + cell * queue->item_size, queue->item_size);
+    // mark the cell free for the next lap
+    atomic_store_explicit(&queue->seqs[cell], pos + queue->mask + 1,
+                          memory_order_release);
+    queue->dequeue_pos = pos + 1;
+    return true;
+}
+
+bool
+sc_mpscq_peek(struct sc_mpscq *queue, void *item) {
+    size_t pos = queue->dequeue_pos;
+    size_t cell = pos & queue->mask;
+    size_t seq = atomic_load_explicit(&queue->seqs[cell],
+                                      memory_order_acquire);
+    if ((intptr_t) seq - (intptr_t) (pos + 1) < 0) {
+        return false; // empty
+    }
+
+    memcpy(item, queue->cells + cell * queue->item_size, queue->item_size);
+    return true;
+}
@@ -0,0 +1,58 @@
+#ifndef SC_MPSCQ_H
+#define SC_MPSCQ_H
+
+#include "common.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Lock-free multi-producer single-consumer bounded queue
+ *
+ * Fixed-size ring of equally-sized items, based on a per-cell sequence
+ * number (Vyukov's bounded queue). Any thread may push; a single consumer
+ * thread may peek and take. A push never blocks: it either claims a cell
+ * with one compare-and-swap or reports the queue full, so a producer (the
+ * UI thread injecting input events) is never delayed by the consumer
+ * draining the queue.
+ *
+ * Unlike SC_RINGBUF (single-producer) and struct sc_audiobuf (byte stream),
+ * this queue supports concurrent producers. It provides no blocking
+ * operation; waking up an idle consumer is left to the caller.
+ */
+struct sc_mpscq {
+    uint8_t *cells; // capacity * item_size bytes
+    atomic_size_t *seqs; // one sequence number per cell
+    size_t item_size;
+    size_t mask; // capacity - 1
+    // position of the next push (racing producers resolve it by CAS)
+    atomic_size_t enqueue_pos;
+    // position of the next take (single consumer, no atomicity needed)
+    size_t dequeue_pos;
+};
+
+// `capacity` must be a power of two
+bool
+sc_mpscq_init(struct sc_mpscq *queue, size_t item_size, size_t capacity);
+
+// the queue must be empty
+void
+sc_mpscq_destroy(struct sc_mpscq *queue);
+
+// Copy the item into the queue; return false if the queue is full.
+// May be called from any thread.
+bool
+sc_mpscq_push(struct sc_mpscq *queue, const void *item);
+
+// Copy the oldest item out of the queue; return false if the queue is empty.
+// Must be called from the consumer thread only.
+bool
+sc_mpscq_take(struct sc_mpscq *queue, void *item);
+
+// Same as sc_mpscq_take(), but do not remove the item from the queue.
+bool
+sc_mpscq_peek(struct sc_mpscq *queue, void *item);
+
+#endif
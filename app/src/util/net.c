@@ -16,7 +16,9 @@
 # include <sys/types.h>
 # include <sys/socket.h>
 # include <netinet/in.h>
+# include <netinet/tcp.h>
 # include <arpa/inet.h>
+# include <poll.h>
 # include <unistd.h>
 # include <fcntl.h>
 # define SOCKET_ERROR -1
@@ -63,6 +65,8 @@ wrap(sc_raw_socket sock) {
 
     socket->socket = sock;
     socket->closed = (atomic_flag) ATOMIC_FLAG_INIT;
+    socket->recv_event = WSA_INVALID_EVENT;
+    socket->send_event = WSA_INVALID_EVENT;
 
     return socket;
 #else
@@ -214,6 +218,10 @@ net_accept(sc_socket server_socket) {
     return wrap(raw_sock);
 }
 
+#ifndef __WINDOWS__
+// on Windows, the data path is implemented with overlapped I/O in
+// sys/win/net.c
+
 ssize_t
 net_recv(sc_socket socket, void *buf, size_t len) {
     sc_raw_socket raw_sock = unwrap(socket);
@@ -231,6 +239,7 @@ net_send(sc_socket socket, const void *buf, size_t len) {
     sc_raw_socket raw_sock = unwrap(socket);
     return send(raw_sock, buf, len, 0);
 }
+#endif
 
 ssize_t
 net_send_all(sc_socket socket, const void *buf, size_t len) {
@@ -247,6 +256,108 @@ net_send_all(sc_socket socket, const void *buf, size_t len) {
     return copied;
 }
 
+bool
+net_set_tcp_nodelay(sc_socket socket, bool tcp_nodelay) {
+    sc_raw_socket raw_sock = unwrap(socket);
+
+    int value = tcp_nodelay ? 1 : 0;
+    if (setsockopt(raw_sock, IPPROTO_TCP, TCP_NODELAY, (const void *) &value,
+                   sizeof(value)) == -1) {
+        net_perror("setsockopt(TCP_NODELAY)");
+        return false;
+    }
+
+    return true;
+}
+
+bool
+net_set_recv_buffer_size(sc_socket socket, int size) {
+    sc_raw_socket raw_sock = unwrap(socket);
+
+    if (setsockopt(raw_sock, SOL_SOCKET, SO_RCVBUF, (const void *) &size,
+                   sizeof(size)) == -1) {
+        net_perror("setsockopt(SO_RCVBUF)");
+        return false;
+    }
+
+    return true;
+}
+
+bool
+net_set_send_buffer_size(sc_socket socket, int size) {
+    sc_raw_socket raw_sock = unwrap(socket);
+
+    if (setsockopt(raw_sock, SOL_SOCKET, SO_SNDBUF, (const void *) &size,
+                   sizeof(size)) == -1) {
+        net_perror("setsockopt(SO_SNDBUF)");
+        return false;
+    }
+
+    return true;
+}
+
+bool
+net_socket_tune(sc_socket socket, const struct sc_socket_tune *tune) {
+    bool ok = true;
+
+    if (tune->recv_buffer_size) {
+        ok = net_set_recv_buffer_size(socket, tune->recv_buffer_size) && ok;
+    }
+    if (tune->send_buffer_size) {
+        ok = net_set_send_buffer_size(socket, tune->send_buffer_size) && ok;
+    }
+    if (tune->tcp_nodelay) {
+        ok = net_set_tcp_nodelay(socket, true) && ok;
+    }
+    if (tune->busy_poll_us) {
+#ifdef SO_BUSY_POLL
+        sc_raw_socket raw_sock = unwrap(socket);
+        int value = tune->busy_poll_us;
+        if (setsockopt(raw_sock, SOL_SOCKET, SO_BUSY_POLL,
+                       (const void *) &value, sizeof(value)) == -1) {
+            net_perror("setsockopt(SO_BUSY_POLL)");
+            ok = false;
+        }
+#else
+        LOGW("SO_BUSY_POLL is not supported on this platform");
+        ok = false;
+#endif
+    }
+
+    return ok;
+}
+
+bool
+net_poll_recv(const sc_socket *sockets, unsigned count, bool *ready) {
+    assert(count);
+#define SC_POLL_MAX_FDS 8
+    assert(count <= SC_POLL_MAX_FDS);
+    struct pollfd fds[SC_POLL_MAX_FDS];
+    for (unsigned i = 0; i < count; ++i) {
+        fds[i].fd = unwrap(sockets[i]);
+        fds[i].events = POLLIN;
+        fds[i].revents = 0;
+    }
+
+#ifdef __WINDOWS__
+    int r = WSAPoll(fds, count, -1);
+#else
+    int r = poll(fds, count, -1);
+#endif
+    if (r <= 0) {
+        net_perror("poll");
+        return false;
+    }
+
+    for (unsigned i = 0; i < count; ++i) {
+        // report hangup/error as readable so that the caller detects the end
+        // of stream from recv()
+        ready[i] = fds[i].revents & (POLLIN | POLLHUP | POLLERR);
+    }
+    return true;
+#undef SC_POLL_MAX_FDS
+}
+
 bool
 net_interrupt(sc_socket socket) {
     assert(socket != SC_SOCKET_NONE);
@@ -272,6 +383,12 @@ net_close(sc_socket socket) {
     if (!atomic_flag_test_and_set(&socket->closed)) {
         ret = !closesocket(raw_sock);
     }
+    if (socket->recv_event != WSA_INVALID_EVENT) {
+        WSACloseEvent(socket->recv_event);
+    }
+    if (socket->send_event != WSA_INVALID_EVENT) {
+        WSACloseEvent(socket->send_event);
+    }
     free(socket);
     return ret;
 #else
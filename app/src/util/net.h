@@ -15,6 +15,10 @@
   typedef struct sc_socket_windows {
       SOCKET socket;
       atomic_flag closed;
+      // events for overlapped I/O (lazily created, one per direction, see
+      // sys/win/net.c)
+      WSAEVENT recv_event;
+      WSAEVENT send_event;
   } *sc_socket;
 
 #else // not __WINDOWS__
@@ -58,6 +62,41 @@ net_send(sc_socket socket, const void *buf, size_t len);
 ssize_t
 net_send_all(sc_socket socket, const void *buf, size_t len);
 
+// Disable (or re-enable) Nagle's algorithm, so that small writes are sent
+// immediately instead of being delayed to coalesce with further data.
+bool
+net_set_tcp_nodelay(sc_socket socket, bool tcp_nodelay);
+
+// Request a kernel receive buffer of `size` bytes (best-effort, the kernel
+// may clamp the value).
+bool
+net_set_recv_buffer_size(sc_socket socket, int size);
+
+// Request a kernel send buffer of `size` bytes (best-effort, the kernel may
+// clamp the value).
+bool
+net_set_send_buffer_size(sc_socket socket, int size);
+
+// Socket tuning parameters; zero values leave the system defaults
+struct sc_socket_tune {
+    int recv_buffer_size; // SO_RCVBUF, in bytes
+    int send_buffer_size; // SO_SNDBUF, in bytes
+    bool tcp_nodelay; // disable Nagle's algorithm
+    int busy_poll_us; // SO_BUSY_POLL, in microseconds (Linux only)
+};
+
+// Apply tuning parameters to a socket
+//
+// Every parameter is applied best-effort; return false if any of them could
+// not be applied.
+bool
+net_socket_tune(sc_socket socket, const struct sc_socket_tune *tune);
+
+// Block until at least one of the sockets is readable (or closed), and set
+// ready[i] accordingly. Return false on error.
+bool
+net_poll_recv(const sc_socket *sockets, unsigned count, bool *ready);
+
 // Shutdown the socket (or close on Windows) so that any blocking send() or
 // recv() are interrupted.
 bool
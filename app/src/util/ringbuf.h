@@ -0,0 +1,98 @@
+// generic lock-free single-producer single-consumer ring buffer
+#ifndef SC_RINGBUF_H
+#define SC_RINGBUF_H
+
+#include "common.h"
+
+#include <assert.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// To define a ring buffer type of 64 ints (the capacity must be a power of
+// two, so that the free-running indices wrap correctly):
+//     struct ringbuf_int SC_RINGBUF(int, 64);
+//
+// Items are stored by value in a preallocated array, so pushing performs no
+// allocation (contrary to SC_QUEUE, which requires one node per item).
+//
+// One thread may push and another thread may take concurrently without any
+// lock: the indices are accessed with explicit memory orderings, and each one
+// is written by a single side (head by the producer, tail by the consumer).
+// They are placed on separate cache lines to avoid false sharing between the
+// two threads.
+//
+// sc_ringbuf_is_full() is only meaningful on the producer side, and
+// sc_ringbuf_is_empty() on the consumer side (the other side may concurrently
+// change the result, but only in the direction making the operation succeed).
+
+// upper bound of the cache line size on current hardware
+#define SC_RINGBUF_CACHELINE 64
+
+#define SC_RINGBUF(TYPE, CAP) { \
+    alignas(SC_RINGBUF_CACHELINE) atomic_size_t head; \
+    alignas(SC_RINGBUF_CACHELINE) atomic_size_t tail; \
+    alignas(SC_RINGBUF_CACHELINE) TYPE data[CAP]; \
+}
+
+#define sc_ringbuf_cap_(PRB) \
+    (sizeof((PRB)->data) / sizeof(*(PRB)->data))
+
+#define sc_ringbuf_init(PRB) \
+    (void) ({ \
+        static_assert(!(sc_ringbuf_cap_(PRB) & (sc_ringbuf_cap_(PRB) - 1)), \
+                      "capacity must be a power of two"); \
+        atomic_init(&(PRB)->head, 0); \
+        atomic_init(&(PRB)->tail, 0); \
+    })
+
+#define sc_ringbuf_is_empty(PRB) \
+    (atomic_load_explicit(&(PRB)->head, memory_order_acquire) \
+        == atomic_load_explicit(&(PRB)->tail, memory_order_relaxed))
+
+#define sc_ringbuf_is_full(PRB) \
+    (atomic_load_explicit(&(PRB)->head, memory_order_relaxed) \
+        - atomic_load_explicit(&(PRB)->tail, memory_order_acquire) \
+        == sc_ringbuf_cap_(PRB))
+
+// Approximate number of queued items. Both indices are read with relaxed
+// ordering, so the result may be stale when the other side runs concurrently;
+// suitable for statistics, not for synchronization.
+#define sc_ringbuf_count(PRB) \
+    (atomic_load_explicit(&(PRB)->head, memory_order_relaxed) \
+        - atomic_load_explicit(&(PRB)->tail, memory_order_relaxed))
+
+// push a new item (producer side only)
+#define sc_ringbuf_push(PRB, ITEM) \
+    ({ \
+        size_t head_ = \
+            atomic_load_explicit(&(PRB)->head, memory_order_relaxed); \
+        size_t tail_ = \
+            atomic_load_explicit(&(PRB)->tail, memory_order_acquire); \
+        bool ok_ = head_ - tail_ < sc_ringbuf_cap_(PRB); \
+        if (ok_) { \
+            (PRB)->data[head_ & (sc_ringbuf_cap_(PRB) - 1)] = (ITEM); \
+            atomic_store_explicit(&(PRB)->head, head_ + 1, \
+                                  memory_order_release); \
+        } \
+        ok_; \
+    })
+
+// take the next item and remove it from the ring (consumer side only)
+#define sc_ringbuf_take(PRB, PITEM) \
+    ({ \
+        size_t tail_ = \
+            atomic_load_explicit(&(PRB)->tail, memory_order_relaxed); \
+        size_t head_ = \
+            atomic_load_explicit(&(PRB)->head, memory_order_acquire); \
+        bool ok_ = tail_ != head_; \
+        if (ok_) { \
+            *(PITEM) = (PRB)->data[tail_ & (sc_ringbuf_cap_(PRB) - 1)]; \
+            atomic_store_explicit(&(PRB)->tail, tail_ + 1, \
+                                  memory_order_release); \
+        } \
+        ok_; \
+    })
+
+#endif
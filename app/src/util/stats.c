@@ -0,0 +1,137 @@
+#include "stats.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdio.h>
+
+#include "log.h"
+#include "thread.h"
+
+static atomic_uint_least64_t values[SC_STAT_COUNT_];
+// static storage: all values default to 0
+
+static const char *const names[SC_STAT_COUNT_] = {
+    [SC_STAT_FRAMES_DECODED] = "decoded",
+    [SC_STAT_FRAMES_RENDERED] = "rendered",
+    [SC_STAT_FRAMES_SKIPPED] = "skipped",
+    [SC_STAT_FRAMES_DROPPED] = "dropped",
+    [SC_STAT_PACKETS_RECORDED] = "recorded",
+    [SC_STAT_BUFFERING_QUEUE] = "buffering_queue",
+    [SC_STAT_RECORDER_QUEUE] = "recorder_queue",
+};
+
+static struct {
+    sc_thread thread;
+    sc_mutex mutex;
+    sc_cond cond;
+    sc_tick interval;
+    bool stopped;
+    bool started;
+} logger;
+
+void
+sc_stats_add(enum sc_stat_id id, uint64_t delta) {
+    assert(id < SC_STAT_COUNT_);
+    atomic_fetch_add_explicit(&values[id], delta, memory_order_relaxed);
+}
+
+void
+sc_stats_set(enum sc_stat_id id, uint64_t value) {
+    assert(id < SC_STAT_COUNT_);
+    atomic_store_explicit(&values[id], value, memory_order_relaxed);
+}
+
+uint64_t
+sc_stats_get(enum sc_stat_id id) {
+    assert(id < SC_STAT_COUNT_);
+    return atomic_load_explicit(&values[id], memory_order_relaxed);
+}
+
+void
+sc_stats_log(void) {
+    char buf[256];
+    size_t len = 0;
+    for (size_t i = 0; i < SC_STAT_COUNT_; ++i) {
+        int w = snprintf(buf + len, sizeof(buf) - len, "%s%s=%" PRIu64_,
+                         i ? " " : "", names[i],
+                         sc_stats_get((enum sc_stat_id) i));
+        assert(w >= 0 && (size_t) w < sizeof(buf) - len);
+        len += w;
+    }
+    LOGI("Stats: %s", buf);
+}
+
+static int
+run_stats_logger(void *data) {
+    (void) data;
+
+    sc_mutex_lock(&logger.mutex);
+    sc_tick deadline = sc_tick_now() + logger.interval;
+    while (!logger.stopped) {
+        bool timedout =
+            !sc_cond_timedwait(&logger.cond, &logger.mutex, deadline);
+        if (timedout) {
+            sc_stats_log();
+            deadline += logger.interval;
+        }
+    }
+    sc_mutex_unlock(&logger.mutex);
+
+    return 0;
+}
+
+bool
+sc_stats_logger_start(sc_tick interval) {
+    assert(!logger.started);
+    assert(interval > 0);
+
+    bool ok = sc_mutex_init(&logger.mutex);
+    if (!ok) {
+        return false;
+    }
+
+    ok = sc_cond_init(&logger.cond);
+    if (!ok) {
+        goto error_destroy_mutex;
+    }
+
+    logger.interval = interval;
+    logger.stopped = false;
+
+    ok = sc_thread_create(&logger.thread, run_stats_logger, "stats", NULL);
+    if (!ok) {
+        LOGE("Could not start stats logger thread");
+        goto error_destroy_cond;
+    }
+
+    logger.started = true;
+    return true;
+
+error_destroy_cond:
+    sc_cond_destroy(&logger.cond);
+error_destroy_mutex:
+    sc_mutex_destroy(&logger.mutex);
+    return false;
+}
+
+void
+sc_stats_logger_stop(void) {
+    if (!logger.started) {
+        return;
+    }
+
+    sc_mutex_lock(&logger.mutex);
+    logger.stopped = true;
+    sc_cond_signal(&logger.cond);
+    sc_mutex_unlock(&logger.mutex);
+
+    sc_thread_join(&logger.thread, NULL);
+
+    sc_cond_destroy(&logger.cond);
+    sc_mutex_destroy(&logger.mutex);
+    logger.started = false;
+
+    // log the final values on exit
+    sc_stats_log();
+}
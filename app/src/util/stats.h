@@ -0,0 +1,62 @@
+#ifndef SC_STATS_H
+#define SC_STATS_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "util/tick.h"
+
+/**
+ * Global pipeline statistics
+ *
+ * Each pipeline component reports into a fixed registry of counters (events
+ * accumulated since startup) and gauges (last observed value, typically a
+ * queue depth). Updates are single relaxed atomic operations, cheap enough to
+ * be left enabled unconditionally on the hot paths.
+ *
+ * When requested (--stats-interval), a dedicated thread periodically logs a
+ * single line with all the values, so that production incidents show where
+ * frames are lost and where latency accumulates.
+ */
+
+enum sc_stat_id {
+    // counters
+    SC_STAT_FRAMES_DECODED,  // frames produced by the decoder
+    SC_STAT_FRAMES_RENDERED, // frames presented on the display
+    SC_STAT_FRAMES_SKIPPED,  // frames replaced before they could be rendered
+    SC_STAT_FRAMES_DROPPED,  // frames dropped on buffering queue overflow
+    SC_STAT_PACKETS_RECORDED, // packets written by the recorder
+
+    // gauges
+    SC_STAT_BUFFERING_QUEUE, // buffering queue depth
+    SC_STAT_RECORDER_QUEUE,  // recorder queue depth
+
+    SC_STAT_COUNT_,
+};
+
+// increment a counter (may be called from any thread)
+void
+sc_stats_add(enum sc_stat_id id, uint64_t delta);
+
+// report the current value of a gauge (may be called from any thread)
+void
+sc_stats_set(enum sc_stat_id id, uint64_t value);
+
+uint64_t
+sc_stats_get(enum sc_stat_id id);
+
+// log a single line with all the current values
+void
+sc_stats_log(void);
+
+// start the periodic logger thread
+bool
+sc_stats_logger_start(sc_tick interval);
+
+// stop and join the periodic logger thread (no-op if it was not started)
+void
+sc_stats_logger_stop(void);
+
+#endif
@@ -166,7 +166,9 @@ sc_str_list_contains(const char *list, char sep, const char *s) {
 
 size_t
 sc_str_utf8_truncation_index(const char *utf8, size_t max_len) {
-    size_t len = strlen(utf8);
+    // bound the scan to max_len bytes: the tail beyond the truncation point
+    // never needs to be traversed (and the libc scan is vectorized)
+    size_t len = strnlen(utf8, max_len + 1);
     if (len <= max_len) {
         return len;
     }
@@ -331,6 +333,17 @@ sc_str_index_of_column(const char *s, unsigned col, const char *seps) {
     return col == colidx ? (ssize_t) idx : -1;
 }
 
+uint64_t
+sc_str_hash(const char *s) {
+    // FNV-1a
+    uint64_t hash = 0xcbf29ce484222325;
+    while (*s) {
+        hash ^= (uint8_t) *s++;
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
 size_t
 sc_str_remove_trailing_cr(char *s, size_t len) {
     while (len) {
@@ -5,6 +5,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 /**
  * Like strncpy(), except:
@@ -103,6 +104,15 @@ sc_str_from_wchars(const wchar_t *s);
 char *
 sc_str_wrap_lines(const char *input, unsigned columns, unsigned indent);
 
+/**
+ * Return a 64-bit FNV-1a hash of the string
+ *
+ * Used to detect identical content without keeping (or comparing) the whole
+ * text, e.g. to avoid retransmitting an unchanged clipboard.
+ */
+uint64_t
+sc_str_hash(const char *s);
+
 /**
  * Truncate the data after any of the characters from `endchars`
  *
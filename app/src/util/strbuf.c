@@ -78,6 +78,35 @@ sc_strbuf_append_n(struct sc_strbuf *buf, const char c, size_t n) {
     return true;
 }
 
+bool
+sc_strbuf_vappendf(struct sc_strbuf *buf, const char *fmt, va_list va) {
+    va_list va2;
+    va_copy(va2, va);
+    int len = vsnprintf(NULL, 0, fmt, va2);
+    va_end(va2);
+    if (len < 0) {
+        return false;
+    }
+
+    if (!sc_strbuf_reserve(buf, len)) {
+        return false;
+    }
+
+    vsnprintf(&buf->s[buf->len], len + 1, fmt, va);
+    buf->len += len;
+
+    return true;
+}
+
+bool
+sc_strbuf_appendf(struct sc_strbuf *buf, const char *fmt, ...) {
+    va_list va;
+    va_start(va, fmt);
+    bool ok = sc_strbuf_vappendf(buf, fmt, va);
+    va_end(va);
+    return ok;
+}
+
 void
 sc_strbuf_shrink(struct sc_strbuf *buf) {
     assert(buf->len <= buf->cap);
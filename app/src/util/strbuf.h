@@ -3,6 +3,7 @@
 
 #include "common.h"
 
+#include <stdarg.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <string.h>
@@ -62,6 +63,20 @@ sc_strbuf_append_str(struct sc_strbuf *buf, const char *s) {
 #define sc_strbuf_append_staticstr(BUF, S) \
     sc_strbuf_append(BUF, S, sizeof(S) - 1)
 
+/**
+ * Append a formatted string
+ *
+ * The string is formatted (as if by printf()) directly into the buffer.
+ */
+bool
+sc_strbuf_appendf(struct sc_strbuf *buf, const char *fmt, ...);
+
+/**
+ * Append a formatted string (va_list version)
+ */
+bool
+sc_strbuf_vappendf(struct sc_strbuf *buf, const char *fmt, va_list va);
+
 /**
  * Shrink the buffer capacity to its current length
  *
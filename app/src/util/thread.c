@@ -1,10 +1,80 @@
 #include "thread.h"
 
 #include <assert.h>
+#include <SDL2/SDL_cpuinfo.h>
 #include <SDL2/SDL_thread.h>
+#ifdef _WIN32
+# include <windows.h>
+# include <timeapi.h>
+#elif defined(__linux__)
+# include <sched.h>
+#endif
 
 #include "log.h"
 
+static struct {
+    enum sc_thread_priority priority;
+    uint64_t cpu_affinity_mask;
+} sc_thread_roles[SC_THREAD_ROLE_COUNT];
+// static storage: all roles default to {SC_THREAD_PRIORITY_NORMAL, 0}
+
+void
+sc_thread_role_configure(enum sc_thread_role role,
+                         enum sc_thread_priority priority,
+                         uint64_t cpu_affinity_mask) {
+    assert(role < SC_THREAD_ROLE_COUNT);
+    sc_thread_roles[role].priority = priority;
+    sc_thread_roles[role].cpu_affinity_mask = cpu_affinity_mask;
+}
+
+static bool
+sc_thread_set_affinity(uint64_t mask) {
+#ifdef _WIN32
+    return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR) mask) != 0;
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (unsigned cpu = 0; cpu < 64; ++cpu) {
+        if (mask & (UINT64_C(1) << cpu)) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    // pid 0 targets the current thread
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    (void) mask;
+    // not supported on this platform
+    return false;
+#endif
+}
+
+void
+sc_thread_apply_role(enum sc_thread_role role) {
+    assert(role < SC_THREAD_ROLE_COUNT);
+
+    enum sc_thread_priority priority = sc_thread_roles[role].priority;
+    if (priority != SC_THREAD_PRIORITY_NORMAL) {
+        SDL_ThreadPriority sdl_priority =
+            priority == SC_THREAD_PRIORITY_HIGH ? SDL_THREAD_PRIORITY_HIGH
+                                                : SDL_THREAD_PRIORITY_LOW;
+        if (SDL_SetThreadPriority(sdl_priority)) {
+            // raising the priority may require privileges
+            LOGW("Could not set thread priority: %s", SDL_GetError());
+        }
+    }
+
+    uint64_t mask = sc_thread_roles[role].cpu_affinity_mask;
+    if (mask && !sc_thread_set_affinity(mask)) {
+        LOGW("Could not set thread CPU affinity");
+    }
+}
+
+unsigned
+sc_cpu_count(void) {
+    int count = SDL_GetCPUCount();
+    return count > 0 ? (unsigned) count : 1;
+}
+
 bool
 sc_thread_create(sc_thread *thread, sc_thread_fn fn, const char *name,
                  void *userdata) {
@@ -147,6 +217,24 @@ sc_cond_timedwait(sc_cond *cond, sc_mutex *mutex, sc_tick deadline) {
     return r == 0;
 }
 
+void
+sc_timedwait_precision_acquire(void) {
+#ifdef _WIN32
+    // timeBeginPeriod() requests are reference-counted by the system, and
+    // the resolution is restored once all of them are released
+    if (timeBeginPeriod(1) != TIMERR_NOERROR) {
+        LOGW("Could not increase the system timer resolution");
+    }
+#endif
+}
+
+void
+sc_timedwait_precision_release(void) {
+#ifdef _WIN32
+    timeEndPeriod(1);
+#endif
+}
+
 void
 sc_cond_signal(sc_cond *cond) {
     int r = SDL_CondSignal(cond->cond);
@@ -5,6 +5,7 @@
 
 #include <stdatomic.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "tick.h"
 
@@ -32,6 +33,38 @@ typedef struct sc_cond {
     SDL_cond *cond;
 } sc_cond;
 
+enum sc_thread_priority {
+    SC_THREAD_PRIORITY_LOW,
+    SC_THREAD_PRIORITY_NORMAL,
+    SC_THREAD_PRIORITY_HIGH,
+};
+
+// Roles of the threads of a session, to configure scheduling globally
+enum sc_thread_role {
+    SC_THREAD_ROLE_RENDER,  // main thread: event loop and rendering
+    SC_THREAD_ROLE_DECODE,  // stream thread: demuxing and decoding
+    SC_THREAD_ROLE_IO,      // recorder, screenshots, file transfers
+    SC_THREAD_ROLE_CONTROL, // controller and receiver
+    SC_THREAD_ROLE_COUNT,
+};
+
+// Configure the priority and CPU affinity applied to the threads of `role`
+// (to be called before the threads start; a mask of 0 means no affinity
+// constraint)
+void
+sc_thread_role_configure(enum sc_thread_role role,
+                         enum sc_thread_priority priority,
+                         uint64_t cpu_affinity_mask);
+
+// Apply the configured scheduling parameters to the current thread
+// (best-effort: failures are logged, not fatal)
+void
+sc_thread_apply_role(enum sc_thread_role role);
+
+// Return the number of logical CPU cores (at least 1)
+unsigned
+sc_cpu_count(void);
+
 bool
 sc_thread_create(sc_thread *thread, sc_thread_fn fn, const char *name,
                  void *userdata);
@@ -75,6 +108,17 @@ sc_cond_wait(sc_cond *cond, sc_mutex *mutex);
 bool
 sc_cond_timedwait(sc_cond *cond, sc_mutex *mutex, sc_tick deadline);
 
+// Request a high system timer resolution while a thread performs
+// deadline-sensitive timed waits (on Windows, the default timer granularity
+// is ~15ms, so sc_cond_timedwait() may overshoot its deadline by that much).
+// No-op on other platforms. May be nested; each acquire must be paired with
+// a release.
+void
+sc_timedwait_precision_acquire(void);
+
+void
+sc_timedwait_precision_release(void);
+
 void
 sc_cond_signal(sc_cond *cond);
 
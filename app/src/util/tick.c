@@ -14,3 +14,14 @@ sc_tick_now(void) {
     //  - in practice, we don't need more precision for now.
     return (sc_tick) SDL_GetTicks() * 1000;
 }
+
+void
+sc_tick_sleep(sc_tick duration) {
+    if (duration <= 0) {
+        return;
+    }
+
+    // round up, to avoid waking up before the requested duration
+    uint32_t ms = SC_TICK_TO_MS(duration + 999);
+    SDL_Delay(ms);
+}
@@ -20,4 +20,8 @@ typedef int64_t sc_tick;
 sc_tick
 sc_tick_now(void);
 
+// sleep for the given duration (rounded up to the millisecond)
+void
+sc_tick_sleep(sc_tick duration);
+
 #endif
@@ -0,0 +1,82 @@
+#include "trace.h"
+
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <SDL2/SDL_thread.h>
+
+#include "log.h"
+#include "thread.h"
+
+static struct {
+    atomic_bool enabled;
+    FILE *file;
+    sc_mutex mutex;
+} sc_trace;
+// static storage: enabled defaults to false
+
+bool
+sc_trace_init(const char *filename) {
+    FILE *file = fopen(filename, "w");
+    if (!file) {
+        LOGE("Could not open trace file: %s", filename);
+        return false;
+    }
+
+    bool ok = sc_mutex_init(&sc_trace.mutex);
+    if (!ok) {
+        fclose(file);
+        return false;
+    }
+
+    // chrome://tracing accepts an unterminated JSON array, so events may
+    // simply be appended
+    fputs("[\n", file);
+
+    sc_trace.file = file;
+    atomic_store(&sc_trace.enabled, true);
+
+    LOGI("Tracing to %s", filename);
+    return true;
+}
+
+void
+sc_trace_close(void) {
+    if (!atomic_exchange(&sc_trace.enabled, false)) {
+        return;
+    }
+
+    fputs("]\n", sc_trace.file);
+    fclose(sc_trace.file);
+    sc_trace.file = NULL;
+    sc_mutex_destroy(&sc_trace.mutex);
+}
+
+sc_tick
+sc_trace_begin(void) {
+    if (!atomic_load_explicit(&sc_trace.enabled, memory_order_relaxed)) {
+        return 0;
+    }
+    return sc_tick_now();
+}
+
+void
+sc_trace_end(const char *name, sc_tick begin) {
+    if (!begin) {
+        return;
+    }
+
+    sc_tick now = sc_tick_now();
+
+    if (!atomic_load_explicit(&sc_trace.enabled, memory_order_relaxed)) {
+        return;
+    }
+
+    // a tick is a microsecond, the unit expected by the trace format
+    sc_mutex_lock(&sc_trace.mutex);
+    fprintf(sc_trace.file,
+            "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%lu,"
+            "\"ts\":%" PRItick ",\"dur\":%" PRItick "},\n",
+            name, (unsigned long) SDL_ThreadID(), begin, now - begin);
+    sc_mutex_unlock(&sc_trace.mutex);
+}
@@ -0,0 +1,43 @@
+#ifndef SC_TRACE_H
+#define SC_TRACE_H
+
+#include "common.h"
+
+#include <stdbool.h>
+
+#include "util/tick.h"
+
+/**
+ * Scoped trace instrumentation
+ *
+ * When enabled (--trace-file), instrumented scopes from all threads are
+ * written as "complete" events in the Chrome trace event format, so that the
+ * resulting file can be loaded in chrome://tracing (or Perfetto) to
+ * visualize the timeline of a single slow frame across the whole pipeline.
+ *
+ * Usage:
+ *
+ *     sc_tick trace = sc_trace_begin();
+ *     // ... instrumented scope ...
+ *     sc_trace_end("name", trace);
+ *
+ * When tracing is disabled, the overhead is a single relaxed atomic load per
+ * scope.
+ */
+
+bool
+sc_trace_init(const char *filename);
+
+// must be called after the instrumented threads terminated
+void
+sc_trace_close(void);
+
+// return the scope start date, or 0 if tracing is disabled
+sc_tick
+sc_trace_begin(void);
+
+// write the scope event ending now (no-op if `begin` is 0)
+void
+sc_trace_end(const char *name, sc_tick begin);
+
+#endif
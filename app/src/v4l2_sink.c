@@ -1,107 +1,123 @@
 #include "v4l2_sink.h"
 
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <linux/videodev2.h>
 
 #include "util/log.h"
-#include "util/str.h"
 
 /** Downcast frame_sink to sc_v4l2_sink */
 #define DOWNCAST(SINK) container_of(SINK, struct sc_v4l2_sink, frame_sink)
 
-static const AVRational SCRCPY_TIME_BASE = {1, 1000000}; // timestamps in us
-
-static const AVOutputFormat *
-find_muxer(const char *name) {
-#ifdef SCRCPY_LAVF_HAS_NEW_MUXER_ITERATOR_API
-    void *opaque = NULL;
-#endif
-    const AVOutputFormat *oformat = NULL;
-    do {
-#ifdef SCRCPY_LAVF_HAS_NEW_MUXER_ITERATOR_API
-        oformat = av_muxer_iterate(&opaque);
-#else
-        oformat = av_oformat_next(oformat);
-#endif
-        // until null or containing the requested name
-    } while (oformat && !sc_str_list_contains(oformat->name, ',', name));
-    return oformat;
-}
-
-static bool
-write_header(struct sc_v4l2_sink *vs, const AVPacket *packet) {
-    AVStream *ostream = vs->format_ctx->streams[0];
-
-    uint8_t *extradata = av_malloc(packet->size * sizeof(uint8_t));
-    if (!extradata) {
-        LOG_OOM();
-        return false;
+// copy one plane, collapsing to a single memcpy when the strides match
+static uint8_t *
+copy_plane(uint8_t *dst, size_t dst_stride, const uint8_t *src,
+           size_t src_stride, size_t width, size_t height) {
+    if (dst_stride == width && src_stride == width) {
+        memcpy(dst, src, width * height);
+        return dst + width * height;
     }
 
-    // copy the first packet to the extra data
-    memcpy(extradata, packet->data, packet->size);
-
-    ostream->codecpar->extradata = extradata;
-    ostream->codecpar->extradata_size = packet->size;
-
-    int ret = avformat_write_header(vs->format_ctx, NULL);
-    if (ret < 0) {
-        LOGE("Failed to write header to %s", vs->device_name);
-        return false;
+    for (size_t y = 0; y < height; ++y) {
+        memcpy(dst, src, width);
+        dst += dst_stride;
+        src += src_stride;
     }
+    return dst;
+}
 
-    return true;
+// pack the decoded YUV420P planes at the stride selected by the driver
+static void
+pack_frame(struct sc_v4l2_sink *vs, const AVFrame *frame, uint8_t *dst) {
+    size_t width = vs->frame_size.width;
+    size_t height = vs->frame_size.height;
+    size_t stride = vs->bytesperline;
+
+    dst = copy_plane(dst, stride, frame->data[0], frame->linesize[0],
+                     width, height);
+    dst = copy_plane(dst, stride / 2, frame->data[1], frame->linesize[1],
+                     (width + 1) / 2, (height + 1) / 2);
+    copy_plane(dst, stride / 2, frame->data[2], frame->linesize[2],
+               (width + 1) / 2, (height + 1) / 2);
 }
 
+// the device (or its consumer) is stalled, skip the frame: a fresher one
+// will be delivered as soon as the device accepts it again
 static void
-rescale_packet(struct sc_v4l2_sink *vs, AVPacket *packet) {
-    AVStream *ostream = vs->format_ctx->streams[0];
-    av_packet_rescale_ts(packet, SCRCPY_TIME_BASE, ostream->time_base);
+drop_frame(struct sc_v4l2_sink *vs) {
+    if (!vs->dropped) {
+        LOGW("v4l2 consumer is too slow, dropping frames");
+    }
+    ++vs->dropped;
 }
 
 static bool
-write_packet(struct sc_v4l2_sink *vs, AVPacket *packet) {
-    if (!vs->header_written) {
-        bool ok = write_header(vs, packet);
-        if (!ok) {
+send_frame(struct sc_v4l2_sink *vs, const AVFrame *frame) {
+    if (!vs->buffer_count) {
+        // fallback path: pack into the staging buffer and write()
+        pack_frame(vs, frame, vs->staging);
+        ssize_t w = write(vs->fd, vs->staging, vs->sizeimage);
+        if (w != (ssize_t) vs->sizeimage) {
+            if (w == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                drop_frame(vs);
+                return true;
+            }
+            LOGE("Could not write frame to %s", vs->device_name);
             return false;
         }
-        vs->header_written = true;
         return true;
     }
 
-    rescale_packet(vs, packet);
-
-    bool ok = av_write_frame(vs->format_ctx, packet) >= 0;
-
-    // Failing to write the last frame is not very serious, no future frame may
-    // depend on it, so the resulting file will still be valid
-    (void) ok;
-
-    return true;
-}
+    struct v4l2_buffer buf = {0};
+    buf.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+    buf.memory = V4L2_MEMORY_MMAP;
+
+    unsigned index;
+    if (vs->queued_count == vs->buffer_count) {
+        // all buffers are queued, reclaim one
+        if (ioctl(vs->fd, VIDIOC_DQBUF, &buf) == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                drop_frame(vs);
+                return true;
+            }
+            LOGE("Could not dequeue v4l2 buffer");
+            return false;
+        }
+        index = buf.index;
+        --vs->queued_count;
+    } else {
+        index = vs->queued_count;
+    }
 
-static bool
-encode_and_write_frame(struct sc_v4l2_sink *vs, const AVFrame *frame) {
-    int ret = avcodec_send_frame(vs->encoder_ctx, frame);
-    if (ret < 0 && ret != AVERROR(EAGAIN)) {
-        LOGE("Could not send v4l2 video frame: %d", ret);
+    pack_frame(vs, frame, vs->buffers[index].data);
+
+    memset(&buf, 0, sizeof(buf));
+    buf.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+    buf.memory = V4L2_MEMORY_MMAP;
+    buf.index = index;
+    buf.bytesused = vs->sizeimage;
+    buf.field = V4L2_FIELD_NONE;
+    // expose the capture timestamp to the consumers of the loopback device
+    buf.timestamp.tv_sec = frame->pts / 1000000;
+    buf.timestamp.tv_usec = frame->pts % 1000000;
+    if (ioctl(vs->fd, VIDIOC_QBUF, &buf) == -1) {
+        LOGE("Could not queue v4l2 buffer");
         return false;
     }
+    ++vs->queued_count;
 
-    AVPacket *packet = vs->packet;
-    ret = avcodec_receive_packet(vs->encoder_ctx, packet);
-    if (ret == 0) {
-        // A packet was received
-
-        bool ok = write_packet(vs, packet);
-        av_packet_unref(packet);
-        if (!ok) {
-            LOGW("Could not send packet to v4l2 sink");
+    if (!vs->streaming) {
+        enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+        if (ioctl(vs->fd, VIDIOC_STREAMON, &type) == -1) {
+            LOGE("Could not start v4l2 streaming");
             return false;
         }
-    } else if (ret != AVERROR(EAGAIN)) {
-        LOGE("Could not receive v4l2 video packet: %d", ret);
-        return false;
+        vs->streaming = true;
     }
 
     return true;
@@ -126,9 +142,23 @@ run_v4l2_sink(void *data) {
         vs->has_frame = false;
         sc_mutex_unlock(&vs->mutex);
 
-        sc_video_buffer_consume(&vs->vb, vs->frame);
+        bool consumed = sc_video_buffer_consume(&vs->vb, vs->frame);
+        // has_frame guarantees that a fresh frame is pending
+        assert(consumed);
+        (void) consumed;
 
-        bool ok = encode_and_write_frame(vs, vs->frame);
+        // Rewrite the PTS to the clock-corrected capture time, expressed in
+        // the system clock, so that consumers can correlate frames to device
+        // time without any additional buffering
+        sc_mutex_lock(&vs->mutex);
+        if (vs->clock.count > 1) {
+            sc_tick pts = SC_TICK_FROM_US(vs->frame->pts);
+            vs->frame->pts =
+                SC_TICK_TO_US(sc_clock_to_system_time(&vs->clock, pts));
+        }
+        sc_mutex_unlock(&vs->mutex);
+
+        bool ok = send_frame(vs, vs->frame);
         av_frame_unref(vs->frame);
         if (!ok) {
             LOGE("Could not send frame to v4l2 sink");
@@ -161,7 +191,8 @@ sc_v4l2_sink_open(struct sc_v4l2_sink *vs) {
         .on_new_frame = sc_video_buffer_on_new_frame,
     };
 
-    bool ok = sc_video_buffer_init(&vs->vb, vs->buffering_time, &cbs, vs);
+    bool ok = sc_video_buffer_init(&vs->vb, vs->buffering_time, false, &cbs,
+                                   vs);
     if (!ok) {
         return false;
     }
@@ -181,119 +212,111 @@ sc_v4l2_sink_open(struct sc_v4l2_sink *vs) {
         goto error_mutex_destroy;
     }
 
-    const AVOutputFormat *format = find_muxer("v4l2");
-    if (!format) {
-        // Alternative name
-        format = find_muxer("video4linux2");
-    }
-    if (!format) {
-        LOGE("Could not find v4l2 muxer");
+    sc_clock_init(&vs->clock);
+
+    // non-blocking, so that a stalled consumer makes the sink drop frames
+    // instead of backpressuring the decoder
+    vs->fd = open(vs->device_name, O_RDWR | O_NONBLOCK);
+    if (vs->fd == -1) {
+        LOGE("Could not open v4l2 device: %s", vs->device_name);
         goto error_cond_destroy;
     }
 
-    const AVCodec *encoder = avcodec_find_encoder(AV_CODEC_ID_RAWVIDEO);
-    if (!encoder) {
-        LOGE("Raw video encoder not found");
-        return false;
+    struct v4l2_format fmt = {0};
+    fmt.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+    fmt.fmt.pix.width = vs->frame_size.width;
+    fmt.fmt.pix.height = vs->frame_size.height;
+    fmt.fmt.pix.pixelformat = V4L2_PIX_FMT_YUV420;
+    fmt.fmt.pix.field = V4L2_FIELD_NONE;
+    if (ioctl(vs->fd, VIDIOC_S_FMT, &fmt) == -1) {
+        LOGE("Could not set format on v4l2 device: %s", vs->device_name);
+        goto error_close_fd;
     }
 
-    vs->format_ctx = avformat_alloc_context();
-    if (!vs->format_ctx) {
-        LOG_OOM();
-        return false;
+    vs->bytesperline = fmt.fmt.pix.bytesperline;
+    if (!vs->bytesperline) {
+        vs->bytesperline = vs->frame_size.width;
     }
-
-    // contrary to the deprecated API (av_oformat_next()), av_muxer_iterate()
-    // returns (on purpose) a pointer-to-const, but AVFormatContext.oformat
-    // still expects a pointer-to-non-const (it has not be updated accordingly)
-    // <https://github.com/FFmpeg/FFmpeg/commit/0694d8702421e7aff1340038559c438b61bb30dd>
-    vs->format_ctx->oformat = (AVOutputFormat *) format;
-#ifdef SCRCPY_LAVF_HAS_AVFORMATCONTEXT_URL
-    vs->format_ctx->url = strdup(vs->device_name);
-    if (!vs->format_ctx->url) {
-        LOG_OOM();
-        goto error_avformat_free_context;
+    vs->sizeimage = fmt.fmt.pix.sizeimage;
+    if (!vs->sizeimage) {
+        vs->sizeimage = vs->bytesperline * vs->frame_size.height * 3 / 2;
     }
-#else
-    strncpy(vs->format_ctx->filename, vs->device_name,
-            sizeof(vs->format_ctx->filename));
-#endif
 
-    AVStream *ostream = avformat_new_stream(vs->format_ctx, encoder);
-    if (!ostream) {
-        LOG_OOM();
-        goto error_avformat_free_context;
-    }
-
-    ostream->codecpar->codec_type = AVMEDIA_TYPE_VIDEO;
-    ostream->codecpar->codec_id = encoder->id;
-    ostream->codecpar->format = AV_PIX_FMT_YUV420P;
-    ostream->codecpar->width = vs->frame_size.width;
-    ostream->codecpar->height = vs->frame_size.height;
-
-    int ret = avio_open(&vs->format_ctx->pb, vs->device_name, AVIO_FLAG_WRITE);
-    if (ret < 0) {
-        LOGE("Failed to open output device: %s", vs->device_name);
-        // ostream will be cleaned up during context cleaning
-        goto error_avformat_free_context;
-    }
-
-    vs->encoder_ctx = avcodec_alloc_context3(encoder);
-    if (!vs->encoder_ctx) {
-        LOG_OOM();
-        goto error_avio_close;
+    vs->buffer_count = 0;
+    vs->queued_count = 0;
+    vs->streaming = false;
+    vs->dropped = 0;
+    vs->staging = NULL;
+
+    // queue mmap()ed kernel buffers, so that frames are packed directly into
+    // shared memory and carry their capture timestamps; fall back to write()
+    // if the device does not support streaming I/O
+    struct v4l2_requestbuffers req = {0};
+    req.count = SC_V4L2_BUFFER_COUNT;
+    req.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+    req.memory = V4L2_MEMORY_MMAP;
+    if (ioctl(vs->fd, VIDIOC_REQBUFS, &req) == 0 && req.count) {
+        unsigned count = req.count;
+        if (count > SC_V4L2_BUFFER_COUNT) {
+            count = SC_V4L2_BUFFER_COUNT;
+        }
+        for (unsigned i = 0; i < count; ++i) {
+            struct v4l2_buffer buf = {0};
+            buf.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+            buf.memory = V4L2_MEMORY_MMAP;
+            buf.index = i;
+            if (ioctl(vs->fd, VIDIOC_QUERYBUF, &buf) == -1) {
+                break;
+            }
+            void *data = mmap(NULL, buf.length, PROT_READ | PROT_WRITE,
+                              MAP_SHARED, vs->fd, buf.m.offset);
+            if (data == MAP_FAILED) {
+                break;
+            }
+            vs->buffers[i].data = data;
+            vs->buffers[i].size = buf.length;
+            ++vs->buffer_count;
+        }
     }
 
-    vs->encoder_ctx->width = vs->frame_size.width;
-    vs->encoder_ctx->height = vs->frame_size.height;
-    vs->encoder_ctx->pix_fmt = AV_PIX_FMT_YUV420P;
-    vs->encoder_ctx->time_base.num = 1;
-    vs->encoder_ctx->time_base.den = 1;
-
-    if (avcodec_open2(vs->encoder_ctx, encoder, NULL) < 0) {
-        LOGE("Could not open codec for v4l2");
-        goto error_avcodec_free_context;
+    if (!vs->buffer_count) {
+        LOGD("v4l2 mmap streaming unavailable, falling back to write()");
+        vs->staging = malloc(vs->sizeimage);
+        if (!vs->staging) {
+            LOG_OOM();
+            goto error_close_fd;
+        }
     }
 
     vs->frame = av_frame_alloc();
     if (!vs->frame) {
         LOG_OOM();
-        goto error_avcodec_close;
-    }
-
-    vs->packet = av_packet_alloc();
-    if (!vs->packet) {
-        LOG_OOM();
-        goto error_av_frame_free;
+        goto error_unmap_buffers;
     }
 
     vs->has_frame = false;
-    vs->header_written = false;
     vs->stopped = false;
 
     LOGD("Starting v4l2 thread");
     ok = sc_thread_create(&vs->thread, run_v4l2_sink, "v4l2", vs);
     if (!ok) {
         LOGC("Could not start v4l2 thread");
-        goto error_av_packet_free;
+        goto error_av_frame_free;
     }
 
     LOGI("v4l2 sink started to device: %s", vs->device_name);
 
     return true;
 
-error_av_packet_free:
-    av_packet_free(&vs->packet);
 error_av_frame_free:
     av_frame_free(&vs->frame);
-error_avcodec_close:
-    avcodec_close(vs->encoder_ctx);
-error_avcodec_free_context:
-    avcodec_free_context(&vs->encoder_ctx);
-error_avio_close:
-    avio_close(vs->format_ctx->pb);
-error_avformat_free_context:
-    avformat_free_context(vs->format_ctx);
+error_unmap_buffers:
+    for (unsigned i = 0; i < vs->buffer_count; ++i) {
+        munmap(vs->buffers[i].data, vs->buffers[i].size);
+    }
+    free(vs->staging);
+error_close_fd:
+    close(vs->fd);
 error_cond_destroy:
     sc_cond_destroy(&vs->cond);
 error_mutex_destroy:
@@ -319,12 +342,20 @@ sc_v4l2_sink_close(struct sc_v4l2_sink *vs) {
     sc_thread_join(&vs->thread, NULL);
     sc_video_buffer_join(&vs->vb);
 
-    av_packet_free(&vs->packet);
+    if (vs->dropped) {
+        LOGW("v4l2: %u frame(s) dropped due to a slow consumer", vs->dropped);
+    }
+
     av_frame_free(&vs->frame);
-    avcodec_close(vs->encoder_ctx);
-    avcodec_free_context(&vs->encoder_ctx);
-    avio_close(vs->format_ctx->pb);
-    avformat_free_context(vs->format_ctx);
+    if (vs->streaming) {
+        enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+        ioctl(vs->fd, VIDIOC_STREAMOFF, &type);
+    }
+    for (unsigned i = 0; i < vs->buffer_count; ++i) {
+        munmap(vs->buffers[i].data, vs->buffers[i].size);
+    }
+    free(vs->staging);
+    close(vs->fd);
     sc_cond_destroy(&vs->cond);
     sc_mutex_destroy(&vs->mutex);
     sc_video_buffer_destroy(&vs->vb);
@@ -350,6 +381,13 @@ sc_v4l2_frame_sink_close(struct sc_frame_sink *sink) {
 static bool
 sc_v4l2_frame_sink_push(struct sc_frame_sink *sink, const AVFrame *frame) {
     struct sc_v4l2_sink *vs = DOWNCAST(sink);
+
+    // The PTS written by the server are expressed in microseconds of device
+    // time, update the clock estimation before the frame is buffered
+    sc_mutex_lock(&vs->mutex);
+    sc_clock_update(&vs->clock, sc_tick_now(), SC_TICK_FROM_US(frame->pts));
+    sc_mutex_unlock(&vs->mutex);
+
     return sc_v4l2_sink_push(vs, frame);
 }
 
@@ -3,33 +3,54 @@
 
 #include "common.h"
 
+#include "clock.h"
 #include "coords.h"
 #include "trait/frame_sink.h"
 #include "video_buffer.h"
 #include "util/tick.h"
 
-#include <libavformat/avformat.h>
+#include <libavutil/frame.h>
+
+// number of mmap()ed kernel buffers requested for queued output
+#define SC_V4L2_BUFFER_COUNT 2
 
 struct sc_v4l2_sink {
     struct sc_frame_sink frame_sink; // frame sink trait
 
     struct sc_video_buffer vb;
-    AVFormatContext *format_ctx;
-    AVCodecContext *encoder_ctx;
 
     char *device_name;
     struct sc_size frame_size;
     sc_tick buffering_time;
 
+    // direct V4L2 output (no rawvideo encoder or avformat muxer round trip)
+    int fd;
+    uint32_t bytesperline; // luma stride selected by the driver
+    size_t sizeimage;
+    struct {
+        void *data;
+        size_t size;
+    } buffers[SC_V4L2_BUFFER_COUNT];
+    unsigned buffer_count; // 0 if the device does not support mmap streaming
+    unsigned queued_count;
+    bool streaming;
+    // frames dropped because the device (or its consumer) was not ready: the
+    // sink is latest-frame-wins, a stalled consumer never blocks the decoder
+    unsigned dropped;
+    // fallback when mmap streaming is unavailable: frames are packed here and
+    // sent with write() (without timestamps)
+    uint8_t *staging;
+
     sc_thread thread;
     sc_mutex mutex;
     sc_cond cond;
+    // estimation of the affine relation between device time and system time,
+    // used to write capture timestamps meaningful to v4l2 consumers
+    struct sc_clock clock;
     bool has_frame;
     bool stopped;
-    bool header_written;
 
     AVFrame *frame;
-    AVPacket *packet;
 };
 
 bool
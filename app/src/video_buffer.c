@@ -7,38 +7,67 @@
 #include <libavformat/avformat.h>
 
 #include "util/log.h"
+#include "util/stats.h"
 
 #define SC_BUFFERING_NDEBUG // comment to debug
 
-static struct sc_video_buffer_frame *
-sc_video_buffer_frame_new(const AVFrame *frame) {
-    struct sc_video_buffer_frame *vb_frame = malloc(sizeof(*vb_frame));
-    if (!vb_frame) {
-        LOG_OOM();
-        return NULL;
+// Bounds of the automatic buffering mode: the buffering time converges
+// toward twice the measured arrival jitter, so that a USB connection keeps
+// near-zero latency while Wi-Fi jitter automatically increases the buffer
+#define SC_BUFFERING_AUTO_MAX SC_TICK_FROM_MS(200)
+
+// expected maximum frame rate, used to size the frame pool from the
+// buffering time
+#define SC_VIDEO_BUFFER_POOL_MAX_FPS 120
+// always pre-allocate a few frames to absorb scheduling hiccups
+#define SC_VIDEO_BUFFER_POOL_MIN_SIZE 4
+
+// Take a pre-allocated frame from the pool (b.mutex must be held); fall back
+// to the allocator when the pool is exhausted (burst above the expected
+// steady-state depth, or buffering time raised at runtime)
+static AVFrame *
+sc_video_buffer_frame_pool_get(struct sc_video_buffer *vb) {
+    if (vb->b.frame_pool_count) {
+        return vb->b.frame_pool[--vb->b.frame_pool_count];
     }
+    return av_frame_alloc();
+}
 
-    vb_frame->frame = av_frame_alloc();
+// Return a frame to the pool (b.mutex must be held)
+static void
+sc_video_buffer_frame_pool_put(struct sc_video_buffer *vb, AVFrame *frame) {
+    av_frame_unref(frame);
+    if (vb->b.frame_pool_count < vb->b.frame_pool_size) {
+        vb->b.frame_pool[vb->b.frame_pool_count++] = frame;
+    } else {
+        av_frame_free(&frame);
+    }
+}
+
+static bool
+sc_video_buffer_frame_init(struct sc_video_buffer *vb,
+                           struct sc_video_buffer_frame *vb_frame,
+                           const AVFrame *frame) {
+    vb_frame->frame = sc_video_buffer_frame_pool_get(vb);
     if (!vb_frame->frame) {
         LOG_OOM();
-        free(vb_frame);
-        return NULL;
+        return false;
     }
 
     if (av_frame_ref(vb_frame->frame, frame)) {
-        av_frame_free(&vb_frame->frame);
-        free(vb_frame);
-        return NULL;
+        sc_video_buffer_frame_pool_put(vb, vb_frame->frame);
+        return false;
     }
 
-    return vb_frame;
+    return true;
 }
 
 static void
-sc_video_buffer_frame_delete(struct sc_video_buffer_frame *vb_frame) {
-    av_frame_unref(vb_frame->frame);
-    av_frame_free(&vb_frame->frame);
-    free(vb_frame);
+sc_video_buffer_frame_destroy(struct sc_video_buffer *vb,
+                              struct sc_video_buffer_frame *vb_frame) {
+    sc_mutex_lock(&vb->b.mutex);
+    sc_video_buffer_frame_pool_put(vb, vb_frame->frame);
+    sc_mutex_unlock(&vb->b.mutex);
 }
 
 static bool
@@ -57,12 +86,16 @@ static int
 run_buffering(void *data) {
     struct sc_video_buffer *vb = data;
 
-    assert(vb->buffering_time > 0);
+    assert(vb->buffering_enabled);
+
+    // the frame release deadlines are well below the default Windows timer
+    // granularity (~15ms)
+    sc_timedwait_precision_acquire();
 
     for (;;) {
         sc_mutex_lock(&vb->b.mutex);
 
-        while (!vb->b.stopped && sc_queue_is_empty(&vb->b.queue)) {
+        while (!vb->b.stopped && sc_ringbuf_is_empty(&vb->b.queue)) {
             sc_cond_wait(&vb->b.queue_cond, &vb->b.mutex);
         }
 
@@ -71,12 +104,25 @@ run_buffering(void *data) {
             goto stopped;
         }
 
-        struct sc_video_buffer_frame *vb_frame;
-        sc_queue_take(&vb->b.queue, next, &vb_frame);
+        struct sc_video_buffer_frame vb_frame;
+        bool non_empty = sc_ringbuf_take(&vb->b.queue, &vb_frame);
+        assert(non_empty);
+        (void) non_empty;
+
+        if (vb->b.auto_buffering) {
+            // converge toward the measured jitter (the target changes
+            // smoothly, a brutal buffering change would be visible as a
+            // pacing jump)
+            sc_tick target = 2 * vb->b.clock.jitter;
+            if (target > SC_BUFFERING_AUTO_MAX) {
+                target = SC_BUFFERING_AUTO_MAX;
+            }
+            vb->buffering_time += (target - vb->buffering_time) / 8;
+        }
 
         sc_tick max_deadline = sc_tick_now() + vb->buffering_time;
         // PTS (written by the server) are expressed in microseconds
-        sc_tick pts = SC_TICK_TO_US(vb_frame->frame->pts);
+        sc_tick pts = SC_TICK_TO_US(vb_frame.frame->pts);
 
         bool timed_out = false;
         while (!vb->b.stopped && !timed_out) {
@@ -85,13 +131,20 @@ run_buffering(void *data) {
             if (deadline > max_deadline) {
                 deadline = max_deadline;
             }
+            if (deadline <= sc_tick_now()) {
+                // already late, deliver immediately without a wait round
+                break;
+            }
 
+            // Wait until the absolute deadline; in the normal case the wait
+            // simply expires (wait_cond is only signaled to interrupt it, on
+            // stop or when the buffering time changes)
             timed_out =
                 !sc_cond_timedwait(&vb->b.wait_cond, &vb->b.mutex, deadline);
         }
 
         if (vb->b.stopped) {
-            sc_video_buffer_frame_delete(vb_frame);
+            sc_video_buffer_frame_pool_put(vb, vb_frame.frame);
             sc_mutex_unlock(&vb->b.mutex);
             goto stopped;
         }
@@ -100,22 +153,25 @@ run_buffering(void *data) {
 
 #ifndef SC_BUFFERING_NDEBUG
         LOGD("Buffering: %" PRItick ";%" PRItick ";%" PRItick,
-             pts, vb_frame->push_date, sc_tick_now());
+             pts, vb_frame.push_date, sc_tick_now());
 #endif
 
-        sc_video_buffer_offer(vb, vb_frame->frame);
+        sc_video_buffer_offer(vb, vb_frame.frame);
 
-        sc_video_buffer_frame_delete(vb_frame);
+        sc_video_buffer_frame_destroy(vb, &vb_frame);
     }
 
 stopped:
     // Flush queue
-    while (!sc_queue_is_empty(&vb->b.queue)) {
-        struct sc_video_buffer_frame *vb_frame;
-        sc_queue_take(&vb->b.queue, next, &vb_frame);
-        sc_video_buffer_frame_delete(vb_frame);
+    {
+        struct sc_video_buffer_frame vb_frame;
+        while (sc_ringbuf_take(&vb->b.queue, &vb_frame)) {
+            sc_video_buffer_frame_destroy(vb, &vb_frame);
+        }
     }
 
+    sc_timedwait_precision_release();
+
     LOGD("Buffering thread ended");
 
     return 0;
@@ -123,6 +179,7 @@ stopped:
 
 bool
 sc_video_buffer_init(struct sc_video_buffer *vb, sc_tick buffering_time,
+                     bool auto_buffering,
                      const struct sc_video_buffer_callbacks *cbs,
                      void *cbs_userdata) {
     bool ok = sc_frame_buffer_init(&vb->fb);
@@ -131,7 +188,7 @@ sc_video_buffer_init(struct sc_video_buffer *vb, sc_tick buffering_time,
     }
 
     assert(buffering_time >= 0);
-    if (buffering_time) {
+    if (buffering_time || auto_buffering) {
         ok = sc_mutex_init(&vb->b.mutex);
         if (!ok) {
             sc_frame_buffer_destroy(&vb->fb);
@@ -154,13 +211,55 @@ sc_video_buffer_init(struct sc_video_buffer *vb, sc_tick buffering_time,
         }
 
         sc_clock_init(&vb->b.clock);
-        sc_queue_init(&vb->b.queue);
+        sc_ringbuf_init(&vb->b.queue);
+
+        // pre-allocate the frames the queue is expected to hold at steady
+        // state, so that the push and buffering threads never touch the
+        // allocator once running (in automatic mode, provision for the
+        // maximum the buffering may grow to)
+        sc_tick pool_time = buffering_time;
+        if (auto_buffering && pool_time < SC_BUFFERING_AUTO_MAX) {
+            pool_time = SC_BUFFERING_AUTO_MAX;
+        }
+        size_t pool_size = pool_time * SC_VIDEO_BUFFER_POOL_MAX_FPS
+                         / SC_TICK_FROM_SEC(1)
+                         + SC_VIDEO_BUFFER_POOL_MIN_SIZE;
+        size_t queue_cap = sc_ringbuf_cap_(&vb->b.queue);
+        if (pool_size > queue_cap) {
+            pool_size = queue_cap;
+        }
+
+        vb->b.frame_pool = malloc(pool_size * sizeof(*vb->b.frame_pool));
+        if (!vb->b.frame_pool) {
+            LOG_OOM();
+            sc_cond_destroy(&vb->b.wait_cond);
+            sc_cond_destroy(&vb->b.queue_cond);
+            sc_mutex_destroy(&vb->b.mutex);
+            sc_frame_buffer_destroy(&vb->fb);
+            return false;
+        }
+        vb->b.frame_pool_size = pool_size;
+
+        vb->b.frame_pool_count = 0;
+        while (vb->b.frame_pool_count < pool_size) {
+            AVFrame *frame = av_frame_alloc();
+            if (!frame) {
+                // not fatal, the pool gets refilled on use
+                LOG_OOM();
+                break;
+            }
+            vb->b.frame_pool[vb->b.frame_pool_count++] = frame;
+        }
     }
 
     assert(cbs);
     assert(cbs->on_new_frame);
 
+    vb->buffering_enabled = buffering_time > 0 || auto_buffering;
     vb->buffering_time = buffering_time;
+    if (vb->buffering_enabled) {
+        vb->b.auto_buffering = auto_buffering;
+    }
     vb->cbs = cbs;
     vb->cbs_userdata = cbs_userdata;
     return true;
@@ -168,7 +267,7 @@ sc_video_buffer_init(struct sc_video_buffer *vb, sc_tick buffering_time,
 
 bool
 sc_video_buffer_start(struct sc_video_buffer *vb) {
-    if (vb->buffering_time) {
+    if (vb->buffering_enabled) {
         bool ok =
             sc_thread_create(&vb->b.thread, run_buffering, "buffering", vb);
         if (!ok) {
@@ -182,7 +281,7 @@ sc_video_buffer_start(struct sc_video_buffer *vb) {
 
 void
 sc_video_buffer_stop(struct sc_video_buffer *vb) {
-    if (vb->buffering_time) {
+    if (vb->buffering_enabled) {
         sc_mutex_lock(&vb->b.mutex);
         vb->b.stopped = true;
         sc_cond_signal(&vb->b.queue_cond);
@@ -193,7 +292,7 @@ sc_video_buffer_stop(struct sc_video_buffer *vb) {
 
 void
 sc_video_buffer_join(struct sc_video_buffer *vb) {
-    if (vb->buffering_time) {
+    if (vb->buffering_enabled) {
         sc_thread_join(&vb->b.thread, NULL);
     }
 }
@@ -201,7 +300,11 @@ sc_video_buffer_join(struct sc_video_buffer *vb) {
 void
 sc_video_buffer_destroy(struct sc_video_buffer *vb) {
     sc_frame_buffer_destroy(&vb->fb);
-    if (vb->buffering_time) {
+    if (vb->buffering_enabled) {
+        while (vb->b.frame_pool_count) {
+            av_frame_free(&vb->b.frame_pool[--vb->b.frame_pool_count]);
+        }
+        free(vb->b.frame_pool);
         sc_cond_destroy(&vb->b.wait_cond);
         sc_cond_destroy(&vb->b.queue_cond);
         sc_mutex_destroy(&vb->b.mutex);
@@ -210,7 +313,7 @@ sc_video_buffer_destroy(struct sc_video_buffer *vb) {
 
 bool
 sc_video_buffer_push(struct sc_video_buffer *vb, const AVFrame *frame) {
-    if (!vb->buffering_time) {
+    if (!vb->buffering_enabled) {
         // No buffering
         return sc_video_buffer_offer(vb, frame);
     }
@@ -219,7 +322,9 @@ sc_video_buffer_push(struct sc_video_buffer *vb, const AVFrame *frame) {
 
     sc_tick pts = SC_TICK_FROM_US(frame->pts);
     sc_clock_update(&vb->b.clock, sc_tick_now(), pts);
-    sc_cond_signal(&vb->b.wait_cond);
+    // Do not wake up the buffering thread: the deadline of the frame at the
+    // head of the queue is valid once computed (refreshing it for later clock
+    // refinements is not worth a wakeup round per pushed frame)
 
     if (vb->b.clock.count == 1) {
         sc_mutex_unlock(&vb->b.mutex);
@@ -230,17 +335,29 @@ sc_video_buffer_push(struct sc_video_buffer *vb, const AVFrame *frame) {
         return sc_video_buffer_offer(vb, frame);
     }
 
-    struct sc_video_buffer_frame *vb_frame = sc_video_buffer_frame_new(frame);
-    if (!vb_frame) {
+    if (sc_ringbuf_is_full(&vb->b.queue)) {
+        // the buffering thread is not keeping up; drop the incoming frame
+        // rather than blocking the stream thread (the display path renders
+        // the latest frame anyway)
+        sc_mutex_unlock(&vb->b.mutex);
+        sc_stats_add(SC_STAT_FRAMES_DROPPED, 1);
+        LOG_RATE_LIMITED(LOGW, "Buffering queue full, dropping frame");
+        return true;
+    }
+
+    struct sc_video_buffer_frame vb_frame;
+    if (!sc_video_buffer_frame_init(vb, &vb_frame, frame)) {
         sc_mutex_unlock(&vb->b.mutex);
-        LOG_OOM();
         return false;
     }
 
 #ifndef SC_BUFFERING_NDEBUG
-    vb_frame->push_date = sc_tick_now();
+    vb_frame.push_date = sc_tick_now();
 #endif
-    sc_queue_push(&vb->b.queue, next, vb_frame);
+    bool pushed = sc_ringbuf_push(&vb->b.queue, vb_frame);
+    assert(pushed); // a slot is available, only this thread may push
+    (void) pushed;
+    sc_stats_set(SC_STAT_BUFFERING_QUEUE, sc_ringbuf_count(&vb->b.queue));
     sc_cond_signal(&vb->b.queue_cond);
 
     sc_mutex_unlock(&vb->b.mutex);
@@ -248,7 +365,42 @@ sc_video_buffer_push(struct sc_video_buffer *vb, const AVFrame *frame) {
     return true;
 }
 
-void
+bool
 sc_video_buffer_consume(struct sc_video_buffer *vb, AVFrame *dst) {
-    sc_frame_buffer_consume(&vb->fb, dst);
+    return sc_frame_buffer_consume(&vb->fb, dst);
+}
+
+bool
+sc_video_buffer_is_buffering_enabled(struct sc_video_buffer *vb) {
+    return vb->buffering_enabled;
+}
+
+bool
+sc_video_buffer_set_buffering_time(struct sc_video_buffer *vb, sc_tick time) {
+    assert(time >= 0);
+    if (!vb->buffering_enabled) {
+        // the buffering thread may not be started dynamically
+        return false;
+    }
+
+    sc_mutex_lock(&vb->b.mutex);
+    // the user takes manual control
+    vb->b.auto_buffering = false;
+    vb->buffering_time = time;
+    // wake up the buffering thread so that it recomputes its deadline
+    sc_cond_signal(&vb->b.wait_cond);
+    sc_mutex_unlock(&vb->b.mutex);
+    return true;
+}
+
+sc_tick
+sc_video_buffer_get_buffering_time(struct sc_video_buffer *vb) {
+    if (!vb->buffering_enabled) {
+        return 0;
+    }
+
+    sc_mutex_lock(&vb->b.mutex);
+    sc_tick time = vb->buffering_time;
+    sc_mutex_unlock(&vb->b.mutex);
+    return time;
 }
@@ -7,7 +7,7 @@
 
 #include "clock.h"
 #include "frame_buffer.h"
-#include "util/queue.h"
+#include "util/ringbuf.h"
 #include "util/thread.h"
 #include "util/tick.h"
 
@@ -16,20 +16,23 @@ typedef struct AVFrame AVFrame;
 
 struct sc_video_buffer_frame {
     AVFrame *frame;
-    struct sc_video_buffer_frame *next;
 #ifndef NDEBUG
     sc_tick push_date;
 #endif
 };
 
-struct sc_video_buffer_frame_queue SC_QUEUE(struct sc_video_buffer_frame);
+// large enough for several seconds of buffering at high frame rates; if the
+// ring is ever full, the incoming frame is dropped (the display path tolerates
+// skipped frames, it renders the latest one anyway)
+struct sc_video_buffer_frame_queue     SC_RINGBUF(struct sc_video_buffer_frame, 256);
 
 struct sc_video_buffer {
     struct sc_frame_buffer fb;
 
-    sc_tick buffering_time;
+    bool buffering_enabled; // constant after initialization
+    sc_tick buffering_time; // protected by b.mutex if buffering is enabled
 
-    // only if buffering_time > 0
+    // only if buffering is enabled
     struct {
         sc_thread thread;
         sc_mutex mutex;
@@ -39,6 +42,17 @@ struct sc_video_buffer {
         struct sc_clock clock;
         struct sc_video_buffer_frame_queue queue;
         bool stopped;
+
+        // adapt buffering_time to the measured arrival jitter (protected by
+        // mutex; cleared when the buffering time is set manually)
+        bool auto_buffering;
+
+        // free-list of AVFrames pre-allocated for the steady-state queue
+        // depth, so that buffering a frame performs no allocation (protected
+        // by mutex)
+        AVFrame **frame_pool;
+        size_t frame_pool_size;
+        size_t frame_pool_count;
     } b; // buffering
 
     const struct sc_video_buffer_callbacks *cbs;
@@ -50,8 +64,12 @@ struct sc_video_buffer_callbacks {
                          void *userdata);
 };
 
+// if `auto_buffering` is enabled, the buffering thread is started and
+// `buffering_time` (possibly 0) is only the initial value, later adapted to
+// the measured arrival jitter
 bool
 sc_video_buffer_init(struct sc_video_buffer *vb, sc_tick buffering_time,
+                     bool auto_buffering,
                      const struct sc_video_buffer_callbacks *cbs,
                      void *cbs_userdata);
 
@@ -70,7 +88,26 @@ sc_video_buffer_destroy(struct sc_video_buffer *vb);
 bool
 sc_video_buffer_push(struct sc_video_buffer *vb, const AVFrame *frame);
 
-void
+// return true if a buffering thread is running (necessary for
+// sc_video_buffer_set_buffering_time())
+bool
+sc_video_buffer_is_buffering_enabled(struct sc_video_buffer *vb);
+
+// dynamically change the buffering time (only possible if the video buffer
+// was initialized with buffering, since the buffering thread may not be
+// started or stopped afterwards); disable automatic buffering, if enabled
+//
+// The new value must be non-negative.
+bool
+sc_video_buffer_set_buffering_time(struct sc_video_buffer *vb, sc_tick time);
+
+// return the current buffering time (0 if buffering is disabled)
+sc_tick
+sc_video_buffer_get_buffering_time(struct sc_video_buffer *vb);
+
+// return false without touching `dst` if the pending frame was already
+// consumed (spurious wake-up)
+bool
 sc_video_buffer_consume(struct sc_video_buffer *vb, AVFrame *dst);
 
 #endif
@@ -0,0 +1,121 @@
+#include "window_geometry.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/file.h"
+#include "util/log.h"
+#include "util/strbuf.h"
+
+#define SC_WINDOW_GEOMETRY_FILENAME "window-geometry"
+
+// One entry per line: "<serial> <x> <y> <width> <height>"
+#define SC_WINDOW_GEOMETRY_MAX_LINE 256
+#define SC_WINDOW_GEOMETRY_MAX_SERIAL 128
+
+bool
+sc_window_geometry_load(const char *serial, struct sc_window_geometry *geom) {
+    assert(serial);
+
+    char *path = sc_file_get_cache_path(SC_WINDOW_GEOMETRY_FILENAME);
+    if (!path) {
+        return false;
+    }
+
+    FILE *file = fopen(path, "r");
+    free(path);
+    if (!file) {
+        // no geometry saved yet
+        return false;
+    }
+
+    bool found = false;
+    char line[SC_WINDOW_GEOMETRY_MAX_LINE];
+    while (fgets(line, sizeof(line), file)) {
+        char entry_serial[SC_WINDOW_GEOMETRY_MAX_SERIAL];
+        int x;
+        int y;
+        unsigned width;
+        unsigned height;
+        if (sscanf(line, "%127s %d %d %u %u", entry_serial, &x, &y, &width,
+                   &height) != 5 || strcmp(entry_serial, serial)) {
+            continue;
+        }
+        if (!width || !height || width > UINT16_MAX || height > UINT16_MAX
+                || x < INT16_MIN || x > INT16_MAX
+                || y < INT16_MIN || y > INT16_MAX) {
+            // corrupted entry, ignore it
+            continue;
+        }
+        geom->x = x;
+        geom->y = y;
+        geom->width = width;
+        geom->height = height;
+        found = true;
+        break;
+    }
+
+    fclose(file);
+    return found;
+}
+
+void
+sc_window_geometry_save(const char *serial,
+                        const struct sc_window_geometry *geom) {
+    assert(serial);
+
+    char *path = sc_file_get_cache_path(SC_WINDOW_GEOMETRY_FILENAME);
+    if (!path) {
+        return;
+    }
+
+    struct sc_strbuf buf;
+    if (!sc_strbuf_init(&buf, SC_WINDOW_GEOMETRY_MAX_LINE)) {
+        LOG_OOM();
+        free(path);
+        return;
+    }
+
+    bool ok = true;
+
+    // keep the entries of the other devices
+    FILE *file = fopen(path, "r");
+    if (file) {
+        char line[SC_WINDOW_GEOMETRY_MAX_LINE];
+        while (ok && fgets(line, sizeof(line), file)) {
+            char entry_serial[SC_WINDOW_GEOMETRY_MAX_SERIAL];
+            if (sscanf(line, "%127s", entry_serial) == 1
+                    && !strcmp(entry_serial, serial)) {
+                // drop the entry to be replaced
+                continue;
+            }
+            ok = sc_strbuf_append_str(&buf, line);
+        }
+        fclose(file);
+    }
+
+    char entry[SC_WINDOW_GEOMETRY_MAX_LINE];
+    int r = snprintf(entry, sizeof(entry),
+                     "%s %" PRIi16 " %" PRIi16 " %" PRIu16 " %" PRIu16 "\n",
+                     serial, geom->x, geom->y, geom->width, geom->height);
+    ok = ok && r >= 0 && (size_t) r < sizeof(entry)
+            && sc_strbuf_append_str(&buf, entry);
+
+    if (ok) {
+        file = fopen(path, "w");
+        if (file) {
+            if (fwrite(buf.s, 1, buf.len, file) != buf.len) {
+                LOGW("Could not write window geometry to \"%s\"", path);
+            }
+            fclose(file);
+        } else {
+            LOGW("Could not open \"%s\" for writing", path);
+        }
+    }
+
+    free(buf.s);
+    free(path);
+}
@@ -0,0 +1,37 @@
+#ifndef SC_WINDOW_GEOMETRY_H
+#define SC_WINDOW_GEOMETRY_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Last-known window geometry, persisted per device serial
+ *
+ * It allows to create the window directly at its final size and position on
+ * startup, without waiting for the first frame.
+ */
+struct sc_window_geometry {
+    int16_t x;
+    int16_t y;
+    uint16_t width;
+    uint16_t height;
+};
+
+/**
+ * Load the last geometry saved for this device
+ *
+ * Return false if no geometry is stored for this serial (or on error).
+ */
+bool
+sc_window_geometry_load(const char *serial, struct sc_window_geometry *geom);
+
+/**
+ * Save the geometry for this device (best effort)
+ */
+void
+sc_window_geometry_save(const char *serial,
+                        const struct sc_window_geometry *geom);
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef SC_BENCH_H
+#define SC_BENCH_H
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+// Minimal helper for micro-benchmarks (run with `meson test --benchmark`):
+// measure the CPU time of `iters` executions of `block`, print the
+// per-operation cost and fail if it exceeds `budget_ns`.
+//
+// The budgets are deliberately generous (about an order of magnitude above
+// the expected cost), so that they catch accidental complexity regressions
+// on these per-event functions without being flaky on slow or loaded
+// machines.
+
+// prevent the compiler from optimizing a result away
+static volatile uint64_t sc_bench_sink;
+
+static inline uint64_t
+sc_bench_now_ns(void) {
+    return (uint64_t) clock() * (UINT64_C(1000000000) / CLOCKS_PER_SEC);
+}
+
+#define SC_BENCH(name, iters, budget_ns, block) do { \
+    uint64_t sc_bench_start_ = sc_bench_now_ns(); \
+    for (uint64_t sc_bench_i_ = 0; sc_bench_i_ < (iters); ++sc_bench_i_) { \
+        block; \
+    } \
+    uint64_t sc_bench_elapsed_ = sc_bench_now_ns() - sc_bench_start_; \
+    uint64_t sc_bench_ns_per_op_ = sc_bench_elapsed_ / (iters); \
+    printf("%-32s %8" PRIu64 " ns/op (budget %" PRIu64 " ns/op)\n", \
+           name, sc_bench_ns_per_op_, (uint64_t) (budget_ns)); \
+    assert(sc_bench_ns_per_op_ <= (budget_ns)); \
+} while (0)
+
+#endif
@@ -0,0 +1,38 @@
+#include "common.h"
+
+#include "bench.h"
+#include "util/buffer_util.h"
+
+// executed for every frame meta header field, on the stream path
+static void bench_buffer_reads(void) {
+    uint8_t buf[16] = {
+        0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef,
+        0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef,
+    };
+
+    SC_BENCH("buffer_read16/32/64be", 1000000, 500, {
+        sc_bench_sink += buffer_read16be(buf)
+                       + buffer_read32be(buf)
+                       + buffer_read64be(buf);
+    });
+}
+
+static void bench_buffer_writes(void) {
+    uint8_t buf[16];
+
+    SC_BENCH("buffer_write16/32/64be", 1000000, 500, {
+        buffer_write16be(buf, (uint16_t) sc_bench_i_);
+        buffer_write32be(buf, (uint32_t) sc_bench_i_);
+        buffer_write64be(buf, sc_bench_i_);
+        sc_bench_sink += buf[0];
+    });
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    bench_buffer_reads();
+    bench_buffer_writes();
+    return 0;
+}
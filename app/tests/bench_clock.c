@@ -0,0 +1,28 @@
+#include "common.h"
+
+#include "bench.h"
+#include "clock.h"
+
+// executed for every frame meta, on the stream path
+static void bench_clock_update(void) {
+    struct sc_clock clock;
+    sc_clock_init(&clock);
+
+    sc_tick system = 0;
+    sc_tick stream = 0;
+    SC_BENCH("sc_clock_update", 1000000, 2000, {
+        // simulate a 60fps stream with a constant offset
+        system += 16667;
+        stream += 16667;
+        sc_clock_update(&clock, system, stream);
+    });
+    sc_bench_sink += (uint64_t) clock.count;
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    bench_clock_update();
+    return 0;
+}
@@ -0,0 +1,50 @@
+#include "common.h"
+
+#include "bench.h"
+#include "util/cbuf.h"
+#include "util/queue.h"
+
+struct int_queue CBUF(int, 64);
+
+// executed for every queued control message
+static void bench_cbuf_push_take(void) {
+    struct int_queue queue;
+    cbuf_init(&queue);
+
+    SC_BENCH("cbuf push+take", 1000000, 1000, {
+        bool ok = cbuf_push(&queue, (int) sc_bench_i_);
+        assert(ok);
+        int item;
+        ok = cbuf_take(&queue, &item);
+        assert(ok);
+        sc_bench_sink += (uint64_t) item;
+    });
+}
+
+struct foo {
+    int value;
+    struct foo *next;
+};
+
+// executed for every buffered video frame
+static void bench_queue_push_take(void) {
+    struct my_queue SC_QUEUE(struct foo) queue;
+    sc_queue_init(&queue);
+
+    struct foo item = { .value = 42 };
+    SC_BENCH("queue push+take", 1000000, 1000, {
+        sc_queue_push(&queue, next, &item);
+        struct foo *taken;
+        sc_queue_take(&queue, next, &taken);
+        sc_bench_sink += (uint64_t) taken->value;
+    });
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    bench_cbuf_push_take();
+    bench_queue_push_take();
+    return 0;
+}
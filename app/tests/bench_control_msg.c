@@ -0,0 +1,58 @@
+#include "common.h"
+
+#include "bench.h"
+#include "control_msg.h"
+
+// serialized for every mouse motion event, so it must stay cheap
+static void bench_serialize_inject_touch_event(void) {
+    struct control_msg msg = {
+        .type = CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT,
+        .inject_touch_event = {
+            .action = AMOTION_EVENT_ACTION_MOVE,
+            .pointer_id = UINT64_C(0x1234567887654321),
+            .position = {
+                .point = {
+                    .x = 100,
+                    .y = 200,
+                },
+                .screen_size = {
+                    .width = 1080,
+                    .height = 1920,
+                },
+            },
+            .pressure = 1.0f,
+            .buttons = AMOTION_EVENT_BUTTON_PRIMARY,
+        },
+    };
+
+    unsigned char buf[CONTROL_MSG_MAX_SIZE];
+    SC_BENCH("inject_touch_event serialize", 1000000, 5000, {
+        sc_bench_sink += control_msg_serialize(&msg, buf);
+    });
+}
+
+static void bench_serialize_inject_keycode(void) {
+    struct control_msg msg = {
+        .type = CONTROL_MSG_TYPE_INJECT_KEYCODE,
+        .inject_keycode = {
+            .action = AKEY_EVENT_ACTION_UP,
+            .keycode = AKEYCODE_ENTER,
+            .repeat = 5,
+            .metastate = AMETA_SHIFT_ON | AMETA_SHIFT_LEFT_ON,
+        },
+    };
+
+    unsigned char buf[CONTROL_MSG_MAX_SIZE];
+    SC_BENCH("inject_keycode serialize", 1000000, 5000, {
+        sc_bench_sink += control_msg_serialize(&msg, buf);
+    });
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    bench_serialize_inject_touch_event();
+    bench_serialize_inject_keycode();
+    return 0;
+}
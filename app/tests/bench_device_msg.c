@@ -0,0 +1,56 @@
+#include "common.h"
+
+#include <string.h>
+
+#include "bench.h"
+#include "device_msg.h"
+
+static struct sc_arena arena;
+
+// deserialized for every device message (the clipboard text comes from the
+// arena and is released immediately, as in production)
+static void bench_deserialize_clipboard(void) {
+    const unsigned char input[] = {
+        DEVICE_MSG_TYPE_CLIPBOARD,
+        0, // not compressed
+        0x00, 0x00, 0x00, 0x0d, // text length
+        'h', 'e', 'l', 'l', 'o', ',', ' ', 'w', 'o', 'r', 'l', 'd', '!',
+    };
+
+    SC_BENCH("clipboard deserialize", 200000, 20000, {
+        struct device_msg msg;
+        ssize_t r = device_msg_deserialize(&arena, input, sizeof(input), &msg);
+        assert(r == (ssize_t) sizeof(input));
+        sc_bench_sink += (uint64_t) r;
+        device_msg_destroy(&arena, &msg);
+    });
+}
+
+static void bench_deserialize_ack_clipboard(void) {
+    const unsigned char input[] = {
+        DEVICE_MSG_TYPE_ACK_CLIPBOARD,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x2a, // sequence
+    };
+
+    SC_BENCH("ack_clipboard deserialize", 1000000, 5000, {
+        struct device_msg msg;
+        ssize_t r = device_msg_deserialize(&arena, input, sizeof(input), &msg);
+        assert(r == (ssize_t) sizeof(input));
+        sc_bench_sink += (uint64_t) r;
+        device_msg_destroy(&arena, &msg);
+    });
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    bool ok = sc_arena_init(&arena, 4096);
+    assert(ok);
+
+    bench_deserialize_clipboard();
+    bench_deserialize_ack_clipboard();
+
+    sc_arena_destroy(&arena);
+    return 0;
+}
@@ -69,6 +69,35 @@ static void test_get_ip_truncated() {
     assert(!ip);
 }
 
+static void test_device_present_any() {
+    char payload[] = "0123456789abcdef\toffline\n"
+                     "192.168.1.3:5555\tdevice\n";
+
+    bool present = sc_adb_parse_device_present(payload, sizeof(payload), NULL);
+    assert(present);
+}
+
+static void test_device_present_matching_serial() {
+    char payload[] = "0123456789abcdef\tdevice\n"
+                     "192.168.1.3:5555\tunauthorized\n";
+
+    bool present = sc_adb_parse_device_present(payload, sizeof(payload),
+                                               "0123456789abcdef");
+    assert(present);
+
+    char payload2[] = "0123456789abcdef\tdevice\n";
+    present = sc_adb_parse_device_present(payload2, sizeof(payload2),
+                                          "192.168.1.3:5555");
+    assert(!present);
+}
+
+static void test_device_present_not_ready() {
+    char payload[] = "0123456789abcdef\toffline\n";
+
+    bool present = sc_adb_parse_device_present(payload, sizeof(payload), NULL);
+    assert(!present);
+}
+
 int main(int argc, char *argv[]) {
     (void) argc;
     (void) argv;
@@ -80,4 +109,7 @@ int main(int argc, char *argv[]) {
     test_get_ip_multiline_second_ok();
     test_get_ip_no_wlan();
     test_get_ip_truncated();
+    test_device_present_any();
+    test_device_present_matching_serial();
+    test_device_present_not_ready();
 }
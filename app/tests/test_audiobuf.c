@@ -0,0 +1,92 @@
+#include "common.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include "util/audiobuf.h"
+
+static void test_audiobuf_simple(void) {
+    struct sc_audiobuf buf;
+    bool ok = sc_audiobuf_init(&buf, 32);
+    assert(ok);
+
+    assert(sc_audiobuf_can_read(&buf) == 0);
+
+    const uint8_t data[] = {1, 2, 3, 4, 5};
+    size_t w = sc_audiobuf_write(&buf, data, sizeof(data));
+    assert(w == 5);
+    assert(sc_audiobuf_can_read(&buf) == 5);
+
+    uint8_t out[8];
+    size_t r = sc_audiobuf_read(&buf, out, 3);
+    assert(r == 3);
+    assert(!memcmp(out, (uint8_t[]) {1, 2, 3}, 3));
+    assert(sc_audiobuf_can_read(&buf) == 2);
+
+    // reading more than available returns only the available bytes
+    r = sc_audiobuf_read(&buf, out, sizeof(out));
+    assert(r == 2);
+    assert(!memcmp(out, (uint8_t[]) {4, 5}, 2));
+    assert(sc_audiobuf_can_read(&buf) == 0);
+
+    sc_audiobuf_destroy(&buf);
+}
+
+static void test_audiobuf_full(void) {
+    struct sc_audiobuf buf;
+    bool ok = sc_audiobuf_init(&buf, 8);
+    assert(ok);
+
+    uint8_t data[12];
+    for (size_t i = 0; i < sizeof(data); ++i) {
+        data[i] = i;
+    }
+
+    // writing more than the capacity only stores the first cap bytes
+    size_t w = sc_audiobuf_write(&buf, data, sizeof(data));
+    assert(w == 8);
+    assert(sc_audiobuf_can_read(&buf) == 8);
+
+    w = sc_audiobuf_write(&buf, data, 1);
+    assert(w == 0); // full
+
+    uint8_t out[8];
+    size_t r = sc_audiobuf_read(&buf, out, sizeof(out));
+    assert(r == 8);
+    assert(!memcmp(out, data, 8));
+
+    sc_audiobuf_destroy(&buf);
+}
+
+static void test_audiobuf_wrapping(void) {
+    struct sc_audiobuf buf;
+    bool ok = sc_audiobuf_init(&buf, 8);
+    assert(ok);
+
+    uint8_t out[8];
+
+    // advance the indices so that the next write wraps around the end
+    size_t w = sc_audiobuf_write(&buf, (uint8_t[]) {0, 0, 0, 0, 0}, 5);
+    assert(w == 5);
+    size_t r = sc_audiobuf_read(&buf, out, 5);
+    assert(r == 5);
+
+    const uint8_t data[] = {10, 11, 12, 13, 14, 15};
+    w = sc_audiobuf_write(&buf, data, sizeof(data));
+    assert(w == 6);
+    r = sc_audiobuf_read(&buf, out, sizeof(out));
+    assert(r == 6);
+    assert(!memcmp(out, data, 6));
+
+    sc_audiobuf_destroy(&buf);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_audiobuf_simple();
+    test_audiobuf_full();
+    test_audiobuf_wrapping();
+    return 0;
+}
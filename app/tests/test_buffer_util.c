@@ -67,6 +67,25 @@ static void test_buffer_read64be(void) {
     assert(val == 0xABCD1234567890EF);
 }
 
+// the helpers use unaligned loads/stores, so they must behave the same at
+// any offset in a serialization buffer
+static void test_buffer_unaligned(void) {
+    uint8_t buf[9];
+
+    for (size_t offset = 0; offset < 2; ++offset) {
+        buffer_write64be(&buf[offset], 0xABCD1234567890EF);
+        assert(buf[offset] == 0xAB);
+        assert(buf[offset + 7] == 0xEF);
+        assert(buffer_read64be(&buf[offset]) == 0xABCD1234567890EF);
+
+        buffer_write32be(&buf[offset], 0xABCD1234);
+        assert(buffer_read32be(&buf[offset]) == 0xABCD1234);
+
+        buffer_write16be(&buf[offset], 0xABCD);
+        assert(buffer_read16be(&buf[offset]) == 0xABCD);
+    }
+}
+
 int main(int argc, char *argv[]) {
     (void) argc;
     (void) argv;
@@ -77,5 +96,6 @@ int main(int argc, char *argv[]) {
     test_buffer_read16be();
     test_buffer_read32be();
     test_buffer_read64be();
+    test_buffer_unaligned();
     return 0;
 }
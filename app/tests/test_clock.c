@@ -69,11 +69,54 @@ void test_large_rolling_sum(void) {
     assert(clock1.right_sum.stream == clock2.right_sum.stream);
 }
 
+void test_outlier_rejection(void) {
+    struct sc_clock clock;
+    sc_clock_init(&clock);
+
+    // simulate a 50fps stream received with a 5ms delay
+    const sc_tick frame_interval = SC_TICK_FROM_MS(20);
+    const sc_tick delay = SC_TICK_FROM_MS(5);
+
+    sc_tick stream = 0;
+    for (unsigned i = 0; i < 2 * SC_CLOCK_RANGE; ++i) {
+        sc_clock_update(&clock, stream + delay, stream);
+        stream += frame_interval;
+    }
+
+    double slope = clock.slope;
+    sc_tick offset = clock.offset;
+
+    // a single delayed frame (for example a Wi-Fi retransmission) must not
+    // skew the estimation
+    sc_clock_update(&clock, stream + delay + SC_TICK_FROM_MS(500), stream);
+    stream += frame_interval;
+
+    assert(clock.outliers == 1);
+    assert(clock.slope == slope);
+    assert(clock.offset == offset);
+
+    // once the transmission recovers, further points are accepted normally
+    sc_clock_update(&clock, stream + delay, stream);
+    stream += frame_interval;
+    assert(clock.outliers == 0);
+
+    // a persistent latency change must restart the estimation
+    sc_tick last_offset = clock.offset;
+    for (unsigned i = 0; i < SC_CLOCK_RANGE; ++i) {
+        sc_clock_update(&clock, stream + delay + SC_TICK_FROM_MS(500), stream);
+        stream += frame_interval;
+    }
+    assert(clock.outliers == 0);
+    assert(clock.count < SC_CLOCK_RANGE); // the estimation restarted
+    assert(clock.offset > last_offset);
+}
+
 int main(int argc, char *argv[]) {
     (void) argc;
     (void) argv;
 
     test_small_rolling_sum();
     test_large_rolling_sum();
+    test_outlier_rejection();
     return 0;
 };
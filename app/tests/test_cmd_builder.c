@@ -0,0 +1,73 @@
+#include "common.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include "util/cmd_builder.h"
+
+static void test_cmd_builder_simple(void) {
+    struct sc_cmd_builder builder;
+    // a tiny arena, to force growth (and reallocations)
+    bool ok = sc_cmd_builder_init(&builder, 4);
+    assert(ok);
+
+    ok = sc_cmd_builder_add(&builder, "shell");
+    assert(ok);
+
+    ok = sc_cmd_builder_addf(&builder, "bit_rate=%u", 8000000u);
+    assert(ok);
+
+    ok = sc_cmd_builder_addf(&builder, "max_size=%u", 1920u);
+    assert(ok);
+
+    assert(builder.count == 3);
+
+    const char *const *argv = sc_cmd_builder_get_argv(&builder);
+    assert(!strcmp(argv[0], "shell"));
+    assert(!strcmp(argv[1], "bit_rate=8000000"));
+    assert(!strcmp(argv[2], "max_size=1920"));
+
+    sc_cmd_builder_destroy(&builder);
+}
+
+static void test_cmd_builder_reset(void) {
+    struct sc_cmd_builder builder;
+    bool ok = sc_cmd_builder_init(&builder, 64);
+    assert(ok);
+
+    ok = sc_cmd_builder_add(&builder, "first");
+    assert(ok);
+    ok = sc_cmd_builder_add(&builder, "command");
+    assert(ok);
+
+    assert(builder.count == 2);
+
+    size_t cap = builder.buf.cap;
+    char *arena = builder.buf.s;
+
+    sc_cmd_builder_reset(&builder);
+    assert(builder.count == 0);
+    assert(builder.buf.len == 0);
+
+    ok = sc_cmd_builder_add(&builder, "second");
+    assert(ok);
+
+    // the arena must be reused, without any reallocation
+    assert(builder.buf.cap == cap);
+    assert(builder.buf.s == arena);
+
+    const char *const *argv = sc_cmd_builder_get_argv(&builder);
+    assert(builder.count == 1);
+    assert(!strcmp(argv[0], "second"));
+
+    sc_cmd_builder_destroy(&builder);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_cmd_builder_simple();
+    test_cmd_builder_reset();
+    return 0;
+}
@@ -2,6 +2,7 @@
 
 #include <assert.h>
 #include <string.h>
+#include <zlib.h>
 
 #include "control_msg.h"
 
@@ -91,12 +92,13 @@ static void test_serialize_inject_touch_event(void) {
             },
             .pressure = 1.0f,
             .buttons = AMOTION_EVENT_BUTTON_PRIMARY,
+            .history_count = 0,
         },
     };
 
     unsigned char buf[CONTROL_MSG_MAX_SIZE];
     size_t size = control_msg_serialize(&msg, buf);
-    assert(size == 28);
+    assert(size == 29);
 
     const unsigned char expected[] = {
         CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT,
@@ -105,7 +107,82 @@ static void test_serialize_inject_touch_event(void) {
         0x00, 0x00, 0x00, 0x64, 0x00, 0x00, 0x00, 0xc8, // 100 200
         0x04, 0x38, 0x07, 0x80, // 1080 1920
         0xff, 0xff, // pressure
-        0x00, 0x00, 0x00, 0x01 // AMOTION_EVENT_BUTTON_PRIMARY
+        0x00, 0x00, 0x00, 0x01, // AMOTION_EVENT_BUTTON_PRIMARY
+        0x00, // no history
+    };
+    assert(!memcmp(buf, expected, sizeof(expected)));
+}
+
+static void test_serialize_inject_touch_event_history(void) {
+    struct control_msg msg = {
+        .type = CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT,
+        .inject_touch_event = {
+            .action = AMOTION_EVENT_ACTION_MOVE,
+            .pointer_id = UINT64_C(0xffffffffffffffff),
+            .position = {
+                .point = {
+                    .x = 100,
+                    .y = 200,
+                },
+                .screen_size = {
+                    .width = 1080,
+                    .height = 1920,
+                },
+            },
+            .pressure = 1.0f,
+            .buttons = 0,
+            .timestamp = SC_TICK_FROM_MS(50),
+            .history_count = 2,
+            .history = {
+                {
+                    .position = {
+                        .point = {
+                            .x = 80,
+                            .y = 180,
+                        },
+                        .screen_size = {
+                            .width = 1080,
+                            .height = 1920,
+                        },
+                    },
+                    .timestamp = SC_TICK_FROM_MS(30),
+                },
+                {
+                    .position = {
+                        .point = {
+                            .x = 90,
+                            .y = 190,
+                        },
+                        .screen_size = {
+                            .width = 1080,
+                            .height = 1920,
+                        },
+                    },
+                    .timestamp = SC_TICK_FROM_MS(40),
+                },
+            },
+        },
+    };
+
+    unsigned char buf[CONTROL_MSG_MAX_SIZE];
+    size_t size = control_msg_serialize(&msg, buf);
+    assert(size == 29 + 2 * 14);
+
+    const unsigned char expected[] = {
+        CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT,
+        0x02, // AMOTION_EVENT_ACTION_MOVE
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, // pointer id
+        0x00, 0x00, 0x00, 0x64, 0x00, 0x00, 0x00, 0xc8, // 100 200
+        0x04, 0x38, 0x07, 0x80, // 1080 1920
+        0xff, 0xff, // pressure
+        0x00, 0x00, 0x00, 0x00, // no buttons
+        0x02, // 2 history entries
+        0x00, 0x00, 0x00, 0x50, 0x00, 0x00, 0x00, 0xb4, // 80 180
+        0x04, 0x38, 0x07, 0x80, // 1080 1920
+        0x00, 0x14, // 20 ms old
+        0x00, 0x00, 0x00, 0x5a, 0x00, 0x00, 0x00, 0xbe, // 90 190
+        0x04, 0x38, 0x07, 0x80, // 1080 1920
+        0x00, 0x0a, // 10 ms old
     };
     assert(!memcmp(buf, expected, sizeof(expected)));
 }
@@ -238,18 +315,59 @@ static void test_serialize_set_clipboard(void) {
 
     unsigned char buf[CONTROL_MSG_MAX_SIZE];
     size_t size = control_msg_serialize(&msg, buf);
-    assert(size == 27);
+    assert(size == 28);
 
     const unsigned char expected[] = {
         CONTROL_MSG_TYPE_SET_CLIPBOARD,
         0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, // sequence
         1, // paste
+        0, // not compressed
         0x00, 0x00, 0x00, 0x0d, // text length
         'h', 'e', 'l', 'l', 'o', ',', ' ', 'w', 'o', 'r', 'l', 'd', '!', // text
     };
     assert(!memcmp(buf, expected, sizeof(expected)));
 }
 
+static void test_serialize_set_clipboard_deflated(void) {
+    char text[CONTROL_MSG_CLIPBOARD_DEFLATE_MIN_LENGTH + 1];
+    memset(text, 'a', sizeof(text) - 1);
+    text[sizeof(text) - 1] = '\0';
+
+    struct control_msg msg = {
+        .type = CONTROL_MSG_TYPE_SET_CLIPBOARD,
+        .set_clipboard = {
+            .sequence = UINT64_C(0x0102030405060708),
+            .paste = false,
+            .text = text,
+        },
+    };
+
+    unsigned char buf[CONTROL_MSG_MAX_SIZE];
+    size_t size = control_msg_serialize(&msg, buf);
+    // a repetitive text must be sent compressed
+    assert(size < sizeof(text) - 1);
+
+    assert(buf[0] == CONTROL_MSG_TYPE_SET_CLIPBOARD);
+    assert(buf[9] == 0); // paste
+    assert(buf[10] == 1); // compressed
+
+    uint32_t payload_len = (buf[11] << 24) | (buf[12] << 16) | (buf[13] << 8)
+                         | buf[14];
+    assert(size == 15 + payload_len);
+
+    uint32_t text_len = (buf[15] << 24) | (buf[16] << 16) | (buf[17] << 8)
+                      | buf[18];
+    assert(text_len == sizeof(text) - 1);
+
+    char uncompressed[sizeof(text)];
+    uLongf dst_len = text_len;
+    int r = uncompress((Bytef *) uncompressed, &dst_len, &buf[19],
+                       payload_len - 4);
+    assert(r == Z_OK);
+    assert(dst_len == text_len);
+    assert(!memcmp(uncompressed, text, text_len));
+}
+
 static void test_serialize_set_screen_power_mode(void) {
     struct control_msg msg = {
         .type = CONTROL_MSG_TYPE_SET_SCREEN_POWER_MODE,
@@ -284,6 +402,141 @@ static void test_serialize_rotate_device(void) {
     assert(!memcmp(buf, expected, sizeof(expected)));
 }
 
+static void test_serialize_set_max_size(void) {
+    struct control_msg msg = {
+        .type = CONTROL_MSG_TYPE_SET_MAX_SIZE,
+        .set_max_size = {
+            .max_size = 1024,
+        },
+    };
+
+    unsigned char buf[CONTROL_MSG_MAX_SIZE];
+    size_t size = control_msg_serialize(&msg, buf);
+    assert(size == 3);
+
+    const unsigned char expected[] = {
+        CONTROL_MSG_TYPE_SET_MAX_SIZE,
+        0x04, 0x00, // 1024
+    };
+    assert(!memcmp(buf, expected, sizeof(expected)));
+}
+
+static void test_serialize_set_max_fps(void) {
+    struct control_msg msg = {
+        .type = CONTROL_MSG_TYPE_SET_MAX_FPS,
+        .set_max_fps = {
+            .max_fps = 30,
+        },
+    };
+
+    unsigned char buf[CONTROL_MSG_MAX_SIZE];
+    size_t size = control_msg_serialize(&msg, buf);
+    assert(size == 3);
+
+    const unsigned char expected[] = {
+        CONTROL_MSG_TYPE_SET_MAX_FPS,
+        0x00, 0x1e, // 30
+    };
+    assert(!memcmp(buf, expected, sizeof(expected)));
+}
+
+static void test_serialize_set_stream_paused(void) {
+    struct control_msg msg = {
+        .type = CONTROL_MSG_TYPE_SET_STREAM_PAUSED,
+        .set_stream_paused = {
+            .paused = true,
+        },
+    };
+
+    unsigned char buf[CONTROL_MSG_MAX_SIZE];
+    size_t size = control_msg_serialize(&msg, buf);
+    assert(size == 2);
+
+    const unsigned char expected[] = {
+        CONTROL_MSG_TYPE_SET_STREAM_PAUSED,
+        0x01, // paused
+    };
+    assert(!memcmp(buf, expected, sizeof(expected)));
+}
+
+static void test_serialize_request_idr(void) {
+    struct control_msg msg = {
+        .type = CONTROL_MSG_TYPE_REQUEST_IDR,
+    };
+
+    unsigned char buf[CONTROL_MSG_MAX_SIZE];
+    size_t size = control_msg_serialize(&msg, buf);
+    assert(size == 1);
+
+    const unsigned char expected[] = {
+        CONTROL_MSG_TYPE_REQUEST_IDR,
+    };
+    assert(!memcmp(buf, expected, sizeof(expected)));
+}
+
+static void test_serialize_set_crop(void) {
+    struct control_msg msg = {
+        .type = CONTROL_MSG_TYPE_SET_CROP,
+        .set_crop = {
+            .width = 1280,
+            .height = 720,
+            .x = 320,
+            .y = 480,
+        },
+    };
+
+    unsigned char buf[CONTROL_MSG_MAX_SIZE];
+    size_t size = control_msg_serialize(&msg, buf);
+    assert(size == 9);
+
+    const unsigned char expected[] = {
+        CONTROL_MSG_TYPE_SET_CROP,
+        0x05, 0x00, // width = 1280
+        0x02, 0xd0, // height = 720
+        0x01, 0x40, // x = 320
+        0x01, 0xe0, // y = 480
+    };
+    assert(!memcmp(buf, expected, sizeof(expected)));
+}
+
+static void test_serialize_clock_sync(void) {
+    struct control_msg msg = {
+        .type = CONTROL_MSG_TYPE_CLOCK_SYNC,
+        .clock_sync = {
+            .client_time = UINT64_C(0x0102030405060708),
+        },
+    };
+
+    unsigned char buf[CONTROL_MSG_MAX_SIZE];
+    size_t size = control_msg_serialize(&msg, buf);
+    assert(size == 9);
+
+    const unsigned char expected[] = {
+        CONTROL_MSG_TYPE_CLOCK_SYNC,
+        0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, // client time
+    };
+    assert(!memcmp(buf, expected, sizeof(expected)));
+}
+
+static void test_serialize_set_bitrate(void) {
+    struct control_msg msg = {
+        .type = CONTROL_MSG_TYPE_SET_BITRATE,
+        .set_bitrate = {
+            .bit_rate = 8000000,
+        },
+    };
+
+    unsigned char buf[CONTROL_MSG_MAX_SIZE];
+    size_t size = control_msg_serialize(&msg, buf);
+    assert(size == 5);
+
+    const unsigned char expected[] = {
+        CONTROL_MSG_TYPE_SET_BITRATE,
+        0x00, 0x7a, 0x12, 0x00, // 8000000 bits per second
+    };
+    assert(!memcmp(buf, expected, sizeof(expected)));
+}
+
 int main(int argc, char *argv[]) {
     (void) argc;
     (void) argv;
@@ -292,6 +545,7 @@ int main(int argc, char *argv[]) {
     test_serialize_inject_text();
     test_serialize_inject_text_long();
     test_serialize_inject_touch_event();
+    test_serialize_inject_touch_event_history();
     test_serialize_inject_scroll_event();
     test_serialize_back_or_screen_on();
     test_serialize_expand_notification_panel();
@@ -299,7 +553,15 @@ int main(int argc, char *argv[]) {
     test_serialize_collapse_panels();
     test_serialize_get_clipboard();
     test_serialize_set_clipboard();
+    test_serialize_set_clipboard_deflated();
     test_serialize_set_screen_power_mode();
     test_serialize_rotate_device();
+    test_serialize_set_max_size();
+    test_serialize_set_max_fps();
+    test_serialize_set_stream_paused();
+    test_serialize_request_idr();
+    test_serialize_set_crop();
+    test_serialize_clock_sync();
+    test_serialize_set_bitrate();
     return 0;
 }
@@ -2,41 +2,46 @@
 
 #include <assert.h>
 #include <string.h>
+#include <zlib.h>
 
 #include "device_msg.h"
 
 #include <stdio.h>
 
+static struct sc_arena arena;
+
 static void test_deserialize_clipboard(void) {
     const unsigned char input[] = {
         DEVICE_MSG_TYPE_CLIPBOARD,
+        0, // not compressed
         0x00, 0x00, 0x00, 0x03, // text length
         0x41, 0x42, 0x43, // "ABC"
     };
 
     struct device_msg msg;
-    ssize_t r = device_msg_deserialize(input, sizeof(input), &msg);
-    assert(r == 8);
+    ssize_t r = device_msg_deserialize(&arena, input, sizeof(input), &msg);
+    assert(r == 9);
 
     assert(msg.type == DEVICE_MSG_TYPE_CLIPBOARD);
     assert(msg.clipboard.text);
     assert(!strcmp("ABC", msg.clipboard.text));
 
-    device_msg_destroy(&msg);
+    device_msg_destroy(&arena, &msg);
 }
 
 static void test_deserialize_clipboard_big(void) {
     unsigned char input[DEVICE_MSG_MAX_SIZE];
     input[0] = DEVICE_MSG_TYPE_CLIPBOARD;
-    input[1] = (DEVICE_MSG_TEXT_MAX_LENGTH & 0xff000000u) >> 24;
-    input[2] = (DEVICE_MSG_TEXT_MAX_LENGTH & 0x00ff0000u) >> 16;
-    input[3] = (DEVICE_MSG_TEXT_MAX_LENGTH & 0x0000ff00u) >> 8;
-    input[4] =  DEVICE_MSG_TEXT_MAX_LENGTH & 0x000000ffu;
+    input[1] = 0; // not compressed
+    input[2] = (DEVICE_MSG_TEXT_MAX_LENGTH & 0xff000000u) >> 24;
+    input[3] = (DEVICE_MSG_TEXT_MAX_LENGTH & 0x00ff0000u) >> 16;
+    input[4] = (DEVICE_MSG_TEXT_MAX_LENGTH & 0x0000ff00u) >> 8;
+    input[5] =  DEVICE_MSG_TEXT_MAX_LENGTH & 0x000000ffu;
 
-    memset(input + 5, 'a', DEVICE_MSG_TEXT_MAX_LENGTH);
+    memset(input + 6, 'a', DEVICE_MSG_TEXT_MAX_LENGTH);
 
     struct device_msg msg;
-    ssize_t r = device_msg_deserialize(input, sizeof(input), &msg);
+    ssize_t r = device_msg_deserialize(&arena, input, sizeof(input), &msg);
     assert(r == DEVICE_MSG_MAX_SIZE);
 
     assert(msg.type == DEVICE_MSG_TYPE_CLIPBOARD);
@@ -44,7 +49,42 @@ static void test_deserialize_clipboard_big(void) {
     assert(strlen(msg.clipboard.text) == DEVICE_MSG_TEXT_MAX_LENGTH);
     assert(msg.clipboard.text[0] == 'a');
 
-    device_msg_destroy(&msg);
+    device_msg_destroy(&arena, &msg);
+}
+
+static void test_deserialize_clipboard_deflated(void) {
+    const char *text = "this text is repetitive, repetitive, repetitive";
+    size_t text_len = strlen(text);
+
+    unsigned char input[128];
+    input[0] = DEVICE_MSG_TYPE_CLIPBOARD;
+    input[1] = 1; // compressed
+
+    input[6] = (text_len & 0xff000000u) >> 24;
+    input[7] = (text_len & 0x00ff0000u) >> 16;
+    input[8] = (text_len & 0x0000ff00u) >> 8;
+    input[9] =  text_len & 0x000000ffu;
+
+    uLongf compressed_len = sizeof(input) - 10;
+    int z = compress2(&input[10], &compressed_len, (const Bytef *) text,
+                      text_len, Z_BEST_SPEED);
+    assert(z == Z_OK);
+
+    size_t payload_len = 4 + compressed_len;
+    input[2] = (payload_len & 0xff000000u) >> 24;
+    input[3] = (payload_len & 0x00ff0000u) >> 16;
+    input[4] = (payload_len & 0x0000ff00u) >> 8;
+    input[5] =  payload_len & 0x000000ffu;
+
+    struct device_msg msg;
+    ssize_t r = device_msg_deserialize(&arena, input, 6 + payload_len, &msg);
+    assert(r == (ssize_t) (6 + payload_len));
+
+    assert(msg.type == DEVICE_MSG_TYPE_CLIPBOARD);
+    assert(msg.clipboard.text);
+    assert(!strcmp(text, msg.clipboard.text));
+
+    device_msg_destroy(&arena, &msg);
 }
 
 static void test_deserialize_ack_set_clipboard(void) {
@@ -54,19 +94,62 @@ static void test_deserialize_ack_set_clipboard(void) {
     };
 
     struct device_msg msg;
-    ssize_t r = device_msg_deserialize(input, sizeof(input), &msg);
+    ssize_t r = device_msg_deserialize(&arena, input, sizeof(input), &msg);
     assert(r == 9);
 
     assert(msg.type == DEVICE_MSG_TYPE_ACK_CLIPBOARD);
     assert(msg.ack_clipboard.sequence == UINT64_C(0x0102030405060708));
 }
 
+static void test_deserialize_inject_failures(void) {
+    const unsigned char input[] = {
+        DEVICE_MSG_TYPE_INJECT_FAILURES,
+        0x00, 0x00, 0x00, 0x2A, // count
+    };
+
+    struct device_msg msg;
+    ssize_t r = device_msg_deserialize(&arena, input, sizeof(input), &msg);
+    assert(r == 5);
+
+    assert(msg.type == DEVICE_MSG_TYPE_INJECT_FAILURES);
+    assert(msg.inject_failures.count == 42);
+}
+
+static void test_deserialize_clock_sync(void) {
+    const unsigned char input[] = {
+        DEVICE_MSG_TYPE_CLOCK_SYNC,
+        0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, // client time
+        0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, // device time
+    };
+
+    struct device_msg msg;
+
+    // an incomplete message must not be consumed
+    ssize_t r = device_msg_deserialize(&arena, input, sizeof(input) - 1, &msg);
+    assert(r == 0);
+
+    r = device_msg_deserialize(&arena, input, sizeof(input), &msg);
+    assert(r == 17);
+
+    assert(msg.type == DEVICE_MSG_TYPE_CLOCK_SYNC);
+    assert(msg.clock_sync.client_time == UINT64_C(0x0102030405060708));
+    assert(msg.clock_sync.device_time == UINT64_C(0x1112131415161718));
+}
+
 int main(int argc, char *argv[]) {
     (void) argc;
     (void) argv;
 
+    bool ok = sc_arena_init(&arena, 4096);
+    assert(ok);
+
     test_deserialize_clipboard();
     test_deserialize_clipboard_big();
+    test_deserialize_clipboard_deflated();
     test_deserialize_ack_set_clipboard();
+    test_deserialize_inject_failures();
+    test_deserialize_clock_sync();
+
+    sc_arena_destroy(&arena);
     return 0;
 }
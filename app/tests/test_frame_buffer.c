@@ -0,0 +1,117 @@
+#include "common.h"
+
+#include <assert.h>
+#include <libavutil/frame.h>
+
+#include "frame_buffer.h"
+
+static AVFrame *
+create_frame(int64_t pts) {
+    AVFrame *frame = av_frame_alloc();
+    assert(frame);
+    frame->format = AV_PIX_FMT_YUV420P;
+    frame->width = 16;
+    frame->height = 16;
+    int r = av_frame_get_buffer(frame, 0);
+    assert(!r);
+    frame->pts = pts;
+    return frame;
+}
+
+static void test_frame_buffer_simple(void) {
+    struct sc_frame_buffer fb;
+    bool ok = sc_frame_buffer_init(&fb);
+    assert(ok);
+
+    AVFrame *dst = av_frame_alloc();
+    assert(dst);
+
+    // no frame pushed yet
+    assert(!sc_frame_buffer_consume(&fb, dst));
+
+    AVFrame *frame = create_frame(42);
+    bool skipped;
+    ok = sc_frame_buffer_push(&fb, frame, &skipped);
+    assert(ok);
+    assert(!skipped);
+    av_frame_free(&frame);
+
+    assert(sc_frame_buffer_consume(&fb, dst));
+    assert(dst->pts == 42);
+    av_frame_unref(dst);
+
+    // already consumed (spurious wake-up)
+    assert(!sc_frame_buffer_consume(&fb, dst));
+
+    av_frame_free(&dst);
+    sc_frame_buffer_destroy(&fb);
+}
+
+static void test_frame_buffer_skip(void) {
+    struct sc_frame_buffer fb;
+    bool ok = sc_frame_buffer_init(&fb);
+    assert(ok);
+
+    bool skipped;
+    AVFrame *frame = create_frame(1);
+    ok = sc_frame_buffer_push(&fb, frame, &skipped);
+    assert(ok);
+    assert(!skipped);
+    av_frame_free(&frame);
+
+    // the previous frame was not consumed, it is replaced
+    frame = create_frame(2);
+    ok = sc_frame_buffer_push(&fb, frame, &skipped);
+    assert(ok);
+    assert(skipped);
+    av_frame_free(&frame);
+
+    AVFrame *dst = av_frame_alloc();
+    assert(dst);
+    assert(sc_frame_buffer_consume(&fb, dst));
+    assert(dst->pts == 2); // the last frame wins
+    av_frame_unref(dst);
+
+    av_frame_free(&dst);
+    sc_frame_buffer_destroy(&fb);
+}
+
+static void test_frame_buffer_rotation(void) {
+    struct sc_frame_buffer fb;
+    bool ok = sc_frame_buffer_init(&fb);
+    assert(ok);
+
+    AVFrame *dst = av_frame_alloc();
+    assert(dst);
+
+    // exercise the slot rotation well past the number of slots, with and
+    // without consuming
+    for (int64_t i = 0; i < 100; ++i) {
+        AVFrame *frame = create_frame(i);
+        bool skipped;
+        ok = sc_frame_buffer_push(&fb, frame, &skipped);
+        assert(ok);
+        // the frame pushed on the previous iteration was not consumed
+        assert(skipped == (i > 0 && i % 3 == 0));
+        av_frame_free(&frame);
+
+        if (i % 3 != 2) {
+            assert(sc_frame_buffer_consume(&fb, dst));
+            assert(dst->pts == i);
+            av_frame_unref(dst);
+        }
+    }
+
+    av_frame_free(&dst);
+    sc_frame_buffer_destroy(&fb);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_frame_buffer_simple();
+    test_frame_buffer_skip();
+    test_frame_buffer_rotation();
+    return 0;
+}
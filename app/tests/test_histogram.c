@@ -0,0 +1,75 @@
+#include "common.h"
+
+#include <assert.h>
+
+#include "util/histogram.h"
+
+static void test_histogram_exact_small_values(void) {
+    struct sc_histogram histogram;
+    sc_histogram_clear(&histogram);
+
+    // values below the sub-bucket count are stored exactly
+    for (int i = 0; i < 100; ++i) {
+        sc_histogram_add(&histogram, 3);
+    }
+    sc_histogram_add(&histogram, 7);
+
+    assert(histogram.count == 101);
+    assert(sc_histogram_percentile(&histogram, 50) == 3);
+    assert(sc_histogram_percentile(&histogram, 100) == 7);
+}
+
+static void test_histogram_percentiles(void) {
+    struct sc_histogram histogram;
+    sc_histogram_clear(&histogram);
+
+    // 90 "good" frames around 16ms, 10 "stutters" around 100ms (in µs)
+    for (int i = 0; i < 90; ++i) {
+        sc_histogram_add(&histogram, 16000);
+    }
+    for (int i = 0; i < 10; ++i) {
+        sc_histogram_add(&histogram, 100000);
+    }
+
+    uint64_t p50 = sc_histogram_percentile(&histogram, 50);
+    uint64_t p95 = sc_histogram_percentile(&histogram, 95);
+
+    // log-linear buckets guarantee a bounded relative error (~12.5%)
+    assert(p50 >= 14000 && p50 <= 18000);
+    assert(p95 >= 87500 && p95 <= 112500);
+    assert(p95 > p50);
+}
+
+static void test_histogram_empty(void) {
+    struct sc_histogram histogram;
+    sc_histogram_clear(&histogram);
+
+    assert(!histogram.count);
+    assert(sc_histogram_percentile(&histogram, 50) == 0);
+    assert(sc_histogram_percentile(&histogram, 99) == 0);
+}
+
+static void test_histogram_large_values(void) {
+    struct sc_histogram histogram;
+    sc_histogram_clear(&histogram);
+
+    // the full 64-bit range must not overflow the bucket array
+    sc_histogram_add(&histogram, UINT64_C(0xFFFFFFFFFFFFFFFF));
+    sc_histogram_add(&histogram, 1);
+
+    assert(histogram.count == 2);
+    assert(sc_histogram_percentile(&histogram, 50) == 1);
+    assert(sc_histogram_percentile(&histogram, 100)
+            > UINT64_C(0xE000000000000000));
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_histogram_exact_small_values();
+    test_histogram_percentiles();
+    test_histogram_empty();
+    test_histogram_large_values();
+    return 0;
+}
@@ -0,0 +1,70 @@
+#include "common.h"
+
+#include <assert.h>
+
+#include "util/intmap.h"
+
+static void test_find_entry(void) {
+    static const struct sc_intmap_entry entries[] = {
+        {1, 100},
+        {42, 200},
+        {27, 300},
+    };
+
+    const struct sc_intmap_entry *entry = SC_INTMAP_FIND_ENTRY(entries, 42);
+    assert(entry);
+    assert(entry->value == 200);
+
+    entry = SC_INTMAP_FIND_ENTRY(entries, 3);
+    assert(!entry);
+}
+
+static void test_find_sorted(void) {
+    // deliberately unsorted, sc_intmap_find() sorts on first lookup
+    static struct sc_intmap_entry entries[] = {
+        {13, 100},
+        {27, 200},
+        {8, 300},
+        {1073741882, 400}, // SDL keycodes may have bit 30 set
+        {-5, 500},
+        {42, 600},
+        {7, 700},
+    };
+    static struct sc_intmap intmap = SC_INTMAP(entries);
+
+    // every key must be found, with its original value
+    const struct sc_intmap_entry *entry = sc_intmap_find(&intmap, 13);
+    assert(entry);
+    assert(entry->value == 100);
+
+    entry = sc_intmap_find(&intmap, -5);
+    assert(entry);
+    assert(entry->value == 500);
+
+    entry = sc_intmap_find(&intmap, 1073741882);
+    assert(entry);
+    assert(entry->value == 400);
+
+    entry = sc_intmap_find(&intmap, 7);
+    assert(entry);
+    assert(entry->value == 700);
+
+    // first and last in sorted order
+    entry = sc_intmap_find(&intmap, 42);
+    assert(entry);
+    assert(entry->value == 600);
+
+    entry = sc_intmap_find(&intmap, 0);
+    assert(!entry);
+    entry = sc_intmap_find(&intmap, 1000);
+    assert(!entry);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_find_entry();
+    test_find_sorted();
+    return 0;
+}
@@ -0,0 +1,133 @@
+#include "common.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include "util/memory_budget.h"
+
+// fake pool shrinking by releasing the requested bytes (rounded up to its
+// "buffer" granularity)
+struct fake_pool {
+    struct sc_memory_budget_client client;
+    struct sc_memory_budget *mb;
+    size_t granularity;
+    unsigned shrink_count;
+};
+
+static void fake_pool_shrink(struct sc_memory_budget_client *client,
+                             size_t target_bytes) {
+    struct fake_pool *pool = container_of(client, struct fake_pool, client);
+
+    size_t count = (target_bytes + pool->granularity - 1) / pool->granularity;
+    size_t bytes = MIN(count * pool->granularity, client->used);
+    sc_memory_budget_release(pool->mb, client, bytes);
+
+    ++pool->shrink_count;
+}
+
+static void fake_pool_init(struct fake_pool *pool, struct sc_memory_budget *mb,
+                           size_t granularity) {
+    pool->client.shrink = fake_pool_shrink;
+    pool->mb = mb;
+    pool->granularity = granularity;
+    pool->shrink_count = 0;
+    sc_memory_budget_register(mb, &pool->client);
+}
+
+static void test_acquire_within_budget(void) {
+    struct sc_memory_budget mb;
+    bool ok = sc_memory_budget_init(&mb, 100);
+    assert(ok);
+
+    struct fake_pool pool;
+    fake_pool_init(&pool, &mb, 10);
+
+    ok = sc_memory_budget_acquire(&mb, &pool.client, 60);
+    assert(ok);
+    ok = sc_memory_budget_acquire(&mb, &pool.client, 40);
+    assert(ok);
+    assert(mb.used == 100);
+    assert(!pool.shrink_count);
+
+    sc_memory_budget_release(&mb, &pool.client, 100);
+    sc_memory_budget_unregister(&mb, &pool.client);
+    sc_memory_budget_destroy(&mb);
+}
+
+static void test_acquire_shrinks_other_client(void) {
+    struct sc_memory_budget mb;
+    bool ok = sc_memory_budget_init(&mb, 100);
+    assert(ok);
+
+    struct fake_pool pool1;
+    struct fake_pool pool2;
+    fake_pool_init(&pool1, &mb, 10);
+    fake_pool_init(&pool2, &mb, 10);
+
+    ok = sc_memory_budget_acquire(&mb, &pool1.client, 80);
+    assert(ok);
+
+    // exceeds the budget by 30: pool1 (the biggest client) must shrink
+    ok = sc_memory_budget_acquire(&mb, &pool2.client, 50);
+    assert(ok);
+    assert(pool1.shrink_count == 1);
+    assert(pool1.client.used == 50);
+    assert(pool2.client.used == 50);
+    assert(mb.used == 100);
+
+    sc_memory_budget_release(&mb, &pool1.client, 50);
+    sc_memory_budget_release(&mb, &pool2.client, 50);
+    sc_memory_budget_unregister(&mb, &pool1.client);
+    sc_memory_budget_unregister(&mb, &pool2.client);
+    sc_memory_budget_destroy(&mb);
+}
+
+static void test_acquire_fails_when_nothing_to_shrink(void) {
+    struct sc_memory_budget mb;
+    bool ok = sc_memory_budget_init(&mb, 100);
+    assert(ok);
+
+    struct fake_pool pool;
+    fake_pool_init(&pool, &mb, 10);
+
+    // the requester itself is never shrunk
+    ok = sc_memory_budget_acquire(&mb, &pool.client, 80);
+    assert(ok);
+    ok = sc_memory_budget_acquire(&mb, &pool.client, 30);
+    assert(!ok);
+    assert(pool.client.used == 80);
+    assert(mb.used == 80);
+    assert(!pool.shrink_count);
+
+    sc_memory_budget_release(&mb, &pool.client, 80);
+    sc_memory_budget_unregister(&mb, &pool.client);
+    sc_memory_budget_destroy(&mb);
+}
+
+static void test_unlimited_budget(void) {
+    struct sc_memory_budget mb;
+    bool ok = sc_memory_budget_init(&mb, 0);
+    assert(ok);
+
+    struct fake_pool pool;
+    fake_pool_init(&pool, &mb, 10);
+
+    ok = sc_memory_budget_acquire(&mb, &pool.client, (size_t) 1 << 30);
+    assert(ok);
+    assert(!pool.shrink_count);
+
+    sc_memory_budget_release(&mb, &pool.client, (size_t) 1 << 30);
+    sc_memory_budget_unregister(&mb, &pool.client);
+    sc_memory_budget_destroy(&mb);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_acquire_within_budget();
+    test_acquire_shrinks_other_client();
+    test_acquire_fails_when_nothing_to_shrink();
+    test_unlimited_budget();
+    return 0;
+}
@@ -0,0 +1,93 @@
+#include "common.h"
+
+#include <assert.h>
+
+#include "util/mpscq.h"
+
+static void test_mpscq_simple(void) {
+    struct sc_mpscq queue;
+    bool ok = sc_mpscq_init(&queue, sizeof(int), 8);
+    assert(ok);
+
+    int item;
+    assert(!sc_mpscq_take(&queue, &item));
+    assert(!sc_mpscq_peek(&queue, &item));
+
+    for (int i = 0; i < 5; ++i) {
+        ok = sc_mpscq_push(&queue, &i);
+        assert(ok);
+    }
+
+    // peek does not consume
+    assert(sc_mpscq_peek(&queue, &item));
+    assert(item == 0);
+    assert(sc_mpscq_peek(&queue, &item));
+    assert(item == 0);
+
+    // items come out in push order
+    for (int i = 0; i < 5; ++i) {
+        assert(sc_mpscq_take(&queue, &item));
+        assert(item == i);
+    }
+    assert(!sc_mpscq_take(&queue, &item));
+
+    sc_mpscq_destroy(&queue);
+}
+
+static void test_mpscq_full(void) {
+    struct sc_mpscq queue;
+    bool ok = sc_mpscq_init(&queue, sizeof(int), 4);
+    assert(ok);
+
+    for (int i = 0; i < 4; ++i) {
+        ok = sc_mpscq_push(&queue, &i);
+        assert(ok);
+    }
+
+    int item = 42;
+    assert(!sc_mpscq_push(&queue, &item)); // full
+
+    // taking one item frees one cell
+    assert(sc_mpscq_take(&queue, &item));
+    assert(item == 0);
+    item = 4;
+    assert(sc_mpscq_push(&queue, &item));
+
+    for (int i = 1; i <= 4; ++i) {
+        assert(sc_mpscq_take(&queue, &item));
+        assert(item == i);
+    }
+    assert(!sc_mpscq_take(&queue, &item));
+
+    sc_mpscq_destroy(&queue);
+}
+
+static void test_mpscq_wrapping(void) {
+    struct sc_mpscq queue;
+    bool ok = sc_mpscq_init(&queue, sizeof(int), 4);
+    assert(ok);
+
+    // push/take many times more items than the capacity
+    for (int i = 0; i < 100; ++i) {
+        ok = sc_mpscq_push(&queue, &i);
+        assert(ok);
+        int item;
+        assert(sc_mpscq_take(&queue, &item));
+        assert(item == i);
+    }
+
+    int item;
+    assert(!sc_mpscq_take(&queue, &item));
+
+    sc_mpscq_destroy(&queue);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_mpscq_simple();
+    test_mpscq_full();
+    test_mpscq_wrapping();
+    return 0;
+}
@@ -0,0 +1,126 @@
+#include "common.h"
+
+#include <assert.h>
+
+#include "util/ringbuf.h"
+#include "util/thread.h"
+
+static void test_ringbuf_fifo(void) {
+    struct ringbuf_int SC_RINGBUF(int, 4) rb;
+    sc_ringbuf_init(&rb);
+
+    assert(sc_ringbuf_is_empty(&rb));
+    assert(!sc_ringbuf_is_full(&rb));
+
+    bool ok = sc_ringbuf_push(&rb, 42);
+    assert(ok);
+    ok = sc_ringbuf_push(&rb, 27);
+    assert(ok);
+
+    int item;
+    ok = sc_ringbuf_take(&rb, &item);
+    assert(ok);
+    assert(item == 42);
+    ok = sc_ringbuf_take(&rb, &item);
+    assert(ok);
+    assert(item == 27);
+
+    assert(sc_ringbuf_is_empty(&rb));
+    ok = sc_ringbuf_take(&rb, &item);
+    assert(!ok);
+}
+
+static void test_ringbuf_full(void) {
+    struct ringbuf_int SC_RINGBUF(int, 4) rb;
+    sc_ringbuf_init(&rb);
+
+    for (int i = 0; i < 4; ++i) {
+        bool ok = sc_ringbuf_push(&rb, i);
+        assert(ok);
+    }
+    assert(sc_ringbuf_is_full(&rb));
+    bool ok = sc_ringbuf_push(&rb, 4);
+    assert(!ok);
+
+    int item;
+    ok = sc_ringbuf_take(&rb, &item);
+    assert(ok);
+    assert(item == 0);
+    assert(!sc_ringbuf_is_full(&rb));
+
+    ok = sc_ringbuf_push(&rb, 4);
+    assert(ok);
+
+    for (int i = 1; i <= 4; ++i) {
+        ok = sc_ringbuf_take(&rb, &item);
+        assert(ok);
+        assert(item == i);
+    }
+    assert(sc_ringbuf_is_empty(&rb));
+}
+
+// exercise index wraparound over many times the capacity
+static void test_ringbuf_wrap(void) {
+    struct ringbuf_int SC_RINGBUF(int, 8) rb;
+    sc_ringbuf_init(&rb);
+
+    int pushed = 0;
+    int taken = 0;
+    for (int round = 0; round < 1000; ++round) {
+        while (sc_ringbuf_push(&rb, pushed)) {
+            ++pushed;
+        }
+        int item;
+        while (sc_ringbuf_take(&rb, &item)) {
+            assert(item == taken);
+            ++taken;
+        }
+    }
+    assert(pushed == taken);
+}
+
+#define SPSC_COUNT 100000
+
+struct spsc_ring SC_RINGBUF(int, 64);
+
+static int run_producer(void *data) {
+    struct spsc_ring *rb = data;
+    for (int i = 0; i < SPSC_COUNT; ++i) {
+        while (!sc_ringbuf_push(rb, i)) {
+            // spin until a slot is available
+        }
+    }
+    return 0;
+}
+
+// concurrent push/take from two threads, items must arrive in order
+static void test_ringbuf_spsc(void) {
+    static struct spsc_ring rb;
+    sc_ringbuf_init(&rb);
+
+    sc_thread producer;
+    bool ok = sc_thread_create(&producer, run_producer, "producer", &rb);
+    assert(ok);
+
+    for (int i = 0; i < SPSC_COUNT; ++i) {
+        int item;
+        while (!sc_ringbuf_take(&rb, &item)) {
+            // spin until an item is available
+        }
+        assert(item == i);
+    }
+
+    sc_thread_join(&producer, NULL);
+    assert(sc_ringbuf_is_empty(&rb));
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_ringbuf_fifo();
+    test_ringbuf_full();
+    test_ringbuf_wrap();
+    test_ringbuf_spsc();
+    return 0;
+}
@@ -0,0 +1,56 @@
+#include "common.h"
+
+#include <assert.h>
+
+#include "util/ringbuf.h"
+#include "util/stats.h"
+
+static void test_stats_counters(void) {
+    assert(sc_stats_get(SC_STAT_FRAMES_DECODED) == 0);
+
+    sc_stats_add(SC_STAT_FRAMES_DECODED, 1);
+    sc_stats_add(SC_STAT_FRAMES_DECODED, 1);
+    sc_stats_add(SC_STAT_FRAMES_DROPPED, 5);
+
+    assert(sc_stats_get(SC_STAT_FRAMES_DECODED) == 2);
+    assert(sc_stats_get(SC_STAT_FRAMES_DROPPED) == 5);
+    // other counters are unaffected
+    assert(sc_stats_get(SC_STAT_FRAMES_RENDERED) == 0);
+}
+
+static void test_stats_gauges(void) {
+    sc_stats_set(SC_STAT_RECORDER_QUEUE, 12);
+    assert(sc_stats_get(SC_STAT_RECORDER_QUEUE) == 12);
+
+    // a gauge reports the last value, it does not accumulate
+    sc_stats_set(SC_STAT_RECORDER_QUEUE, 3);
+    assert(sc_stats_get(SC_STAT_RECORDER_QUEUE) == 3);
+}
+
+static void test_stats_ringbuf_count(void) {
+    struct ringbuf_int SC_RINGBUF(int, 4) rb;
+    sc_ringbuf_init(&rb);
+
+    assert(sc_ringbuf_count(&rb) == 0);
+
+    bool ok = sc_ringbuf_push(&rb, 42);
+    assert(ok);
+    ok = sc_ringbuf_push(&rb, 27);
+    assert(ok);
+    assert(sc_ringbuf_count(&rb) == 2);
+
+    int item;
+    ok = sc_ringbuf_take(&rb, &item);
+    assert(ok);
+    assert(sc_ringbuf_count(&rb) == 1);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_stats_counters();
+    test_stats_gauges();
+    test_stats_ringbuf_count();
+    return 0;
+}
@@ -39,10 +39,31 @@ static void test_strbuf_simple(void) {
     free(buf.s);
 }
 
+static void test_strbuf_appendf(void) {
+    struct sc_strbuf buf;
+    bool ok = sc_strbuf_init(&buf, 4);
+    assert(ok);
+
+    ok = sc_strbuf_appendf(&buf, "value=%d", 42);
+    assert(ok);
+
+    assert(!strcmp(buf.s, "value=42"));
+
+    // force a growth
+    ok = sc_strbuf_appendf(&buf, " %s=%u", "other", 1234u);
+    assert(ok);
+
+    assert(!strcmp(buf.s, "value=42 other=1234"));
+    assert(buf.len == strlen(buf.s));
+
+    free(buf.s);
+}
+
 int main(int argc, char *argv[]) {
     (void) argc;
     (void) argv;
 
     test_strbuf_simple();
+    test_strbuf_appendf();
     return 0;
 }
@@ -0,0 +1,68 @@
+package com.genymobile.scrcpy;
+
+import android.annotation.TargetApi;
+import android.media.AudioFormat;
+import android.media.AudioRecord;
+import android.media.MediaRecorder;
+import android.os.Build;
+
+import java.nio.ByteBuffer;
+
+public final class AudioCapture {
+
+    public static final int SAMPLE_RATE = 48000;
+    public static final int CHANNELS = 2;
+    public static final int BYTES_PER_SAMPLE = 2; // PCM 16-bit
+
+    private AudioRecord recorder;
+
+    @TargetApi(Build.VERSION_CODES.M)
+    public void start() throws AudioCaptureException {
+        if (Build.VERSION.SDK_INT < Build.VERSION_CODES.Q) {
+            throw new AudioCaptureException("Audio capture requires Android 10");
+        }
+
+        // The server is not an app process, but some AudioRecord internals expect an application context
+        Workarounds.fillAppInfo();
+
+        AudioFormat format = new AudioFormat.Builder()
+                .setEncoding(AudioFormat.ENCODING_PCM_16BIT)
+                .setSampleRate(SAMPLE_RATE)
+                .setChannelMask(AudioFormat.CHANNEL_IN_STEREO)
+                .build();
+
+        int minBufferSize = AudioRecord.getMinBufferSize(SAMPLE_RATE, AudioFormat.CHANNEL_IN_STEREO, AudioFormat.ENCODING_PCM_16BIT);
+        if (minBufferSize <= 0) {
+            throw new AudioCaptureException("Could not get audio buffer size: " + minBufferSize);
+        }
+
+        try {
+            // REMOTE_SUBMIX captures the device audio output; the shell user holds the CAPTURE_AUDIO_OUTPUT permission
+            recorder = new AudioRecord.Builder()
+                    .setAudioSource(MediaRecorder.AudioSource.REMOTE_SUBMIX)
+                    .setAudioFormat(format)
+                    .setBufferSizeInBytes(8 * minBufferSize)
+                    .build();
+            recorder.startRecording();
+        } catch (RuntimeException e) {
+            if (recorder != null) {
+                recorder.release();
+                recorder = null;
+            }
+            throw new AudioCaptureException("Could not start audio capture", e);
+        }
+    }
+
+    public int read(ByteBuffer buffer, int size) {
+        // blocking read
+        return recorder.read(buffer, size);
+    }
+
+    public void stop() {
+        if (recorder != null) {
+            recorder.stop();
+            recorder.release();
+            recorder = null;
+        }
+    }
+}
@@ -0,0 +1,12 @@
+package com.genymobile.scrcpy;
+
+public class AudioCaptureException extends Exception {
+
+    public AudioCaptureException(String message) {
+        super(message);
+    }
+
+    public AudioCaptureException(String message, Throwable cause) {
+        super(message, cause);
+    }
+}
@@ -0,0 +1,127 @@
+package com.genymobile.scrcpy;
+
+import android.media.MediaCodec;
+import android.media.MediaFormat;
+
+import java.io.FileDescriptor;
+import java.io.IOException;
+import java.nio.ByteBuffer;
+
+public final class AudioEncoder {
+
+    private static final int BIT_RATE = 128000;
+    // read at most 20ms of samples per input buffer, to bound the capture-side latency
+    private static final int READ_SIZE = (AudioCapture.SAMPLE_RATE / 50) * AudioCapture.CHANNELS * AudioCapture.BYTES_PER_SAMPLE;
+
+    private static final long DEQUEUE_TIMEOUT_US = 10_000;
+
+    private static final long NO_PTS = -1;
+
+    private final DesktopConnection connection;
+    // audio packets are framed with an 8-byte PTS (NO_PTS for the codec config packet) followed by the 4-byte packet size
+    private final ByteBuffer headerBuffer = ByteBuffer.allocate(12);
+
+    private long ptsOrigin;
+
+    public AudioEncoder(DesktopConnection connection) {
+        this.connection = connection;
+    }
+
+    public Thread start() {
+        Thread thread = new Thread(new Runnable() {
+            @Override
+            public void run() {
+                encode();
+            }
+        }, "audio-encoder");
+        thread.start();
+        return thread;
+    }
+
+    private void encode() {
+        AudioCapture capture = new AudioCapture();
+        MediaCodec codec = null;
+        try {
+            capture.start();
+            codec = createCodec();
+            codec.start();
+            loop(codec, capture);
+        } catch (AudioCaptureException e) {
+            Ln.w("Audio disabled: " + e.getMessage());
+            // close the audio socket so that the client detects the absence of audio immediately
+            connection.shutdownAudio();
+        } catch (IOException e) {
+            // this is expected on close
+            Ln.d("Audio streaming stopped");
+        } catch (Exception e) {
+            Ln.e("Audio encoding failed", e);
+            connection.shutdownAudio();
+        } finally {
+            if (codec != null) {
+                codec.stop();
+                codec.release();
+            }
+            capture.stop();
+        }
+    }
+
+    private static MediaCodec createCodec() throws IOException {
+        MediaFormat format = new MediaFormat();
+        format.setString(MediaFormat.KEY_MIME, MediaFormat.MIMETYPE_AUDIO_OPUS);
+        format.setInteger(MediaFormat.KEY_BIT_RATE, BIT_RATE);
+        format.setInteger(MediaFormat.KEY_CHANNEL_COUNT, AudioCapture.CHANNELS);
+        format.setInteger(MediaFormat.KEY_SAMPLE_RATE, AudioCapture.SAMPLE_RATE);
+
+        MediaCodec codec = MediaCodec.createEncoderByType(MediaFormat.MIMETYPE_AUDIO_OPUS);
+        codec.configure(format, null, null, MediaCodec.CONFIGURE_FLAG_ENCODE);
+        return codec;
+    }
+
+    private void loop(MediaCodec codec, AudioCapture capture) throws IOException {
+        FileDescriptor fd = connection.getAudioFd();
+        MediaCodec.BufferInfo bufferInfo = new MediaCodec.BufferInfo();
+
+        while (true) {
+            int inputIndex = codec.dequeueInputBuffer(DEQUEUE_TIMEOUT_US);
+            if (inputIndex >= 0) {
+                ByteBuffer inputBuffer = codec.getInputBuffer(inputIndex);
+                int size = Math.min(inputBuffer.remaining(), READ_SIZE);
+                int r = capture.read(inputBuffer, size);
+                if (r <= 0) {
+                    throw new IOException("Could not read audio: " + r);
+                }
+                long pts = System.nanoTime() / 1000;
+                codec.queueInputBuffer(inputIndex, 0, r, pts, 0);
+            }
+
+            int outputIndex = codec.dequeueOutputBuffer(bufferInfo, DEQUEUE_TIMEOUT_US);
+            if (outputIndex >= 0) {
+                try {
+                    ByteBuffer codecBuffer = codec.getOutputBuffer(outputIndex);
+                    writePacket(fd, bufferInfo, codecBuffer);
+                } finally {
+                    codec.releaseOutputBuffer(outputIndex, false);
+                }
+            }
+        }
+    }
+
+    private void writePacket(FileDescriptor fd, MediaCodec.BufferInfo bufferInfo, ByteBuffer codecBuffer) throws IOException {
+        long pts;
+        if ((bufferInfo.flags & MediaCodec.BUFFER_FLAG_CODEC_CONFIG) != 0) {
+            pts = NO_PTS; // the config packet carries the OpusHead, not samples
+        } else {
+            if (ptsOrigin == 0) {
+                ptsOrigin = bufferInfo.presentationTimeUs;
+            }
+            pts = bufferInfo.presentationTimeUs - ptsOrigin;
+        }
+
+        headerBuffer.clear();
+        headerBuffer.putLong(pts);
+        headerBuffer.putInt(codecBuffer.remaining());
+        headerBuffer.flip();
+        // vectored write, the header and the payload leave in a single syscall
+        IO.writeFully(fd, headerBuffer, codecBuffer);
+    }
+}
@@ -8,6 +8,8 @@ import android.util.Base64;
 
 import java.io.File;
 import java.io.IOException;
+import java.util.ArrayList;
+import java.util.List;
 
 /**
  * Handle the cleanup of scrcpy, even if the main process is killed.
@@ -166,21 +168,21 @@ public final class CleanUp {
         if (config.disableShowTouches || config.restoreStayOn != -1) {
             ServiceManager serviceManager = new ServiceManager();
             Settings settings = new Settings(serviceManager);
+
+            // batch the restores so that the settings ContentProvider is acquired only once
+            List<Settings.Entry> batch = new ArrayList<>(2);
             if (config.disableShowTouches) {
                 Ln.i("Disabling \"show touches\"");
-                try {
-                    settings.putValue(Settings.TABLE_SYSTEM, "show_touches", "0");
-                } catch (SettingsException e) {
-                    Ln.e("Could not restore \"show_touches\"", e);
-                }
+                batch.add(new Settings.Entry(Settings.TABLE_SYSTEM, "show_touches", "0"));
             }
             if (config.restoreStayOn != -1) {
                 Ln.i("Restoring \"stay awake\"");
-                try {
-                    settings.putValue(Settings.TABLE_GLOBAL, "stay_on_while_plugged_in", String.valueOf(config.restoreStayOn));
-                } catch (SettingsException e) {
-                    Ln.e("Could not restore \"stay_on_while_plugged_in\"", e);
-                }
+                batch.add(new Settings.Entry(Settings.TABLE_GLOBAL, "stay_on_while_plugged_in", String.valueOf(config.restoreStayOn)));
+            }
+            try {
+                settings.putValues(batch);
+            } catch (SettingsException e) {
+                Ln.e("Could not restore settings", e);
             }
         }
 
@@ -1,5 +1,7 @@
 package com.genymobile.scrcpy;
 
+import android.graphics.Rect;
+
 /**
  * Union of all supported event types, identified by their {@code type}.
  */
@@ -17,6 +19,13 @@ public final class ControlMessage {
     public static final int TYPE_SET_CLIPBOARD = 9;
     public static final int TYPE_SET_SCREEN_POWER_MODE = 10;
     public static final int TYPE_ROTATE_DEVICE = 11;
+    public static final int TYPE_SET_MAX_SIZE = 12;
+    public static final int TYPE_SET_MAX_FPS = 13;
+    public static final int TYPE_SET_STREAM_PAUSED = 14;
+    public static final int TYPE_REQUEST_IDR = 15;
+    public static final int TYPE_SET_CROP = 16;
+    public static final int TYPE_CLOCK_SYNC = 17;
+    public static final int TYPE_SET_BITRATE = 18;
 
     public static final long SEQUENCE_INVALID = 0;
 
@@ -39,12 +48,59 @@ public final class ControlMessage {
     private boolean paste;
     private int repeat;
     private long sequence;
+    private long clientTime; // clock sync request timestamp, echoed back in the reply
+    private int maxSize;
+    private int maxFps;
+    private int bitRate;
+    private boolean paused;
+    private Rect crop; // may be null (restore the full screen)
+    // older positions coalesced into a touch move event (oldest first), with
+    // their ages in milliseconds relative to the event; may be null
+    private Position[] historyPositions;
+    private int[] historyAges;
+
+    // Pool handled messages (linked by "next") so that the steady-state input path is allocation-free
+    private static final int MAX_POOL_SIZE = 10;
+    private static ControlMessage pool;
+    private static int poolSize;
+
+    private ControlMessage next;
 
     private ControlMessage() {
     }
 
+    private static ControlMessage obtain() {
+        synchronized (ControlMessage.class) {
+            if (pool != null) {
+                ControlMessage msg = pool;
+                pool = msg.next;
+                msg.next = null;
+                --poolSize;
+                return msg;
+            }
+        }
+        return new ControlMessage();
+    }
+
+    /**
+     * Return this message to the pool (it must not be used afterwards).
+     */
+    public void recycle() {
+        // do not keep references alive from the pool
+        text = null;
+        position = null;
+        crop = null;
+        synchronized (ControlMessage.class) {
+            if (poolSize < MAX_POOL_SIZE) {
+                next = pool;
+                pool = this;
+                ++poolSize;
+            }
+        }
+    }
+
     public static ControlMessage createInjectKeycode(int action, int keycode, int repeat, int metaState) {
-        ControlMessage msg = new ControlMessage();
+        ControlMessage msg = obtain();
         msg.type = TYPE_INJECT_KEYCODE;
         msg.action = action;
         msg.keycode = keycode;
@@ -54,25 +110,28 @@ public final class ControlMessage {
     }
 
     public static ControlMessage createInjectText(String text) {
-        ControlMessage msg = new ControlMessage();
+        ControlMessage msg = obtain();
         msg.type = TYPE_INJECT_TEXT;
         msg.text = text;
         return msg;
     }
 
-    public static ControlMessage createInjectTouchEvent(int action, long pointerId, Position position, float pressure, int buttons) {
-        ControlMessage msg = new ControlMessage();
+    public static ControlMessage createInjectTouchEvent(int action, long pointerId, Position position, float pressure, int buttons,
+            Position[] historyPositions, int[] historyAges) {
+        ControlMessage msg = obtain();
         msg.type = TYPE_INJECT_TOUCH_EVENT;
         msg.action = action;
         msg.pointerId = pointerId;
         msg.pressure = pressure;
         msg.position = position;
         msg.buttons = buttons;
+        msg.historyPositions = historyPositions;
+        msg.historyAges = historyAges;
         return msg;
     }
 
     public static ControlMessage createInjectScrollEvent(Position position, int hScroll, int vScroll) {
-        ControlMessage msg = new ControlMessage();
+        ControlMessage msg = obtain();
         msg.type = TYPE_INJECT_SCROLL_EVENT;
         msg.position = position;
         msg.hScroll = hScroll;
@@ -81,21 +140,21 @@ public final class ControlMessage {
     }
 
     public static ControlMessage createBackOrScreenOn(int action) {
-        ControlMessage msg = new ControlMessage();
+        ControlMessage msg = obtain();
         msg.type = TYPE_BACK_OR_SCREEN_ON;
         msg.action = action;
         return msg;
     }
 
     public static ControlMessage createGetClipboard(int copyKey) {
-        ControlMessage msg = new ControlMessage();
+        ControlMessage msg = obtain();
         msg.type = TYPE_GET_CLIPBOARD;
         msg.copyKey = copyKey;
         return msg;
     }
 
     public static ControlMessage createSetClipboard(long sequence, String text, boolean paste) {
-        ControlMessage msg = new ControlMessage();
+        ControlMessage msg = obtain();
         msg.type = TYPE_SET_CLIPBOARD;
         msg.sequence = sequence;
         msg.text = text;
@@ -107,14 +166,71 @@ public final class ControlMessage {
      * @param mode one of the {@code Device.SCREEN_POWER_MODE_*} constants
      */
     public static ControlMessage createSetScreenPowerMode(int mode) {
-        ControlMessage msg = new ControlMessage();
+        ControlMessage msg = obtain();
         msg.type = TYPE_SET_SCREEN_POWER_MODE;
         msg.action = mode;
         return msg;
     }
 
+    /**
+     * @param maxSize the new maximum dimension of the video stream (0 for no limit), must be a multiple of 8
+     */
+    public static ControlMessage createSetMaxSize(int maxSize) {
+        ControlMessage msg = obtain();
+        msg.type = TYPE_SET_MAX_SIZE;
+        msg.maxSize = maxSize;
+        return msg;
+    }
+
+    /**
+     * @param maxFps the new maximum frame rate of the video stream (0 for no limit)
+     */
+    public static ControlMessage createSetMaxFps(int maxFps) {
+        ControlMessage msg = obtain();
+        msg.type = TYPE_SET_MAX_FPS;
+        msg.maxFps = maxFps;
+        return msg;
+    }
+
+    /**
+     * @param paused whether the video encoder must stop (true) or restart (false) producing frames
+     */
+    public static ControlMessage createSetStreamPaused(boolean paused) {
+        ControlMessage msg = obtain();
+        msg.type = TYPE_SET_STREAM_PAUSED;
+        msg.paused = paused;
+        return msg;
+    }
+
+    /**
+     * @param crop the new region of interest to stream (in the natural device orientation), or null to restore the full screen
+     */
+    public static ControlMessage createSetCrop(Rect crop) {
+        ControlMessage msg = obtain();
+        msg.type = TYPE_SET_CROP;
+        msg.crop = crop;
+        return msg;
+    }
+
+    /**
+     * @param bitRate the new video bitrate, in bits per second
+     */
+    public static ControlMessage createSetBitRate(int bitRate) {
+        ControlMessage msg = obtain();
+        msg.type = TYPE_SET_BITRATE;
+        msg.bitRate = bitRate;
+        return msg;
+    }
+
+    public static ControlMessage createClockSync(long clientTime) {
+        ControlMessage msg = obtain();
+        msg.type = TYPE_CLOCK_SYNC;
+        msg.clientTime = clientTime;
+        return msg;
+    }
+
     public static ControlMessage createEmpty(int type) {
-        ControlMessage msg = new ControlMessage();
+        ControlMessage msg = obtain();
         msg.type = type;
         return msg;
     }
@@ -139,6 +255,14 @@ public final class ControlMessage {
         return keycode;
     }
 
+    public Position[] getHistoryPositions() {
+        return historyPositions;
+    }
+
+    public int[] getHistoryAges() {
+        return historyAges;
+    }
+
     public int getButtons() {
         return buttons;
     }
@@ -178,4 +302,28 @@ public final class ControlMessage {
     public long getSequence() {
         return sequence;
     }
+
+    public long getClientTime() {
+        return clientTime;
+    }
+
+    public int getMaxSize() {
+        return maxSize;
+    }
+
+    public int getMaxFps() {
+        return maxFps;
+    }
+
+    public int getBitRate() {
+        return bitRate;
+    }
+
+    public boolean isPaused() {
+        return paused;
+    }
+
+    public Rect getCrop() {
+        return crop;
+    }
 }
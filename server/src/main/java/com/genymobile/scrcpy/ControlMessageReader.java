@@ -1,24 +1,36 @@
 package com.genymobile.scrcpy;
 
+import android.graphics.Rect;
+
 import java.io.EOFException;
 import java.io.IOException;
 import java.io.InputStream;
 import java.nio.ByteBuffer;
 import java.nio.charset.StandardCharsets;
+import java.util.zip.DataFormatException;
+import java.util.zip.Inflater;
 
 public class ControlMessageReader {
 
     static final int INJECT_KEYCODE_PAYLOAD_LENGTH = 13;
-    static final int INJECT_TOUCH_EVENT_PAYLOAD_LENGTH = 27;
+    static final int INJECT_TOUCH_EVENT_PAYLOAD_LENGTH = 28;
+    static final int TOUCH_HISTORY_ENTRY_LENGTH = 14; // position + age in ms
     static final int INJECT_SCROLL_EVENT_PAYLOAD_LENGTH = 20;
     static final int BACK_OR_SCREEN_ON_LENGTH = 1;
     static final int SET_SCREEN_POWER_MODE_PAYLOAD_LENGTH = 1;
     static final int GET_CLIPBOARD_LENGTH = 1;
-    static final int SET_CLIPBOARD_FIXED_PAYLOAD_LENGTH = 9;
+    static final int SET_CLIPBOARD_FIXED_PAYLOAD_LENGTH = 10;
+    static final int SET_MAX_SIZE_PAYLOAD_LENGTH = 2;
+    static final int SET_MAX_FPS_PAYLOAD_LENGTH = 2;
+    static final int SET_STREAM_PAUSED_PAYLOAD_LENGTH = 1;
+    static final int SET_CROP_PAYLOAD_LENGTH = 8;
+    static final int CLOCK_SYNC_PAYLOAD_LENGTH = 8;
+    static final int SET_BITRATE_PAYLOAD_LENGTH = 4;
 
     private static final int MESSAGE_MAX_SIZE = 1 << 18; // 256k
 
-    public static final int CLIPBOARD_TEXT_MAX_LENGTH = MESSAGE_MAX_SIZE - 14; // type: 1 byte; sequence: 8 bytes; paste flag: 1 byte; length: 4 bytes
+    public static final int CLIPBOARD_TEXT_MAX_LENGTH = MESSAGE_MAX_SIZE - 15; // type: 1 byte; sequence: 8 bytes; paste flag: 1 byte; compressed flag: 1
+                                                                               // byte; length: 4 bytes
     public static final int INJECT_TEXT_MAX_LENGTH = 300;
 
     private final byte[] rawBuffer = new byte[MESSAGE_MAX_SIZE];
@@ -80,10 +92,29 @@ public class ControlMessageReader {
             case ControlMessage.TYPE_SET_SCREEN_POWER_MODE:
                 msg = parseSetScreenPowerMode();
                 break;
+            case ControlMessage.TYPE_SET_MAX_SIZE:
+                msg = parseSetMaxSize();
+                break;
+            case ControlMessage.TYPE_SET_MAX_FPS:
+                msg = parseSetMaxFps();
+                break;
+            case ControlMessage.TYPE_SET_STREAM_PAUSED:
+                msg = parseSetStreamPaused();
+                break;
+            case ControlMessage.TYPE_SET_CROP:
+                msg = parseSetCrop();
+                break;
+            case ControlMessage.TYPE_CLOCK_SYNC:
+                msg = parseClockSync();
+                break;
+            case ControlMessage.TYPE_SET_BITRATE:
+                msg = parseSetBitRate();
+                break;
             case ControlMessage.TYPE_EXPAND_NOTIFICATION_PANEL:
             case ControlMessage.TYPE_EXPAND_SETTINGS_PANEL:
             case ControlMessage.TYPE_COLLAPSE_PANELS:
             case ControlMessage.TYPE_ROTATE_DEVICE:
+            case ControlMessage.TYPE_REQUEST_IDR:
                 msg = ControlMessage.createEmpty(type);
                 break;
             default:
@@ -144,7 +175,21 @@ public class ControlMessageReader {
         // convert it to a float between 0 and 1 (0x1p16f is 2^16 as float)
         float pressure = pressureInt == 0xffff ? 1f : (pressureInt / 0x1p16f);
         int buttons = buffer.getInt();
-        return ControlMessage.createInjectTouchEvent(action, pointerId, position, pressure, buttons);
+        int historyCount = toUnsigned(buffer.get());
+        if (buffer.remaining() < historyCount * TOUCH_HISTORY_ENTRY_LENGTH) {
+            return null;
+        }
+        Position[] historyPositions = null;
+        int[] historyAges = null;
+        if (historyCount > 0) {
+            historyPositions = new Position[historyCount];
+            historyAges = new int[historyCount];
+            for (int i = 0; i < historyCount; ++i) {
+                historyPositions[i] = readPosition(buffer);
+                historyAges[i] = toUnsigned(buffer.getShort());
+            }
+        }
+        return ControlMessage.createInjectTouchEvent(action, pointerId, position, pressure, buttons, historyPositions, historyAges);
     }
 
     private ControlMessage parseInjectScrollEvent() {
@@ -179,13 +224,49 @@ public class ControlMessageReader {
         }
         long sequence = buffer.getLong();
         boolean paste = buffer.get() != 0;
-        String text = parseString();
+        boolean compressed = buffer.get() != 0;
+        String text = compressed ? parseDeflatedString() : parseString();
         if (text == null) {
             return null;
         }
         return ControlMessage.createSetClipboard(sequence, text, paste);
     }
 
+    private String parseDeflatedString() {
+        if (buffer.remaining() < 4) {
+            return null;
+        }
+        int len = buffer.getInt();
+        // the payload is the uncompressed length (4 bytes) followed by a zlib stream
+        if (len < 4 || buffer.remaining() < len) {
+            return null;
+        }
+        int uncompressedLen = buffer.getInt();
+        if (uncompressedLen < 0 || uncompressedLen > CLIPBOARD_TEXT_MAX_LENGTH) {
+            Ln.w("Invalid clipboard length: " + uncompressedLen);
+            return null;
+        }
+        int position = buffer.position();
+        buffer.position(position + len - 4);
+
+        Inflater inflater = new Inflater();
+        try {
+            inflater.setInput(rawBuffer, position, len - 4);
+            byte[] uncompressed = new byte[uncompressedLen];
+            int r = inflater.inflate(uncompressed);
+            if (r != uncompressedLen || !inflater.finished()) {
+                Ln.w("Could not uncompress clipboard text");
+                return null;
+            }
+            return new String(uncompressed, StandardCharsets.UTF_8);
+        } catch (DataFormatException e) {
+            Ln.w("Could not uncompress clipboard text", e);
+            return null;
+        } finally {
+            inflater.end();
+        }
+    }
+
     private ControlMessage parseSetScreenPowerMode() {
         if (buffer.remaining() < SET_SCREEN_POWER_MODE_PAYLOAD_LENGTH) {
             return null;
@@ -194,6 +275,59 @@ public class ControlMessageReader {
         return ControlMessage.createSetScreenPowerMode(mode);
     }
 
+    private ControlMessage parseSetMaxSize() {
+        if (buffer.remaining() < SET_MAX_SIZE_PAYLOAD_LENGTH) {
+            return null;
+        }
+        int maxSize = toUnsigned(buffer.getShort());
+        return ControlMessage.createSetMaxSize(maxSize);
+    }
+
+    private ControlMessage parseSetMaxFps() {
+        if (buffer.remaining() < SET_MAX_FPS_PAYLOAD_LENGTH) {
+            return null;
+        }
+        int maxFps = toUnsigned(buffer.getShort());
+        return ControlMessage.createSetMaxFps(maxFps);
+    }
+
+    private ControlMessage parseSetStreamPaused() {
+        if (buffer.remaining() < SET_STREAM_PAUSED_PAYLOAD_LENGTH) {
+            return null;
+        }
+        boolean paused = buffer.get() != 0;
+        return ControlMessage.createSetStreamPaused(paused);
+    }
+
+    private ControlMessage parseSetCrop() {
+        if (buffer.remaining() < SET_CROP_PAYLOAD_LENGTH) {
+            return null;
+        }
+        int width = toUnsigned(buffer.getShort());
+        int height = toUnsigned(buffer.getShort());
+        int x = toUnsigned(buffer.getShort());
+        int y = toUnsigned(buffer.getShort());
+        // an empty rectangle restores the full screen
+        Rect crop = width > 0 && height > 0 ? new Rect(x, y, x + width, y + height) : null;
+        return ControlMessage.createSetCrop(crop);
+    }
+
+    private ControlMessage parseSetBitRate() {
+        if (buffer.remaining() < SET_BITRATE_PAYLOAD_LENGTH) {
+            return null;
+        }
+        int bitRate = buffer.getInt();
+        return ControlMessage.createSetBitRate(bitRate);
+    }
+
+    private ControlMessage parseClockSync() {
+        if (buffer.remaining() < CLOCK_SYNC_PAYLOAD_LENGTH) {
+            return null;
+        }
+        long clientTime = buffer.getLong();
+        return ControlMessage.createClockSync(clientTime);
+    }
+
     private static Position readPosition(ByteBuffer buffer) {
         int x = buffer.getInt();
         int y = buffer.getInt();
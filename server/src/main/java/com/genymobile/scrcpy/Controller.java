@@ -8,6 +8,8 @@ import android.view.KeyEvent;
 import android.view.MotionEvent;
 
 import java.io.IOException;
+import java.util.concurrent.ArrayBlockingQueue;
+import java.util.concurrent.BlockingQueue;
 import java.util.concurrent.Executors;
 import java.util.concurrent.ScheduledExecutorService;
 import java.util.concurrent.TimeUnit;
@@ -25,6 +27,12 @@ public class Controller {
 
     private final KeyCharacterMap charMap = KeyCharacterMap.load(KeyCharacterMap.VIRTUAL_KEYBOARD);
 
+    // Injection may block in a binder call to the InputManager (for hundreds of milliseconds during UI jank), so messages are parsed on a
+    // dedicated thread and handled from this queue: intake never backs up into the kernel socket buffer. When the queue is full, the reader
+    // blocks, which is the expected backpressure.
+    private static final int QUEUE_CAPACITY = 64;
+    private final BlockingQueue<ControlMessage> queue = new ArrayBlockingQueue<>(QUEUE_CAPACITY);
+
     private long lastTouchDown;
     private final PointersState pointersState = new PointersState();
     private final MotionEvent.PointerProperties[] pointerProperties = new MotionEvent.PointerProperties[PointersState.MAX_POINTERS];
@@ -32,6 +40,11 @@ public class Controller {
 
     private boolean keepPowerModeOff;
 
+    // injection is asynchronous; failures are counted and reported to the client in batches, at most one message per second
+    private static final long INJECT_FAILURE_REPORT_INTERVAL_MS = 1000;
+    private int injectFailureCount;
+    private long lastInjectFailureReport;
+
     public Controller(Device device, DesktopConnection connection, boolean clipboardAutosync) {
         this.device = device;
         this.connection = connection;
@@ -69,8 +82,36 @@ public class Controller {
             SystemClock.sleep(500);
         }
 
-        while (true) {
-            handleEvent();
+        final Thread handlerThread = Thread.currentThread();
+        Thread reader = new Thread(new Runnable() {
+            @Override
+            public void run() {
+                try {
+                    while (true) {
+                        ControlMessage msg = connection.receiveControlMessage();
+                        queue.put(msg);
+                    }
+                } catch (IOException e) {
+                    // this is expected on close
+                } catch (InterruptedException e) {
+                    // the server is stopping
+                }
+                // unblock the handler waiting on the queue
+                handlerThread.interrupt();
+            }
+        });
+        reader.setDaemon(true);
+        reader.start();
+
+        try {
+            while (true) {
+                handleEvent(queue.take());
+            }
+        } catch (InterruptedException e) {
+            // the reader stopped, or the server is stopping
+            throw new IOException("Control socket closed", e);
+        } finally {
+            reader.interrupt();
         }
     }
 
@@ -78,12 +119,23 @@ public class Controller {
         return sender;
     }
 
-    private void handleEvent() throws IOException {
-        ControlMessage msg = connection.receiveControlMessage();
+    private void onInjectFailure() {
+        ++injectFailureCount;
+        long now = SystemClock.uptimeMillis();
+        if (now - lastInjectFailureReport >= INJECT_FAILURE_REPORT_INTERVAL_MS) {
+            sender.pushInjectFailures(injectFailureCount);
+            injectFailureCount = 0;
+            lastInjectFailureReport = now;
+        }
+    }
+
+    private void handleEvent(ControlMessage msg) {
         switch (msg.getType()) {
             case ControlMessage.TYPE_INJECT_KEYCODE:
                 if (device.supportsInputEvents()) {
-                    injectKeycode(msg.getAction(), msg.getKeycode(), msg.getRepeat(), msg.getMetaState());
+                    if (!injectKeycode(msg.getAction(), msg.getKeycode(), msg.getRepeat(), msg.getMetaState())) {
+                        onInjectFailure();
+                    }
                 }
                 break;
             case ControlMessage.TYPE_INJECT_TEXT:
@@ -93,12 +145,17 @@ public class Controller {
                 break;
             case ControlMessage.TYPE_INJECT_TOUCH_EVENT:
                 if (device.supportsInputEvents()) {
-                    injectTouch(msg.getAction(), msg.getPointerId(), msg.getPosition(), msg.getPressure(), msg.getButtons());
+                    if (!injectTouch(msg.getAction(), msg.getPointerId(), msg.getPosition(), msg.getPressure(), msg.getButtons(),
+                            msg.getHistoryPositions(), msg.getHistoryAges())) {
+                        onInjectFailure();
+                    }
                 }
                 break;
             case ControlMessage.TYPE_INJECT_SCROLL_EVENT:
                 if (device.supportsInputEvents()) {
-                    injectScroll(msg.getPosition(), msg.getHScroll(), msg.getVScroll());
+                    if (!injectScroll(msg.getPosition(), msg.getHScroll(), msg.getVScroll())) {
+                        onInjectFailure();
+                    }
                 }
                 break;
             case ControlMessage.TYPE_BACK_OR_SCREEN_ON:
@@ -134,9 +191,34 @@ public class Controller {
             case ControlMessage.TYPE_ROTATE_DEVICE:
                 Device.rotateDevice();
                 break;
+            case ControlMessage.TYPE_SET_MAX_SIZE:
+                device.setMaxSize(msg.getMaxSize());
+                break;
+            case ControlMessage.TYPE_SET_MAX_FPS:
+                device.setMaxFps(msg.getMaxFps());
+                break;
+            case ControlMessage.TYPE_SET_BITRATE:
+                device.setBitRate(msg.getBitRate());
+                break;
+            case ControlMessage.TYPE_SET_STREAM_PAUSED:
+                device.setStreamPaused(msg.isPaused());
+                break;
+            case ControlMessage.TYPE_REQUEST_IDR:
+                device.requestIdr();
+                break;
+            case ControlMessage.TYPE_SET_CROP:
+                device.setCrop(msg.getCrop());
+                break;
+            case ControlMessage.TYPE_CLOCK_SYNC: {
+                // Express the device timestamp in the same base as the frame PTS (MediaCodec timestamps the frames with System.nanoTime())
+                long deviceTime = System.nanoTime() / 1000 - ScreenEncoder.getClockPtsOrigin();
+                sender.pushClockSync(msg.getClientTime(), deviceTime);
+                break;
+            }
             default:
                 // do nothing
         }
+        msg.recycle();
     }
 
     private boolean injectKeycode(int action, int keycode, int repeat, int metaState) {
@@ -173,7 +255,8 @@ public class Controller {
         return successCount;
     }
 
-    private boolean injectTouch(int action, long pointerId, Position position, float pressure, int buttons) {
+    private boolean injectTouch(int action, long pointerId, Position position, float pressure, int buttons, Position[] historyPositions,
+            int[] historyAges) {
         long now = SystemClock.uptimeMillis();
 
         Point point = device.getPhysicalPoint(position);
@@ -215,10 +298,46 @@ public class Controller {
             buttons = 0;
         }
 
-        MotionEvent event = MotionEvent
-                .obtain(lastTouchDown, now, action, pointerCount, pointerProperties, pointerCoords, 0, buttons, 1f, 1f, DEFAULT_DEVICE_ID, 0, source,
-                        0);
-        return device.injectEvent(event, Device.INJECT_MODE_ASYNC);
+        MotionEvent event = null;
+        if (action == MotionEvent.ACTION_MOVE && historyPositions != null) {
+            // Inject the coalesced positions as a single batched event
+            // (oldest sample first), so the device resamples the full motion
+            // instead of seeing one big jump
+            MotionEvent.PointerCoords coords = pointerCoords[pointerIndex];
+            float headX = coords.x;
+            float headY = coords.y;
+            for (int i = 0; i < historyPositions.length; ++i) {
+                Point historyPoint = device.getPhysicalPoint(historyPositions[i]);
+                if (historyPoint == null) {
+                    // generated for a different device size, skip the sample
+                    continue;
+                }
+                coords.x = historyPoint.x;
+                coords.y = historyPoint.y;
+                long eventTime = now - historyAges[i];
+                if (event == null) {
+                    event = MotionEvent
+                            .obtain(lastTouchDown, eventTime, action, pointerCount, pointerProperties, pointerCoords, 0, buttons, 1f, 1f,
+                                    DEFAULT_DEVICE_ID, 0, source, 0);
+                } else {
+                    event.addBatch(eventTime, pointerCoords, 0);
+                }
+            }
+            coords.x = headX;
+            coords.y = headY;
+            if (event != null) {
+                event.addBatch(now, pointerCoords, 0);
+            }
+        }
+        if (event == null) {
+            event = MotionEvent
+                    .obtain(lastTouchDown, now, action, pointerCount, pointerProperties, pointerCoords, 0, buttons, 1f, 1f, DEFAULT_DEVICE_ID, 0,
+                            source, 0);
+        }
+        boolean ok = device.injectEvent(event, Device.INJECT_MODE_ASYNC);
+        // the event has been copied for injection, return it to the framework pool
+        event.recycle();
+        return ok;
     }
 
     private boolean injectScroll(Position position, int hScroll, int vScroll) {
@@ -241,7 +360,10 @@ public class Controller {
         MotionEvent event = MotionEvent
                 .obtain(lastTouchDown, now, MotionEvent.ACTION_SCROLL, 1, pointerProperties, pointerCoords, 0, 0, 1f, 1f, DEFAULT_DEVICE_ID, 0,
                         InputDevice.SOURCE_MOUSE, 0);
-        return device.injectEvent(event, Device.INJECT_MODE_ASYNC);
+        boolean ok = device.injectEvent(event, Device.INJECT_MODE_ASYNC);
+        // the event has been copied for injection, return it to the framework pool
+        event.recycle();
+        return ok;
     }
 
     /**
@@ -299,6 +421,8 @@ public class Controller {
         if (ok) {
             Ln.i("Device clipboard set");
         }
+        // either way, the client knows this content, a later identical change needs no push
+        sender.recordClipboardText(text);
 
         // On Android >= 7, also press the PASTE key if requested
         if (paste && Build.VERSION.SDK_INT >= Build.VERSION_CODES.N && device.supportsInputEvents()) {
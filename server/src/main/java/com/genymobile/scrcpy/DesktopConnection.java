@@ -3,36 +3,90 @@ package com.genymobile.scrcpy;
 import android.net.LocalServerSocket;
 import android.net.LocalSocket;
 import android.net.LocalSocketAddress;
+import android.os.ParcelFileDescriptor;
 
 import java.io.Closeable;
 import java.io.FileDescriptor;
 import java.io.IOException;
 import java.io.InputStream;
 import java.io.OutputStream;
+import java.net.ServerSocket;
+import java.net.Socket;
+import java.nio.ByteBuffer;
 import java.nio.charset.StandardCharsets;
+import java.util.List;
 
 public final class DesktopConnection implements Closeable {
 
     private static final int DEVICE_NAME_FIELD_LENGTH = 64;
 
+    // The device meta handshake is a versioned TLV block, sent in a single write: 1 byte version, 2 bytes payload length, then entries of
+    // 1 byte type + 2 bytes length + value. The client skips unknown entry types, so new capabilities do not cost a protocol round-trip.
+    private static final int DEVICE_META_VERSION = 1;
+
+    private static final int META_TYPE_DEVICE_NAME = 1;
+    private static final int META_TYPE_VIDEO_SIZE = 2;
+    private static final int META_TYPE_SECONDARY_VIDEO_SIZES = 3;
+    private static final int META_TYPE_DENSITY = 4;
+    private static final int META_TYPE_FEATURES = 5;
+
+    // features advertised to the client
+    private static final int FEATURE_REQUEST_IDR = 1;
+    private static final int FEATURE_STREAM_PAUSE = 1 << 1;
+    private static final int FEATURE_INJECT_FAILURES = 1 << 2;
+
     private static final String SOCKET_NAME = "scrcpy";
 
     private final LocalSocket videoSocket;
     private final FileDescriptor videoFd;
 
+    // null if audio is disabled
+    private final LocalSocket audioSocket;
+    private final FileDescriptor audioFd;
+
     private final LocalSocket controlSocket;
     private final InputStream controlInputStream;
     private final OutputStream controlOutputStream;
 
+    // in direct TCP mode (listen_port), the sockets are plain TCP sockets
+    private final Socket videoTcpSocket;
+    private final Socket audioTcpSocket;
+    private final Socket controlTcpSocket;
+    // own the socket file descriptors in direct TCP mode
+    private final ParcelFileDescriptor videoPfd;
+    private final ParcelFileDescriptor audioPfd;
+
     private final ControlMessageReader reader = new ControlMessageReader();
     private final DeviceMessageWriter writer = new DeviceMessageWriter();
 
-    private DesktopConnection(LocalSocket videoSocket, LocalSocket controlSocket) throws IOException {
+    private DesktopConnection(LocalSocket videoSocket, LocalSocket audioSocket, LocalSocket controlSocket) throws IOException {
         this.videoSocket = videoSocket;
+        this.audioSocket = audioSocket;
         this.controlSocket = controlSocket;
+        this.videoTcpSocket = null;
+        this.audioTcpSocket = null;
+        this.controlTcpSocket = null;
+        this.videoPfd = null;
+        this.audioPfd = null;
         controlInputStream = controlSocket.getInputStream();
         controlOutputStream = controlSocket.getOutputStream();
         videoFd = videoSocket.getFileDescriptor();
+        audioFd = audioSocket != null ? audioSocket.getFileDescriptor() : null;
+    }
+
+    private DesktopConnection(Socket videoTcpSocket, Socket audioTcpSocket, Socket controlTcpSocket) throws IOException {
+        this.videoSocket = null;
+        this.audioSocket = null;
+        this.controlSocket = null;
+        this.videoTcpSocket = videoTcpSocket;
+        this.audioTcpSocket = audioTcpSocket;
+        this.controlTcpSocket = controlTcpSocket;
+        this.videoPfd = ParcelFileDescriptor.fromSocket(videoTcpSocket);
+        this.audioPfd = audioTcpSocket != null ? ParcelFileDescriptor.fromSocket(audioTcpSocket) : null;
+        controlInputStream = controlTcpSocket.getInputStream();
+        controlOutputStream = controlTcpSocket.getOutputStream();
+        videoFd = videoPfd.getFileDescriptor();
+        audioFd = audioPfd != null ? audioPfd.getFileDescriptor() : null;
     }
 
     private static LocalSocket connect(String abstractName) throws IOException {
@@ -41,18 +95,59 @@ public final class DesktopConnection implements Closeable {
         return localSocket;
     }
 
-    public static DesktopConnection open(Device device, boolean tunnelForward) throws IOException {
+    public static DesktopConnection open(boolean tunnelForward, int listenPort, boolean audio) throws IOException {
+        if (listenPort > 0) {
+            // Direct TCP mode: listen on all interfaces, the client connects straight to the device, without the adb forwarder on the data path.
+            // The connection is neither authenticated nor encrypted, the client only enables it explicitly for trusted networks.
+            ServerSocket serverSocket = new ServerSocket(listenPort);
+            try {
+                // this marker is parsed by the client to connect as soon as the socket is listening, without polling; do not change it
+                Ln.i("Listening on scrcpy socket");
+                Socket videoSocket = serverSocket.accept();
+                videoSocket.setTcpNoDelay(true);
+                // send one byte so the client may read() to detect a connection error
+                videoSocket.getOutputStream().write(0);
+                Socket audioSocket = null;
+                Socket controlSocket;
+                try {
+                    if (audio) {
+                        audioSocket = serverSocket.accept();
+                    }
+                    controlSocket = serverSocket.accept();
+                    controlSocket.setTcpNoDelay(true);
+                } catch (IOException | RuntimeException e) {
+                    if (audioSocket != null) {
+                        audioSocket.close();
+                    }
+                    videoSocket.close();
+                    throw e;
+                }
+                return new DesktopConnection(videoSocket, audioSocket, controlSocket);
+            } finally {
+                serverSocket.close();
+            }
+        }
+
         LocalSocket videoSocket;
+        LocalSocket audioSocket = null;
         LocalSocket controlSocket;
         if (tunnelForward) {
             LocalServerSocket localServerSocket = new LocalServerSocket(SOCKET_NAME);
+            // this marker is parsed by the client to connect as soon as the socket is listening, without polling; do not change it
+            Ln.i("Listening on scrcpy socket");
             try {
                 videoSocket = localServerSocket.accept();
                 // send one byte so the client may read() to detect a connection error
                 videoSocket.getOutputStream().write(0);
                 try {
+                    if (audio) {
+                        audioSocket = localServerSocket.accept();
+                    }
                     controlSocket = localServerSocket.accept();
                 } catch (IOException | RuntimeException e) {
+                    if (audioSocket != null) {
+                        audioSocket.close();
+                    }
                     videoSocket.close();
                     throw e;
                 }
@@ -62,47 +157,119 @@ public final class DesktopConnection implements Closeable {
         } else {
             videoSocket = connect(SOCKET_NAME);
             try {
+                if (audio) {
+                    audioSocket = connect(SOCKET_NAME);
+                }
                 controlSocket = connect(SOCKET_NAME);
             } catch (IOException | RuntimeException e) {
+                if (audioSocket != null) {
+                    audioSocket.close();
+                }
                 videoSocket.close();
                 throw e;
             }
         }
 
-        DesktopConnection connection = new DesktopConnection(videoSocket, controlSocket);
-        Size videoSize = device.getScreenInfo().getVideoSize();
-        connection.send(Device.getDeviceName(), videoSize.getWidth(), videoSize.getHeight());
-        return connection;
+        return new DesktopConnection(videoSocket, audioSocket, controlSocket);
+    }
+
+    public void sendDeviceMeta(Device device, Device[] secondaryDevices, Size videoSizeOverride) throws IOException {
+        Size videoSize = videoSizeOverride != null ? videoSizeOverride : device.getScreenInfo().getVideoSize();
+        Size[] secondaryVideoSizes = new Size[secondaryDevices.length];
+        for (int i = 0; i < secondaryDevices.length; ++i) {
+            secondaryVideoSizes[i] = secondaryDevices[i].getScreenInfo().getVideoSize();
+        }
+        send(Device.getDeviceName(), videoSize.getWidth(), videoSize.getHeight(), secondaryVideoSizes, device.getDensityDpi());
     }
 
     public void close() throws IOException {
+        if (videoTcpSocket != null) {
+            videoPfd.close();
+            videoTcpSocket.close();
+            if (audioPfd != null) {
+                audioPfd.close();
+                audioTcpSocket.close();
+            }
+            controlTcpSocket.close();
+            return;
+        }
         videoSocket.shutdownInput();
         videoSocket.shutdownOutput();
         videoSocket.close();
+        if (audioSocket != null) {
+            audioSocket.shutdownInput();
+            audioSocket.shutdownOutput();
+            audioSocket.close();
+        }
         controlSocket.shutdownInput();
         controlSocket.shutdownOutput();
         controlSocket.close();
     }
 
-    private void send(String deviceName, int width, int height) throws IOException {
-        byte[] buffer = new byte[DEVICE_NAME_FIELD_LENGTH + 4];
+    // Close the audio stream, so that the client immediately detects that audio is disabled (without ending the session)
+    public void shutdownAudio() {
+        try {
+            if (audioTcpSocket != null) {
+                audioTcpSocket.shutdownOutput();
+            } else if (audioSocket != null) {
+                audioSocket.shutdownOutput();
+            }
+        } catch (IOException e) {
+            Ln.w("Could not shutdown audio socket: " + e.getMessage());
+        }
+    }
 
+    private void send(String deviceName, int width, int height, Size[] secondaryVideoSizes, int densityDpi) throws IOException {
         byte[] deviceNameBytes = deviceName.getBytes(StandardCharsets.UTF_8);
-        int len = StringUtils.getUtf8TruncationIndex(deviceNameBytes, DEVICE_NAME_FIELD_LENGTH - 1);
-        System.arraycopy(deviceNameBytes, 0, buffer, 0, len);
-        // byte[] are always 0-initialized in java, no need to set '\0' explicitly
-
-        buffer[DEVICE_NAME_FIELD_LENGTH] = (byte) (width >> 8);
-        buffer[DEVICE_NAME_FIELD_LENGTH + 1] = (byte) width;
-        buffer[DEVICE_NAME_FIELD_LENGTH + 2] = (byte) (height >> 8);
-        buffer[DEVICE_NAME_FIELD_LENGTH + 3] = (byte) height;
-        IO.writeFully(videoFd, buffer, 0, buffer.length);
+        int nameLen = StringUtils.getUtf8TruncationIndex(deviceNameBytes, DEVICE_NAME_FIELD_LENGTH - 1);
+
+        // 3 bytes of header, then 5 entries of 3 bytes of type+length each plus their values
+        ByteBuffer buffer = ByteBuffer.allocate(3 + 5 * 3 + nameLen + 4 + 4 * secondaryVideoSizes.length + 2 + 4);
+        buffer.position(3); // the header is written once the payload length is known
+
+        buffer.put((byte) META_TYPE_DEVICE_NAME);
+        buffer.putShort((short) nameLen);
+        buffer.put(deviceNameBytes, 0, nameLen);
+
+        buffer.put((byte) META_TYPE_VIDEO_SIZE);
+        buffer.putShort((short) 4);
+        buffer.putShort((short) width);
+        buffer.putShort((short) height);
+
+        if (secondaryVideoSizes.length > 0) {
+            // one initial size per secondary display
+            buffer.put((byte) META_TYPE_SECONDARY_VIDEO_SIZES);
+            buffer.putShort((short) (4 * secondaryVideoSizes.length));
+            for (Size size : secondaryVideoSizes) {
+                buffer.putShort((short) size.getWidth());
+                buffer.putShort((short) size.getHeight());
+            }
+        }
+
+        buffer.put((byte) META_TYPE_DENSITY);
+        buffer.putShort((short) 2);
+        buffer.putShort((short) densityDpi);
+
+        buffer.put((byte) META_TYPE_FEATURES);
+        buffer.putShort((short) 4);
+        buffer.putInt(FEATURE_REQUEST_IDR | FEATURE_STREAM_PAUSE | FEATURE_INJECT_FAILURES);
+
+        int end = buffer.position();
+        buffer.position(0);
+        buffer.put((byte) DEVICE_META_VERSION);
+        buffer.putShort((short) (end - 3));
+
+        IO.writeFully(videoFd, buffer.array(), 0, end);
     }
 
     public FileDescriptor getVideoFd() {
         return videoFd;
     }
 
+    public FileDescriptor getAudioFd() {
+        return audioFd;
+    }
+
     public ControlMessage receiveControlMessage() throws IOException {
         ControlMessage msg = reader.next();
         while (msg == null) {
@@ -115,4 +282,8 @@ public final class DesktopConnection implements Closeable {
     public void sendDeviceMessage(DeviceMessage msg) throws IOException {
         writer.writeTo(msg, controlOutputStream);
     }
+
+    public void sendDeviceMessages(List<DeviceMessage> msgs) throws IOException {
+        writer.writeTo(msgs, controlOutputStream);
+    }
 }
@@ -42,9 +42,38 @@ public final class Device {
         void onClipboardTextChanged(String text);
     }
 
-    private ScreenInfo screenInfo;
+    public interface MaxFpsListener {
+        void onMaxFpsChanged(int maxFps);
+    }
+
+    public interface BitRateListener {
+        void onBitRateChanged(int bitRate);
+    }
+
+    public interface StreamPausedListener {
+        void onStreamPausedChanged(boolean paused);
+    }
+
+    public interface RequestIdrListener {
+        void onIdrRequested();
+    }
+
+    public interface CropListener {
+        void onCropChanged();
+    }
+
+    // Immutable snapshot of the display geometry, replaced (never mutated) on
+    // rotation and max size changes. Declared volatile so that the input
+    // injection path can read it without taking the Device monitor; only
+    // writers synchronize (to make their read-modify-write atomic).
+    private volatile ScreenInfo screenInfo;
     private RotationListener rotationListener;
     private ClipboardListener clipboardListener;
+    private MaxFpsListener maxFpsListener;
+    private BitRateListener bitRateListener;
+    private StreamPausedListener streamPausedListener;
+    private RequestIdrListener requestIdrListener;
+    private CropListener cropListener;
     private final AtomicBoolean isSettingClipboard = new AtomicBoolean();
 
     /**
@@ -59,6 +88,11 @@ public final class Device {
 
     private final boolean supportsInputEvents;
 
+    /**
+     * Display density (dpi), sent to the client in the handshake
+     */
+    private final int densityDpi;
+
     public Device(Options options) {
         displayId = options.getDisplayId();
         DisplayInfo displayInfo = SERVICE_MANAGER.getDisplayManager().getDisplayInfo(displayId);
@@ -71,6 +105,7 @@ public final class Device {
 
         screenInfo = ScreenInfo.computeScreenInfo(displayInfo, options.getCrop(), options.getMaxSize(), options.getLockVideoOrientation());
         layerStack = displayInfo.getLayerStack();
+        densityDpi = displayInfo.getDensityDpi();
 
         SERVICE_MANAGER.getWindowManager().registerRotationWatcher(new IRotationWatcher.Stub() {
             @Override
@@ -123,18 +158,39 @@ public final class Device {
         }
     }
 
-    public synchronized ScreenInfo getScreenInfo() {
+    public ScreenInfo getScreenInfo() {
+        // lock-free volatile read of an immutable snapshot
         return screenInfo;
     }
 
+    /**
+     * Recompute the video size for a new maximum dimension, and restart the encoder if it changed.
+     *
+     * @param maxSize the new maximum dimension (0 for no limit), must be a multiple of 8
+     */
+    public synchronized void setMaxSize(int maxSize) {
+        ScreenInfo newScreenInfo = screenInfo.withMaxSize(maxSize);
+        if (newScreenInfo == screenInfo) {
+            // the video size is unchanged
+            return;
+        }
+        screenInfo = newScreenInfo;
+        Ln.i("Max size set to " + maxSize);
+
+        // the encoder restarts on rotation notifications, reuse this mechanism to apply the new video size
+        if (rotationListener != null) {
+            rotationListener.onRotationChanged(screenInfo.getDeviceRotation());
+        }
+    }
+
     public int getLayerStack() {
         return layerStack;
     }
 
     public Point getPhysicalPoint(Position position) {
-        // it hides the field on purpose, to read it with a lock
+        // it hides the field on purpose, to read the snapshot only once
         @SuppressWarnings("checkstyle:HiddenField")
-        ScreenInfo screenInfo = getScreenInfo(); // read with synchronization
+        ScreenInfo screenInfo = getScreenInfo(); // lock-free read
 
         // ignore the locked video orientation, the events will apply in coordinates considered in the physical device orientation
         Size unlockedVideoSize = screenInfo.getUnlockedVideoSize();
@@ -168,6 +224,10 @@ public final class Device {
         return supportsInputEvents;
     }
 
+    public int getDensityDpi() {
+        return densityDpi;
+    }
+
     public static boolean injectEvent(InputEvent inputEvent, int displayId, int injectMode) {
         if (!supportsInputEvents(displayId)) {
             throw new AssertionError("Could not inject input event if !supportsInputEvents()");
@@ -212,6 +272,97 @@ public final class Device {
         this.rotationListener = rotationListener;
     }
 
+    public synchronized void setMaxFpsListener(MaxFpsListener maxFpsListener) {
+        this.maxFpsListener = maxFpsListener;
+    }
+
+    /**
+     * Forward a new maximum frame rate to the video encoder.
+     *
+     * @param maxFps the new maximum frame rate (0 for no limit)
+     */
+    public synchronized void setMaxFps(int maxFps) {
+        Ln.i("Max fps set to " + maxFps);
+        if (maxFpsListener != null) {
+            maxFpsListener.onMaxFpsChanged(maxFps);
+        }
+    }
+
+    public synchronized void setBitRateListener(BitRateListener bitRateListener) {
+        this.bitRateListener = bitRateListener;
+    }
+
+    /**
+     * Forward a new video bitrate to the encoder, which applies it to the running session without restarting it.
+     *
+     * @param bitRate the new bitrate, in bits per second
+     */
+    public synchronized void setBitRate(int bitRate) {
+        Ln.i("Bitrate set to " + bitRate);
+        if (bitRateListener != null) {
+            bitRateListener.onBitRateChanged(bitRate);
+        }
+    }
+
+    public synchronized void setStreamPausedListener(StreamPausedListener streamPausedListener) {
+        this.streamPausedListener = streamPausedListener;
+    }
+
+    /**
+     * Pause or resume the video encoder.
+     * <p>
+     * While paused, the display is not captured and no frame is produced; on resume, a new encoding session starts (with a keyframe).
+     */
+    public synchronized void setStreamPaused(boolean paused) {
+        Ln.i("Video stream " + (paused ? "paused" : "resumed"));
+        if (streamPausedListener != null) {
+            streamPausedListener.onStreamPausedChanged(paused);
+        }
+    }
+
+    public synchronized void setRequestIdrListener(RequestIdrListener requestIdrListener) {
+        this.requestIdrListener = requestIdrListener;
+    }
+
+    /**
+     * Request the video encoder to produce a keyframe, so that the client can recover from packet loss without waiting for the next natural one.
+     */
+    public synchronized void requestIdr() {
+        if (requestIdrListener != null) {
+            requestIdrListener.onIdrRequested();
+        }
+    }
+
+    public synchronized void setCropListener(CropListener cropListener) {
+        this.cropListener = cropListener;
+    }
+
+    /**
+     * Update the streamed region at runtime (region-of-interest streaming).
+     * <p>
+     * The crop is expressed in the natural device orientation, like the startup crop option; null restores the full screen. The new region is
+     * projected onto the existing encoder surface, so the codec is not restarted and the video size does not change: the region is streamed at
+     * the full encoder resolution.
+     */
+    public synchronized void setCrop(Rect crop) {
+        DisplayInfo displayInfo = SERVICE_MANAGER.getDisplayManager().getDisplayInfo(displayId);
+        if (displayInfo == null) {
+            Ln.e("Could not get display info");
+            return;
+        }
+        ScreenInfo newScreenInfo = screenInfo.withCrop(crop, displayInfo.getSize());
+        if (newScreenInfo == screenInfo) {
+            // the content rectangle is unchanged
+            return;
+        }
+        screenInfo = newScreenInfo;
+        Ln.i("Crop set to " + (crop != null ? crop.width() + ":" + crop.height() + ":" + crop.left + ":" + crop.top : "full screen"));
+
+        if (cropListener != null) {
+            cropListener.onCropChanged();
+        }
+    }
+
     public synchronized void setClipboardListener(ClipboardListener clipboardListener) {
         this.clipboardListener = clipboardListener;
     }
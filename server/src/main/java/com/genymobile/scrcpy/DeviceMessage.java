@@ -4,12 +4,17 @@ public final class DeviceMessage {
 
     public static final int TYPE_CLIPBOARD = 0;
     public static final int TYPE_ACK_CLIPBOARD = 1;
+    public static final int TYPE_INJECT_FAILURES = 2;
+    public static final int TYPE_CLOCK_SYNC = 3;
 
     public static final long SEQUENCE_INVALID = ControlMessage.SEQUENCE_INVALID;
 
     private int type;
     private String text;
     private long sequence;
+    private int count;
+    private long clientTime;
+    private long deviceTime;
 
     private DeviceMessage() {
     }
@@ -28,6 +33,21 @@ public final class DeviceMessage {
         return event;
     }
 
+    public static DeviceMessage createInjectFailures(int count) {
+        DeviceMessage event = new DeviceMessage();
+        event.type = TYPE_INJECT_FAILURES;
+        event.count = count;
+        return event;
+    }
+
+    public static DeviceMessage createClockSync(long clientTime, long deviceTime) {
+        DeviceMessage event = new DeviceMessage();
+        event.type = TYPE_CLOCK_SYNC;
+        event.clientTime = clientTime;
+        event.deviceTime = deviceTime;
+        return event;
+    }
+
     public int getType() {
         return type;
     }
@@ -39,4 +59,16 @@ public final class DeviceMessage {
     public long getSequence() {
         return sequence;
     }
+
+    public int getCount() {
+        return count;
+    }
+
+    public long getClientTime() {
+        return clientTime;
+    }
+
+    public long getDeviceTime() {
+        return deviceTime;
+    }
 }
@@ -1,6 +1,8 @@
 package com.genymobile.scrcpy;
 
 import java.io.IOException;
+import java.util.ArrayList;
+import java.util.List;
 
 public final class DeviceMessageSender {
 
@@ -8,28 +10,72 @@ public final class DeviceMessageSender {
 
     private String clipboardText;
 
+    // last clipboard content pushed to (or received from) the client
+    private String lastClipboardText;
+
     private long ack;
 
+    private int injectFailures;
+
+    private boolean clockSyncPending;
+    private long clockSyncClientTime;
+    private long clockSyncDeviceTime;
+
     public DeviceMessageSender(DesktopConnection connection) {
         this.connection = connection;
     }
 
     public synchronized void pushClipboardText(String text) {
+        lastClipboardText = text;
         clipboardText = text;
         notify();
     }
 
+    /**
+     * Push the clipboard text only if it differs from the last content the client knows, to avoid retransmitting a (possibly huge) unchanged
+     * clipboard on every focus change.
+     */
+    public synchronized void pushClipboardTextIfChanged(String text) {
+        if (text.equals(lastClipboardText)) {
+            return;
+        }
+        pushClipboardText(text);
+    }
+
+    /**
+     * Remember a clipboard content the client already knows (because it sent it), without pushing it.
+     */
+    public synchronized void recordClipboardText(String text) {
+        lastClipboardText = text;
+    }
+
     public synchronized void pushAckClipboard(long sequence) {
         ack = sequence;
         notify();
     }
 
+    public synchronized void pushInjectFailures(int count) {
+        injectFailures += count;
+        notify();
+    }
+
+    public synchronized void pushClockSync(long clientTime, long deviceTime) {
+        clockSyncPending = true;
+        clockSyncClientTime = clientTime;
+        clockSyncDeviceTime = deviceTime;
+        notify();
+    }
+
     public void loop() throws IOException, InterruptedException {
         while (true) {
             String text;
             long sequence;
+            int failures;
+            boolean clockSync;
+            long clockSyncClient;
+            long clockSyncDevice;
             synchronized (this) {
-                while (ack == DeviceMessage.SEQUENCE_INVALID && clipboardText == null) {
+                while (ack == DeviceMessage.SEQUENCE_INVALID && clipboardText == null && injectFailures == 0 && !clockSyncPending) {
                     wait();
                 }
                 text = clipboardText;
@@ -37,16 +83,31 @@ public final class DeviceMessageSender {
 
                 sequence = ack;
                 ack = DeviceMessage.SEQUENCE_INVALID;
+
+                failures = injectFailures;
+                injectFailures = 0;
+
+                clockSync = clockSyncPending;
+                clockSyncClient = clockSyncClientTime;
+                clockSyncDevice = clockSyncDeviceTime;
+                clockSyncPending = false;
             }
 
+            // batch the pending messages to send them in a single write
+            List<DeviceMessage> events = new ArrayList<>(4);
             if (sequence != DeviceMessage.SEQUENCE_INVALID) {
-                DeviceMessage event = DeviceMessage.createAckClipboard(sequence);
-                connection.sendDeviceMessage(event);
+                events.add(DeviceMessage.createAckClipboard(sequence));
+            }
+            if (clockSync) {
+                events.add(DeviceMessage.createClockSync(clockSyncClient, clockSyncDevice));
             }
             if (text != null) {
-                DeviceMessage event = DeviceMessage.createClipboard(text);
-                connection.sendDeviceMessage(event);
+                events.add(DeviceMessage.createClipboard(text));
+            }
+            if (failures > 0) {
+                events.add(DeviceMessage.createInjectFailures(failures));
             }
+            connection.sendDeviceMessages(events);
         }
     }
 }
@@ -4,34 +4,121 @@ import java.io.IOException;
 import java.io.OutputStream;
 import java.nio.ByteBuffer;
 import java.nio.charset.StandardCharsets;
+import java.util.List;
+import java.util.zip.Deflater;
 
 public class DeviceMessageWriter {
 
     private static final int MESSAGE_MAX_SIZE = 1 << 18; // 256k
-    public static final int CLIPBOARD_TEXT_MAX_LENGTH = MESSAGE_MAX_SIZE - 5; // type: 1 byte; length: 4 bytes
+    public static final int CLIPBOARD_TEXT_MAX_LENGTH = MESSAGE_MAX_SIZE - 6; // type: 1 byte; compressed flag: 1 byte; length: 4 bytes
+
+    // deflate the clipboard text when at least this size (small payloads are not worth the overhead)
+    private static final int CLIPBOARD_DEFLATE_MIN_LENGTH = 512;
+
+    private static final int ACK_CLIPBOARD_LENGTH = 9; // type: 1 byte; sequence: 8 bytes
+    private static final int INJECT_FAILURES_LENGTH = 5; // type: 1 byte; count: 4 bytes
+    private static final int CLOCK_SYNC_LENGTH = 17; // type: 1 byte; client time: 8 bytes; device time: 8 bytes
 
     private final byte[] rawBuffer = new byte[MESSAGE_MAX_SIZE];
     private final ByteBuffer buffer = ByteBuffer.wrap(rawBuffer);
 
     public void writeTo(DeviceMessage msg, OutputStream output) throws IOException {
         buffer.clear();
-        buffer.put((byte) msg.getType());
+        serialize(msg, output);
+        flushTo(output);
+    }
+
+    /**
+     * Write several messages in a single batch, so that a burst of messages (for example clipboard acks) leaves in one write call.
+     */
+    public void writeTo(List<DeviceMessage> msgs, OutputStream output) throws IOException {
+        buffer.clear();
+        for (DeviceMessage msg : msgs) {
+            serialize(msg, output);
+        }
+        flushTo(output);
+    }
+
+    private void serialize(DeviceMessage msg, OutputStream output) throws IOException {
         switch (msg.getType()) {
             case DeviceMessage.TYPE_CLIPBOARD:
                 String text = msg.getText();
                 byte[] raw = text.getBytes(StandardCharsets.UTF_8);
                 int len = StringUtils.getUtf8TruncationIndex(raw, CLIPBOARD_TEXT_MAX_LENGTH);
-                buffer.putInt(len);
-                buffer.put(raw, 0, len);
-                output.write(rawBuffer, 0, buffer.position());
+                byte[] deflated = len >= CLIPBOARD_DEFLATE_MIN_LENGTH ? deflate(raw, len) : null;
+                int payloadLen = deflated != null ? 4 + deflated.length : len;
+                if (buffer.remaining() < 6 + payloadLen) {
+                    // not enough space left in the batch buffer
+                    flushTo(output);
+                }
+                buffer.put((byte) DeviceMessage.TYPE_CLIPBOARD);
+                buffer.put((byte) (deflated != null ? 1 : 0));
+                buffer.putInt(payloadLen);
+                if (deflated != null) {
+                    buffer.putInt(len); // uncompressed length
+                    buffer.put(deflated);
+                } else {
+                    buffer.put(raw, 0, len);
+                }
                 break;
             case DeviceMessage.TYPE_ACK_CLIPBOARD:
+                if (buffer.remaining() < ACK_CLIPBOARD_LENGTH) {
+                    flushTo(output);
+                }
+                buffer.put((byte) DeviceMessage.TYPE_ACK_CLIPBOARD);
                 buffer.putLong(msg.getSequence());
-                output.write(rawBuffer, 0, buffer.position());
+                break;
+            case DeviceMessage.TYPE_INJECT_FAILURES:
+                if (buffer.remaining() < INJECT_FAILURES_LENGTH) {
+                    flushTo(output);
+                }
+                buffer.put((byte) DeviceMessage.TYPE_INJECT_FAILURES);
+                buffer.putInt(msg.getCount());
+                break;
+            case DeviceMessage.TYPE_CLOCK_SYNC:
+                if (buffer.remaining() < CLOCK_SYNC_LENGTH) {
+                    flushTo(output);
+                }
+                buffer.put((byte) DeviceMessage.TYPE_CLOCK_SYNC);
+                buffer.putLong(msg.getClientTime());
+                buffer.putLong(msg.getDeviceTime());
                 break;
             default:
                 Ln.w("Unknown device message: " + msg.getType());
                 break;
         }
     }
+
+    /**
+     * Deflate the payload, or return {@code null} if the compressed form is not smaller.
+     */
+    private static byte[] deflate(byte[] raw, int len) {
+        Deflater deflater = new Deflater(Deflater.BEST_SPEED);
+        try {
+            deflater.setInput(raw, 0, len);
+            deflater.finish();
+            byte[] out = new byte[len - 5]; // only useful if smaller overall
+            int outLen = 0;
+            while (!deflater.finished()) {
+                int r = deflater.deflate(out, outLen, out.length - outLen);
+                if (r == 0) {
+                    // the text is incompressible, send it raw
+                    return null;
+                }
+                outLen += r;
+            }
+            byte[] result = new byte[outLen];
+            System.arraycopy(out, 0, result, 0, outLen);
+            return result;
+        } finally {
+            deflater.end();
+        }
+    }
+
+    private void flushTo(OutputStream output) throws IOException {
+        if (buffer.position() > 0) {
+            output.write(rawBuffer, 0, buffer.position());
+            buffer.clear();
+        }
+    }
 }
@@ -34,6 +34,35 @@ public final class IO {
         }
     }
 
+    /**
+     * Write both buffers fully, using vectored writes so that a header and its payload leave in a single syscall.
+     */
+    public static void writeFully(FileDescriptor fd, ByteBuffer header, ByteBuffer payload) throws IOException {
+        ByteBuffer[] buffers = {header, payload};
+        int headerPosition = header.position();
+        int payloadPosition = payload.position();
+        int headerLen = header.remaining();
+        int total = headerLen + payload.remaining();
+        int written = 0;
+        while (written < total) {
+            // Os.writev() may not update the buffer positions either (see the comment in writeFully() above), set them explicitly
+            header.position(headerPosition + Math.min(written, headerLen));
+            payload.position(payloadPosition + Math.max(written - headerLen, 0));
+            try {
+                int w = Os.writev(fd, buffers);
+                if (BuildConfig.DEBUG && w < 0) {
+                    // w should not be negative, since an exception is thrown on error
+                    throw new AssertionError("Os.writev() returned a negative value (" + w + ")");
+                }
+                written += w;
+            } catch (ErrnoException e) {
+                if (e.errno != OsConstants.EINTR) {
+                    throw new IOException(e);
+                }
+            }
+        }
+    }
+
     public static void writeFully(FileDescriptor fd, byte[] buffer, int offset, int len) throws IOException {
         writeFully(fd, ByteBuffer.wrap(buffer, offset, len));
     }
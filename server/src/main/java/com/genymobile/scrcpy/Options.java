@@ -8,19 +8,27 @@ public class Options {
     private Ln.Level logLevel = Ln.Level.DEBUG;
     private int maxSize;
     private int bitRate = 8000000;
+    private String codec = "h264";
     private int maxFps;
     private int lockVideoOrientation = -1;
     private boolean tunnelForward;
     private Rect crop;
     private boolean sendFrameMeta = true; // send PTS so that the client may record properly
     private boolean control = true;
+    private boolean audio;
     private int displayId;
+    private int[] secondaryDisplayIds = new int[0];
+    // synthetic test-pattern source, for device-free load testing (null for normal mirroring)
+    private Size syntheticSize;
+    private int syntheticFps;
     private boolean showTouches;
     private boolean stayAwake;
     private List<CodecOption> codecOptions;
     private String encoderName;
     private boolean powerOffScreenOnClose;
     private boolean clipboardAutosync = true;
+    private boolean daemon;
+    private int listenPort; // if > 0, listen on this TCP port instead of the localabstract socket
 
     public Ln.Level getLogLevel() {
         return logLevel;
@@ -46,6 +54,14 @@ public class Options {
         this.bitRate = bitRate;
     }
 
+    public String getCodec() {
+        return codec;
+    }
+
+    public void setCodec(String codec) {
+        this.codec = codec;
+    }
+
     public int getMaxFps() {
         return maxFps;
     }
@@ -94,6 +110,14 @@ public class Options {
         this.control = control;
     }
 
+    public boolean getAudio() {
+        return audio;
+    }
+
+    public void setAudio(boolean audio) {
+        this.audio = audio;
+    }
+
     public int getDisplayId() {
         return displayId;
     }
@@ -102,6 +126,30 @@ public class Options {
         this.displayId = displayId;
     }
 
+    public int[] getSecondaryDisplayIds() {
+        return secondaryDisplayIds;
+    }
+
+    public void setSecondaryDisplayIds(int[] secondaryDisplayIds) {
+        this.secondaryDisplayIds = secondaryDisplayIds;
+    }
+
+    public Size getSyntheticSize() {
+        return syntheticSize;
+    }
+
+    public void setSyntheticSize(Size syntheticSize) {
+        this.syntheticSize = syntheticSize;
+    }
+
+    public int getSyntheticFps() {
+        return syntheticFps;
+    }
+
+    public void setSyntheticFps(int syntheticFps) {
+        this.syntheticFps = syntheticFps;
+    }
+
     public boolean getShowTouches() {
         return showTouches;
     }
@@ -149,4 +197,20 @@ public class Options {
     public void setClipboardAutosync(boolean clipboardAutosync) {
         this.clipboardAutosync = clipboardAutosync;
     }
+
+    public boolean getDaemon() {
+        return daemon;
+    }
+
+    public void setDaemon(boolean daemon) {
+        this.daemon = daemon;
+    }
+
+    public int getListenPort() {
+        return listenPort;
+    }
+
+    public void setListenPort(int listenPort) {
+        this.listenPort = listenPort;
+    }
 }
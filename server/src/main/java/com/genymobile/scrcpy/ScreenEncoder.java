@@ -8,6 +8,9 @@ import android.media.MediaCodecInfo;
 import android.media.MediaCodecList;
 import android.media.MediaFormat;
 import android.os.Build;
+import android.os.Bundle;
+import android.os.Handler;
+import android.os.HandlerThread;
 import android.os.IBinder;
 import android.view.Surface;
 
@@ -19,30 +22,54 @@ import java.util.Arrays;
 import java.util.List;
 import java.util.concurrent.atomic.AtomicBoolean;
 
-public class ScreenEncoder implements Device.RotationListener {
+public class ScreenEncoder implements Device.RotationListener, Device.MaxFpsListener, Device.BitRateListener, Device.StreamPausedListener,
+        Device.RequestIdrListener, Device.CropListener {
 
     private static final int DEFAULT_I_FRAME_INTERVAL = 10; // seconds
     private static final int REPEAT_FRAME_DELAY_US = 100_000; // repeat after 100ms
     private static final String KEY_MAX_FPS_TO_ENCODER = "max-fps-to-encoder";
 
     private static final int NO_PTS = -1;
+    // bit 62 of the PTS field carries the keyframe flag, so that the client
+    // does not need to parse the packet bytes to detect keyframes
+    private static final long PACKET_FLAG_KEY_FRAME = 1L << 62;
 
     private final AtomicBoolean rotationChanged = new AtomicBoolean();
-    private final ByteBuffer headerBuffer = ByteBuffer.allocate(12);
+    private final ByteBuffer headerBuffer = ByteBuffer.allocate(17);
+
+    // index of the mirrored display in the client request, written in the frame meta header so that the client can demux the substreams
+    private final int displayIndex;
+    // serializes whole packets (header + payload) on the shared video socket
+    private final Object writeLock;
+    // if not null, encode this synthetic source instead of mirroring the display
+    private final TestPatternSource testPattern;
 
     private String encoderName;
     private List<CodecOption> codecOptions;
-    private int bitRate;
-    private int maxFps;
+    // MediaFormat MIME type of the selected codec
+    private final String mimeType;
+    private volatile int bitRate;
+    private volatile int maxFps;
     private boolean sendFrameMeta;
     private long ptsOrigin;
-
-    public ScreenEncoder(boolean sendFrameMeta, int bitRate, int maxFps, List<CodecOption> codecOptions, String encoderName) {
+    // PTS origin of the main display encoder, exposed so that the Controller can answer clock sync requests with a device timestamp expressed
+    // in the same base as the frame PTS
+    private static volatile long clockPtsOrigin;
+    // count of encoded media packets, sent in the frame meta so that the
+    // client can detect frames lost before it (encoder restarts, transport)
+    private int sequence;
+
+    public ScreenEncoder(boolean sendFrameMeta, int bitRate, String codec, int maxFps, List<CodecOption> codecOptions, String encoderName,
+            int displayIndex, Object writeLock, TestPatternSource testPattern) {
         this.sendFrameMeta = sendFrameMeta;
         this.bitRate = bitRate;
+        this.mimeType = toMimeType(codec);
         this.maxFps = maxFps;
         this.codecOptions = codecOptions;
         this.encoderName = encoderName;
+        this.displayIndex = displayIndex;
+        this.writeLock = writeLock;
+        this.testPattern = testPattern;
     }
 
     @Override
@@ -54,51 +81,324 @@ public class ScreenEncoder implements Device.RotationListener {
         return rotationChanged.getAndSet(false);
     }
 
-    public void streamScreen(Device device, FileDescriptor fd) throws IOException {
+    @Override
+    public void onMaxFpsChanged(int maxFps) {
+        this.maxFps = maxFps;
+        // the encoder restarts on rotation notifications, reuse this mechanism to apply the new frame rate
+        rotationChanged.set(true);
+    }
+
+    @Override
+    public void onBitRateChanged(int bitRate) {
+        // keep the new rate for the next encoding sessions (rotation restarts)
+        this.bitRate = bitRate;
+        MediaCodec codec = runningCodec;
+        if (codec != null) {
+            // adjust the running session live, without restarting it
+            Bundle bundle = new Bundle();
+            bundle.putInt(MediaCodec.PARAMETER_KEY_VIDEO_BITRATE, bitRate);
+            try {
+                codec.setParameters(bundle);
+            } catch (IllegalStateException e) {
+                // the session just ended; the next one is configured with the new rate anyway
+            }
+        }
+    }
+
+    private final Object pauseLock = new Object();
+    private boolean paused;
+
+    @Override
+    public void onStreamPausedChanged(boolean paused) {
+        synchronized (pauseLock) {
+            this.paused = paused;
+            if (paused) {
+                // end the current encoding session (reuse the rotation restart mechanism); the display is released until resume
+                rotationChanged.set(true);
+            } else {
+                pauseLock.notify();
+            }
+        }
+    }
+
+    // the codec of the current encoding session, to apply IDR requests (null between sessions)
+    private volatile MediaCodec runningCodec;
+
+    // the virtual display of the current encoding session, to re-project a new crop without restarting the codec (null between sessions)
+    private volatile IBinder runningDisplay;
+    private volatile Device runningDevice;
+
+    @Override
+    public void onCropChanged() {
+        IBinder display = runningDisplay;
+        Device device = runningDevice;
+        if (display == null || device == null) {
+            // no active session, the next one will use the new content rectangle
+            return;
+        }
+        ScreenInfo screenInfo = device.getScreenInfo();
+        Rect contentRect = screenInfo.getContentRect();
+        Rect unlockedVideoRect = screenInfo.getUnlockedVideoSize().toRect();
+        // re-project the new region onto the existing encoder surface, without restarting the codec
+        SurfaceControl.openTransaction();
+        try {
+            SurfaceControl.setDisplayProjection(display, screenInfo.getVideoRotation(), contentRect, unlockedVideoRect);
+        } finally {
+            SurfaceControl.closeTransaction();
+        }
+    }
+
+    @Override
+    public void onIdrRequested() {
+        MediaCodec codec = runningCodec;
+        if (codec != null) {
+            Bundle bundle = new Bundle();
+            bundle.putInt(MediaCodec.PARAMETER_KEY_REQUEST_SYNC_FRAME, 0);
+            try {
+                codec.setParameters(bundle);
+            } catch (IllegalStateException e) {
+                // the session just ended; the next one starts with a keyframe anyway
+            }
+        }
+    }
+
+    private boolean isPaused() {
+        synchronized (pauseLock) {
+            return paused;
+        }
+    }
+
+    private void waitWhilePaused() throws IOException {
+        synchronized (pauseLock) {
+            while (paused) {
+                try {
+                    pauseLock.wait();
+                } catch (InterruptedException e) {
+                    Thread.currentThread().interrupt();
+                    throw new IOException("Interrupted while the stream was paused", e);
+                }
+            }
+        }
+    }
+
+    private static String toMimeType(String codec) {
+        switch (codec) {
+            case "h264":
+                return MediaFormat.MIMETYPE_VIDEO_AVC;
+            case "h265":
+                return MediaFormat.MIMETYPE_VIDEO_HEVC;
+            case "av1":
+                return MediaFormat.MIMETYPE_VIDEO_AV1;
+            default:
+                throw new IllegalArgumentException("Unsupported codec: " + codec);
+        }
+    }
+
+    private static boolean workaroundsApplied;
+
+    private static synchronized void applyWorkarounds() {
+        if (workaroundsApplied) {
+            // the workarounds are global, they must be applied only once even if several encoders stream concurrently
+            return;
+        }
+        workaroundsApplied = true;
+
         Workarounds.prepareMainLooper();
         if (Build.BRAND.equalsIgnoreCase("meizu")) {
             // <https://github.com/Genymobile/scrcpy/issues/240>
             // <https://github.com/Genymobile/scrcpy/issues/2656>
             Workarounds.fillAppInfo();
         }
+    }
 
+    public void streamScreen(Device device, FileDescriptor fd) throws IOException {
+        applyWorkarounds();
         internalStreamScreen(device, fd);
     }
 
     private void internalStreamScreen(Device device, FileDescriptor fd) throws IOException {
-        MediaFormat format = createFormat(bitRate, maxFps, codecOptions);
         device.setRotationListener(this);
+        device.setMaxFpsListener(this);
+        device.setBitRateListener(this);
+        device.setStreamPausedListener(this);
+        device.setRequestIdrListener(this);
+        device.setCropListener(this);
+
+        // In asynchronous mode, encoded buffers are written to the socket directly from the codec callback, without an extra thread hop.
+        // The callback must run on a dedicated looper thread: delivering it on the main looper would deadlock, since the main thread blocks
+        // waiting for the end of the encoding session.
+        boolean async = Build.VERSION.SDK_INT >= Build.VERSION_CODES.M;
+        HandlerThread callbackThread = null;
+        Handler callbackHandler = null;
+        if (async) {
+            callbackThread = new HandlerThread("ScreenEncoder");
+            callbackThread.start();
+            callbackHandler = new Handler(callbackThread.getLooper());
+        }
+
+        // The codec and the virtual display are created once and reused across encoding sessions: MediaCodec cannot change the output size of
+        // a running session, so rotation still restarts the session, but stop() returns the codec to the Uninitialized state, where it can be
+        // configured again. This avoids the expensive parts of a restart (codec allocation and display creation), which caused a visible black
+        // gap on every rotation.
+        MediaCodec codec = createCodec(encoderName, mimeType);
+        IBinder display = null;
         boolean alive;
         try {
             do {
-                MediaCodec codec = createCodec(encoderName);
-                IBinder display = createDisplay();
-                ScreenInfo screenInfo = device.getScreenInfo();
-                Rect contentRect = screenInfo.getContentRect();
-                // include the locked video orientation
-                Rect videoRect = screenInfo.getVideoSize().toRect();
-                // does not include the locked video orientation
-                Rect unlockedVideoRect = screenInfo.getUnlockedVideoSize().toRect();
-                int videoRotation = screenInfo.getVideoRotation();
-                int layerStack = device.getLayerStack();
+                // while paused, no display is captured and no codec is running; a fresh session (starting with a keyframe) is created on resume
+                waitWhilePaused();
+
+                // recreate the format on each iteration, maxFps may have changed
+                MediaFormat format = createFormat(mimeType, bitRate, maxFps, codecOptions);
+                EncoderCallback callback = null;
+                if (async) {
+                    callback = new EncoderCallback(fd);
+                    // must be called before configure()
+                    codec.setCallback(callback, callbackHandler);
+                }
+                Rect videoRect;
+                if (testPattern != null) {
+                    videoRect = testPattern.getSize().toRect();
+                } else {
+                    if (display == null) {
+                        display = createDisplay();
+                    }
+                    // include the locked video orientation
+                    videoRect = device.getScreenInfo().getVideoSize().toRect();
+                }
 
                 setSize(format, videoRect.width(), videoRect.height());
                 configure(codec, format);
                 Surface surface = codec.createInputSurface();
-                setDisplaySurface(display, surface, videoRotation, contentRect, unlockedVideoRect, layerStack);
+                if (testPattern != null) {
+                    testPattern.start(surface);
+                } else {
+                    ScreenInfo screenInfo = device.getScreenInfo();
+                    Rect contentRect = screenInfo.getContentRect();
+                    // does not include the locked video orientation
+                    Rect unlockedVideoRect = screenInfo.getUnlockedVideoSize().toRect();
+                    int videoRotation = screenInfo.getVideoRotation();
+                    int layerStack = device.getLayerStack();
+                    setDisplaySurface(display, surface, videoRotation, contentRect, unlockedVideoRect, layerStack);
+                }
                 codec.start();
+                runningCodec = codec;
+                if (testPattern == null) {
+                    runningDisplay = display;
+                    runningDevice = device;
+                }
                 try {
-                    alive = encode(codec, fd);
+                    alive = callback != null ? callback.waitForEnd() : encode(codec, fd);
                     // do not call stop() on exception, it would trigger an IllegalStateException
                     codec.stop();
                 } finally {
-                    destroyDisplay(display);
-                    codec.release();
+                    runningCodec = null;
+                    runningDisplay = null;
+                    runningDevice = null;
+                    if (testPattern != null) {
+                        testPattern.stop();
+                    }
                     surface.release();
                 }
+                if (display != null && isPaused()) {
+                    // release the display while the stream is paused, nothing must be captured
+                    destroyDisplay(display);
+                    display = null;
+                }
             } while (alive);
         } finally {
+            if (display != null) {
+                destroyDisplay(display);
+            }
+            codec.release();
             device.setRotationListener(null);
+            device.setMaxFpsListener(null);
+            device.setBitRateListener(null);
+            device.setStreamPausedListener(null);
+            device.setRequestIdrListener(null);
+            device.setCropListener(null);
+            if (callbackThread != null) {
+                callbackThread.quitSafely();
+            }
+        }
+    }
+
+    private final class EncoderCallback extends MediaCodec.Callback {
+
+        private final FileDescriptor fd;
+
+        private final Object lock = new Object();
+        private boolean ended;
+        private boolean eof;
+        private IOException error;
+
+        private EncoderCallback(FileDescriptor fd) {
+            this.fd = fd;
+        }
+
+        private void end(boolean endOfStream, IOException e) {
+            synchronized (lock) {
+                ended = true;
+                eof = endOfStream;
+                error = e;
+                lock.notify();
+            }
+        }
+
+        boolean waitForEnd() throws IOException {
+            synchronized (lock) {
+                while (!ended) {
+                    try {
+                        lock.wait();
+                    } catch (InterruptedException e) {
+                        Thread.currentThread().interrupt();
+                        throw new IOException("Interrupted while waiting for the encoder", e);
+                    }
+                }
+                if (error != null) {
+                    throw error;
+                }
+                return !eof;
+            }
+        }
+
+        @Override
+        public void onOutputBufferAvailable(MediaCodec codec, int index, MediaCodec.BufferInfo bufferInfo) {
+            synchronized (lock) {
+                if (ended) {
+                    // the codec is being stopped by the waiting thread, do not touch it anymore
+                    return;
+                }
+            }
+            boolean endOfStream = (bufferInfo.flags & MediaCodec.BUFFER_FLAG_END_OF_STREAM) != 0;
+            if (consumeRotationChange() || endOfStream) {
+                // the codec is stopped by the thread blocked in waitForEnd() (the pending buffer is reclaimed by stop())
+                end(endOfStream, null);
+                return;
+            }
+            try {
+                ByteBuffer codecBuffer = codec.getOutputBuffer(index);
+
+                writePacket(fd, bufferInfo, codecBuffer);
+                codec.releaseOutputBuffer(index, false);
+            } catch (IOException e) {
+                end(false, e);
+            }
+        }
+
+        @Override
+        public void onInputBufferAvailable(MediaCodec codec, int index) {
+            // the input is a Surface, there are no input buffers
+        }
+
+        @Override
+        public void onOutputFormatChanged(MediaCodec codec, MediaFormat format) {
+            // nothing to do
+        }
+
+        @Override
+        public void onError(MediaCodec codec, MediaCodec.CodecException e) {
+            end(false, new IOException("MediaCodec error", e));
         }
     }
 
@@ -117,11 +417,7 @@ public class ScreenEncoder implements Device.RotationListener {
                 if (outputBufferId >= 0) {
                     ByteBuffer codecBuffer = codec.getOutputBuffer(outputBufferId);
 
-                    if (sendFrameMeta) {
-                        writeFrameMeta(fd, bufferInfo, codecBuffer.remaining());
-                    }
-
-                    IO.writeFully(fd, codecBuffer);
+                    writePacket(fd, bufferInfo, codecBuffer);
                 }
             } finally {
                 if (outputBufferId >= 0) {
@@ -133,7 +429,24 @@ public class ScreenEncoder implements Device.RotationListener {
         return !eof;
     }
 
-    private void writeFrameMeta(FileDescriptor fd, MediaCodec.BufferInfo bufferInfo, int packetSize) throws IOException {
+    private void writePacket(FileDescriptor fd, MediaCodec.BufferInfo bufferInfo, ByteBuffer codecBuffer) throws IOException {
+        // several encoders (one per display) may share the socket, a whole packet (header + payload) must be written atomically
+        synchronized (writeLock) {
+            if (sendFrameMeta) {
+                fillFrameMeta(bufferInfo, codecBuffer.remaining());
+                // vectored write, the header and the payload leave in a single syscall
+                IO.writeFully(fd, headerBuffer, codecBuffer);
+            } else {
+                IO.writeFully(fd, codecBuffer);
+            }
+        }
+    }
+
+    public static long getClockPtsOrigin() {
+        return clockPtsOrigin;
+    }
+
+    private void fillFrameMeta(MediaCodec.BufferInfo bufferInfo, int packetSize) {
         headerBuffer.clear();
 
         long pts;
@@ -142,38 +455,46 @@ public class ScreenEncoder implements Device.RotationListener {
         } else {
             if (ptsOrigin == 0) {
                 ptsOrigin = bufferInfo.presentationTimeUs;
+                if (displayIndex == 0) {
+                    clockPtsOrigin = ptsOrigin;
+                }
             }
             pts = bufferInfo.presentationTimeUs - ptsOrigin;
+            ++sequence;
+            if ((bufferInfo.flags & MediaCodec.BUFFER_FLAG_KEY_FRAME) != 0) {
+                pts |= PACKET_FLAG_KEY_FRAME;
+            }
         }
 
+        headerBuffer.put((byte) displayIndex);
         headerBuffer.putLong(pts);
         headerBuffer.putInt(packetSize);
+        headerBuffer.putInt(sequence);
         headerBuffer.flip();
-        IO.writeFully(fd, headerBuffer);
     }
 
-    private static MediaCodecInfo[] listEncoders() {
+    private static MediaCodecInfo[] listEncoders(String mimeType) {
         List<MediaCodecInfo> result = new ArrayList<>();
         MediaCodecList list = new MediaCodecList(MediaCodecList.REGULAR_CODECS);
         for (MediaCodecInfo codecInfo : list.getCodecInfos()) {
-            if (codecInfo.isEncoder() && Arrays.asList(codecInfo.getSupportedTypes()).contains(MediaFormat.MIMETYPE_VIDEO_AVC)) {
+            if (codecInfo.isEncoder() && Arrays.asList(codecInfo.getSupportedTypes()).contains(mimeType)) {
                 result.add(codecInfo);
             }
         }
         return result.toArray(new MediaCodecInfo[result.size()]);
     }
 
-    private static MediaCodec createCodec(String encoderName) throws IOException {
+    private static MediaCodec createCodec(String encoderName, String mimeType) throws IOException {
         if (encoderName != null) {
             Ln.d("Creating encoder by name: '" + encoderName + "'");
             try {
                 return MediaCodec.createByCodecName(encoderName);
             } catch (IllegalArgumentException e) {
-                MediaCodecInfo[] encoders = listEncoders();
+                MediaCodecInfo[] encoders = listEncoders(mimeType);
                 throw new InvalidEncoderException(encoderName, encoders);
             }
         }
-        MediaCodec codec = MediaCodec.createEncoderByType(MediaFormat.MIMETYPE_VIDEO_AVC);
+        MediaCodec codec = MediaCodec.createEncoderByType(mimeType);
         Ln.d("Using encoder: '" + codec.getName() + "'");
         return codec;
     }
@@ -195,9 +516,9 @@ public class ScreenEncoder implements Device.RotationListener {
         Ln.d("Codec option set: " + key + " (" + value.getClass().getSimpleName() + ") = " + value);
     }
 
-    private static MediaFormat createFormat(int bitRate, int maxFps, List<CodecOption> codecOptions) {
+    private static MediaFormat createFormat(String mimeType, int bitRate, int maxFps, List<CodecOption> codecOptions) {
         MediaFormat format = new MediaFormat();
-        format.setString(MediaFormat.KEY_MIME, MediaFormat.MIMETYPE_VIDEO_AVC);
+        format.setString(MediaFormat.KEY_MIME, mimeType);
         format.setInteger(MediaFormat.KEY_BIT_RATE, bitRate);
         // must be present to configure the encoder, but does not impact the actual frame rate, which is variable
         format.setInteger(MediaFormat.KEY_FRAME_RATE, 60);
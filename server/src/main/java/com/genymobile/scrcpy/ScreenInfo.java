@@ -80,6 +80,41 @@ public final class ScreenInfo {
         return new ScreenInfo(newContentRect, newUnlockedVideoSize, newDeviceRotation, lockedVideoOrientation);
     }
 
+    /**
+     * Return a snapshot with a new crop, keeping the current video size.
+     * <p>
+     * Used for runtime region-of-interest streaming: the region is projected onto the existing encoder surface, so the codec does not restart
+     * and the region is streamed at the full encoder resolution.
+     *
+     * @param crop the crop in the natural device orientation, or null to restore the full screen
+     * @param deviceSize the full display size (in the current rotation)
+     */
+    public ScreenInfo withCrop(Rect crop, Size deviceSize) {
+        Rect newContentRect = new Rect(0, 0, deviceSize.getWidth(), deviceSize.getHeight());
+        if (crop != null) {
+            if (deviceRotation % 2 != 0) { // 180s preserve dimensions
+                // the crop (provided by the client) is expressed in the natural orientation
+                crop = flipRect(crop);
+            }
+            if (!newContentRect.intersect(crop)) {
+                Ln.w("Crop rectangle (" + formatCrop(crop) + ") does not intersect device screen (" + formatCrop(deviceSize.toRect()) + ")");
+                newContentRect = new Rect(0, 0, deviceSize.getWidth(), deviceSize.getHeight());
+            }
+        }
+        if (newContentRect.equals(contentRect)) {
+            return this;
+        }
+        return new ScreenInfo(newContentRect, unlockedVideoSize, deviceRotation, lockedVideoOrientation);
+    }
+
+    public ScreenInfo withMaxSize(int maxSize) {
+        Size newVideoSize = computeVideoSize(contentRect.width(), contentRect.height(), maxSize);
+        if (newVideoSize.equals(unlockedVideoSize)) {
+            return this;
+        }
+        return new ScreenInfo(contentRect, newVideoSize, deviceRotation, lockedVideoOrientation);
+    }
+
     public static ScreenInfo computeScreenInfo(DisplayInfo displayInfo, Rect crop, int maxSize, int lockedVideoOrientation) {
         int rotation = displayInfo.getRotation();
 
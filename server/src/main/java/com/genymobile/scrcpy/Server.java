@@ -7,8 +7,12 @@ import android.os.BatteryManager;
 import android.os.Build;
 
 import java.io.IOException;
+import java.util.ArrayList;
 import java.util.List;
 import java.util.Locale;
+import java.util.concurrent.Callable;
+import java.util.concurrent.ExecutionException;
+import java.util.concurrent.FutureTask;
 
 public final class Server {
 
@@ -22,22 +26,31 @@ public final class Server {
         int restoreStayOn = -1;
         if (options.getShowTouches() || options.getStayAwake()) {
             Settings settings = Device.getSettings();
+
+            // batch the changes so that the settings ContentProvider is acquired only once
+            List<Settings.Entry> batch = new ArrayList<>(2);
+            Settings.Entry showTouchesEntry = null;
+            Settings.Entry stayOnEntry = null;
+            int stayOn = BatteryManager.BATTERY_PLUGGED_AC | BatteryManager.BATTERY_PLUGGED_USB | BatteryManager.BATTERY_PLUGGED_WIRELESS;
             if (options.getShowTouches()) {
-                try {
-                    String oldValue = settings.getAndPutValue(Settings.TABLE_SYSTEM, "show_touches", "1");
-                    // If "show touches" was disabled, it must be disabled back on clean up
-                    mustDisableShowTouchesOnCleanUp = !"1".equals(oldValue);
-                } catch (SettingsException e) {
-                    Ln.e("Could not change \"show_touches\"", e);
-                }
+                showTouchesEntry = new Settings.Entry(Settings.TABLE_SYSTEM, "show_touches", "1");
+                batch.add(showTouchesEntry);
             }
-
             if (options.getStayAwake()) {
-                int stayOn = BatteryManager.BATTERY_PLUGGED_AC | BatteryManager.BATTERY_PLUGGED_USB | BatteryManager.BATTERY_PLUGGED_WIRELESS;
-                try {
-                    String oldValue = settings.getAndPutValue(Settings.TABLE_GLOBAL, "stay_on_while_plugged_in", String.valueOf(stayOn));
+                stayOnEntry = new Settings.Entry(Settings.TABLE_GLOBAL, "stay_on_while_plugged_in", String.valueOf(stayOn));
+                batch.add(stayOnEntry);
+            }
+
+            try {
+                settings.getAndPutValues(batch);
+
+                if (showTouchesEntry != null) {
+                    // If "show touches" was disabled, it must be disabled back on clean up
+                    mustDisableShowTouchesOnCleanUp = !"1".equals(showTouchesEntry.getOldValue());
+                }
+                if (stayOnEntry != null) {
                     try {
-                        restoreStayOn = Integer.parseInt(oldValue);
+                        restoreStayOn = Integer.parseInt(stayOnEntry.getOldValue());
                         if (restoreStayOn == stayOn) {
                             // No need to restore
                             restoreStayOn = -1;
@@ -45,9 +58,9 @@ public final class Server {
                     } catch (NumberFormatException e) {
                         restoreStayOn = 0;
                     }
-                } catch (SettingsException e) {
-                    Ln.e("Could not change \"stay_on_while_plugged_in\"", e);
                 }
+            } catch (SettingsException e) {
+                Ln.e("Could not change settings", e);
             }
         }
 
@@ -60,16 +73,66 @@ public final class Server {
 
     private static void scrcpy(Options options) throws IOException {
         Ln.i("Device: " + Build.MANUFACTURER + " " + Build.MODEL + " (Android " + Build.VERSION.RELEASE + ")");
+
+        // Open the sockets in parallel with the Device initialization (which performs several binder calls), both are on the time-to-first-frame
+        // path
+        final boolean tunnelForward = options.isTunnelForward();
+        final int listenPort = options.getListenPort();
+        final boolean audio = options.getAudio();
+        FutureTask<DesktopConnection> connectionFuture = new FutureTask<>(new Callable<DesktopConnection>() {
+            @Override
+            public DesktopConnection call() throws IOException {
+                return DesktopConnection.open(tunnelForward, listenPort, audio);
+            }
+        });
+        Thread connectionThread = new Thread(connectionFuture);
+        // do not prevent the process from exiting if the device initialization fails while the socket is not connected yet
+        connectionThread.setDaemon(true);
+        connectionThread.start();
+
         final Device device = new Device(options);
         List<CodecOption> codecOptions = options.getCodecOptions();
 
+        int[] secondaryDisplayIds = options.getSecondaryDisplayIds();
+        if (secondaryDisplayIds.length > 0 && !options.getSendFrameMeta()) {
+            // without the frame meta headers, the client cannot demultiplex several displays
+            Ln.w("Secondary displays require the frame meta headers, ignored");
+            secondaryDisplayIds = new int[0];
+            options.setSecondaryDisplayIds(secondaryDisplayIds);
+        }
+        Device[] secondaryDevices = new Device[secondaryDisplayIds.length];
+        for (int i = 0; i < secondaryDisplayIds.length; ++i) {
+            secondaryDevices[i] = new Device(createSecondaryOptions(options, secondaryDisplayIds[i]));
+        }
+
         Thread initThread = startInitThread(options);
 
-        boolean tunnelForward = options.isTunnelForward();
+        TestPatternSource testPattern = null;
+        if (options.getSyntheticFps() > 0) {
+            testPattern = new TestPatternSource(options.getSyntheticSize(), options.getSyntheticFps());
+            Ln.i("Synthetic video source: " + options.getSyntheticSize() + " @ " + options.getSyntheticFps() + " fps");
+        }
+
+        try (DesktopConnection connection = waitConnection(connectionFuture)) {
+            // the video socket is connected, send the device name and initial video sizes
+            connection.sendDeviceMeta(device, secondaryDevices, testPattern != null ? testPattern.getSize() : null);
 
-        try (DesktopConnection connection = DesktopConnection.open(device, tunnelForward)) {
-            ScreenEncoder screenEncoder = new ScreenEncoder(options.getSendFrameMeta(), options.getBitRate(), options.getMaxFps(), codecOptions,
-                    options.getEncoderName());
+            // serializes the packets of all the encoders on the shared video socket
+            Object videoWriteLock = new Object();
+            ScreenEncoder screenEncoder = new ScreenEncoder(options.getSendFrameMeta(), options.getBitRate(), options.getCodec(),
+                    options.getMaxFps(), codecOptions, options.getEncoderName(), 0, videoWriteLock, testPattern);
+
+            for (int i = 0; i < secondaryDevices.length; ++i) {
+                ScreenEncoder secondaryEncoder = new ScreenEncoder(options.getSendFrameMeta(), options.getBitRate(), options.getCodec(),
+                        options.getMaxFps(), codecOptions, options.getEncoderName(), 1 + i, videoWriteLock, null);
+                startSecondaryEncoder(secondaryEncoder, secondaryDevices[i], connection);
+            }
+
+            if (options.getAudio()) {
+                AudioEncoder audioEncoder = new AudioEncoder(connection);
+                // asynchronous, terminates when the audio socket is closed
+                audioEncoder.start();
+            }
 
             Thread controllerThread = null;
             Thread deviceMessageSenderThread = null;
@@ -83,7 +146,7 @@ public final class Server {
                 device.setClipboardListener(new Device.ClipboardListener() {
                     @Override
                     public void onClipboardTextChanged(String text) {
-                        controller.getSender().pushClipboardText(text);
+                        controller.getSender().pushClipboardTextIfChanged(text);
                     }
                 });
             }
@@ -106,6 +169,48 @@ public final class Server {
         }
     }
 
+    private static Options createSecondaryOptions(Options options, int displayId) {
+        // a stripped copy: the secondary Device only mirrors, input and clipboard stay bound to the primary display
+        Options secondaryOptions = new Options();
+        secondaryOptions.setDisplayId(displayId);
+        secondaryOptions.setMaxSize(options.getMaxSize());
+        secondaryOptions.setLockVideoOrientation(options.getLockVideoOrientation());
+        secondaryOptions.setControl(false);
+        secondaryOptions.setClipboardAutosync(false);
+        return secondaryOptions;
+    }
+
+    private static void startSecondaryEncoder(final ScreenEncoder encoder, final Device device, final DesktopConnection connection) {
+        Thread thread = new Thread(new Runnable() {
+            @Override
+            public void run() {
+                try {
+                    encoder.streamScreen(device, connection.getVideoFd());
+                } catch (IOException e) {
+                    // this is expected on close
+                    Ln.d("Secondary screen streaming stopped");
+                }
+            }
+        });
+        // do not prevent the process from exiting when the primary stream ends
+        thread.setDaemon(true);
+        thread.start();
+    }
+
+    private static DesktopConnection waitConnection(FutureTask<DesktopConnection> future) throws IOException {
+        try {
+            return future.get();
+        } catch (InterruptedException e) {
+            throw new IOException("Connection interrupted", e);
+        } catch (ExecutionException e) {
+            Throwable cause = e.getCause();
+            if (cause instanceof IOException) {
+                throw (IOException) cause;
+            }
+            throw new IOException("Could not open connection", cause);
+        }
+    }
+
     private static Thread startInitThread(final Options options) {
         Thread thread = new Thread(new Runnable() {
             @Override
@@ -183,6 +288,9 @@ public final class Server {
                     int bitRate = Integer.parseInt(value);
                     options.setBitRate(bitRate);
                     break;
+                case "codec":
+                    options.setCodec(value);
+                    break;
                 case "max_fps":
                     int maxFps = Integer.parseInt(value);
                     options.setMaxFps(maxFps);
@@ -207,9 +315,32 @@ public final class Server {
                     boolean control = Boolean.parseBoolean(value);
                     options.setControl(control);
                     break;
+                case "synthetic_source": {
+                    // "<width>x<height>@<fps>": generate a test pattern instead of mirroring a display
+                    int xIndex = value.indexOf('x');
+                    int atIndex = value.indexOf('@');
+                    if (xIndex == -1 || atIndex == -1 || atIndex < xIndex) {
+                        throw new IllegalArgumentException("Invalid synthetic source: " + value);
+                    }
+                    int width = Integer.parseInt(value.substring(0, xIndex));
+                    int height = Integer.parseInt(value.substring(xIndex + 1, atIndex));
+                    int fps = Integer.parseInt(value.substring(atIndex + 1));
+                    if (width <= 0 || height <= 0 || fps <= 0) {
+                        throw new IllegalArgumentException("Invalid synthetic source: " + value);
+                    }
+                    options.setSyntheticSize(new Size(width, height));
+                    options.setSyntheticFps(fps);
+                    break;
+                }
                 case "display_id":
-                    int displayId = Integer.parseInt(value);
-                    options.setDisplayId(displayId);
+                    // a comma-separated list: the primary display, then optional secondary displays
+                    String[] displayIdTokens = value.split(",");
+                    options.setDisplayId(Integer.parseInt(displayIdTokens[0]));
+                    int[] secondaryDisplayIds = new int[displayIdTokens.length - 1];
+                    for (int j = 0; j < secondaryDisplayIds.length; ++j) {
+                        secondaryDisplayIds[j] = Integer.parseInt(displayIdTokens[j + 1]);
+                    }
+                    options.setSecondaryDisplayIds(secondaryDisplayIds);
                     break;
                 case "show_touches":
                     boolean showTouches = Boolean.parseBoolean(value);
@@ -236,6 +367,18 @@ public final class Server {
                     boolean clipboardAutosync = Boolean.parseBoolean(value);
                     options.setClipboardAutosync(clipboardAutosync);
                     break;
+                case "audio":
+                    boolean audio = Boolean.parseBoolean(value);
+                    options.setAudio(audio);
+                    break;
+                case "daemon":
+                    boolean daemon = Boolean.parseBoolean(value);
+                    options.setDaemon(daemon);
+                    break;
+                case "listen_port":
+                    int listenPort = Integer.parseInt(value);
+                    options.setListenPort(listenPort);
+                    break;
                 default:
                     Ln.w("Unknown server option: " + key);
                     break;
@@ -306,6 +449,23 @@ public final class Server {
 
         Ln.initLogLevel(options.getLogLevel());
 
-        scrcpy(options);
+        if (options.getDaemon()) {
+            if (!options.isTunnelForward()) {
+                throw new IllegalArgumentException("Daemon mode requires tunnel_forward=true");
+            }
+            // Stay resident: serve clients one at a time, re-listening on the localabstract socket after each session, so that a reconnecting
+            // client skips the whole app_process startup
+            while (true) {
+                try {
+                    scrcpy(options);
+                } catch (IOException e) {
+                    // this is expected when the client disconnects
+                    Ln.d("Session terminated: " + e.getMessage());
+                }
+                Ln.i("Daemon: waiting for a new client");
+            }
+        } else {
+            scrcpy(options);
+        }
     }
 }
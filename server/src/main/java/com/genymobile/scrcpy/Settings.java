@@ -6,6 +6,7 @@ import com.genymobile.scrcpy.wrappers.ServiceManager;
 import android.os.Build;
 
 import java.io.IOException;
+import java.util.List;
 
 public class Settings {
 
@@ -61,6 +62,26 @@ public class Settings {
         execSettingsPut(table, key, value);
     }
 
+    /**
+     * One settings value to read and replace as part of a batch (see {@link #getAndPutValues(List)} and {@link #putValues(List)}).
+     */
+    public static final class Entry {
+        private final String table;
+        private final String key;
+        private final String value;
+        private String oldValue;
+
+        public Entry(String table, String key, String value) {
+            this.table = table;
+            this.key = key;
+            this.value = value;
+        }
+
+        public String getOldValue() {
+            return oldValue;
+        }
+    }
+
     public String getAndPutValue(String table, String key, String value) throws SettingsException {
         if (Build.VERSION.SDK_INT <= Build.VERSION_CODES.R) {
             // on Android >= 12, it always fails: <https://github.com/Genymobile/scrcpy/issues/2788>
@@ -81,4 +102,62 @@ public class Settings {
         }
         return oldValue;
     }
+
+    /**
+     * Get and replace several settings values at once.
+     * <p>
+     * Each entry behaves like {@link #getAndPutValue(String, String, String)} (the old value is stored in the entry), but the binder
+     * transactions to acquire the settings ContentProvider are paid only once for the whole batch instead of once per key.
+     */
+    public void getAndPutValues(List<Entry> entries) throws SettingsException {
+        if (entries.isEmpty()) {
+            return;
+        }
+
+        if (Build.VERSION.SDK_INT <= Build.VERSION_CODES.R) {
+            // on Android >= 12, it always fails: <https://github.com/Genymobile/scrcpy/issues/2788>
+            try (ContentProvider provider = serviceManager.getActivityManager().createSettingsProvider()) {
+                for (Entry entry : entries) {
+                    String oldValue = provider.getValue(entry.table, entry.key);
+                    if (!entry.value.equals(oldValue)) {
+                        provider.putValue(entry.table, entry.key, entry.value);
+                    }
+                    entry.oldValue = oldValue;
+                }
+                return;
+            } catch (SettingsException e) {
+                Ln.w("Could not get and put settings values via ContentProvider, fallback to settings process", e);
+            }
+        }
+
+        // the fallback is idempotent, entries already applied above are unchanged
+        for (Entry entry : entries) {
+            entry.oldValue = getAndPutValue(entry.table, entry.key, entry.value);
+        }
+    }
+
+    /**
+     * Write several settings values at once, over a single ContentProvider acquisition (see {@link #getAndPutValues(List)}).
+     */
+    public void putValues(List<Entry> entries) throws SettingsException {
+        if (entries.isEmpty()) {
+            return;
+        }
+
+        if (Build.VERSION.SDK_INT <= Build.VERSION_CODES.R) {
+            // on Android >= 12, it always fails: <https://github.com/Genymobile/scrcpy/issues/2788>
+            try (ContentProvider provider = serviceManager.getActivityManager().createSettingsProvider()) {
+                for (Entry entry : entries) {
+                    provider.putValue(entry.table, entry.key, entry.value);
+                }
+                return;
+            } catch (SettingsException e) {
+                Ln.w("Could not put settings values via ContentProvider, fallback to settings process", e);
+            }
+        }
+
+        for (Entry entry : entries) {
+            putValue(entry.table, entry.key, entry.value);
+        }
+    }
 }
@@ -0,0 +1,113 @@
+package com.genymobile.scrcpy;
+
+import android.graphics.Canvas;
+import android.graphics.Color;
+import android.graphics.Paint;
+import android.os.Build;
+import android.view.Surface;
+
+/**
+ * Synthetic video source for device-free load testing.
+ * <p>
+ * Draws an animated test pattern on the encoder input surface at a fixed frame rate, instead of mirroring a display. This produces a realistic
+ * encoded stream (every frame differs from the previous one) without requiring any real screen content, so many servers can be benchmarked
+ * concurrently on CI hardware.
+ */
+public final class TestPatternSource {
+
+    private final Size size;
+    private final int fps;
+
+    private Thread thread;
+
+    public TestPatternSource(Size size, int fps) {
+        this.size = size;
+        this.fps = fps;
+    }
+
+    public Size getSize() {
+        return size;
+    }
+
+    public synchronized void start(final Surface surface) {
+        thread = new Thread(new Runnable() {
+            @Override
+            public void run() {
+                draw(surface);
+            }
+        }, "TestPatternSource");
+        thread.start();
+    }
+
+    public synchronized void stop() {
+        if (thread != null) {
+            thread.interrupt();
+            try {
+                thread.join();
+            } catch (InterruptedException e) {
+                Thread.currentThread().interrupt();
+            }
+            thread = null;
+        }
+    }
+
+    private void draw(Surface surface) {
+        long framePeriodMs = 1000 / fps;
+        Paint paint = new Paint();
+        long frame = 0;
+        try {
+            while (!Thread.currentThread().isInterrupted()) {
+                long start = System.currentTimeMillis();
+
+                Canvas canvas;
+                if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.M) {
+                    // required for a MediaCodec input surface on most devices
+                    canvas = surface.lockHardwareCanvas();
+                } else {
+                    canvas = surface.lockCanvas(null);
+                }
+                try {
+                    drawFrame(canvas, paint, frame);
+                } finally {
+                    surface.unlockCanvasAndPost(canvas);
+                }
+                ++frame;
+
+                long elapsed = System.currentTimeMillis() - start;
+                long remaining = framePeriodMs - elapsed;
+                if (remaining > 0) {
+                    Thread.sleep(remaining);
+                }
+            }
+        } catch (InterruptedException e) {
+            // end of stream
+        } catch (IllegalStateException e) {
+            // the surface has been released (the encoder is stopping)
+            Ln.d("Test pattern drawing stopped: " + e.getMessage());
+        }
+    }
+
+    private void drawFrame(Canvas canvas, Paint paint, long frame) {
+        int width = size.getWidth();
+        int height = size.getHeight();
+
+        // a color cycling background, so that no frame is identical to the previous one
+        canvas.drawColor(Color.HSVToColor(new float[]{frame % 360, 1f, 0.5f}));
+
+        // a bouncing square, to generate motion vectors
+        int side = Math.min(width, height) / 8;
+        int position = (int) (frame * side / 8);
+        int xRange = width - side;
+        int yRange = height - side;
+        int x = position % (2 * xRange);
+        if (x > xRange) {
+            x = 2 * xRange - x;
+        }
+        int y = position % (2 * yRange);
+        if (y > yRange) {
+            y = 2 * yRange - y;
+        }
+        paint.setColor(Color.WHITE);
+        canvas.drawRect(x, y, x + side, y + side, paint);
+    }
+}
@@ -11,6 +11,7 @@ import java.io.DataOutputStream;
 import java.io.IOException;
 import java.nio.charset.StandardCharsets;
 import java.util.Arrays;
+import java.util.zip.Deflater;
 
 
 public class ControlMessageReaderTest {
@@ -239,6 +240,7 @@ public class ControlMessageReaderTest {
         dos.writeByte(ControlMessage.TYPE_SET_CLIPBOARD);
         dos.writeLong(0x0102030405060708L); // sequence
         dos.writeByte(1); // paste
+        dos.writeByte(0); // not compressed
         byte[] text = "testé".getBytes(StandardCharsets.UTF_8);
         dos.writeInt(text.length);
         dos.write(text);
@@ -265,6 +267,7 @@ public class ControlMessageReaderTest {
         byte[] rawText = new byte[ControlMessageReader.CLIPBOARD_TEXT_MAX_LENGTH];
         dos.writeLong(0x0807060504030201L); // sequence
         dos.writeByte(1); // paste
+        dos.writeByte(0); // not compressed
         Arrays.fill(rawText, (byte) 'a');
         String text = new String(rawText, 0, rawText.length);
 
@@ -282,6 +285,43 @@ public class ControlMessageReaderTest {
         Assert.assertTrue(event.getPaste());
     }
 
+    @Test
+    public void testParseDeflatedSetClipboardEvent() throws IOException {
+        ControlMessageReader reader = new ControlMessageReader();
+
+        byte[] rawText = new byte[4096];
+        Arrays.fill(rawText, (byte) 'a');
+        String text = new String(rawText, StandardCharsets.UTF_8);
+
+        Deflater deflater = new Deflater(Deflater.BEST_SPEED);
+        deflater.setInput(rawText);
+        deflater.finish();
+        byte[] out = new byte[rawText.length];
+        int deflatedLen = deflater.deflate(out);
+        Assert.assertTrue(deflater.finished());
+        deflater.end();
+
+        ByteArrayOutputStream bos = new ByteArrayOutputStream();
+        DataOutputStream dos = new DataOutputStream(bos);
+        dos.writeByte(ControlMessage.TYPE_SET_CLIPBOARD);
+        dos.writeLong(0x0102030405060708L); // sequence
+        dos.writeByte(0); // no paste
+        dos.writeByte(1); // compressed
+        dos.writeInt(4 + deflatedLen); // payload length
+        dos.writeInt(rawText.length); // uncompressed length
+        dos.write(out, 0, deflatedLen);
+
+        byte[] packet = bos.toByteArray();
+
+        reader.readFrom(new ByteArrayInputStream(packet));
+        ControlMessage event = reader.next();
+
+        Assert.assertEquals(ControlMessage.TYPE_SET_CLIPBOARD, event.getType());
+        Assert.assertEquals(0x0102030405060708L, event.getSequence());
+        Assert.assertEquals(text, event.getText());
+        Assert.assertFalse(event.getPaste());
+    }
+
     @Test
     public void testParseSetScreenPowerMode() throws IOException {
         ControlMessageReader reader = new ControlMessageReader();
@@ -319,6 +359,48 @@ public class ControlMessageReaderTest {
         Assert.assertEquals(ControlMessage.TYPE_ROTATE_DEVICE, event.getType());
     }
 
+    @Test
+    public void testParseSetMaxSize() throws IOException {
+        ControlMessageReader reader = new ControlMessageReader();
+
+        ByteArrayOutputStream bos = new ByteArrayOutputStream();
+        DataOutputStream dos = new DataOutputStream(bos);
+        dos.writeByte(ControlMessage.TYPE_SET_MAX_SIZE);
+        dos.writeShort(1024);
+
+        byte[] packet = bos.toByteArray();
+
+        // The message type (1 byte) does not count
+        Assert.assertEquals(ControlMessageReader.SET_MAX_SIZE_PAYLOAD_LENGTH, packet.length - 1);
+
+        reader.readFrom(new ByteArrayInputStream(packet));
+        ControlMessage event = reader.next();
+
+        Assert.assertEquals(ControlMessage.TYPE_SET_MAX_SIZE, event.getType());
+        Assert.assertEquals(1024, event.getMaxSize());
+    }
+
+    @Test
+    public void testParseSetMaxFps() throws IOException {
+        ControlMessageReader reader = new ControlMessageReader();
+
+        ByteArrayOutputStream bos = new ByteArrayOutputStream();
+        DataOutputStream dos = new DataOutputStream(bos);
+        dos.writeByte(ControlMessage.TYPE_SET_MAX_FPS);
+        dos.writeShort(30);
+
+        byte[] packet = bos.toByteArray();
+
+        // The message type (1 byte) does not count
+        Assert.assertEquals(ControlMessageReader.SET_MAX_FPS_PAYLOAD_LENGTH, packet.length - 1);
+
+        reader.readFrom(new ByteArrayInputStream(packet));
+        ControlMessage event = reader.next();
+
+        Assert.assertEquals(ControlMessage.TYPE_SET_MAX_FPS, event.getType());
+        Assert.assertEquals(30, event.getMaxFps());
+    }
+
     @Test
     public void testMultiEvents() throws IOException {
         ControlMessageReader reader = new ControlMessageReader();
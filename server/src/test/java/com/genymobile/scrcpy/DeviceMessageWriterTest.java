@@ -6,7 +6,11 @@ import org.junit.Test;
 import java.io.ByteArrayOutputStream;
 import java.io.DataOutputStream;
 import java.io.IOException;
+import java.nio.ByteBuffer;
 import java.nio.charset.StandardCharsets;
+import java.util.Arrays;
+import java.util.zip.DataFormatException;
+import java.util.zip.Inflater;
 
 public class DeviceMessageWriterTest {
 
@@ -19,6 +23,7 @@ public class DeviceMessageWriterTest {
         ByteArrayOutputStream bos = new ByteArrayOutputStream();
         DataOutputStream dos = new DataOutputStream(bos);
         dos.writeByte(DeviceMessage.TYPE_CLIPBOARD);
+        dos.writeByte(0); // not compressed
         dos.writeInt(data.length);
         dos.write(data);
 
@@ -33,6 +38,39 @@ public class DeviceMessageWriterTest {
         Assert.assertArrayEquals(expected, actual);
     }
 
+    @Test
+    public void testSerializeBigClipboardDeflated() throws IOException, DataFormatException {
+        DeviceMessageWriter writer = new DeviceMessageWriter();
+
+        char[] rawText = new char[4096];
+        Arrays.fill(rawText, 'a');
+        String text = new String(rawText);
+
+        DeviceMessage msg = DeviceMessage.createClipboard(text);
+        ByteArrayOutputStream bos = new ByteArrayOutputStream();
+        writer.writeTo(msg, bos);
+
+        byte[] actual = bos.toByteArray();
+        // a repetitive text must be sent compressed
+        Assert.assertTrue(actual.length < rawText.length);
+
+        ByteBuffer buffer = ByteBuffer.wrap(actual);
+        Assert.assertEquals(DeviceMessage.TYPE_CLIPBOARD, buffer.get());
+        Assert.assertEquals(1, buffer.get()); // compressed
+        int payloadLen = buffer.getInt();
+        Assert.assertEquals(buffer.remaining(), payloadLen);
+        int uncompressedLen = buffer.getInt();
+        Assert.assertEquals(rawText.length, uncompressedLen);
+
+        Inflater inflater = new Inflater();
+        inflater.setInput(actual, buffer.position(), buffer.remaining());
+        byte[] uncompressed = new byte[uncompressedLen];
+        int r = inflater.inflate(uncompressed);
+        inflater.end();
+        Assert.assertEquals(uncompressedLen, r);
+        Assert.assertEquals(text, new String(uncompressed, StandardCharsets.UTF_8));
+    }
+
     @Test
     public void testSerializeAckSetClipboard() throws IOException {
         DeviceMessageWriter writer = new DeviceMessageWriter();
@@ -52,4 +90,31 @@ public class DeviceMessageWriterTest {
 
         Assert.assertArrayEquals(expected, actual);
     }
+
+    @Test
+    public void testSerializeBatch() throws IOException {
+        DeviceMessageWriter writer = new DeviceMessageWriter();
+
+        String text = "aéûoç";
+        byte[] data = text.getBytes(StandardCharsets.UTF_8);
+        ByteArrayOutputStream bos = new ByteArrayOutputStream();
+        DataOutputStream dos = new DataOutputStream(bos);
+        dos.writeByte(DeviceMessage.TYPE_ACK_CLIPBOARD);
+        dos.writeLong(0x0102030405060708L);
+        dos.writeByte(DeviceMessage.TYPE_CLIPBOARD);
+        dos.writeByte(0); // not compressed
+        dos.writeInt(data.length);
+        dos.write(data);
+
+        byte[] expected = bos.toByteArray();
+
+        DeviceMessage ack = DeviceMessage.createAckClipboard(0x0102030405060708L);
+        DeviceMessage clipboard = DeviceMessage.createClipboard(text);
+        bos = new ByteArrayOutputStream();
+        writer.writeTo(Arrays.asList(ack, clipboard), bos);
+
+        byte[] actual = bos.toByteArray();
+
+        Assert.assertArrayEquals(expected, actual);
+    }
 }